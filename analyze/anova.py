@@ -22,6 +22,9 @@ Usage:
   # ANOVA with post-hoc tests
   python3 anova.py data/experiment.csv --metric runtime_ns --group workload_type --posthoc tukey
 
+  # Binary results (.lrcr) work anywhere a CSV does; columns are read in place
+  python3 anova.py data/experiment.lrcr --metric runtime_ns --group workload_type
+
   # Multiple CSVs (each file is a group)
   python3 anova.py data/exp1.csv data/exp2.csv data/exp3.csv --metric runtime_ns
 
@@ -38,6 +41,8 @@ from collections import defaultdict
 from pathlib import Path
 from typing import List, Dict, Tuple, Optional
 
+import results
+
 # Try to import scipy for exact distributions
 try:
     from scipy import stats
@@ -369,8 +374,25 @@ def bonferroni_correction(groups: Dict[str, List[float]], alpha: float = 0.05) -
     return comparisons
 
 
+def load_binary_groups(path: Path, metric: str, group_column: str) -> Dict[str, List[float]]:
+    """Group one metric column of an .lrcr file (mapped, no row objects)."""
+    table = results.load(path)
+    for name in (metric, group_column):
+        if name not in table.types:
+            print(f"Error: Column '{name}' not found in {path}", file=sys.stderr)
+            return {}
+    
+    groups = defaultdict(list)
+    for group, value in zip(table.column(group_column), table.column(metric)):
+        groups[str(group)].append(float(value))
+    return dict(groups)
+
+
 def load_csv_groups(csv_path: Path, metric: str, group_column: str) -> Dict[str, List[float]]:
-    """Load data from CSV and group by column."""
+    """Load data from CSV (or .lrcr) and group by column."""
+    if results.is_results_file(csv_path):
+        return load_binary_groups(csv_path, metric, group_column)
+    
     groups = defaultdict(list)
     
     try:
@@ -404,6 +426,14 @@ def load_multiple_csvs(csv_paths: List[Path], metric: str) -> Dict[str, List[flo
     groups = {}
     
     for path in csv_paths:
+        if results.is_results_file(path):
+            table = results.load(path)
+            if metric not in table.types:
+                print(f"Warning: Metric '{metric}' not found in {path}", file=sys.stderr)
+                continue
+            groups[path.stem] = [float(v) for v in table.column(metric)]
+            continue
+        
         values = []
         try:
             with open(path, 'r') as f:
@@ -20,8 +20,9 @@ Usage:
   # Initialize database
   python3 analyze/db.py --init
 
-  # Store experiment results
+  # Store experiment results (.csv, or the scenario's .lrcr for a faster load)
   python3 analyze/db.py --store data/experiment.csv --scenario test --metadata metadata.json
+  python3 analyze/db.py --store data/experiment.lrcr --scenario test
 
   # Query experiments
   python3 analyze/db.py --query "SELECT * FROM experiments WHERE scenario='cache_hierarchy'"
@@ -44,7 +45,9 @@ import sys
 import hashlib
 from datetime import datetime
 from pathlib import Path
-from typing import Dict, List, Optional, Tuple, Any
+from typing import Dict, Iterator, List, Optional, Tuple, Any
+
+import results
 
 # Default database location
 DEFAULT_DB_PATH = Path.home() / '.lrc' / 'results.db'
@@ -52,6 +55,11 @@ DEFAULT_DB_PATH = Path.home() / '.lrc' / 'results.db'
 # Schema version for migrations
 SCHEMA_VERSION = 1
 
+# Result columns with their own field in runs; the rest go to custom_metrics
+RUN_COLUMNS = ['run', 'workload_type', 'timestamp_ns', 'runtime_ns',
+               'voluntary_ctxt_switches', 'nonvoluntary_ctxt_switches',
+               'minor_page_faults', 'major_page_faults', 'start_cpu', 'end_cpu']
+
 
 def get_db_path(custom_path: Optional[str] = None) -> Path:
     """Get database path, creating directory if needed."""
@@ -211,10 +219,58 @@ def get_or_create_system(conn: sqlite3.Connection, metadata: Dict[str, Any]) ->
         json.dumps(metadata)
     ))
     
-    conn.commit()
+    # Committed by the caller, together with the experiment
     return cursor.lastrowid
 
 
+def _csv_runs(csv_path: Path, experiment_id: int) -> Iterator[Tuple]:
+    """runs rows from a CSV file (every cell parsed from text)."""
+    with open(csv_path) as f:
+        reader = csv.DictReader(f)
+        for number, row in enumerate(reader):
+            custom_metrics = {key: value for key, value in row.items() if key not in RUN_COLUMNS}
+            yield (
+                experiment_id,
+                int(row.get('run', number)),
+                row.get('workload_type'),
+                int(row['timestamp_ns']) if row.get('timestamp_ns') else None,
+                int(row['runtime_ns']) if row.get('runtime_ns') else None,
+                int(row.get('voluntary_ctxt_switches', 0)),
+                int(row.get('nonvoluntary_ctxt_switches', 0)),
+                int(row.get('minor_page_faults', 0)),
+                int(row.get('major_page_faults', 0)),
+                int(row.get('start_cpu', -1)),
+                int(row.get('end_cpu', -1)),
+                json.dumps(custom_metrics) if custom_metrics else None
+            )
+
+
+def _binary_runs(table: 'results.ResultTable', experiment_id: int) -> Iterator[Tuple]:
+    """
+    runs rows from a mapped .lrcr file: columns are used in place (typed,
+    no parsing), missing ones become the CSV path's defaults.
+    """
+    n = len(table)
+    
+    def column(name, default):
+        return table.column(name) if name in table.types else [default] * n
+    
+    fixed = [column('run', None), column('workload_type', None),
+             column('timestamp_ns', None), column('runtime_ns', None),
+             column('voluntary_ctxt_switches', 0), column('nonvoluntary_ctxt_switches', 0),
+             column('minor_page_faults', 0), column('major_page_faults', 0),
+             column('start_cpu', -1), column('end_cpu', -1)]
+    custom_names = [name for name in table.names if name not in RUN_COLUMNS]
+    custom = [table.column(name) for name in custom_names]
+    runs = fixed[0]
+    
+    for i in range(n):
+        custom_metrics = {name: col[i] for name, col in zip(custom_names, custom)}
+        yield (experiment_id, i if runs[i] is None else runs[i]) + \
+            tuple(col[i] for col in fixed[1:]) + \
+            (json.dumps(custom_metrics) if custom_metrics else None,)
+
+
 def store_experiment(conn: sqlite3.Connection, 
                      csv_path: Path, 
                      scenario: str,
@@ -222,7 +278,9 @@ def store_experiment(conn: sqlite3.Connection,
                      notes: Optional[str] = None,
                      tags: Optional[List[str]] = None) -> int:
     """
-    Store experiment results from CSV file.
+    Store experiment results from a CSV or .lrcr file.
+    Runs go in with one prepared statement (executemany) and everything
+    commits as one transaction.
     Returns experiment_id.
     """
     cursor = conn.cursor()
@@ -263,42 +321,24 @@ def store_experiment(conn: sqlite3.Connection,
     
     experiment_id = cursor.lastrowid
     
-    # Store runs from CSV
-    num_samples = 0
-    with open(csv_path) as f:
-        reader = csv.DictReader(f)
-        for row in reader:
-            # Handle optional custom metrics
-            custom_metrics = {}
-            for key in row.keys():
-                if key not in ['run', 'workload_type', 'timestamp_ns', 'runtime_ns',
-                             'voluntary_ctxt_switches', 'nonvoluntary_ctxt_switches',
-                             'minor_page_faults', 'major_page_faults', 'start_cpu', 'end_cpu']:
-                    custom_metrics[key] = row[key]
-            
-            cursor.execute('''
-                INSERT INTO runs 
-                (experiment_id, run_number, workload_type, timestamp_ns, runtime_ns,
-                 voluntary_ctxt_switches, nonvoluntary_ctxt_switches,
-                 minor_page_faults, major_page_faults, start_cpu, end_cpu, custom_metrics)
-                VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
-            ''', (
-                experiment_id,
-                int(row.get('run', num_samples)),
-                row.get('workload_type'),
-                int(row['timestamp_ns']) if row.get('timestamp_ns') else None,
-                int(row['runtime_ns']) if row.get('runtime_ns') else None,
-                int(row.get('voluntary_ctxt_switches', 0)),
-                int(row.get('nonvoluntary_ctxt_switches', 0)),
-                int(row.get('minor_page_faults', 0)),
-                int(row.get('major_page_faults', 0)),
-                int(row.get('start_cpu', -1)),
-                int(row.get('end_cpu', -1)),
-                json.dumps(custom_metrics) if custom_metrics else None
-            ))
-            num_samples += 1
+    # Store runs
+    if results.is_results_file(csv_path):
+        table = results.load(csv_path)
+        runs = _binary_runs(table, experiment_id)
+    else:
+        runs = _csv_runs(csv_path, experiment_id)
+    
+    cursor.executemany('''
+        INSERT INTO runs 
+        (experiment_id, run_number, workload_type, timestamp_ns, runtime_ns,
+         voluntary_ctxt_switches, nonvoluntary_ctxt_switches,
+         minor_page_faults, major_page_faults, start_cpu, end_cpu, custom_metrics)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    ''', runs)
     
     # Update sample count
+    cursor.execute('SELECT COUNT(*) FROM runs WHERE experiment_id = ?', (experiment_id,))
+    num_samples = cursor.fetchone()[0]
     cursor.execute('UPDATE experiments SET num_samples = ? WHERE experiment_id = ?',
                   (num_samples, experiment_id))
     
@@ -506,7 +546,7 @@ Examples:
     
     parser.add_argument('--db', help='Database path (default: ~/.lrc/results.db)')
     parser.add_argument('--init', action='store_true', help='Initialize database')
-    parser.add_argument('--store', help='Store CSV results in database')
+    parser.add_argument('--store', help='Store CSV (or .lrcr) results in database')
     parser.add_argument('--scenario', help='Scenario name (required with --store)')
     parser.add_argument('--metadata', help='Metadata JSON file')
     parser.add_argument('--notes', help='Experiment notes')
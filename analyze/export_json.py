@@ -14,10 +14,10 @@ import csv
 import sys
 from pathlib import Path
 
-def csv_to_json(csv_file, output_file=None, include_metadata=True):
-    """Convert CSV results to JSON format"""
-    
-    # Read CSV data
+import results
+
+def read_csv_rows(csv_file):
+    """Column names and rows of a CSV file, numeric fields converted"""
     rows = []
     with open(csv_file, 'r') as f:
         reader = csv.DictReader(f)
@@ -38,6 +38,19 @@ def csv_to_json(csv_file, output_file=None, include_metadata=True):
             
             rows.append(converted_row)
     
+    return fieldnames, rows
+
+def csv_to_json(csv_file, output_file=None, include_metadata=True):
+    """Convert CSV (or .lrcr) results to JSON format"""
+    
+    # .lrcr cells are already typed
+    if results.is_results_file(csv_file):
+        table = results.load(csv_file)
+        fieldnames = table.names
+        rows = list(table.rows())
+    else:
+        fieldnames, rows = read_csv_rows(csv_file)
+    
     # Build JSON structure
     result = {
         'format_version': '1.0',
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+histogram.py - Decode and merge latency_hist columns
+
+Purpose:
+  Lock, syscall and I/O scenarios write the full latency distribution of
+  every run as one latency_hist cell (core/histogram.h). This decodes the
+  cells, merges them per group (the same bucket-wise sum the C side uses
+  for per-thread histograms) and prints percentiles over all runs.
+
+Cell format:
+  "<sub_bits>;<index>:<count>;<gap>:<count>;..." - the first pair holds
+  the absolute bucket index, each later pair the distance to the previous
+  non-empty bucket. Values are nanoseconds.
+
+Usage:
+  python3 histogram.py data/lock_scaling.csv --group lock_type threads
+  python3 histogram.py data/syscall_overhead.csv --group syscall_type
+  python3 histogram.py data/file_io_patterns.csv --group workload_type --dump
+"""
+
+import argparse
+import csv
+import sys
+from collections import OrderedDict
+from pathlib import Path
+from typing import Dict, List, Tuple
+
+PERCENTILES = [50.0, 90.0, 99.0, 99.9, 99.99]
+
+
+def decode(cell: str) -> Tuple[int, Dict[int, int]]:
+    """Return (sub_bits, {bucket index: count}) for one encoded cell."""
+    if not cell:
+        return 0, {}
+    parts = cell.split(';')
+    sub_bits = int(parts[0])
+    counts: Dict[int, int] = {}
+    index = None
+    for part in parts[1:]:
+        key, count = part.split(':')
+        index = int(key) if index is None else index + int(key)
+        counts[index] = counts.get(index, 0) + int(count)
+    return sub_bits, counts
+
+
+def bucket_low(index: int, sub_bits: int) -> int:
+    """Smallest value of a bucket (mirrors histogram_bucket_low())."""
+    sub_count = 1 << sub_bits
+    if index < sub_count:
+        return index
+    shift = (index >> sub_bits) - 1
+    return (sub_count + (index & (sub_count - 1))) << shift
+
+
+def bucket_high(index: int, sub_bits: int) -> int:
+    """Largest value of a bucket."""
+    sub_count = 1 << sub_bits
+    if index < sub_count:
+        return index
+    shift = (index >> sub_bits) - 1
+    return bucket_low(index, sub_bits) + (1 << shift) - 1
+
+
+def percentile(counts: Dict[int, int], sub_bits: int, pct: float) -> int:
+    """Upper bucket edge at a percentile (nearest rank), as in C."""
+    total = sum(counts.values())
+    if total == 0:
+        return 0
+    rank = max(1, int(pct / 100.0 * total + 0.5))
+    seen = 0
+    for index in sorted(counts):
+        seen += counts[index]
+        if seen >= rank:
+            return bucket_high(index, sub_bits)
+    return bucket_high(max(counts), sub_bits)
+
+
+def load(path: Path, group_by: List[str]) -> "OrderedDict[str, Tuple[int, Dict[int, int], int]]":
+    """Merge latency_hist cells per group: name -> (sub_bits, counts, rows)."""
+    groups: "OrderedDict[str, Tuple[int, Dict[int, int], int]]" = OrderedDict()
+    with open(path, newline='') as f:
+        reader = csv.DictReader(line for line in f if not line.startswith('#'))
+        if 'latency_hist' not in (reader.fieldnames or []):
+            print(f"{path}: no latency_hist column", file=sys.stderr)
+            sys.exit(1)
+        for row in reader:
+            sub_bits, counts = decode(row['latency_hist'])
+            if not counts:
+                continue
+            name = ' '.join(row.get(col, '?') for col in group_by) or 'all'
+            bits, merged, rows = groups.get(name, (sub_bits, {}, 0))
+            if bits != sub_bits:
+                print(f"{name}: mixed sub_bits {bits}/{sub_bits}", file=sys.stderr)
+                sys.exit(1)
+            for index, count in counts.items():
+                merged[index] = merged.get(index, 0) + count
+            groups[name] = (bits, merged, rows + 1)
+    return groups
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Percentiles from latency_hist columns")
+    parser.add_argument('csv', type=Path)
+    parser.add_argument('--group', nargs='*', default=[],
+                        help="Columns to group rows by (default: all rows together)")
+    parser.add_argument('--dump', action='store_true',
+                        help="Also print the non-empty buckets of each group")
+    args = parser.parse_args()
+
+    groups = load(args.csv, args.group)
+    if not groups:
+        print(f"{args.csv}: no non-empty histograms", file=sys.stderr)
+        sys.exit(1)
+
+    header = ''.join(f"{'p' + format(p, 'g'):>12}" for p in PERCENTILES)
+    print(f"=== Latency distribution (ns): {args.csv.name} ===")
+    print(f"{'group':<32}{'runs':>6}{'samples':>12}{header}")
+    for name, (bits, counts, rows) in groups.items():
+        total = sum(counts.values())
+        values = ''.join(f"{percentile(counts, bits, p):>12}" for p in PERCENTILES)
+        print(f"{name:<32}{rows:>6}{total:>12}{values}")
+        if args.dump:
+            for index in sorted(counts):
+                low, high = bucket_low(index, bits), bucket_high(index, bits)
+                print(f"    [{low:>12}, {high:>12}]  {counts[index]}")
+
+
+if __name__ == '__main__':
+    main()
@@ -3,7 +3,8 @@
 parse.py - Raw data parser
 
 Purpose:
-  Read CSV files produced by C experiments.
+  Read CSV or binary (.lrcr, see results.py) files produced by C
+  experiments.
   Perform basic statistical aggregation.
   No interpretation, just normalization.
 """
@@ -11,10 +12,12 @@ Purpose:
 import sys
 import csv
 from pathlib import Path
-from typing import Dict, List
+from typing import Dict, Iterator, List
 from dataclasses import dataclass
 import statistics
 
+import results
+
 
 @dataclass
 class Metrics:
@@ -72,43 +75,67 @@ class RunGroup:
         return sum(m.nonvoluntary_ctxt_switches for m in self.runs)
 
 
+def read_rows(filepath: Path) -> Iterator[Dict[str, object]]:
+    """
+    Rows of a results file as dicts.
+    
+    .lrcr files are mapped and read column-wise without parsing; CSV
+    files go through csv.DictReader. Values may be str (CSV) or typed
+    (binary), so convert with int()/float() either way.
+    """
+    if results.is_results_file(filepath):
+        yield from results.load(filepath).rows()
+        return
+    
+    with open(filepath, 'r') as f:
+        yield from csv.DictReader(f)
+
+
 def parse_csv(filepath: Path) -> Dict[str, RunGroup]:
     """
-    Parse experiment CSV file into grouped metrics.
+    Parse experiment CSV (or .lrcr) file into grouped metrics.
     
     Returns:
         Dictionary mapping group name to RunGroup
     """
     groups: Dict[str, List[Metrics]] = {}
     
-    with open(filepath, 'r') as f:
-        reader = csv.DictReader(f)
+    for row in read_rows(filepath):
+        # Determine group key (depends on experiment type)
+        if 'series' in row:
+            # Timeline samples (core/sampler.c): one group per run
+            group_key = str(row['series'])
+        elif 'affinity' in row:
+            group_key = str(row['affinity'])
+        elif 'nice_level' in row:
+            group_key = str(row['nice_level'])
+        elif 'buffer_size' in row:
+            group_key = str(row['buffer_size'])
+        else:
+            group_key = 'default'
+        if 'page_size' in row and 'series' not in row:
+            # lrc_alloc page-size sweep: keep 4k and huge page runs apart
+            group_key += '/' + str(row['page_size'])
+        
+        runtime_ns = int(row['runtime_ns'])
+        if 'series' in row and int(row.get('ns_per_mi') or 0) > 0:
+            # Timeline intervals have a fixed length; compare work rate
+            runtime_ns = int(row['ns_per_mi'])
+        
+        metrics = Metrics(
+            timestamp_ns=int(row['timestamp_ns']),
+            runtime_ns=runtime_ns,
+            voluntary_ctxt_switches=int(row['voluntary_ctxt_switches']),
+            nonvoluntary_ctxt_switches=int(row['nonvoluntary_ctxt_switches']),
+            minor_page_faults=int(row['minor_page_faults']),
+            major_page_faults=int(row['major_page_faults']),
+            start_cpu=int(row['start_cpu']),
+            end_cpu=int(row['end_cpu'])
+        )
         
-        for row in reader:
-            # Determine group key (depends on experiment type)
-            if 'affinity' in row:
-                group_key = row['affinity']
-            elif 'nice_level' in row:
-                group_key = row['nice_level']
-            elif 'buffer_size' in row:
-                group_key = row['buffer_size']
-            else:
-                group_key = 'default'
-            
-            metrics = Metrics(
-                timestamp_ns=int(row['timestamp_ns']),
-                runtime_ns=int(row['runtime_ns']),
-                voluntary_ctxt_switches=int(row['voluntary_ctxt_switches']),
-                nonvoluntary_ctxt_switches=int(row['nonvoluntary_ctxt_switches']),
-                minor_page_faults=int(row['minor_page_faults']),
-                major_page_faults=int(row['major_page_faults']),
-                start_cpu=int(row['start_cpu']),
-                end_cpu=int(row['end_cpu'])
-            )
-            
-            if group_key not in groups:
-                groups[group_key] = []
-            groups[group_key].append(metrics)
+        if group_key not in groups:
+            groups[group_key] = []
+        groups[group_key].append(metrics)
     
     return {name: RunGroup(name, runs) for name, runs in groups.items()}
 
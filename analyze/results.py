@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+results.py - Binary result loader
+
+Purpose:
+  Read .lrcr files written by core/results.c without parsing.
+  The file is mmap'd and each numeric column is a zero-copy
+  memoryview of the mapping; strings are decoded once per distinct
+  value, not per row.
+
+Usage:
+  python3 results.py data/lock_scaling.lrcr            # print as CSV
+  python3 results.py data/lock_scaling.lrcr --schema   # columns and types
+"""
+
+import sys
+import csv
+import mmap
+import struct
+from pathlib import Path
+from typing import Dict, Iterator, List, Union
+
+MAGIC = b'LRCRES01'
+VERSION = 1
+HEADER = struct.Struct('<8sIIQQQ24x')      # 64 bytes
+DESCRIPTOR = struct.Struct('<48sIiQ')      # 64 bytes
+
+TYPE_U64 = 1
+TYPE_I64 = 2
+TYPE_F64 = 3
+TYPE_STR = 4
+
+TYPE_NAMES = {TYPE_U64: 'u64', TYPE_I64: 'i64', TYPE_F64: 'f64', TYPE_STR: 'str'}
+_FORMATS = {TYPE_U64: 'Q', TYPE_I64: 'q', TYPE_F64: 'd', TYPE_STR: 'Q'}
+
+Column = Union[memoryview, List]
+
+
+def is_results_file(filepath: Path) -> bool:
+    """True if the file starts with the .lrcr magic."""
+    try:
+        with open(filepath, 'rb') as f:
+            return f.read(len(MAGIC)) == MAGIC
+    except OSError:
+        return False
+
+
+class ResultTable:
+    """Columnar view of one .lrcr file (keep it alive while columns are used)."""
+    
+    def __init__(self, filepath: Path):
+        self.path = Path(filepath)
+        with open(self.path, 'rb') as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        
+        magic, version, num_columns, num_rows, num_strings, strings_offset = \
+            HEADER.unpack_from(self._map, 0)
+        if magic != MAGIC:
+            raise ValueError(f"{self.path}: not an LRC results file")
+        if version != VERSION:
+            raise ValueError(f"{self.path}: unsupported version {version}")
+        
+        self.num_rows = num_rows
+        self.names: List[str] = []
+        self.types: Dict[str, int] = {}
+        self.decimals: Dict[str, int] = {}
+        self._offsets: Dict[str, int] = {}
+        
+        for c in range(num_columns):
+            raw, ctype, decimals, offset = DESCRIPTOR.unpack_from(
+                self._map, HEADER.size + c * DESCRIPTOR.size)
+            name = raw.split(b'\0', 1)[0].decode()
+            self.names.append(name)
+            self.types[name] = ctype
+            self.decimals[name] = decimals
+            self._offsets[name] = offset
+        
+        offsets = memoryview(self._map)[strings_offset:strings_offset + 8 * (num_strings + 1)]
+        offsets = offsets.cast('Q') if sys.byteorder == 'little' else \
+            struct.unpack_from(f'<{num_strings + 1}Q', offsets)
+        base = strings_offset + 8 * (num_strings + 1)
+        self.strings = [self._map[base + offsets[i]:base + offsets[i + 1]].decode()
+                        for i in range(num_strings)]
+        self._cache: Dict[str, Column] = {}
+    
+    def __len__(self) -> int:
+        return self.num_rows
+    
+    def column(self, name: str) -> Column:
+        """Column values: memoryview for numbers (no copy), list for strings."""
+        if name in self._cache:
+            return self._cache[name]
+        
+        ctype = self.types[name]
+        start = self._offsets[name]
+        raw = memoryview(self._map)[start:start + 8 * self.num_rows]
+        if sys.byteorder == 'little':
+            values = raw.cast(_FORMATS[ctype])
+        else:
+            values = list(struct.unpack_from(f'<{self.num_rows}{_FORMATS[ctype]}', raw))
+        
+        if ctype == TYPE_STR:
+            # Ids past the table (strings lost to ENOMEM) read as ''
+            n = len(self.strings)
+            values = [self.strings[i] if i < n else '' for i in values]
+        
+        self._cache[name] = values
+        return values
+    
+    def columns(self) -> Dict[str, Column]:
+        return {name: self.column(name) for name in self.names}
+    
+    def rows(self) -> Iterator[Dict[str, object]]:
+        """Rows as dicts (like csv.DictReader, but typed)."""
+        cols = [self.column(name) for name in self.names]
+        for i in range(self.num_rows):
+            yield {name: col[i] for name, col in zip(self.names, cols)}
+    
+    def format_cell(self, name: str, value) -> str:
+        """Format a value exactly as the CSV output of core/results.c."""
+        if self.types[name] == TYPE_F64:
+            decimals = self.decimals[name]
+            return f"{value:g}" if decimals < 0 else f"{value:.{decimals}f}"
+        return str(value)
+    
+    def write_csv(self, out) -> None:
+        writer = csv.writer(out, lineterminator='\n')
+        writer.writerow(self.names)
+        cols = [self.column(name) for name in self.names]
+        for i in range(self.num_rows):
+            writer.writerow([self.format_cell(name, col[i])
+                             for name, col in zip(self.names, cols)])
+
+
+def load(filepath: Path) -> ResultTable:
+    """Map an .lrcr file."""
+    return ResultTable(filepath)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(f"Usage: {sys.argv[0]} <data.lrcr> [--schema]", file=sys.stderr)
+        sys.exit(1)
+    
+    filepath = Path(sys.argv[1])
+    if not filepath.exists():
+        print(f"Error: {filepath} does not exist", file=sys.stderr)
+        sys.exit(1)
+    
+    table = load(filepath)
+    if '--schema' in sys.argv[2:]:
+        print(f"{filepath}: {len(table)} rows, {len(table.strings)} strings")
+        for name in table.names:
+            print(f"  {name:<40} {TYPE_NAMES.get(table.types[name], '?')}")
+    else:
+        table.write_csv(sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,562 @@
+/*
+ * async_io.c - Queue-depth driven block I/O engines
+ *
+ * Purpose:
+ *   file_io_patterns only measured synchronous reads at queue depth 1,
+ *   which says nothing about an NVMe device that needs tens of requests
+ *   in flight to reach its rated IOPS. This module keeps a fixed number
+ *   of requests outstanding through io_uring or native AIO and records
+ *   the latency of each one.
+ *
+ * Design:
+ *   - One buffer per queue slot (4 KB aligned, so O_DIRECT works);
+ *     a slot is busy from submission until its completion is reaped
+ *   - Up to `batch` requests are prepared, stamped with one clock read
+ *     and handed to the kernel in a single submit call; the loop blocks
+ *     for a completion only when every slot is busy
+ *   - io_uring rings are mapped directly (no liburing): registered
+ *     buffers use READ_FIXED/WRITE_FIXED, a registered file uses
+ *     IOSQE_FIXED_FILE, and with SQPOLL the kernel thread picks up new
+ *     entries so only waits and wake-ups cost a syscall
+ *   - Latencies go to a fixed-memory histogram (histogram.h), read for
+ *     percentiles at the end and passed out whole for the result file
+ *   - async_io_nop_* reuses the ring setup for IORING_OP_NOP batches:
+ *     one io_uring_enter submits and waits for the whole batch, which
+ *     isolates the per-request cost of the interface from any device
+ *
+ * Justification for syscalls:
+ *   io_uring_setup/io_uring_register/io_setup and mmap once per job.
+ *   In the loop: io_uring_enter or io_submit/io_getevents per batch,
+ *   pread/pwrite per request for the psync baseline, and
+ *   clock_gettime() (vDSO) once per submit and once per reap.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <linux/aio_abi.h>
+
+#include "async_io.h"
+#include "rng.h"
+
+#define BUFFER_ALIGN 4096
+#define SQPOLL_IDLE_MS 1000
+
+static const char *engine_names[ASYNC_IO_ENGINE_COUNT] = {
+    "psync", "libaio", "uring"
+};
+
+const char *async_io_engine_name(async_io_engine_t engine) {
+    if ((int)engine < 0 || engine >= ASYNC_IO_ENGINE_COUNT) return "unknown";
+    return engine_names[engine];
+}
+
+static inline uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* State shared by all engines for one job */
+typedef struct {
+    const async_io_params_t *p;
+    int fd;
+    uint64_t blocks;           // file_size / block_size
+    uint64_t next_block;       // Sequential mode cursor
+    lrc_rng_t rng;
+    
+    char *buffers;             // queue_depth * block_size
+    uint64_t *submit_ns;       // Per slot
+    unsigned *free_slots;      // Stack of idle slots
+    unsigned num_free;
+    unsigned *pending;         // Prepared, not yet submitted
+    unsigned num_pending;
+    
+    histogram_t *latency;      // Completion latencies (result->latency)
+    uint64_t completed;
+    uint64_t bytes;
+    uint64_t first_ns;         // First submission
+    uint64_t last_ns;          // Last completion
+    uint64_t syscalls;
+} job_t;
+
+static inline uint64_t next_offset(job_t *j) {
+    uint64_t block;
+    if (j->p->random) {
+        block = lrc_rng_next(&j->rng) % j->blocks;
+    } else {
+        block = j->next_block++;
+        if (j->next_block == j->blocks) j->next_block = 0;
+    }
+    return block * j->p->block_size;
+}
+
+static inline char *slot_buffer(job_t *j, unsigned slot) {
+    return j->buffers + (size_t)slot * j->p->block_size;
+}
+
+/* Stamp all prepared requests just before they are submitted */
+static inline void stamp_pending(job_t *j) {
+    uint64_t now = get_time_ns();
+    if (j->first_ns == 0) j->first_ns = now;
+    for (unsigned i = 0; i < j->num_pending; i++) {
+        j->submit_ns[j->pending[i]] = now;
+    }
+}
+
+static inline int complete(job_t *j, unsigned slot, int64_t res, uint64_t now) {
+    if (res < 0) {
+        errno = (int)-res;
+        return -1;
+    }
+    histogram_record(j->latency, now - j->submit_ns[slot]);
+    j->completed++;
+    j->last_ns = now;
+    j->bytes += (uint64_t)res;
+    j->free_slots[j->num_free++] = slot;
+    return 0;
+}
+
+/* ---- psync ---- */
+
+static int run_psync(job_t *j) {
+    const async_io_params_t *p = j->p;
+    char *buf = slot_buffer(j, 0);
+    
+    for (uint64_t i = 0; i < p->num_ios; i++) {
+        uint64_t offset = next_offset(j);
+        uint64_t start = get_time_ns();
+        ssize_t ret = p->write ? pwrite(j->fd, buf, p->block_size, offset)
+                               : pread(j->fd, buf, p->block_size, offset);
+        uint64_t now = get_time_ns();
+        j->syscalls++;
+        
+        if (j->first_ns == 0) j->first_ns = start;
+        j->submit_ns[0] = start;
+        j->num_free--;
+        if (complete(j, 0, ret < 0 ? -errno : ret, now) != 0) return -1;
+    }
+    return 0;
+}
+
+/* ---- Native AIO ---- */
+
+static int run_libaio(job_t *j) {
+    const async_io_params_t *p = j->p;
+    unsigned depth = p->queue_depth;
+    aio_context_t ctx = 0;
+    int ret = -1;
+    
+    struct iocb *iocbs = calloc(depth, sizeof(struct iocb));
+    struct iocb **ptrs = calloc(depth, sizeof(struct iocb *));
+    struct io_event *events = calloc(depth, sizeof(struct io_event));
+    if (!iocbs || !ptrs || !events) goto out;
+    
+    if (syscall(SYS_io_setup, depth, &ctx) != 0) goto out;
+    
+    uint64_t issued = 0;
+    while (j->completed < p->num_ios) {
+        unsigned limit = p->batch;
+        while (j->num_free > 0 && issued < p->num_ios && j->num_pending < limit) {
+            unsigned slot = j->free_slots[--j->num_free];
+            struct iocb *cb = &iocbs[slot];
+            memset(cb, 0, sizeof(*cb));
+            cb->aio_fildes = j->fd;
+            cb->aio_lio_opcode = p->write ? IOCB_CMD_PWRITE : IOCB_CMD_PREAD;
+            cb->aio_buf = (uintptr_t)slot_buffer(j, slot);
+            cb->aio_nbytes = p->block_size;
+            cb->aio_offset = next_offset(j);
+            cb->aio_data = slot;
+            ptrs[j->num_pending] = cb;
+            j->pending[j->num_pending++] = slot;
+            issued++;
+        }
+        
+        if (j->num_pending > 0) {
+            stamp_pending(j);
+            long submitted = syscall(SYS_io_submit, ctx, (long)j->num_pending, ptrs);
+            j->syscalls++;
+            if (submitted != (long)j->num_pending) {
+                if (submitted >= 0) errno = EAGAIN;
+                goto out;
+            }
+            j->num_pending = 0;
+        }
+        
+        // Wait only when no slot is free or nothing is left to issue
+        if (j->num_free > 0 && issued < p->num_ios) continue;
+        
+        long n = syscall(SYS_io_getevents, ctx, 1L, (long)depth, events, NULL);
+        j->syscalls++;
+        if (n < 0) goto out;
+        uint64_t now = get_time_ns();
+        for (long i = 0; i < n; i++) {
+            if (complete(j, (unsigned)events[i].data, events[i].res, now) != 0) goto out;
+        }
+    }
+    ret = 0;
+
+out:
+    if (ctx) {
+        int saved = errno;
+        syscall(SYS_io_destroy, ctx);
+        errno = saved;
+    }
+    free(iocbs);
+    free(ptrs);
+    free(events);
+    return ret;
+}
+
+/* ---- io_uring ---- */
+
+typedef struct {
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqes_size;
+} uring_t;
+
+static void uring_destroy(uring_t *u) {
+    int saved = errno;
+    if (u->sqes) munmap(u->sqes, u->sqes_size);
+    if (u->cq_ptr && u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_size);
+    if (u->sq_ptr) munmap(u->sq_ptr, u->sq_size);
+    if (u->ring_fd >= 0) close(u->ring_fd);
+    errno = saved;
+}
+
+static int uring_setup(uring_t *u, unsigned entries, unsigned flags) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(u, 0, sizeof(*u));
+    u->ring_fd = -1;
+    
+    if (flags & ASYNC_IO_SQPOLL) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = SQPOLL_IDLE_MS;
+    }
+    
+    u->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (u->ring_fd < 0) return -1;
+    u->sq_entries = params.sq_entries;
+    
+    u->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    u->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_size > u->sq_size) u->sq_size = u->cq_size;
+        u->cq_size = u->sq_size;
+    }
+    
+    u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) {
+        u->sq_ptr = NULL;
+        goto fail;
+    }
+    
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ptr = u->sq_ptr;
+    } else {
+        u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         u->ring_fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED) {
+            u->cq_ptr = NULL;
+            goto fail;
+        }
+    }
+    
+    u->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        goto fail;
+    }
+    
+    char *sq = u->sq_ptr;
+    char *cq = u->cq_ptr;
+    u->sq_head = (unsigned *)(sq + params.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    u->sq_flags = (unsigned *)(sq + params.sq_off.flags);
+    u->sq_array = (unsigned *)(sq + params.sq_off.array);
+    u->cq_head = (unsigned *)(cq + params.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    
+    // SQ entry i always lives in SQE slot i
+    for (unsigned i = 0; i < params.sq_entries; i++) {
+        u->sq_array[i] = i;
+    }
+    return 0;
+
+fail:
+    uring_destroy(u);
+    return -1;
+}
+
+static inline int uring_enter(job_t *j, uring_t *u, unsigned to_submit,
+                              unsigned min_complete, unsigned flags) {
+    j->syscalls++;
+    return (int)syscall(__NR_io_uring_enter, u->ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/* Reap every completion currently in the CQ ring */
+static int uring_reap(job_t *j, uring_t *u) {
+    unsigned head = *u->cq_head;
+    unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) return 0;
+    
+    uint64_t now = get_time_ns();
+    unsigned mask = *u->cq_mask;
+    int ret = 0;
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &u->cqes[head & mask];
+        if (complete(j, (unsigned)cqe->user_data, cqe->res, now) != 0) {
+            ret = -1;
+            head++;
+            break;
+        }
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    return ret;
+}
+
+static int run_uring(job_t *j) {
+    const async_io_params_t *p = j->p;
+    unsigned depth = p->queue_depth;
+    int fixed_buffers = (p->flags & ASYNC_IO_FIXED_BUFFERS) != 0;
+    int fixed_file = (p->flags & ASYNC_IO_FIXED_FILE) != 0;
+    int sqpoll = (p->flags & ASYNC_IO_SQPOLL) != 0;
+    uring_t u;
+    int ret = -1;
+    
+    if (uring_setup(&u, depth, p->flags) != 0) return -1;
+    
+    if (fixed_buffers) {
+        struct iovec *iov = calloc(depth, sizeof(struct iovec));
+        if (!iov) goto out;
+        for (unsigned i = 0; i < depth; i++) {
+            iov[i].iov_base = slot_buffer(j, i);
+            iov[i].iov_len = p->block_size;
+        }
+        int r = (int)syscall(__NR_io_uring_register, u.ring_fd, IORING_REGISTER_BUFFERS, iov, depth);
+        free(iov);
+        if (r != 0) goto out;
+    }
+    if (fixed_file) {
+        if (syscall(__NR_io_uring_register, u.ring_fd, IORING_REGISTER_FILES, &j->fd, 1) != 0) {
+            goto out;
+        }
+    }
+    
+    uint8_t opcode = p->write ? (fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE)
+                              : (fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ);
+    unsigned mask = *u.sq_mask;
+    uint64_t issued = 0;
+    
+    while (j->completed < p->num_ios) {
+        unsigned tail = *u.sq_tail;
+        while (j->num_free > 0 && issued < p->num_ios && j->num_pending < p->batch) {
+            unsigned slot = j->free_slots[--j->num_free];
+            struct io_uring_sqe *sqe = &u.sqes[tail & mask];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = opcode;
+            sqe->fd = fixed_file ? 0 : j->fd;
+            sqe->flags = fixed_file ? IOSQE_FIXED_FILE : 0;
+            sqe->addr = (uintptr_t)slot_buffer(j, slot);
+            sqe->len = (unsigned)p->block_size;
+            sqe->off = next_offset(j);
+            sqe->buf_index = fixed_buffers ? (uint16_t)slot : 0;
+            sqe->user_data = slot;
+            j->pending[j->num_pending++] = slot;
+            tail++;
+            issued++;
+        }
+        
+        unsigned to_submit = j->num_pending;
+        if (to_submit > 0) {
+            stamp_pending(j);
+            __atomic_store_n(u.sq_tail, tail, __ATOMIC_RELEASE);
+            j->num_pending = 0;
+        }
+        
+        // Wait only when no slot is free or nothing is left to issue
+        int wait = j->num_free == 0 || issued == p->num_ios;
+        
+        if (sqpoll) {
+            if (to_submit > 0) {
+                // Full barrier: tail store must be visible before the flag read
+                __atomic_thread_fence(__ATOMIC_SEQ_CST);
+                if (__atomic_load_n(u.sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+                    if (uring_enter(j, &u, 0, 0, IORING_ENTER_SQ_WAKEUP) < 0) goto out;
+                }
+            }
+            // Sleep only if nothing has completed yet
+            if (wait && *u.cq_head == __atomic_load_n(u.cq_tail, __ATOMIC_ACQUIRE)) {
+                if (uring_enter(j, &u, 0, 1, IORING_ENTER_GETEVENTS) < 0) goto out;
+            }
+        } else if (to_submit > 0 || wait) {
+            int r = uring_enter(j, &u, to_submit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+            if (r < 0) goto out;
+            if ((unsigned)r != to_submit) {
+                errno = EAGAIN;
+                goto out;
+            }
+        }
+        if (uring_reap(j, &u) != 0) goto out;
+    }
+    ret = 0;
+
+out:
+    uring_destroy(&u);
+    return ret;
+}
+
+int async_io_run(int fd, uint64_t file_size, const async_io_params_t *params,
+                 async_io_result_t *result) {
+    async_io_params_t p = *params;
+    job_t j;
+    int ret = -1;
+    
+    if (p.engine == ASYNC_IO_PSYNC) p.queue_depth = 1;
+    if (p.batch == 0 || p.batch > p.queue_depth) p.batch = p.queue_depth;
+    if (p.queue_depth == 0 || p.block_size == 0 || p.num_ios == 0 ||
+        file_size < p.block_size || p.engine >= ASYNC_IO_ENGINE_COUNT) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    memset(&j, 0, sizeof(j));
+    j.p = &p;
+    j.fd = fd;
+    j.blocks = file_size / p.block_size;
+    lrc_rng_seed(&j.rng, p.seed);
+    
+    size_t buffer_bytes = (size_t)p.queue_depth * p.block_size;
+    if (posix_memalign((void **)&j.buffers, BUFFER_ALIGN, buffer_bytes) != 0) {
+        j.buffers = NULL;
+        errno = ENOMEM;
+        goto out;
+    }
+    memset(j.buffers, 0xAA, buffer_bytes);
+    j.submit_ns = calloc(p.queue_depth, sizeof(uint64_t));
+    j.free_slots = calloc(p.queue_depth, sizeof(unsigned));
+    j.pending = calloc(p.queue_depth, sizeof(unsigned));
+    if (!j.submit_ns || !j.free_slots || !j.pending) {
+        errno = ENOMEM;
+        goto out;
+    }
+    memset(result, 0, sizeof(*result));
+    histogram_reset(&result->latency);
+    j.latency = &result->latency;
+    for (unsigned i = 0; i < p.queue_depth; i++) {
+        j.free_slots[j.num_free++] = p.queue_depth - 1 - i;
+    }
+    
+    int r;
+    switch (p.engine) {
+    case ASYNC_IO_LIBAIO: r = run_libaio(&j); break;
+    case ASYNC_IO_URING:  r = run_uring(&j); break;
+    default:              r = run_psync(&j); break;
+    }
+    if (r != 0) goto out;
+    
+    result->ios = j.completed;
+    result->bytes = j.bytes;
+    result->runtime_ns = j.last_ns - j.first_ns;
+    result->syscalls = j.syscalls;
+    
+    result->p50_ns = histogram_percentile(&result->latency, 50.0);
+    result->p90_ns = histogram_percentile(&result->latency, 90.0);
+    result->p99_ns = histogram_percentile(&result->latency, 99.0);
+    result->p999_ns = histogram_percentile(&result->latency, 99.9);
+    result->max_ns = result->latency.max;
+    ret = 0;
+
+out:
+    {
+        int saved = errno;
+        free(j.buffers);
+        free(j.submit_ns);
+        free(j.free_slots);
+        free(j.pending);
+        errno = saved;
+    }
+    return ret;
+}
+
+/* ---- io_uring no-op batches ---- */
+
+struct async_io_nop {
+    uring_t u;
+};
+
+async_io_nop_t *async_io_nop_open(unsigned entries) {
+    async_io_nop_t *n = malloc(sizeof(*n));
+    if (!n) return NULL;
+    if (uring_setup(&n->u, entries, 0) != 0) {
+        int saved = errno;
+        free(n);
+        errno = saved;
+        return NULL;
+    }
+    return n;
+}
+
+unsigned async_io_nop_entries(const async_io_nop_t *n) {
+    return n->u.sq_entries;
+}
+
+int async_io_nop_submit(async_io_nop_t *n, unsigned count) {
+    uring_t *u = &n->u;
+    if (count == 0 || count > u->sq_entries) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    unsigned tail = *u->sq_tail;
+    unsigned mask = *u->sq_mask;
+    for (unsigned i = 0; i < count; i++, tail++) {
+        struct io_uring_sqe *sqe = &u->sqes[tail & mask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = i;
+    }
+    __atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+    
+    // Submit and wait for all of them in the same call
+    if (syscall(__NR_io_uring_enter, u->ring_fd, count, count, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+        return -1;
+    }
+    
+    unsigned head = *u->cq_head;
+    unsigned cq_tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned cq_mask = *u->cq_mask;
+    int done = 0;
+    for (; head != cq_tail; head++) {
+        if (u->cqes[head & cq_mask].res >= 0) done++;
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    return done;
+}
+
+void async_io_nop_close(async_io_nop_t *n) {
+    if (!n) return;
+    uring_destroy(&n->u);
+    free(n);
+}
@@ -0,0 +1,99 @@
+/*
+ * async_io.h - Queue-depth driven block I/O engines
+ *
+ * Closed-loop I/O generator: keeps queue_depth block-sized requests in
+ * flight against one file descriptor until num_ios have completed, and
+ * times every request from submission to completion. Engines are
+ * io_uring (plain, registered buffers/file, SQPOLL), Linux native AIO
+ * (io_submit, O_DIRECT only) and pread/pwrite as the QD1 baseline.
+ *
+ * Both async interfaces are driven through raw syscalls, so neither
+ * liburing nor libaio is needed to build or run.
+ */
+
+#ifndef LRC_ASYNC_IO_H
+#define LRC_ASYNC_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "histogram.h"
+
+typedef enum {
+    ASYNC_IO_PSYNC = 0,       // pread/pwrite, queue depth 1
+    ASYNC_IO_LIBAIO,          // io_setup/io_submit/io_getevents
+    ASYNC_IO_URING,           // io_uring_setup/io_uring_enter
+    ASYNC_IO_ENGINE_COUNT
+} async_io_engine_t;
+
+/* io_uring options (ignored by the other engines) */
+#define ASYNC_IO_FIXED_BUFFERS 0x1    // IORING_REGISTER_BUFFERS + READ/WRITE_FIXED
+#define ASYNC_IO_FIXED_FILE    0x2    // IORING_REGISTER_FILES + IOSQE_FIXED_FILE
+#define ASYNC_IO_SQPOLL        0x4    // Kernel thread polls the SQ (no submit syscall)
+
+typedef struct {
+    async_io_engine_t engine;
+    unsigned flags;           // ASYNC_IO_* options
+    unsigned queue_depth;     // Requests kept in flight
+    unsigned batch;           // Requests per submit call (0 = queue_depth)
+    size_t block_size;        // Bytes per request (multiple of 4096 for O_DIRECT)
+    int write;                // 1 = writes, 0 = reads
+    int random;               // 1 = uniform random blocks, 0 = sequential
+    uint64_t num_ios;         // Requests to complete
+    uint64_t seed;            // Offset sequence (random mode)
+} async_io_params_t;
+
+typedef struct {
+    uint64_t ios;             // Requests completed
+    uint64_t bytes;
+    uint64_t runtime_ns;      // First submission to last completion
+    uint64_t syscalls;        // Submit/wait syscalls issued
+    uint64_t p50_ns;          // Per-request latency percentiles
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+    histogram_t latency;      // Every completion, submission to reap
+} async_io_result_t;
+
+/**
+ * @brief Run one closed-loop I/O job
+ * @param fd File to read or write (opened by the caller, O_DIRECT as needed)
+ * @param file_size Offsets stay within [0, file_size)
+ * @param params Engine, depth, block size and request count
+ * @param result Filled with throughput and latency percentiles
+ * @return 0 on success, -1 on error (errno set; ENOSYS/EPERM mean the
+ *         engine or option is not available on this kernel)
+ */
+int async_io_run(int fd, uint64_t file_size, const async_io_params_t *params,
+                 async_io_result_t *result);
+
+/* Minimal io_uring that only runs IORING_OP_NOP (syscall batching cost) */
+typedef struct async_io_nop async_io_nop_t;
+
+/**
+ * @brief Set up a ring for no-op batches
+ * @param entries Submission queue size (rounded up to a power of two)
+ * @return Ring, or NULL with errno set (ENOSYS/EPERM without io_uring)
+ */
+async_io_nop_t *async_io_nop_open(unsigned entries);
+
+/**
+ * @brief Largest batch async_io_nop_submit() accepts
+ */
+unsigned async_io_nop_entries(const async_io_nop_t *n);
+
+/**
+ * @brief Queue count NOPs, submit and reap them with one io_uring_enter
+ * @return Completions that succeeded, -1 with errno set
+ */
+int async_io_nop_submit(async_io_nop_t *n, unsigned count);
+
+void async_io_nop_close(async_io_nop_t *n);
+
+/**
+ * @brief Short engine name for CSV labels ("psync", "libaio", "uring")
+ */
+const char *async_io_engine_name(async_io_engine_t engine);
+
+#endif /* LRC_ASYNC_IO_H */
@@ -18,7 +18,12 @@
  *   indicate scheduler interference, not workload characteristics.
  */
 
+#define _GNU_SOURCE
 #include <stdint.h>
+#include <time.h>
+
+#define CALIBRATION_ITERATIONS (1ULL << 20)
+#define CALIBRATION_TRIALS 7
 
 /*
  * Perform fixed number of integer operations.
@@ -55,3 +60,42 @@ uint64_t cpu_spin_long(uint64_t iterations, uint32_t phases) {
     
     return result;
 }
+
+/*
+ * Calibrate cpu_spin() against CLOCK_MONOTONIC_RAW.
+ * Returns iterations per nanosecond. Best of several ~1ms trials, since
+ * preemption can only make a trial slower. Cached after the first call;
+ * valid for the CPU frequency at calibration time.
+ */
+double cpu_spin_calibrate(void) {
+    static double iterations_per_ns;
+    
+    if (iterations_per_ns > 0.0) return iterations_per_ns;
+    
+    volatile uint64_t sink = cpu_spin(CALIBRATION_ITERATIONS);  // Warm-up
+    double best = 0.0;
+    
+    for (int trial = 0; trial < CALIBRATION_TRIALS; trial++) {
+        struct timespec start, end;
+        
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        sink += cpu_spin(CALIBRATION_ITERATIONS);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        
+        uint64_t ns = (end.tv_sec - start.tv_sec) * 1000000000ULL +
+                      (end.tv_nsec - start.tv_nsec);
+        double rate = ns ? (double)CALIBRATION_ITERATIONS / ns : 0.0;
+        if (rate > best) best = rate;
+    }
+    (void)sink;
+    
+    iterations_per_ns = best > 0.0 ? best : 1.0;
+    return iterations_per_ns;
+}
+
+/*
+ * cpu_spin() iterations that take about ns nanoseconds.
+ */
+uint64_t cpu_spin_iterations_for_ns(uint64_t ns) {
+    return (uint64_t)(ns * cpu_spin_calibrate() + 0.5);
+}
@@ -0,0 +1,98 @@
+/*
+ * histogram.h - Fixed-memory log-linear latency histogram
+ *
+ * HDR-style bucketing: values below 2^HISTOGRAM_SUB_BITS get one bucket
+ * each, above that every power of two is split into 2^HISTOGRAM_SUB_BITS
+ * linear sub-buckets, so the relative error is below 1/64 (1.6%) from
+ * 1 ns to 2^63 ns. The counts live inside the struct: recording is an
+ * index computation and one increment, no allocation, no locks. Each
+ * thread records into its own histogram; merge them after the run.
+ *
+ *     histogram_t h;
+ *     histogram_reset(&h);
+ *     for (...) histogram_record(&h, latency_ns);
+ *     uint64_t p99 = histogram_percentile(&h, 99.0);
+ *     results_histogram(&out, &h);      // Compact text cell
+ */
+
+#ifndef LRC_HISTOGRAM_H
+#define LRC_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BITS 6
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+/* Longest histogram_encode() output (every bucket non-empty) */
+#define HISTOGRAM_ENCODED_MAX (16 + HISTOGRAM_BUCKETS * 26)
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint64_t counts[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+/**
+ * @brief Bucket index of a value (exact below HISTOGRAM_SUB_COUNT)
+ */
+static inline int histogram_index(uint64_t v) {
+    if (v < HISTOGRAM_SUB_COUNT) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + (int)((v >> shift) - HISTOGRAM_SUB_COUNT);
+}
+
+/**
+ * @brief Record one value (hot path: no branches beyond min/max)
+ */
+static inline void histogram_record(histogram_t *h, uint64_t v) {
+    h->counts[histogram_index(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+}
+
+/**
+ * @brief Empty the histogram
+ */
+void histogram_reset(histogram_t *h);
+
+/**
+ * @brief Add every count of src to dst
+ */
+void histogram_merge(histogram_t *dst, const histogram_t *src);
+
+/**
+ * @brief Smallest value of a bucket
+ */
+uint64_t histogram_bucket_low(int index);
+
+/**
+ * @brief Value at a percentile (0-100), as the upper edge of its bucket
+ *        capped at the recorded max; 0 when empty
+ */
+uint64_t histogram_percentile(const histogram_t *h, double percentile);
+
+/**
+ * @brief Arithmetic mean of the recorded values (exact, from the sum)
+ */
+double histogram_mean(const histogram_t *h);
+
+/**
+ * @brief Sparse text form for a CSV cell
+ *
+ * "<sub_bits>;<index>:<count>;<gap>:<count>;..." where the first pair
+ * carries the absolute bucket index and each later one the distance to
+ * the previous non-empty bucket. No commas, so the cell needs no
+ * quoting. analyze/histogram.py decodes it.
+ *
+ * @return Length written (truncated to len - 1 if buf is too small)
+ */
+size_t histogram_encode(const histogram_t *h, char *buf, size_t len);
+
+#endif /* LRC_HISTOGRAM_H */
@@ -0,0 +1,69 @@
+/*
+ * hw_prefetch.h - Switch the hardware prefetchers off and back on
+ *
+ * Intel cores expose their four data prefetchers as disable bits in
+ * MSR 0x1A4 (MISC_FEATURE_CONTROL), one register per core. Clearing
+ * them shows what a loop gets from software prefetch alone:
+ *
+ *     hw_prefetch_t pf;
+ *     if (hw_prefetch_disable(&pf, sched_getcpu(), HW_PREFETCH_ALL) == 0) {
+ *         ...                                   // Measure on that CPU
+ *         hw_prefetch_restore(&pf);             // Original value back
+ *     }
+ *
+ * Needs root and the msr driver (modprobe msr, /dev/cpu/N/msr). Other
+ * vendors use different registers and get ENOTSUP.
+ */
+
+#ifndef LRC_HW_PREFETCH_H
+#define LRC_HW_PREFETCH_H
+
+#include <stdint.h>
+
+#define HW_PREFETCH_MSR 0x1A4
+
+/* Disable bits in MSR 0x1A4 */
+#define HW_PREFETCH_L2_STREAMER 0x1   // L2 hardware (streamer) prefetcher
+#define HW_PREFETCH_L2_ADJACENT 0x2   // L2 adjacent cache line prefetcher
+#define HW_PREFETCH_DCU         0x4   // L1 next-line (DCU streamer) prefetcher
+#define HW_PREFETCH_DCU_IP      0x8   // L1 IP-based stride prefetcher
+#define HW_PREFETCH_ALL         0xF
+
+typedef struct {
+    int cpu;                  // -1 = nothing to restore
+    int fd;                   // /dev/cpu/<cpu>/msr, open until restored
+    uint64_t saved;           // MSR value before hw_prefetch_disable()
+} hw_prefetch_t;
+
+/**
+ * @brief Read an MSR through /dev/cpu/<cpu>/msr
+ * @return 0 on success, -1 with errno set (ENOENT without the msr driver,
+ *         EACCES/EPERM without root, EIO if the register does not exist)
+ */
+int msr_read(int cpu, uint32_t reg, uint64_t *value);
+
+/**
+ * @brief Write an MSR through /dev/cpu/<cpu>/msr
+ */
+int msr_write(int cpu, uint32_t reg, uint64_t value);
+
+/**
+ * @brief Whether MSR 0x1A4 can be read and written on this machine
+ */
+int hw_prefetch_supported(void);
+
+/**
+ * @brief Set the disable bits in mask on one CPU, saving the old value
+ * @note Keeps the MSR device open so hw_prefetch_restore() needs no path
+ * @return 0 on success, -1 with errno set (ENOTSUP on non-Intel CPUs)
+ */
+int hw_prefetch_disable(hw_prefetch_t *pf, int cpu, unsigned mask);
+
+/**
+ * @brief Write back the value saved by hw_prefetch_disable()
+ * @note Safe to call twice or after a failed disable. Only pwrite and
+ *       close, so it is async-signal-safe (restore from a SIGINT handler)
+ */
+int hw_prefetch_restore(hw_prefetch_t *pf);
+
+#endif /* LRC_HW_PREFETCH_H */
@@ -5,6 +5,7 @@
  *   - Spinlock contention
  *   - Mutex contention
  *   - Atomic operations
+ *   - Queue-based locks (ticket, MCS, CLH, qspinlock) and futex waits
  *   - Cache coherency protocol (MESI)
  *
  * What it deliberately avoids:
@@ -16,6 +17,29 @@
  *   Measure lock overhead and contention effects.
  *   Compare spinlock vs mutex vs atomic operations.
  *   Demonstrate scalability bottlenecks.
+ *
+ * Design (lock zoo, lock_contention_run):
+ *   - Every lock protects the same plain counter increment, so only the
+ *     acquire/release protocol differs between lock types
+ *   - Ticket: one line shared by all waiters (global bouncing on
+ *     release). MCS/CLH: each waiter spins on its own line, handoff
+ *     touches one remote line. qspinlock: 32-bit word with a pending bit
+ *     for the first waiter and an MCS queue behind it. Futex: bounded
+ *     spin, then sleep. Flat combining: waiters publish requests and one
+ *     combiner applies them all while holding the line
+ *   - Spin loops yield after a bounded number of pauses so oversubscribed
+ *     runs make progress (results are then not meaningful, but finish)
+ *   - One acquire in LOCK_SAMPLE_INTERVAL is timed (TSC where
+ *     available) into a per-thread histogram, recorded after the
+ *     release so bucketing stays outside the critical section; the
+ *     histograms are merged into the result
+ *   - lock_params_t adds calibrated cpu_spin() work inside the lock
+ *     (cs_ns), between acquisitions (think_ns) and shared lines written
+ *     under the lock (cs_lines), for Amdahl-style profiles
+ *
+ * Justification for syscalls:
+ *   futex(FUTEX_WAIT/FUTEX_WAKE) in LOCK_FUTEX only, after spinning
+ *   failed: this is the mechanism being measured.
  */
 
 #define _GNU_SOURCE
@@ -24,119 +48,578 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdio.h>
 #include <sched.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "workloads_api.h"
+#include "thread_pool.h"
+#include "topology.h"
+#include "histogram.h"
+#include "tsc.h"
+
+/*
+ * Pool for a single run: compact placement when pinning, wrapping
+ * around if there are more threads than CPUs.
+ */
+static int create_lock_pool(thread_pool_t* pool, int threads, int pin_threads) {
+    topology_t topo;
+    int* cpus = NULL;
+    
+    if (pin_threads && topology_init(&topo) == 0) {
+        int* placed = malloc(topo.num_cpus * sizeof(int));
+        cpus = malloc(threads * sizeof(int));
+        int count = placed ? topology_place(&topo, TOPO_PLACE_COMPACT, topo.num_cpus, placed) : 0;
+        
+        if (cpus && count > 0) {
+            for (int i = 0; i < threads; i++) {
+                cpus[i] = placed[i % count];
+            }
+        } else {
+            free(cpus);
+            cpus = NULL;
+        }
+        free(placed);
+        topology_destroy(&topo);
+    }
+    
+    int ret = thread_pool_create(pool, threads, cpus);
+    free(cpus);
+    return ret;
+}
+
+/* ------------------------------------------------------------------------
+ * Lock zoo
+ * ------------------------------------------------------------------------ */
+
+#define CACHE_LINE 64
+#define SPINS_BEFORE_YIELD 1024
+#define FUTEX_SPINS 128              // Adaptive mutex: CAS attempts before sleeping
+#define QSPIN_PENDING_SPINS 512      // qspinlock: wait for a pending->locked handoff
+
+// qspinlock word layout (as in Linux): locked byte, pending bit, tail
+#define Q_LOCKED 0x01U
+#define Q_LOCKED_MASK 0xffU
+#define Q_PENDING 0x100U
+#define Q_TAIL_SHIFT 16
+#define Q_TAIL_MASK 0xffff0000U
+
+static const char* lock_type_names[LOCK_TYPE_COUNT] = {
+    "spinlock", "mutex", "atomic", "ticket", "mcs", "clh",
+    "qspinlock", "futex", "flat_combining"
+};
 
 typedef struct {
+    volatile uint32_t next;          // Next ticket to hand out
+    volatile uint32_t owner;         // Ticket currently holding the lock
+} __attribute__((aligned(CACHE_LINE))) ticket_lock_t;
+
+typedef struct mcs_node {
+    struct mcs_node* volatile next;
+    volatile uint32_t locked;
+} __attribute__((aligned(CACHE_LINE))) mcs_node_t;
+
+typedef struct {
+    volatile uint32_t locked;
+} __attribute__((aligned(CACHE_LINE))) clh_node_t;
+
+typedef struct {
+    volatile uint32_t request;       // 1 = increment requested, 0 = served
+} __attribute__((aligned(CACHE_LINE))) fc_slot_t;
+
+typedef struct {
+    mcs_node_t node;                 // MCS and qspinlock queue node
+    clh_node_t* clh_mine;            // Node this thread enqueues next
+    clh_node_t* clh_pred;            // Predecessor node, recycled on release
+    histogram_t latency;             // Sampled acquire latencies in ns
+    uint64_t sink;                   // cpu_spin() results (prevents optimization)
+} __attribute__((aligned(CACHE_LINE))) lock_thread_t;
+
+typedef struct {
+    int lock_type;
+    int num_threads;
+    uint64_t iterations;
+    uint64_t cs_iterations;          // cpu_spin() iterations inside the lock
+    uint64_t think_iterations;       // cpu_spin() iterations between acquisitions
+    int cs_lines;
+    uint64_t* cs_data;               // cs_lines shared lines, written under the lock
+    double ns_per_tick;              // Sampled acquire ticks to ns (tsc.h)
+    uint64_t timer_overhead;         // Empty begin/end pair, in ticks
+    lock_thread_t* threads;
+    clh_node_t* clh_nodes;           // num_threads + 1 (one initial dummy)
+    fc_slot_t* fc_slots;
     pthread_spinlock_t spinlock;
     pthread_mutex_t mutex;
-    volatile uint64_t atomic_counter;
-    uint64_t shared_counter;
-    int iterations_per_thread;
-    int thread_count;
-} lock_workload_t;
+    
+    // Each lock word on its own line
+    ticket_lock_t ticket;
+    mcs_node_t* volatile mcs_tail __attribute__((aligned(CACHE_LINE)));
+    clh_node_t* volatile clh_tail __attribute__((aligned(CACHE_LINE)));
+    volatile uint32_t qspinlock __attribute__((aligned(CACHE_LINE)));
+    volatile uint32_t futex_word __attribute__((aligned(CACHE_LINE)));
+    volatile uint32_t fc_lock __attribute__((aligned(CACHE_LINE)));
+    
+    // Protected data
+    uint64_t counter __attribute__((aligned(CACHE_LINE)));
+} lock_zoo_t;
 
-/*
- * Spinlock contention: all threads compete for spinlock.
- * High contention, busy-wait.
- */
-void* spinlock_worker(void* arg) {
-    lock_workload_t* work = (lock_workload_t*)arg;
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static inline void spin_pause(unsigned* spins) {
+    cpu_relax();
+    if (++*spins % SPINS_BEFORE_YIELD == 0) sched_yield();
+}
+
+// Ticket lock: FIFO, but every waiter polls the same line
+static inline void ticket_lock(lock_zoo_t* z) {
+    uint32_t ticket = __atomic_fetch_add(&z->ticket.next, 1, __ATOMIC_RELAXED);
+    unsigned spins = 0;
     
-    for (int i = 0; i < work->iterations_per_thread; i++) {
-        pthread_spin_lock(&work->spinlock);
-        work->shared_counter++;
-        pthread_spin_unlock(&work->spinlock);
+    while (__atomic_load_n(&z->ticket.owner, __ATOMIC_ACQUIRE) != ticket) {
+        spin_pause(&spins);
     }
+}
+
+static inline void ticket_unlock(lock_zoo_t* z) {
+    uint32_t owner = __atomic_load_n(&z->ticket.owner, __ATOMIC_RELAXED);
+    __atomic_store_n(&z->ticket.owner, owner + 1, __ATOMIC_RELEASE);
+}
+
+// MCS: enqueue own node, spin on own node, owner hands off to successor
+static inline void mcs_lock(mcs_node_t* volatile* tail, mcs_node_t* node) {
+    node->next = NULL;
+    __atomic_store_n(&node->locked, 1, __ATOMIC_RELAXED);
+    
+    mcs_node_t* prev = __atomic_exchange_n(tail, node, __ATOMIC_ACQ_REL);
+    if (prev) {
+        unsigned spins = 0;
+        __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) {
+            spin_pause(&spins);
+        }
+    }
+}
+
+static inline void mcs_unlock(mcs_node_t* volatile* tail, mcs_node_t* node) {
+    mcs_node_t* next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
     
-    return NULL;
+    if (!next) {
+        mcs_node_t* expected = node;
+        if (__atomic_compare_exchange_n(tail, &expected, NULL, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        // A successor swapped the tail but has not linked itself yet
+        unsigned spins = 0;
+        while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))) {
+            spin_pause(&spins);
+        }
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+// CLH: enqueue own node, spin on predecessor's node, then adopt it
+static inline void clh_lock(lock_zoo_t* z, lock_thread_t* self) {
+    clh_node_t* mine = self->clh_mine;
+    __atomic_store_n(&mine->locked, 1, __ATOMIC_RELAXED);
+    
+    clh_node_t* pred = __atomic_exchange_n(&z->clh_tail, mine, __ATOMIC_ACQ_REL);
+    unsigned spins = 0;
+    while (__atomic_load_n(&pred->locked, __ATOMIC_ACQUIRE)) {
+        spin_pause(&spins);
+    }
+    self->clh_pred = pred;
+}
+
+static inline void clh_unlock(lock_thread_t* self) {
+    __atomic_store_n(&self->clh_mine->locked, 0, __ATOMIC_RELEASE);
+    self->clh_mine = self->clh_pred;
 }
 
 /*
- * Mutex contention: all threads compete for mutex.
- * High contention, sleep-wait (scheduler involved).
+ * qspinlock (after kernel/locking/qspinlock.c): uncontended CAS, one
+ * waiter spins on the lock word with the pending bit, everyone else
+ * queues MCS-style and only the queue head touches the lock word.
  */
-void* mutex_worker(void* arg) {
-    lock_workload_t* work = (lock_workload_t*)arg;
+static inline void qspin_lock(lock_zoo_t* z, lock_thread_t* self, int id) {
+    volatile uint32_t* lock = &z->qspinlock;
+    uint32_t val = 0;
+    unsigned spins = 0;
+    
+    if (__atomic_compare_exchange_n(lock, &val, Q_LOCKED, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    // Pending waiter is about to take the lock: give it a moment
+    for (int n = 0; val == Q_PENDING && n < QSPIN_PENDING_SPINS; n++) {
+        cpu_relax();
+        val = __atomic_load_n(lock, __ATOMIC_RELAXED);
+    }
+    
+    // Only the owner present: become the pending waiter
+    if (!(val & ~Q_LOCKED_MASK)) {
+        val = __atomic_fetch_or(lock, Q_PENDING, __ATOMIC_ACQUIRE);
+        if (!(val & ~Q_LOCKED_MASK)) {
+            while (__atomic_load_n(lock, __ATOMIC_ACQUIRE) & Q_LOCKED_MASK) {
+                spin_pause(&spins);
+            }
+            // Clear pending, set locked
+            __atomic_add_fetch(lock, Q_LOCKED - Q_PENDING, __ATOMIC_ACQUIRE);
+            return;
+        }
+        // Lost the race: undo our pending bit, if it was ours
+        if (!(val & Q_PENDING)) {
+            __atomic_fetch_and(lock, ~Q_PENDING, __ATOMIC_RELAXED);
+        }
+    }
+    
+    // Slow path: MCS queue encoded in the upper 16 bits
+    mcs_node_t* node = &self->node;
+    uint32_t tail = (uint32_t)(id + 1) << Q_TAIL_SHIFT;
+    node->next = NULL;
+    __atomic_store_n(&node->locked, 1, __ATOMIC_RELAXED);
+    
+    val = __atomic_load_n(lock, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(lock, &val, (val & ~Q_TAIL_MASK) | tail, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+    }
+    
+    if (val & Q_TAIL_MASK) {
+        mcs_node_t* prev = &z->threads[(val >> Q_TAIL_SHIFT) - 1].node;
+        __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) {
+            spin_pause(&spins);
+        }
+    }
+    
+    // Queue head: wait for the owner and the pending waiter to leave
+    while ((val = __atomic_load_n(lock, __ATOMIC_ACQUIRE)) & (Q_LOCKED_MASK | Q_PENDING)) {
+        spin_pause(&spins);
+    }
     
-    for (int i = 0; i < work->iterations_per_thread; i++) {
-        pthread_mutex_lock(&work->mutex);
-        work->shared_counter++;
-        pthread_mutex_unlock(&work->mutex);
+    // Last in queue: take the lock and clear the tail in one step
+    if ((val & Q_TAIL_MASK) == tail &&
+        __atomic_compare_exchange_n(lock, &val, Q_LOCKED, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
     }
+    __atomic_fetch_or(lock, Q_LOCKED, __ATOMIC_ACQUIRE);
     
-    return NULL;
+    // Make the successor the new queue head
+    mcs_node_t* next;
+    while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))) {
+        spin_pause(&spins);
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline void qspin_unlock(lock_zoo_t* z) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Byte store to the locked byte, as the kernel does
+    __atomic_store_n((volatile uint8_t*)&z->qspinlock, 0, __ATOMIC_RELEASE);
+#else
+    __atomic_fetch_sub(&z->qspinlock, Q_LOCKED, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline long futex(volatile uint32_t* uaddr, int op, uint32_t val) {
+    return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
 }
 
 /*
- * Atomic operations: lock-free with hardware support.
- * Compare-and-swap, no actual lock.
+ * Adaptive mutex (Drepper, "Futexes Are Tricky", mutex 2): 0 unlocked,
+ * 1 locked, 2 locked with possible sleepers. Spins for FUTEX_SPINS
+ * attempts before sleeping.
  */
-void* atomic_worker(void* arg) {
-    lock_workload_t* work = (lock_workload_t*)arg;
+static inline void futex_lock(lock_zoo_t* z) {
+    volatile uint32_t* word = &z->futex_word;
     
-    for (int i = 0; i < work->iterations_per_thread; i++) {
-        __atomic_add_fetch(&work->atomic_counter, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < FUTEX_SPINS; i++) {
+        uint32_t expected = 0;
+        if (__atomic_load_n(word, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(word, &expected, 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        cpu_relax();
     }
     
-    return NULL;
+    uint32_t c = __atomic_exchange_n(word, 2, __ATOMIC_ACQUIRE);
+    while (c != 0) {
+        futex(word, FUTEX_WAIT_PRIVATE, 2);
+        c = __atomic_exchange_n(word, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+static inline void futex_unlock(lock_zoo_t* z) {
+    if (__atomic_fetch_sub(&z->futex_word, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&z->futex_word, 0, __ATOMIC_RELEASE);
+        futex(&z->futex_word, FUTEX_WAKE_PRIVATE, 1);
+    }
+}
+
+/*
+ * The protected work: counter increment, cs_lines shared lines written,
+ * then cs_ns of computation while the lock is held.
+ */
+static inline void zoo_critical(lock_zoo_t* z, lock_thread_t* self) {
+    z->counter++;
+    for (int l = 0; l < z->cs_lines; l++) {
+        z->cs_data[l * (CACHE_LINE / sizeof(uint64_t))]++;
+    }
+    if (z->cs_iterations) {
+        self->sink += cpu_spin(z->cs_iterations);
+    }
 }
 
 /*
- * Run lock contention experiment.
- * Returns elapsed time in nanoseconds.
+ * Flat combining: publish a request, then either wait for a combiner to
+ * serve it or become the combiner and serve everyone's requests while
+ * the counter line stays in this core's cache.
  */
-uint64_t run_lock_test(lock_workload_t* work, 
-                        void* (*worker_func)(void*),
-                        int pin_threads) {
-    pthread_t* threads = malloc(work->thread_count * sizeof(pthread_t));
-    cpu_set_t cpuset;
-    
-    struct timespec start, end;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
-    
-    // Create threads
-    for (int i = 0; i < work->thread_count; i++) {
-        pthread_create(&threads[i], NULL, worker_func, work);
+static inline void fc_increment(lock_zoo_t* z, lock_thread_t* self, int id) {
+    fc_slot_t* slot = &z->fc_slots[id];
+    unsigned spins = 0;
+    
+    __atomic_store_n(&slot->request, 1, __ATOMIC_RELEASE);
+    
+    for (;;) {
+        if (!__atomic_load_n(&slot->request, __ATOMIC_ACQUIRE)) return;
         
-        // Optionally pin each thread to specific CPU
-        if (pin_threads) {
-            CPU_ZERO(&cpuset);
-            CPU_SET(i % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
-            pthread_setaffinity_np(threads[i], sizeof(cpu_set_t), &cpuset);
+        if (!__atomic_load_n(&z->fc_lock, __ATOMIC_RELAXED) &&
+            !__atomic_exchange_n(&z->fc_lock, 1, __ATOMIC_ACQUIRE)) {
+            for (int j = 0; j < z->num_threads; j++) {
+                if (__atomic_load_n(&z->fc_slots[j].request, __ATOMIC_ACQUIRE)) {
+                    zoo_critical(z, self);
+                    __atomic_store_n(&z->fc_slots[j].request, 0, __ATOMIC_RELEASE);
+                }
+            }
+            __atomic_store_n(&z->fc_lock, 0, __ATOMIC_RELEASE);
+            return;
         }
+        spin_pause(&spins);
     }
+}
+
+/*
+ * Acquire. For atomic and flat combining the "acquire" is the whole
+ * operation, since there is no separate lock to hold.
+ */
+static inline __attribute__((always_inline))
+void zoo_acquire(lock_zoo_t* z, lock_thread_t* self, int id, int type) {
+    switch (type) {
+        case LOCK_SPINLOCK:       pthread_spin_lock(&z->spinlock); break;
+        case LOCK_MUTEX:          pthread_mutex_lock(&z->mutex); break;
+        case LOCK_ATOMIC:         __atomic_add_fetch(&z->counter, 1, __ATOMIC_SEQ_CST); break;
+        case LOCK_TICKET:         ticket_lock(z); break;
+        case LOCK_MCS:            mcs_lock(&z->mcs_tail, &self->node); break;
+        case LOCK_CLH:            clh_lock(z, self); break;
+        case LOCK_QSPINLOCK:      qspin_lock(z, self, id); break;
+        case LOCK_FUTEX:          futex_lock(z); break;
+        case LOCK_FLAT_COMBINING: fc_increment(z, self, id); break;
+    }
+}
+
+static inline __attribute__((always_inline))
+void zoo_release(lock_zoo_t* z, lock_thread_t* self, int type) {
+    if (type == LOCK_ATOMIC || type == LOCK_FLAT_COMBINING) return;
+    
+    zoo_critical(z, self);
     
-    // Wait for all threads
-    for (int i = 0; i < work->thread_count; i++) {
-        pthread_join(threads[i], NULL);
+    switch (type) {
+        case LOCK_SPINLOCK:       pthread_spin_unlock(&z->spinlock); break;
+        case LOCK_MUTEX:          pthread_mutex_unlock(&z->mutex); break;
+        case LOCK_TICKET:         ticket_unlock(z); break;
+        case LOCK_MCS:            mcs_unlock(&z->mcs_tail, &self->node); break;
+        case LOCK_CLH:            clh_unlock(self); break;
+        case LOCK_QSPINLOCK:      qspin_unlock(z); break;
+        case LOCK_FUTEX:          futex_unlock(z); break;
+        default:                  break;
     }
+}
+
+static inline __attribute__((always_inline))
+void zoo_loop(lock_zoo_t* z, int id, int type) {
+    lock_thread_t* self = &z->threads[id];
     
-    clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+    for (uint64_t i = 0; i < z->iterations; i++) {
+        if (i % LOCK_SAMPLE_INTERVAL == 0) {
+            uint64_t t0 = tsc_begin();
+            zoo_acquire(z, self, id, type);
+            uint64_t t1 = tsc_end();
+            zoo_release(z, self, type);
+            
+            uint64_t ticks = t1 - t0 > z->timer_overhead ? t1 - t0 - z->timer_overhead : 0;
+            histogram_record(&self->latency, (uint64_t)(ticks * z->ns_per_tick));
+        } else {
+            zoo_acquire(z, self, id, type);
+            zoo_release(z, self, type);
+        }
+        
+        if (z->think_iterations) {
+            self->sink += cpu_spin(z->think_iterations);
+        }
+    }
+}
+
+// One pool task per lock type, so each loop is specialized at compile time
+#define ZOO_TASK(name, type) \
+    static void name(int id, void* arg) { zoo_loop((lock_zoo_t*)arg, id, type); }
+
+ZOO_TASK(zoo_spinlock, LOCK_SPINLOCK)
+ZOO_TASK(zoo_mutex, LOCK_MUTEX)
+ZOO_TASK(zoo_atomic, LOCK_ATOMIC)
+ZOO_TASK(zoo_ticket, LOCK_TICKET)
+ZOO_TASK(zoo_mcs, LOCK_MCS)
+ZOO_TASK(zoo_clh, LOCK_CLH)
+ZOO_TASK(zoo_qspinlock, LOCK_QSPINLOCK)
+ZOO_TASK(zoo_futex, LOCK_FUTEX)
+ZOO_TASK(zoo_flat_combining, LOCK_FLAT_COMBINING)
+
+static const thread_pool_fn_t zoo_tasks[LOCK_TYPE_COUNT] = {
+    zoo_spinlock, zoo_mutex, zoo_atomic, zoo_ticket, zoo_mcs, zoo_clh,
+    zoo_qspinlock, zoo_futex, zoo_flat_combining
+};
+
+int lock_params_from_env(const char* name, const lock_params_t* defaults, int num_defaults,
+                         lock_params_t* profiles) {
+    const char* env = getenv(name);
+    int count = 0;
     
-    free(threads);
+    if (env && *env) {
+        char* copy = strdup(env);
+        char* save = NULL;
+        
+        for (char* tok = strtok_r(copy, ",", &save); tok && count < LOCK_MAX_PROFILES;
+             tok = strtok_r(NULL, ",", &save)) {
+            unsigned long long cs = 0, think = 0;
+            int lines = 0;
+            
+            if (sscanf(tok, "%llu:%llu:%d", &cs, &think, &lines) >= 1 && lines >= 0) {
+                profiles[count].cs_ns = cs;
+                profiles[count].think_ns = think;
+                profiles[count].cs_lines = lines;
+                count++;
+            }
+        }
+        free(copy);
+    }
     
-    uint64_t elapsed_ns = (end.tv_sec - start.tv_sec) * 1000000000ULL +
-                          (end.tv_nsec - start.tv_nsec);
+    if (count == 0) {
+        for (int i = 0; i < num_defaults && i < LOCK_MAX_PROFILES; i++) {
+            profiles[count++] = defaults[i];
+        }
+    }
     
-    return elapsed_ns;
+    return count;
 }
 
-/*
- * Initialize lock workload.
- */
-void lock_workload_init(lock_workload_t* work, int threads, int iterations) {
-    pthread_spin_init(&work->spinlock, PTHREAD_PROCESS_PRIVATE);
-    pthread_mutex_init(&work->mutex, NULL);
-    work->atomic_counter = 0;
-    work->shared_counter = 0;
-    work->thread_count = threads;
-    work->iterations_per_thread = iterations;
+const char* lock_type_name(int lock_type) {
+    if (lock_type < 0 || lock_type >= LOCK_TYPE_COUNT) return "unknown";
+    return lock_type_names[lock_type];
 }
 
-/*
- * Cleanup lock workload.
- */
-void lock_workload_cleanup(lock_workload_t* work) {
-    pthread_spin_destroy(&work->spinlock);
-    pthread_mutex_destroy(&work->mutex);
+static void zoo_free(lock_zoo_t* z) {
+    free(z->threads);
+    free(z->cs_data);
+    free(z->clh_nodes);
+    free(z->fc_slots);
+    pthread_spin_destroy(&z->spinlock);
+    pthread_mutex_destroy(&z->mutex);
+    free(z);
+}
+
+int lock_contention_run(thread_pool_t* pool, int lock_type, int num_threads,
+                        uint64_t iterations, const lock_params_t* params,
+                        lock_result_t* result) {
+    lock_params_t p = params ? *params : LOCK_PARAMS_DEFAULT;
+    
+    if (lock_type < 0 || lock_type >= LOCK_TYPE_COUNT ||
+        num_threads < 1 || num_threads > pool->num_threads || p.cs_lines < 0) {
+        return -1;
+    }
+    
+    lock_zoo_t* z = aligned_alloc(CACHE_LINE, sizeof(lock_zoo_t));
+    if (!z) return -1;
+    memset(z, 0, sizeof(lock_zoo_t));
+    
+    z->lock_type = lock_type;
+    z->num_threads = num_threads;
+    z->iterations = iterations;
+    z->cs_iterations = cpu_spin_iterations_for_ns(p.cs_ns);
+    z->think_iterations = cpu_spin_iterations_for_ns(p.think_ns);
+    z->cs_lines = p.cs_lines;
+    pthread_spin_init(&z->spinlock, PTHREAD_PROCESS_PRIVATE);
+    pthread_mutex_init(&z->mutex, NULL);
+    
+    z->threads = aligned_alloc(CACHE_LINE, num_threads * sizeof(lock_thread_t));
+    z->clh_nodes = aligned_alloc(CACHE_LINE, (num_threads + 1) * sizeof(clh_node_t));
+    z->fc_slots = aligned_alloc(CACHE_LINE, num_threads * sizeof(fc_slot_t));
+    z->cs_data = aligned_alloc(CACHE_LINE, (p.cs_lines + 1) * CACHE_LINE);
+    if (!z->threads || !z->clh_nodes || !z->fc_slots || !z->cs_data) {
+        zoo_free(z);
+        return -1;
+    }
+    memset(z->threads, 0, num_threads * sizeof(lock_thread_t));
+    memset(z->clh_nodes, 0, (num_threads + 1) * sizeof(clh_node_t));
+    memset(z->fc_slots, 0, num_threads * sizeof(fc_slot_t));
+    memset(z->cs_data, 0, (p.cs_lines + 1) * CACHE_LINE);
+    
+    const tsc_info_t* timer = tsc_info();
+    z->ns_per_tick = 1.0 / timer->ticks_per_ns;
+    z->timer_overhead = timer->overhead_ticks;
+    for (int i = 0; i < num_threads; i++) {
+        z->threads[i].clh_mine = &z->clh_nodes[i];
+        histogram_reset(&z->threads[i].latency);
+    }
+    z->clh_tail = &z->clh_nodes[num_threads];    // Unlocked dummy
+    
+    if (thread_pool_run(pool, num_threads, NULL, zoo_tasks[lock_type], z) != 0) {
+        zoo_free(z);
+        return -1;
+    }
+    
+    memset(result, 0, sizeof(lock_result_t));
+    result->operations = z->counter;
+    result->runtime_ns = thread_pool_elapsed_ns(pool);
+    
+    // Per-thread histograms combine into the pooled distribution
+    histogram_reset(&result->latency);
+    for (int i = 0; i < num_threads; i++) {
+        histogram_merge(&result->latency, &z->threads[i].latency);
+    }
+    result->samples = result->latency.count;
+    result->p50_ns = histogram_percentile(&result->latency, 50.0);
+    result->p90_ns = histogram_percentile(&result->latency, 90.0);
+    result->p99_ns = histogram_percentile(&result->latency, 99.0);
+    result->p999_ns = histogram_percentile(&result->latency, 99.9);
+    result->max_ns = result->latency.max;
+    
+    zoo_free(z);
+    return 0;
+}
+
+uint64_t lock_contention(int lock_type, int num_threads, uint64_t iterations) {
+    thread_pool_t pool;
+    lock_result_t result;
+    
+    if (create_lock_pool(&pool, num_threads, 1) != 0) return 0;
+    
+    int ret = lock_contention_run(&pool, lock_type, num_threads, iterations, NULL, &result);
+    thread_pool_destroy(&pool);
+    
+    return ret == 0 ? result.operations : 0;
 }
@@ -19,6 +19,21 @@
 #include "sched_api.h"
 #include "metrics.h"
 #include "perf_counters.h"
+#include "sampler.h"
+#include "topology.h"
+#include "thread_pool.h"
+#include "results.h"
+#include "async_io.h"
+#include "lrc_alloc.h"
+#include "run_control.h"
+#include "tsc.h"
+#include "histogram.h"
+#include "mixed_workload.h"
+#include "resctrl.h"
+#include "simd_kernels.h"
+#include "hw_prefetch.h"
+#include "queues.h"
+#include "sched_trace.h"
 
 /**
  * @brief Get LRC version string
@@ -0,0 +1,196 @@
+/*
+ * lrc_alloc.c - Page-size and NUMA aware buffer allocation
+ *
+ * Purpose:
+ *   Only huge_pages.c could ask for huge pages; every other memory
+ *   workload ran on malloc, whose page size depends on the THP policy of
+ *   the host, the allocator's arena and the buffer size. A DRAM-sized
+ *   chase could be 4 KB pages on one machine and THP on the next, so
+ *   TLB misses leaked into what looked like cache results.
+ *
+ * Design:
+ *   - Always mmap (never malloc), so madvise and mbind apply to exactly
+ *     the buffer and lrc_free() never needs to know the history
+ *   - THP: over-allocate by 2 MB and trim, giving a 2 MB aligned range
+ *     the kernel can back with huge pages from the first fault
+ *   - hugetlbfs: MAP_HUGETLB with the size encoded in the flags; no
+ *     silent fallback, callers decide whether to skip
+ *   - numa_bind_memory() runs before any page is touched; prefault then
+ *     writes one byte per page, so the pages land on the bound node (or
+ *     the caller's node without binding)
+ *
+ * Justification for syscalls:
+ *   mmap/munmap/madvise/mbind at allocation time only. The smaps read in
+ *   lrc_alloc_huge_fraction() is for reporting, outside timed regions.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <linux/mman.h>
+
+#include "lrc_alloc.h"
+#include "numa_api.h"
+
+#define SMALL_PAGE (4096UL)
+#define HUGE_2M (2UL * 1024 * 1024)
+#define HUGE_1G (1024UL * 1024 * 1024)
+
+static const char *pages_names[LRC_PAGES_COUNT] = {
+    "default", "4k", "thp", "2m", "1g"
+};
+
+const char *lrc_pages_name(lrc_pages_t pages) {
+    if ((int)pages < 0 || pages >= LRC_PAGES_COUNT) return "unknown";
+    return pages_names[pages];
+}
+
+size_t lrc_pages_size(lrc_pages_t pages) {
+    switch (pages) {
+        case LRC_PAGES_THP:
+        case LRC_PAGES_2M: return HUGE_2M;
+        case LRC_PAGES_1G: return HUGE_1G;
+        default: return SMALL_PAGE;
+    }
+}
+
+/* Length actually mapped for a request */
+static size_t mapped_size(size_t size, lrc_pages_t pages) {
+    size_t page = (pages == LRC_PAGES_2M || pages == LRC_PAGES_1G) ? lrc_pages_size(pages) : SMALL_PAGE;
+    return (size + page - 1) & ~(page - 1);
+}
+
+static void *map_aligned(size_t len, size_t align) {
+    char *raw = mmap(NULL, len + align, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    
+    char *aligned = (char *)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+    if (aligned > raw) munmap(raw, aligned - raw);
+    size_t tail = (raw + len + align) - (aligned + len);
+    if (tail > 0) munmap(aligned + len, tail);
+    return aligned;
+}
+
+void *lrc_alloc(size_t size, const lrc_alloc_opts_t *opts) {
+    lrc_alloc_opts_t defaults = { -1, LRC_PAGES_DEFAULT, 0 };
+    if (!opts) opts = &defaults;
+    if (size == 0 || (int)opts->pages < 0 || opts->pages >= LRC_PAGES_COUNT) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    size_t len = mapped_size(size, opts->pages);
+    void *ptr = NULL;
+    
+    switch (opts->pages) {
+        case LRC_PAGES_2M:
+        case LRC_PAGES_1G: {
+            int huge = opts->pages == LRC_PAGES_2M ? MAP_HUGE_2MB : MAP_HUGE_1GB;
+            ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge, -1, 0);
+            if (ptr == MAP_FAILED) return NULL;
+            break;
+        }
+        case LRC_PAGES_THP:
+            ptr = map_aligned(len, HUGE_2M);
+            if (!ptr) return NULL;
+            madvise(ptr, len, MADV_HUGEPAGE);      // EINVAL if THP is compiled out
+            break;
+        case LRC_PAGES_4K:
+            ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) return NULL;
+            madvise(ptr, len, MADV_NOHUGEPAGE);
+            break;
+        default:
+            ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) return NULL;
+            break;
+    }
+    
+    if (opts->node >= 0 && numa_bind_memory(ptr, len, opts->node) != 0) {
+        fprintf(stderr, "Warning: mbind() failed for node %d: %s\n",
+                opts->node, strerror(errno));
+    }
+    
+    if (opts->prefault) {
+        // One write per page that can fault separately (THP may fall back to 4 KB)
+        size_t step = (opts->pages == LRC_PAGES_2M || opts->pages == LRC_PAGES_1G) ?
+                      lrc_pages_size(opts->pages) : SMALL_PAGE;
+        volatile char *p = ptr;
+        for (size_t off = 0; off < len; off += step) {
+            p[off] = 0;
+        }
+    }
+    
+    return ptr;
+}
+
+void lrc_free(void *ptr, size_t size, lrc_pages_t pages) {
+    if (!ptr) return;
+    munmap(ptr, mapped_size(size, pages));
+}
+
+double lrc_alloc_huge_fraction(const void *ptr, size_t size) {
+    FILE *f = fopen("/proc/self/smaps", "r");
+    char line[512];
+    uintptr_t addr = (uintptr_t)ptr;
+    int in_vma = 0;
+    uint64_t vma_kb = 0, huge_kb = 0;
+    int hugetlb = 0;
+    
+    if (!f || size == 0) {
+        if (f) fclose(f);
+        return 0.0;
+    }
+    
+    while (fgets(line, sizeof(line), f)) {
+        uintptr_t start, end;
+        uint64_t kb;
+        
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (in_vma) break;                     // Past the VMA holding ptr
+            in_vma = addr >= start && addr < end;
+            continue;
+        }
+        if (!in_vma) continue;
+        
+        if (sscanf(line, "Size: %lu kB", &kb) == 1) vma_kb = kb;
+        else if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) huge_kb = kb;
+        else if (sscanf(line, "KernelPageSize: %lu kB", &kb) == 1 && kb > 4) hugetlb = 1;
+    }
+    fclose(f);
+    
+    if (hugetlb) return 1.0;
+    if (vma_kb == 0) return 0.0;
+    
+    // The VMA may be merged with neighbours; cap at the buffer's share
+    double fraction = (double)huge_kb * 1024 / size;
+    return fraction > 1.0 ? 1.0 : fraction;
+}
+
+int lrc_pages_from_env(lrc_pages_t *out, const char *default_spec) {
+    const char *env = getenv("LRC_PAGE_SIZES");
+    char *copy = strdup(env && *env ? env : default_spec);
+    int count = 0;
+    
+    if (!copy) return 0;
+    for (char *tok = strtok(copy, ","); tok && count < LRC_PAGES_MAX; tok = strtok(NULL, ",")) {
+        int found = 0;
+        for (int p = 0; p < LRC_PAGES_COUNT; p++) {
+            if (strcasecmp(tok, pages_names[p]) == 0) {
+                out[count++] = (lrc_pages_t)p;
+                found = 1;
+                break;
+            }
+        }
+        if (!found) fprintf(stderr, "Unknown page size '%s' in LRC_PAGE_SIZES\n", tok);
+    }
+    free(copy);
+    return count;
+}
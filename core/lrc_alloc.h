@@ -0,0 +1,75 @@
+/*
+ * lrc_alloc.h - Page-size and NUMA aware buffer allocation
+ *
+ * One allocator for every memory workload, so the page size becomes a
+ * controlled variable: plain 4 KB pages with THP disabled, THP
+ * requested with madvise on a 2 MB aligned range, or hugetlbfs 2 MB and
+ * 1 GB pages. Node binding goes through numa_bind_memory(), the same
+ * mbind() path numa_alloc_on_node() uses, before the first touch.
+ */
+
+#ifndef LRC_ALLOC_H
+#define LRC_ALLOC_H
+
+#include <stddef.h>
+
+typedef enum {
+    LRC_PAGES_DEFAULT = 0,    // 4 KB pages, THP per system policy (like malloc)
+    LRC_PAGES_4K,             // 4 KB pages, MADV_NOHUGEPAGE
+    LRC_PAGES_THP,            // 2 MB aligned, MADV_HUGEPAGE
+    LRC_PAGES_2M,             // hugetlbfs, MAP_HUGETLB | MAP_HUGE_2MB
+    LRC_PAGES_1G,             // hugetlbfs, MAP_HUGETLB | MAP_HUGE_1GB
+    LRC_PAGES_COUNT
+} lrc_pages_t;
+
+typedef struct {
+    int node;                 // NUMA node to bind to, -1 = first touch
+    lrc_pages_t pages;
+    int prefault;             // Touch every page before returning
+} lrc_alloc_opts_t;
+
+/* Largest LRC_PAGE_SIZES list */
+#define LRC_PAGES_MAX LRC_PAGES_COUNT
+
+/**
+ * @brief Allocate an anonymous buffer
+ * @param size Bytes (rounded up to the page size)
+ * @param opts Node, page size and prefault (NULL: unbound default pages)
+ * @return Page-aligned buffer, or NULL (errno set; ENOMEM for hugetlbfs
+ *         usually means no pages are reserved in /proc/sys/vm/nr_hugepages)
+ * @note Free with lrc_free() and the same size and page type
+ */
+void *lrc_alloc(size_t size, const lrc_alloc_opts_t *opts);
+
+/**
+ * @brief Release a buffer from lrc_alloc()
+ */
+void lrc_free(void *ptr, size_t size, lrc_pages_t pages);
+
+/**
+ * @brief Fraction of [ptr, ptr + size) backed by huge pages
+ * @return 1.0 for hugetlbfs, AnonHugePages share of the mapping from
+ *         /proc/self/smaps for THP, 0.0 when none (or unreadable)
+ * @note Call after the buffer is touched; THP are allocated at fault time
+ */
+double lrc_alloc_huge_fraction(const void *ptr, size_t size);
+
+/**
+ * @brief Page type for CSV output ("default", "4k", "thp", "2m", "1g")
+ */
+const char *lrc_pages_name(lrc_pages_t pages);
+
+/**
+ * @brief Page size in bytes backing a page type (THP: 2 MB)
+ */
+size_t lrc_pages_size(lrc_pages_t pages);
+
+/**
+ * @brief Page-size sweep from $LRC_PAGE_SIZES (comma-separated names)
+ * @param out Output array with room for LRC_PAGES_MAX entries
+ * @param default_spec Used when the variable is unset (e.g. "4k,thp")
+ * @return Number of entries written (unknown names are skipped)
+ */
+int lrc_pages_from_env(lrc_pages_t *out, const char *default_spec);
+
+#endif /* LRC_ALLOC_H */
@@ -20,6 +20,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "rng.h"
+#include "workloads_api.h"
+
+#define CHASE_LINE_WORDS 8      // 64-byte cache line
+#define CHASE_PAGE_BYTES 4096
+
 /*
  * Pre-shuffle array indices to create random access pattern.
  * Uses Fisher-Yates shuffle for uniform distribution.
@@ -38,31 +44,265 @@ static void shuffle_indices(uint64_t *indices, size_t count) {
 }
 
 /*
- * Pointer-chasing pattern: each element points to next in chain.
- * Creates dependent loads - CPU must wait for each access.
- * This measures true latency, not bandwidth.
+ * Address of chain node n.
  */
-uint64_t memory_random_chase(uint64_t *buffer, size_t size, uint64_t iterations) {
-    size_t count = size / sizeof(uint64_t);
+static inline uint64_t *chase_node(const chase_t *c, size_t n) {
+    size_t words = (c->flags & CHASE_LINE) ? CHASE_LINE_WORDS : 1;
+    return c->buffer + n * words;
+}
+
+static inline void chase_link(const chase_t *c, size_t from, size_t to) {
+    *chase_node(c, from) = (uint64_t)(uintptr_t)chase_node(c, to);
+}
+
+/*
+ * Fisher-Yates shuffle of an index array with the fast generator.
+ */
+static void shuffle_nodes(size_t *order, size_t count, lrc_rng_t *rng) {
+    for (size_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    
+    for (size_t i = count - 1; i > 0; i--) {
+        size_t j = lrc_rng_bounded(rng, i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+/*
+ * Sattolo's algorithm: a uniformly random cyclic permutation, built in
+ * place in the node slots (slot i ends up holding the successor of i).
+ * Needs no scratch memory and always yields one cycle over all nodes.
+ */
+static void build_sattolo(chase_t *c, lrc_rng_t *rng) {
+    for (size_t i = 0; i < c->nodes; i++) {
+        *chase_node(c, i) = i;
+    }
     
-    uint64_t *indices = malloc(count * sizeof(uint64_t));
-    if (!indices) return 0;
+    for (size_t i = c->nodes - 1; i > 0; i--) {
+        size_t j = lrc_rng_bounded(rng, i);  // j < i, never a fixed point
+        uint64_t tmp = *chase_node(c, i);
+        *chase_node(c, i) = *chase_node(c, j);
+        *chase_node(c, j) = tmp;
+    }
     
-    shuffle_indices(indices, count);
+    // Convert successor indices to addresses
+    for (size_t i = 0; i < c->nodes; i++) {
+        chase_link(c, i, *chase_node(c, i));
+    }
+    
+    c->start = chase_node(c, 0);
+}
+
+/*
+ * Link nodes in the order of a shuffled index array.
+ */
+static int build_shuffled(chase_t *c, lrc_rng_t *rng) {
+    size_t *order = malloc(c->nodes * sizeof(size_t));
+    if (!order) return -1;
+    
+    shuffle_nodes(order, c->nodes, rng);
     
-    for (size_t i = 0; i < count - 1; i++) {
-        buffer[indices[i]] = indices[i + 1];
+    for (size_t i = 0; i + 1 < c->nodes; i++) {
+        chase_link(c, order[i], order[i + 1]);
     }
-    buffer[indices[count - 1]] = indices[0];
+    chase_link(c, order[c->nodes - 1], order[0]);
     
-    free(indices);
+    c->start = chase_node(c, order[0]);
+    free(order);
+    return 0;
+}
+
+/*
+ * Page-aware chain: pages in random order, all nodes of a page (in random
+ * order) before the next page. Keeps one TLB entry live for a whole page
+ * so cache latency is measured without a page walk per hop.
+ */
+static int build_paged(chase_t *c, lrc_rng_t *rng) {
+    size_t node_bytes = ((c->flags & CHASE_LINE) ? CHASE_LINE_WORDS : 1) * sizeof(uint64_t);
+    size_t per_page = CHASE_PAGE_BYTES / node_bytes;
+    if (per_page > c->nodes) per_page = c->nodes;
+    size_t pages = (c->nodes + per_page - 1) / per_page;
+    
+    size_t *page_order = malloc(pages * sizeof(size_t));
+    size_t *node_order = malloc(per_page * sizeof(size_t));
+    if (!page_order || !node_order) {
+        free(page_order);
+        free(node_order);
+        return -1;
+    }
+    
+    shuffle_nodes(page_order, pages, rng);
+    
+    size_t first = SIZE_MAX, prev = SIZE_MAX;
+    for (size_t p = 0; p < pages; p++) {
+        size_t base = page_order[p] * per_page;
+        size_t in_page = c->nodes - base < per_page ? c->nodes - base : per_page;
+        
+        shuffle_nodes(node_order, in_page, rng);
+        
+        for (size_t k = 0; k < in_page; k++) {
+            size_t n = base + node_order[k];
+            if (prev == SIZE_MAX) first = n;
+            else chase_link(c, prev, n);
+            prev = n;
+        }
+    }
+    chase_link(c, prev, first);
+    
+    c->start = chase_node(c, first);
+    free(page_order);
+    free(node_order);
+    return 0;
+}
+
+/*
+ * Prepare a single-cycle pointer chain once, outside the timed region.
+ * Nodes store absolute addresses so each hop is exactly one dependent load.
+ */
+int chase_build(chase_t *c, uint64_t *buffer, size_t size, int flags, uint64_t seed) {
+    size_t node_bytes = ((flags & CHASE_LINE) ? CHASE_LINE_WORDS : 1) * sizeof(uint64_t);
+    
+    memset(c, 0, sizeof(chase_t));
+    c->buffer = buffer;
+    c->size = size;
+    c->flags = flags;
+    c->nodes = size / node_bytes;
+    
+    if (!buffer || c->nodes < 2) return -1;
+    
+    lrc_rng_t rng;
+    lrc_rng_seed(&rng, seed);
+    
+    if (flags & CHASE_PAGE) {
+        return build_paged(c, &rng);
+    }
+    
+    if (flags & CHASE_SATTOLO) {
+        build_sattolo(c, &rng);
+        return 0;
+    }
+    
+    return build_shuffled(c, &rng);
+}
+
+/*
+ * One node per page: pages in random cyclic order, each node at a random
+ * line of its page. A fixed offset would put every node in the same
+ * cache set (page-aligned addresses share their set index bits), so the
+ * chain would measure L1 conflict misses instead of the TLB.
+ */
+int chase_build_pages(chase_t *c, uint64_t *buffer, size_t pages, size_t page_size,
+                      uint64_t seed) {
+    size_t line_bytes = CHASE_LINE_WORDS * sizeof(uint64_t);
+    
+    memset(c, 0, sizeof(chase_t));
+    if (!buffer || pages < 2 || page_size < line_bytes) return -1;
+    
+    size_t *slot = malloc(pages * sizeof(size_t));
+    if (!slot) return -1;
+    
+    lrc_rng_t rng;
+    lrc_rng_seed(&rng, seed);
+    shuffle_nodes(slot, pages, &rng);
+    
+    // slot[i]: byte offset of the i-th node in chain order
+    size_t lines = page_size / line_bytes;
+    for (size_t i = 0; i < pages; i++) {
+        slot[i] = slot[i] * page_size + lrc_rng_bounded(&rng, lines) * line_bytes;
+    }
+    
+    char *base = (char *)buffer;
+    for (size_t i = 0; i < pages; i++) {
+        size_t next = slot[(i + 1) % pages];
+        *(uint64_t *)(base + slot[i]) = (uint64_t)(uintptr_t)(base + next);
+    }
+    
+    c->buffer = buffer;
+    c->size = pages * page_size;
+    c->nodes = pages;
+    c->start = base + slot[0];
+    free(slot);
+    return 0;
+}
+
+/*
+ * Pointer-chasing hot loop: each load depends on the previous one.
+ * No allocation, no RNG, no bookkeeping - only the hops are timed.
+ */
+uint64_t chase_run(const chase_t *c, uint64_t iterations) {
+    const uint64_t *p = c->start;
     
-    uint64_t index = 0;
     for (uint64_t i = 0; i < iterations; i++) {
-        index = buffer[index];
+        p = (const uint64_t *)(uintptr_t)*p;
+    }
+    
+    return (uint64_t)(uintptr_t)p;
+}
+
+/*
+ * Interleaved chase over a compile-time number of chains. Inlined per
+ * count so the cursors live in registers (until the count exceeds the
+ * register file) instead of a stack array that adds a store-forwarding
+ * round trip to every hop.
+ */
+static inline __attribute__((always_inline))
+uint64_t chase_multi_fixed(const chase_t *chains, int count, uint64_t iterations) {
+    const uint64_t *p[CHASE_MAX_CHAINS];
+    uint64_t sum = 0;
+    
+    for (int j = 0; j < count; j++) {
+        p[j] = chains[j].start;
+    }
+    
+    for (uint64_t i = 0; i < iterations; i++) {
+        #pragma GCC unroll 32
+        for (int j = 0; j < count; j++) {
+            p[j] = (const uint64_t *)(uintptr_t)*p[j];
+        }
+    }
+    
+    for (int j = 0; j < count; j++) {
+        sum += (uint64_t)(uintptr_t)p[j];
+    }
+    return sum;
+}
+
+#define CHASE_MULTI_CASE(n) case n: return chase_multi_fixed(chains, n, iterations)
+
+uint64_t chase_run_multi(const chase_t *chains, int count, uint64_t iterations) {
+    switch (count) {
+        CHASE_MULTI_CASE(1);  CHASE_MULTI_CASE(2);  CHASE_MULTI_CASE(3);  CHASE_MULTI_CASE(4);
+        CHASE_MULTI_CASE(5);  CHASE_MULTI_CASE(6);  CHASE_MULTI_CASE(7);  CHASE_MULTI_CASE(8);
+        CHASE_MULTI_CASE(9);  CHASE_MULTI_CASE(10); CHASE_MULTI_CASE(11); CHASE_MULTI_CASE(12);
+        CHASE_MULTI_CASE(13); CHASE_MULTI_CASE(14); CHASE_MULTI_CASE(15); CHASE_MULTI_CASE(16);
+        CHASE_MULTI_CASE(17); CHASE_MULTI_CASE(18); CHASE_MULTI_CASE(19); CHASE_MULTI_CASE(20);
+        CHASE_MULTI_CASE(21); CHASE_MULTI_CASE(22); CHASE_MULTI_CASE(23); CHASE_MULTI_CASE(24);
+        CHASE_MULTI_CASE(25); CHASE_MULTI_CASE(26); CHASE_MULTI_CASE(27); CHASE_MULTI_CASE(28);
+        CHASE_MULTI_CASE(29); CHASE_MULTI_CASE(30); CHASE_MULTI_CASE(31); CHASE_MULTI_CASE(32);
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Pointer-chasing pattern: each element points to next in chain.
+ * Creates dependent loads - CPU must wait for each access.
+ * This measures true latency, not bandwidth.
+ *
+ * Kept for compatibility: builds the chain on every call, so the build
+ * cost is included when this is timed. Prefer chase_build + chase_run.
+ */
+uint64_t memory_random_chase(uint64_t *buffer, size_t size, uint64_t iterations) {
+    chase_t chain;
+    
+    if (chase_build(&chain, buffer, size, CHASE_SATTOLO, (uint64_t)rand()) != 0) {
+        return 0;
     }
     
-    return index;
+    return chase_run(&chain, iterations);
 }
 
 /*
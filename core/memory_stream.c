@@ -15,13 +15,35 @@
  * Purpose:
  *   Isolate memory subsystem behavior. Cache misses and
  *   memory stalls should dominate, not CPU operations.
+ *
+ * Kernels:
+ *   The plain loops below measure whatever the compiler emits. The
+ *   *_kernel variants fix the instruction sequence (scalar, SSE2, AVX2,
+ *   AVX-512, non-temporal stores, rep movsb/stosb) and are selected at
+ *   runtime from CPUID, so bandwidth numbers are comparable across
+ *   compilers and flags. Each SIMD kernel is compiled with a target
+ *   attribute, so the file needs no extra -m flags.
+ *
+ * Prefetch:
+ *   memory_stream_strided_prefetch() and memory_stream_indirect() issue
+ *   __builtin_prefetch a configurable number of accesses ahead with a
+ *   chosen locality hint, to find where software prefetch beats the
+ *   hardware prefetchers (see hw_prefetch.h to switch those off).
  */
 
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "workloads_api.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STREAM_X86 1
+#include <immintrin.h>
+#endif
+
 #define CACHE_LINE_SIZE 64
+#define STREAM_WRITE_PATTERN 0x5A5A5A5A5A5A5A5AULL  // Byte-uniform, same for rep stosb
 
 /*
  * Sequential read and accumulate.
@@ -80,3 +102,458 @@ uint64_t memory_stream_strided(const uint64_t *buffer, size_t size, size_t strid
     
     return sum;
 }
+
+/*
+ * Software-prefetch variants. __builtin_prefetch takes the locality hint
+ * as a compile-time constant, so every hint gets its own copy of the
+ * loop. The last distance accesses run without prefetch rather than
+ * forming addresses past the end of the buffer.
+ */
+#define STRIDED_PREFETCH(name, hint)                                             \
+    static uint64_t name(const uint64_t *buffer, size_t count, size_t step,       \
+                         size_t ahead) {                                          \
+        uint64_t sum = 0;                                                         \
+        size_t stop = count > ahead ? count - ahead : 0;                          \
+        size_t i = 0;                                                             \
+        for (; i < stop; i += step) {                                             \
+            __builtin_prefetch(&buffer[i + ahead], 0, hint);                      \
+            sum += buffer[i];                                                     \
+        }                                                                         \
+        for (; i < count; i += step) sum += buffer[i];                            \
+        return sum;                                                               \
+    }
+
+#define INDIRECT_PREFETCH(name, hint)                                            \
+    static uint64_t name(const uint64_t *buffer, const uint32_t *index,           \
+                         size_t count, size_t ahead) {                            \
+        uint64_t sum = 0;                                                         \
+        size_t stop = count > ahead ? count - ahead : 0;                          \
+        size_t i = 0;                                                             \
+        for (; i < stop; i++) {                                                   \
+            __builtin_prefetch(&buffer[index[i + ahead]], 0, hint);               \
+            sum += buffer[index[i]];                                              \
+        }                                                                         \
+        for (; i < count; i++) sum += buffer[index[i]];                           \
+        return sum;                                                               \
+    }
+
+STRIDED_PREFETCH(strided_nta, 0)
+STRIDED_PREFETCH(strided_t2, 1)
+STRIDED_PREFETCH(strided_t1, 2)
+STRIDED_PREFETCH(strided_t0, 3)
+INDIRECT_PREFETCH(indirect_nta, 0)
+INDIRECT_PREFETCH(indirect_t2, 1)
+INDIRECT_PREFETCH(indirect_t1, 2)
+INDIRECT_PREFETCH(indirect_t0, 3)
+
+const char *prefetch_hint_name(prefetch_hint_t hint) {
+    static const char *names[PREFETCH_HINT_COUNT] = { "nta", "t2", "t1", "t0" };
+    
+    if (hint < 0 || hint >= PREFETCH_HINT_COUNT) return "unknown";
+    return names[hint];
+}
+
+uint64_t memory_stream_strided_prefetch(const uint64_t *buffer, size_t size, size_t stride,
+                                        size_t distance, prefetch_hint_t hint) {
+    size_t count = size / sizeof(uint64_t);
+    size_t step = (stride * CACHE_LINE_SIZE) / sizeof(uint64_t);
+    size_t ahead = distance * step;
+    
+    if (distance == 0) return memory_stream_strided(buffer, size, stride);
+    switch (hint) {
+        case PREFETCH_NTA: return strided_nta(buffer, count, step, ahead);
+        case PREFETCH_T2:  return strided_t2(buffer, count, step, ahead);
+        case PREFETCH_T1:  return strided_t1(buffer, count, step, ahead);
+        default:           return strided_t0(buffer, count, step, ahead);
+    }
+}
+
+uint64_t memory_stream_indirect(const uint64_t *buffer, const uint32_t *index, size_t count,
+                                size_t distance, prefetch_hint_t hint) {
+    if (distance == 0) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; i++) sum += buffer[index[i]];
+        return sum;
+    }
+    switch (hint) {
+        case PREFETCH_NTA: return indirect_nta(buffer, index, count, distance);
+        case PREFETCH_T2:  return indirect_t2(buffer, index, count, distance);
+        case PREFETCH_T1:  return indirect_t1(buffer, index, count, distance);
+        default:           return indirect_t0(buffer, index, count, distance);
+    }
+}
+
+/*
+ * Scalar kernels: one 64-bit access per iteration, never vectorized.
+ */
+__attribute__((optimize("no-tree-vectorize")))
+static uint64_t read_scalar(const uint64_t *buffer, size_t count) {
+    uint64_t sum = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        sum += buffer[i];
+    }
+    
+    return sum;
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+static void write_scalar(uint64_t *buffer, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = STREAM_WRITE_PATTERN;
+    }
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+static void copy_scalar(uint64_t *dst, const uint64_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = src[i];
+    }
+}
+
+#ifdef STREAM_X86
+
+/*
+ * Words to process before dst reaches the given alignment
+ * (non-temporal stores need naturally aligned vectors).
+ */
+static size_t align_head(const void *dst, size_t count, size_t align) {
+    size_t misalign = (uintptr_t)dst & (align - 1);
+    size_t head = misalign ? (align - misalign) / sizeof(uint64_t) : 0;
+    return head < count ? head : count;
+}
+
+/*
+ * SSE2: 4 x 128-bit accumulators per iteration (one cache line).
+ */
+__attribute__((target("sse2")))
+static uint64_t read_sse2(const uint64_t *buffer, size_t count) {
+    __m128i a0 = _mm_setzero_si128(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    
+    for (; i + 8 <= count; i += 8) {
+        a0 = _mm_add_epi64(a0, _mm_loadu_si128((const __m128i *)(buffer + i)));
+        a1 = _mm_add_epi64(a1, _mm_loadu_si128((const __m128i *)(buffer + i + 2)));
+        a2 = _mm_add_epi64(a2, _mm_loadu_si128((const __m128i *)(buffer + i + 4)));
+        a3 = _mm_add_epi64(a3, _mm_loadu_si128((const __m128i *)(buffer + i + 6)));
+    }
+    
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(_mm_add_epi64(a0, a1), _mm_add_epi64(a2, a3)));
+    return lanes[0] + lanes[1] + read_scalar(buffer + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void write_sse2(uint64_t *buffer, size_t count, int nt) {
+    const __m128i v = _mm_set1_epi64x((long long)STREAM_WRITE_PATTERN);
+    size_t i = nt ? align_head(buffer, count, 16) : 0;
+    
+    write_scalar(buffer, i);
+    if (nt) {
+        for (; i + 8 <= count; i += 8) {
+            _mm_stream_si128((__m128i *)(buffer + i), v);
+            _mm_stream_si128((__m128i *)(buffer + i + 2), v);
+            _mm_stream_si128((__m128i *)(buffer + i + 4), v);
+            _mm_stream_si128((__m128i *)(buffer + i + 6), v);
+        }
+        _mm_sfence();
+    } else {
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128((__m128i *)(buffer + i), v);
+            _mm_storeu_si128((__m128i *)(buffer + i + 2), v);
+            _mm_storeu_si128((__m128i *)(buffer + i + 4), v);
+            _mm_storeu_si128((__m128i *)(buffer + i + 6), v);
+        }
+    }
+    write_scalar(buffer + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void copy_sse2(uint64_t *dst, const uint64_t *src, size_t count, int nt) {
+    size_t i = nt ? align_head(dst, count, 16) : 0;
+    
+    copy_scalar(dst, src, i);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(src + i + 2));
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(src + i + 4));
+        __m128i v3 = _mm_loadu_si128((const __m128i *)(src + i + 6));
+        if (nt) {
+            _mm_stream_si128((__m128i *)(dst + i), v0);
+            _mm_stream_si128((__m128i *)(dst + i + 2), v1);
+            _mm_stream_si128((__m128i *)(dst + i + 4), v2);
+            _mm_stream_si128((__m128i *)(dst + i + 6), v3);
+        } else {
+            _mm_storeu_si128((__m128i *)(dst + i), v0);
+            _mm_storeu_si128((__m128i *)(dst + i + 2), v1);
+            _mm_storeu_si128((__m128i *)(dst + i + 4), v2);
+            _mm_storeu_si128((__m128i *)(dst + i + 6), v3);
+        }
+    }
+    if (nt) _mm_sfence();
+    copy_scalar(dst + i, src + i, count - i);
+}
+
+/*
+ * AVX2: 4 x 256-bit accumulators per iteration (two cache lines).
+ */
+__attribute__((target("avx2")))
+static uint64_t read_avx2(const uint64_t *buffer, size_t count) {
+    __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    
+    for (; i + 16 <= count; i += 16) {
+        a0 = _mm256_add_epi64(a0, _mm256_loadu_si256((const __m256i *)(buffer + i)));
+        a1 = _mm256_add_epi64(a1, _mm256_loadu_si256((const __m256i *)(buffer + i + 4)));
+        a2 = _mm256_add_epi64(a2, _mm256_loadu_si256((const __m256i *)(buffer + i + 8)));
+        a3 = _mm256_add_epi64(a3, _mm256_loadu_si256((const __m256i *)(buffer + i + 12)));
+    }
+    
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes,
+                        _mm256_add_epi64(_mm256_add_epi64(a0, a1), _mm256_add_epi64(a2, a3)));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + read_scalar(buffer + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void write_avx2(uint64_t *buffer, size_t count, int nt) {
+    const __m256i v = _mm256_set1_epi64x((long long)STREAM_WRITE_PATTERN);
+    size_t i = nt ? align_head(buffer, count, 32) : 0;
+    
+    write_scalar(buffer, i);
+    if (nt) {
+        for (; i + 16 <= count; i += 16) {
+            _mm256_stream_si256((__m256i *)(buffer + i), v);
+            _mm256_stream_si256((__m256i *)(buffer + i + 4), v);
+            _mm256_stream_si256((__m256i *)(buffer + i + 8), v);
+            _mm256_stream_si256((__m256i *)(buffer + i + 12), v);
+        }
+        _mm_sfence();
+    } else {
+        for (; i + 16 <= count; i += 16) {
+            _mm256_storeu_si256((__m256i *)(buffer + i), v);
+            _mm256_storeu_si256((__m256i *)(buffer + i + 4), v);
+            _mm256_storeu_si256((__m256i *)(buffer + i + 8), v);
+            _mm256_storeu_si256((__m256i *)(buffer + i + 12), v);
+        }
+    }
+    write_scalar(buffer + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void copy_avx2(uint64_t *dst, const uint64_t *src, size_t count, int nt) {
+    size_t i = nt ? align_head(dst, count, 32) : 0;
+    
+    copy_scalar(dst, src, i);
+    for (; i + 16 <= count; i += 16) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(src + i + 4));
+        __m256i v2 = _mm256_loadu_si256((const __m256i *)(src + i + 8));
+        __m256i v3 = _mm256_loadu_si256((const __m256i *)(src + i + 12));
+        if (nt) {
+            _mm256_stream_si256((__m256i *)(dst + i), v0);
+            _mm256_stream_si256((__m256i *)(dst + i + 4), v1);
+            _mm256_stream_si256((__m256i *)(dst + i + 8), v2);
+            _mm256_stream_si256((__m256i *)(dst + i + 12), v3);
+        } else {
+            _mm256_storeu_si256((__m256i *)(dst + i), v0);
+            _mm256_storeu_si256((__m256i *)(dst + i + 4), v1);
+            _mm256_storeu_si256((__m256i *)(dst + i + 8), v2);
+            _mm256_storeu_si256((__m256i *)(dst + i + 12), v3);
+        }
+    }
+    if (nt) _mm_sfence();
+    copy_scalar(dst + i, src + i, count - i);
+}
+
+/*
+ * AVX-512: 4 x 512-bit accumulators per iteration (four cache lines).
+ */
+__attribute__((target("avx512f")))
+static uint64_t read_avx512(const uint64_t *buffer, size_t count) {
+    __m512i a0 = _mm512_setzero_si512(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    
+    for (; i + 32 <= count; i += 32) {
+        a0 = _mm512_add_epi64(a0, _mm512_loadu_si512((const void *)(buffer + i)));
+        a1 = _mm512_add_epi64(a1, _mm512_loadu_si512((const void *)(buffer + i + 8)));
+        a2 = _mm512_add_epi64(a2, _mm512_loadu_si512((const void *)(buffer + i + 16)));
+        a3 = _mm512_add_epi64(a3, _mm512_loadu_si512((const void *)(buffer + i + 24)));
+    }
+    
+    __m512i total = _mm512_add_epi64(_mm512_add_epi64(a0, a1), _mm512_add_epi64(a2, a3));
+    return (uint64_t)_mm512_reduce_add_epi64(total) + read_scalar(buffer + i, count - i);
+}
+
+__attribute__((target("avx512f")))
+static void write_avx512(uint64_t *buffer, size_t count, int nt) {
+    const __m512i v = _mm512_set1_epi64((long long)STREAM_WRITE_PATTERN);
+    size_t i = nt ? align_head(buffer, count, 64) : 0;
+    
+    write_scalar(buffer, i);
+    if (nt) {
+        for (; i + 32 <= count; i += 32) {
+            _mm512_stream_si512((void *)(buffer + i), v);
+            _mm512_stream_si512((void *)(buffer + i + 8), v);
+            _mm512_stream_si512((void *)(buffer + i + 16), v);
+            _mm512_stream_si512((void *)(buffer + i + 24), v);
+        }
+        _mm_sfence();
+    } else {
+        for (; i + 32 <= count; i += 32) {
+            _mm512_storeu_si512((void *)(buffer + i), v);
+            _mm512_storeu_si512((void *)(buffer + i + 8), v);
+            _mm512_storeu_si512((void *)(buffer + i + 16), v);
+            _mm512_storeu_si512((void *)(buffer + i + 24), v);
+        }
+    }
+    write_scalar(buffer + i, count - i);
+}
+
+__attribute__((target("avx512f")))
+static void copy_avx512(uint64_t *dst, const uint64_t *src, size_t count, int nt) {
+    size_t i = nt ? align_head(dst, count, 64) : 0;
+    
+    copy_scalar(dst, src, i);
+    for (; i + 32 <= count; i += 32) {
+        __m512i v0 = _mm512_loadu_si512((const void *)(src + i));
+        __m512i v1 = _mm512_loadu_si512((const void *)(src + i + 8));
+        __m512i v2 = _mm512_loadu_si512((const void *)(src + i + 16));
+        __m512i v3 = _mm512_loadu_si512((const void *)(src + i + 24));
+        if (nt) {
+            _mm512_stream_si512((void *)(dst + i), v0);
+            _mm512_stream_si512((void *)(dst + i + 8), v1);
+            _mm512_stream_si512((void *)(dst + i + 16), v2);
+            _mm512_stream_si512((void *)(dst + i + 24), v3);
+        } else {
+            _mm512_storeu_si512((void *)(dst + i), v0);
+            _mm512_storeu_si512((void *)(dst + i + 8), v1);
+            _mm512_storeu_si512((void *)(dst + i + 16), v2);
+            _mm512_storeu_si512((void *)(dst + i + 24), v3);
+        }
+    }
+    if (nt) _mm_sfence();
+    copy_scalar(dst + i, src + i, count - i);
+}
+
+/*
+ * String instructions: microcode picks the strategy (fast with ERMS/FSRM,
+ * and may switch to non-temporal-like stores for large sizes).
+ */
+static void write_rep(uint64_t *buffer, size_t bytes) {
+    void *d = buffer;
+    __asm__ __volatile__("rep stosb"
+                         : "+D"(d), "+c"(bytes)
+                         : "a"((int)(STREAM_WRITE_PATTERN & 0xff))
+                         : "memory");
+}
+
+static void copy_rep(uint64_t *dst, const uint64_t *src, size_t bytes) {
+    void *d = dst;
+    const void *s = src;
+    __asm__ __volatile__("rep movsb"
+                         : "+D"(d), "+S"(s), "+c"(bytes)
+                         :
+                         : "memory");
+}
+
+#endif /* STREAM_X86 */
+
+int stream_kernel_supported(stream_kernel_t kernel) {
+    switch (kernel) {
+        case STREAM_KERNEL_SCALAR:
+            return 1;
+#ifdef STREAM_X86
+        case STREAM_KERNEL_SSE2:
+        case STREAM_KERNEL_SSE2_NT:
+            return __builtin_cpu_supports("sse2");
+        case STREAM_KERNEL_AVX2:
+        case STREAM_KERNEL_AVX2_NT:
+            return __builtin_cpu_supports("avx2");
+        case STREAM_KERNEL_AVX512:
+        case STREAM_KERNEL_AVX512_NT:
+            return __builtin_cpu_supports("avx512f");
+        case STREAM_KERNEL_REP_MOVSB:
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+const char *stream_kernel_name(stream_kernel_t kernel) {
+    static const char *names[STREAM_KERNEL_COUNT] = {
+        "scalar", "sse2", "avx2", "avx512",
+        "sse2_nt", "avx2_nt", "avx512_nt", "rep_movsb"
+    };
+    
+    if (kernel < 0 || kernel >= STREAM_KERNEL_COUNT) return "unknown";
+    return names[kernel];
+}
+
+stream_kernel_t stream_kernel_best(void) {
+    if (stream_kernel_supported(STREAM_KERNEL_AVX512)) return STREAM_KERNEL_AVX512;
+    if (stream_kernel_supported(STREAM_KERNEL_AVX2)) return STREAM_KERNEL_AVX2;
+    if (stream_kernel_supported(STREAM_KERNEL_SSE2)) return STREAM_KERNEL_SSE2;
+    return STREAM_KERNEL_SCALAR;
+}
+
+uint64_t memory_stream_read_kernel(stream_kernel_t kernel, const uint64_t *buffer, size_t size) {
+    size_t count = size / sizeof(uint64_t);
+    
+    if (!stream_kernel_supported(kernel)) kernel = STREAM_KERNEL_SCALAR;
+    
+    switch (kernel) {
+#ifdef STREAM_X86
+        case STREAM_KERNEL_SSE2:
+        case STREAM_KERNEL_SSE2_NT:
+            return read_sse2(buffer, count);
+        case STREAM_KERNEL_AVX2:
+        case STREAM_KERNEL_AVX2_NT:
+            return read_avx2(buffer, count);
+        case STREAM_KERNEL_AVX512:
+        case STREAM_KERNEL_AVX512_NT:
+            return read_avx512(buffer, count);
+#endif
+        default:
+            return read_scalar(buffer, count);
+    }
+}
+
+void memory_stream_write_kernel(stream_kernel_t kernel, uint64_t *buffer, size_t size) {
+    size_t count = size / sizeof(uint64_t);
+    
+    if (!stream_kernel_supported(kernel)) kernel = STREAM_KERNEL_SCALAR;
+    
+    switch (kernel) {
+#ifdef STREAM_X86
+        case STREAM_KERNEL_SSE2:      write_sse2(buffer, count, 0); break;
+        case STREAM_KERNEL_SSE2_NT:   write_sse2(buffer, count, 1); break;
+        case STREAM_KERNEL_AVX2:      write_avx2(buffer, count, 0); break;
+        case STREAM_KERNEL_AVX2_NT:   write_avx2(buffer, count, 1); break;
+        case STREAM_KERNEL_AVX512:    write_avx512(buffer, count, 0); break;
+        case STREAM_KERNEL_AVX512_NT: write_avx512(buffer, count, 1); break;
+        case STREAM_KERNEL_REP_MOVSB: write_rep(buffer, count * sizeof(uint64_t)); break;
+#endif
+        default:                      write_scalar(buffer, count); break;
+    }
+}
+
+void memory_stream_copy_kernel(stream_kernel_t kernel, uint64_t *dst, const uint64_t *src, size_t size) {
+    size_t count = size / sizeof(uint64_t);
+    
+    if (!stream_kernel_supported(kernel)) kernel = STREAM_KERNEL_SCALAR;
+    
+    switch (kernel) {
+#ifdef STREAM_X86
+        case STREAM_KERNEL_SSE2:      copy_sse2(dst, src, count, 0); break;
+        case STREAM_KERNEL_SSE2_NT:   copy_sse2(dst, src, count, 1); break;
+        case STREAM_KERNEL_AVX2:      copy_avx2(dst, src, count, 0); break;
+        case STREAM_KERNEL_AVX2_NT:   copy_avx2(dst, src, count, 1); break;
+        case STREAM_KERNEL_AVX512:    copy_avx512(dst, src, count, 0); break;
+        case STREAM_KERNEL_AVX512_NT: copy_avx512(dst, src, count, 1); break;
+        case STREAM_KERNEL_REP_MOVSB: copy_rep(dst, src, count * sizeof(uint64_t)); break;
+#endif
+        default:                      copy_scalar(dst, src, count); break;
+    }
+}
@@ -15,17 +15,12 @@
 #include <string.h>
 #include <unistd.h>
 #include <sched.h>
+#include <sys/resource.h>
 
-typedef struct {
-    uint64_t timestamp_ns;
-    uint64_t runtime_ns;
-    uint64_t voluntary_ctxt_switches;
-    uint64_t nonvoluntary_ctxt_switches;
-    uint64_t minor_page_faults;
-    uint64_t major_page_faults;
-    int start_cpu;
-    int end_cpu;
-} workload_metrics_t;
+#include "metrics.h"
+
+static metrics_mode_t current_mode = METRICS_MODE_PROC;
+static uint64_t calibrated_overhead_ns = 0;
 
 /*
  * Get monotonic raw timestamp in nanoseconds.
@@ -121,16 +116,68 @@ static void read_page_faults(uint64_t *minor, uint64_t *major) {
     fclose(f);
 }
 
+/*
+ * Read context switch and page fault counts for the calling thread.
+ *
+ * Justification for syscall:
+ *   getrusage(RUSAGE_THREAD) returns the same kernel counters as /proc
+ *   without open/read/parse, so it is cheap enough for short workloads.
+ *   Counts are per-thread rather than process-wide.
+ */
+static void read_rusage(uint64_t *voluntary, uint64_t *nonvoluntary,
+                        uint64_t *minor, uint64_t *major) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) != 0) {
+        *voluntary = 0;
+        *nonvoluntary = 0;
+        *minor = 0;
+        *major = 0;
+        return;
+    }
+    
+    *voluntary = (uint64_t)ru.ru_nvcsw;
+    *nonvoluntary = (uint64_t)ru.ru_nivcsw;
+    *minor = (uint64_t)ru.ru_minflt;
+    *major = (uint64_t)ru.ru_majflt;
+}
+
+static void read_counters(uint64_t *voluntary, uint64_t *nonvoluntary,
+                          uint64_t *minor, uint64_t *major) {
+    if (current_mode == METRICS_MODE_FAST) {
+        read_rusage(voluntary, nonvoluntary, minor, major);
+    } else {
+        read_ctxt_switches(voluntary, nonvoluntary);
+        read_page_faults(minor, major);
+    }
+}
+
+/*
+ * Select how counters are collected at workload boundaries.
+ */
+void metrics_set_mode(metrics_mode_t mode) {
+    if (mode != current_mode) {
+        current_mode = mode;
+        calibrated_overhead_ns = 0;
+    }
+}
+
+metrics_mode_t metrics_get_mode(void) {
+    return current_mode;
+}
+
 /*
  * Initialize metrics collection before workload.
+ * Clock is read last on entry and first on exit (metrics_finish).
  */
 void metrics_init(workload_metrics_t *m) {
     memset(m, 0, sizeof(workload_metrics_t));
     
-    m->timestamp_ns = get_timestamp_ns();
-    read_ctxt_switches(&m->voluntary_ctxt_switches, &m->nonvoluntary_ctxt_switches);
-    read_page_faults(&m->minor_page_faults, &m->major_page_faults);
     m->start_cpu = sched_getcpu();
+    read_counters(&m->voluntary_ctxt_switches, &m->nonvoluntary_ctxt_switches,
+                  &m->minor_page_faults, &m->major_page_faults);
+    
+    // Clock read last so counter collection is outside the timed region
+    m->timestamp_ns = get_timestamp_ns();
 }
 
 /*
@@ -142,8 +189,7 @@ void metrics_finish(workload_metrics_t *m) {
     uint64_t vol_ctxt, nonvol_ctxt;
     uint64_t minor_pf, major_pf;
     
-    read_ctxt_switches(&vol_ctxt, &nonvol_ctxt);
-    read_page_faults(&minor_pf, &major_pf);
+    read_counters(&vol_ctxt, &nonvol_ctxt, &minor_pf, &major_pf);
     
     m->runtime_ns = end_ts - m->timestamp_ns;
     m->voluntary_ctxt_switches = vol_ctxt - m->voluntary_ctxt_switches;
@@ -174,3 +220,40 @@ void metrics_print_csv(FILE *out, const workload_metrics_t *m) {
             m->start_cpu,
             m->end_cpu);
 }
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Measure the cost of an empty init/finish pair in the current mode.
+ * Median rather than mean so a single preemption does not skew it.
+ */
+uint64_t metrics_calibrate_overhead(int samples) {
+    if (samples < 1) samples = 1;
+    
+    uint64_t *runtimes = malloc(samples * sizeof(uint64_t));
+    if (!runtimes) return 0;
+    
+    workload_metrics_t m;
+    for (int i = 0; i < samples; i++) {
+        metrics_init(&m);
+        metrics_finish(&m);
+        runtimes[i] = m.runtime_ns;
+    }
+    
+    qsort(runtimes, samples, sizeof(uint64_t), compare_u64);
+    calibrated_overhead_ns = runtimes[samples / 2];
+    free(runtimes);
+    
+    return calibrated_overhead_ns;
+}
+
+/*
+ * Last calibrated overhead (0 if metrics_calibrate_overhead() not called).
+ */
+uint64_t metrics_overhead_ns(void) {
+    return calibrated_overhead_ns;
+}
@@ -15,9 +15,33 @@ typedef struct {
     int end_cpu;
 } workload_metrics_t;
 
+/*
+ * Collection modes.
+ *
+ * METRICS_MODE_PROC: parse /proc/self/status and /proc/self/stat
+ *   (process-wide counters, ~10-50us per boundary).
+ * METRICS_MODE_FAST: getrusage(RUSAGE_THREAD), no file I/O
+ *   (calling-thread counters, ~1us per boundary).
+ */
+typedef enum {
+    METRICS_MODE_PROC = 0,
+    METRICS_MODE_FAST = 1
+} metrics_mode_t;
+
+void metrics_set_mode(metrics_mode_t mode);
+metrics_mode_t metrics_get_mode(void);
+
 void metrics_init(workload_metrics_t *m);
 void metrics_finish(workload_metrics_t *m);
 void metrics_print_csv_header(FILE *out);
 void metrics_print_csv(FILE *out, const workload_metrics_t *m);
 
+/*
+ * Measure the runtime_ns reported for an empty init/finish pair in the
+ * current mode. Returns the median over `samples` pairs; the result is
+ * cached and also available via metrics_overhead_ns().
+ */
+uint64_t metrics_calibrate_overhead(int samples);
+uint64_t metrics_overhead_ns(void);
+
 #endif
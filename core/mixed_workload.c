@@ -16,36 +16,248 @@
  *   Bridge gap between synthetic and real workloads.
  *   More realistic cache/memory behavior.
  *   Configurable to match different application profiles.
+ *
+ * Design:
+ *   - Keys from a seeded xoshiro256** (rng.h): reproducible, and fast
+ *     enough that large access streams build in milliseconds where
+ *     rand() % count took seconds and depended on time(NULL)
+ *   - Zipf by rejection-inversion (Hormann & Derflinger 1996): O(1)
+ *     memory and expected ~1.1 draws per key for any key space, so the
+ *     same sampler serves pre-generated and in-loop streams
+ *   - Key -> slot through a multiplier coprime to the slot count: a
+ *     bijection that scatters hot keys over the buffer instead of
+ *     packing them into a few cache lines
+ *   - inloop drops the index buffer; the loop draws its own keys
+ *   - Multithreaded: one mixed_workload_t per pool worker, built in the
+ *     untimed setup on that worker so private buffers are first-touched
+ *     locally; shared buffers are initialized slice by slice the same
+ *     way. Shared writes are plain racy stores on purpose: the values
+ *     do not matter, the coherence traffic they cause does
+ *
+ * Justification for syscalls:
+ *   None (buffer allocation through lrc_alloc()).
  */
 
+#define _GNU_SOURCE
+#include <math.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include "mixed_workload.h"
 
 #define KB (1024ULL)
 #define MB (1024ULL * KB)
 
-typedef struct {
-    uint64_t *buffer;
-    size_t buffer_size;
-    uint64_t *indices;
-    size_t working_set_size;
-    int compute_ratio;  // Compute ops per memory access
-    uint64_t seed;
-} mixed_workload_t;
+#define DEFAULT_SEED 42
+#define DEFAULT_ZIPF_S 0.99
+#define DEFAULT_HOT_FRACTION 0.2
+#define DEFAULT_HOT_ACCESS 0.8
+
+static const char *keys_names[MIXED_KEYS_COUNT] = { "uniform", "zipf", "hotspot" };
+
+const char *mixed_keys_name(mixed_keys_t dist) {
+    return dist < MIXED_KEYS_COUNT ? keys_names[dist] : "unknown";
+}
+
+void mixed_keys_defaults(mixed_keys_params_t *params) {
+    params->dist = MIXED_KEYS_UNIFORM;
+    params->zipf_s = DEFAULT_ZIPF_S;
+    params->hot_fraction = DEFAULT_HOT_FRACTION;
+    params->hot_access = DEFAULT_HOT_ACCESS;
+    params->seed = DEFAULT_SEED;
+    params->inloop = 0;
+    
+    const char *env = getenv("LRC_SEED");
+    if (env && *env) params->seed = strtoull(env, NULL, 0);
+    
+    env = getenv("LRC_KEYS_INLOOP");
+    if (env && *env) params->inloop = atoi(env) != 0;
+    
+    env = getenv("LRC_KEY_DIST");
+    if (!env || !*env) return;
+    if (strncmp(env, "uniform", 7) == 0) {
+        params->dist = MIXED_KEYS_UNIFORM;
+    } else if (strncmp(env, "zipf", 4) == 0) {
+        params->dist = MIXED_KEYS_ZIPF;
+        if (env[4] == ':' && atof(env + 5) > 0.0) params->zipf_s = atof(env + 5);
+    } else if (strncmp(env, "hotspot", 7) == 0) {
+        params->dist = MIXED_KEYS_HOTSPOT;
+        if (env[7] == ':') {
+            char *end;
+            double fraction = strtod(env + 8, &end);
+            if (fraction > 0.0 && fraction <= 1.0) params->hot_fraction = fraction;
+            if (*end == ':') {
+                double access = atof(end + 1);
+                if (access > 0.0 && access <= 1.0) params->hot_access = access;
+            }
+        }
+    } else {
+        fprintf(stderr, "Unknown key distribution '%s' in LRC_KEY_DIST, using uniform\n", env);
+    }
+}
+
+/*
+ * Rejection-inversion Zipf sampling. H is an integral of the density
+ * h(x) = x^-s; helper1/helper2 keep log1p(x)/x and expm1(x)/x accurate
+ * near 0 so s = 1 needs no special case.
+ */
+static double helper1(double x) {
+    if (fabs(x) > 1e-8) return log1p(x) / x;
+    return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+static double helper2(double x) {
+    if (fabs(x) > 1e-8) return expm1(x) / x;
+    return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+static double zipf_h(double s, double x) {
+    return exp(-s * log(x));
+}
+
+static double zipf_h_integral(double s, double x) {
+    double log_x = log(x);
+    return helper2((1.0 - s) * log_x) * log_x;
+}
+
+static double zipf_h_integral_inverse(double s, double x) {
+    double t = x * (1.0 - s);
+    if (t < -1.0) t = -1.0;     // Rounding at the edge of the domain
+    return exp(helper1(t) * x);
+}
+
+/* Constants for key space n; the generator state is left alone */
+static void keygen_setup(mixed_keygen_t *kg, uint64_t n) {
+    kg->n = n ? n : 1;
+    
+    if (kg->dist == MIXED_KEYS_HOTSPOT) {
+        kg->hot_n = (uint64_t)(kg->n * kg->hot_fraction + 0.5);
+        if (kg->hot_n < 1) kg->hot_n = 1;
+        if (kg->hot_n > kg->n) kg->hot_n = kg->n;
+    } else if (kg->dist == MIXED_KEYS_ZIPF) {
+        double s = kg->s;
+        kg->h_x1 = zipf_h_integral(s, 1.5) - 1.0;
+        kg->h_n = zipf_h_integral(s, kg->n + 0.5);
+        kg->sv = 2.0 - zipf_h_integral_inverse(s, zipf_h_integral(s, 2.5) - zipf_h(s, 2.0));
+    }
+}
+
+void mixed_keygen_init(mixed_keygen_t *kg, const mixed_keys_params_t *params, uint64_t n) {
+    memset(kg, 0, sizeof(*kg));
+    kg->dist = params->dist;
+    kg->hot_fraction = params->hot_fraction;
+    kg->hot_access = params->hot_access;
+    kg->s = params->zipf_s;
+    lrc_rng_seed(&kg->rng, params->seed);
+    keygen_setup(kg, n);
+}
+
+uint64_t mixed_keygen_next(mixed_keygen_t *kg) {
+    switch (kg->dist) {
+        case MIXED_KEYS_ZIPF:
+            for (;;) {
+                double u = kg->h_n + lrc_rng_double(&kg->rng) * (kg->h_x1 - kg->h_n);
+                double x = zipf_h_integral_inverse(kg->s, u);
+                uint64_t k = (uint64_t)(x + 0.5);
+                if (k < 1) k = 1;
+                else if (k > kg->n) k = kg->n;
+                // Accept: inside the squeeze, or under the density
+                if ((double)k - x <= kg->sv ||
+                    u >= zipf_h_integral(kg->s, k + 0.5) - zipf_h(kg->s, (double)k)) {
+                    return k - 1;
+                }
+            }
+        case MIXED_KEYS_HOTSPOT:
+            if (kg->hot_n >= kg->n || lrc_rng_double(&kg->rng) < kg->hot_access) {
+                return lrc_rng_bounded(&kg->rng, kg->hot_n);
+            }
+            return kg->hot_n + lrc_rng_bounded(&kg->rng, kg->n - kg->hot_n);
+        default:
+            return lrc_rng_bounded(&kg->rng, kg->n);
+    }
+}
+
+static uint64_t gcd_u64(uint64_t a, uint64_t b) {
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline size_t key_slot(const mixed_workload_t *w, uint64_t key) {
+    return (size_t)(key * w->slot_mult % w->slots);
+}
+
+/* Next slot: from the index buffer, or a fresh key in inloop mode */
+static inline size_t next_slot(mixed_workload_t *w, uint64_t iter) {
+    if (w->indices) return w->indices[iter % w->working_set_size];
+    return key_slot(w, mixed_keygen_next(&w->keygen));
+}
+
+/* Follow a working set changed by phased(); keeps the stream position */
+static void sync_keygen(mixed_workload_t *w) {
+    if (!w->indices && w->keygen.n != w->working_set_size) {
+        keygen_setup(&w->keygen, w->working_set_size);
+    }
+}
+
+/*
+ * Key space, key -> slot map and access stream for a buffer already set
+ * in w (buffer, buffer_size, compute_ratio). Allocates only the index
+ * buffer.
+ */
+static int workload_attach(mixed_workload_t *w, size_t working_set,
+                           const mixed_keys_params_t *keys) {
+    w->keys = *keys;
+    w->seed = keys->seed;
+    w->write_pct = 100;
+    w->write_acc = 0;
+    w->indices = NULL;
+    
+    // Key space: at most one key per slot
+    w->slots = w->buffer_size / sizeof(uint64_t);
+    if (w->slots < 1) w->slots = 1;
+    w->working_set_size = working_set < w->slots ? working_set : w->slots;
+    if (w->working_set_size < 1) w->working_set_size = 1;
+    
+    // Multiplier near slots / golden ratio, coprime so keys map 1:1; keep
+    // key * slot_mult within 64 bits
+    w->slot_mult = 1;
+    if (w->slots > 2 && w->slots <= (1ULL << 32)) {
+        w->slot_mult = (uint64_t)(w->slots * 0.6180339887498949);
+        while (gcd_u64(w->slot_mult, w->slots) != 1) w->slot_mult++;
+    }
+    
+    mixed_keygen_init(&w->keygen, keys, w->working_set_size);
+    if (keys->inloop) return 0;
+    
+    // Pre-generate access pattern
+    w->indices = malloc(w->working_set_size * sizeof(uint64_t));
+    if (!w->indices) return -1;
+    for (size_t i = 0; i < w->working_set_size; i++) {
+        w->indices[i] = key_slot(w, mixed_keygen_next(&w->keygen));
+    }
+    return 0;
+}
 
 /*
  * Initialize mixed workload.
  */
-int mixed_workload_init(mixed_workload_t *w, size_t buffer_size, 
-                        size_t working_set, int compute_ratio) {
+int mixed_workload_init_keys(mixed_workload_t *w, size_t buffer_size, size_t working_set,
+                             int compute_ratio, const mixed_keys_params_t *keys) {
+    memset(w, 0, sizeof(*w));
     w->buffer_size = buffer_size;
-    w->working_set_size = working_set;
     w->compute_ratio = compute_ratio;
-    w->seed = time(NULL);
     
-    w->buffer = malloc(buffer_size);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    lrc_alloc_opts_t opts = { -1, LRC_PAGES_DEFAULT, 0 };
+    if (lrc_pages_from_env(pages, "default") > 0) opts.pages = pages[0];
+    w->pages = opts.pages;
+    
+    w->buffer = lrc_alloc(buffer_size, &opts);
     if (!w->buffer) return -1;
     
     // Initialize with pattern
@@ -54,27 +266,25 @@ int mixed_workload_init(mixed_workload_t *w, size_t buffer_size,
         w->buffer[i] = i;
     }
     
-    // Pre-generate access pattern
-    w->indices = malloc(working_set * sizeof(uint64_t));
-    if (!w->indices) {
-        free(w->buffer);
+    if (workload_attach(w, working_set, keys) != 0) {
+        lrc_free(w->buffer, buffer_size, w->pages);
         return -1;
     }
-    
-    // Random working set within buffer
-    srand(w->seed);
-    for (size_t i = 0; i < working_set; i++) {
-        w->indices[i] = rand() % count;
-    }
-    
     return 0;
 }
 
+int mixed_workload_init(mixed_workload_t *w, size_t buffer_size, 
+                        size_t working_set, int compute_ratio) {
+    mixed_keys_params_t keys;
+    mixed_keys_defaults(&keys);
+    return mixed_workload_init_keys(w, buffer_size, working_set, compute_ratio, &keys);
+}
+
 /*
  * Cleanup mixed workload.
  */
 void mixed_workload_cleanup(mixed_workload_t *w) {
-    free(w->buffer);
+    lrc_free(w->buffer, w->buffer_size, w->pages);
     free(w->indices);
 }
 
@@ -95,9 +305,10 @@ void mixed_workload_cleanup(mixed_workload_t *w) {
 uint64_t mixed_workload_run(mixed_workload_t *w, uint64_t iterations) {
     uint64_t result = 0;
     
+    sync_keygen(w);
     for (uint64_t iter = 0; iter < iterations; iter++) {
         // Memory access from working set
-        size_t idx = w->indices[iter % w->working_set_size];
+        size_t idx = next_slot(w, iter);
         uint64_t value = w->buffer[idx];
         
         // Compute operations (configurable ratio)
@@ -108,8 +319,12 @@ uint64_t mixed_workload_run(mixed_workload_t *w, uint64_t iterations) {
             value ^= (value << 17);
         }
         
-        // Write back (dirty cache line)
-        w->buffer[idx] = value;
+        // Write back (dirty cache line), write_pct of the accesses
+        w->write_acc += w->write_pct;
+        if (w->write_acc >= 100) {
+            w->write_acc -= 100;
+            w->buffer[idx] = value;
+        }
         result += value;
     }
     
@@ -144,6 +359,7 @@ uint64_t mixed_workload_bursty(mixed_workload_t *w, uint64_t iterations) {
     uint64_t result = 0;
     int original_ratio = w->compute_ratio;
     
+    sync_keygen(w);
     for (uint64_t i = 0; i < iterations; i++) {
         // Alternate between compute-heavy and memory-heavy
         if ((i / 1000) % 2 == 0) {
@@ -153,7 +369,7 @@ uint64_t mixed_workload_bursty(mixed_workload_t *w, uint64_t iterations) {
             if (w->compute_ratio < 1) w->compute_ratio = 1;
         }
         
-        size_t idx = w->indices[i % w->working_set_size];
+        size_t idx = next_slot(w, i);
         uint64_t value = w->buffer[idx];
         
         for (int c = 0; c < w->compute_ratio; c++) {
@@ -161,10 +377,115 @@ uint64_t mixed_workload_bursty(mixed_workload_t *w, uint64_t iterations) {
             value ^= (value << 13);
         }
         
-        w->buffer[idx] = value;
+        w->write_acc += w->write_pct;
+        if (w->write_acc >= 100) {
+            w->write_acc -= 100;
+            w->buffer[idx] = value;
+        }
         result += value;
     }
     
     w->compute_ratio = original_ratio;
     return result;
 }
+
+/*
+ * Multithreaded run state, shared by the pool callbacks.
+ */
+typedef struct {
+    const mixed_mt_params_t *params;
+    mixed_workload_t *work;          // One per thread
+    uint64_t *shared;                // Shared mode buffer (NULL if private)
+    int *failed;                     // Setup failed on thread i
+    uint64_t *sink;                  // Keeps each thread's result live
+} mt_run_t;
+
+static void mt_setup(int id, void *arg) {
+    mt_run_t *run = arg;
+    const mixed_mt_params_t *p = run->params;
+    mixed_workload_t *w = &run->work[id];
+    mixed_keys_params_t keys = p->keys;
+    
+    keys.seed += id;
+    if (!run->shared) {
+        run->failed[id] = mixed_workload_init_keys(w, p->buffer_size, p->working_set,
+                                                   p->compute_ratio, &keys) != 0;
+    } else {
+        // First touch of this thread's slice of the shared buffer
+        size_t count = p->buffer_size / sizeof(uint64_t);
+        size_t lo = count * id / p->threads, hi = count * (id + 1) / p->threads;
+        for (size_t i = lo; i < hi; i++) {
+            run->shared[i] = i;
+        }
+        
+        memset(w, 0, sizeof(*w));
+        w->buffer = run->shared;
+        w->buffer_size = p->buffer_size;
+        w->compute_ratio = p->compute_ratio;
+        run->failed[id] = workload_attach(w, p->working_set, &keys) != 0;
+    }
+    w->write_pct = p->write_pct;
+}
+
+static void mt_work(int id, void *arg) {
+    mt_run_t *run = arg;
+    
+    if (run->failed[id]) return;
+    run->sink[id] = mixed_workload_run(&run->work[id], run->params->iterations);
+}
+
+int mixed_workload_mt_run(thread_pool_t *pool, const mixed_mt_params_t *params,
+                          mixed_mt_thread_t *per_thread) {
+    int n = params->threads;
+    mt_run_t run = { params, NULL, NULL, NULL, NULL };
+    lrc_pages_t pages = LRC_PAGES_DEFAULT;
+    int rc = -1;
+    
+    if (n < 1 || n > pool->num_threads || params->write_pct < 0 || params->write_pct > 100) {
+        return -1;
+    }
+    
+    run.work = calloc(n, sizeof(mixed_workload_t));
+    run.failed = calloc(n, sizeof(int));
+    run.sink = calloc(n, sizeof(uint64_t));
+    if (!run.work || !run.failed || !run.sink) goto out;
+    
+    if (params->shared) {
+        lrc_pages_t env_pages[LRC_PAGES_MAX];
+        lrc_alloc_opts_t opts = { -1, LRC_PAGES_DEFAULT, 0 };
+        if (lrc_pages_from_env(env_pages, "default") > 0) opts.pages = env_pages[0];
+        pages = opts.pages;
+        run.shared = lrc_alloc(params->buffer_size, &opts);
+        if (!run.shared) goto out;
+    }
+    
+    if (thread_pool_run(pool, n, mt_setup, mt_work, &run) != 0) goto out;
+    
+    rc = 0;
+    for (int i = 0; i < n; i++) {
+        const thread_pool_timing_t *t = &pool->timing[i];
+        if (run.failed[i]) rc = -1;
+        per_thread[i].ops = run.failed[i] ? 0 : params->iterations;
+        per_thread[i].runtime_ns = t->end_ns - t->start_ns;
+        per_thread[i].ops_per_sec = per_thread[i].runtime_ns ?
+            per_thread[i].ops / (per_thread[i].runtime_ns / 1e9) : 0.0;
+        per_thread[i].cpu = t->cpu;
+    }
+
+out:
+    if (run.work) {
+        for (int i = 0; i < n; i++) {
+            if (run.failed && run.failed[i]) continue;
+            if (run.shared) {
+                free(run.work[i].indices);
+            } else if (run.work[i].buffer) {
+                mixed_workload_cleanup(&run.work[i]);
+            }
+        }
+    }
+    if (run.shared) lrc_free(run.shared, params->buffer_size, pages);
+    free(run.work);
+    free(run.failed);
+    free(run.sink);
+    return rc;
+}
@@ -0,0 +1,178 @@
+/*
+ * mixed_workload.h - CPU+memory mixed workload with skewed key access
+ *
+ * Each iteration reads one 8-byte slot of the buffer, runs compute_ratio
+ * rounds of integer mixing on it and writes it back. Which slot is
+ * chosen comes from a key distribution over working_set keys, each key
+ * mapped to a fixed slot scattered over the buffer:
+ *
+ *   uniform   every key equally likely
+ *   zipf      key rank k with probability ~ 1/k^s (s = 0.99 as in YCSB)
+ *   hotspot   hot_fraction of the keys take hot_access of the accesses
+ *
+ * Keys come from a seeded xoshiro256** generator (rng.h), so a given
+ * seed reproduces the same access stream. By default the stream is
+ * generated once at init into an index buffer of working_set entries
+ * that the loop cycles through; with inloop set keys are drawn inside
+ * the loop instead, so working sets of any size need no second buffer
+ * (the draw, ~4 ns for uniform and ~30 ns for zipf, is then part
+ * of the measured work).
+ *
+ *     mixed_keys_params_t keys;
+ *     mixed_keys_defaults(&keys);            // LRC_SEED, LRC_KEY_DIST, ...
+ *     keys.dist = MIXED_KEYS_ZIPF;
+ *     mixed_workload_init_keys(&w, 16 << 20, 100000, 3, &keys);
+ *     mixed_workload_run(&w, iterations);
+ *     mixed_workload_cleanup(&w);
+ *
+ * mixed_workload_mt_run() runs the loop on a pinned thread_pool, each
+ * thread with its own key stream (seed + thread id), either on private
+ * buffers (first touched by their thread) or all on one shared buffer
+ * with a write share, to expose LLC sharing and coherence traffic
+ * between co-located workloads.
+ */
+
+#ifndef LRC_MIXED_WORKLOAD_H
+#define LRC_MIXED_WORKLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lrc_alloc.h"
+#include "rng.h"
+#include "thread_pool.h"
+
+typedef enum {
+    MIXED_KEYS_UNIFORM = 0,
+    MIXED_KEYS_ZIPF,
+    MIXED_KEYS_HOTSPOT,
+    MIXED_KEYS_COUNT
+} mixed_keys_t;
+
+typedef struct {
+    mixed_keys_t dist;
+    double zipf_s;            // Zipf exponent (> 0)
+    double hot_fraction;      // Hotspot: share of keys that are hot
+    double hot_access;        // Hotspot: share of accesses that hit them
+    uint64_t seed;            // Same seed, same access stream
+    int inloop;               // 1 = draw keys in the loop, no index buffer
+} mixed_keys_params_t;
+
+/* Key generator state (set up for one key space size) */
+typedef struct {
+    mixed_keys_t dist;
+    uint64_t n;               // Key space
+    lrc_rng_t rng;
+    uint64_t hot_n;           // Hotspot: keys [0, hot_n) are hot
+    double hot_fraction;
+    double hot_access;
+    double s;                 // Zipf: rejection-inversion constants
+    double h_x1;
+    double h_n;
+    double sv;
+} mixed_keygen_t;
+
+typedef struct {
+    uint64_t *buffer;
+    size_t buffer_size;
+    uint64_t *indices;        // Pre-generated slots (NULL with inloop)
+    size_t working_set_size;  // Key space; phased shrinks and regrows it
+    int compute_ratio;        // Compute ops per memory access
+    int write_pct;            // Accesses written back, percent (default 100)
+    int write_acc;            // Spreads the writes evenly over the stream
+    uint64_t seed;
+    lrc_pages_t pages;        // Buffer backing (first LRC_PAGE_SIZES entry)
+    mixed_keys_params_t keys;
+    mixed_keygen_t keygen;
+    uint64_t slot_mult;       // Key -> slot: key * slot_mult % slots
+    size_t slots;             // Buffer size in 8-byte slots
+} mixed_workload_t;
+
+typedef struct {
+    int threads;              // Pool workers taking part
+    int shared;               // 1 = one buffer for all, 0 = private buffers
+    int write_pct;            // Accesses written back, percent
+    size_t buffer_size;       // Per thread (private) or in total (shared)
+    size_t working_set;       // Keys per thread (private) or in total (shared)
+    int compute_ratio;
+    uint64_t iterations;      // Per thread
+    mixed_keys_params_t keys; // Thread i draws with keys.seed + i
+} mixed_mt_params_t;
+
+typedef struct {
+    uint64_t ops;
+    uint64_t runtime_ns;      // This thread, barrier release to finish
+    double ops_per_sec;
+    int cpu;                  // CPU the thread finished on
+} mixed_mt_thread_t;
+
+/**
+ * @brief Default key parameters, overridden from the environment
+ *
+ * LRC_SEED=<n> (default 42), LRC_KEY_DIST=uniform | zipf[:s] |
+ * hotspot[:hot_fraction:hot_access] (default uniform, 0.99, 0.2:0.8),
+ * LRC_KEYS_INLOOP=1.
+ */
+void mixed_keys_defaults(mixed_keys_params_t *params);
+
+/**
+ * @brief Distribution name for CSV output ("uniform", "zipf", "hotspot")
+ */
+const char *mixed_keys_name(mixed_keys_t dist);
+
+/**
+ * @brief Set up a key generator for keys [0, n)
+ */
+void mixed_keygen_init(mixed_keygen_t *kg, const mixed_keys_params_t *params, uint64_t n);
+
+/**
+ * @brief Next key in [0, n); rank order, so key 0 is the hottest
+ */
+uint64_t mixed_keygen_next(mixed_keygen_t *kg);
+
+/**
+ * @brief Initialize with explicit key parameters
+ * @param working_set Number of distinct keys (capped at the slot count)
+ * @return 0 on success, -1 on allocation failure
+ */
+int mixed_workload_init_keys(mixed_workload_t *w, size_t buffer_size, size_t working_set,
+                             int compute_ratio, const mixed_keys_params_t *keys);
+
+/**
+ * @brief Initialize with mixed_keys_defaults()
+ */
+int mixed_workload_init(mixed_workload_t *w, size_t buffer_size,
+                        size_t working_set, int compute_ratio);
+
+void mixed_workload_cleanup(mixed_workload_t *w);
+
+/**
+ * @brief Read-compute-write loop over the key stream
+ * @return Sum of written values (keeps the work observable)
+ */
+uint64_t mixed_workload_run(mixed_workload_t *w, uint64_t iterations);
+
+/**
+ * @brief Run the read-compute-write loop on several pinned threads
+ * @param pool Workers (placement is the caller's, via the topology API)
+ * @param params Thread count, sharing mode, sizes and key distribution
+ * @param per_thread Filled for threads 0..params->threads-1
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ * @note Buffers are allocated and initialized in the untimed setup
+ *       phase on the worker threads; thread_pool_elapsed_ns(pool) gives
+ *       the wall time of the timed part
+ */
+int mixed_workload_mt_run(thread_pool_t *pool, const mixed_mt_params_t *params,
+                          mixed_mt_thread_t *per_thread);
+
+/**
+ * @brief Working set grows in phases steps from 1/phases to all keys
+ */
+uint64_t mixed_workload_phased(mixed_workload_t *w, uint64_t iterations, int phases);
+
+/**
+ * @brief Compute ratio alternates x4 and /4 every 1000 accesses
+ */
+uint64_t mixed_workload_bursty(mixed_workload_t *w, uint64_t iterations);
+
+#endif /* LRC_MIXED_WORKLOAD_H */
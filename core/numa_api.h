@@ -20,19 +20,30 @@ int numa_get_node_count(void);
  * @brief Get CPUs belonging to a NUMA node
  * @param node NUMA node ID (0-based)
  * @return Bitmask of CPUs (up to 64 CPUs supported)
+ * @note Use topology_domain_cpuset(TOPO_LEVEL_NODE) for larger hosts
  */
 uint64_t numa_node_to_cpus(int node);
 
 /**
  * @brief Allocate memory on specific NUMA node
  * @param size Number of bytes to allocate (will be page-aligned)
- * @param node NUMA node ID (0-based)
+ * @param node Kernel NUMA node ID (ids may be sparse)
  * @return Pointer to allocated memory, or NULL on failure
  * @note Memory must be freed with numa_free(), not free()
  * @note Falls back to malloc() on single-node systems
  */
 void* numa_alloc_on_node(size_t size, int node);
 
+/**
+ * @brief Bind an existing mapping to one NUMA node
+ * @param ptr Page-aligned start (not yet touched, or pages are migrated)
+ * @param size Bytes
+ * @param node Kernel NUMA node ID (ids may be sparse, e.g. {0, 2})
+ * @return 0 on success (always on single-node systems), -1 on error
+ *         (EINVAL if the kernel has no such node)
+ */
+int numa_bind_memory(void *ptr, size_t size, int node);
+
 /**
  * @brief Free memory allocated with numa_alloc_on_node
  * @param ptr Pointer to memory (can be NULL)
@@ -15,16 +15,22 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <dirent.h>
 #include <sys/mman.h>
 #include <sys/syscall.h>
 #include <errno.h>
 
+#include "topology.h"
+
 // NUMA constants
-#define NUMA_MAXNODES 256
+#define NUMA_MAXNODES 1024           // Kernel MAX_NUMNODES upper bound
 #define BITS_PER_LONG (sizeof(unsigned long) * 8)
+#define NODE_WORDS (NUMA_MAXNODES / BITS_PER_LONG)
 
-// Cached node count for performance
+// Cached node scan for performance; ids may be sparse (e.g. {0, 2})
 static int cached_node_count = -2;  // -2 = not initialized, -1 = error, >=0 = count
+static int cached_max_node = -1;    // Highest node id present
+static unsigned long present_nodes[NODE_WORDS];
 
 // NUMA policy modes
 #define MPOL_DEFAULT 0
@@ -38,7 +44,7 @@ static int cached_node_count = -2;  // -2 = not initialized, -1 = error, >=0 = c
 #define MPOL_MF_MOVE_ALL (1<<2)
 
 /*
- * Read NUMA topology from /sys.
+ * Read NUMA topology from /sys: every node<N> entry, not just 0..count-1.
  * Returns number of NUMA nodes, or -1 on error.
  */
 int numa_get_node_count(void) {
@@ -48,28 +54,57 @@ int numa_get_node_count(void) {
     }
     
     int count = 0;
-    char path[256];
+    DIR *dir = opendir("/sys/devices/system/node");
     
-    for (int i = 0; i < NUMA_MAXNODES; i++) {
-        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", i);
-        if (access(path, F_OK) == 0) {
+    if (dir) {
+        struct dirent *ent;
+        while ((ent = readdir(dir)) != NULL) {
+            char *end;
+            if (strncmp(ent->d_name, "node", 4) != 0 || ent->d_name[4] == '\0') continue;
+            long id = strtol(ent->d_name + 4, &end, 10);
+            if (*end != '\0' || id < 0 || id >= NUMA_MAXNODES) continue;
+            
+            present_nodes[id / BITS_PER_LONG] |= 1UL << (id % BITS_PER_LONG);
+            if (id > cached_max_node) cached_max_node = (int)id;
             count++;
-        } else {
-            break;
         }
+        closedir(dir);
     }
     
     cached_node_count = (count > 0) ? count : -1;
     return cached_node_count;
 }
 
+/*
+ * Whether the kernel has a node with this id.
+ */
+static int node_present(int node) {
+    if (numa_get_node_count() < 0 || node < 0 || node > cached_max_node) return 0;
+    return (present_nodes[node / BITS_PER_LONG] >> (node % BITS_PER_LONG)) & 1;
+}
+
+/*
+ * mbind() nodemask covering ids 0..cached_max_node. Returns the maxnode
+ * argument to pass with it (mask bits + 1, as the kernel expects).
+ */
+static unsigned long build_nodemask(unsigned long *nodemask, int node) {
+    memset(nodemask, 0, NODE_WORDS * sizeof(unsigned long));
+    if (node >= 0) {
+        nodemask[node / BITS_PER_LONG] = 1UL << (node % BITS_PER_LONG);
+    } else {
+        memcpy(nodemask, present_nodes, sizeof(present_nodes));
+    }
+    return (unsigned long)cached_max_node + 2;
+}
+
 /*
  * Get CPUs belonging to a NUMA node.
- * Returns bitmask of CPUs (simplified - only supports up to 64 CPUs).
+ * Returns bitmask of CPUs 0-63 only; use topology_domain_cpuset() on
+ * larger hosts.
  */
 uint64_t numa_node_to_cpus(int node) {
     char path[256];
-    char buffer[256];
+    char buffer[4096];
     FILE *f;
     
     snprintf(path, sizeof(path), 
@@ -84,30 +119,56 @@ uint64_t numa_node_to_cpus(int node) {
     }
     fclose(f);
     
-    // Parse CPU list (e.g., "0-3,8-11")
-    // Simplified: just return mask of first range
-    int start, end;
+    // Parse full CPU list (e.g., "0-3,8-11"), keep the first 64 CPUs
+    cpu_set_t set;
     uint64_t mask = 0;
     
-    if (sscanf(buffer, "%d-%d", &start, &end) == 2) {
-        for (int i = start; i <= end && i < 64; i++) {
+    topology_parse_cpulist(buffer, &set, sizeof(set));
+    for (int i = 0; i < 64; i++) {
+        if (CPU_ISSET(i, &set)) {
             mask |= (1ULL << i);
         }
-    } else if (sscanf(buffer, "%d", &start) == 1) {
-        if (start < 64) {
-            mask |= (1ULL << start);
-        }
     }
     
     return mask;
 }
 
 /*
- * Allocate memory on specific NUMA node.
- * Falls back to regular malloc if NUMA not available.
+ * Bind an existing mapping to one NUMA node (before it is touched).
+ * No-op on single-node systems; a node id the kernel does not have
+ * fails with EINVAL.
  *
  * Uses mbind() syscall directly to avoid libnuma dependency.
  */
+int numa_bind_memory(void *ptr, size_t size, int node) {
+    int node_count = numa_get_node_count();
+    if (node_count < 0 && node == 0) {
+        return 0;                    // Kernel without NUMA: all memory is node 0
+    }
+    
+    // Validate node number: kernel ids, possibly sparse
+    if (!node_present(node)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (node_count < 2) {
+        return 0;
+    }
+    
+    // Create nodemask with only the target node set
+    unsigned long nodemask[NODE_WORDS];
+    unsigned long maxnode = build_nodemask(nodemask, node);
+    
+    // Bind memory to the specified NUMA node
+    long ret = syscall(SYS_mbind, ptr, size, MPOL_BIND, 
+                       nodemask, maxnode, MPOL_MF_STRICT | MPOL_MF_MOVE);
+    return ret == 0 ? 0 : -1;
+}
+
+/*
+ * Allocate memory on specific NUMA node.
+ * Falls back to regular malloc if NUMA not available.
+ */
 void* numa_alloc_on_node(size_t size, int node) {
     // Check if NUMA is available
     int node_count = numa_get_node_count();
@@ -116,7 +177,8 @@ void* numa_alloc_on_node(size_t size, int node) {
     }
     
     // Validate node number
-    if (node < 0 || node >= node_count) {
+    if (!node_present(node)) {
+        errno = EINVAL;
         return NULL;
     }
     
@@ -129,16 +191,7 @@ void* numa_alloc_on_node(size_t size, int node) {
         return NULL;
     }
     
-    // Create nodemask with only the target node set
-    unsigned long nodemask[((node_count + BITS_PER_LONG - 1) / BITS_PER_LONG)];
-    memset(nodemask, 0, sizeof(nodemask));
-    nodemask[node / BITS_PER_LONG] = 1UL << (node % BITS_PER_LONG);
-    
-    // Bind memory to the specified NUMA node
-    long ret = syscall(SYS_mbind, ptr, size, MPOL_BIND, 
-                       nodemask, node_count + 1, MPOL_MF_STRICT | MPOL_MF_MOVE);
-    
-    if (ret != 0) {
+    if (numa_bind_memory(ptr, size, node) != 0) {
         // If mbind fails, still return the memory but it won't be NUMA-bound
         fprintf(stderr, "Warning: mbind() failed for node %d: %s\n", 
                 node, strerror(errno));
@@ -190,16 +243,12 @@ void* numa_alloc_interleaved(size_t size) {
     }
     
     // Create nodemask with all nodes set
-    unsigned long nodemask[((node_count + BITS_PER_LONG - 1) / BITS_PER_LONG)];
-    memset(nodemask, 0, sizeof(nodemask));
-    
-    for (int i = 0; i < node_count; i++) {
-        nodemask[i / BITS_PER_LONG] |= 1UL << (i % BITS_PER_LONG);
-    }
+    unsigned long nodemask[NODE_WORDS];
+    unsigned long maxnode = build_nodemask(nodemask, -1);
     
     // Use MPOL_INTERLEAVE to spread pages across nodes
     long ret = syscall(SYS_mbind, ptr, size, MPOL_INTERLEAVE,
-                       nodemask, node_count + 1, MPOL_MF_MOVE);
+                       nodemask, maxnode, MPOL_MF_MOVE);
     
     if (ret != 0) {
         fprintf(stderr, "Warning: mbind() interleave failed: %s\n", strerror(errno));
@@ -223,7 +272,8 @@ void numa_print_topology(void) {
     
     printf("  Nodes: %d\n", node_count);
     
-    for (int node = 0; node < node_count; node++) {
+    for (int node = 0; node <= cached_max_node; node++) {
+        if (!node_present(node)) continue;
         uint64_t cpus = numa_node_to_cpus(node);
         printf("  Node %d: CPUs ", node);
         
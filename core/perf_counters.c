@@ -19,29 +19,19 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <sys/syscall.h>
+#include <sys/mman.h>
 
-typedef struct {
-    int fd_instructions;
-    int fd_cycles;
-    int fd_l1_dcache_misses;
-    int fd_llc_misses;
-    int fd_branches;
-    int fd_branch_misses;
-    
-    uint64_t instructions_start;
-    uint64_t cycles_start;
-    uint64_t l1_misses_start;
-    uint64_t llc_misses_start;
-    uint64_t branches_start;
-    uint64_t branch_misses_start;
-    
-    uint64_t instructions;
-    uint64_t cycles;
-    uint64_t l1_dcache_misses;
-    uint64_t llc_misses;
-    uint64_t branches;
-    uint64_t branch_misses;
-} perf_counters_t;
+#include "perf_counters.h"
+
+/*
+ * Group read layout with PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED |
+ * TOTAL_TIME_RUNNING (no PERF_FORMAT_ID):
+ *   { nr, time_enabled, time_running, values[nr] }
+ */
+#define GROUP_READ_FORMAT (PERF_FORMAT_GROUP | \
+                           PERF_FORMAT_TOTAL_TIME_ENABLED | \
+                           PERF_FORMAT_TOTAL_TIME_RUNNING)
+#define GROUP_HEADER_WORDS 3
 
 /*
  * Wrapper for perf_event_open syscall.
@@ -53,22 +43,73 @@ static long perf_event_open(struct perf_event_attr *hw_event, pid_t pid,
 
 /*
  * Open a single performance counter.
+ * group_fd = -1 opens a standalone event (or a group leader).
  */
-static int open_counter(uint32_t type, uint64_t config) {
+static int open_counter_ex(uint32_t type, uint64_t config,
+                           int group_fd, uint64_t read_format) {
     struct perf_event_attr pe;
     memset(&pe, 0, sizeof(struct perf_event_attr));
     
     pe.type = type;
     pe.size = sizeof(struct perf_event_attr);
     pe.config = config;
-    pe.disabled = 1;
+    pe.disabled = (group_fd == -1);  // Members follow the leader
     pe.exclude_kernel = 0;  // Include kernel (we want full picture)
     pe.exclude_hv = 1;      // Exclude hypervisor
+    pe.read_format = read_format;
     
-    int fd = perf_event_open(&pe, 0, -1, -1, 0);
+    int fd = perf_event_open(&pe, 0, -1, group_fd, 0);
     return fd;
 }
 
+static int open_counter(uint32_t type, uint64_t config) {
+    return open_counter_ex(type, config, -1, 0);
+}
+
+/*
+ * Event definitions in perf_counter_id_t order.
+ */
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_events[PERF_COUNTER_COUNT] = {
+    [PERF_COUNTER_INSTRUCTIONS]    = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [PERF_COUNTER_CYCLES]          = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [PERF_COUNTER_L1_DCACHE_MISSES] = {PERF_TYPE_HW_CACHE,
+        (PERF_COUNT_HW_CACHE_L1D) | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    [PERF_COUNTER_LLC_MISSES]      = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    [PERF_COUNTER_BRANCHES]        = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    [PERF_COUNTER_BRANCH_MISSES]   = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+/*
+ * Map counter id to the struct's fd and value fields.
+ */
+static int *counter_fd(perf_counters_t *pc, perf_counter_id_t id) {
+    switch (id) {
+        case PERF_COUNTER_INSTRUCTIONS: return &pc->fd_instructions;
+        case PERF_COUNTER_CYCLES: return &pc->fd_cycles;
+        case PERF_COUNTER_L1_DCACHE_MISSES: return &pc->fd_l1_dcache_misses;
+        case PERF_COUNTER_LLC_MISSES: return &pc->fd_llc_misses;
+        case PERF_COUNTER_BRANCHES: return &pc->fd_branches;
+        case PERF_COUNTER_BRANCH_MISSES: return &pc->fd_branch_misses;
+        default: return NULL;
+    }
+}
+
+static uint64_t *counter_value(perf_counters_t *pc, perf_counter_id_t id) {
+    switch (id) {
+        case PERF_COUNTER_INSTRUCTIONS: return &pc->instructions;
+        case PERF_COUNTER_CYCLES: return &pc->cycles;
+        case PERF_COUNTER_L1_DCACHE_MISSES: return &pc->l1_dcache_misses;
+        case PERF_COUNTER_LLC_MISSES: return &pc->llc_misses;
+        case PERF_COUNTER_BRANCHES: return &pc->branches;
+        case PERF_COUNTER_BRANCH_MISSES: return &pc->branch_misses;
+        default: return NULL;
+    }
+}
+
 /*
  * Initialize performance counters.
  * Returns 0 on success, -1 if perf not available.
@@ -94,10 +135,107 @@ int perf_counters_init(perf_counters_t *pc) {
     return 0;
 }
 
+/*
+ * Initialize performance counters as a single event group.
+ * Instructions is the leader; members that fail to open are skipped
+ * (their value stays 0), but the leader and cycles are required.
+ * Returns 0 on success, -1 if perf not available.
+ */
+int perf_counters_init_group(perf_counters_t *pc) {
+    memset(pc, 0, sizeof(perf_counters_t));
+    
+    pc->grouped = 1;
+    int leader = -1;
+    
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+        int fd = open_counter_ex(counter_events[id].type, counter_events[id].config,
+                                 leader, GROUP_READ_FORMAT);
+        *counter_fd(pc, id) = fd;
+        pc->group_index[id] = -1;
+        
+        if (fd < 0) continue;
+        if (leader == -1) leader = fd;
+        pc->group_index[id] = pc->group_size++;
+    }
+    
+    if (pc->fd_instructions < 0 || pc->fd_cycles < 0) {
+        perf_counters_close(pc);
+        pc->fd_instructions = -1;
+        return -1;
+    }
+    
+    ioctl(pc->fd_instructions, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    return 0;
+}
+
+/*
+ * Read cumulative group values with one read().
+ * buf must hold GROUP_HEADER_WORDS + PERF_COUNTER_COUNT words.
+ */
+static int read_group(const perf_counters_t *pc, uint64_t *buf) {
+    size_t len = (GROUP_HEADER_WORDS + pc->group_size) * sizeof(uint64_t);
+    ssize_t ret = read(pc->fd_instructions, buf, len);
+    return (ret == (ssize_t)len && buf[0] == (uint64_t)pc->group_size) ? 0 : -1;
+}
+
+/*
+ * Stop group and compute per-interval deltas, scaled for multiplexing.
+ * Counts are never reset: each interval is the difference from the
+ * previous cumulative read, so start needs no read and no RESET.
+ */
+static void group_stop(perf_counters_t *pc) {
+    uint64_t buf[GROUP_HEADER_WORDS + PERF_COUNTER_COUNT];
+    
+    ioctl(pc->fd_instructions, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    
+    if (read_group(pc, buf) != 0) {
+        for (int id = 0; id < PERF_COUNTER_COUNT; id++) *counter_value(pc, id) = 0;
+        pc->time_enabled = 0;
+        pc->time_running = 0;
+        return;
+    }
+    
+    pc->time_enabled = buf[1] - pc->group_prev[0];
+    pc->time_running = buf[2] - pc->group_prev[1];
+    pc->group_prev[0] = buf[1];
+    pc->group_prev[1] = buf[2];
+    
+    double scale = 0.0;
+    if (pc->time_running > 0) {
+        scale = (double)pc->time_enabled / pc->time_running;
+    }
+    
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+        int slot = pc->group_index[id];
+        uint64_t *value = counter_value(pc, id);
+        
+        if (slot < 0) {
+            *value = 0;
+            continue;
+        }
+        
+        uint64_t raw = buf[GROUP_HEADER_WORDS + slot];
+        uint64_t delta = raw - pc->group_prev[2 + slot];
+        pc->group_prev[2 + slot] = raw;
+        
+        *value = (scale == 1.0) ? delta : (uint64_t)(delta * scale + 0.5);
+    }
+}
+
+double perf_counters_running_ratio(const perf_counters_t *pc) {
+    if (!pc->grouped || pc->time_enabled == 0) return 0.0;
+    return (double)pc->time_running / pc->time_enabled;
+}
+
 /*
  * Start counting (call before workload).
  */
 void perf_counters_start(perf_counters_t *pc) {
+    if (pc->grouped) {
+        ioctl(pc->fd_instructions, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return;
+    }
+    
     // Reset and enable all counters
     if (pc->fd_instructions >= 0) {
         ioctl(pc->fd_instructions, PERF_EVENT_IOC_RESET, 0);
@@ -131,6 +269,11 @@ void perf_counters_start(perf_counters_t *pc) {
 void perf_counters_stop(perf_counters_t *pc) {
     ssize_t ret;
     
+    if (pc->grouped) {
+        group_stop(pc);
+        return;
+    }
+    
     // Disable and read all counters
     if (pc->fd_instructions >= 0) {
         ioctl(pc->fd_instructions, PERF_EVENT_IOC_DISABLE, 0);
@@ -168,6 +311,14 @@ void perf_counters_stop(perf_counters_t *pc) {
  * Close all counter file descriptors.
  */
 void perf_counters_close(perf_counters_t *pc) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+        if (pc->mmap_page[id]) {
+            munmap(pc->mmap_page[id], page_size);
+            pc->mmap_page[id] = NULL;
+        }
+    }
+    
     if (pc->fd_instructions >= 0) close(pc->fd_instructions);
     if (pc->fd_cycles >= 0) close(pc->fd_cycles);
     if (pc->fd_l1_dcache_misses >= 0) close(pc->fd_l1_dcache_misses);
@@ -176,6 +327,102 @@ void perf_counters_close(perf_counters_t *pc) {
     if (pc->fd_branch_misses >= 0) close(pc->fd_branch_misses);
 }
 
+/*
+ * Map each counter's perf_event_mmap_page for user-space reads.
+ *
+ * Justification for mmap:
+ *   The kernel publishes the hardware counter index and offset in this
+ *   page; with cap_user_rdpmc set, rdpmc reads the PMC with no syscall.
+ */
+int perf_counters_rdpmc_enable(perf_counters_t *pc) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    int mapped = 0;
+    
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+        int fd = *counter_fd(pc, id);
+        if (fd < 0 || pc->mmap_page[id]) continue;
+        
+        void *page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (page == MAP_FAILED) continue;
+        
+        struct perf_event_mmap_page *mp = page;
+        if (!mp->cap_user_rdpmc) {
+            munmap(page, page_size);
+            continue;
+        }
+        
+        pc->mmap_page[id] = page;
+        mapped++;
+    }
+    
+    return mapped;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t rdpmc(uint32_t counter) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+    return ((uint64_t)hi << 32) | lo;
+}
+#endif
+
+/*
+ * Fallback: read one counter's cumulative count via read().
+ */
+static uint64_t read_counter_syscall(const perf_counters_t *pc, perf_counter_id_t id) {
+    perf_counters_t *mpc = (perf_counters_t *)pc;
+    int fd = *counter_fd(mpc, id);
+    if (fd < 0) return 0;
+    
+    if (pc->grouped) {
+        uint64_t buf[GROUP_HEADER_WORDS + PERF_COUNTER_COUNT];
+        if (pc->group_index[id] < 0 || read_group(pc, buf) != 0) return 0;
+        return buf[GROUP_HEADER_WORDS + pc->group_index[id]];
+    }
+    
+    uint64_t value;
+    if (read(fd, &value, sizeof(value)) != sizeof(value)) return 0;
+    return value;
+}
+
+/*
+ * Seqlock read of the mmap page (see perf_event_open(2)).
+ * Follows the kernel's documented self-monitoring sequence.
+ */
+uint64_t perf_counters_rdpmc(const perf_counters_t *pc, perf_counter_id_t id) {
+    if (id < 0 || id >= PERF_COUNTER_COUNT) return 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+    volatile struct perf_event_mmap_page *mp = pc->mmap_page[id];
+    if (mp) {
+        uint32_t seq, idx;
+        uint64_t count;
+        
+        do {
+            seq = mp->lock;
+            __asm__ __volatile__("" ::: "memory");
+            
+            idx = mp->index;
+            count = mp->offset;
+            if (mp->cap_user_rdpmc && idx) {
+                uint16_t width = mp->pmc_width;
+                int64_t pmc = rdpmc(idx - 1);
+                // Sign-extend the width-bit hardware counter
+                pmc <<= 64 - width;
+                pmc >>= 64 - width;
+                count += pmc;
+            }
+            
+            __asm__ __volatile__("" ::: "memory");
+        } while (mp->lock != seq);
+        
+        return count;
+    }
+#endif
+    
+    return read_counter_syscall(pc, id);
+}
+
 /*
  * Print CSV header for perf counters.
  */
@@ -202,3 +449,411 @@ void perf_counters_print_csv(FILE *out, const perf_counters_t *pc) {
             pc->branch_misses,
             branch_miss_rate);
 }
+
+/*
+ * ---------------------------------------------------------------------
+ * Configurable event lists
+ * ---------------------------------------------------------------------
+ */
+
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} named_events[] = {
+    {"instructions",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cycles",                  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"cpu-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"ref-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+    {"bus-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES},
+    {"branches",                PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"cache-references",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {"stalled-cycles-backend",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {"task-clock",              PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page-faults",             PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"minor-faults",            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN},
+    {"major-faults",            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ},
+    {"context-switches",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"cpu-migrations",          PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+};
+
+static const struct {
+    const char *prefix;
+    uint64_t id;
+} cache_names[] = {
+    {"L1-dcache", PERF_COUNT_HW_CACHE_L1D},
+    {"L1-icache", PERF_COUNT_HW_CACHE_L1I},
+    {"LLC",       PERF_COUNT_HW_CACHE_LL},
+    {"dTLB",      PERF_COUNT_HW_CACHE_DTLB},
+    {"iTLB",      PERF_COUNT_HW_CACHE_ITLB},
+    {"branch",    PERF_COUNT_HW_CACHE_BPU},
+    {"node",      PERF_COUNT_HW_CACHE_NODE},
+};
+
+static const struct {
+    const char *name;      // plural form; singular is used with -misses
+    const char *singular;
+    uint64_t id;
+} cache_ops[] = {
+    {"loads",      "load",     PERF_COUNT_HW_CACHE_OP_READ},
+    {"stores",     "store",    PERF_COUNT_HW_CACHE_OP_WRITE},
+    {"prefetches", "prefetch", PERF_COUNT_HW_CACHE_OP_PREFETCH},
+};
+
+/*
+ * Parse "<cache>-<op>s" or "<cache>-<op>-misses".
+ */
+static int parse_cache_event(const char *name, uint64_t *config) {
+    for (size_t c = 0; c < sizeof(cache_names) / sizeof(cache_names[0]); c++) {
+        size_t plen = strlen(cache_names[c].prefix);
+        if (strncmp(name, cache_names[c].prefix, plen) != 0 || name[plen] != '-') {
+            continue;
+        }
+        
+        const char *rest = name + plen + 1;
+        for (size_t o = 0; o < sizeof(cache_ops) / sizeof(cache_ops[0]); o++) {
+            char misses[32];
+            snprintf(misses, sizeof(misses), "%s-misses", cache_ops[o].singular);
+            
+            uint64_t result;
+            if (strcmp(rest, cache_ops[o].name) == 0) {
+                result = PERF_COUNT_HW_CACHE_RESULT_ACCESS;
+            } else if (strcmp(rest, misses) == 0) {
+                result = PERF_COUNT_HW_CACHE_RESULT_MISS;
+            } else {
+                continue;
+            }
+            
+            *config = cache_names[c].id | (cache_ops[o].id << 8) | (result << 16);
+            return 0;
+        }
+    }
+    
+    return -1;
+}
+
+/*
+ * Resolve one event name to perf type/config.
+ */
+static int parse_event(const char *name, uint32_t *type, uint64_t *config) {
+    for (size_t i = 0; i < sizeof(named_events) / sizeof(named_events[0]); i++) {
+        if (strcmp(name, named_events[i].name) == 0) {
+            *type = named_events[i].type;
+            *config = named_events[i].config;
+            return 0;
+        }
+    }
+    
+    if (parse_cache_event(name, config) == 0) {
+        *type = PERF_TYPE_HW_CACHE;
+        return 0;
+    }
+    
+    // Raw PMU code: r<hex>
+    if (name[0] == 'r' && name[1] != '\0') {
+        char *end;
+        uint64_t raw = strtoull(name + 1, &end, 16);
+        if (*end == '\0') {
+            *type = PERF_TYPE_RAW;
+            *config = raw;
+            return 0;
+        }
+    }
+    
+    return -1;
+}
+
+/*
+ * Column name: label if given, otherwise event name with non-alnum -> '_'.
+ */
+static void column_name(char *dst, size_t len, const char *src) {
+    size_t i;
+    for (i = 0; i + 1 < len && src[i]; i++) {
+        char c = src[i];
+        int alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9');
+        dst[i] = alnum ? c : '_';
+    }
+    dst[i] = '\0';
+}
+
+const char *perf_event_list_spec(const char *default_spec) {
+    const char *env = getenv("LRC_PERF_EVENTS");
+    return (env && *env) ? env : default_spec;
+}
+
+static int list_append(perf_event_list_t *list, const char *label,
+                       uint32_t type, uint64_t config) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 8;
+        perf_event_t *events = realloc(list->events, capacity * sizeof(perf_event_t));
+        if (!events) return -1;
+        list->events = events;
+        list->capacity = capacity;
+    }
+    
+    perf_event_t *ev = &list->events[list->count++];
+    memset(ev, 0, sizeof(perf_event_t));
+    column_name(ev->name, sizeof(ev->name), label);
+    ev->type = type;
+    ev->config = config;
+    ev->fd = -1;
+    ev->slot = -1;
+    return 0;
+}
+
+int perf_event_list_parse(perf_event_list_t *list, const char *spec) {
+    memset(list, 0, sizeof(perf_event_list_t));
+    list->leader_fd = -1;
+    
+    char *copy = strdup(spec ? spec : "");
+    if (!copy) return -1;
+    
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        while (*tok == ' ') tok++;
+        if (*tok == '\0') continue;
+        
+        const char *label = tok;
+        char *event = tok;
+        char *eq = strchr(tok, '=');
+        if (eq) {
+            *eq = '\0';
+            event = eq + 1;
+        }
+        
+        uint32_t type;
+        uint64_t config;
+        if (parse_event(event, &type, &config) != 0 ||
+            list_append(list, label, type, config) != 0) {
+            fprintf(stderr, "Warning: unknown perf event '%s'\n", event);
+            free(copy);
+            perf_event_list_close(list);
+            return -1;
+        }
+    }
+    
+    free(copy);
+    return list->count;
+}
+
+int perf_event_list_open(perf_event_list_t *list, int grouped) {
+    uint64_t read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    if (grouped) read_format |= PERF_FORMAT_GROUP;
+    
+    list->grouped = grouped;
+    list->leader_fd = -1;
+    list->group_size = 0;
+    int opened = 0;
+    
+    for (int i = 0; i < list->count; i++) {
+        perf_event_t *ev = &list->events[i];
+        ev->fd = open_counter_ex(ev->type, ev->config,
+                                 grouped ? list->leader_fd : -1, read_format);
+        if (ev->fd < 0) continue;
+        
+        if (grouped) {
+            if (list->leader_fd == -1) list->leader_fd = ev->fd;
+            ev->slot = list->group_size++;
+        }
+        opened++;
+    }
+    
+    if (grouped && list->group_size > 0) {
+        list->read_buf = calloc(GROUP_HEADER_WORDS + list->group_size, sizeof(uint64_t));
+        if (!list->read_buf) return 0;
+        ioctl(list->leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+    
+    return opened;
+}
+
+void perf_event_list_start(perf_event_list_t *list) {
+    if (list->grouped) {
+        if (list->leader_fd >= 0) {
+            ioctl(list->leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        return;
+    }
+    
+    for (int i = 0; i < list->count; i++) {
+        if (list->events[i].fd >= 0) {
+            ioctl(list->events[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+static uint64_t scale_delta(uint64_t delta, uint64_t enabled, uint64_t running) {
+    if (running == 0) return 0;
+    if (running == enabled) return delta;
+    return (uint64_t)((double)delta * enabled / running + 0.5);
+}
+
+static void list_stop_grouped(perf_event_list_t *list) {
+    size_t len = (GROUP_HEADER_WORDS + list->group_size) * sizeof(uint64_t);
+    uint64_t *buf = list->read_buf;
+    
+    ioctl(list->leader_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    
+    if (read(list->leader_fd, buf, len) != (ssize_t)len) {
+        for (int i = 0; i < list->count; i++) list->events[i].value = 0;
+        list->time_enabled = 0;
+        list->time_running = 0;
+        return;
+    }
+    
+    list->time_enabled = buf[1] - list->prev_enabled;
+    list->time_running = buf[2] - list->prev_running;
+    list->prev_enabled = buf[1];
+    list->prev_running = buf[2];
+    
+    for (int i = 0; i < list->count; i++) {
+        perf_event_t *ev = &list->events[i];
+        if (ev->slot < 0) {
+            ev->value = 0;
+            continue;
+        }
+        
+        uint64_t raw = buf[GROUP_HEADER_WORDS + ev->slot];
+        ev->value = scale_delta(raw - ev->prev, list->time_enabled, list->time_running);
+        ev->prev = raw;
+    }
+}
+
+/*
+ * Independent events: each is scaled by its own enabled/running time.
+ * The list-level times are taken from the worst-scheduled event.
+ */
+static void list_stop_independent(perf_event_list_t *list) {
+    double worst = 2.0;
+    list->time_enabled = 0;
+    list->time_running = 0;
+    
+    for (int i = 0; i < list->count; i++) {
+        perf_event_t *ev = &list->events[i];
+        ev->value = 0;
+        if (ev->fd < 0) continue;
+        
+        uint64_t buf[3];
+        ioctl(ev->fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(ev->fd, buf, sizeof(buf)) != sizeof(buf)) continue;
+        
+        uint64_t enabled = buf[1] - ev->prev_enabled;
+        uint64_t running = buf[2] - ev->prev_running;
+        ev->value = scale_delta(buf[0] - ev->prev, enabled, running);
+        ev->prev = buf[0];
+        ev->prev_enabled = buf[1];
+        ev->prev_running = buf[2];
+        
+        double ratio = enabled ? (double)running / enabled : 0.0;
+        if (ratio < worst) {
+            worst = ratio;
+            list->time_enabled = enabled;
+            list->time_running = running;
+        }
+    }
+}
+
+void perf_event_list_stop(perf_event_list_t *list) {
+    if (list->grouped) {
+        if (list->leader_fd >= 0) list_stop_grouped(list);
+        return;
+    }
+    
+    list_stop_independent(list);
+}
+
+void perf_event_list_close(perf_event_list_t *list) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->events[i].fd >= 0) close(list->events[i].fd);
+    }
+    
+    free(list->events);
+    free(list->read_buf);
+    memset(list, 0, sizeof(perf_event_list_t));
+    list->leader_fd = -1;
+}
+
+int perf_event_list_read(const perf_event_list_t *list, uint64_t *values,
+                         uint64_t *enabled, uint64_t *running) {
+    *enabled = 0;
+    *running = 0;
+    for (int i = 0; i < list->count; i++) values[i] = 0;
+    
+    if (list->grouped) {
+        if (list->leader_fd < 0) return -1;
+        
+        uint64_t buf[GROUP_HEADER_WORDS + list->group_size];
+        ssize_t len = sizeof(buf);
+        if (read(list->leader_fd, buf, len) != len) return -1;
+        
+        *enabled = buf[1];
+        *running = buf[2];
+        for (int i = 0; i < list->count; i++) {
+            int slot = list->events[i].slot;
+            if (slot >= 0) values[i] = buf[GROUP_HEADER_WORDS + slot];
+        }
+        return 0;
+    }
+    
+    for (int i = 0; i < list->count; i++) {
+        uint64_t buf[3];
+        if (list->events[i].fd < 0) continue;
+        if (read(list->events[i].fd, buf, sizeof(buf)) != sizeof(buf)) return -1;
+        
+        values[i] = buf[0];
+        if (*enabled == 0) {
+            *enabled = buf[1];
+            *running = buf[2];
+        }
+    }
+    return 0;
+}
+
+int perf_event_list_from_env(perf_event_list_t *list, const char *default_spec, int grouped) {
+    const char *spec = perf_event_list_spec(default_spec);
+    
+    if (perf_event_list_parse(list, spec) < 0) {
+        fprintf(stderr, "Warning: LRC_PERF_EVENTS rejected, using %s\n", default_spec);
+        perf_event_list_parse(list, default_spec);
+    }
+    
+    int opened = perf_event_list_open(list, grouped);
+    if (opened == 0 && list->count > 0) {
+        fprintf(stderr, "Warning: perf counters not available, counter columns will be 0\n");
+    }
+    return opened;
+}
+
+int perf_event_list_find(const perf_event_list_t *list, const char *name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->events[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+uint64_t perf_event_list_value(const perf_event_list_t *list, const char *name) {
+    int i = perf_event_list_find(list, name);
+    return i >= 0 ? list->events[i].value : 0;
+}
+
+void perf_event_list_print_csv_header(FILE *out, const perf_event_list_t *list) {
+    for (int i = 0; i < list->count; i++) {
+        fprintf(out, "%s,", list->events[i].name);
+    }
+    fprintf(out, "perf_running_ratio");
+}
+
+void perf_event_list_print_csv(FILE *out, const perf_event_list_t *list) {
+    for (int i = 0; i < list->count; i++) {
+        fprintf(out, "%lu,", list->events[i].value);
+    }
+    
+    double ratio = list->time_enabled ?
+        (double)list->time_running / list->time_enabled : 0.0;
+    fprintf(out, "%.3f", ratio);
+}
@@ -4,6 +4,17 @@
 #include <stdint.h>
 #include <stdio.h>
 
+/* Counter identifiers, in group read order */
+typedef enum {
+    PERF_COUNTER_INSTRUCTIONS = 0,
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_L1_DCACHE_MISSES,
+    PERF_COUNTER_LLC_MISSES,
+    PERF_COUNTER_BRANCHES,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+} perf_counter_id_t;
+
 typedef struct {
     int fd_instructions;
     int fd_cycles;
@@ -11,20 +22,31 @@ typedef struct {
     int fd_llc_misses;
     int fd_branches;
     int fd_branch_misses;
-    
+
     uint64_t instructions_start;
     uint64_t cycles_start;
     uint64_t l1_misses_start;
     uint64_t llc_misses_start;
     uint64_t branches_start;
     uint64_t branch_misses_start;
-    
+
     uint64_t instructions;
     uint64_t cycles;
     uint64_t l1_dcache_misses;
     uint64_t llc_misses;
     uint64_t branches;
     uint64_t branch_misses;
+
+    /* Group mode (perf_counters_init_group) */
+    int grouped;                                // 1 if events share one leader
+    int group_size;                             // events in the group read
+    int group_index[PERF_COUNTER_COUNT];        // slot in group read, -1 if absent
+    uint64_t group_prev[2 + PERF_COUNTER_COUNT]; // cumulative enabled, running, values
+    uint64_t time_enabled;                      // ns enabled during last interval
+    uint64_t time_running;                      // ns on the PMU during last interval
+
+    /* rdpmc fast path (perf_counters_rdpmc_enable) */
+    void *mmap_page[PERF_COUNTER_COUNT];
 } perf_counters_t;
 
 int perf_counters_init(perf_counters_t *pc);
@@ -34,4 +56,134 @@ void perf_counters_close(perf_counters_t *pc);
 void perf_counters_print_csv_header(FILE *out);
 void perf_counters_print_csv(FILE *out, const perf_counters_t *pc);
 
+/*
+ * Open all six counters as one group led by instructions.
+ * Start/stop is one ioctl each; stop reads the whole group with one read().
+ * Values are scaled by time_enabled/time_running when multiplexed.
+ * Returns 0 on success, -1 if the group could not be opened.
+ */
+int perf_counters_init_group(perf_counters_t *pc);
+
+/*
+ * Fraction of the last interval the group was on the PMU (1.0 = never
+ * multiplexed, 0.0 = never scheduled or not in group mode).
+ */
+double perf_counters_running_ratio(const perf_counters_t *pc);
+
+/*
+ * Map the counter pages so perf_counters_rdpmc() can read counts from
+ * user space without a syscall. Returns number of counters mapped with
+ * rdpmc capability, 0 if the fast path is unavailable.
+ */
+int perf_counters_rdpmc_enable(perf_counters_t *pc);
+
+/*
+ * Read the cumulative raw count of one counter while enabled.
+ * Uses rdpmc when mapped, otherwise falls back to read().
+ * Intended for in-loop sampling: take deltas between two calls.
+ */
+uint64_t perf_counters_rdpmc(const perf_counters_t *pc, perf_counter_id_t id);
+
+/*
+ * Configurable event lists.
+ *
+ * Spec is a comma-separated list of perf-style event names:
+ *   generic:   instructions, cycles, branches, branch-misses,
+ *              cache-references, cache-misses, ref-cycles,
+ *              stalled-cycles-frontend, stalled-cycles-backend
+ *   hw cache:  <cache>-<op>[-misses] with cache in L1-dcache, L1-icache,
+ *              LLC, dTLB, iTLB, branch, node and op in loads, stores,
+ *              prefetches (e.g. dTLB-load-misses, node-loads)
+ *   software:  page-faults, minor-faults, major-faults,
+ *              context-switches, cpu-migrations, task-clock
+ *   raw:       rXXXX (hex config, e.g. r01d1)
+ * Any entry may be labelled as label=event (e.g. walks=r0e08); the label
+ * is used as the CSV column name.
+ */
+#define PERF_EVENT_NAME_MAX 64
+
+typedef struct {
+    char name[PERF_EVENT_NAME_MAX];  // CSV column name
+    uint32_t type;
+    uint64_t config;
+    int fd;                          // -1 if not supported on this host
+    int slot;                        // index in group read, -1 if absent
+    uint64_t prev;                   // cumulative raw count at last stop
+    uint64_t prev_enabled;           // per-event times (ungrouped mode)
+    uint64_t prev_running;
+    uint64_t value;                  // scaled delta for last interval
+} perf_event_t;
+
+typedef struct {
+    perf_event_t *events;
+    int count;
+    int capacity;
+    int grouped;                     // 1 = one group, 0 = independent events
+    int leader_fd;
+    int group_size;
+    uint64_t prev_enabled;
+    uint64_t prev_running;
+    uint64_t time_enabled;           // ns enabled during last interval
+    uint64_t time_running;           // ns on the PMU during last interval
+    uint64_t *read_buf;
+} perf_event_list_t;
+
+/*
+ * Return $LRC_PERF_EVENTS if set, otherwise default_spec.
+ */
+const char *perf_event_list_spec(const char *default_spec);
+
+/*
+ * Parse spec into list (list is initialized here).
+ * Returns number of events, or -1 on an unknown name (list left empty).
+ */
+int perf_event_list_parse(perf_event_list_t *list, const char *spec);
+
+/*
+ * Open parsed events. grouped=1 schedules them as one group (all or
+ * nothing); grouped=0 opens them independently, each scaled on its own.
+ * Unsupported events are skipped and report 0.
+ * Returns number of events opened.
+ */
+int perf_event_list_open(perf_event_list_t *list, int grouped);
+
+/*
+ * Scenario setup in one call: parse $LRC_PERF_EVENTS, falling back to
+ * default_spec when it is unset or names an unknown event, then open.
+ * Prints a warning when nothing could be opened (columns report 0).
+ * Returns number of events opened.
+ */
+int perf_event_list_from_env(perf_event_list_t *list, const char *default_spec, int grouped);
+
+void perf_event_list_start(perf_event_list_t *list);
+void perf_event_list_stop(perf_event_list_t *list);
+void perf_event_list_close(perf_event_list_t *list);
+
+/*
+ * Read cumulative raw counts while running (no stop, no scaling).
+ * values[i] corresponds to list->events[i]; absent events read 0.
+ * Safe to call from another thread than the one being measured.
+ * Returns 0 on success, -1 on read failure.
+ */
+int perf_event_list_read(const perf_event_list_t *list, uint64_t *values,
+                         uint64_t *enabled, uint64_t *running);
+
+/*
+ * Index of the event with this column name, -1 if absent.
+ */
+int perf_event_list_find(const perf_event_list_t *list, const char *name);
+
+/*
+ * Last-interval value by column name, 0 if absent.
+ */
+uint64_t perf_event_list_value(const perf_event_list_t *list, const char *name);
+
+/*
+ * CSV columns: one per parsed event (opened or not), then
+ * perf_running_ratio. Neither ends the line, so the columns can sit
+ * before other fields (e.g. metrics_print_csv, which does).
+ */
+void perf_event_list_print_csv_header(FILE *out, const perf_event_list_t *list);
+void perf_event_list_print_csv(FILE *out, const perf_event_list_t *list);
+
 #endif
@@ -0,0 +1,522 @@
+/*
+ * queues.c - Bounded cross-thread queues and a handoff benchmark
+ *
+ * Purpose:
+ *   Inter-thread handoff is the hot path of pipelined services, and its
+ *   cost depends as much on the queue's synchronization as on where the
+ *   two threads run. This module implements the common designs behind
+ *   one interface so a scenario can sweep them against placement,
+ *   thread counts and batch size.
+ *
+ * Design:
+ *   - Producer and consumer indices (spsc) and enqueue/dequeue positions
+ *     (mpmc) live on separate cache lines, so the only shared-line
+ *     traffic is the data itself plus the index the other side rereads
+ *   - spsc publishes a whole batch with one release store of the tail;
+ *     mpmc claims one slot per CAS; mutex moves a batch under one lock
+ *     and signals once
+ *   - futex/eventfd: consumers spin NOTIFY_SPINS times, then announce
+ *     themselves in `waiters` and sleep; a producer wakes only when it
+ *     sees a waiter after a full fence, so the uncontended path has no
+ *     syscall. Producers never sleep on a full ring, they spin and yield,
+ *     but first wake sleepers for the items they already pushed: a
+ *     consumer may have gone to sleep on a slot claimed but not yet
+ *     published, and nobody else would wake it
+ *   - Spin loops yield after SPINS_BEFORE_YIELD pauses so oversubscribed
+ *     runs finish (their numbers are then scheduler numbers)
+ *   - Every item carries its producer's tsc_now() stamp; consumers read
+ *     the clock once per pop and record each item's age in a per-thread
+ *     histogram, merged into the result
+ *   - The last producer to finish pushes one QUEUE_ITEM_STOP per
+ *     consumer; a consumer that pops more than one puts the rest back
+ *
+ * Justification for syscalls:
+ *   futex(FUTEX_WAIT/FUTEX_WAKE) and eventfd read/write in the notified
+ *   variants, pthread condvars (futex underneath) in the mutex queue,
+ *   sched_yield() in saturated spin loops: these are what is measured.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "queues.h"
+#include "tsc.h"
+
+#define CACHE_LINE 64
+#define SPINS_BEFORE_YIELD 1024
+#define NOTIFY_SPINS 256             // futex/eventfd: empty polls before sleeping
+
+typedef struct {
+    volatile size_t seq;
+    uint64_t value;
+} mpmc_cell_t;
+
+struct queue {
+    queue_type_t type;
+    size_t mask;
+    uint64_t *slots;                 // spsc, mutex
+    mpmc_cell_t *cells;              // mpmc, futex, eventfd
+    
+    // spsc: each side's own index plus its cached copy of the other's
+    volatile size_t tail __attribute__((aligned(CACHE_LINE)));
+    size_t head_cache;
+    volatile size_t head __attribute__((aligned(CACHE_LINE)));
+    size_t tail_cache;
+    
+    // mpmc positions
+    size_t enqueue_pos __attribute__((aligned(CACHE_LINE)));
+    size_t dequeue_pos __attribute__((aligned(CACHE_LINE)));
+    
+    // Notification (futex, eventfd)
+    uint32_t futex_word __attribute__((aligned(CACHE_LINE)));
+    int waiters;
+    int efd;
+    uint64_t sleeps __attribute__((aligned(CACHE_LINE)));
+    
+    // mutex queue
+    pthread_mutex_t lock __attribute__((aligned(CACHE_LINE)));
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    size_t count;
+    size_t read_pos;
+};
+
+static const char *queue_names[QUEUE_TYPE_COUNT] = {
+    "spsc", "mpmc", "mutex", "futex", "eventfd"
+};
+
+const char *queue_type_name(queue_type_t type) {
+    if ((int)type < 0 || type >= QUEUE_TYPE_COUNT) return "unknown";
+    return queue_names[type];
+}
+
+int queue_type_multi(queue_type_t type) {
+    return type != QUEUE_SPSC;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static inline void spin_wait(uint64_t *spins) {
+    cpu_relax();
+    if (++*spins % SPINS_BEFORE_YIELD == 0) sched_yield();
+}
+
+queue_t *queue_create(queue_type_t type, size_t capacity) {
+    if ((int)type < 0 || type >= QUEUE_TYPE_COUNT) {
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t cap = 2;
+    while (cap < capacity) cap <<= 1;
+    
+    queue_t *q = aligned_alloc(CACHE_LINE, sizeof(queue_t));
+    if (!q) return NULL;
+    memset(q, 0, sizeof(*q));
+    q->type = type;
+    q->mask = cap - 1;
+    q->efd = -1;
+    
+    if (type == QUEUE_SPSC || type == QUEUE_MUTEX) {
+        q->slots = aligned_alloc(CACHE_LINE, cap * sizeof(uint64_t));
+        if (!q->slots) goto fail;
+    } else {
+        q->cells = aligned_alloc(CACHE_LINE, cap * sizeof(mpmc_cell_t));
+        if (!q->cells) goto fail;
+        for (size_t i = 0; i < cap; i++) q->cells[i].seq = i;
+    }
+    if (type == QUEUE_EVENTFD) {
+        q->efd = eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
+        if (q->efd < 0) goto fail;
+    }
+    if (type == QUEUE_MUTEX) {
+        pthread_mutex_init(&q->lock, NULL);
+        pthread_cond_init(&q->not_empty, NULL);
+        pthread_cond_init(&q->not_full, NULL);
+    }
+    return q;
+
+fail:
+    queue_destroy(q);
+    return NULL;
+}
+
+void queue_destroy(queue_t *q) {
+    if (!q) return;
+    int saved = errno;
+    if (q->type == QUEUE_MUTEX) {
+        pthread_mutex_destroy(&q->lock);
+        pthread_cond_destroy(&q->not_empty);
+        pthread_cond_destroy(&q->not_full);
+    }
+    if (q->efd >= 0) close(q->efd);
+    free(q->slots);
+    free(q->cells);
+    free(q);
+    errno = saved;
+}
+
+size_t queue_capacity(const queue_t *q) {
+    return q->mask + 1;
+}
+
+uint64_t queue_sleeps(const queue_t *q) {
+    return __atomic_load_n(&q->sleeps, __ATOMIC_RELAXED);
+}
+
+/* ---- spsc ---- */
+
+static void spsc_push(queue_t *q, const uint64_t *items, int n) {
+    size_t tail = q->tail;
+    size_t cap = q->mask + 1;
+    uint64_t spins = 0;
+    
+    // Reread the consumer's index only when the cached one says full
+    while (tail + n - q->head_cache > cap) {
+        q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        if (tail + n - q->head_cache <= cap) break;
+        spin_wait(&spins);
+    }
+    for (int i = 0; i < n; i++) q->slots[(tail + i) & q->mask] = items[i];
+    __atomic_store_n(&q->tail, tail + n, __ATOMIC_RELEASE);
+}
+
+static int spsc_pop(queue_t *q, uint64_t *items, int max) {
+    size_t head = q->head;
+    uint64_t spins = 0;
+    
+    while (q->tail_cache == head) {
+        q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        if (q->tail_cache != head) break;
+        spin_wait(&spins);
+    }
+    size_t avail = q->tail_cache - head;
+    int n = avail < (size_t)max ? (int)avail : max;
+    for (int i = 0; i < n; i++) items[i] = q->slots[(head + i) & q->mask];
+    __atomic_store_n(&q->head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+/* ---- mpmc (Vyukov) ---- */
+
+static int mpmc_try_push(queue_t *q, uint64_t value) {
+    size_t pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+    mpmc_cell_t *cell;
+    
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (dif < 0) {
+            return 0;                // Full
+        } else {
+            pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    cell->value = value;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static int mpmc_try_pop(queue_t *q, uint64_t *value) {
+    size_t pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+    mpmc_cell_t *cell;
+    
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->dequeue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (dif < 0) {
+            return 0;                // Empty
+        } else {
+            pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    *value = cell->value;
+    __atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void mpmc_push(queue_t *q, const uint64_t *items, int n) {
+    uint64_t spins = 0;
+    for (int i = 0; i < n; i++) {
+        while (!mpmc_try_push(q, items[i])) spin_wait(&spins);
+    }
+}
+
+/* Drain up to max - 1 more items after a successful first pop */
+static int mpmc_pop_more(queue_t *q, uint64_t *items, int max) {
+    int n = 1;
+    while (n < max && mpmc_try_pop(q, &items[n])) n++;
+    return n;
+}
+
+static int mpmc_pop(queue_t *q, uint64_t *items, int max) {
+    uint64_t spins = 0;
+    while (!mpmc_try_pop(q, &items[0])) spin_wait(&spins);
+    return mpmc_pop_more(q, items, max);
+}
+
+/* ---- futex / eventfd notification on top of mpmc ---- */
+
+static void notify(queue_t *q, int n) {
+    // Pairs with the waiter's increment: either it sees our items or we see it
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->waiters, __ATOMIC_RELAXED) == 0) return;
+    
+    if (q->type == QUEUE_FUTEX) {
+        __atomic_add_fetch(&q->futex_word, 1, __ATOMIC_RELEASE);
+        syscall(SYS_futex, &q->futex_word, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+    } else {
+        uint64_t count = (uint64_t)n;
+        if (write(q->efd, &count, sizeof(count)) != sizeof(count)) {
+            // Counter saturated: sleepers still have pending wakeups
+        }
+    }
+}
+
+static void notified_push(queue_t *q, const uint64_t *items, int n) {
+    uint64_t spins = 0;
+    int pending = 0;
+    for (int i = 0; i < n; i++) {
+        while (!mpmc_try_push(q, items[i])) {
+            // Full: the consumers may be asleep waiting for what we pushed
+            if (pending) {
+                notify(q, pending);
+                pending = 0;
+            }
+            spin_wait(&spins);
+        }
+        pending++;
+    }
+    notify(q, pending);
+}
+
+static int notified_pop(queue_t *q, uint64_t *items, int max) {
+    for (int i = 0; i < NOTIFY_SPINS; i++) {
+        if (mpmc_try_pop(q, &items[0])) return mpmc_pop_more(q, items, max);
+        cpu_relax();
+    }
+    
+    for (;;) {
+        uint32_t seen = __atomic_load_n(&q->futex_word, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&q->waiters, 1, __ATOMIC_SEQ_CST);
+        if (mpmc_try_pop(q, &items[0])) {
+            __atomic_sub_fetch(&q->waiters, 1, __ATOMIC_RELAXED);
+            return mpmc_pop_more(q, items, max);
+        }
+        
+        __atomic_add_fetch(&q->sleeps, 1, __ATOMIC_RELAXED);
+        if (q->type == QUEUE_FUTEX) {
+            syscall(SYS_futex, &q->futex_word, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+        } else {
+            uint64_t count;
+            if (read(q->efd, &count, sizeof(count)) != sizeof(count) && errno != EINTR) {
+                sched_yield();
+            }
+        }
+        __atomic_sub_fetch(&q->waiters, 1, __ATOMIC_RELAXED);
+        
+        if (mpmc_try_pop(q, &items[0])) return mpmc_pop_more(q, items, max);
+    }
+}
+
+/* ---- mutex + condvars ---- */
+
+static void mutex_push(queue_t *q, const uint64_t *items, int n) {
+    size_t cap = q->mask + 1;
+    
+    pthread_mutex_lock(&q->lock);
+    while (q->count + n > cap) pthread_cond_wait(&q->not_full, &q->lock);
+    size_t pos = q->read_pos + q->count;
+    for (int i = 0; i < n; i++) q->slots[(pos + i) & q->mask] = items[i];
+    q->count += n;
+    if (n > 1) pthread_cond_broadcast(&q->not_empty);
+    else pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int mutex_pop(queue_t *q, uint64_t *items, int max) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        q->sleeps++;
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    int n = q->count < (size_t)max ? (int)q->count : max;
+    for (int i = 0; i < n; i++) items[i] = q->slots[(q->read_pos + i) & q->mask];
+    q->read_pos += n;
+    q->count -= n;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+void queue_push(queue_t *q, const uint64_t *items, int n) {
+    switch (q->type) {
+        case QUEUE_SPSC:    spsc_push(q, items, n); break;
+        case QUEUE_MUTEX:   mutex_push(q, items, n); break;
+        case QUEUE_FUTEX:
+        case QUEUE_EVENTFD: notified_push(q, items, n); break;
+        default:            mpmc_push(q, items, n); break;
+    }
+}
+
+int queue_pop(queue_t *q, uint64_t *items, int max) {
+    switch (q->type) {
+        case QUEUE_SPSC:    return spsc_pop(q, items, max);
+        case QUEUE_MUTEX:   return mutex_pop(q, items, max);
+        case QUEUE_FUTEX:
+        case QUEUE_EVENTFD: return notified_pop(q, items, max);
+        default:            return mpmc_pop(q, items, max);
+    }
+}
+
+/* ---- Handoff benchmark ---- */
+
+typedef struct {
+    histogram_t latency;
+    uint64_t items;
+} __attribute__((aligned(CACHE_LINE))) queue_thread_t;
+
+typedef struct {
+    queue_t *q;
+    queue_params_t p;
+    queue_thread_t *consumers;
+    double ns_per_tick;
+    int producers_left __attribute__((aligned(CACHE_LINE)));
+} queue_bench_t;
+
+static void producer_task(queue_bench_t *b) {
+    uint64_t batch[QUEUE_MAX_BATCH];
+    
+    for (uint64_t sent = 0; sent < b->p.items; ) {
+        int n = b->p.items - sent < (uint64_t)b->p.batch ? (int)(b->p.items - sent) : b->p.batch;
+        uint64_t stamp = tsc_now();
+        for (int i = 0; i < n; i++) batch[i] = stamp;
+        queue_push(b->q, batch, n);
+        sent += n;
+    }
+    
+    // Everyone else has pushed their last item, so the stops come last
+    if (__atomic_sub_fetch(&b->producers_left, 1, __ATOMIC_ACQ_REL) == 0) {
+        uint64_t stop = QUEUE_ITEM_STOP;
+        for (int c = 0; c < b->p.consumers; c++) queue_push(b->q, &stop, 1);
+    }
+}
+
+static void consumer_task(queue_bench_t *b, queue_thread_t *self) {
+    uint64_t items[QUEUE_MAX_BATCH];
+    
+    for (;;) {
+        int n = queue_pop(b->q, items, b->p.batch);
+        uint64_t now = tsc_now();
+        int stops = 0;
+        for (int i = 0; i < n; i++) {
+            if (items[i] == QUEUE_ITEM_STOP) {
+                stops++;
+                continue;
+            }
+            uint64_t age = now > items[i] ? now - items[i] : 0;
+            histogram_record(&self->latency, (uint64_t)(age * b->ns_per_tick + 0.5));
+            self->items++;
+        }
+        if (stops) {
+            // Other consumers' stops go back
+            uint64_t stop = QUEUE_ITEM_STOP;
+            for (int s = 1; s < stops; s++) queue_push(b->q, &stop, 1);
+            return;
+        }
+    }
+}
+
+static void bench_task(int id, void *arg) {
+    queue_bench_t *b = arg;
+    if (id < b->p.producers) producer_task(b);
+    else consumer_task(b, &b->consumers[id - b->p.producers]);
+}
+
+static void bench_setup(int id, void *arg) {
+    queue_bench_t *b = arg;
+    if (id < b->p.producers) return;
+    queue_thread_t *self = &b->consumers[id - b->p.producers];
+    histogram_reset(&self->latency);
+    self->items = 0;
+}
+
+int queue_bench_run(thread_pool_t *pool, queue_type_t type, const queue_params_t *params,
+                    queue_result_t *result) {
+    const queue_params_t *p = params;
+    
+    if ((int)type < 0 || type >= QUEUE_TYPE_COUNT || p->producers < 1 || p->consumers < 1 ||
+        p->producers + p->consumers > pool->num_threads ||
+        p->batch < 1 || p->batch > QUEUE_MAX_BATCH || p->capacity < (size_t)p->batch ||
+        (!queue_type_multi(type) && (p->producers > 1 || p->consumers > 1))) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    queue_bench_t *b = aligned_alloc(CACHE_LINE, sizeof(queue_bench_t));
+    if (!b) return -1;
+    memset(b, 0, sizeof(*b));
+    b->p = *p;
+    b->producers_left = p->producers;
+    b->ns_per_tick = 1.0 / tsc_info()->ticks_per_ns;
+    b->q = queue_create(type, p->capacity);
+    b->consumers = aligned_alloc(CACHE_LINE, p->consumers * sizeof(queue_thread_t));
+    if (!b->q || !b->consumers) {
+        queue_destroy(b->q);
+        free(b->consumers);
+        free(b);
+        return -1;
+    }
+    
+    if (thread_pool_run(pool, p->producers + p->consumers, bench_setup, bench_task, b) != 0) {
+        queue_destroy(b->q);
+        free(b->consumers);
+        free(b);
+        return -1;
+    }
+    
+    memset(result, 0, sizeof(*result));
+    histogram_reset(&result->latency);
+    for (int c = 0; c < p->consumers; c++) {
+        histogram_merge(&result->latency, &b->consumers[c].latency);
+        result->items += b->consumers[c].items;
+    }
+    result->runtime_ns = thread_pool_elapsed_ns(pool);
+    result->sleeps = queue_sleeps(b->q);
+    result->p50_ns = histogram_percentile(&result->latency, 50.0);
+    result->p90_ns = histogram_percentile(&result->latency, 90.0);
+    result->p99_ns = histogram_percentile(&result->latency, 99.0);
+    result->p999_ns = histogram_percentile(&result->latency, 99.9);
+    result->max_ns = result->latency.max;
+    
+    queue_destroy(b->q);
+    free(b->consumers);
+    free(b);
+    return 0;
+}
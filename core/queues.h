@@ -0,0 +1,123 @@
+/*
+ * queues.h - Bounded cross-thread queues and a handoff benchmark
+ *
+ * Bounded queues of 64-bit items behind one batch interface, so that
+ * only the synchronization differs between them:
+ *
+ *   spsc     Lamport ring, one producer and one consumer; each side keeps
+ *            a cached copy of the other's index and rereads the shared
+ *            one only when the ring looks full (or empty)
+ *   mpmc     Vyukov bounded MPMC: a sequence number per slot, one CAS on
+ *            the shared position per item
+ *   mutex    Ring under a pthread mutex with not-empty/not-full condvars
+ *   futex    mpmc ring; a consumer that still finds it empty after
+ *            spinning sleeps on a futex word producers bump and wake
+ *   eventfd  Same, sleeping in read() on an eventfd (EFD_SEMAPHORE)
+ *
+ *     queue_t *q = queue_create(QUEUE_MPMC, 1024);
+ *     queue_push(q, items, 8);                  // Blocks until all 8 are in
+ *     int n = queue_pop(q, out, 8);             // Blocks until 1..8 arrive
+ *     queue_destroy(q);
+ *
+ * queue_bench_run() drives a queue from producer and consumer workers of
+ * a thread pool and records the handoff latency of every item (push
+ * stamp to pop) in a histogram.
+ */
+
+#ifndef LRC_QUEUES_H
+#define LRC_QUEUES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "histogram.h"
+#include "thread_pool.h"
+
+typedef enum {
+    QUEUE_SPSC = 0,           // Lamport ring with cached indices
+    QUEUE_MPMC,               // Vyukov bounded MPMC
+    QUEUE_MUTEX,              // Mutex + condition variables
+    QUEUE_FUTEX,              // MPMC, consumers sleep on a futex
+    QUEUE_EVENTFD,            // MPMC, consumers sleep on an eventfd
+    QUEUE_TYPE_COUNT
+} queue_type_t;
+
+#define QUEUE_MAX_BATCH 256       // Largest batch queue_bench_run() accepts
+#define QUEUE_ITEM_STOP UINT64_MAX  // Reserved by queue_bench_run() (end of stream)
+
+typedef struct queue queue_t;
+
+/**
+ * @brief Create an empty queue
+ * @param capacity Slots (rounded up to a power of two, at least 2)
+ * @return Queue, or NULL with errno set
+ */
+queue_t *queue_create(queue_type_t type, size_t capacity);
+
+void queue_destroy(queue_t *q);
+
+/**
+ * @brief Slots after rounding
+ */
+size_t queue_capacity(const queue_t *q);
+
+/**
+ * @brief Append n items, waiting (spin, then yield or sleep) for room
+ * @note n must not exceed queue_capacity(); spsc allows one producer only
+ */
+void queue_push(queue_t *q, const uint64_t *items, int n);
+
+/**
+ * @brief Remove between 1 and max items, waiting until at least one is there
+ * @return Items written to items
+ */
+int queue_pop(queue_t *q, uint64_t *items, int max);
+
+/**
+ * @brief Consumer waits that went to sleep (mutex, futex, eventfd)
+ */
+uint64_t queue_sleeps(const queue_t *q);
+
+/**
+ * @brief Queue name for CSV output ("spsc", "mpmc", ...)
+ */
+const char *queue_type_name(queue_type_t type);
+
+/**
+ * @brief Whether type allows more than one producer and consumer
+ */
+int queue_type_multi(queue_type_t type);
+
+typedef struct {
+    int producers;            // Pool workers 0..producers-1
+    int consumers;            // The next consumers workers
+    int batch;                // Items per push, most items per pop (1..QUEUE_MAX_BATCH)
+    size_t capacity;          // Slots (>= batch)
+    uint64_t items;           // Items per producer
+} queue_params_t;
+
+typedef struct {
+    uint64_t items;           // Items consumed (producers x items)
+    uint64_t runtime_ns;      // First barrier release to last finish
+    uint64_t sleeps;          // Consumer waits that blocked
+    uint64_t p50_ns;          // Handoff latency: push stamp to pop
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+    histogram_t latency;      // Every item, merged across consumers
+} queue_result_t;
+
+/**
+ * @brief Run one producer/consumer handoff measurement on an existing pool
+ * @param pool Pool with at least producers + consumers workers
+ * @param params Thread counts, batch size, capacity and item count
+ * @param result Filled with throughput and latency percentiles
+ * @return 0 on success, -1 on invalid arguments (e.g. spsc with more than
+ *         one producer or consumer), allocation failure or a failed
+ *         thread_pool_run()
+ */
+int queue_bench_run(thread_pool_t *pool, queue_type_t type, const queue_params_t *params,
+                    queue_result_t *result);
+
+#endif /* LRC_QUEUES_H */
@@ -0,0 +1,323 @@
+/*
+ * resctrl.c - Cache and memory-bandwidth partitioning through resctrl
+ *
+ * Purpose:
+ *   Interference between co-located workloads could only be measured
+ *   and classified after the fact (analyze/interference.py). resctrl
+ *   lets an experiment change it: give a latency-sensitive thread its
+ *   own L3 ways, throttle a streaming neighbour's memory bandwidth, and
+ *   read each group's cache occupancy and bandwidth to confirm it took.
+ *
+ * Design:
+ *   - Plain file I/O on /sys/fs/resctrl, no library; one write() per
+ *     schemata update because the kernel parses each write as a unit
+ *   - Domain ids come from the root schemata, so masks are applied to
+ *     every cache/memory domain without needing the topology
+ *   - Schemata values are passed through unchanged; resctrl_mba_value()
+ *     converts a percentage using the root group's unthrottled value,
+ *     which is 100 on Intel (percent) and 2048 on AMD (1/8 GB/s units)
+ *   - With CDP (L3CODE/L3DATA), the same mask is written to both
+ *   - Monitoring walks the group's mon_data/mon_L3_* directories, which
+ *     exist with CMT/MBM alone (no L3 schemata line without CAT)
+ *
+ * Justification for syscalls:
+ *   open/read/write/mkdir/rmdir on resctrl files, all outside timed
+ *   regions: at group setup, task assignment and counter readout.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "resctrl.h"
+
+static resctrl_info_t cached;
+static int probed;
+
+/* Whole file into buf (NUL terminated); -1 on error */
+static int read_file(const char *path, char *buf, size_t len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    
+    ssize_t n = read(fd, buf, len - 1);
+    int saved = errno;
+    close(fd);
+    if (n < 0) {
+        errno = saved;
+        return -1;
+    }
+    buf[n] = '\0';
+    return (int)n;
+}
+
+static int read_ulong(const char *path, int base, unsigned long *value) {
+    char buf[64];
+    char *end;
+    
+    if (read_file(path, buf, sizeof(buf)) < 0) return -1;
+    *value = strtoul(buf, &end, base);
+    if (end == buf) {
+        errno = EINVAL;        // "Unavailable" or similar
+        return -1;
+    }
+    return 0;
+}
+
+static int write_file(const char *path, const char *data) {
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) return -1;
+    
+    size_t len = strlen(data);
+    ssize_t n = write(fd, data, len);
+    int saved = errno;
+    close(fd);
+    if (n != (ssize_t)len) {
+        errno = n < 0 ? saved : EIO;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Domain ids of one schemata line, e.g. "MB:0=100;1=100".
+ */
+static int parse_domains(const char *line, int *ids) {
+    const char *p = strchr(line, ':');
+    int count = 0;
+    
+    if (!p) return 0;
+    p++;
+    while (*p && *p != '\n' && count < RESCTRL_MAX_DOMAINS) {
+        char *end;
+        long id = strtol(p, &end, 10);
+        if (end == p || *end != '=') break;
+        ids[count++] = (int)id;
+        p = strchr(end, ';');
+        if (!p) break;
+        p++;
+    }
+    return count;
+}
+
+int resctrl_probe(resctrl_info_t *info) {
+    char buf[4096];
+    unsigned long v;
+    
+    if (probed) {
+        *info = cached;
+        return cached.available ? 0 : -1;
+    }
+    probed = 1;
+    memset(&cached, 0, sizeof(cached));
+    
+    if (read_file(RESCTRL_ROOT "/schemata", buf, sizeof(buf)) < 0) {
+        *info = cached;
+        return -1;
+    }
+    cached.available = 1;
+    
+    // Resources present in the root schemata
+    for (char *line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+        while (*line == ' ') line++;
+        if (strncmp(line, "L3:", 3) == 0 || strncmp(line, "L3DATA:", 7) == 0) {
+            cached.cat_l3 = 1;
+            cached.cdp = line[2] == 'D';
+            cached.num_l3_domains = parse_domains(line, cached.l3_domains);
+        } else if (strncmp(line, "MB:", 3) == 0) {
+            unsigned long max = 0;
+            // The root value is in decimal, unlike cache masks
+            const char *eq = strchr(line, '=');
+            if (eq) max = strtoul(eq + 1, NULL, 10);
+            cached.mba = 1;
+            cached.num_mb_domains = parse_domains(line, cached.mb_domains);
+            cached.mba_max = max ? (unsigned)max : 100;
+        }
+    }
+    
+    const char *l3_dir = cached.cdp ? RESCTRL_ROOT "/info/L3DATA" : RESCTRL_ROOT "/info/L3";
+    char path[256];
+    if (cached.cat_l3) {
+        snprintf(path, sizeof(path), "%s/cbm_mask", l3_dir);
+        if (read_ulong(path, 16, &v) == 0) cached.l3_ways = (unsigned)__builtin_popcountl(v);
+        snprintf(path, sizeof(path), "%s/min_cbm_bits", l3_dir);
+        if (read_ulong(path, 10, &v) == 0) cached.l3_min_ways = (unsigned)v;
+        snprintf(path, sizeof(path), "%s/num_closids", l3_dir);
+        if (read_ulong(path, 10, &v) == 0) cached.num_closids = (unsigned)v;
+    }
+    if (cached.mba) {
+        if (read_ulong(RESCTRL_ROOT "/info/MB/min_bandwidth", 10, &v) == 0) {
+            cached.mba_min = (unsigned)v;
+        }
+        if (read_ulong(RESCTRL_ROOT "/info/MB/bandwidth_gran", 10, &v) == 0) {
+            cached.mba_gran = (unsigned)v;
+        }
+        if (!cached.num_closids &&
+            read_ulong(RESCTRL_ROOT "/info/MB/num_closids", 10, &v) == 0) {
+            cached.num_closids = (unsigned)v;
+        }
+    }
+    
+    if (read_file(RESCTRL_ROOT "/info/L3_MON/mon_features", buf, sizeof(buf)) >= 0) {
+        cached.mon_llc = strstr(buf, "llc_occupancy") != NULL;
+        cached.mon_mbm_total = strstr(buf, "mbm_total_bytes") != NULL;
+        cached.mon_mbm_local = strstr(buf, "mbm_local_bytes") != NULL;
+    }
+    
+    *info = cached;
+    return 0;
+}
+
+uint64_t resctrl_l3_mask(const resctrl_info_t *info, unsigned first, unsigned ways) {
+    unsigned width = info->l3_ways ? info->l3_ways : 1;
+    
+    if (ways < info->l3_min_ways) ways = info->l3_min_ways;
+    if (ways < 1) ways = 1;
+    if (ways > width) ways = width;
+    if (first + ways > width) first = width - ways;
+    
+    uint64_t mask = ways >= 64 ? ~0ULL : (1ULL << ways) - 1;
+    return mask << first;
+}
+
+unsigned resctrl_mba_value(const resctrl_info_t *info, unsigned percent) {
+    unsigned max = info->mba_max ? info->mba_max : 100;
+    unsigned gran = info->mba_gran ? info->mba_gran : 1;
+    
+    if (percent > 100) percent = 100;
+    unsigned value = (max * percent + 99) / 100;
+    
+    // Intel steps in percent granules; AMD's absolute units are not
+    // quantized the same way, so only round when max is a percentage
+    if (max == 100) value = (value + gran - 1) / gran * gran;
+    if (value < info->mba_min) value = info->mba_min;
+    if (value > max) value = max;
+    return value;
+}
+
+int resctrl_group_create(resctrl_group_t *g, const resctrl_info_t *info, const char *name) {
+    g->info = info;
+    snprintf(g->path, sizeof(g->path), "%s/%s", RESCTRL_ROOT, name);
+    
+    if (!info->available) {
+        errno = ENODEV;
+        return -1;
+    }
+    if (mkdir(g->path, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+/* One resource line for every domain: "<name>:0=<v>;1=<v>\n" */
+static int format_line(char *buf, size_t len, const char *name, const int *ids, int count,
+                       const char *fmt, unsigned long value) {
+    size_t used = (size_t)snprintf(buf, len, "%s:", name);
+    
+    for (int i = 0; i < count && used < len; i++) {
+        used += (size_t)snprintf(buf + used, len - used, "%s%d=", i ? ";" : "", ids[i]);
+        if (used < len) used += (size_t)snprintf(buf + used, len - used, fmt, value);
+    }
+    if (used < len) used += (size_t)snprintf(buf + used, len - used, "\n");
+    return used < len ? 0 : -1;
+}
+
+int resctrl_group_set_l3(resctrl_group_t *g, uint64_t mask) {
+    const resctrl_info_t *info = g->info;
+    char line[2048], path[300];
+    
+    if (!info->cat_l3) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/schemata", g->path);
+    
+    static const char *plain[] = { "L3" }, *cdp[] = { "L3CODE", "L3DATA" };
+    const char **names = info->cdp ? cdp : plain;
+    for (int i = 0; i < (info->cdp ? 2 : 1); i++) {
+        if (format_line(line, sizeof(line), names[i], info->l3_domains, info->num_l3_domains,
+                        "%lx", (unsigned long)mask) != 0) {
+            errno = E2BIG;
+            return -1;
+        }
+        if (write_file(path, line) != 0) return -1;
+    }
+    return 0;
+}
+
+int resctrl_group_set_mba(resctrl_group_t *g, unsigned value) {
+    const resctrl_info_t *info = g->info;
+    char line[2048], path[300];
+    
+    if (!info->mba) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/schemata", g->path);
+    if (format_line(line, sizeof(line), "MB", info->mb_domains, info->num_mb_domains,
+                    "%lu", (unsigned long)value) != 0) {
+        errno = E2BIG;
+        return -1;
+    }
+    return write_file(path, line);
+}
+
+int resctrl_group_add_task(resctrl_group_t *g, pid_t tid) {
+    char path[300], value[32];
+    
+    if (tid == 0) tid = (pid_t)syscall(SYS_gettid);
+    snprintf(path, sizeof(path), "%s/tasks", g->path);
+    snprintf(value, sizeof(value), "%d\n", (int)tid);
+    return write_file(path, value);
+}
+
+int resctrl_group_read(const resctrl_group_t *g, resctrl_mon_t *mon) {
+    static const struct {
+        const char *file;
+        int bit;
+    } counters[] = {
+        { "llc_occupancy", RESCTRL_MON_LLC },
+        { "mbm_total_bytes", RESCTRL_MON_TOTAL },
+        { "mbm_local_bytes", RESCTRL_MON_LOCAL },
+    };
+    char path[600];
+    
+    memset(mon, 0, sizeof(*mon));
+    snprintf(path, sizeof(path), "%s/mon_data", g->path);
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+    
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "mon_L3_", 7) != 0) continue;
+        
+        for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+            unsigned long v;
+            snprintf(path, sizeof(path), "%s/mon_data/%s/%s", g->path, ent->d_name,
+                     counters[c].file);
+            if (read_ulong(path, 10, &v) != 0) continue;
+            
+            mon->valid |= counters[c].bit;
+            if (counters[c].bit == RESCTRL_MON_LLC) mon->llc_occupancy += v;
+            else if (counters[c].bit == RESCTRL_MON_TOTAL) mon->mbm_total_bytes += v;
+            else mon->mbm_local_bytes += v;
+        }
+    }
+    closedir(dir);
+    if (!mon->valid) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    return 0;
+}
+
+int resctrl_group_destroy(resctrl_group_t *g) {
+    if (!g->path[0]) return 0;
+    int rc = rmdir(g->path);
+    g->path[0] = '\0';
+    return rc;
+}
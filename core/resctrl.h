@@ -0,0 +1,128 @@
+/*
+ * resctrl.h - Cache and memory-bandwidth partitioning through resctrl
+ *
+ * Thin wrapper over the kernel's resctrl filesystem (/sys/fs/resctrl),
+ * which drives Intel RDT (CAT, MBA, CMT, MBM) and AMD PQoS through the
+ * same files. A group is a directory with its own schemata: an L3
+ * capacity bitmask (which cache ways its tasks may allocate into) and a
+ * memory-bandwidth throttle. Threads are assigned by writing their TID
+ * to the group's tasks file; monitoring counters (LLC occupancy, MBM
+ * bytes) are read back per group.
+ *
+ *     resctrl_info_t info;
+ *     if (resctrl_probe(&info) == 0 && info.cat_l3) {
+ *         resctrl_group_t g;
+ *         resctrl_group_create(&g, &info, "lrc_ls");
+ *         resctrl_group_set_l3(&g, resctrl_l3_mask(&info, 0, 8));
+ *         resctrl_group_add_task(&g, 0);        // Calling thread
+ *         ...
+ *         resctrl_group_read(&g, &mon);
+ *         resctrl_group_destroy(&g);            // Tasks return to the root
+ *     }
+ *
+ * Requires resctrl mounted (mount -t resctrl resctrl /sys/fs/resctrl)
+ * and root. Every call fails with errno set when it is not, so
+ * scenarios can skip the partitioned configurations and keep going.
+ */
+
+#ifndef LRC_RESCTRL_H
+#define LRC_RESCTRL_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifndef RESCTRL_ROOT
+#define RESCTRL_ROOT "/sys/fs/resctrl"
+#endif
+#define RESCTRL_MAX_DOMAINS 64
+
+typedef struct {
+    int available;            // resctrl mounted and readable
+    int cat_l3;               // L3 allocation (L3 or L3CODE/L3DATA with CDP)
+    int cdp;                  // Code/data prioritization enabled
+    int mba;                  // Memory bandwidth allocation
+    int mon_llc;              // llc_occupancy
+    int mon_mbm_total;        // mbm_total_bytes
+    int mon_mbm_local;        // mbm_local_bytes
+    unsigned l3_ways;         // Bits in info/L3/cbm_mask
+    unsigned l3_min_ways;     // info/L3/min_cbm_bits
+    unsigned num_closids;     // Groups the hardware supports (root included)
+    unsigned mba_min;         // info/MB/min_bandwidth
+    unsigned mba_gran;        // info/MB/bandwidth_gran
+    unsigned mba_max;         // Unthrottled value (100 = percent, AMD: GB/s x 8)
+    int num_l3_domains;       // Cache domains in the root schemata
+    int l3_domains[RESCTRL_MAX_DOMAINS];
+    int num_mb_domains;
+    int mb_domains[RESCTRL_MAX_DOMAINS];
+} resctrl_info_t;
+
+typedef struct {
+    char path[256];           // RESCTRL_ROOT/<name>
+    const resctrl_info_t *info;
+} resctrl_group_t;
+
+/* Monitoring counters summed over all L3 domains */
+typedef struct {
+    uint64_t llc_occupancy;   // Bytes of L3 held by the group's tasks
+    uint64_t mbm_total_bytes; // Cumulative, read twice and subtract
+    uint64_t mbm_local_bytes;
+    int valid;                // RESCTRL_MON_* bits that were read
+} resctrl_mon_t;
+
+#define RESCTRL_MON_LLC   0x1
+#define RESCTRL_MON_TOTAL 0x2
+#define RESCTRL_MON_LOCAL 0x4
+
+/**
+ * @brief Detect resctrl features and limits (result cached)
+ * @return 0 when resctrl is mounted, -1 otherwise (info->available = 0)
+ */
+int resctrl_probe(resctrl_info_t *info);
+
+/**
+ * @brief Contiguous capacity bitmask of ways [first, first + ways)
+ * @note Clamped to the CBM width and to at least min_cbm_bits ways
+ */
+uint64_t resctrl_l3_mask(const resctrl_info_t *info, unsigned first, unsigned ways);
+
+/**
+ * @brief MBA schemata value for a share of the unthrottled bandwidth
+ * @param percent 1-100, rounded up to the granularity and raised to the minimum
+ */
+unsigned resctrl_mba_value(const resctrl_info_t *info, unsigned percent);
+
+/**
+ * @brief Create a control group (an existing one with the name is reused)
+ * @return 0 on success, -1 on error (ENODEV without resctrl, EACCES
+ *         without root, ENOSPC when the hardware is out of CLOSIDs)
+ */
+int resctrl_group_create(resctrl_group_t *g, const resctrl_info_t *info, const char *name);
+
+/**
+ * @brief Set the L3 capacity bitmask on every cache domain
+ */
+int resctrl_group_set_l3(resctrl_group_t *g, uint64_t mask);
+
+/**
+ * @brief Set the memory-bandwidth throttle (schemata value) on every domain
+ */
+int resctrl_group_set_mba(resctrl_group_t *g, unsigned value);
+
+/**
+ * @brief Move a thread into the group
+ * @param tid Thread ID (gettid), 0 = calling thread
+ */
+int resctrl_group_add_task(resctrl_group_t *g, pid_t tid);
+
+/**
+ * @brief Read the group's monitoring counters
+ * @return 0 if at least one counter was read, -1 otherwise
+ */
+int resctrl_group_read(const resctrl_group_t *g, resctrl_mon_t *mon);
+
+/**
+ * @brief Remove the group; its tasks fall back to the root group
+ */
+int resctrl_group_destroy(resctrl_group_t *g);
+
+#endif /* LRC_RESCTRL_H */
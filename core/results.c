@@ -0,0 +1,622 @@
+/*
+ * results.c - Buffered result sink
+ *
+ * Purpose:
+ *   Scenarios used to fprintf() a CSV row after every run, so number
+ *   formatting and stdio sat between measured intervals, and
+ *   analyze/parse.py had to parse the text back. Large sweeps spent
+ *   more time in parsing than in any other stage.
+ *
+ * Design:
+ *   - One preallocated array of 8-byte cells per column; appending a
+ *     cell is a store and an increment (results.h inline functions)
+ *   - Strings (workload names, lock types, ...) are interned once and
+ *     stored as ids, so rows stay fixed-width
+ *   - results_close() writes the columns back to back with a schema
+ *     header: a reader can mmap the file and use each column in place
+ *   - CSV is produced from the same buffer at close, with the column
+ *     names and precisions the scenarios printed before
+ *   - Optionally an Arrow IPC file from the same columns
+ *     (results_arrow.c), written through a .tmp rename like the .lrcr
+ *
+ * Justification for syscalls:
+ *   malloc/realloc only when the preallocated capacity is exceeded
+ *   (doubling). Output files are opened in results_open() and written
+ *   only in results_close().
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <stdarg.h>
+
+#include "results.h"
+
+#define RESULTS_MIN_ROWS 64
+#define RESULTS_HEADER_SIZE 64
+#define RESULTS_DESCRIPTOR_SIZE 64
+#define RESULTS_CSV_BUFFER (1 << 20)
+
+static results_format_t parse_format(const char *name) {
+    if (strcasecmp(name, "both") == 0) return RESULTS_FORMAT_BOTH;
+    if (strcasecmp(name, "all") == 0) return RESULTS_FORMAT_ALL;
+    if (strcasecmp(name, "csv") == 0) return RESULTS_FORMAT_CSV;
+    if (strcasecmp(name, "binary") == 0 || strcasecmp(name, "lrcr") == 0) return RESULTS_FORMAT_BINARY;
+    if (strcasecmp(name, "arrow") == 0) return RESULTS_FORMAT_ARROW;
+    return 0;
+}
+
+results_format_t results_format_from_env(void) {
+    const char *env = getenv("LRC_RESULTS_FORMAT");
+    char name[16];
+    int format = 0;
+    
+    if (!env || !*env) return RESULTS_FORMAT_BOTH;
+    
+    // Comma-separated, e.g. "csv,arrow"
+    for (const char *p = env; *p; ) {
+        size_t len = strcspn(p, ",");
+        int f = 0;
+        if (len < sizeof(name)) {
+            memcpy(name, p, len);
+            name[len] = '\0';
+            f = parse_format(name);
+        }
+        if (!f) {
+            fprintf(stderr, "Unknown LRC_RESULTS_FORMAT '%s', using both\n", env);
+            return RESULTS_FORMAT_BOTH;
+        }
+        format |= f;
+        p += len;
+        if (*p) p++;
+    }
+    return format ? (results_format_t)format : RESULTS_FORMAT_BOTH;
+}
+
+static void free_paths(results_t *r) {
+    free(r->csv_path);
+    free(r->binary_path);
+    free(r->binary_tmp_path);
+    free(r->arrow_path);
+    free(r->arrow_tmp_path);
+}
+
+int results_open(results_t *r, const char *csv_path, size_t expected_rows) {
+    memset(r, 0, sizeof(*r));
+    
+    size_t len = strlen(csv_path);
+    size_t stem = len;
+    if (len >= 4 && strcmp(csv_path + len - 4, ".csv") == 0) stem = len - 4;
+    
+    r->csv_path = strdup(csv_path);
+    r->binary_path = malloc(stem + sizeof(".lrcr"));
+    r->binary_tmp_path = malloc(stem + sizeof(".lrcr.tmp"));
+    r->arrow_path = malloc(stem + sizeof(".arrow"));
+    r->arrow_tmp_path = malloc(stem + sizeof(".arrow.tmp"));
+    if (!r->csv_path || !r->binary_path || !r->binary_tmp_path ||
+        !r->arrow_path || !r->arrow_tmp_path) {
+        free_paths(r);
+        return -1;
+    }
+    memcpy(r->binary_path, csv_path, stem);
+    strcpy(r->binary_path + stem, ".lrcr");
+    sprintf(r->binary_tmp_path, "%s.tmp", r->binary_path);
+    memcpy(r->arrow_path, csv_path, stem);
+    strcpy(r->arrow_path + stem, ".arrow");
+    sprintf(r->arrow_tmp_path, "%s.tmp", r->arrow_path);
+    
+    r->format = results_format_from_env();
+    r->capacity = expected_rows < RESULTS_MIN_ROWS ? RESULTS_MIN_ROWS : expected_rows;
+    
+    // Open now so a bad path fails before the experiment, not after
+    if (r->format & RESULTS_FORMAT_CSV) {
+        r->csv_file = fopen(r->csv_path, "w");
+        if (!r->csv_file) {
+            free_paths(r);
+            return -1;
+        }
+    }
+    if (r->format & RESULTS_FORMAT_BINARY) {
+        r->binary_file = fopen(r->binary_tmp_path, "wb");
+        if (!r->binary_file) {
+            if (r->csv_file) fclose(r->csv_file);
+            free_paths(r);
+            return -1;
+        }
+    }
+    if (r->format & RESULTS_FORMAT_ARROW) {
+        r->arrow_file = fopen(r->arrow_tmp_path, "wb");
+        if (!r->arrow_file) {
+            if (r->csv_file) fclose(r->csv_file);
+            if (r->binary_file) {
+                fclose(r->binary_file);
+                remove(r->binary_tmp_path);
+            }
+            free_paths(r);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int results_add_column(results_t *r, const char *name, result_type_t type, int decimals) {
+    if (r->rows > 0 || r->col > 0 || r->num_columns >= RESULTS_MAX_COLUMNS) {
+        fprintf(stderr, "%s: cannot add column %s\n", r->csv_path, name);
+        r->dropped_columns++;
+        return -1;
+    }
+    
+    uint64_t *cells = malloc(r->capacity * sizeof(uint64_t));
+    if (!cells) {
+        r->dropped_columns++;
+        return -1;
+    }
+    
+    // Long perf event names (up to PERF_EVENT_NAME_MAX) keep their prefix
+    if (strlen(name) >= RESULTS_NAME_MAX) {
+        fprintf(stderr, "%s: column name %s truncated to %d bytes\n", r->csv_path, name,
+                RESULTS_NAME_MAX - 1);
+    }
+    
+    int c = r->num_columns++;
+    snprintf(r->columns[c].name, RESULTS_NAME_MAX, "%s", name);
+    r->columns[c].type = type;
+    r->columns[c].decimals = decimals;
+    r->cells[c] = cells;
+    return c;
+}
+
+/*
+ * Called from results_put() when a new row would not fit. On allocation
+ * failure the last row is overwritten (and counted) rather than writing
+ * past the arrays.
+ */
+void results_grow(results_t *r) {
+    size_t capacity = r->capacity * 2;
+    
+    for (int c = 0; c < r->num_columns; c++) {
+        uint64_t *cells = realloc(r->cells[c], capacity * sizeof(uint64_t));
+        if (!cells) {
+            // Columns already grown keep their larger arrays; unused
+            r->rows--;
+            r->overwritten++;
+            return;
+        }
+        r->cells[c] = cells;
+    }
+    r->capacity = capacity;
+}
+
+static uint64_t hash_string(const char *s) {
+    uint64_t h = 0xcbf29ce484222325ULL;    // FNV-1a
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int rehash_strings(results_t *r, size_t size) {
+    uint32_t *slots = calloc(size, sizeof(uint32_t));
+    if (!slots) return -1;
+    
+    for (size_t i = 0; i < r->num_strings; i++) {
+        size_t s = hash_string(r->strings[i]) & (size - 1);
+        while (slots[s]) s = (s + 1) & (size - 1);
+        slots[s] = i + 1;
+    }
+    
+    free(r->string_slots);
+    r->string_slots = slots;
+    r->string_slots_size = size;
+    return 0;
+}
+
+uint64_t results_intern(results_t *r, const char *s) {
+    if (!s) s = "";
+    
+    if (r->string_slots_size == 0 && rehash_strings(r, 64) != 0) {
+        r->lost_strings++;
+        return RESULTS_STRING_NONE;
+    }
+    
+    size_t mask = r->string_slots_size - 1;
+    size_t slot = hash_string(s) & mask;
+    while (r->string_slots[slot]) {
+        uint32_t id = r->string_slots[slot] - 1;
+        if (strcmp(r->strings[id], s) == 0) return id;
+        slot = (slot + 1) & mask;
+    }
+    
+    // New string: keep the table at most half full
+    if (r->num_strings == r->strings_capacity) {
+        size_t capacity = r->strings_capacity ? r->strings_capacity * 2 : 16;
+        char **strings = realloc(r->strings, capacity * sizeof(char *));
+        if (!strings) {
+            r->lost_strings++;
+            return RESULTS_STRING_NONE;
+        }
+        r->strings = strings;
+        r->strings_capacity = capacity;
+    }
+    char *copy = strdup(s);
+    if (!copy) {
+        r->lost_strings++;
+        return RESULTS_STRING_NONE;
+    }
+    
+    uint64_t id = r->num_strings++;
+    r->strings[id] = copy;
+    
+    if (r->num_strings * 2 > r->string_slots_size) {
+        if (rehash_strings(r, r->string_slots_size * 2) != 0) {
+            r->num_strings--;
+            free(copy);
+            r->lost_strings++;
+            return RESULTS_STRING_NONE;
+        }
+    } else {
+        r->string_slots[slot] = id + 1;
+    }
+    return id;
+}
+
+void results_strf(results_t *r, const char *fmt, ...) {
+    char buf[256];
+    va_list ap;
+    
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    results_str(r, buf);
+}
+
+static void write_u32(FILE *f, uint32_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static void write_u64(FILE *f, uint64_t v) {
+    v = results_le64(v);
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+/*
+ * Close a file written under tmp and move it to path, so a reader never
+ * maps a partial file.
+ */
+static int commit_file(FILE *f, int failed, const char *tmp, const char *path) {
+    int err = ferror(f) || failed;
+    if (fclose(f) != 0 || err) {
+        perror(tmp);
+        remove(tmp);
+        return -1;
+    }
+    if (rename(tmp, path) != 0) {
+        perror(path);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Written to <path>.lrcr.tmp and renamed (commit_file()).
+ */
+static int write_binary(const results_t *r) {
+    FILE *f = r->binary_file;
+    const char *tmp = r->binary_tmp_path;
+    
+    uint64_t data_offset = RESULTS_HEADER_SIZE + (uint64_t)r->num_columns * RESULTS_DESCRIPTOR_SIZE;
+    uint64_t strings_offset = data_offset + (uint64_t)r->num_columns * r->rows * sizeof(uint64_t);
+    
+    // Header
+    fwrite(RESULTS_MAGIC, 1, 8, f);
+    write_u32(f, RESULTS_VERSION);
+    write_u32(f, r->num_columns);
+    write_u64(f, r->rows);
+    write_u64(f, r->num_strings);
+    write_u64(f, strings_offset);
+    for (int i = 0; i < 3; i++) write_u64(f, 0);
+    
+    // Column descriptors
+    for (int c = 0; c < r->num_columns; c++) {
+        char name[RESULTS_NAME_MAX] = {0};
+        strncpy(name, r->columns[c].name, RESULTS_NAME_MAX - 1);
+        fwrite(name, 1, RESULTS_NAME_MAX, f);
+        write_u32(f, r->columns[c].type);
+        write_u32(f, (uint32_t)r->columns[c].decimals);
+        write_u64(f, data_offset + (uint64_t)c * r->rows * sizeof(uint64_t));
+    }
+    
+    // Columns, already little-endian
+    for (int c = 0; c < r->num_columns; c++) {
+        fwrite(r->cells[c], sizeof(uint64_t), r->rows, f);
+    }
+    
+    // String table: offsets (relative to the byte area), then bytes
+    uint64_t offset = 0;
+    for (size_t i = 0; i < r->num_strings; i++) {
+        write_u64(f, offset);
+        offset += strlen(r->strings[i]);
+    }
+    write_u64(f, offset);
+    for (size_t i = 0; i < r->num_strings; i++) {
+        fwrite(r->strings[i], 1, strlen(r->strings[i]), f);
+    }
+    
+    return commit_file(f, 0, tmp, r->binary_path);
+}
+
+static int write_arrow(const results_t *r) {
+    int failed = results_write_arrow(r, r->arrow_file) != 0;
+    return commit_file(r->arrow_file, failed, r->arrow_tmp_path, r->arrow_path);
+}
+
+static void write_csv_cell(FILE *f, const results_t *r, int c, uint64_t bits) {
+    bits = results_le64(bits);
+    
+    switch (r->columns[c].type) {
+        case RESULT_U64:
+            fprintf(f, "%lu", bits);
+            break;
+        case RESULT_I64:
+            fprintf(f, "%ld", (int64_t)bits);
+            break;
+        case RESULT_F64: {
+            double v;
+            memcpy(&v, &bits, sizeof(v));
+            if (isnan(v)) {
+                break;
+            } else if (r->columns[c].decimals < 0) {
+                fprintf(f, "%g", v);
+            } else {
+                fprintf(f, "%.*f", r->columns[c].decimals, v);
+            }
+            break;
+        }
+        case RESULT_STR:
+            fputs(bits < r->num_strings ? r->strings[bits] : "", f);
+            break;
+    }
+}
+
+static int write_csv(const results_t *r) {
+    FILE *f = r->csv_file;
+    
+    setvbuf(f, NULL, _IOFBF, RESULTS_CSV_BUFFER);
+    
+    for (int c = 0; c < r->num_columns; c++) {
+        fprintf(f, c ? ",%s" : "%s", r->columns[c].name);
+    }
+    fputc('\n', f);
+    
+    for (size_t row = 0; row < r->rows; row++) {
+        for (int c = 0; c < r->num_columns; c++) {
+            if (c) fputc(',', f);
+            write_csv_cell(f, r, c, r->cells[c][row]);
+        }
+        fputc('\n', f);
+    }
+    
+    int err = ferror(f);
+    if (fclose(f) != 0 || err) {
+        perror(r->csv_path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Under the suite runner (LRC_PARTITION set, e.g. "l3:1" or "all") every
+ * row is stamped with the partition it ran on, as a last column.
+ */
+static void add_partition_column(results_t *r) {
+    const char *partition = getenv("LRC_PARTITION");
+    if (!partition || !*partition || r->num_columns == 0) return;
+    
+    for (int c = 0; c < r->num_columns; c++) {
+        if (strcmp(r->columns[c].name, "partition") == 0) return;
+    }
+    uint64_t *cells = r->num_columns < RESULTS_MAX_COLUMNS ?
+                      malloc((r->rows ? r->rows : 1) * sizeof(uint64_t)) : NULL;
+    if (!cells) {
+        fprintf(stderr, "%s: partition column not added\n", r->csv_path);
+        return;
+    }
+    
+    uint64_t id = results_le64(results_intern(r, partition));
+    for (size_t i = 0; i < r->rows; i++) cells[i] = id;
+    
+    int c = r->num_columns++;
+    strcpy(r->columns[c].name, "partition");
+    r->columns[c].type = RESULT_STR;
+    r->columns[c].decimals = 0;
+    r->cells[c] = cells;
+}
+
+/*
+ * Close and remove the files opened by results_open() without writing.
+ */
+static void discard_files(results_t *r) {
+    if (r->csv_file) {
+        fclose(r->csv_file);
+        remove(r->csv_path);
+    }
+    if (r->binary_file) {
+        fclose(r->binary_file);
+        remove(r->binary_tmp_path);
+    }
+    if (r->arrow_file) {
+        fclose(r->arrow_file);
+        remove(r->arrow_tmp_path);
+    }
+}
+
+int results_close(results_t *r) {
+    int ret = 0;
+    
+    if (r->col != 0) {
+        fprintf(stderr, "%s: last row incomplete (%d of %d columns), dropped\n",
+                r->csv_path, r->col, r->num_columns);
+    }
+    if (!r->dropped_columns) add_partition_column(r);
+    if (r->overwritten) {
+        fprintf(stderr, "%s: out of memory, %zu rows lost\n", r->csv_path, r->overwritten);
+        ret = -1;
+    }
+    if (r->lost_strings) {
+        fprintf(stderr, "%s: out of memory, %zu string cells left empty\n",
+                r->csv_path, r->lost_strings);
+        ret = -1;
+    }
+    
+    if (r->dropped_columns) {
+        // Every cell after a dropped column sits one column left: keep nothing
+        fprintf(stderr, "%s: %d column(s) could not be added, results discarded\n",
+                r->csv_path, r->dropped_columns);
+        discard_files(r);
+        ret = -1;
+    } else {
+        if ((r->format & RESULTS_FORMAT_BINARY) && write_binary(r) != 0) ret = -1;
+        if ((r->format & RESULTS_FORMAT_ARROW) && write_arrow(r) != 0) ret = -1;
+        if ((r->format & RESULTS_FORMAT_CSV) && write_csv(r) != 0) ret = -1;
+    }
+    
+    for (int c = 0; c < r->num_columns; c++) free(r->cells[c]);
+    for (size_t i = 0; i < r->num_strings; i++) free(r->strings[i]);
+    free(r->strings);
+    free(r->string_slots);
+    free_paths(r);
+    memset(r, 0, sizeof(*r));
+    
+    return ret;
+}
+
+/*
+ * Helpers matching the existing CSV printers column for column.
+ */
+void results_add_metrics_columns(results_t *r) {
+    results_add_column(r, "timestamp_ns", RESULT_U64, 0);
+    results_add_column(r, "runtime_ns", RESULT_U64, 0);
+    results_add_column(r, "voluntary_ctxt_switches", RESULT_U64, 0);
+    results_add_column(r, "nonvoluntary_ctxt_switches", RESULT_U64, 0);
+    results_add_column(r, "minor_page_faults", RESULT_U64, 0);
+    results_add_column(r, "major_page_faults", RESULT_U64, 0);
+    results_add_column(r, "start_cpu", RESULT_I64, 0);
+    results_add_column(r, "end_cpu", RESULT_I64, 0);
+}
+
+void results_metrics(results_t *r, const workload_metrics_t *m) {
+    results_u64(r, m->timestamp_ns);
+    results_u64(r, m->runtime_ns);
+    results_u64(r, m->voluntary_ctxt_switches);
+    results_u64(r, m->nonvoluntary_ctxt_switches);
+    results_u64(r, m->minor_page_faults);
+    results_u64(r, m->major_page_faults);
+    results_i64(r, m->start_cpu);
+    results_i64(r, m->end_cpu);
+}
+
+void results_runtime(results_t *r, uint64_t timestamp_ns, uint64_t runtime_ns) {
+    workload_metrics_t m = {
+        .timestamp_ns = timestamp_ns,
+        .runtime_ns = runtime_ns,
+        .start_cpu = -1,
+        .end_cpu = -1,
+    };
+    results_metrics(r, &m);
+}
+
+void results_histogram(results_t *r, const histogram_t *h) {
+    // Sized for the non-empty buckets only; outside any timed region
+    size_t buckets = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (h->counts[i]) buckets++;
+    }
+    
+    size_t len = 16 + buckets * 26;
+    char *buf = malloc(len);
+    if (!buf) {
+        results_str(r, "");
+        return;
+    }
+    histogram_encode(h, buf, len);
+    results_str(r, buf);
+    free(buf);
+}
+
+void results_add_perf_columns(results_t *r) {
+    results_add_column(r, "instructions", RESULT_U64, 0);
+    results_add_column(r, "cycles", RESULT_U64, 0);
+    results_add_column(r, "ipc", RESULT_F64, 3);
+    results_add_column(r, "l1_dcache_misses", RESULT_U64, 0);
+    results_add_column(r, "llc_misses", RESULT_U64, 0);
+    results_add_column(r, "branches", RESULT_U64, 0);
+    results_add_column(r, "branch_misses", RESULT_U64, 0);
+    results_add_column(r, "branch_miss_rate", RESULT_F64, 6);
+}
+
+void results_perf(results_t *r, const perf_counters_t *pc) {
+    double ipc = pc->cycles > 0 ? (double)pc->instructions / pc->cycles : 0.0;
+    double branch_miss_rate = pc->branches > 0 ?
+        (double)pc->branch_misses / pc->branches : 0.0;
+    
+    results_u64(r, pc->instructions);
+    results_u64(r, pc->cycles);
+    results_f64(r, ipc);
+    results_u64(r, pc->l1_dcache_misses);
+    results_u64(r, pc->llc_misses);
+    results_u64(r, pc->branches);
+    results_u64(r, pc->branch_misses);
+    results_f64(r, branch_miss_rate);
+}
+
+void results_add_event_columns(results_t *r, const perf_event_list_t *list) {
+    for (int i = 0; i < list->count; i++) {
+        results_add_column(r, list->events[i].name, RESULT_U64, 0);
+    }
+    results_add_column(r, "perf_running_ratio", RESULT_F64, 3);
+}
+
+void results_events(results_t *r, const perf_event_list_t *list) {
+    for (int i = 0; i < list->count; i++) {
+        results_u64(r, list->events[i].value);
+    }
+    
+    double ratio = list->time_enabled ?
+        (double)list->time_running / list->time_enabled : 0.0;
+    results_f64(r, ratio);
+}
+
+void results_add_sched_trace_columns(results_t *r) {
+    results_add_column(r, "sched_traced", RESULT_U64, 0);
+    results_add_column(r, "off_cpu_ns", RESULT_U64, 0);
+    results_add_column(r, "sched_switches", RESULT_U64, 0);
+    results_add_column(r, "sched_preemptions", RESULT_U64, 0);
+    results_add_column(r, "sched_migrations", RESULT_U64, 0);
+    results_add_column(r, "irqs", RESULT_U64, 0);
+    results_add_column(r, "irq_ns", RESULT_U64, 0);
+    results_add_column(r, "softirqs", RESULT_U64, 0);
+    results_add_column(r, "softirq_ns", RESULT_U64, 0);
+    results_add_column(r, "sched_events_dropped", RESULT_U64, 0);
+}
+
+void results_sched_trace(results_t *r, const sched_trace_run_t *run) {
+    results_u64(r, run->traced);
+    results_u64(r, run->off_cpu_ns);
+    results_u64(r, run->switches);
+    results_u64(r, run->preemptions);
+    results_u64(r, run->migrations);
+    results_u64(r, run->irqs);
+    results_u64(r, run->irq_ns);
+    results_u64(r, run->softirqs);
+    results_u64(r, run->softirq_ns);
+    results_u64(r, run->dropped);
+}
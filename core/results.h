@@ -0,0 +1,219 @@
+/*
+ * results.h - Buffered result sink
+ *
+ * Rows are appended as fixed-width 8-byte little-endian cells into
+ * preallocated per-column arrays while the experiment runs; nothing is
+ * formatted or written until results_close(). The close writes a
+ * columnar, mmap-able binary file (<name>.lrcr, read by
+ * analyze/results.py) and/or the CSV file the scenario always wrote.
+ *
+ * Binary layout (all offsets from file start, 8-byte aligned):
+ *   header       64 bytes: "LRCRES01", u32 version, u32 num_columns,
+ *                u64 num_rows, u64 num_strings, u64 strings_offset
+ *   descriptors  num_columns x 64 bytes: char name[48], u32 type,
+ *                i32 decimals, u64 data_offset
+ *   columns      num_rows x 8 bytes each (u64, i64, f64, or string id)
+ *   strings      u64 offsets[num_strings + 1] then the bytes
+ *                (string i = bytes[offsets[i] .. offsets[i+1]])
+ *
+ * With the arrow format the same columns also go to <name>.arrow, an
+ * Arrow IPC file (results_arrow.c) for pyarrow, polars or DuckDB.
+ *
+ * Output format: LRC_RESULTS_FORMAT=csv|binary|arrow|both|all, or a
+ * comma-separated combination such as csv,arrow (default both = csv and
+ * binary).
+ *
+ * With LRC_PARTITION set (by the suite runner), results_close() appends
+ * a string column "partition" holding its value on every row.
+ */
+
+#ifndef LRC_RESULTS_H
+#define LRC_RESULTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "histogram.h"
+#include "perf_counters.h"
+#include "sched_trace.h"
+
+#define RESULTS_MAGIC "LRCRES01"
+#define RESULTS_VERSION 1
+#define RESULTS_NAME_MAX 48
+#define RESULTS_MAX_COLUMNS 128
+
+typedef enum {
+    RESULT_U64 = 1,
+    RESULT_I64 = 2,
+    RESULT_F64 = 3,               // NaN = not measured (empty CSV cell)
+    RESULT_STR = 4                // Cell is an id into the string table
+} result_type_t;
+
+typedef enum {
+    RESULTS_FORMAT_CSV = 1,
+    RESULTS_FORMAT_BINARY = 2,
+    RESULTS_FORMAT_BOTH = 3,
+    RESULTS_FORMAT_ARROW = 4,
+    RESULTS_FORMAT_ALL = 7
+} results_format_t;
+
+typedef struct {
+    char name[RESULTS_NAME_MAX];
+    result_type_t type;
+    int decimals;                 // CSV precision for RESULT_F64 (-1 = %g)
+} result_column_t;
+
+/**
+ * @brief Result sink (fields are internal; use the functions below)
+ */
+typedef struct {
+    char *csv_path;
+    char *binary_path;
+    char *binary_tmp_path;                 // Renamed to binary_path at close
+    char *arrow_path;
+    char *arrow_tmp_path;
+    results_format_t format;
+    FILE *csv_file;                        // Opened up front so errors show early
+    FILE *binary_file;
+    FILE *arrow_file;
+    
+    result_column_t columns[RESULTS_MAX_COLUMNS];
+    uint64_t *cells[RESULTS_MAX_COLUMNS];  // cells[column][row], little-endian
+    int num_columns;
+    int col;                               // Next column of the current row
+    size_t rows;                           // Complete rows
+    size_t capacity;                       // Rows allocated per column
+    size_t overwritten;                    // Rows lost to allocation failure
+    size_t lost_strings;                   // String cells left empty by ENOMEM
+    int dropped_columns;                   // Failed results_add_column(); close discards
+    
+    char **strings;                        // Interned, id = index
+    size_t num_strings;
+    size_t strings_capacity;
+    uint32_t *string_slots;                // Hash table of id + 1 (0 = empty)
+    size_t string_slots_size;
+} results_t;
+
+/**
+ * @brief Open a sink
+ * @param r Sink to initialize
+ * @param csv_path CSV path; the binary files use the same name with .lrcr
+ *                 and .arrow
+ * @param expected_rows Rows to preallocate (grows by doubling if exceeded)
+ * @return 0 on success, -1 on error (errno set, as for fopen)
+ */
+int results_open(results_t *r, const char *csv_path, size_t expected_rows);
+
+/**
+ * @brief Append a column to the schema (only before the first cell)
+ * @param name Truncated (with a warning) to RESULTS_NAME_MAX - 1 bytes
+ * @param decimals CSV precision for RESULT_F64, ignored otherwise
+ * @return Column index, or -1 on error. A failed add would shift every
+ *         later cell one column left, so the sink remembers it and
+ *         results_close() writes nothing and fails.
+ */
+int results_add_column(results_t *r, const char *name, result_type_t type, int decimals);
+
+/**
+ * @brief Schema helpers matching metrics_print_csv_header(),
+ *        perf_counters_print_csv_header() and
+ *        perf_event_list_print_csv_header()
+ */
+void results_add_metrics_columns(results_t *r);
+void results_add_perf_columns(results_t *r);
+void results_add_event_columns(results_t *r, const perf_event_list_t *list);
+void results_add_sched_trace_columns(results_t *r);
+
+/**
+ * @brief Flush to the configured format(s) and free the sink
+ * @return 0 on success, -1 if any output failed or a column was dropped
+ */
+int results_close(results_t *r);
+
+/**
+ * @brief Output format from LRC_RESULTS_FORMAT
+ */
+results_format_t results_format_from_env(void);
+
+/* Internal: make room for one more row */
+void results_grow(results_t *r);
+
+/* Id of a string that could not be stored; its cells are written empty */
+#define RESULTS_STRING_NONE UINT64_MAX
+
+/* Internal: id of s in the string table, adding it if new, or
+   RESULTS_STRING_NONE on allocation failure (counted, close fails) */
+uint64_t results_intern(results_t *r, const char *s);
+
+/* Internal: write the sink as an Arrow IPC file (results_arrow.c) */
+int results_write_arrow(const results_t *r, FILE *f);
+
+/* Host to file byte order (no-op on little-endian hosts) */
+static inline uint64_t results_le64(uint64_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(v);
+#else
+    return v;
+#endif
+}
+
+/*
+ * Cell appenders: one call per column, in schema order; the row is
+ * complete after the last column. Inline so the measurement loop pays
+ * a store and an increment, no formatting.
+ */
+static inline void results_put(results_t *r, uint64_t bits) {
+    if (r->col == 0 && r->rows == r->capacity) results_grow(r);
+    r->cells[r->col][r->rows] = results_le64(bits);
+    if (++r->col == r->num_columns) {
+        r->col = 0;
+        r->rows++;
+    }
+}
+
+static inline void results_u64(results_t *r, uint64_t v) {
+    results_put(r, v);
+}
+
+static inline void results_i64(results_t *r, int64_t v) {
+    results_put(r, (uint64_t)v);
+}
+
+static inline void results_f64(results_t *r, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    results_put(r, bits);
+}
+
+static inline void results_str(results_t *r, const char *s) {
+    results_put(r, results_intern(r, s));
+}
+
+/**
+ * @brief String cell from a printf format (labels such as "fork_4threads")
+ */
+void results_strf(results_t *r, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Row helpers matching the *_print_csv() functions
+ */
+void results_metrics(results_t *r, const workload_metrics_t *m);
+void results_perf(results_t *r, const perf_counters_t *pc);
+void results_events(results_t *r, const perf_event_list_t *list);
+void results_sched_trace(results_t *r, const sched_trace_run_t *run);
+
+/**
+ * @brief Latency distribution as one string cell (histogram_encode())
+ */
+void results_histogram(results_t *r, const histogram_t *h);
+
+/**
+ * @brief Metrics columns for runs timed without metrics_init/finish
+ *        (kernel counters 0, CPUs -1)
+ */
+void results_runtime(results_t *r, uint64_t timestamp_ns, uint64_t runtime_ns);
+
+#endif /* LRC_RESULTS_H */
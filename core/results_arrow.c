@@ -0,0 +1,492 @@
+/*
+ * results_arrow.c - Arrow IPC file output for the result sink
+ *
+ * Purpose:
+ *   The .lrcr file is only understood by analyze/results.py. Arrow IPC
+ *   is the columnar format pyarrow, polars, DuckDB and pandas map
+ *   directly (pyarrow.ipc.open_file(), pyarrow.memory_map()), and from
+ *   which Parquet is one library call away, so results reach those
+ *   tools without a CSV round trip.
+ *
+ * Design:
+ *   - One file: schema, one dictionary batch per string column, one
+ *     record batch holding every row, footer (Arrow columnar format
+ *     version 5, "ARROW1" magic, little-endian, no compression)
+ *   - u64/i64/f64 columns are the sink's cell arrays written as they are:
+ *     UInt64, Int64 and Float64 buffers share the 8-byte little-endian
+ *     layout the sink already keeps
+ *   - String columns are dictionary-encoded Utf8 with Int32 indices; each
+ *     column gets its own dictionary holding only the strings it uses, so
+ *     per-row histogram strings are stored once
+ *   - The flatbuffer metadata is built back to front by a minimal builder
+ *     below (tables, vectors, strings; no generated code, no library)
+ *   - No validity buffers: the sink has no nulls
+ *
+ * Justification for syscalls:
+ *   None beyond the stdio writes of results_close(); metadata and
+ *   dictionaries are built in memory first.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "results.h"
+
+#define ARROW_MAGIC "ARROW1"
+#define ARROW_METADATA_V5 4
+#define ARROW_CONTINUATION 0xFFFFFFFFu
+
+// Message header and Type union tags (Message.fbs, Schema.fbs)
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_DICTIONARY_BATCH 2
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_UTF8 5
+#define ARROW_PRECISION_DOUBLE 2
+
+#define FB_MAX_FIELDS 8
+
+static uint32_t le32(uint32_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+/*
+ * Flatbuffer builder. The buffer grows downwards from buf + cap; an
+ * object is referenced by the builder size right after it was written
+ * (its distance from the end), which stays valid as the buffer grows.
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t size;
+    int failed;
+} fb_t;
+
+typedef struct {
+    size_t start;                     // Builder size before the first field
+    size_t pos[FB_MAX_FIELDS];        // Field position (0 = absent)
+    int count;
+} fb_table_t;
+
+static uint8_t *fb_prepend(fb_t *b, size_t len) {
+    if (b->size + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 1024;
+        while (cap < b->size + len) cap *= 2;
+        uint8_t *buf = malloc(cap);
+        if (!buf) {
+            b->failed = 1;
+            return NULL;
+        }
+        if (b->size) memcpy(buf + cap - b->size, b->buf + b->cap - b->size, b->size);
+        free(b->buf);
+        b->buf = buf;
+        b->cap = cap;
+    }
+    b->size += len;
+    return b->buf + b->cap - b->size;
+}
+
+/* Pad so that the next len bytes end on an align boundary */
+static void fb_align(fb_t *b, size_t len, size_t align) {
+    size_t pad = (align - (b->size + len) % align) % align;
+    uint8_t *p = pad ? fb_prepend(b, pad) : NULL;
+    if (p) memset(p, 0, pad);
+}
+
+static void fb_bytes(fb_t *b, const void *data, size_t len) {
+    uint8_t *p = fb_prepend(b, len);
+    if (p) memcpy(p, data, len);
+}
+
+/* Little-endian scalar of 1, 2, 4 or 8 bytes, naturally aligned */
+static void fb_scalar(fb_t *b, uint64_t v, size_t bytes) {
+    uint8_t le[8];
+    
+    fb_align(b, bytes, bytes);
+    for (size_t i = 0; i < bytes; i++) le[i] = (uint8_t)(v >> (8 * i));
+    fb_bytes(b, le, bytes);
+}
+
+static size_t fb_string(fb_t *b, const char *s) {
+    size_t len = strlen(s);
+    
+    fb_align(b, len + 1, 4);
+    fb_bytes(b, s, len + 1);
+    fb_scalar(b, len, 4);
+    return b->size;
+}
+
+/* Vector of structs already in little-endian wire layout */
+static size_t fb_struct_vector(fb_t *b, const void *data, size_t count, size_t elem_size) {
+    fb_align(b, count * elem_size, 8);
+    if (count) fb_bytes(b, data, count * elem_size);
+    fb_scalar(b, count, 4);
+    return b->size;
+}
+
+static size_t fb_offset_vector(fb_t *b, const size_t *refs, size_t count) {
+    fb_align(b, count * 4, 4);
+    for (size_t i = count; i-- > 0; ) {
+        fb_scalar(b, b->size + 4 - refs[i], 4);
+    }
+    fb_scalar(b, count, 4);
+    return b->size;
+}
+
+static void fb_table_begin(fb_t *b, fb_table_t *t) {
+    memset(t, 0, sizeof(*t));
+    t->start = b->size;
+}
+
+static void fb_add_scalar(fb_t *b, fb_table_t *t, int id, uint64_t v, size_t bytes) {
+    fb_scalar(b, v, bytes);
+    t->pos[id] = b->size;
+    if (id >= t->count) t->count = id + 1;
+}
+
+static void fb_add_offset(fb_t *b, fb_table_t *t, int id, size_t ref) {
+    fb_align(b, 4, 4);
+    fb_scalar(b, b->size + 4 - ref, 4);
+    t->pos[id] = b->size;
+    if (id >= t->count) t->count = id + 1;
+}
+
+/* Table header (offset to the vtable) and the vtable written just before it */
+static size_t fb_table_end(fb_t *b, fb_table_t *t) {
+    size_t vtable_size = 4 + 2 * (size_t)t->count;
+    
+    fb_scalar(b, vtable_size, 4);            // soffset: vtable sits right below the table
+    size_t table = b->size;
+    
+    for (int id = t->count; id-- > 0; ) {
+        fb_scalar(b, t->pos[id] ? table - t->pos[id] : 0, 2);
+    }
+    fb_scalar(b, table - t->start, 2);
+    fb_scalar(b, vtable_size, 2);
+    return table;
+}
+
+/* Root offset; the finished buffer is a multiple of 8 bytes */
+static void fb_finish(fb_t *b, size_t root) {
+    fb_align(b, 4, 8);
+    fb_scalar(b, b->size + 4 - root, 4);
+}
+
+static const uint8_t *fb_data(const fb_t *b) {
+    return b->buf + b->cap - b->size;
+}
+
+/*
+ * Dictionary of one string column: the strings it uses, in order of
+ * first use, and the per-row index into them.
+ */
+typedef struct {
+    int32_t *indices;                 // Per row, little-endian
+    const char **values;
+    int32_t *offsets;                 // count + 1, little-endian
+    size_t count;
+    size_t bytes;
+} arrow_dict_t;
+
+static int build_dictionary(const results_t *r, int c, int32_t *local, arrow_dict_t *d) {
+    memset(d, 0, sizeof(*d));
+    d->indices = malloc((r->rows ? r->rows : 1) * sizeof(int32_t));
+    d->values = malloc((r->num_strings + 1) * sizeof(char *));
+    d->offsets = malloc((r->num_strings + 2) * sizeof(int32_t));
+    if (!d->indices || !d->values || !d->offsets) return -1;
+    
+    // local[id] = index in this dictionary (-1 = unused); slot num_strings stands for ""
+    for (size_t row = 0; row < r->rows; row++) {
+        uint64_t id = results_le64(r->cells[c][row]);
+        if (id >= r->num_strings) id = r->num_strings;
+        
+        if (local[id] < 0) {
+            const char *s = id < r->num_strings ? r->strings[id] : "";
+            size_t len = strlen(s);
+            if (d->bytes + len > INT32_MAX) {
+                errno = EOVERFLOW;
+                return -1;
+            }
+            local[id] = (int32_t)d->count;
+            d->offsets[d->count] = le32((uint32_t)d->bytes);
+            d->values[d->count++] = s;
+            d->bytes += len;
+        }
+        d->indices[row] = le32((uint32_t)local[id]);
+    }
+    d->offsets[d->count] = le32((uint32_t)d->bytes);
+    
+    // Reset only what this column touched for the next one
+    for (size_t row = 0; row < r->rows; row++) {
+        uint64_t id = results_le64(r->cells[c][row]);
+        local[id >= r->num_strings ? r->num_strings : id] = -1;
+    }
+    return 0;
+}
+
+static void free_dictionary(arrow_dict_t *d) {
+    free(d->indices);
+    free(d->values);
+    free(d->offsets);
+}
+
+/* Int table: bitWidth, is_signed */
+static size_t build_int_type(fb_t *b, int bits, int is_signed) {
+    fb_table_t t;
+    
+    fb_table_begin(b, &t);
+    fb_add_scalar(b, &t, 0, (uint64_t)bits, 4);
+    fb_add_scalar(b, &t, 1, (uint64_t)is_signed, 1);
+    return fb_table_end(b, &t);
+}
+
+static size_t build_field(fb_t *b, const results_t *r, int c) {
+    const result_column_t *col = &r->columns[c];
+    fb_table_t t;
+    size_t type, dictionary = 0;
+    int type_tag;
+    
+    size_t name = fb_string(b, col->name);
+    size_t children = fb_offset_vector(b, NULL, 0);
+    
+    switch (col->type) {
+        case RESULT_F64:
+            fb_table_begin(b, &t);
+            fb_add_scalar(b, &t, 0, ARROW_PRECISION_DOUBLE, 2);
+            type = fb_table_end(b, &t);
+            type_tag = ARROW_TYPE_FLOATING_POINT;
+            break;
+        case RESULT_STR: {
+            size_t index_type = build_int_type(b, 32, 1);
+            fb_table_begin(b, &t);
+            fb_add_scalar(b, &t, 0, (uint64_t)c, 8);             // id
+            fb_add_offset(b, &t, 1, index_type);                 // indexType
+            fb_add_scalar(b, &t, 2, 0, 1);                       // isOrdered
+            dictionary = fb_table_end(b, &t);
+            
+            fb_table_begin(b, &t);                               // Utf8 {}
+            type = fb_table_end(b, &t);
+            type_tag = ARROW_TYPE_UTF8;
+            break;
+        }
+        default:
+            type = build_int_type(b, 64, col->type == RESULT_I64);
+            type_tag = ARROW_TYPE_INT;
+            break;
+    }
+    
+    fb_table_begin(b, &t);
+    fb_add_offset(b, &t, 0, name);
+    fb_add_scalar(b, &t, 1, 0, 1);                               // nullable
+    fb_add_scalar(b, &t, 2, (uint64_t)type_tag, 1);
+    fb_add_offset(b, &t, 3, type);
+    if (dictionary) fb_add_offset(b, &t, 4, dictionary);
+    fb_add_offset(b, &t, 5, children);
+    return fb_table_end(b, &t);
+}
+
+static size_t build_schema(fb_t *b, const results_t *r) {
+    size_t fields[RESULTS_MAX_COLUMNS];
+    fb_table_t t;
+    
+    for (int c = 0; c < r->num_columns; c++) fields[c] = build_field(b, r, c);
+    size_t vector = fb_offset_vector(b, fields, (size_t)r->num_columns);
+    
+    fb_table_begin(b, &t);
+    fb_add_scalar(b, &t, 0, 0, 2);                               // Little endian
+    fb_add_offset(b, &t, 1, vector);
+    return fb_table_end(b, &t);
+}
+
+/* FieldNode, Buffer and Block structs as written on the wire */
+typedef struct { uint64_t a; uint64_t b; } arrow_pair_t;
+typedef struct { uint64_t offset; uint32_t metadata_length; uint32_t pad; uint64_t body_length; } arrow_block_t;
+
+static size_t build_record_batch(fb_t *b, uint64_t length, const arrow_pair_t *nodes, size_t num_nodes,
+                                 const arrow_pair_t *buffers, size_t num_buffers) {
+    fb_table_t t;
+    
+    size_t node_vec = fb_struct_vector(b, nodes, num_nodes, sizeof(arrow_pair_t));
+    size_t buffer_vec = fb_struct_vector(b, buffers, num_buffers, sizeof(arrow_pair_t));
+    
+    fb_table_begin(b, &t);
+    fb_add_scalar(b, &t, 0, length, 8);
+    fb_add_offset(b, &t, 1, node_vec);
+    fb_add_offset(b, &t, 2, buffer_vec);
+    return fb_table_end(b, &t);
+}
+
+static void build_message(fb_t *b, int header_type, size_t header, uint64_t body_length) {
+    fb_table_t t;
+    
+    fb_table_begin(b, &t);
+    fb_add_scalar(b, &t, 0, ARROW_METADATA_V5, 2);
+    fb_add_scalar(b, &t, 1, (uint64_t)header_type, 1);
+    fb_add_offset(b, &t, 2, header);
+    fb_add_scalar(b, &t, 3, body_length, 8);
+    fb_finish(b, fb_table_end(b, &t));
+}
+
+typedef struct {
+    FILE *f;
+    uint64_t pos;
+} arrow_out_t;
+
+static void put(arrow_out_t *out, const void *data, size_t len) {
+    if (len) fwrite(data, 1, len, out->f);
+    out->pos += len;
+}
+
+static void put_padding(arrow_out_t *out, size_t len) {
+    static const uint8_t zeros[8];
+    put(out, zeros, (8 - len % 8) % 8);
+}
+
+static uint64_t padded(uint64_t len) {
+    return (len + 7) & ~(uint64_t)7;
+}
+
+/* Continuation marker, metadata length, flatbuffer; fills the footer block */
+static void put_message(arrow_out_t *out, const fb_t *b, uint64_t body_length, arrow_block_t *block) {
+    uint32_t prefix[2] = { le32(ARROW_CONTINUATION), le32((uint32_t)b->size) };
+    
+    if (block) {
+        block->offset = results_le64(out->pos);
+        block->metadata_length = le32((uint32_t)(sizeof(prefix) + b->size));
+        block->pad = 0;
+        block->body_length = results_le64(body_length);
+    }
+    put(out, prefix, sizeof(prefix));
+    put(out, fb_data(b), b->size);
+}
+
+static void put_dictionary(arrow_out_t *out, fb_t *b, int c, const arrow_dict_t *d, arrow_block_t *block) {
+    uint64_t offsets_len = (d->count + 1) * sizeof(int32_t);
+    arrow_pair_t node = { results_le64(d->count), 0 };
+    arrow_pair_t buffers[3] = {
+        { 0, 0 },                                                   // validity (none)
+        { 0, results_le64(offsets_len) },
+        { results_le64(padded(offsets_len)), results_le64(d->bytes) },
+    };
+    uint64_t body_length = padded(offsets_len) + padded(d->bytes);
+    fb_table_t t;
+    
+    b->size = 0;
+    size_t batch = build_record_batch(b, d->count, &node, 1, buffers, 3);
+    fb_table_begin(b, &t);
+    fb_add_scalar(b, &t, 0, (uint64_t)c, 8);
+    fb_add_offset(b, &t, 1, batch);
+    fb_add_scalar(b, &t, 2, 0, 1);                               // isDelta
+    build_message(b, ARROW_HEADER_DICTIONARY_BATCH, fb_table_end(b, &t), body_length);
+    if (b->failed) return;
+    
+    put_message(out, b, body_length, block);
+    put(out, d->offsets, offsets_len);
+    put_padding(out, offsets_len);
+    for (size_t i = 0; i < d->count; i++) put(out, d->values[i], strlen(d->values[i]));
+    put_padding(out, d->bytes);
+}
+
+static void put_record_batch(arrow_out_t *out, fb_t *b, const results_t *r, const arrow_dict_t *dicts,
+                             arrow_block_t *block) {
+    arrow_pair_t nodes[RESULTS_MAX_COLUMNS];
+    arrow_pair_t buffers[2 * RESULTS_MAX_COLUMNS];
+    uint64_t offset = 0;
+    
+    for (int c = 0; c < r->num_columns; c++) {
+        uint64_t len = r->rows * (r->columns[c].type == RESULT_STR ? sizeof(int32_t) : sizeof(uint64_t));
+        nodes[c].a = results_le64(r->rows);
+        nodes[c].b = 0;
+        buffers[2 * c].a = results_le64(offset);
+        buffers[2 * c].b = 0;
+        buffers[2 * c + 1].a = results_le64(offset);
+        buffers[2 * c + 1].b = results_le64(len);
+        offset += padded(len);
+    }
+    
+    b->size = 0;
+    size_t batch = build_record_batch(b, r->rows, nodes, (size_t)r->num_columns,
+                                      buffers, 2 * (size_t)r->num_columns);
+    build_message(b, ARROW_HEADER_RECORD_BATCH, batch, offset);
+    if (b->failed) return;
+    
+    put_message(out, b, offset, block);
+    for (int c = 0; c < r->num_columns; c++) {
+        if (r->columns[c].type == RESULT_STR) {
+            put(out, dicts[c].indices, r->rows * sizeof(int32_t));
+            put_padding(out, r->rows * sizeof(int32_t));
+        } else {
+            put(out, r->cells[c], r->rows * sizeof(uint64_t));     // Already little-endian
+        }
+    }
+}
+
+int results_write_arrow(const results_t *r, FILE *f) {
+    arrow_out_t out = { f, 0 };
+    arrow_dict_t dicts[RESULTS_MAX_COLUMNS];
+    arrow_block_t dict_blocks[RESULTS_MAX_COLUMNS];
+    arrow_block_t batch_block;
+    fb_t b = { 0 };
+    int num_dicts = 0;
+    int ret = -1;
+    
+    memset(dicts, 0, sizeof(dicts));
+    int32_t *local = malloc((r->num_strings + 1) * sizeof(int32_t));
+    if (!local) return -1;
+    for (size_t i = 0; i <= r->num_strings; i++) local[i] = -1;
+    for (int c = 0; c < r->num_columns; c++) {
+        if (r->columns[c].type == RESULT_STR && build_dictionary(r, c, local, &dicts[c]) != 0) goto out;
+    }
+    
+    put(&out, ARROW_MAGIC "\0\0", 8);
+    
+    build_message(&b, ARROW_HEADER_SCHEMA, build_schema(&b, r), 0);
+    if (b.failed) goto out;
+    put_message(&out, &b, 0, NULL);
+    
+    for (int c = 0; c < r->num_columns; c++) {
+        if (r->columns[c].type != RESULT_STR) continue;
+        put_dictionary(&out, &b, c, &dicts[c], &dict_blocks[num_dicts++]);
+        if (b.failed) goto out;
+    }
+    put_record_batch(&out, &b, r, dicts, &batch_block);
+    if (b.failed) goto out;
+    
+    // End-of-stream marker, then the footer for random access
+    uint32_t eos[2] = { le32(ARROW_CONTINUATION), 0 };
+    put(&out, eos, sizeof(eos));
+    
+    fb_table_t t;
+    b.size = 0;
+    size_t schema = build_schema(&b, r);
+    size_t dict_vec = fb_struct_vector(&b, dict_blocks, (size_t)num_dicts, sizeof(arrow_block_t));
+    size_t batch_vec = fb_struct_vector(&b, &batch_block, 1, sizeof(arrow_block_t));
+    fb_table_begin(&b, &t);
+    fb_add_scalar(&b, &t, 0, ARROW_METADATA_V5, 2);
+    fb_add_offset(&b, &t, 1, schema);
+    fb_add_offset(&b, &t, 2, dict_vec);
+    fb_add_offset(&b, &t, 3, batch_vec);
+    fb_finish(&b, fb_table_end(&b, &t));
+    if (b.failed) goto out;
+    
+    uint32_t footer_length = le32((uint32_t)b.size);
+    put(&out, fb_data(&b), b.size);
+    put(&out, &footer_length, sizeof(footer_length));
+    put(&out, ARROW_MAGIC, 6);
+    ret = 0;
+
+out:
+    for (int c = 0; c < r->num_columns; c++) free_dictionary(&dicts[c]);
+    free(local);
+    free(b.buf);
+    if (ret != 0 && errno == 0) errno = ENOMEM;
+    return ret;
+}
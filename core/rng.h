@@ -0,0 +1,71 @@
+/*
+ * rng.h - Fast seeded pseudo-random number generation
+ *
+ * xoshiro256** seeded through splitmix64. Used to build access patterns
+ * outside the timed region: much faster than rand(), reproducible for a
+ * given seed, and independent per thread (no hidden global state).
+ */
+
+#ifndef LRC_RNG_H
+#define LRC_RNG_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t s[4];
+} lrc_rng_t;
+
+static inline uint64_t lrc_rng_splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Seed generator (any seed, including 0, is valid)
+ */
+static inline void lrc_rng_seed(lrc_rng_t *rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = lrc_rng_splitmix64(&seed);
+    }
+}
+
+static inline uint64_t lrc_rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * @brief Next 64-bit value
+ */
+static inline uint64_t lrc_rng_next(lrc_rng_t *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = lrc_rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = lrc_rng_rotl(s[3], 45);
+
+    return result;
+}
+
+/**
+ * @brief Uniform value in [0, bound) without division (Lemire's method)
+ * @note Bias is at most bound/2^64, negligible for buffer-sized bounds
+ */
+static inline uint64_t lrc_rng_bounded(lrc_rng_t *rng, uint64_t bound) {
+    return (uint64_t)(((unsigned __int128)lrc_rng_next(rng) * bound) >> 64);
+}
+
+/**
+ * @brief Uniform double in [0, 1)
+ */
+static inline double lrc_rng_double(lrc_rng_t *rng) {
+    return (lrc_rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif /* LRC_RNG_H */
@@ -0,0 +1,171 @@
+/*
+ * run_control.c - Sequential run-count controller
+ *
+ * Purpose:
+ *   Every scenario hard-coded RUNS, so a 0.1% noise experiment ran as
+ *   long as a 10% one, and the noisy one was still under-sampled.
+ *   power_analysis.py could say how many runs were needed only after the
+ *   data was collected.
+ *
+ * Design:
+ *   - Warmup runs are executed and discarded (cold caches, page faults,
+ *     frequency ramp)
+ *   - After each measured run the samples are kept sorted and the 95%
+ *     CI of the median is taken from order statistics: ranks
+ *     n/2 -/+ 1.96 * sqrt(n) / 2 (no normality assumption, robust to the
+ *     outliers that dominate scheduler data)
+ *   - Stop when the relative CI half-width is below the target after at
+ *     least min_runs (raised to 8, the smallest n with a CI), at
+ *     max_runs, or when the wall-time budget is spent
+ *   - LRC_RUNS=N restores a fixed count for comparisons with old data
+ *
+ * Justification for syscalls:
+ *   clock_gettime() once per run, between runs, for the budget check.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "run_control.h"
+
+#define Z_95 1.96
+#define DEFAULT_WARMUP 1
+#define DEFAULT_TARGET 0.02
+#define DEFAULT_BUDGET_S 30.0
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int env_int(const char *name, int fallback) {
+    const char *env = getenv(name);
+    return env && *env ? atoi(env) : fallback;
+}
+
+static double env_double(const char *name, double fallback) {
+    const char *env = getenv(name);
+    return env && *env ? atof(env) : fallback;
+}
+
+static int clamp_runs(int runs) {
+    if (runs < 1) return 1;
+    return runs > RUN_CONTROL_MAX_RUNS ? RUN_CONTROL_MAX_RUNS : runs;
+}
+
+void run_control_begin(run_control_t *rc, int min_runs, int max_runs) {
+    int fixed = env_int("LRC_RUNS", 0);
+    
+    rc->runs = 0;
+    rc->stop = RUN_STOP_NONE;
+    rc->median = 0.0;
+    rc->ci_low = rc->ci_high = 0.0;
+    rc->rel_halfwidth = -1.0;
+    
+    if (fixed > 0) {
+        rc->fixed = 1;
+        rc->warmup = 0;
+        rc->min_runs = rc->max_runs = clamp_runs(fixed);
+        rc->target = 0.0;
+        rc->budget_ns = 0;
+    } else {
+        rc->fixed = 0;
+        rc->warmup = env_int("LRC_WARMUP", DEFAULT_WARMUP);
+        rc->max_runs = clamp_runs(env_int("LRC_MAX_RUNS", max_runs));
+        rc->min_runs = clamp_runs(env_int("LRC_MIN_RUNS", min_runs));
+        if (rc->min_runs < RUN_CONTROL_MIN_CI_RUNS) rc->min_runs = RUN_CONTROL_MIN_CI_RUNS;
+        if (rc->min_runs > rc->max_runs) rc->min_runs = rc->max_runs;
+        rc->target = env_double("LRC_CI_TARGET", DEFAULT_TARGET);
+        double budget_s = env_double("LRC_RUN_BUDGET_S", DEFAULT_BUDGET_S);
+        rc->budget_ns = budget_s > 0 ? (uint64_t)(budget_s * 1e9) : 0;
+    }
+    if (rc->warmup < 0) rc->warmup = 0;
+    
+    rc->warmup_left = rc->warmup;
+    rc->start_ns = now_ns();
+}
+
+int run_control_next(run_control_t *rc) {
+    if (rc->stop != RUN_STOP_NONE) return 0;
+    if (rc->warmup_left > 0) return 1;
+    
+    if (rc->runs >= rc->max_runs) {
+        rc->stop = rc->fixed ? RUN_STOP_FIXED : RUN_STOP_MAX_RUNS;
+    } else if (rc->runs >= rc->min_runs && rc->target > 0 &&
+               rc->rel_halfwidth >= 0 && rc->rel_halfwidth <= rc->target) {
+        rc->stop = RUN_STOP_CONVERGED;
+    } else if (rc->budget_ns && rc->runs >= 1 && now_ns() - rc->start_ns >= rc->budget_ns) {
+        rc->stop = RUN_STOP_BUDGET;
+    }
+    return rc->stop == RUN_STOP_NONE;
+}
+
+/* Median and order-statistic CI over the sorted samples */
+static void update_stats(run_control_t *rc) {
+    int n = rc->runs;
+    const double *x = rc->samples;
+    
+    rc->median = (n % 2) ? x[n / 2] : 0.5 * (x[n / 2 - 1] + x[n / 2]);
+    
+    // 1-based ranks j = floor(n/2 - h), k = ceil(1 + n/2 + h)
+    double h = Z_95 * sqrt((double)n) / 2.0;
+    int j = (int)(n / 2.0 - h);
+    double upper = 1.0 + n / 2.0 + h;
+    int k = (int)upper;
+    if (k < upper) k++;
+    
+    if (j < 1 || k > n || rc->median <= 0.0) {
+        rc->ci_low = rc->ci_high = 0.0;
+        rc->rel_halfwidth = -1.0;
+        return;
+    }
+    rc->ci_low = x[j - 1];
+    rc->ci_high = x[k - 1];
+    rc->rel_halfwidth = (rc->ci_high - rc->ci_low) / 2.0 / rc->median;
+}
+
+int run_control_add(run_control_t *rc, double value) {
+    if (rc->warmup_left > 0) {
+        rc->warmup_left--;
+        if (rc->warmup_left == 0) rc->start_ns = now_ns();  // Budget covers measured runs
+        return 0;
+    }
+    if (rc->runs >= RUN_CONTROL_MAX_RUNS) return 1;
+    
+    // Insertion keeps samples sorted; n is small and this runs between runs
+    int i = rc->runs;
+    while (i > 0 && rc->samples[i - 1] > value) {
+        rc->samples[i] = rc->samples[i - 1];
+        i--;
+    }
+    rc->samples[i] = value;
+    rc->runs++;
+    
+    update_stats(rc);
+    return 1;
+}
+
+const char *run_control_stop_name(run_stop_t stop) {
+    switch (stop) {
+        case RUN_STOP_CONVERGED: return "converged";
+        case RUN_STOP_MAX_RUNS: return "max_runs";
+        case RUN_STOP_BUDGET: return "budget";
+        case RUN_STOP_FIXED: return "fixed";
+        default: return "running";
+    }
+}
+
+void run_control_report(const run_control_t *rc, const char *label) {
+    if (rc->rel_halfwidth >= 0) {
+        printf("  %-24s %4d runs, median %.4g, 95%% CI +/-%.2f%% (%s)\n", label, rc->runs,
+               rc->median, rc->rel_halfwidth * 100.0, run_control_stop_name(rc->stop));
+    } else {
+        printf("  %-24s %4d runs, median %.4g, CI n/a (%s)\n", label, rc->runs,
+               rc->median, run_control_stop_name(rc->stop));
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * run_control.h - Sequential run-count controller
+ *
+ * Replaces fixed RUNS loops: after a few discarded warmup runs, keep
+ * measuring until the distribution-free 95% confidence interval of the
+ * median is narrow enough (relative half-width below a target), the
+ * run cap is reached, or a wall-time budget runs out.
+ *
+ *     run_control_t rc;
+ *     run_control_begin(&rc, 5, MAX_RUNS);
+ *     while (run_control_next(&rc)) {
+ *         metrics_init(&m); workload(); metrics_finish(&m);
+ *         if (!run_control_add(&rc, m.runtime_ns)) continue;   // Warmup
+ *         results_u64(&out, run_control_index(&rc)); ...
+ *     }
+ *     run_control_report(&rc, "label");
+ *
+ * Environment (read by run_control_begin):
+ *   LRC_RUNS=N          Fixed N measured runs, no warmup (old behaviour)
+ *   LRC_WARMUP=N        Discarded runs before measuring (default 1)
+ *   LRC_MIN_RUNS=N      Override the scenario's minimum (at least 8)
+ *   LRC_MAX_RUNS=N      Override the scenario's cap
+ *   LRC_CI_TARGET=F     Relative CI half-width of the median (default 0.02)
+ *   LRC_RUN_BUDGET_S=F  Wall time per measured point (default 30)
+ */
+
+#ifndef LRC_RUN_CONTROL_H
+#define LRC_RUN_CONTROL_H
+
+#include <stdint.h>
+
+#define RUN_CONTROL_MAX_RUNS 1024
+#define RUN_CONTROL_MIN_CI_RUNS 8   // Smallest n whose order-statistic CI exists
+
+typedef enum {
+    RUN_STOP_NONE = 0,        // Still sampling
+    RUN_STOP_CONVERGED,       // CI half-width below target
+    RUN_STOP_MAX_RUNS,        // Reached the run cap
+    RUN_STOP_BUDGET,          // Wall-time budget exhausted
+    RUN_STOP_FIXED            // LRC_RUNS fixed count done
+} run_stop_t;
+
+typedef struct {
+    int warmup;               // Discarded runs before measuring
+    int min_runs;
+    int max_runs;
+    double target;            // Relative half-width, <= 0 = never converge
+    uint64_t budget_ns;       // 0 = unlimited
+    int fixed;                // LRC_RUNS set
+    
+    int warmup_left;
+    int runs;                 // Measured samples so far
+    uint64_t start_ns;
+    run_stop_t stop;
+    
+    double median;            // Valid after each run_control_add()
+    double ci_low;            // 95% CI of the median (0 until enough runs)
+    double ci_high;
+    double rel_halfwidth;     // (ci_high - ci_low) / 2 / median, -1 = undefined
+    
+    double samples[RUN_CONTROL_MAX_RUNS];   // Measured values, kept sorted
+} run_control_t;
+
+/**
+ * @brief Start a measured point
+ * @param min_runs Measured runs before convergence is considered; raised
+ *        to RUN_CONTROL_MIN_CI_RUNS (the median CI is undefined below 8)
+ * @param max_runs Cap on measured runs (clamped to RUN_CONTROL_MAX_RUNS)
+ * @note Environment overrides are documented above
+ */
+void run_control_begin(run_control_t *rc, int min_runs, int max_runs);
+
+/**
+ * @brief Whether to do another run (warmup or measured)
+ * @return 1 to run again, 0 when a stop condition was met
+ */
+int run_control_next(run_control_t *rc);
+
+/**
+ * @brief Record the value of the run just finished (e.g. runtime_ns)
+ * @return 1 if it was a measured run, 0 for a discarded warmup run
+ */
+int run_control_add(run_control_t *rc, double value);
+
+/**
+ * @brief Index of the last measured run (0-based, for the "run" column)
+ */
+static inline int run_control_index(const run_control_t *rc) {
+    return rc->runs - 1;
+}
+
+/**
+ * @brief Stop reason as text ("converged", "max_runs", "budget", "fixed")
+ */
+const char *run_control_stop_name(run_stop_t stop);
+
+/**
+ * @brief Print runs, median and CI half-width of the finished point
+ */
+void run_control_report(const run_control_t *rc, const char *label);
+
+#endif /* LRC_RUN_CONTROL_H */
@@ -0,0 +1,371 @@
+/*
+ * sampler.c - In-run timeline sampling
+ *
+ * Purpose:
+ *   Turn one before/after delta per run into a time series, so that
+ *   throttling, migration or interference halfway through a run can be
+ *   seen within that run.
+ *
+ * Design:
+ *   - Sampler thread wakes every interval (absolute deadlines) and
+ *     snapshots cumulative counters of the measured thread
+ *   - Records go into a preallocated single-producer/single-consumer
+ *     ring; the consumer only drains after the run
+ *   - The workload thread executes no extra instructions in its loop
+ *
+ * Justification for syscalls:
+ *   pread() on /proc/self/task/<tid>/{stat,status} (fds opened once) and
+ *   read() on the perf group leader are the only way to observe another
+ *   thread's counters. They run on the sampler thread, not the workload.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "sampler.h"
+#include "sched_api.h"
+
+/*
+ * Deadlines and sample stamps share one clock, so intervals match the
+ * sampling period. clock_nanosleep() cannot sleep on CLOCK_MONOTONIC_RAW.
+ */
+#define SAMPLER_CLOCK CLOCK_MONOTONIC
+
+static uint64_t get_timestamp_ns(void) {
+    struct timespec ts;
+    clock_gettime(SAMPLER_CLOCK, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+/*
+ * Parse minflt (field 10), majflt (field 12) and processor (field 39)
+ * from /proc/<pid>/task/<tid>/stat. Fields are counted after the
+ * closing ')' of comm, which may itself contain spaces.
+ */
+static void parse_stat(const char *buf, sampler_record_t *rec) {
+    const char *p = strrchr(buf, ')');
+    if (!p) return;
+    p++;
+    
+    // p now points before field 3
+    for (int field = 3; *p && field <= 39; field++) {
+        while (*p == ' ') p++;
+        
+        if (field == 10) rec->minor_page_faults = strtoull(p, NULL, 10);
+        else if (field == 12) rec->major_page_faults = strtoull(p, NULL, 10);
+        else if (field == 39) rec->cpu = (int)strtol(p, NULL, 10);
+        
+        while (*p && *p != ' ') p++;
+    }
+}
+
+static uint64_t parse_status_field(const char *buf, const char *key) {
+    const char *p = strstr(buf, key);
+    if (!p) return 0;
+    return strtoull(p + strlen(key), NULL, 10);
+}
+
+static void take_sample(sampler_t *s, sampler_record_t *rec) {
+    char buf[2048];
+    ssize_t n;
+    
+    memset(rec, 0, sizeof(*rec));
+    rec->cpu = -1;
+    rec->timestamp_ns = get_timestamp_ns();
+    
+    if (s->events) {
+        uint64_t values[s->events->count > 0 ? s->events->count : 1];
+        if (perf_event_list_read(s->events, values,
+                                 &rec->time_enabled, &rec->time_running) == 0) {
+            int count = s->events->count < SAMPLER_MAX_EVENTS ?
+                        s->events->count : SAMPLER_MAX_EVENTS;
+            memcpy(rec->values, values, count * sizeof(uint64_t));
+        }
+    }
+    
+    if (s->stat_fd >= 0 && (n = pread(s->stat_fd, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[n] = '\0';
+        parse_stat(buf, rec);
+    }
+    
+    if (s->status_fd >= 0 && (n = pread(s->status_fd, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[n] = '\0';
+        // "nonvoluntary_" contains "voluntary_", so match the line start
+        rec->voluntary_ctxt_switches = parse_status_field(buf, "\nvoluntary_ctxt_switches:");
+        rec->nonvoluntary_ctxt_switches = parse_status_field(buf, "nonvoluntary_ctxt_switches:");
+    }
+}
+
+/*
+ * Producer side: write slot then publish head with release ordering.
+ */
+static void push_sample(sampler_t *s) {
+    size_t head = s->head;
+    size_t tail = __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE);
+    
+    if (head - tail == s->capacity) {
+        s->dropped++;
+        return;
+    }
+    
+    take_sample(s, &s->ring[head & (s->capacity - 1)]);
+    __atomic_store_n(&s->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void *sampler_thread(void *arg) {
+    sampler_t *s = arg;
+    
+    if (s->sampler_cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(sched_map_cpu(s->sampler_cpu), &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    }
+    
+    struct timespec next;
+    clock_gettime(SAMPLER_CLOCK, &next);
+    
+    while (!__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) {
+        next.tv_nsec += s->interval_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(SAMPLER_CLOCK, TIMER_ABSTIME, &next, NULL);
+        
+        if (__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) break;
+        push_sample(s);
+        
+        // Skip deadlines already missed instead of sampling in a burst
+        struct timespec now;
+        clock_gettime(SAMPLER_CLOCK, &now);
+        while (next.tv_sec < now.tv_sec ||
+               (next.tv_sec == now.tv_sec && next.tv_nsec < now.tv_nsec)) {
+            next.tv_nsec += s->interval_ns;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+int sampler_init(sampler_t *s, const perf_event_list_t *events,
+                 uint64_t interval_us, size_t capacity, int sampler_cpu) {
+    char path[64];
+    
+    memset(s, 0, sizeof(sampler_t));
+    s->stat_fd = -1;
+    s->status_fd = -1;
+    s->instructions_index = -1;
+    s->events = events;
+    s->interval_ns = (interval_us > 0 ? interval_us : 1) * 1000ULL;
+    s->sampler_cpu = sampler_cpu;
+    s->capacity = round_up_pow2(capacity > 2 ? capacity : 2);
+    
+    s->ring = calloc(s->capacity, sizeof(sampler_record_t));
+    if (!s->ring) return -1;
+    
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+    s->stat_fd = open(path, O_RDONLY);
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", tid);
+    s->status_fd = open(path, O_RDONLY);
+    
+    if (events) {
+        for (int i = 0; i < events->count && i < SAMPLER_MAX_EVENTS; i++) {
+            const perf_event_t *ev = &events->events[i];
+            if (ev->fd >= 0 && ev->type == PERF_TYPE_HARDWARE &&
+                ev->config == PERF_COUNT_HW_INSTRUCTIONS) {
+                s->instructions_index = i;
+                break;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+int sampler_start(sampler_t *s) {
+    s->head = 0;
+    s->tail = 0;
+    s->dropped = 0;
+    s->stop = 0;
+    
+    // Baseline sample from the caller, so the first interval starts here
+    push_sample(s);
+    
+    if (pthread_create(&s->thread, NULL, sampler_thread, s) != 0) {
+        return -1;
+    }
+    
+    s->running = 1;
+    return 0;
+}
+
+void sampler_stop(sampler_t *s) {
+    if (!s->running) return;
+    
+    __atomic_store_n(&s->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(s->thread, NULL);
+    s->running = 0;
+    
+    // Final sample closes the last partial interval. On a full ring it
+    // replaces the newest periodic sample (counted as dropped), so the
+    // timeline still ends at stop; the producer thread is gone by now
+    size_t tail = __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE);
+    if (s->head - tail == s->capacity) {
+        s->dropped++;
+        take_sample(s, &s->ring[(s->head - 1) & (s->capacity - 1)]);
+    } else {
+        push_sample(s);
+    }
+}
+
+void sampler_print_csv_header(FILE *out, const sampler_t *s) {
+    fprintf(out, "series,sample,interval_ns,timestamp_ns,runtime_ns,");
+    fprintf(out, "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,");
+    fprintf(out, "minor_page_faults,major_page_faults,start_cpu,end_cpu,");
+    
+    if (s->events) {
+        for (int i = 0; i < s->events->count && i < SAMPLER_MAX_EVENTS; i++) {
+            fprintf(out, "%s,", s->events->events[i].name);
+        }
+    }
+    fprintf(out, "perf_running_ratio,ns_per_mi,dropped\n");
+}
+
+void sampler_add_columns(results_t *r, const sampler_t *s) {
+    results_add_column(r, "series", RESULT_STR, 0);
+    results_add_column(r, "sample", RESULT_U64, 0);
+    results_add_column(r, "interval_ns", RESULT_U64, 0);
+    results_add_metrics_columns(r);
+    
+    if (s->events) {
+        for (int i = 0; i < s->events->count && i < SAMPLER_MAX_EVENTS; i++) {
+            results_add_column(r, s->events->events[i].name, RESULT_U64, 0);
+        }
+    }
+    results_add_column(r, "perf_running_ratio", RESULT_F64, 3);
+    results_add_column(r, "ns_per_mi", RESULT_U64, 0);
+    results_add_column(r, "dropped", RESULT_U64, 0);
+}
+
+/*
+ * Drain the ring into a CSV stream (out) or a result sink (r).
+ */
+static size_t sampler_drain(sampler_t *s, const char *series, FILE *out, results_t *r) {
+    size_t head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+    size_t mask = s->capacity - 1;
+    size_t rows = 0;
+    int count = 0;
+    
+    if (s->events) {
+        count = s->events->count < SAMPLER_MAX_EVENTS ? s->events->count : SAMPLER_MAX_EVENTS;
+    }
+    
+    if (head - s->tail < 2) {
+        __atomic_store_n(&s->tail, head, __ATOMIC_RELEASE);
+        return 0;
+    }
+    
+    const sampler_record_t *prev = &s->ring[s->tail & mask];
+    
+    for (size_t i = s->tail + 1; i != head; i++) {
+        const sampler_record_t *cur = &s->ring[i & mask];
+        uint64_t interval = cur->timestamp_ns - prev->timestamp_ns;
+        uint64_t enabled = cur->time_enabled - prev->time_enabled;
+        uint64_t running = cur->time_running - prev->time_running;
+        double scale = running ? (double)enabled / running : 0.0;
+        
+        // Interval normalized to fixed work when instructions are counted
+        uint64_t ns_per_mi = 0;
+        if (s->instructions_index >= 0) {
+            uint64_t insns = cur->values[s->instructions_index] -
+                             prev->values[s->instructions_index];
+            insns = (uint64_t)(insns * scale + 0.5);
+            ns_per_mi = insns ? (uint64_t)((double)interval * SAMPLER_WORK_UNIT / insns) : 0;
+        }
+        
+        uint64_t vol = cur->voluntary_ctxt_switches - prev->voluntary_ctxt_switches;
+        uint64_t nonvol = cur->nonvoluntary_ctxt_switches - prev->nonvoluntary_ctxt_switches;
+        uint64_t minflt = cur->minor_page_faults - prev->minor_page_faults;
+        uint64_t majflt = cur->major_page_faults - prev->major_page_faults;
+        double ratio = enabled ? (double)running / enabled : 0.0;
+        
+        if (r) {
+            results_str(r, series);
+            results_u64(r, rows);
+            results_u64(r, interval);
+            results_u64(r, cur->timestamp_ns);
+            results_u64(r, interval);
+            results_u64(r, vol);
+            results_u64(r, nonvol);
+            results_u64(r, minflt);
+            results_u64(r, majflt);
+            results_i64(r, prev->cpu);
+            results_i64(r, cur->cpu);
+            for (int e = 0; e < count; e++) {
+                uint64_t delta = cur->values[e] - prev->values[e];
+                results_u64(r, (uint64_t)(delta * scale + 0.5));
+            }
+            results_f64(r, ratio);
+            results_u64(r, ns_per_mi);
+            results_u64(r, s->dropped);
+        } else {
+            fprintf(out, "%s,%zu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%d,%d,",
+                    series, rows, interval, cur->timestamp_ns, interval,
+                    vol, nonvol, minflt, majflt, prev->cpu, cur->cpu);
+            
+            for (int e = 0; e < count; e++) {
+                uint64_t delta = cur->values[e] - prev->values[e];
+                fprintf(out, "%lu,", (uint64_t)(delta * scale + 0.5));
+            }
+            fprintf(out, "%.3f,%lu,%lu\n", ratio, ns_per_mi, s->dropped);
+        }
+        
+        prev = cur;
+        rows++;
+    }
+    
+    __atomic_store_n(&s->tail, head, __ATOMIC_RELEASE);
+    return rows;
+}
+
+size_t sampler_print_csv(FILE *out, sampler_t *s, const char *series) {
+    return sampler_drain(s, series, out, NULL);
+}
+
+size_t sampler_record(results_t *r, sampler_t *s, const char *series) {
+    return sampler_drain(s, series, NULL, r);
+}
+
+void sampler_destroy(sampler_t *s) {
+    sampler_stop(s);
+    
+    if (s->stat_fd >= 0) close(s->stat_fd);
+    if (s->status_fd >= 0) close(s->status_fd);
+    free(s->ring);
+    
+    memset(s, 0, sizeof(sampler_t));
+    s->stat_fd = -1;
+    s->status_fd = -1;
+}
@@ -0,0 +1,125 @@
+/*
+ * sampler.h - In-run timeline sampling
+ *
+ * A sampler thread snapshots the measured thread's perf event list and
+ * kernel counters every N microseconds into a preallocated SPSC ring.
+ * Nothing is written from the workload's hot path; the ring is flushed
+ * as a time series after the run.
+ */
+
+#ifndef LRC_SAMPLER_H
+#define LRC_SAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "perf_counters.h"
+#include "results.h"
+
+#define SAMPLER_MAX_EVENTS 16
+
+/* Instructions per "unit of work" used for the ns_per_mi column */
+#define SAMPLER_WORK_UNIT 1000000ULL
+
+/**
+ * @brief One snapshot of cumulative counters
+ */
+typedef struct {
+    uint64_t timestamp_ns;           // CLOCK_MONOTONIC, the clock deadlines use
+    uint64_t voluntary_ctxt_switches;
+    uint64_t nonvoluntary_ctxt_switches;
+    uint64_t minor_page_faults;
+    uint64_t major_page_faults;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[SAMPLER_MAX_EVENTS];
+    int cpu;
+} sampler_record_t;
+
+/**
+ * @brief Sampler state (single producer: sampler thread,
+ *        single consumer: sampler_print_csv or sampler_record after the run)
+ */
+typedef struct {
+    sampler_record_t *ring;
+    size_t capacity;                 // power of two
+    size_t head;                     // next slot to write (producer)
+    size_t tail;                     // next slot to read (consumer)
+    uint64_t dropped;                // samples lost because ring was full
+
+    const perf_event_list_t *events; // may be NULL (kernel counters only)
+    int instructions_index;          // events[] index used for ns_per_mi, -1 if none
+    uint64_t interval_ns;
+    int sampler_cpu;                 // CPU for the sampler thread, -1 = unpinned
+
+    int stat_fd;                     // /proc/self/task/<tid>/stat
+    int status_fd;                   // /proc/self/task/<tid>/status
+
+    pthread_t thread;
+    int running;
+    volatile int stop;
+} sampler_t;
+
+/**
+ * @brief Prepare a sampler for the calling thread
+ * @param s Sampler to initialize
+ * @param events Opened perf event list of the calling thread (or NULL)
+ * @param interval_us Sampling period in microseconds
+ * @param capacity Ring size in samples (rounded up to a power of two)
+ * @param sampler_cpu CPU to pin the sampler thread to, -1 for no pinning
+ * @return 0 on success, -1 on error
+ * @note Must be called from the thread that will be measured
+ */
+int sampler_init(sampler_t *s, const perf_event_list_t *events,
+                 uint64_t interval_us, size_t capacity, int sampler_cpu);
+
+/**
+ * @brief Take a baseline sample and start the sampler thread
+ * @return 0 on success, -1 on error
+ */
+int sampler_start(sampler_t *s);
+
+/**
+ * @brief Stop the sampler thread and take a final sample
+ * @note The final sample is always kept: on a full ring it replaces the
+ *       newest periodic one, which is counted in dropped
+ */
+void sampler_stop(sampler_t *s);
+
+/**
+ * @brief CSV header for sampler_print_csv (ends the line)
+ */
+void sampler_print_csv_header(FILE *out, const sampler_t *s);
+
+/**
+ * @brief Drain the ring as one row per interval (deltas between samples)
+ * @param series Label written in the series column (e.g. "64MB_DRAM_run3")
+ * @return Number of rows written
+ * @note runtime_ns is the interval length. ns_per_mi is the interval
+ *       scaled to SAMPLER_WORK_UNIT instructions, so a slowdown within the
+ *       run shows up the same way it does across runs (0 without an
+ *       instructions counter or when none retired). dropped is the number
+ *       of samples lost to a full ring in this run; intervals next to a
+ *       loss span several sampling periods
+ */
+size_t sampler_print_csv(FILE *out, sampler_t *s, const char *series);
+
+/**
+ * @brief Schema matching sampler_print_csv_header(), for sampler_record()
+ */
+void sampler_add_columns(results_t *r, const sampler_t *s);
+
+/**
+ * @brief Drain the ring into a result sink (same rows as sampler_print_csv)
+ * @return Number of rows appended
+ */
+size_t sampler_record(results_t *r, sampler_t *s, const char *series);
+
+/**
+ * @brief Release ring and file descriptors
+ */
+void sampler_destroy(sampler_t *s);
+
+#endif /* LRC_SAMPLER_H */
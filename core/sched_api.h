@@ -9,11 +9,19 @@
 
 /**
  * @brief Pin calling thread to specific CPU
- * @param cpu CPU ID to pin to (0-based)
+ * @param cpu CPU ID to pin to (0-based), mapped through sched_map_cpu()
  * @return 0 on success, -1 on error
  */
 int pin_to_cpu(int cpu);
 
+/**
+ * @brief Translate a scenario CPU index into a CPU id
+ * @param cpu CPU index as written in the scenario (0-based)
+ * @return cpu itself, or the (cpu % n)-th entry of $LRC_CPU_SET (a CPU
+ *         list set by the suite runner for partitioned runs)
+ */
+int sched_map_cpu(int cpu);
+
 /**
  * @brief Set scheduling priority (nice value)
  * @param nice_value Priority (-20 to 19, lower = higher priority)
@@ -0,0 +1,806 @@
+/*
+ * sched_trace.c - In-process scheduler tracing with eBPF
+ *
+ * Purpose:
+ *   analyze/ebpf_tracer.py runs BCC in a second process and polls every
+ *   100 ms: its events cannot be tied to individual runs, and Python
+ *   wakeups perturb short scenarios. Here the scenario itself loads the
+ *   programs, tags events with the current run id in the kernel and
+ *   drains them between runs, so each result row gets its exact off-CPU,
+ *   migration and interrupt figures.
+ *
+ * Design:
+ *   - No libbpf, no clang: six small programs are emitted as BPF
+ *     instructions below and loaded with bpf(BPF_PROG_LOAD), then attached
+ *     with a tracepoint perf event and PERF_EVENT_IOC_SET_BPF (the same
+ *     attach libbpf uses); core/async_io.c drives io_uring the same way
+ *   - Tracepoint field offsets are read from tracefs format files at open,
+ *     so the programs follow the running kernel's layout (sched_migrate_task
+ *     changed in 6.x) without BTF: the tracepoint analogue of CO-RE
+ *     relocations
+ *   - Threads are matched by tgid in this process's pid namespace
+ *     (bpf_get_ns_current_pid_tgid), so containers work; events carry the
+ *     namespace tid, i.e. what gettid() returns
+ *   - A config array holds the run id; 0 between runs, so nothing is
+ *     recorded (or sent to the ring) outside sched_trace_begin/end
+ *   - sched_switch: switch-out of one of our threads stores its time in an
+ *     LRU hash keyed by global tid; the switch-in computes the interval in
+ *     the kernel. IRQ/softirq entry stores the time in a per-CPU slot when
+ *     it interrupts one of our threads; exit emits the duration
+ *   - Records are 40 bytes, written with bpf_ringbuf_output(); a failed
+ *     output increments a drop counter in the config value
+ *   - Kernel timestamps are CLOCK_MONOTONIC (bpf_ktime_get_ns) and are
+ *     converted to TSC ticks at drain with a clock/TSC pair taken at open
+ *
+ * Justification for syscalls:
+ *   bpf() and perf_event_open() at open; one bpf(BPF_MAP_UPDATE_ELEM) at
+ *   begin and end and one lookup at end. Draining reads the mmap'd ring
+ *   without syscalls. None of it runs inside a measured interval.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <linux/bpf.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "sched_trace.h"
+#include "tsc.h"
+
+#define RING_SIZE (4u << 20)          // Power of two, multiple of the page size
+#define MAX_THREADS 16384
+#define MAX_INSNS 128
+#define LOG_SIZE (64 * 1024)
+#define BUSY_SPINS 100000             // Wait for a record another CPU is still writing
+
+#define SLOT_IRQ 0
+#define SLOT_SOFTIRQ 1
+
+static const char *tracefs_roots[] = { "/sys/kernel/tracing", "/sys/kernel/debug/tracing" };
+
+/* Ring buffer record, filled on the BPF stack at fp-64 */
+typedef struct {
+    uint64_t ts_ns;
+    uint64_t value;
+    uint64_t run_id;
+    uint32_t tid;
+    uint32_t arg;
+    uint16_t type;
+    uint16_t cpu;
+    uint32_t pad;
+} trace_record_t;
+
+/* Config array value */
+typedef struct {
+    uint64_t run_id;
+    uint32_t tgid;
+    uint32_t pad;
+    uint64_t dropped;
+} trace_config_t;
+
+/* Threads hash value */
+typedef struct {
+    uint64_t off_ns;              // Switch-out time, 0 while on CPU
+    uint64_t run_id;              // Run of the switch-out; others are stale
+    uint32_t tid;                 // Namespace tid
+    uint32_t pad;
+} trace_thread_t;
+
+/* Stack layout shared by all programs (offsets from the frame pointer) */
+#define FP_RECORD   (-64)         // trace_record_t
+#define FP_TS       (-72)
+#define FP_THREAD   (-96)         // trace_thread_t
+#define FP_TID_KEY  (-100)
+#define FP_NSINFO   (-108)        // struct bpf_pidns_info
+#define FP_KEY      (-112)
+
+#define REC(field) (FP_RECORD + (int)offsetof(trace_record_t, field))
+#define THREAD(field) (FP_THREAD + (int)offsetof(trace_thread_t, field))
+#define NSINFO(field) (FP_NSINFO + (int)offsetof(struct bpf_pidns_info, field))
+
+/* Tracepoint fields the programs read */
+typedef struct {
+    int offset;
+    int size;
+} tp_field_t;
+
+/*
+ * Minimal BPF assembler: instructions plus forward jumps to labels.
+ */
+#define MAX_LABELS 2
+#define MAX_FIXUPS 32
+
+typedef struct {
+    struct bpf_insn insns[MAX_INSNS];
+    int count;
+    int labels[MAX_LABELS];
+    struct { int insn; int label; } fixups[MAX_FIXUPS];
+    int num_fixups;
+    int overflow;
+} bpf_prog_t;
+
+enum { L_EXIT = 0, L_NEXT };
+
+static void emit(bpf_prog_t *p, uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+    if (p->count >= MAX_INSNS) {
+        p->overflow = 1;
+        return;
+    }
+    struct bpf_insn *insn = &p->insns[p->count++];
+    memset(insn, 0, sizeof(*insn));
+    insn->code = code;
+    insn->dst_reg = dst;
+    insn->src_reg = src;
+    insn->off = off;
+    insn->imm = imm;
+}
+
+static void emit_ld64(bpf_prog_t *p, uint8_t dst, uint8_t src, uint64_t imm) {
+    emit(p, BPF_LD | BPF_DW | BPF_IMM, dst, src, 0, (int32_t)(uint32_t)imm);
+    emit(p, 0, 0, 0, 0, (int32_t)(uint32_t)(imm >> 32));
+}
+
+static void emit_map(bpf_prog_t *p, uint8_t dst, int map_fd) {
+    emit_ld64(p, dst, BPF_PSEUDO_MAP_FD, (uint32_t)map_fd);
+}
+
+/* Conditional jump (BPF_JEQ, BPF_JNE, ...) against an immediate, to a label */
+static void emit_jmp(bpf_prog_t *p, uint8_t op, uint8_t dst, int32_t imm, int label) {
+    if (p->num_fixups < MAX_FIXUPS) {
+        p->fixups[p->num_fixups].insn = p->count;
+        p->fixups[p->num_fixups++].label = label;
+    } else {
+        p->overflow = 1;
+    }
+    emit(p, BPF_JMP | op | BPF_K, dst, 0, 0, imm);
+}
+
+static void emit_jmp_reg(bpf_prog_t *p, uint8_t op, uint8_t dst, uint8_t src, int label) {
+    emit_jmp(p, op, dst, 0, label);
+    p->insns[p->count - 1].code = BPF_JMP | op | BPF_X;
+    p->insns[p->count - 1].src_reg = src;
+}
+
+static void emit_label(bpf_prog_t *p, int label) {
+    p->labels[label] = p->count;
+}
+
+static void emit_call(bpf_prog_t *p, int helper) {
+    emit(p, BPF_JMP | BPF_CALL, 0, 0, 0, helper);
+}
+
+static uint8_t size_code(int bytes) {
+    switch (bytes) {
+        case 1: return BPF_B;
+        case 2: return BPF_H;
+        case 4: return BPF_W;
+        default: return BPF_DW;
+    }
+}
+
+/* dst = *(size *)(src + off) */
+static void emit_load(bpf_prog_t *p, uint8_t dst, uint8_t src, int16_t off, int bytes) {
+    emit(p, BPF_LDX | size_code(bytes) | BPF_MEM, dst, src, off, 0);
+}
+
+/* *(size *)(dst + off) = src */
+static void emit_store(bpf_prog_t *p, uint8_t dst, int16_t off, uint8_t src, int bytes) {
+    emit(p, BPF_STX | size_code(bytes) | BPF_MEM, dst, src, off, 0);
+}
+
+static void emit_store_imm(bpf_prog_t *p, uint8_t dst, int16_t off, int32_t imm, int bytes) {
+    emit(p, BPF_ST | size_code(bytes) | BPF_MEM, dst, 0, off, imm);
+}
+
+/* dst = fp + off */
+static void emit_stack_ptr(bpf_prog_t *p, uint8_t dst, int16_t off) {
+    emit(p, BPF_ALU64 | BPF_MOV | BPF_X, dst, BPF_REG_10, 0, 0);
+    emit(p, BPF_ALU64 | BPF_ADD | BPF_K, dst, 0, 0, off);
+}
+
+static void emit_mov_imm(bpf_prog_t *p, uint8_t dst, int32_t imm) {
+    emit(p, BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm);
+}
+
+static int finish_prog(bpf_prog_t *p) {
+    emit_label(p, L_EXIT);
+    emit_mov_imm(p, BPF_REG_0, 0);
+    emit(p, BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+    
+    for (int i = 0; i < p->num_fixups; i++) {
+        int at = p->fixups[i].insn;
+        p->insns[at].off = (int16_t)(p->labels[p->fixups[i].label] - at - 1);
+    }
+    return p->overflow ? -1 : 0;
+}
+
+typedef struct {
+    const sched_trace_t *trace;
+    uint64_t ns_dev;
+    uint64_t ns_ino;
+} prog_env_t;
+
+/*
+ * r6 = ctx, r9 = config value, r7 = run id; exit if no run is active.
+ */
+static void emit_prologue(bpf_prog_t *p, const prog_env_t *env) {
+    emit(p, BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+    emit_store_imm(p, BPF_REG_10, FP_KEY, 0, 4);
+    emit_map(p, BPF_REG_1, env->trace->config_fd);
+    emit_stack_ptr(p, BPF_REG_2, FP_KEY);
+    emit_call(p, BPF_FUNC_map_lookup_elem);
+    emit_jmp(p, BPF_JEQ, BPF_REG_0, 0, L_EXIT);
+    emit(p, BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_9, BPF_REG_0, 0, 0);
+    emit_load(p, BPF_REG_7, BPF_REG_9, offsetof(trace_config_t, run_id), 8);
+    emit_jmp(p, BPF_JEQ, BPF_REG_7, 0, L_EXIT);
+}
+
+/*
+ * r8 = namespace tid of current if it belongs to this process, else jump
+ * to label.
+ */
+static void emit_current_ours(bpf_prog_t *p, const prog_env_t *env, int label) {
+    emit_ld64(p, BPF_REG_1, 0, env->ns_dev);
+    emit_ld64(p, BPF_REG_2, 0, env->ns_ino);
+    emit_stack_ptr(p, BPF_REG_3, FP_NSINFO);
+    emit_mov_imm(p, BPF_REG_4, sizeof(struct bpf_pidns_info));
+    emit_call(p, BPF_FUNC_get_ns_current_pid_tgid);
+    emit_jmp(p, BPF_JNE, BPF_REG_0, 0, label);
+    emit_load(p, BPF_REG_1, BPF_REG_10, NSINFO(tgid), 4);
+    emit_load(p, BPF_REG_2, BPF_REG_9, offsetof(trace_config_t, tgid), 4);
+    emit_jmp_reg(p, BPF_JNE, BPF_REG_1, BPF_REG_2, label);
+    emit_load(p, BPF_REG_8, BPF_REG_10, NSINFO(pid), 4);
+}
+
+/* record.cpu = current CPU */
+static void emit_store_cpu(bpf_prog_t *p) {
+    emit_call(p, BPF_FUNC_get_smp_processor_id);
+    emit_store(p, BPF_REG_10, REC(cpu), BPF_REG_0, 2);
+}
+
+/*
+ * Fill type, run id and padding, then bpf_ringbuf_output(); count a drop
+ * on failure. ts, value, tid, arg and cpu are already on the stack.
+ */
+static void emit_output(bpf_prog_t *p, const prog_env_t *env, sched_trace_type_t type, int label) {
+    emit_store(p, BPF_REG_10, REC(run_id), BPF_REG_7, 8);
+    emit_store_imm(p, BPF_REG_10, REC(type), type, 2);
+    emit_store_imm(p, BPF_REG_10, REC(pad), 0, 4);
+    emit_map(p, BPF_REG_1, env->trace->ring_fd);
+    emit_stack_ptr(p, BPF_REG_2, FP_RECORD);
+    emit_mov_imm(p, BPF_REG_3, sizeof(trace_record_t));
+    emit_mov_imm(p, BPF_REG_4, 0);
+    emit_call(p, BPF_FUNC_ringbuf_output);
+    emit_jmp(p, BPF_JEQ, BPF_REG_0, 0, label);
+    emit_mov_imm(p, BPF_REG_1, 1);
+    emit(p, BPF_STX | BPF_DW | BPF_ATOMIC, BPF_REG_9, BPF_REG_1,
+         offsetof(trace_config_t, dropped), BPF_ADD);
+}
+
+static void emit_ktime(bpf_prog_t *p, int16_t off) {
+    emit_call(p, BPF_FUNC_ktime_get_ns);
+    emit_store(p, BPF_REG_10, off, BPF_REG_0, 8);
+}
+
+/*
+ * sched_switch: current is prev. Switch-out of our thread stores the time
+ * and run id under its global tid; switch-in of a thread stored in the
+ * same run emits the interval (an entry left by an earlier run would
+ * report the gap between runs).
+ */
+static int build_switch(bpf_prog_t *p, const prog_env_t *env,
+                        tp_field_t prev_pid, tp_field_t prev_state, tp_field_t next_pid) {
+    emit_prologue(p, env);
+    emit_ktime(p, FP_TS);
+    emit_store(p, BPF_REG_10, REC(ts_ns), BPF_REG_0, 8);
+    emit_store_cpu(p);
+    
+    // Switch-out
+    emit_current_ours(p, env, L_NEXT);
+    emit_load(p, BPF_REG_1, BPF_REG_10, FP_TS, 8);
+    emit_store(p, BPF_REG_10, THREAD(off_ns), BPF_REG_1, 8);
+    emit_store(p, BPF_REG_10, THREAD(run_id), BPF_REG_7, 8);
+    emit_store(p, BPF_REG_10, THREAD(tid), BPF_REG_8, 4);
+    emit_store_imm(p, BPF_REG_10, THREAD(pad), 0, 4);
+    emit_load(p, BPF_REG_1, BPF_REG_6, prev_pid.offset, prev_pid.size);
+    emit_store(p, BPF_REG_10, FP_TID_KEY, BPF_REG_1, 4);
+    emit_map(p, BPF_REG_1, env->trace->threads_fd);
+    emit_stack_ptr(p, BPF_REG_2, FP_TID_KEY);
+    emit_stack_ptr(p, BPF_REG_3, FP_THREAD);
+    emit_mov_imm(p, BPF_REG_4, BPF_ANY);
+    emit_call(p, BPF_FUNC_map_update_elem);
+    emit_store_imm(p, BPF_REG_10, REC(value), 0, 8);
+    emit_store(p, BPF_REG_10, REC(tid), BPF_REG_8, 4);
+    emit_load(p, BPF_REG_1, BPF_REG_6, prev_state.offset, prev_state.size);
+    emit_store(p, BPF_REG_10, REC(arg), BPF_REG_1, 4);
+    emit_output(p, env, SCHED_TRACE_SWITCH_OUT, L_NEXT);
+    
+    // Switch-in
+    emit_label(p, L_NEXT);
+    emit_load(p, BPF_REG_1, BPF_REG_6, next_pid.offset, next_pid.size);
+    emit_store(p, BPF_REG_10, FP_TID_KEY, BPF_REG_1, 4);
+    emit_map(p, BPF_REG_1, env->trace->threads_fd);
+    emit_stack_ptr(p, BPF_REG_2, FP_TID_KEY);
+    emit_call(p, BPF_FUNC_map_lookup_elem);
+    emit_jmp(p, BPF_JEQ, BPF_REG_0, 0, L_EXIT);
+    emit_load(p, BPF_REG_1, BPF_REG_0, offsetof(trace_thread_t, off_ns), 8);
+    emit_jmp(p, BPF_JEQ, BPF_REG_1, 0, L_EXIT);
+    emit_load(p, BPF_REG_2, BPF_REG_0, offsetof(trace_thread_t, run_id), 8);
+    emit_jmp_reg(p, BPF_JNE, BPF_REG_2, BPF_REG_7, L_EXIT);
+    emit_load(p, BPF_REG_2, BPF_REG_10, FP_TS, 8);
+    emit(p, BPF_ALU64 | BPF_SUB | BPF_X, BPF_REG_2, BPF_REG_1, 0, 0);
+    emit_store(p, BPF_REG_10, REC(value), BPF_REG_2, 8);
+    emit_store_imm(p, BPF_REG_0, offsetof(trace_thread_t, off_ns), 0, 8);
+    emit_load(p, BPF_REG_1, BPF_REG_0, offsetof(trace_thread_t, tid), 4);
+    emit_store(p, BPF_REG_10, REC(tid), BPF_REG_1, 4);
+    emit_store_imm(p, BPF_REG_10, REC(arg), 0, 4);
+    emit_output(p, env, SCHED_TRACE_SWITCH_IN, L_EXIT);
+    return finish_prog(p);
+}
+
+/*
+ * sched_migrate_task: the migrating task is usually not current, so it is
+ * matched against the threads seen switching out.
+ */
+static int build_migrate(bpf_prog_t *p, const prog_env_t *env,
+                         tp_field_t pid, tp_field_t orig_cpu, tp_field_t dest_cpu) {
+    emit_prologue(p, env);
+    emit_load(p, BPF_REG_1, BPF_REG_6, pid.offset, pid.size);
+    emit_store(p, BPF_REG_10, FP_TID_KEY, BPF_REG_1, 4);
+    emit_map(p, BPF_REG_1, env->trace->threads_fd);
+    emit_stack_ptr(p, BPF_REG_2, FP_TID_KEY);
+    emit_call(p, BPF_FUNC_map_lookup_elem);
+    emit_jmp(p, BPF_JEQ, BPF_REG_0, 0, L_EXIT);
+    emit_load(p, BPF_REG_1, BPF_REG_0, offsetof(trace_thread_t, tid), 4);
+    emit_store(p, BPF_REG_10, REC(tid), BPF_REG_1, 4);
+    emit_ktime(p, REC(ts_ns));
+    emit_store_imm(p, BPF_REG_10, REC(value), 0, 8);
+    emit_load(p, BPF_REG_1, BPF_REG_6, orig_cpu.offset, orig_cpu.size);
+    emit_store(p, BPF_REG_10, REC(arg), BPF_REG_1, 4);
+    emit_load(p, BPF_REG_1, BPF_REG_6, dest_cpu.offset, dest_cpu.size);
+    emit_store(p, BPF_REG_10, REC(cpu), BPF_REG_1, 2);
+    emit_output(p, env, SCHED_TRACE_MIGRATE, L_EXIT);
+    return finish_prog(p);
+}
+
+/* r0 = per-CPU slot pointer (this CPU), exit if the lookup fails */
+static void emit_slot(bpf_prog_t *p, const prog_env_t *env, int slot) {
+    emit_store_imm(p, BPF_REG_10, FP_KEY, slot, 4);
+    emit_map(p, BPF_REG_1, env->trace->slots_fd);
+    emit_stack_ptr(p, BPF_REG_2, FP_KEY);
+    emit_call(p, BPF_FUNC_map_lookup_elem);
+    emit_jmp(p, BPF_JEQ, BPF_REG_0, 0, L_EXIT);
+}
+
+/* irq_handler_entry, softirq_entry: remember when our thread was interrupted */
+static int build_entry(bpf_prog_t *p, const prog_env_t *env, int slot) {
+    emit_prologue(p, env);
+    emit_current_ours(p, env, L_EXIT);
+    emit_slot(p, env, slot);
+    emit(p, BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_8, BPF_REG_0, 0, 0);
+    emit_call(p, BPF_FUNC_ktime_get_ns);
+    emit_store(p, BPF_REG_8, 0, BPF_REG_0, 8);
+    return finish_prog(p);
+}
+
+/* irq_handler_exit, softirq_exit: emit the handler time */
+static int build_exit(bpf_prog_t *p, const prog_env_t *env, int slot,
+                      sched_trace_type_t type, tp_field_t arg) {
+    emit_prologue(p, env);
+    emit_current_ours(p, env, L_EXIT);
+    emit_store(p, BPF_REG_10, REC(tid), BPF_REG_8, 4);
+    emit_slot(p, env, slot);
+    emit(p, BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_8, BPF_REG_0, 0, 0);
+    emit_load(p, BPF_REG_1, BPF_REG_8, 0, 8);
+    emit_jmp(p, BPF_JEQ, BPF_REG_1, 0, L_EXIT);
+    emit_store(p, BPF_REG_10, FP_TS, BPF_REG_1, 8);
+    emit_store_imm(p, BPF_REG_8, 0, 0, 8);
+    emit_ktime(p, REC(ts_ns));
+    emit_load(p, BPF_REG_1, BPF_REG_10, FP_TS, 8);
+    emit(p, BPF_ALU64 | BPF_SUB | BPF_X, BPF_REG_0, BPF_REG_1, 0, 0);
+    emit_store(p, BPF_REG_10, REC(value), BPF_REG_0, 8);
+    emit_load(p, BPF_REG_1, BPF_REG_6, arg.offset, arg.size);
+    emit_store(p, BPF_REG_10, REC(arg), BPF_REG_1, 4);
+    emit_store_cpu(p);
+    emit_output(p, env, type, L_EXIT);
+    return finish_prog(p);
+}
+
+static long sys_bpf(int cmd, union bpf_attr *attr) {
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+static int map_create(uint32_t type, uint32_t key_size, uint32_t value_size, uint32_t max_entries) {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = type;
+    attr.key_size = key_size;
+    attr.value_size = value_size;
+    attr.max_entries = max_entries;
+    return (int)sys_bpf(BPF_MAP_CREATE, &attr);
+}
+
+static int config_update(const sched_trace_t *t, const trace_config_t *config) {
+    uint32_t key = 0;
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = t->config_fd;
+    attr.key = (uint64_t)(uintptr_t)&key;
+    attr.value = (uint64_t)(uintptr_t)config;
+    attr.flags = BPF_ANY;
+    return (int)sys_bpf(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+static int config_lookup(const sched_trace_t *t, trace_config_t *config) {
+    uint32_t key = 0;
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = t->config_fd;
+    attr.key = (uint64_t)(uintptr_t)&key;
+    attr.value = (uint64_t)(uintptr_t)config;
+    return (int)sys_bpf(BPF_MAP_LOOKUP_ELEM, &attr);
+}
+
+static int prog_load(bpf_prog_t *p, const char *name) {
+    static char log[LOG_SIZE];
+    union bpf_attr attr;
+    
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_TRACEPOINT;
+    attr.insns = (uint64_t)(uintptr_t)p->insns;
+    attr.insn_cnt = p->count;
+    attr.license = (uint64_t)(uintptr_t)"GPL";
+    attr.log_buf = (uint64_t)(uintptr_t)log;
+    attr.log_size = sizeof(log);
+    attr.log_level = 1;
+    log[0] = '\0';
+    
+    int fd = (int)sys_bpf(BPF_PROG_LOAD, &attr);
+    if (fd < 0 && errno != EPERM && log[0]) {
+        fprintf(stderr, "sched_trace: %s rejected by the verifier:\n%s\n", name, log);
+    }
+    return fd;
+}
+
+/*
+ * Read tracefs file <root>/events/<event>/<file> into buf.
+ */
+static int read_event_file(const char *event, const char *file, char *buf, size_t len) {
+    for (size_t i = 0; i < sizeof(tracefs_roots) / sizeof(tracefs_roots[0]); i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/events/%s/%s", tracefs_roots[i], event, file);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        size_t n = fread(buf, 1, len - 1, f);
+        buf[n] = '\0';
+        fclose(f);
+        return 0;
+    }
+    return -1;
+}
+
+/*
+ * Offset and size of one field from the event's format file, e.g.
+ *   field:pid_t prev_pid;	offset:24;	size:4;	signed:1;
+ */
+static int event_field(const char *format, const char *name, tp_field_t *field) {
+    size_t len = strlen(name);
+    
+    for (const char *line = format; line; line = strchr(line, '\n')) {
+        if (*line == '\n') line++;
+        const char *f = strstr(line, "field:");
+        const char *end = strchr(line, ';');
+        const char *eol = strchr(line, '\n');
+        if (!f || !end || (eol && f > eol)) continue;
+        
+        // The name is the last word before ';'
+        if ((size_t)(end - f) < len || strncmp(end - len, name, len) != 0) continue;
+        char before = *(end - len - 1);
+        if (before != ' ' && before != '*') continue;
+        
+        const char *off = strstr(end, "offset:");
+        const char *size = strstr(end, "size:");
+        if (!off || !size) return -1;
+        field->offset = atoi(off + 7);
+        field->size = atoi(size + 5);
+        return (field->size == 4 || field->size == 8) ? 0 : -1;
+    }
+    return -1;
+}
+
+typedef struct {
+    const char *event;            // "sched/sched_switch"
+    const char *fields[3];
+} tp_spec_t;
+
+static const tp_spec_t tracepoints[SCHED_TRACE_PROGS] = {
+    { "sched/sched_switch", { "prev_pid", "prev_state", "next_pid" } },
+    { "sched/sched_migrate_task", { "pid", "orig_cpu", "dest_cpu" } },
+    { "irq/irq_handler_entry", { NULL } },
+    { "irq/irq_handler_exit", { "irq" } },
+    { "irq/softirq_entry", { NULL } },
+    { "irq/softirq_exit", { "vec" } },
+};
+
+static int attach(int prog_fd, const char *event) {
+    char buf[32];
+    struct perf_event_attr attr;
+    
+    if (read_event_file(event, "id", buf, sizeof(buf)) != 0) return -1;
+    
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = strtoull(buf, NULL, 10);
+    attr.sample_period = 1;
+    attr.wakeup_events = 1;
+    
+    // One event suffices: the program runs for the tracepoint on every CPU
+    int fd = (int)syscall(__NR_perf_event_open, &attr, -1, 0, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0) return -1;
+    if (ioctl(fd, PERF_EVENT_IOC_SET_BPF, prog_fd) != 0 ||
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void fail(sched_trace_t *t, const char *what) {
+    static int reported;
+    int err = errno;
+    
+    if (!reported++) {
+        fprintf(stderr, "Warning: scheduler tracing unavailable (%s: %s), sched columns will be 0\n",
+                what, strerror(err));
+    }
+    sched_trace_close(t);
+    errno = err;
+}
+
+int sched_trace_open(sched_trace_t *t) {
+    const char *env = getenv("LRC_SCHED_TRACE");
+    char format[8192];
+    tp_field_t fields[SCHED_TRACE_PROGS][3];
+    struct stat ns;
+    
+    memset(t, 0, sizeof(*t));
+    t->config_fd = t->threads_fd = t->slots_fd = t->ring_fd = -1;
+    for (int i = 0; i < SCHED_TRACE_PROGS; i++) t->prog_fds[i] = t->event_fds[i] = -1;
+    
+    if (env && strcmp(env, "0") == 0) return -1;
+    memset(fields, 0, sizeof(fields));
+    
+    // Field offsets of the running kernel
+    for (int i = 0; i < SCHED_TRACE_PROGS; i++) {
+        if (read_event_file(tracepoints[i].event, "format", format, sizeof(format)) != 0) {
+            fail(t, "tracefs");
+            return -1;
+        }
+        for (int f = 0; f < 3 && tracepoints[i].fields[f]; f++) {
+            if (event_field(format, tracepoints[i].fields[f], &fields[i][f]) != 0) {
+                errno = ENOENT;
+                fail(t, tracepoints[i].fields[f]);
+                return -1;
+            }
+        }
+    }
+    if (stat("/proc/self/ns/pid", &ns) != 0) {
+        fail(t, "/proc/self/ns/pid");
+        return -1;
+    }
+    
+    t->config_fd = map_create(BPF_MAP_TYPE_ARRAY, 4, sizeof(trace_config_t), 1);
+    t->threads_fd = map_create(BPF_MAP_TYPE_LRU_HASH, 4, sizeof(trace_thread_t), MAX_THREADS);
+    t->slots_fd = map_create(BPF_MAP_TYPE_PERCPU_ARRAY, 4, sizeof(uint64_t), 2);
+    t->ring_fd = map_create(BPF_MAP_TYPE_RINGBUF, 0, 0, RING_SIZE);
+    if (t->config_fd < 0 || t->threads_fd < 0 || t->slots_fd < 0 || t->ring_fd < 0) {
+        fail(t, "bpf map");
+        return -1;
+    }
+    
+    trace_config_t config = { 0, (uint32_t)getpid(), 0, 0 };
+    if (config_update(t, &config) != 0) {
+        fail(t, "bpf map update");
+        return -1;
+    }
+    
+    // Ring buffer: consumer page read-write, producer page and data read-only
+    t->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    t->ring_size = RING_SIZE;
+    void *consumer = mmap(NULL, t->page_size, PROT_READ | PROT_WRITE, MAP_SHARED, t->ring_fd, 0);
+    if (consumer == MAP_FAILED) {
+        fail(t, "ring buffer mmap");
+        return -1;
+    }
+    t->consumer_pos = consumer;
+    void *producer = mmap(NULL, t->page_size + 2 * t->ring_size, PROT_READ, MAP_SHARED,
+                          t->ring_fd, t->page_size);
+    if (producer == MAP_FAILED) {
+        fail(t, "ring buffer mmap");
+        return -1;
+    }
+    t->producer_pos = producer;
+    t->data = (uint8_t *)producer + t->page_size;
+    
+    prog_env_t penv = { t, (uint64_t)ns.st_dev, (uint64_t)ns.st_ino };
+    for (int i = 0; i < SCHED_TRACE_PROGS; i++) {
+        bpf_prog_t prog;
+        int ret;
+        
+        memset(&prog, 0, sizeof(prog));
+        switch (i) {
+            case 0: ret = build_switch(&prog, &penv, fields[0][0], fields[0][1], fields[0][2]); break;
+            case 1: ret = build_migrate(&prog, &penv, fields[1][0], fields[1][1], fields[1][2]); break;
+            case 2: ret = build_entry(&prog, &penv, SLOT_IRQ); break;
+            case 3: ret = build_exit(&prog, &penv, SLOT_IRQ, SCHED_TRACE_IRQ, fields[3][0]); break;
+            case 4: ret = build_entry(&prog, &penv, SLOT_SOFTIRQ); break;
+            default: ret = build_exit(&prog, &penv, SLOT_SOFTIRQ, SCHED_TRACE_SOFTIRQ, fields[5][0]); break;
+        }
+        if (ret != 0) {
+            errno = E2BIG;
+            fail(t, tracepoints[i].event);
+            return -1;
+        }
+        t->prog_fds[i] = prog_load(&prog, tracepoints[i].event);
+        if (t->prog_fds[i] < 0) {
+            fail(t, "bpf program load");
+            return -1;
+        }
+        t->event_fds[i] = attach(t->prog_fds[i], tracepoints[i].event);
+        if (t->event_fds[i] < 0) {
+            fail(t, "tracepoint attach");
+            return -1;
+        }
+    }
+    
+    tsc_init();
+    t->base_tsc = tsc_now();
+    t->base_ns = monotonic_ns();
+    t->available = 1;
+    return 0;
+}
+
+/*
+ * Consume every committed record; records of the current run go to run
+ * (and fn).
+ */
+static void drain(sched_trace_t *t, sched_trace_run_t *run, sched_trace_fn_t fn, void *arg) {
+    uint64_t mask = t->ring_size - 1;
+    uint64_t cons = __atomic_load_n(t->consumer_pos, __ATOMIC_ACQUIRE);
+    uint64_t prod = __atomic_load_n(t->producer_pos, __ATOMIC_ACQUIRE);
+    double ticks_per_ns = tsc_info()->ticks_per_ns;
+    
+    while (cons < prod) {
+        const uint32_t *header = (const uint32_t *)(t->data + (cons & mask));
+        uint32_t len = __atomic_load_n(header, __ATOMIC_ACQUIRE);
+        
+        // Reserved but not yet committed by another CPU: wait briefly
+        for (int spin = 0; (len & BPF_RINGBUF_BUSY_BIT) && spin < BUSY_SPINS; spin++) {
+            sched_yield();
+            len = __atomic_load_n(header, __ATOMIC_ACQUIRE);
+        }
+        if (len & BPF_RINGBUF_BUSY_BIT) break;
+        
+        uint32_t size = len & ~(BPF_RINGBUF_BUSY_BIT | BPF_RINGBUF_DISCARD_BIT);
+        if (!(len & BPF_RINGBUF_DISCARD_BIT) && size >= sizeof(trace_record_t)) {
+            const trace_record_t *rec = (const trace_record_t *)((const uint8_t *)header + BPF_RINGBUF_HDR_SZ);
+            if (run && rec->run_id == t->run_id) {
+                sched_trace_event_t ev = {
+                    .tsc = t->base_tsc + (uint64_t)((double)(int64_t)(rec->ts_ns - t->base_ns) * ticks_per_ns),
+                    .value = rec->value,
+                    .run_id = rec->run_id,
+                    .tid = rec->tid,
+                    .arg = rec->arg,
+                    .type = (sched_trace_type_t)rec->type,
+                    .cpu = rec->cpu,
+                };
+                run->events++;
+                switch (ev.type) {
+                    case SCHED_TRACE_SWITCH_OUT:
+                        run->switches++;
+                        if ((ev.arg & SCHED_TRACE_STATE_MASK) == 0) run->preemptions++;
+                        break;
+                    case SCHED_TRACE_SWITCH_IN:
+                        run->off_cpu_ns += ev.value;
+                        break;
+                    case SCHED_TRACE_MIGRATE:
+                        run->migrations++;
+                        break;
+                    case SCHED_TRACE_IRQ:
+                        run->irqs++;
+                        run->irq_ns += ev.value;
+                        break;
+                    case SCHED_TRACE_SOFTIRQ:
+                        run->softirqs++;
+                        run->softirq_ns += ev.value;
+                        break;
+                    default:
+                        break;
+                }
+                if (fn) fn(&ev, arg);
+            }
+        }
+        
+        cons += (BPF_RINGBUF_HDR_SZ + size + 7) & ~7u;
+        __atomic_store_n(t->consumer_pos, cons, __ATOMIC_RELEASE);
+        if (cons >= prod) prod = __atomic_load_n(t->producer_pos, __ATOMIC_ACQUIRE);
+    }
+}
+
+void sched_trace_begin(sched_trace_t *t, uint64_t run_id) {
+    trace_config_t config;
+    
+    if (!t->available) return;
+    
+    drain(t, NULL, NULL, NULL);               // Leftovers of earlier runs
+    if (config_lookup(t, &config) != 0) return;
+    t->dropped = config.dropped;
+    t->run_id = run_id ? run_id : 1;
+    config.run_id = t->run_id;
+    config_update(t, &config);
+}
+
+void sched_trace_end(sched_trace_t *t, sched_trace_run_t *run, sched_trace_fn_t fn, void *arg) {
+    trace_config_t config;
+    
+    memset(run, 0, sizeof(*run));
+    if (!t->available || t->run_id == 0) return;
+    
+    // Stop recording first; the update is ordered before our later reads
+    if (config_lookup(t, &config) == 0) {
+        config.run_id = 0;
+        config_update(t, &config);
+    }
+    drain(t, run, fn, arg);
+    if (config_lookup(t, &config) == 0) run->dropped = config.dropped - t->dropped;
+    run->traced = 1;
+    t->run_id = 0;
+}
+
+void sched_trace_close(sched_trace_t *t) {
+    for (int i = 0; i < SCHED_TRACE_PROGS; i++) {
+        if (t->event_fds[i] >= 0) {
+            ioctl(t->event_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            close(t->event_fds[i]);
+        }
+        if (t->prog_fds[i] >= 0) close(t->prog_fds[i]);
+        t->event_fds[i] = t->prog_fds[i] = -1;
+    }
+    if (t->producer_pos) munmap((void *)t->producer_pos, t->page_size + 2 * t->ring_size);
+    if (t->consumer_pos) munmap((void *)t->consumer_pos, t->page_size);
+    if (t->ring_fd >= 0) close(t->ring_fd);
+    if (t->slots_fd >= 0) close(t->slots_fd);
+    if (t->threads_fd >= 0) close(t->threads_fd);
+    if (t->config_fd >= 0) close(t->config_fd);
+    t->producer_pos = t->consumer_pos = NULL;
+    t->ring_fd = t->slots_fd = t->threads_fd = t->config_fd = -1;
+    t->available = 0;
+}
+
+const char *sched_trace_type_name(sched_trace_type_t type) {
+    switch (type) {
+        case SCHED_TRACE_SWITCH_OUT: return "switch_out";
+        case SCHED_TRACE_SWITCH_IN: return "switch_in";
+        case SCHED_TRACE_MIGRATE: return "migrate";
+        case SCHED_TRACE_IRQ: return "irq";
+        case SCHED_TRACE_SOFTIRQ: return "softirq";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * sched_trace.h - In-process scheduler tracing with eBPF
+ *
+ * Tracepoint programs for sched_switch, sched_migrate_task,
+ * irq_handler_entry/exit and softirq_entry/exit, loaded by this process
+ * with the bpf() syscall. They record events of this process's threads
+ * into a BPF ring buffer, stamped with the run id set by
+ * sched_trace_begin(); sched_trace_end() drains the ring and sums the
+ * run's off-CPU time, migrations and interrupt time.
+ *
+ *     sched_trace_t trace;
+ *     sched_trace_open(&trace);                  // Needs CAP_BPF + CAP_PERFMON
+ *     sched_trace_begin(&trace, run);
+ *     ... workload ...
+ *     sched_trace_end(&trace, &stats, NULL, NULL);
+ *     results_sched_trace(&out, &stats);
+ *
+ * Without privileges (or tracefs) sched_trace_open() fails and begin/end
+ * report zeros, so scenarios can keep the columns unconditionally.
+ * LRC_SCHED_TRACE=0 disables tracing.
+ */
+
+#ifndef LRC_SCHED_TRACE_H
+#define LRC_SCHED_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    SCHED_TRACE_SWITCH_OUT = 1,   // Thread left the CPU; arg = prev_state
+    SCHED_TRACE_SWITCH_IN,        // Thread back on a CPU; value = ns off CPU
+    SCHED_TRACE_MIGRATE,          // arg = source CPU, cpu = destination
+    SCHED_TRACE_IRQ,              // Hard IRQ on the thread; arg = irq, value = ns
+    SCHED_TRACE_SOFTIRQ,          // Softirq on the thread; arg = vector, value = ns
+    SCHED_TRACE_TYPE_COUNT
+} sched_trace_type_t;
+
+/* prev_state of a preempted (still runnable) task: 0 or TASK_REPORT_MAX */
+#define SCHED_TRACE_STATE_MASK 0xff
+
+/**
+ * @brief One drained event
+ */
+typedef struct {
+    uint64_t tsc;                 // Event time in TSC ticks (tsc.h time base)
+    uint64_t value;               // See sched_trace_type_t
+    uint64_t run_id;
+    uint32_t tid;                 // Thread id as gettid() returns it
+    uint32_t arg;
+    sched_trace_type_t type;
+    int cpu;
+} sched_trace_event_t;
+
+/**
+ * @brief Per-run totals (all zero when tracing is unavailable)
+ */
+typedef struct {
+    uint64_t off_cpu_ns;          // Sum of switch-out to switch-in intervals
+    uint64_t switches;            // Switch-outs
+    uint64_t preemptions;         // Switch-outs while still runnable
+    uint64_t migrations;
+    uint64_t irqs;
+    uint64_t irq_ns;
+    uint64_t softirqs;
+    uint64_t softirq_ns;
+    uint64_t events;              // Records drained for this run
+    uint64_t dropped;             // Records lost to a full ring buffer
+    int traced;                   // 1 if the numbers come from the tracer
+} sched_trace_run_t;
+
+typedef void (*sched_trace_fn_t)(const sched_trace_event_t *event, void *arg);
+
+#define SCHED_TRACE_PROGS 6
+
+/**
+ * @brief Tracer state (fields are internal)
+ */
+typedef struct {
+    int available;
+    int config_fd;                // Array: run id, tgid, drop count
+    int threads_fd;               // LRU hash: global tid -> switch-out time, tid
+    int slots_fd;                 // Per-CPU array: IRQ and softirq entry times
+    int ring_fd;
+    int prog_fds[SCHED_TRACE_PROGS];
+    int event_fds[SCHED_TRACE_PROGS];
+    
+    volatile uint64_t *consumer_pos;  // Ring buffer mappings
+    volatile uint64_t *producer_pos;
+    uint8_t *data;
+    size_t ring_size;
+    size_t page_size;
+    
+    uint64_t run_id;
+    uint64_t dropped;             // Drop counter at sched_trace_begin()
+    uint64_t base_ns;             // CLOCK_MONOTONIC / TSC pair for conversion
+    uint64_t base_tsc;
+} sched_trace_t;
+
+/**
+ * @brief Load and attach the tracepoint programs
+ * @return 0 on success, -1 if tracing is unavailable or disabled (a reason
+ *         is printed once); trace is usable either way
+ */
+int sched_trace_open(sched_trace_t *trace);
+
+/**
+ * @brief Start attributing this process's events to run_id (non-zero)
+ */
+void sched_trace_begin(sched_trace_t *trace, uint64_t run_id);
+
+/**
+ * @brief Stop the run, drain the ring buffer and sum the run's events
+ * @param fn Optional callback for every event of the run (e.g. an event log)
+ */
+void sched_trace_end(sched_trace_t *trace, sched_trace_run_t *run, sched_trace_fn_t fn, void *arg);
+
+void sched_trace_close(sched_trace_t *trace);
+
+/**
+ * @brief Event name for CSV output ("switch_out", "irq", ...)
+ */
+const char *sched_trace_type_name(sched_trace_type_t type);
+
+#endif /* LRC_SCHED_TRACE_H */
@@ -12,9 +12,51 @@
 #include <sys/resource.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#include "sched_api.h"
+
+/*
+ * Map a scenario CPU index to a CPU id.
+ * Without LRC_CPU_SET this is the identity. The suite runner sets it to
+ * the partition's CPU list ("8-15,72-79") so an unmodified pin_to_cpu(0)
+ * lands on the partition's first CPU; indexes wrap within the list.
+ *
+ * Justification:
+ *   getenv() and string parsing only; called at pin time, not in hot path.
+ */
+int sched_map_cpu(int cpu) {
+    const char *list = getenv("LRC_CPU_SET");
+    long count = 0;
+    
+    if (!list || !*list || cpu < 0) return cpu;
+    
+    // Two passes over the list (count, then select) so any length works
+    for (int pass = 0; pass < 2; pass++) {
+        long index = pass == 0 ? -1 : cpu % count;
+        long seen = 0;
+        
+        for (const char *p = list; *p; ) {
+            char *end;
+            long lo = strtol(p, &end, 10), hi = lo;
+            if (end == p) break;                   // Malformed: stop here
+            if (*end == '-') hi = strtol(end + 1, &end, 10);
+            if (hi >= lo) {
+                if (index >= seen && index <= seen + (hi - lo)) return (int)(lo + index - seen);
+                seen += hi - lo + 1;
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+        
+        count = seen;
+        if (count == 0) return cpu;
+    }
+    
+    return cpu;
+}
 
 /*
- * Pin calling thread to specific CPU core.
+ * Pin calling thread to specific CPU core (index into LRC_CPU_SET if set).
  * Returns 0 on success, -1 on failure.
  *
  * Justification for syscall:
@@ -22,15 +64,23 @@
  *   Called once before workload, not in hot path.
  */
 int pin_to_cpu(int cpu) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(cpu, &cpuset);
-    
-    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) == -1) {
+    int target = sched_map_cpu(cpu);
+    if (target < 0) {
+        errno = EINVAL;
         return -1;
     }
     
-    return 0;
+    // Sized for the target, so ids beyond CPU_SETSIZE (1024) work
+    cpu_set_t *cpuset = CPU_ALLOC(target + 1);
+    if (!cpuset) return -1;
+    
+    size_t setsize = CPU_ALLOC_SIZE(target + 1);
+    CPU_ZERO_S(setsize, cpuset);
+    CPU_SET_S(target, setsize, cpuset);
+    
+    int ret = sched_setaffinity(0, setsize, cpuset);
+    CPU_FREE(cpuset);
+    return ret == -1 ? -1 : 0;
 }
 
 /*
@@ -0,0 +1,1006 @@
+/*
+ * simd_kernels.c - Vector kernel suite with runtime ISA dispatch
+ *
+ * Purpose:
+ *   simd_performance only timed a float add whose SSE/AVX2 versions
+ *   were plain intrinsics compiled under -march=native, so a binary
+ *   built on one host either crashed or silently measured less on
+ *   another, and one streaming kernel says little about gathers,
+ *   reductions, byte scans or dense compute.
+ *
+ * Design:
+ *   - One variant per ISA for every kernel, each compiled with its own
+ *     target attribute (as memory_stream.c does); the rest of the file
+ *     is built for the baseline ISA (see the Makefile), so nothing runs
+ *     an instruction CPUID did not report
+ *   - Same algorithm across variants: four independent accumulators
+ *     (scalar) or four vector accumulators and no tail loops, because
+ *     prepare rounds element counts down to a multiple of 64 (256 for
+ *     the byte kernels) and matrix dimensions to a multiple of 16
+ *   - matmul computes 4 x 16 output tiles held in registers over the
+ *     whole k loop; dot_i8 multiplies u8 by s8 with pmaddubsw + pmaddwd,
+ *     or vpdpbusd with VNNI. Operands are kept in [0, 63] x [-64, 63] so
+ *     the 16-bit pmaddubsw path never saturates and both agree
+ *   - Float operands are small multiples of 1/8 whose partial sums stay
+ *     exact, so checksums match across ISAs despite the different
+ *     summation order
+ *   - gather/scatter index through a seeded random permutation: every
+ *     element touched once, no conflicting scatter lanes
+ *
+ * Justification for syscalls:
+ *   None; buffers are allocated and filled outside the timed region.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd_kernels.h"
+#include "rng.h"
+#include "tsc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#define SIMD_ALIGN 64
+#define SIMD_STEP 64              // Elements per loop iteration, all variants
+#define SIMD_MIN_BYTES 4096
+#define SIMD_SEED 42
+#define PROBE_ADDS (1 << 17)
+
+#define NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+
+/*
+ * Scalar kernels: the reference, never vectorized.
+ */
+NO_VECTORIZE
+static void add_scalar(const float *a, const float *b, float *c, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        c[i] = a[i] + b[i];
+    }
+}
+
+NO_VECTORIZE
+static float dot_scalar(const float *a, const float *b, size_t n) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    
+    for (size_t i = 0; i < n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+NO_VECTORIZE
+static float sum_scalar(const float *a, size_t n) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    
+    for (size_t i = 0; i < n; i += 4) {
+        s0 += a[i];
+        s1 += a[i + 1];
+        s2 += a[i + 2];
+        s3 += a[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+NO_VECTORIZE
+static float max_scalar(const float *a, size_t n) {
+    float m0 = a[0], m1 = a[1], m2 = a[2], m3 = a[3];
+    
+    for (size_t i = 4; i < n; i += 4) {
+        m0 = a[i] > m0 ? a[i] : m0;
+        m1 = a[i + 1] > m1 ? a[i + 1] : m1;
+        m2 = a[i + 2] > m2 ? a[i + 2] : m2;
+        m3 = a[i + 3] > m3 ? a[i + 3] : m3;
+    }
+    m0 = m1 > m0 ? m1 : m0;
+    m2 = m3 > m2 ? m3 : m2;
+    return m2 > m0 ? m2 : m0;
+}
+
+NO_VECTORIZE
+static float gather_scalar(const float *a, const int32_t *idx, size_t n) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    
+    for (size_t i = 0; i < n; i += 4) {
+        s0 += a[idx[i]];
+        s1 += a[idx[i + 1]];
+        s2 += a[idx[i + 2]];
+        s3 += a[idx[i + 3]];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+NO_VECTORIZE
+static void scatter_scalar(const float *a, const int32_t *idx, float *c, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        c[idx[i]] = a[i];
+    }
+}
+
+NO_VECTORIZE
+static size_t scan_scalar(const uint8_t *p, size_t n, uint8_t needle) {
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == needle) return i;
+    }
+    return n;
+}
+
+NO_VECTORIZE
+static void prefix_scalar(const int32_t *in, int32_t *out, size_t n) {
+    int32_t acc = 0;
+    
+    for (size_t i = 0; i < n; i++) {
+        acc += in[i];
+        out[i] = acc;
+    }
+}
+
+NO_VECTORIZE
+static void matmul_scalar(const float *A, const float *B, float *C, size_t d) {
+    for (size_t i = 0; i < d; i += 4) {
+        for (size_t j = 0; j < d; j += 16) {
+            float acc[4][16] = { { 0.0f } };
+            for (size_t k = 0; k < d; k++) {
+                for (int r = 0; r < 4; r++) {
+                    float av = A[(i + r) * d + k];
+                    for (int q = 0; q < 16; q++) acc[r][q] += av * B[k * d + j + q];
+                }
+            }
+            for (int r = 0; r < 4; r++) memcpy(&C[(i + r) * d + j], acc[r], sizeof(acc[r]));
+        }
+    }
+}
+
+NO_VECTORIZE
+static uint32_t dot_i8_scalar(const uint8_t *u, const int8_t *s, size_t n) {
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    
+    for (size_t i = 0; i < n; i += 4) {
+        s0 += (uint32_t)(u[i] * s[i]);
+        s1 += (uint32_t)(u[i + 1] * s[i + 1]);
+        s2 += (uint32_t)(u[i + 2] * s[i + 2]);
+        s3 += (uint32_t)(u[i + 3] * s[i + 3]);
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+#ifdef SIMD_X86
+
+/*
+ * SSE4.2: 4 floats / 16 bytes per register.
+ */
+__attribute__((target("sse4.2")))
+static float hsum_sse4(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t hsum_epi32_sse4(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("sse4.2")))
+static void add_sse4(const float *a, const float *b, float *c, size_t n) {
+    for (size_t i = 0; i < n; i += 4) {
+        _mm_store_ps(c + i, _mm_add_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+    }
+}
+
+__attribute__((target("sse4.2")))
+static float dot_sse4(const float *a, const float *b, size_t n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 16) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_load_ps(a + i + 4), _mm_load_ps(b + i + 4)));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_load_ps(a + i + 8), _mm_load_ps(b + i + 8)));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_load_ps(a + i + 12), _mm_load_ps(b + i + 12)));
+    }
+    return hsum_sse4(_mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+}
+
+__attribute__((target("sse4.2")))
+static float sum_sse4(const float *a, size_t n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 16) {
+        s0 = _mm_add_ps(s0, _mm_load_ps(a + i));
+        s1 = _mm_add_ps(s1, _mm_load_ps(a + i + 4));
+        s2 = _mm_add_ps(s2, _mm_load_ps(a + i + 8));
+        s3 = _mm_add_ps(s3, _mm_load_ps(a + i + 12));
+    }
+    return hsum_sse4(_mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+}
+
+__attribute__((target("sse4.2")))
+static float max_sse4(const float *a, size_t n) {
+    __m128 m0 = _mm_load_ps(a), m1 = _mm_load_ps(a + 4);
+    __m128 m2 = _mm_load_ps(a + 8), m3 = _mm_load_ps(a + 12);
+    
+    for (size_t i = 16; i < n; i += 16) {
+        m0 = _mm_max_ps(m0, _mm_load_ps(a + i));
+        m1 = _mm_max_ps(m1, _mm_load_ps(a + i + 4));
+        m2 = _mm_max_ps(m2, _mm_load_ps(a + i + 8));
+        m3 = _mm_max_ps(m3, _mm_load_ps(a + i + 12));
+    }
+    __m128 m = _mm_max_ps(_mm_max_ps(m0, m1), _mm_max_ps(m2, m3));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+/* No gather instruction: four scalar loads inserted into a register */
+__attribute__((target("sse4.2")))
+static float gather_sse4(const float *a, const int32_t *idx, size_t n) {
+    __m128 s[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+    
+    for (size_t i = 0; i < n; i += 16) {
+        for (int q = 0; q < 4; q++) {
+            const int32_t *x = idx + i + 4 * q;
+            s[q] = _mm_add_ps(s[q], _mm_set_ps(a[x[3]], a[x[2]], a[x[1]], a[x[0]]));
+        }
+    }
+    return hsum_sse4(_mm_add_ps(_mm_add_ps(s[0], s[1]), _mm_add_ps(s[2], s[3])));
+}
+
+__attribute__((target("sse4.2")))
+static size_t scan_sse4(const uint8_t *p, size_t n, uint8_t needle) {
+    const __m128i v = _mm_set1_epi8((char)needle);
+    
+    for (size_t i = 0; i < n; i += 64) {
+        __m128i e0 = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(p + i)), v);
+        __m128i e1 = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(p + i + 16)), v);
+        __m128i e2 = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(p + i + 32)), v);
+        __m128i e3 = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(p + i + 48)), v);
+        if (!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(e0, e1), _mm_or_si128(e2, e3)))) continue;
+        
+        uint64_t mask = (uint64_t)_mm_movemask_epi8(e0) |
+                        (uint64_t)_mm_movemask_epi8(e1) << 16 |
+                        (uint64_t)_mm_movemask_epi8(e2) << 32 |
+                        (uint64_t)_mm_movemask_epi8(e3) << 48;
+        return i + (size_t)__builtin_ctzll(mask);
+    }
+    return n;
+}
+
+__attribute__((target("sse4.2")))
+static void prefix_sse4(const int32_t *in, int32_t *out, size_t n) {
+    __m128i carry = _mm_setzero_si128();
+    
+    for (size_t i = 0; i < n; i += 4) {
+        __m128i x = _mm_load_si128((const __m128i *)(in + i));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        _mm_store_si128((__m128i *)(out + i), x);
+        carry = _mm_shuffle_epi32(x, 0xFF);
+    }
+}
+
+__attribute__((target("sse4.2")))
+static void matmul_sse4(const float *A, const float *B, float *C, size_t d) {
+    for (size_t i = 0; i < d; i += 4) {
+        for (size_t j = 0; j < d; j += 16) {
+            __m128 acc[4][4];
+            for (int r = 0; r < 4; r++) {
+                for (int q = 0; q < 4; q++) acc[r][q] = _mm_setzero_ps();
+            }
+            for (size_t k = 0; k < d; k++) {
+                const float *brow = B + k * d + j;
+                __m128 b0 = _mm_load_ps(brow), b1 = _mm_load_ps(brow + 4);
+                __m128 b2 = _mm_load_ps(brow + 8), b3 = _mm_load_ps(brow + 12);
+                for (int r = 0; r < 4; r++) {
+                    __m128 av = _mm_set1_ps(A[(i + r) * d + k]);
+                    acc[r][0] = _mm_add_ps(acc[r][0], _mm_mul_ps(av, b0));
+                    acc[r][1] = _mm_add_ps(acc[r][1], _mm_mul_ps(av, b1));
+                    acc[r][2] = _mm_add_ps(acc[r][2], _mm_mul_ps(av, b2));
+                    acc[r][3] = _mm_add_ps(acc[r][3], _mm_mul_ps(av, b3));
+                }
+            }
+            for (int r = 0; r < 4; r++) {
+                for (int q = 0; q < 4; q++) _mm_store_ps(C + (i + r) * d + j + 4 * q, acc[r][q]);
+            }
+        }
+    }
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t dot_i8_sse4(const uint8_t *u, const int8_t *s, size_t n) {
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc[4] = { _mm_setzero_si128(), _mm_setzero_si128(),
+                       _mm_setzero_si128(), _mm_setzero_si128() };
+    
+    for (size_t i = 0; i < n; i += 64) {
+        for (int q = 0; q < 4; q++) {
+            __m128i x = _mm_load_si128((const __m128i *)(u + i + 16 * q));
+            __m128i y = _mm_load_si128((const __m128i *)(s + i + 16 * q));
+            __m128i p = _mm_madd_epi16(_mm_maddubs_epi16(x, y), ones);
+            acc[q] = _mm_add_epi32(acc[q], p);
+        }
+    }
+    return hsum_epi32_sse4(_mm_add_epi32(_mm_add_epi32(acc[0], acc[1]),
+                                         _mm_add_epi32(acc[2], acc[3])));
+}
+
+/*
+ * AVX2 + FMA: 8 floats / 32 bytes per register.
+ */
+__attribute__((target("avx2,fma")))
+static float hsum_avx2(__m256 v) {
+    __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+__attribute__((target("avx2,fma")))
+static uint32_t hsum_epi32_avx2(__m256i v) {
+    __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0x4E));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0xB1));
+    return (uint32_t)_mm_cvtsi128_si32(x);
+}
+
+__attribute__((target("avx2,fma")))
+static void add_avx2(const float *a, const float *b, float *c, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        _mm256_store_ps(c + i, _mm256_add_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float *a, const float *b, size_t n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 32) {
+        s0 = _mm256_fmadd_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_load_ps(a + i + 8), _mm256_load_ps(b + i + 8), s1);
+        s2 = _mm256_fmadd_ps(_mm256_load_ps(a + i + 16), _mm256_load_ps(b + i + 16), s2);
+        s3 = _mm256_fmadd_ps(_mm256_load_ps(a + i + 24), _mm256_load_ps(b + i + 24), s3);
+    }
+    return hsum_avx2(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx2,fma")))
+static float sum_avx2(const float *a, size_t n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 32) {
+        s0 = _mm256_add_ps(s0, _mm256_load_ps(a + i));
+        s1 = _mm256_add_ps(s1, _mm256_load_ps(a + i + 8));
+        s2 = _mm256_add_ps(s2, _mm256_load_ps(a + i + 16));
+        s3 = _mm256_add_ps(s3, _mm256_load_ps(a + i + 24));
+    }
+    return hsum_avx2(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx2,fma")))
+static float max_avx2(const float *a, size_t n) {
+    __m256 m0 = _mm256_load_ps(a), m1 = _mm256_load_ps(a + 8);
+    __m256 m2 = _mm256_load_ps(a + 16), m3 = _mm256_load_ps(a + 24);
+    
+    for (size_t i = 32; i < n; i += 32) {
+        m0 = _mm256_max_ps(m0, _mm256_load_ps(a + i));
+        m1 = _mm256_max_ps(m1, _mm256_load_ps(a + i + 8));
+        m2 = _mm256_max_ps(m2, _mm256_load_ps(a + i + 16));
+        m3 = _mm256_max_ps(m3, _mm256_load_ps(a + i + 24));
+    }
+    __m256 m8 = _mm256_max_ps(_mm256_max_ps(m0, m1), _mm256_max_ps(m2, m3));
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(m8), _mm256_extractf128_ps(m8, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+__attribute__((target("avx2,fma")))
+static float gather_avx2(const float *a, const int32_t *idx, size_t n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 32) {
+        const __m256i *x = (const __m256i *)(idx + i);
+        s0 = _mm256_add_ps(s0, _mm256_i32gather_ps(a, _mm256_load_si256(x), 4));
+        s1 = _mm256_add_ps(s1, _mm256_i32gather_ps(a, _mm256_load_si256(x + 1), 4));
+        s2 = _mm256_add_ps(s2, _mm256_i32gather_ps(a, _mm256_load_si256(x + 2), 4));
+        s3 = _mm256_add_ps(s3, _mm256_i32gather_ps(a, _mm256_load_si256(x + 3), 4));
+    }
+    return hsum_avx2(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx2,fma")))
+static size_t scan_avx2(const uint8_t *p, size_t n, uint8_t needle) {
+    const __m256i v = _mm256_set1_epi8((char)needle);
+    
+    for (size_t i = 0; i < n; i += 64) {
+        __m256i e0 = _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)(p + i)), v);
+        __m256i e1 = _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)(p + i + 32)), v);
+        if (_mm256_testz_si256(_mm256_or_si256(e0, e1), _mm256_or_si256(e0, e1))) continue;
+        
+        uint64_t mask = (uint64_t)(uint32_t)_mm256_movemask_epi8(e0) |
+                        (uint64_t)(uint32_t)_mm256_movemask_epi8(e1) << 32;
+        return i + (size_t)__builtin_ctzll(mask);
+    }
+    return n;
+}
+
+__attribute__((target("avx2,fma")))
+static void prefix_avx2(const int32_t *in, int32_t *out, size_t n) {
+    const __m256i last = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_setzero_si256();
+    
+    for (size_t i = 0; i < n; i += 8) {
+        __m256i x = _mm256_load_si256((const __m256i *)(in + i));
+        // Prefix within each 128-bit lane, then carry the low lane's total up
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        __m256i low = _mm256_permute2x128_si256(x, x, 0x08);
+        x = _mm256_add_epi32(x, _mm256_shuffle_epi32(low, 0xFF));
+        x = _mm256_add_epi32(x, carry);
+        _mm256_store_si256((__m256i *)(out + i), x);
+        carry = _mm256_permutevar8x32_epi32(x, last);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void matmul_avx2(const float *A, const float *B, float *C, size_t d) {
+    for (size_t i = 0; i < d; i += 4) {
+        for (size_t j = 0; j < d; j += 16) {
+            __m256 c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00;
+            __m256 c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+            for (size_t k = 0; k < d; k++) {
+                __m256 b0 = _mm256_load_ps(B + k * d + j);
+                __m256 b1 = _mm256_load_ps(B + k * d + j + 8);
+                __m256 a0 = _mm256_broadcast_ss(A + i * d + k);
+                __m256 a1 = _mm256_broadcast_ss(A + (i + 1) * d + k);
+                __m256 a2 = _mm256_broadcast_ss(A + (i + 2) * d + k);
+                __m256 a3 = _mm256_broadcast_ss(A + (i + 3) * d + k);
+                c00 = _mm256_fmadd_ps(a0, b0, c00);
+                c01 = _mm256_fmadd_ps(a0, b1, c01);
+                c10 = _mm256_fmadd_ps(a1, b0, c10);
+                c11 = _mm256_fmadd_ps(a1, b1, c11);
+                c20 = _mm256_fmadd_ps(a2, b0, c20);
+                c21 = _mm256_fmadd_ps(a2, b1, c21);
+                c30 = _mm256_fmadd_ps(a3, b0, c30);
+                c31 = _mm256_fmadd_ps(a3, b1, c31);
+            }
+            float *crow = C + i * d + j;
+            _mm256_store_ps(crow, c00);
+            _mm256_store_ps(crow + 8, c01);
+            _mm256_store_ps(crow + d, c10);
+            _mm256_store_ps(crow + d + 8, c11);
+            _mm256_store_ps(crow + 2 * d, c20);
+            _mm256_store_ps(crow + 2 * d + 8, c21);
+            _mm256_store_ps(crow + 3 * d, c30);
+            _mm256_store_ps(crow + 3 * d + 8, c31);
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static uint32_t dot_i8_avx2(const uint8_t *u, const int8_t *s, size_t n) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0;
+    
+    for (size_t i = 0; i < n; i += 64) {
+        __m256i x0 = _mm256_load_si256((const __m256i *)(u + i));
+        __m256i y0 = _mm256_load_si256((const __m256i *)(s + i));
+        __m256i x1 = _mm256_load_si256((const __m256i *)(u + i + 32));
+        __m256i y1 = _mm256_load_si256((const __m256i *)(s + i + 32));
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_maddubs_epi16(x0, y0), ones));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_maddubs_epi16(x1, y1), ones));
+    }
+    return hsum_epi32_avx2(_mm256_add_epi32(acc0, acc1));
+}
+
+/*
+ * AVX-512 F + BW: 16 floats / 64 bytes per register.
+ */
+__attribute__((target("avx512f,avx512bw")))
+static void add_avx512(const float *a, const float *b, float *c, size_t n) {
+    for (size_t i = 0; i < n; i += 16) {
+        _mm512_store_ps(c + i, _mm512_add_ps(_mm512_load_ps(a + i), _mm512_load_ps(b + i)));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float dot_avx512(const float *a, const float *b, size_t n) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 64) {
+        s0 = _mm512_fmadd_ps(_mm512_load_ps(a + i), _mm512_load_ps(b + i), s0);
+        s1 = _mm512_fmadd_ps(_mm512_load_ps(a + i + 16), _mm512_load_ps(b + i + 16), s1);
+        s2 = _mm512_fmadd_ps(_mm512_load_ps(a + i + 32), _mm512_load_ps(b + i + 32), s2);
+        s3 = _mm512_fmadd_ps(_mm512_load_ps(a + i + 48), _mm512_load_ps(b + i + 48), s3);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float sum_avx512(const float *a, size_t n) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 64) {
+        s0 = _mm512_add_ps(s0, _mm512_load_ps(a + i));
+        s1 = _mm512_add_ps(s1, _mm512_load_ps(a + i + 16));
+        s2 = _mm512_add_ps(s2, _mm512_load_ps(a + i + 32));
+        s3 = _mm512_add_ps(s3, _mm512_load_ps(a + i + 48));
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float max_avx512(const float *a, size_t n) {
+    __m512 m0 = _mm512_load_ps(a), m1 = _mm512_load_ps(a + 16);
+    __m512 m2 = _mm512_load_ps(a + 32), m3 = _mm512_load_ps(a + 48);
+    
+    for (size_t i = 64; i < n; i += 64) {
+        m0 = _mm512_max_ps(m0, _mm512_load_ps(a + i));
+        m1 = _mm512_max_ps(m1, _mm512_load_ps(a + i + 16));
+        m2 = _mm512_max_ps(m2, _mm512_load_ps(a + i + 32));
+        m3 = _mm512_max_ps(m3, _mm512_load_ps(a + i + 48));
+    }
+    return _mm512_reduce_max_ps(_mm512_max_ps(_mm512_max_ps(m0, m1), _mm512_max_ps(m2, m3)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float gather_avx512(const float *a, const int32_t *idx, size_t n) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    
+    for (size_t i = 0; i < n; i += 64) {
+        const __m512i *x = (const __m512i *)(idx + i);
+        s0 = _mm512_add_ps(s0, _mm512_i32gather_ps(_mm512_load_si512(x), a, 4));
+        s1 = _mm512_add_ps(s1, _mm512_i32gather_ps(_mm512_load_si512(x + 1), a, 4));
+        s2 = _mm512_add_ps(s2, _mm512_i32gather_ps(_mm512_load_si512(x + 2), a, 4));
+        s3 = _mm512_add_ps(s3, _mm512_i32gather_ps(_mm512_load_si512(x + 3), a, 4));
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void scatter_avx512(const float *a, const int32_t *idx, float *c, size_t n) {
+    for (size_t i = 0; i < n; i += 16) {
+        _mm512_i32scatter_ps(c, _mm512_load_si512((const __m512i *)(idx + i)),
+                             _mm512_load_ps(a + i), 4);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t scan_avx512(const uint8_t *p, size_t n, uint8_t needle) {
+    const __m512i v = _mm512_set1_epi8((char)needle);
+    
+    for (size_t i = 0; i < n; i += 64) {
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_load_si512((const __m512i *)(p + i)), v);
+        if (mask) return i + (size_t)__builtin_ctzll(mask);
+    }
+    return n;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void prefix_avx512(const int32_t *in, int32_t *out, size_t n) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i last = _mm512_set1_epi32(15);
+    __m512i carry = zero;
+    
+    for (size_t i = 0; i < n; i += 16) {
+        __m512i x = _mm512_load_si512((const __m512i *)(in + i));
+        // alignr with zero shifts left by 1, 2, 4, 8 elements
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 15));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 14));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 12));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 8));
+        x = _mm512_add_epi32(x, carry);
+        _mm512_store_si512((__m512i *)(out + i), x);
+        carry = _mm512_permutexvar_epi32(last, x);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void matmul_avx512(const float *A, const float *B, float *C, size_t d) {
+    for (size_t i = 0; i < d; i += 4) {
+        for (size_t j = 0; j < d; j += 16) {
+            __m512 c0 = _mm512_setzero_ps(), c1 = c0, c2 = c0, c3 = c0;
+            for (size_t k = 0; k < d; k++) {
+                __m512 b = _mm512_load_ps(B + k * d + j);
+                c0 = _mm512_fmadd_ps(_mm512_set1_ps(A[i * d + k]), b, c0);
+                c1 = _mm512_fmadd_ps(_mm512_set1_ps(A[(i + 1) * d + k]), b, c1);
+                c2 = _mm512_fmadd_ps(_mm512_set1_ps(A[(i + 2) * d + k]), b, c2);
+                c3 = _mm512_fmadd_ps(_mm512_set1_ps(A[(i + 3) * d + k]), b, c3);
+            }
+            float *crow = C + i * d + j;
+            _mm512_store_ps(crow, c0);
+            _mm512_store_ps(crow + d, c1);
+            _mm512_store_ps(crow + 2 * d, c2);
+            _mm512_store_ps(crow + 3 * d, c3);
+        }
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static uint32_t dot_i8_avx512(const uint8_t *u, const int8_t *s, size_t n) {
+    const __m512i ones = _mm512_set1_epi16(1);
+    __m512i acc[4] = { _mm512_setzero_si512(), _mm512_setzero_si512(),
+                       _mm512_setzero_si512(), _mm512_setzero_si512() };
+    
+    for (size_t i = 0; i < n; i += 256) {
+        for (int q = 0; q < 4; q++) {
+            __m512i x = _mm512_load_si512((const __m512i *)(u + i + 64 * q));
+            __m512i y = _mm512_load_si512((const __m512i *)(s + i + 64 * q));
+            acc[q] = _mm512_add_epi32(acc[q], _mm512_madd_epi16(_mm512_maddubs_epi16(x, y), ones));
+        }
+    }
+    return (uint32_t)_mm512_reduce_add_epi32(_mm512_add_epi32(_mm512_add_epi32(acc[0], acc[1]),
+                                                              _mm512_add_epi32(acc[2], acc[3])));
+}
+
+/* VNNI fuses the multiply, pairwise add and accumulate into vpdpbusd */
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+static uint32_t dot_i8_vnni(const uint8_t *u, const int8_t *s, size_t n) {
+    __m512i acc[4] = { _mm512_setzero_si512(), _mm512_setzero_si512(),
+                       _mm512_setzero_si512(), _mm512_setzero_si512() };
+    
+    for (size_t i = 0; i < n; i += 256) {
+        for (int q = 0; q < 4; q++) {
+            __m512i x = _mm512_load_si512((const __m512i *)(u + i + 64 * q));
+            __m512i y = _mm512_load_si512((const __m512i *)(s + i + 64 * q));
+            acc[q] = _mm512_dpbusd_epi32(acc[q], x, y);
+        }
+    }
+    return (uint32_t)_mm512_reduce_add_epi32(_mm512_add_epi32(_mm512_add_epi32(acc[0], acc[1]),
+                                                              _mm512_add_epi32(acc[2], acc[3])));
+}
+
+#endif /* SIMD_X86 */
+
+int simd_isa_supported(simd_isa_t isa) {
+    switch (isa) {
+        case SIMD_ISA_SCALAR:
+            return 1;
+#ifdef SIMD_X86
+        case SIMD_ISA_SSE4:
+            return __builtin_cpu_supports("sse4.2");
+        case SIMD_ISA_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case SIMD_ISA_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        case SIMD_ISA_AVX512_VNNI:
+            return simd_isa_supported(SIMD_ISA_AVX512) && __builtin_cpu_supports("avx512vnni");
+#endif
+        default:
+            return 0;
+    }
+}
+
+const char *simd_isa_name(simd_isa_t isa) {
+    static const char *names[SIMD_ISA_COUNT] = {
+        "scalar", "sse4", "avx2", "avx512", "avx512_vnni"
+    };
+    
+    if (isa < 0 || isa >= SIMD_ISA_COUNT) return "unknown";
+    return names[isa];
+}
+
+simd_isa_t simd_isa_best(void) {
+    for (int isa = SIMD_ISA_COUNT - 1; isa > SIMD_ISA_SCALAR; isa--) {
+        if (simd_isa_supported((simd_isa_t)isa)) return (simd_isa_t)isa;
+    }
+    return SIMD_ISA_SCALAR;
+}
+
+const char *simd_op_name(simd_op_t op) {
+    static const char *names[SIMD_OP_COUNT] = {
+        "add", "dot", "sum", "max", "gather", "scatter", "scan", "prefix", "matmul", "dot_i8"
+    };
+    
+    if (op < 0 || op >= SIMD_OP_COUNT) return "unknown";
+    return names[op];
+}
+
+int simd_op_has_variant(simd_op_t op, simd_isa_t isa) {
+    switch (isa) {
+        case SIMD_ISA_SCALAR:
+        case SIMD_ISA_AVX512:
+            return 1;
+        case SIMD_ISA_SSE4:
+        case SIMD_ISA_AVX2:
+            return op != SIMD_OP_SCATTER;
+        case SIMD_ISA_AVX512_VNNI:
+            return op == SIMD_OP_DOT_I8;
+        default:
+            return 0;
+    }
+}
+
+/* Variant that actually runs: supported, and narrowed to one that exists */
+static simd_isa_t resolve_isa(simd_op_t op, simd_isa_t isa) {
+    if (!simd_isa_supported(isa)) return SIMD_ISA_SCALAR;
+    while (isa > SIMD_ISA_SCALAR && !simd_op_has_variant(op, isa)) {
+        isa = isa == SIMD_ISA_AVX512 ? SIMD_ISA_SCALAR : (simd_isa_t)(isa - 1);
+    }
+    return isa;
+}
+
+int simd_suite_init(simd_suite_t *s, size_t bytes) {
+    memset(s, 0, sizeof(*s));
+    if (bytes < SIMD_MIN_BYTES) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    bytes = (bytes + SIMD_ALIGN - 1) & ~(size_t)(SIMD_ALIGN - 1);
+    s->bytes = bytes;
+    s->a = aligned_alloc(SIMD_ALIGN, bytes);
+    s->b = aligned_alloc(SIMD_ALIGN, bytes);
+    s->c = aligned_alloc(SIMD_ALIGN, bytes);
+    if (!s->a || !s->b || !s->c) {
+        simd_suite_cleanup(s);
+        errno = ENOMEM;
+        return -1;
+    }
+    
+    // Fault the pages in now, not during the first timed pass
+    memset(s->a, 0, bytes);
+    memset(s->b, 0, bytes);
+    memset(s->c, 0, bytes);
+    s->prepared = SIMD_OP_COUNT;
+    return 0;
+}
+
+/* Multiples of 1/8 in [-1, 1]: every partial sum stays exact */
+static void fill_float(float *p, size_t n, unsigned period) {
+    for (size_t i = 0; i < n; i++) {
+        p[i] = (float)((int)(i % period) - (int)(period / 2)) * 0.125f;
+    }
+}
+
+static void fill_permutation(int32_t *idx, size_t n) {
+    lrc_rng_t rng;
+    
+    lrc_rng_seed(&rng, SIMD_SEED);
+    for (size_t i = 0; i < n; i++) idx[i] = (int32_t)i;
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = (size_t)lrc_rng_bounded(&rng, i + 1);
+        int32_t t = idx[i];
+        idx[i] = idx[j];
+        idx[j] = t;
+    }
+}
+
+void simd_suite_prepare(simd_suite_t *s, simd_op_t op) {
+    size_t bytes = s->bytes;
+    size_t n;
+    
+    switch (op) {
+        case SIMD_OP_ADD:
+        case SIMD_OP_SCATTER: n = bytes / 12; break;
+        case SIMD_OP_DOT:
+        case SIMD_OP_GATHER:
+        case SIMD_OP_PREFIX:  n = bytes / 8; break;
+        case SIMD_OP_SCAN:    n = bytes; break;
+        case SIMD_OP_DOT_I8:  n = bytes / 2; break;
+        default:              n = bytes / 4; break;
+    }
+    // Byte kernels step over four 64-byte vectors
+    size_t step = op == SIMD_OP_SCAN || op == SIMD_OP_DOT_I8 ? 4 * SIMD_STEP : SIMD_STEP;
+    n &= ~(step - 1);
+    s->n = n;
+    s->prepared = op;
+    
+    switch (op) {
+        case SIMD_OP_ADD:
+        case SIMD_OP_DOT:
+            fill_float(s->a, n, 17);
+            fill_float(s->b, n, 13);
+            break;
+        case SIMD_OP_SUM:
+        case SIMD_OP_MAX:
+            fill_float(s->a, n, 17);
+            break;
+        case SIMD_OP_GATHER:
+        case SIMD_OP_SCATTER:
+            fill_float(s->a, n, 17);
+            fill_permutation(s->b, n);
+            break;
+        case SIMD_OP_SCAN: {
+            // Never the needle until the last byte, so every pass scans it all
+            uint8_t *p = s->a;
+            for (size_t i = 0; i < n; i++) p[i] = (uint8_t)(1 + i % 255);
+            p[n - 1] = 0;
+            break;
+        }
+        case SIMD_OP_PREFIX: {
+            int32_t *in = s->a;
+            for (size_t i = 0; i < n; i++) in[i] = (int32_t)(i & 7);
+            break;
+        }
+        case SIMD_OP_MATMUL: {
+            size_t d = 16;
+            while ((d + 16) * (d + 16) * 12 <= bytes && d + 16 <= SIMD_MATMUL_MAX_DIM) d += 16;
+            s->dim = d;
+            s->n = d * d;
+            fill_float(s->a, s->n, 17);
+            fill_float(s->b, s->n, 13);
+            break;
+        }
+        case SIMD_OP_DOT_I8: {
+            uint8_t *u = s->a;
+            int8_t *v = s->b;
+            for (size_t i = 0; i < n; i++) {
+                u[i] = (uint8_t)(i % 64);
+                v[i] = (int8_t)((int)(i % 127) - 64);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+double simd_suite_run(simd_suite_t *s, simd_op_t op, simd_isa_t isa) {
+    if (s->prepared != op) simd_suite_prepare(s, op);
+    
+    const float *fa = s->a, *fb = s->b;
+    float *fc = s->c;
+    const int32_t *idx = s->b;
+    size_t n = s->n;
+    isa = resolve_isa(op, isa);
+    
+    switch (op) {
+        case SIMD_OP_ADD:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   add_sse4(fa, fb, fc, n); break;
+                case SIMD_ISA_AVX2:   add_avx2(fa, fb, fc, n); break;
+                case SIMD_ISA_AVX512: add_avx512(fa, fb, fc, n); break;
+#endif
+                default:              add_scalar(fa, fb, fc, n); break;
+            }
+            return (double)fc[0] + fc[n / 2] + fc[n - 1];
+        case SIMD_OP_DOT:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   return dot_sse4(fa, fb, n);
+                case SIMD_ISA_AVX2:   return dot_avx2(fa, fb, n);
+                case SIMD_ISA_AVX512: return dot_avx512(fa, fb, n);
+#endif
+                default:              return dot_scalar(fa, fb, n);
+            }
+        case SIMD_OP_SUM:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   return sum_sse4(fa, n);
+                case SIMD_ISA_AVX2:   return sum_avx2(fa, n);
+                case SIMD_ISA_AVX512: return sum_avx512(fa, n);
+#endif
+                default:              return sum_scalar(fa, n);
+            }
+        case SIMD_OP_MAX:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   return max_sse4(fa, n);
+                case SIMD_ISA_AVX2:   return max_avx2(fa, n);
+                case SIMD_ISA_AVX512: return max_avx512(fa, n);
+#endif
+                default:              return max_scalar(fa, n);
+            }
+        case SIMD_OP_GATHER:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   return gather_sse4(fa, idx, n);
+                case SIMD_ISA_AVX2:   return gather_avx2(fa, idx, n);
+                case SIMD_ISA_AVX512: return gather_avx512(fa, idx, n);
+#endif
+                default:              return gather_scalar(fa, idx, n);
+            }
+        case SIMD_OP_SCATTER:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_AVX512: scatter_avx512(fa, idx, fc, n); break;
+#endif
+                default:              scatter_scalar(fa, idx, fc, n); break;
+            }
+            return (double)fc[0] + fc[n / 2] + fc[n - 1];
+        case SIMD_OP_SCAN:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   return (double)scan_sse4(s->a, n, 0);
+                case SIMD_ISA_AVX2:   return (double)scan_avx2(s->a, n, 0);
+                case SIMD_ISA_AVX512: return (double)scan_avx512(s->a, n, 0);
+#endif
+                default:              return (double)scan_scalar(s->a, n, 0);
+            }
+        case SIMD_OP_PREFIX: {
+            int32_t *out = s->c;
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   prefix_sse4(s->a, out, n); break;
+                case SIMD_ISA_AVX2:   prefix_avx2(s->a, out, n); break;
+                case SIMD_ISA_AVX512: prefix_avx512(s->a, out, n); break;
+#endif
+                default:              prefix_scalar(s->a, out, n); break;
+            }
+            return (double)out[n / 2] + out[n - 1];
+        }
+        case SIMD_OP_MATMUL: {
+            size_t d = s->dim;
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:   matmul_sse4(fa, fb, fc, d); break;
+                case SIMD_ISA_AVX2:   matmul_avx2(fa, fb, fc, d); break;
+                case SIMD_ISA_AVX512: matmul_avx512(fa, fb, fc, d); break;
+#endif
+                default:              matmul_scalar(fa, fb, fc, d); break;
+            }
+            return (double)fc[0] + fc[d + 1] + fc[d * d - 1];
+        }
+        case SIMD_OP_DOT_I8:
+            switch (isa) {
+#ifdef SIMD_X86
+                case SIMD_ISA_SSE4:        return dot_i8_sse4(s->a, s->b, n);
+                case SIMD_ISA_AVX2:        return dot_i8_avx2(s->a, s->b, n);
+                case SIMD_ISA_AVX512:      return dot_i8_avx512(s->a, s->b, n);
+                case SIMD_ISA_AVX512_VNNI: return dot_i8_vnni(s->a, s->b, n);
+#endif
+                default:                   return dot_i8_scalar(s->a, s->b, n);
+            }
+        default:
+            return 0.0;
+    }
+}
+
+void simd_suite_work(const simd_suite_t *s, simd_op_t op, double *ops, double *bytes) {
+    double n = (double)s->n;
+    double d = (double)s->dim;
+    
+    switch (op) {
+        case SIMD_OP_ADD:     *ops = n;             *bytes = 12 * n; break;
+        case SIMD_OP_DOT:     *ops = 2 * n;         *bytes = 8 * n; break;
+        case SIMD_OP_SUM:
+        case SIMD_OP_MAX:     *ops = n;             *bytes = 4 * n; break;
+        case SIMD_OP_GATHER:  *ops = n;             *bytes = 8 * n; break;
+        case SIMD_OP_SCATTER: *ops = 0;             *bytes = 12 * n; break;
+        case SIMD_OP_SCAN:    *ops = 0;             *bytes = n; break;
+        case SIMD_OP_PREFIX:  *ops = n;             *bytes = 8 * n; break;
+        case SIMD_OP_MATMUL:  *ops = 2 * d * d * d; *bytes = 12 * d * d; break;
+        case SIMD_OP_DOT_I8:  *ops = 2 * n;         *bytes = 2 * n; break;
+        default:              *ops = 0;             *bytes = 0; break;
+    }
+}
+
+void simd_suite_cleanup(simd_suite_t *s) {
+    free(s->a);
+    free(s->b);
+    free(s->c);
+    s->a = s->b = s->c = NULL;
+}
+
+double simd_freq_probe_ghz(void) {
+#ifdef SIMD_X86
+    uint64_t x = 0, one = 1;
+    
+    tsc_init();
+    uint64_t begin = tsc_begin();
+    for (int i = 0; i < PROBE_ADDS / 8; i++) {
+        // One dependency chain: 8 adds take 8 cycles at any width or port
+        // count. Register operands, since newer cores fold add-immediate
+        // chains at rename and would retire several per cycle
+        __asm__ volatile("add %1, %0\n\tadd %1, %0\n\tadd %1, %0\n\tadd %1, %0\n\t"
+                         "add %1, %0\n\tadd %1, %0\n\tadd %1, %0\n\tadd %1, %0"
+                         : "+r"(x) : "r"(one));
+    }
+    double ns = tsc_to_ns(tsc_elapsed(begin, tsc_end()));
+    return ns > 0 ? PROBE_ADDS / ns : 0.0;
+#else
+    return 0.0;
+#endif
+}
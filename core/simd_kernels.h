@@ -0,0 +1,140 @@
+/*
+ * simd_kernels.h - Vector kernel suite with runtime ISA dispatch
+ *
+ * A fixed set of kernels, each written once per instruction set with
+ * the same algorithm (same accumulator count and loop order), so the
+ * only thing that changes between variants is the vector width and the
+ * instructions available:
+ *
+ *   add        c[i] = a[i] + b[i]                  float, 1 flop/element
+ *   dot        sum a[i] * b[i]                     float, 2 flops/element
+ *   sum, max   horizontal reductions of a          float, 1 flop/element
+ *   gather     sum a[idx[i]], random idx           float, 1 flop/element
+ *   scatter    c[idx[i]] = a[i]                    float, no flops
+ *   scan       first byte equal to a needle        memchr-style, GB/s
+ *   prefix     inclusive prefix sum                int32, 1 op/element
+ *   matmul     C = A * B, square dim x dim tile    float, 2 dim^3 flops
+ *   dot_i8     sum u8[i] * s8[i] into int32         2 ops/element
+ *
+ * Every SIMD variant is compiled with a per-function target attribute
+ * and chosen from CPUID at runtime (simd_isa_supported()), so one binary
+ * reports what the machine it runs on can do, whatever -march it was
+ * built with. Some combinations have no distinct variant (no scatter
+ * before AVX-512, VNNI only changes dot_i8); simd_op_has_variant() says
+ * which ones to measure.
+ *
+ *     simd_suite_t s;
+ *     simd_suite_init(&s, 256 * 1024);          // Working set in bytes
+ *     simd_suite_prepare(&s, SIMD_OP_DOT);      // Untimed data setup
+ *     double check = simd_suite_run(&s, SIMD_OP_DOT, SIMD_ISA_AVX2);
+ *     simd_suite_work(&s, SIMD_OP_DOT, &ops, &bytes);
+ *     simd_suite_cleanup(&s);
+ */
+
+#ifndef LRC_SIMD_KERNELS_H
+#define LRC_SIMD_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    SIMD_ISA_SCALAR = 0,      // Plain C, auto-vectorization disabled
+    SIMD_ISA_SSE4,            // SSE4.2, 128-bit
+    SIMD_ISA_AVX2,            // AVX2 + FMA, 256-bit
+    SIMD_ISA_AVX512,          // AVX-512 F + BW, 512-bit
+    SIMD_ISA_AVX512_VNNI,     // AVX-512 with vpdpbusd
+    SIMD_ISA_COUNT
+} simd_isa_t;
+
+typedef enum {
+    SIMD_OP_ADD = 0,
+    SIMD_OP_DOT,
+    SIMD_OP_SUM,
+    SIMD_OP_MAX,
+    SIMD_OP_GATHER,
+    SIMD_OP_SCATTER,
+    SIMD_OP_SCAN,
+    SIMD_OP_PREFIX,
+    SIMD_OP_MATMUL,
+    SIMD_OP_DOT_I8,
+    SIMD_OP_COUNT
+} simd_op_t;
+
+#define SIMD_MATMUL_MAX_DIM 512   // Larger working sets reuse the 3 MB tile
+
+typedef struct {
+    size_t bytes;             // Working set requested at init
+    void *a;                  // Three buffers of `bytes` each, 64-byte aligned;
+    void *b;                  // each op lays its operands out in them
+    void *c;
+    size_t n;                 // Elements of the prepared op
+    size_t dim;               // matmul: matrix dimension
+    simd_op_t prepared;
+} simd_suite_t;
+
+/**
+ * @brief Whether this CPU (and OS, for the wider register state) runs an ISA
+ */
+int simd_isa_supported(simd_isa_t isa);
+
+/**
+ * @brief Short ISA name for CSV output ("scalar", "sse4", "avx2", ...)
+ */
+const char *simd_isa_name(simd_isa_t isa);
+
+/**
+ * @brief Widest supported ISA
+ */
+simd_isa_t simd_isa_best(void);
+
+/**
+ * @brief Kernel name for CSV output ("add", "dot", ...)
+ */
+const char *simd_op_name(simd_op_t op);
+
+/**
+ * @brief Whether op has its own implementation for isa
+ * @return 0 when the variant would just run a narrower one (e.g. scatter
+ *         before AVX-512, anything but dot_i8 with VNNI)
+ */
+int simd_op_has_variant(simd_op_t op, simd_isa_t isa);
+
+/**
+ * @brief Allocate the suite's buffers
+ * @param bytes Working set every op is sized to (operands plus results)
+ * @return 0 on success, -1 on allocation failure
+ */
+int simd_suite_init(simd_suite_t *s, size_t bytes);
+
+/**
+ * @brief Lay out and fill the operands of op (outside the timed region)
+ */
+void simd_suite_prepare(simd_suite_t *s, simd_op_t op);
+
+/**
+ * @brief One pass of op over the prepared data
+ * @param isa Variant to run (falls back to SCALAR if unsupported)
+ * @return Checksum of the result; equal across ISAs up to float rounding
+ */
+double simd_suite_run(simd_suite_t *s, simd_op_t op, simd_isa_t isa);
+
+/**
+ * @brief Work done by one pass
+ * @param ops Arithmetic operations (flops, or integer ops for prefix and dot_i8)
+ * @param bytes Bytes read plus written
+ */
+void simd_suite_work(const simd_suite_t *s, simd_op_t op, double *ops, double *bytes);
+
+void simd_suite_cleanup(simd_suite_t *s);
+
+/**
+ * @brief Current core clock from a chain of dependent integer adds
+ *
+ * Runs ~100k single-cycle dependent adds and times them with the TSC, so
+ * a reading taken right after a wide-vector kernel shows the frequency
+ * licence it left the core in without needing a PMU.
+ * @return GHz, 0 on non-x86 (clock_gettime timing without a usable TSC)
+ */
+double simd_freq_probe_ghz(void);
+
+#endif /* LRC_SIMD_KERNELS_H */
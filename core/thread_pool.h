@@ -0,0 +1,103 @@
+/*
+ * thread_pool.h - Persistent pinned worker pool
+ *
+ * Workers are created and pinned once, then reused for every run. Each
+ * run releases the workers through a spin barrier and times each one
+ * individually (TSC cycles and CLOCK_MONOTONIC_RAW), so thread creation,
+ * migration and wake-up latency stay outside the measured interval.
+ */
+
+#ifndef LRC_THREAD_POOL_H
+#define LRC_THREAD_POOL_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * @brief Per-thread work function
+ * @param id Worker index (0..active-1)
+ * @param arg Argument passed to thread_pool_run()
+ */
+typedef void (*thread_pool_fn_t)(int id, void *arg);
+
+/**
+ * @brief Timing of one worker for the last run
+ */
+typedef struct {
+    uint64_t start_ns;       // CLOCK_MONOTONIC_RAW when released from the barrier
+    uint64_t end_ns;         // CLOCK_MONOTONIC_RAW when fn returned
+    uint64_t cycles;         // TSC cycles spent in fn (0 without a TSC)
+    int cpu;                 // CPU the worker finished on
+} thread_pool_timing_t;
+
+/**
+ * @brief Worker pool (fields after timing are internal)
+ */
+typedef struct {
+    int num_threads;
+    int *cpus;                       // CPU per worker, -1 = unpinned
+    thread_pool_timing_t *timing;    // Indexed by worker id, valid for 0..active-1
+    
+    pthread_t *threads;
+    void *worker_args;               // (pool, id) handed to each thread
+    pthread_mutex_t lock;
+    pthread_cond_t wake;             // Workers park here between runs
+    pthread_cond_t done;             // Caller waits here for the run to end
+    uint64_t generation;             // Bumped once per run
+    int stop;
+    int started;                     // Workers pinned and parked after create
+    
+    thread_pool_fn_t setup;          // Current run (written under lock)
+    thread_pool_fn_t fn;
+    void *arg;
+    int active;
+    
+    volatile int arrived;            // Spin barrier
+    volatile int release;
+    volatile int pending;            // Workers still in fn
+} thread_pool_t;
+
+/**
+ * @brief Create workers and pin each before it does anything else
+ * @param pool Pool to initialize
+ * @param num_threads Number of workers
+ * @param cpus CPU for worker i (NULL: leave workers unpinned)
+ * @return 0 on success, -1 on error
+ * @note Returns only after every worker is pinned and parked
+ */
+int thread_pool_create(thread_pool_t *pool, int num_threads, const int *cpus);
+
+/**
+ * @brief Run fn on the first active workers and wait for all of them
+ * @param pool Pool
+ * @param active Workers taking part (1..num_threads)
+ * @param setup Untimed per-thread preparation before the barrier (may be NULL)
+ * @param fn Timed per-thread work
+ * @param arg Passed to setup and fn
+ * @return 0 on success, -1 if active is out of range
+ */
+int thread_pool_run(thread_pool_t *pool, int active, thread_pool_fn_t setup,
+                    thread_pool_fn_t fn, void *arg);
+
+/**
+ * @brief Wall time of the last run: first release to last finish
+ */
+uint64_t thread_pool_elapsed_ns(const thread_pool_t *pool);
+
+/**
+ * @brief Spread of barrier release times in the last run
+ * @note Large values mean workers were not running when released
+ *       (oversubscribed CPUs or preemption)
+ */
+uint64_t thread_pool_start_skew_ns(const thread_pool_t *pool);
+
+/**
+ * @brief Stop and join all workers, release memory
+ */
+void thread_pool_destroy(thread_pool_t *pool);
+
+#endif /* LRC_THREAD_POOL_H */
@@ -0,0 +1,497 @@
+/*
+ * topology.c - CPU topology discovery and thread placement
+ *
+ * Purpose:
+ *   Place threads deliberately on hosts with hundreds of hardware
+ *   threads: which CPUs share a core (SMT), an L3 (CCX), a NUMA node or
+ *   a package decides whether a scaling curve measures the algorithm or
+ *   the interconnect.
+ *
+ * Design:
+ *   - Sysfs is read once in topology_init(); queries are in-memory
+ *   - CPU sets are sized dynamically (CPU_ALLOC), no 64/1024-CPU ceiling
+ *   - Only CPUs that are online and in the process affinity mask are
+ *     listed, so taskset/cgroup restrictions are respected
+ *
+ * Justification for syscalls:
+ *   sched_getaffinity() and sysfs reads happen at init only;
+ *   pthread_setaffinity_np() once per thread placement.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "topology.h"
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+#define SYSFS_NODE "/sys/devices/system/node"
+#define MAX_CACHE_INDEX 16
+
+static const char *placement_names[TOPO_PLACE_COUNT] = {
+    "compact", "scatter", "per_l3"
+};
+
+static int read_file(const char *path, char *buf, size_t size) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    
+    size_t n = fread(buf, 1, size - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    return (int)n;
+}
+
+static int read_int(const char *path, int fallback) {
+    char buf[64];
+    if (read_file(path, buf, sizeof(buf)) <= 0) return fallback;
+    return atoi(buf);
+}
+
+/*
+ * First CPU of a list (sysfs lists are ascending), -1 if unreadable.
+ */
+static int read_first_cpu(const char *path) {
+    char buf[64];
+    if (read_file(path, buf, sizeof(buf)) <= 0) return -1;
+    return atoi(buf);
+}
+
+int topology_parse_cpulist(const char *list, cpu_set_t *set, size_t setsize) {
+    int count = 0;
+    const char *p = list;
+    
+    CPU_ZERO_S(setsize, set);
+    
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        
+        for (long c = first; c <= last; c++) {
+            if ((size_t)c < setsize * 8 && !CPU_ISSET_S(c, setsize, set)) {
+                CPU_SET_S(c, setsize, set);
+                count++;
+            }
+        }
+        
+        while (*p == ',' || *p == '\n' || *p == ' ') p++;
+    }
+    
+    return count;
+}
+
+/*
+ * Highest possible CPU id + 1.
+ */
+static int detect_cpu_limit(void) {
+    char buf[256];
+    int limit = (int)sysconf(_SC_NPROCESSORS_CONF);
+    
+    if (read_file(SYSFS_CPU "/possible", buf, sizeof(buf)) > 0) {
+        // Last number in the list is the highest id
+        char *last = buf;
+        for (char *p = buf; *p; p++) {
+            if ((*p == '-' || *p == ',') && p[1]) last = p + 1;
+        }
+        int max_id = atoi(last);
+        if (max_id + 1 > limit) limit = max_id + 1;
+    }
+    
+    return limit > 0 ? limit : 1;
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Replace keys with their rank among the distinct keys (0..n-1).
+ * Returns the number of distinct keys.
+ */
+static int densify(int *keys, int n) {
+    int *sorted = malloc(n * sizeof(int));
+    if (!sorted) return 0;
+    
+    memcpy(sorted, keys, n * sizeof(int));
+    qsort(sorted, n, sizeof(int), compare_int);
+    
+    int unique = 0;
+    for (int i = 0; i < n; i++) {
+        if (i == 0 || sorted[i] != sorted[i - 1]) sorted[unique++] = sorted[i];
+    }
+    
+    for (int i = 0; i < n; i++) {
+        int *found = bsearch(&keys[i], sorted, unique, sizeof(int), compare_int);
+        keys[i] = (int)(found - sorted);
+    }
+    
+    free(sorted);
+    return unique;
+}
+
+/*
+ * Lowest CPU sharing this CPU's L3, or -1 if no L3 is described.
+ */
+static int l3_key(int cpu) {
+    char path[256];
+    
+    for (int idx = 0; idx < MAX_CACHE_INDEX; idx++) {
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/level", cpu, idx);
+        int level = read_int(path, -1);
+        if (level < 0) break;
+        if (level != 3) continue;
+        
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/shared_cpu_list", cpu, idx);
+        return read_first_cpu(path);
+    }
+    
+    return -1;
+}
+
+/*
+ * Assign node domains from /sys/devices/system/node/node<N>/cpulist.
+ * Domains are dense like the other levels; node_ids keeps the kernel
+ * numbering (valid for mbind), which may have holes.
+ */
+static int assign_nodes(topology_t *t, cpu_set_t *scratch, size_t setsize, int *keys) {
+    for (int i = 0; i < t->num_cpus; i++) t->cpus[i].domain[TOPO_LEVEL_NODE] = 0;
+    
+    DIR *dir = opendir(SYSFS_NODE);
+    if (dir) {
+        struct dirent *ent;
+        char path[512], buf[4096];
+        
+        while ((ent = readdir(dir)) != NULL) {
+            int node;
+            if (sscanf(ent->d_name, "node%d", &node) != 1) continue;
+            
+            snprintf(path, sizeof(path), SYSFS_NODE "/%s/cpulist", ent->d_name);
+            if (read_file(path, buf, sizeof(buf)) <= 0) continue;
+            topology_parse_cpulist(buf, scratch, setsize);
+            
+            for (int i = 0; i < t->num_cpus; i++) {
+                if (CPU_ISSET_S(t->cpus[i].cpu, setsize, scratch)) {
+                    t->cpus[i].domain[TOPO_LEVEL_NODE] = node;
+                }
+            }
+        }
+        closedir(dir);
+    }
+    
+    for (int i = 0; i < t->num_cpus; i++) keys[i] = t->cpus[i].domain[TOPO_LEVEL_NODE];
+    int count = densify(keys, t->num_cpus);
+    if (count == 0 && t->num_cpus > 0) return -1;
+    
+    t->node_ids = calloc(count > 0 ? count : 1, sizeof(int));
+    if (!t->node_ids) return -1;
+    
+    for (int i = 0; i < t->num_cpus; i++) {
+        t->node_ids[keys[i]] = t->cpus[i].domain[TOPO_LEVEL_NODE];
+        t->cpus[i].domain[TOPO_LEVEL_NODE] = keys[i];
+    }
+    t->num_domains[TOPO_LEVEL_NODE] = count > 0 ? count : 1;
+    return 0;
+}
+
+int topology_init(topology_t *t) {
+    char path[256], buf[4096];
+    
+    memset(t, 0, sizeof(topology_t));
+    t->cpu_limit = detect_cpu_limit();
+    
+    size_t setsize = CPU_ALLOC_SIZE(t->cpu_limit);
+    cpu_set_t *online = CPU_ALLOC(t->cpu_limit);
+    cpu_set_t *allowed = CPU_ALLOC(t->cpu_limit);
+    if (!online || !allowed) {
+        CPU_FREE(online);
+        CPU_FREE(allowed);
+        return -1;
+    }
+    
+    if (read_file(SYSFS_CPU "/online", buf, sizeof(buf)) > 0) {
+        topology_parse_cpulist(buf, online, setsize);
+    } else {
+        CPU_ZERO_S(setsize, online);
+        for (long c = 0; c < sysconf(_SC_NPROCESSORS_ONLN); c++) CPU_SET_S(c, setsize, online);
+    }
+    
+    if (sched_getaffinity(0, setsize, allowed) != 0) {
+        memcpy(allowed, online, setsize);
+    }
+    CPU_AND_S(setsize, online, online, allowed);
+    
+    t->cpus = calloc(t->cpu_limit, sizeof(topo_cpu_t));
+    int *keys = calloc(t->cpu_limit, sizeof(int));
+    if (!t->cpus || !keys) {
+        free(keys);
+        topology_destroy(t);
+        CPU_FREE(online);
+        CPU_FREE(allowed);
+        return -1;
+    }
+    
+    for (int c = 0; c < t->cpu_limit; c++) {
+        if (!CPU_ISSET_S(c, setsize, online)) continue;
+        topo_cpu_t *tc = &t->cpus[t->num_cpus++];
+        tc->cpu = c;
+        
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/physical_package_id", c);
+        tc->domain[TOPO_LEVEL_PACKAGE] = read_int(path, 0);
+        if (tc->domain[TOPO_LEVEL_PACKAGE] < 0) tc->domain[TOPO_LEVEL_PACKAGE] = 0;
+        
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/thread_siblings_list", c);
+        int core = read_first_cpu(path);
+        tc->domain[TOPO_LEVEL_CORE] = core >= 0 ? core : c;
+        
+        // No L3 described: one L3 domain per package (negative keys)
+        int l3 = l3_key(c);
+        tc->domain[TOPO_LEVEL_L3] = l3 >= 0 ? l3 : -1 - tc->domain[TOPO_LEVEL_PACKAGE];
+    }
+    
+    // Dense ids for core, L3 and package levels
+    topo_level_t dense[] = {TOPO_LEVEL_CORE, TOPO_LEVEL_L3, TOPO_LEVEL_PACKAGE};
+    for (size_t l = 0; l < sizeof(dense) / sizeof(dense[0]); l++) {
+        for (int i = 0; i < t->num_cpus; i++) keys[i] = t->cpus[i].domain[dense[l]];
+        t->num_domains[dense[l]] = densify(keys, t->num_cpus);
+        for (int i = 0; i < t->num_cpus; i++) t->cpus[i].domain[dense[l]] = keys[i];
+    }
+    
+    if (assign_nodes(t, allowed, setsize, keys) != 0) {
+        free(keys);
+        topology_destroy(t);
+        CPU_FREE(online);
+        CPU_FREE(allowed);
+        return -1;
+    }
+    
+    // SMT index: siblings with a lower CPU id come first
+    for (int i = 0; i < t->num_cpus; i++) {
+        for (int j = 0; j < i; j++) {
+            if (t->cpus[j].domain[TOPO_LEVEL_CORE] == t->cpus[i].domain[TOPO_LEVEL_CORE]) {
+                t->cpus[i].smt_index++;
+            }
+        }
+    }
+    
+    free(keys);
+    CPU_FREE(online);
+    CPU_FREE(allowed);
+    return t->num_cpus > 0 ? 0 : -1;
+}
+
+void topology_destroy(topology_t *t) {
+    free(t->cpus);
+    free(t->node_ids);
+    memset(t, 0, sizeof(topology_t));
+}
+
+const topo_cpu_t *topology_cpu(const topology_t *t, int cpu) {
+    for (int i = 0; i < t->num_cpus; i++) {
+        if (t->cpus[i].cpu == cpu) return &t->cpus[i];
+    }
+    return NULL;
+}
+
+int topology_node_id(const topology_t *t, int domain) {
+    if (!t->node_ids || domain < 0 || domain >= t->num_domains[TOPO_LEVEL_NODE]) return -1;
+    return t->node_ids[domain];
+}
+
+int topology_domain_cpus(const topology_t *t, topo_level_t level, int id, int *cpus, int max) {
+    int count = 0;
+    
+    for (int i = 0; i < t->num_cpus; i++) {
+        if (t->cpus[i].domain[level] != id) continue;
+        if (cpus && count < max) cpus[count] = t->cpus[i].cpu;
+        count++;
+    }
+    
+    return count;
+}
+
+cpu_set_t *topology_domain_cpuset(const topology_t *t, topo_level_t level, int id, size_t *setsize) {
+    cpu_set_t *set = CPU_ALLOC(t->cpu_limit);
+    if (!set) return NULL;
+    
+    *setsize = CPU_ALLOC_SIZE(t->cpu_limit);
+    CPU_ZERO_S(*setsize, set);
+    
+    for (int i = 0; i < t->num_cpus; i++) {
+        if (t->cpus[i].domain[level] == id) CPU_SET_S(t->cpus[i].cpu, *setsize, set);
+    }
+    
+    return set;
+}
+
+#define PLACE_KEYS 5
+
+typedef struct {
+    int key[PLACE_KEYS];
+    int cpu;
+} place_entry_t;
+
+static int compare_place(const void *a, const void *b) {
+    const place_entry_t *x = a;
+    const place_entry_t *y = b;
+    
+    for (int k = 0; k < PLACE_KEYS; k++) {
+        if (x->key[k] != y->key[k]) return (x->key[k] > y->key[k]) - (x->key[k] < y->key[k]);
+    }
+    return (x->cpu > y->cpu) - (x->cpu < y->cpu);
+}
+
+/*
+ * Rank of each domain of `inner` level among the domains sharing the
+ * same `outer` domain (ordered by id). E.g. core 5 is the 2nd core of
+ * its L3 -> rank 1.
+ */
+static int *domain_ranks(const topology_t *t, topo_level_t inner, topo_level_t outer) {
+    int n = t->num_domains[inner];
+    int *rank = malloc(n * sizeof(int));
+    int *outer_of = malloc(n * sizeof(int));
+    if (!rank || !outer_of) {
+        free(rank);
+        free(outer_of);
+        return NULL;
+    }
+    
+    for (int d = 0; d < n; d++) outer_of[d] = -1;
+    for (int i = 0; i < t->num_cpus; i++) {
+        outer_of[t->cpus[i].domain[inner]] = t->cpus[i].domain[outer];
+    }
+    
+    for (int d = 0; d < n; d++) {
+        rank[d] = 0;
+        for (int e = 0; e < d; e++) {
+            if (outer_of[e] == outer_of[d]) rank[d]++;
+        }
+    }
+    
+    free(outer_of);
+    return rank;
+}
+
+int topology_place(const topology_t *t, topo_placement_t policy, int count, int *cpus) {
+    place_entry_t *order = malloc(t->num_cpus * sizeof(place_entry_t));
+    int *core_rank = domain_ranks(t, TOPO_LEVEL_CORE, TOPO_LEVEL_L3);
+    int *l3_rank = domain_ranks(t, TOPO_LEVEL_L3, TOPO_LEVEL_PACKAGE);
+    int placed = 0;
+    
+    if (!order || !core_rank || !l3_rank) goto out;
+    
+    int entries = 0;
+    for (int i = 0; i < t->num_cpus; i++) {
+        const topo_cpu_t *c = &t->cpus[i];
+        place_entry_t *e = &order[entries];
+        int cr = core_rank[c->domain[TOPO_LEVEL_CORE]];
+        int lr = l3_rank[c->domain[TOPO_LEVEL_L3]];
+        
+        e->cpu = c->cpu;
+        if (policy == TOPO_PLACE_COMPACT) {
+            // Nested order: package, node, L3, core, sibling
+            e->key[0] = c->domain[TOPO_LEVEL_PACKAGE];
+            e->key[1] = c->domain[TOPO_LEVEL_NODE];
+            e->key[2] = c->domain[TOPO_LEVEL_L3];
+            e->key[3] = c->domain[TOPO_LEVEL_CORE];
+            e->key[4] = c->smt_index;
+        } else {
+            // Round-robin: packages fastest, then L3s, then cores; SMT last
+            if (policy == TOPO_PLACE_PER_L3 && (cr != 0 || c->smt_index != 0)) continue;
+            e->key[0] = c->smt_index;
+            e->key[1] = cr;
+            e->key[2] = lr;
+            e->key[3] = c->domain[TOPO_LEVEL_PACKAGE];
+            e->key[4] = c->domain[TOPO_LEVEL_NODE];
+        }
+        entries++;
+    }
+    
+    qsort(order, entries, sizeof(place_entry_t), compare_place);
+    
+    placed = count < entries ? count : entries;
+    for (int i = 0; i < placed; i++) cpus[i] = order[i].cpu;
+
+out:
+    free(order);
+    free(core_rank);
+    free(l3_rank);
+    return placed;
+}
+
+topo_placement_t topology_placement_from_env(topo_placement_t default_policy) {
+    const char *env = getenv("LRC_PLACEMENT");
+    if (!env) return default_policy;
+    
+    for (int p = 0; p < TOPO_PLACE_COUNT; p++) {
+        if (strcmp(env, placement_names[p]) == 0) return (topo_placement_t)p;
+    }
+    
+    fprintf(stderr, "Unknown LRC_PLACEMENT '%s', using %s\n", env, placement_names[default_policy]);
+    return default_policy;
+}
+
+const char *topology_placement_name(topo_placement_t policy) {
+    if (policy < 0 || policy >= TOPO_PLACE_COUNT) return "unknown";
+    return placement_names[policy];
+}
+
+int topology_thread_counts(int max, int *counts, int capacity) {
+    int n = 0;
+    
+    for (int c = 1; c < max && n < capacity; c *= 2) {
+        counts[n++] = c;
+    }
+    if (n < capacity && max >= 1) counts[n++] = max;
+    
+    return n;
+}
+
+int topology_pin_thread(pthread_t thread, int cpu) {
+    cpu_set_t *set = CPU_ALLOC(cpu + 1);
+    if (!set) return -1;
+    
+    size_t setsize = CPU_ALLOC_SIZE(cpu + 1);
+    CPU_ZERO_S(setsize, set);
+    CPU_SET_S(cpu, setsize, set);
+    
+    int ret = pthread_setaffinity_np(thread, setsize, set);
+    CPU_FREE(set);
+    return ret;
+}
+
+void topology_print(const topology_t *t) {
+    printf("Topology: %d CPUs, %d packages, %d NUMA nodes, %d L3 domains, %d cores\n",
+           t->num_cpus, t->num_domains[TOPO_LEVEL_PACKAGE], t->num_domains[TOPO_LEVEL_NODE],
+           t->num_domains[TOPO_LEVEL_L3], t->num_domains[TOPO_LEVEL_CORE]);
+    
+    for (int l3 = 0; l3 < t->num_domains[TOPO_LEVEL_L3]; l3++) {
+        int n = topology_domain_cpus(t, TOPO_LEVEL_L3, l3, NULL, 0);
+        int first = -1;
+        for (int i = 0; i < t->num_cpus; i++) {
+            if (t->cpus[i].domain[TOPO_LEVEL_L3] == l3) {
+                first = i;
+                break;
+            }
+        }
+        if (first < 0) continue;
+        
+        printf("  L3 %d: %d CPUs (package %d, node %d)\n", l3, n,
+               t->cpus[first].domain[TOPO_LEVEL_PACKAGE],
+               topology_node_id(t, t->cpus[first].domain[TOPO_LEVEL_NODE]));
+    }
+}
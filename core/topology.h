@@ -0,0 +1,159 @@
+/*
+ * topology.h - CPU topology and thread placement API
+ *
+ * Discovers packages, NUMA nodes, L3 (CCX) domains and SMT siblings from
+ * /sys/devices/system/{cpu,node} without a CPU-count ceiling, and places
+ * threads on them (compact / scatter / one per L3).
+ */
+
+#ifndef LRC_TOPOLOGY_H
+#define LRC_TOPOLOGY_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  /* cpu_set_t and CPU_ALLOC; must precede <sched.h> */
+#endif
+
+#include <stddef.h>
+#include <sched.h>
+#include <pthread.h>
+
+/**
+ * @brief Topology levels, innermost first
+ */
+typedef enum {
+    TOPO_LEVEL_CORE = 0,    /* SMT siblings of one physical core */
+    TOPO_LEVEL_L3,          /* CPUs sharing one L3 (CCX on AMD) */
+    TOPO_LEVEL_NODE,        /* NUMA node */
+    TOPO_LEVEL_PACKAGE,     /* Physical socket */
+    TOPO_LEVEL_COUNT
+} topo_level_t;
+
+/**
+ * @brief One online logical CPU
+ */
+typedef struct {
+    int cpu;                         /* Logical CPU id */
+    int domain[TOPO_LEVEL_COUNT];    /* Dense domain id (0..n-1) per level */
+    int smt_index;                   /* Position among its core's siblings */
+} topo_cpu_t;
+
+/**
+ * @brief Discovered topology
+ */
+typedef struct {
+    topo_cpu_t *cpus;                /* Online CPUs in ascending id order */
+    int num_cpus;
+    int cpu_limit;                   /* Highest CPU id + 1 (size for cpusets) */
+    int num_domains[TOPO_LEVEL_COUNT];
+    int *node_ids;                   /* Kernel node id per dense node domain */
+} topology_t;
+
+/**
+ * @brief Thread placement policies
+ */
+typedef enum {
+    TOPO_PLACE_COMPACT = 0,  /* Fill SMT siblings, then cores of one L3, node, package */
+    TOPO_PLACE_SCATTER,      /* Spread across packages, L3s and cores; SMT siblings last */
+    TOPO_PLACE_PER_L3,       /* One thread per L3 domain (CCX) */
+    TOPO_PLACE_COUNT
+} topo_placement_t;
+
+/**
+ * @brief Read topology of online CPUs from sysfs
+ * @param t Topology to fill
+ * @return 0 on success, -1 on error
+ * @note Missing sysfs entries degrade gracefully (e.g. no L3 info: one
+ *       L3 domain per package)
+ */
+int topology_init(topology_t *t);
+
+/**
+ * @brief Release topology memory
+ */
+void topology_destroy(topology_t *t);
+
+/**
+ * @brief Look up an online CPU by id
+ * @return CPU entry, or NULL if the CPU is offline or out of range
+ */
+const topo_cpu_t *topology_cpu(const topology_t *t, int cpu);
+
+/**
+ * @brief Kernel NUMA node id (for mbind/lrc_alloc) of a dense node domain
+ * @return Node id, or -1 if domain is out of range
+ * @note Node ids can be sparse (e.g. 0 and 2 with memory-less or CXL
+ *       nodes); domain[TOPO_LEVEL_NODE] is always 0..num_domains-1 and
+ *       covers the nodes that own allowed CPUs
+ */
+int topology_node_id(const topology_t *t, int domain);
+
+/**
+ * @brief List CPUs of one domain
+ * @param t Topology
+ * @param level Domain level
+ * @param id Dense domain id (0..num_domains[level]-1)
+ * @param cpus Output array of CPU ids (may be NULL to only count)
+ * @param max Capacity of cpus
+ * @return Number of CPUs in the domain
+ */
+int topology_domain_cpus(const topology_t *t, topo_level_t level, int id, int *cpus, int max);
+
+/**
+ * @brief CPUs of one domain as a dynamically sized cpuset
+ * @param setsize Receives the size to pass to CPU_*_S and sched_setaffinity
+ * @return CPU_ALLOC'd set (free with CPU_FREE), or NULL on error
+ */
+cpu_set_t *topology_domain_cpuset(const topology_t *t, topo_level_t level, int id, size_t *setsize);
+
+/**
+ * @brief Choose CPUs for count threads under a placement policy
+ * @param t Topology
+ * @param policy Placement policy
+ * @param count Threads to place
+ * @param cpus Output array with room for count CPU ids
+ * @return Number of threads placed: min(count, num_cpus), or for
+ *         TOPO_PLACE_PER_L3 min(count, number of L3 domains)
+ */
+int topology_place(const topology_t *t, topo_placement_t policy, int count, int *cpus);
+
+/**
+ * @brief Placement policy from $LRC_PLACEMENT (compact, scatter, per_l3)
+ * @param default_policy Used when the variable is unset or unknown
+ */
+topo_placement_t topology_placement_from_env(topo_placement_t default_policy);
+
+/**
+ * @brief Policy name for CSV output
+ */
+const char *topology_placement_name(topo_placement_t policy);
+
+/**
+ * @brief Thread-count sweep 1, 2, 4, ... up to max (max always included)
+ * @param max Largest thread count (e.g. num_cpus)
+ * @param counts Output array
+ * @param capacity Capacity of counts
+ * @return Number of entries written
+ */
+int topology_thread_counts(int max, int *counts, int capacity);
+
+/**
+ * @brief Pin a thread to one CPU (works for any CPU id)
+ * @return 0 on success, error number otherwise
+ */
+int topology_pin_thread(pthread_t thread, int cpu);
+
+/**
+ * @brief Parse a sysfs CPU list ("0-3,8-11") into a cpuset
+ * @param list CPU list string
+ * @param set Cpuset to fill (cleared first)
+ * @param setsize Size of set in bytes (CPU_ALLOC_SIZE)
+ * @return Number of CPUs in the list
+ */
+int topology_parse_cpulist(const char *list, cpu_set_t *set, size_t setsize);
+
+/**
+ * @brief Print domain counts and per-CPU mapping to stdout
+ */
+void topology_print(const topology_t *t);
+
+#endif /* LRC_TOPOLOGY_H */
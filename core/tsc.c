@@ -0,0 +1,164 @@
+/*
+ * tsc.c - Calibrated TSC timer for in-loop timing
+ *
+ * Purpose:
+ *   Each scenario kept its own get_time_ns() around clock_gettime(), so
+ *   per-operation timing of atomics, branches and fast syscalls drowned
+ *   in the 20-40 ns cost of the clock itself.
+ *
+ * Design:
+ *   - CPUID decides: invariant TSC (constant rate across P-/C-states)
+ *     and rdtscp are both required, else the clock fallback is used
+ *   - Frequency: TSC ticks over a ~10 ms spin against
+ *     CLOCK_MONOTONIC_RAW, three times, median kept. The clock read is
+ *     bracketed by two TSC reads and the midpoint used, so the clock's
+ *     own latency does not bias the ratio
+ *   - Overhead: median of TSC_OVERHEAD_SAMPLES empty begin/end pairs,
+ *     subtracted by tsc_elapsed()
+ *   - LRC_TIMER=clock forces the fallback for comparison runs
+ *
+ * Justification for syscalls:
+ *   clock_gettime() during calibration only (or every read in fallback
+ *   mode, which is what the scenarios did before).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "tsc.h"
+
+#ifdef LRC_TSC_X86
+#include <cpuid.h>
+#endif
+
+#define TSC_CALIBRATION_NS 10000000ULL    // Per calibration round
+#define TSC_CALIBRATION_ROUNDS 3
+#define TSC_OVERHEAD_SAMPLES 10001
+
+int lrc_tsc_usable = 0;
+
+static tsc_info_t info;
+static int initialized = 0;
+
+uint64_t tsc_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+#ifdef LRC_TSC_X86
+static void detect_features(void) {
+    unsigned int eax, ebx, ecx, edx;
+    
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0) return;
+    unsigned int max_ext = eax;
+    
+    if (max_ext >= 0x80000001 && __get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx)) {
+        info.rdtscp = (edx >> 27) & 1;
+    }
+    if (max_ext >= 0x80000007 && __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        info.invariant = (edx >> 8) & 1;
+    }
+}
+
+/* Clock sample paired with the TSC midpoint of its read */
+static void paired_sample(uint64_t *tsc, uint64_t *ns) {
+    uint64_t t0 = tsc_begin();
+    *ns = tsc_clock_ns();
+    uint64_t t1 = tsc_end();
+    *tsc = t0 + (t1 - t0) / 2;
+}
+
+static double calibrate_round(void) {
+    uint64_t tsc0, ns0, tsc1, ns1;
+    
+    paired_sample(&tsc0, &ns0);
+    do {
+        paired_sample(&tsc1, &ns1);
+    } while (ns1 - ns0 < TSC_CALIBRATION_NS);
+    
+    return (double)(tsc1 - tsc0) / (double)(ns1 - ns0);
+}
+#endif
+
+static void measure_overhead(void) {
+    static uint64_t samples[TSC_OVERHEAD_SAMPLES];
+    
+    for (int i = 0; i < TSC_OVERHEAD_SAMPLES; i++) {
+        uint64_t t0 = tsc_begin();
+        uint64_t t1 = tsc_end();
+        samples[i] = t1 - t0;
+    }
+    qsort(samples, TSC_OVERHEAD_SAMPLES, sizeof(uint64_t), compare_u64);
+    info.overhead_ticks = samples[TSC_OVERHEAD_SAMPLES / 2];
+}
+
+int tsc_init(void) {
+    if (initialized) return lrc_tsc_usable ? 0 : -1;
+    initialized = 1;
+    
+    memset(&info, 0, sizeof(info));
+    info.ticks_per_ns = 1.0;
+    
+    const char *env = getenv("LRC_TIMER");
+    int force_clock = env && strcmp(env, "clock") == 0;
+
+#ifdef LRC_TSC_X86
+    detect_features();
+    if (!force_clock && info.invariant && info.rdtscp) {
+        double rounds[TSC_CALIBRATION_ROUNDS];
+        
+        lrc_tsc_usable = 1;
+        for (int r = 0; r < TSC_CALIBRATION_ROUNDS; r++) {
+            rounds[r] = calibrate_round();
+        }
+        qsort(rounds, TSC_CALIBRATION_ROUNDS, sizeof(double), compare_double);
+        info.ticks_per_ns = rounds[TSC_CALIBRATION_ROUNDS / 2];
+        if (info.ticks_per_ns <= 0.0) {
+            lrc_tsc_usable = 0;
+            info.ticks_per_ns = 1.0;
+        }
+    }
+#else
+    (void)force_clock;
+    (void)compare_double;
+#endif
+    
+    info.usable = lrc_tsc_usable;
+    measure_overhead();
+    return lrc_tsc_usable ? 0 : -1;
+}
+
+const tsc_info_t *tsc_info(void) {
+    tsc_init();
+    return &info;
+}
+
+uint64_t tsc_elapsed(uint64_t begin, uint64_t end) {
+    if (!initialized) tsc_init();
+    uint64_t ticks = end - begin;
+    return ticks > info.overhead_ticks ? ticks - info.overhead_ticks : 0;
+}
+
+double tsc_to_ns(uint64_t ticks) {
+    if (!initialized) tsc_init();
+    return (double)ticks / info.ticks_per_ns;
+}
+
+const char *tsc_source_name(void) {
+    return lrc_tsc_usable ? "tsc" : "clock";
+}
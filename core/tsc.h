@@ -0,0 +1,122 @@
+/*
+ * tsc.h - Calibrated TSC timer for in-loop timing
+ *
+ * clock_gettime() costs 20-40 ns through the vDSO (more when the clock
+ * source or CLOCK_MONOTONIC_RAW falls back to a syscall), so operations
+ * below ~100 ns could only be timed in bulk. This timer reads the TSC
+ * with serializing fences, converts with a frequency calibrated against
+ * CLOCK_MONOTONIC_RAW, and reports its own fixed overhead so a single
+ * operation can be timed and corrected.
+ *
+ *     tsc_init();
+ *     uint64_t t0 = tsc_begin();
+ *     op();
+ *     uint64_t t1 = tsc_end();
+ *     double ns = tsc_to_ns(tsc_elapsed(t0, t1));
+ *
+ * Fences: lfence; rdtsc; lfence at the start keeps earlier work out and
+ * later work from starting early; rdtscp; lfence at the end waits for
+ * the timed work and keeps later work out of the interval.
+ *
+ * Without a usable invariant TSC (non-x86, no rdtscp, TSC not
+ * invariant, or LRC_TIMER=clock) ticks are CLOCK_MONOTONIC_RAW
+ * nanoseconds, so callers need no second code path.
+ */
+
+#ifndef LRC_TSC_H
+#define LRC_TSC_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LRC_TSC_X86 1
+#endif
+
+typedef struct {
+    int usable;               // Timer runs on the TSC
+    int invariant;            // CPUID.80000007H:EDX[8]
+    int rdtscp;               // CPUID.80000001H:EDX[27]
+    double ticks_per_ns;      // 1.0 in clock mode
+    uint64_t overhead_ticks;  // Median of an empty begin/end pair
+} tsc_info_t;
+
+/* Set by tsc_init(); read inline by tsc_begin()/tsc_end() */
+extern int lrc_tsc_usable;
+
+/**
+ * @brief Detect and calibrate the TSC (about 30 ms, result cached)
+ * @return 0 when the TSC is used, -1 when falling back to the clock
+ */
+int tsc_init(void);
+
+/**
+ * @brief Calibration result (tsc_init() is called if needed)
+ */
+const tsc_info_t *tsc_info(void);
+
+/**
+ * @brief CLOCK_MONOTONIC_RAW in nanoseconds (the fallback time base)
+ */
+uint64_t tsc_clock_ns(void);
+
+/**
+ * @brief Timestamp at the start of a timed region
+ */
+static inline uint64_t tsc_begin(void) {
+#ifdef LRC_TSC_X86
+    if (__builtin_expect(lrc_tsc_usable, 1)) {
+        _mm_lfence();
+        uint64_t t = __rdtsc();
+        _mm_lfence();
+        return t;
+    }
+#endif
+    return tsc_clock_ns();
+}
+
+/**
+ * @brief Timestamp at the end of a timed region
+ */
+static inline uint64_t tsc_end(void) {
+#ifdef LRC_TSC_X86
+    if (__builtin_expect(lrc_tsc_usable, 1)) {
+        unsigned int aux;
+        uint64_t t = __rdtscp(&aux);
+        _mm_lfence();
+        return t;
+    }
+#endif
+    return tsc_clock_ns();
+}
+
+/**
+ * @brief Unfenced timestamp for stamps handed between threads
+ * @note Cheaper than tsc_begin() but may move against nearby loads. An
+ *       invariant TSC is synchronized across cores, so stamps taken on
+ *       different CPUs compare (raw difference, no overhead subtracted)
+ */
+static inline uint64_t tsc_now(void) {
+#ifdef LRC_TSC_X86
+    if (__builtin_expect(lrc_tsc_usable, 1)) return __rdtsc();
+#endif
+    return tsc_clock_ns();
+}
+
+/**
+ * @brief Ticks between begin and end minus the timer's fixed overhead
+ * @return 0 when the interval is shorter than the overhead
+ */
+uint64_t tsc_elapsed(uint64_t begin, uint64_t end);
+
+/**
+ * @brief Convert ticks to nanoseconds
+ */
+double tsc_to_ns(uint64_t ticks);
+
+/**
+ * @brief Timer source for CSV output ("tsc" or "clock")
+ */
+const char *tsc_source_name(void);
+
+#endif /* LRC_TSC_H */
@@ -10,6 +10,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "thread_pool.h"
+#include "histogram.h"
+
 /**
  * @brief Execute CPU-intensive spin workload
  * @param iterations Number of iterations to perform
@@ -17,6 +20,17 @@
  */
 uint64_t cpu_spin(uint64_t iterations);
 
+/**
+ * @brief Calibrate cpu_spin() speed (cached after first call)
+ * @return cpu_spin() iterations per nanosecond at the current frequency
+ */
+double cpu_spin_calibrate(void);
+
+/**
+ * @brief cpu_spin() iterations that take about ns nanoseconds
+ */
+uint64_t cpu_spin_iterations_for_ns(uint64_t ns);
+
 /**
  * @brief Sequential memory streaming (measures bandwidth)
  * @param buffer Memory buffer to access
@@ -26,8 +40,126 @@ uint64_t cpu_spin(uint64_t iterations);
  */
 uint64_t memory_stream(uint64_t *buffer, size_t size, uint64_t iterations);
 
+/**
+ * @brief Sequential read/write/copy as compiled from plain C loops
+ * @note Whatever the compiler emits at the build's -O level; use the
+ *       *_kernel variants to pin down the instruction sequence
+ */
+uint64_t memory_stream_read(const uint64_t *buffer, size_t size);
+void memory_stream_write(uint64_t *buffer, size_t size);
+void memory_stream_copy(uint64_t *dst, const uint64_t *src, size_t size);
+
+/**
+ * @brief Explicit streaming kernels (see memory_stream_*_kernel)
+ *
+ * *_NT kernels write with non-temporal stores (movnt*), which bypass the
+ * cache and skip the read-for-ownership of the destination line.
+ * REP_MOVSB copies with rep movsb and writes with rep stosb.
+ * Read kernels ignore the store strategy: *_NT reads like its base ISA,
+ * REP_MOVSB reads like SCALAR.
+ */
+typedef enum {
+    STREAM_KERNEL_SCALAR = 0,   /* 64-bit scalar loop, auto-vectorization disabled */
+    STREAM_KERNEL_SSE2,
+    STREAM_KERNEL_AVX2,
+    STREAM_KERNEL_AVX512,
+    STREAM_KERNEL_SSE2_NT,
+    STREAM_KERNEL_AVX2_NT,
+    STREAM_KERNEL_AVX512_NT,
+    STREAM_KERNEL_REP_MOVSB,
+    STREAM_KERNEL_COUNT
+} stream_kernel_t;
+
+/**
+ * @brief Check (via CPUID) whether a kernel can run on this CPU
+ * @return 1 if supported, 0 otherwise
+ */
+int stream_kernel_supported(stream_kernel_t kernel);
+
+/**
+ * @brief Short kernel name for CSV output (e.g. "avx2_nt")
+ */
+const char *stream_kernel_name(stream_kernel_t kernel);
+
+/**
+ * @brief Widest supported kernel with regular (cached) stores
+ */
+stream_kernel_t stream_kernel_best(void);
+
+/**
+ * @brief Sequential read with an explicit kernel
+ * @param kernel Kernel to use (falls back to SCALAR if unsupported)
+ * @param buffer Buffer to read
+ * @param size Buffer size in bytes (multiple of 8)
+ * @return Sum of all words (prevents optimization)
+ */
+uint64_t memory_stream_read_kernel(stream_kernel_t kernel, const uint64_t *buffer, size_t size);
+
+/**
+ * @brief Sequential write with an explicit kernel
+ * @param kernel Kernel to use (falls back to SCALAR if unsupported)
+ * @param buffer Buffer to fill with a constant pattern
+ * @param size Buffer size in bytes (multiple of 8)
+ */
+void memory_stream_write_kernel(stream_kernel_t kernel, uint64_t *buffer, size_t size);
+
+/**
+ * @brief Sequential copy with an explicit kernel
+ * @param kernel Kernel to use (falls back to SCALAR if unsupported)
+ * @param dst Destination buffer
+ * @param src Source buffer (must not overlap dst)
+ * @param size Bytes to copy (multiple of 8)
+ */
+void memory_stream_copy_kernel(stream_kernel_t kernel, uint64_t *dst, const uint64_t *src, size_t size);
+
+/**
+ * @brief Read one word per stride cache lines (hardware prefetch only)
+ * @param stride Cache lines between accesses (1 = every line)
+ * @return Sum of the words read
+ */
+uint64_t memory_stream_strided(const uint64_t *buffer, size_t size, size_t stride);
+
+/*
+ * Software-prefetch locality hints, in __builtin_prefetch's numbering.
+ * On x86: NTA = prefetchnta (fill L1 only, minimal LLC pollution),
+ * T2/T1 = prefetcht2/t1 (L2 and outer levels), T0 = prefetcht0 (all levels).
+ */
+typedef enum {
+    PREFETCH_NTA = 0,
+    PREFETCH_T2,
+    PREFETCH_T1,
+    PREFETCH_T0,
+    PREFETCH_HINT_COUNT
+} prefetch_hint_t;
+
+/**
+ * @brief Short hint name for CSV output ("nta", "t2", "t1", "t0")
+ */
+const char *prefetch_hint_name(prefetch_hint_t hint);
+
+/**
+ * @brief memory_stream_strided() with software prefetch
+ * @param distance Accesses ahead to prefetch (0 = no software prefetch)
+ * @param hint Locality hint for the prefetches
+ */
+uint64_t memory_stream_strided_prefetch(const uint64_t *buffer, size_t size, size_t stride,
+                                        size_t distance, prefetch_hint_t hint);
+
+/**
+ * @brief Indirect scan: sum of buffer[index[i]] for i < count
+ *
+ * The gather of a columnar scan through a selection vector. The index
+ * array streams sequentially; the words it points to are only
+ * prefetched if distance > 0 (index[i + distance] is read early).
+ * @param index Word offsets into buffer
+ */
+uint64_t memory_stream_indirect(const uint64_t *buffer, const uint32_t *index, size_t count,
+                                size_t distance, prefetch_hint_t hint);
+
 /**
  * @brief Random memory access via pointer chasing (measures latency)
+ * @note Builds the chain on every call; use chase_build/chase_run to
+ *       time only the hops
  * @param buffer Memory buffer with pointer chain
  * @param size Buffer size in bytes
  * @param iterations Number of pointer hops
@@ -35,12 +167,163 @@ uint64_t memory_stream(uint64_t *buffer, size_t size, uint64_t iterations);
  */
 uint64_t memory_random_chase(uint64_t *buffer, size_t size, uint64_t iterations);
 
+/* chase_build() layout flags */
+#define CHASE_SATTOLO (1 << 0)  /* Build cycle in place (Sattolo), no scratch allocation */
+#define CHASE_LINE    (1 << 1)  /* One node per 64-byte cache line instead of per word */
+#define CHASE_PAGE    (1 << 2)  /* Visit every node of a page before moving to the next page */
+
+/**
+ * @brief Prepared pointer chain (see chase_build)
+ */
+typedef struct {
+    uint64_t *buffer;
+    size_t size;
+    size_t nodes;       /* Nodes in the single cycle */
+    void *start;        /* First node of the chain */
+    int flags;
+} chase_t;
+
+/**
+ * @brief Build a random single-cycle pointer chain in buffer
+ * @param c Chain descriptor to fill
+ * @param buffer Memory to link (contents are overwritten)
+ * @param size Buffer size in bytes
+ * @param flags CHASE_* layout flags
+ * @param seed RNG seed (same seed gives the same chain)
+ * @return 0 on success, -1 on error
+ * @note Call once per buffer, outside the timed region
+ */
+int chase_build(chase_t *c, uint64_t *buffer, size_t size, int flags, uint64_t seed);
+
+/**
+ * @brief Build a chain with exactly one node per page (TLB reach probes)
+ * @param c Chain descriptor to fill
+ * @param buffer Memory of at least pages * page_size bytes
+ * @param pages Number of pages (nodes) in the cycle, at least 2
+ * @param page_size Stride between nodes: the page size backing buffer
+ * @param seed RNG seed (page order and line offsets)
+ * @return 0 on success, -1 on error
+ * @note Each node sits at a random cache line of its page, so the nodes
+ *       spread over all cache sets and every hop needs a new translation
+ */
+int chase_build_pages(chase_t *c, uint64_t *buffer, size_t pages, size_t page_size,
+                      uint64_t seed);
+
+/**
+ * @brief Follow the chain for a number of dependent loads
+ * @param c Chain built by chase_build
+ * @param iterations Number of pointer hops
+ * @return Final node address (prevents optimization)
+ * @note Only the hops are executed: no allocation, no RNG
+ */
+uint64_t chase_run(const chase_t *c, uint64_t iterations);
+
+/* Maximum independent chains for chase_run_multi() */
+#define CHASE_MAX_CHAINS 32
+
+/**
+ * @brief Follow several independent chains interleaved in one loop
+ * @param chains Array of chains built by chase_build (disjoint memory)
+ * @param count Number of chains (1..CHASE_MAX_CHAINS)
+ * @param iterations Hops per chain (total loads = count * iterations)
+ * @return Sum of final node addresses (prevents optimization), 0 if count
+ *         is out of range
+ * @note Loads of different chains are independent, so up to count misses
+ *       can be outstanding at once (memory-level parallelism)
+ */
+uint64_t chase_run_multi(const chase_t *chains, int count, uint64_t iterations);
+
+/**
+ * @brief Lock implementations for lock_contention (values 0-2 unchanged)
+ */
+typedef enum {
+    LOCK_SPINLOCK = 0,      /* pthread_spinlock_t (test-and-set) */
+    LOCK_MUTEX = 1,         /* pthread_mutex_t */
+    LOCK_ATOMIC = 2,        /* __atomic_add_fetch, no lock */
+    LOCK_TICKET,            /* FIFO ticket lock, all waiters spin on one line */
+    LOCK_MCS,               /* MCS queue lock, each waiter spins on its own node */
+    LOCK_CLH,               /* CLH queue lock, each waiter spins on its predecessor */
+    LOCK_QSPINLOCK,         /* Linux-style qspinlock: locked/pending/MCS tail in 32 bits */
+    LOCK_FUTEX,             /* Adaptive mutex: bounded spin, then futex wait */
+    LOCK_FLAT_COMBINING,    /* Flat-combining counter: one combiner applies all requests */
+    LOCK_TYPE_COUNT
+} lock_type_t;
+
+/* One acquire in LOCK_SAMPLE_INTERVAL is timed for the latency percentiles */
+#define LOCK_SAMPLE_INTERVAL 16
+
+/**
+ * @brief Result of one lock contention run
+ */
+typedef struct {
+    uint64_t operations;    /* Critical sections completed (final counter value) */
+    uint64_t runtime_ns;    /* First barrier release to last finish */
+    uint64_t samples;       /* Acquires timed for the percentiles */
+    uint64_t p50_ns;        /* Acquire latency: request to lock held */
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+    histogram_t latency;    /* All sampled acquires, merged across threads */
+} lock_result_t;
+
+/**
+ * @brief Work done per acquisition (Amdahl profile of the lock user)
+ * @note Ideal speedup is bounded by (cs_ns + think_ns) / cs_ns. LOCK_ATOMIC
+ *       has no critical section and only honours think_ns; with
+ *       LOCK_FLAT_COMBINING the combiner runs each critical section.
+ */
+typedef struct {
+    uint64_t cs_ns;         /* cpu_spin() time inside the critical section */
+    uint64_t think_ns;      /* cpu_spin() time between acquisitions */
+    int cs_lines;           /* Shared cache lines written inside the lock (>= 0) */
+} lock_params_t;
+
+/* Original profile: one counter increment, no think time */
+#define LOCK_PARAMS_DEFAULT ((lock_params_t){ 0, 0, 0 })
+
+/* Maximum profiles parsed by lock_params_from_env() */
+#define LOCK_MAX_PROFILES 16
+
+/**
+ * @brief Parse profiles "cs_ns:think_ns:cs_lines,..." from an environment variable
+ * @param name Variable name (e.g. "LRC_LOCK_PROFILES")
+ * @param defaults Used when the variable is unset or empty
+ * @param num_defaults Number of default profiles
+ * @param profiles Output array with room for LOCK_MAX_PROFILES entries
+ * @return Number of profiles written
+ */
+int lock_params_from_env(const char *name, const lock_params_t *defaults, int num_defaults,
+                         lock_params_t *profiles);
+
+/**
+ * @brief Lock type name for CSV output ("spinlock", "mcs", ...)
+ * @return Name, or "unknown" if lock_type is out of range
+ */
+const char *lock_type_name(int lock_type);
+
+/**
+ * @brief Run one lock contention measurement on an existing pool
+ * @param pool Worker pool with at least num_threads workers
+ * @param lock_type Lock implementation (lock_type_t)
+ * @param num_threads Threads incrementing the shared counter
+ * @param iterations Critical sections per thread
+ * @param params Critical-section and think-time profile (NULL: LOCK_PARAMS_DEFAULT)
+ * @param result Filled with throughput and acquire latency percentiles
+ * @return 0 on success, -1 on invalid arguments, allocation failure or a
+ *         failed thread_pool_run()
+ */
+int lock_contention_run(thread_pool_t *pool, int lock_type, int num_threads,
+                        uint64_t iterations, const lock_params_t *params,
+                        lock_result_t *result);
+
 /**
  * @brief Multi-threaded lock contention workload
- * @param lock_type Type of lock (0=spinlock, 1=mutex, 2=atomic)
+ * @param lock_type Type of lock (lock_type_t: 0=spinlock, 1=mutex, 2=atomic, ...)
  * @param num_threads Number of threads
  * @param iterations Iterations per thread
  * @return Total operations completed
+ * @note Creates a compact-placed pool for this call only
  */
 uint64_t lock_contention(int lock_type, int num_threads, uint64_t iterations);
 
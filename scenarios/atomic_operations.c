@@ -21,70 +21,76 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <math.h>
+#include <string.h>
 #include <stdatomic.h>
 #include <pthread.h>
-#include <time.h>
 #include <sched.h>
 #include <unistd.h>
+#include "../core/topology.h"
+#include "../core/thread_pool.h"
+#include "../core/results.h"
+#include "../core/tsc.h"
 
 #define ITERATIONS 10000000
-#define MAX_THREADS 8
-
-static inline uint64_t get_time_ns(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
-}
+#define TIMED_OPS 100001            // Individually timed operations per run
 
 typedef struct {
     int thread_id;
+    int cpu;
     uint64_t iterations;
     _Atomic uint64_t *shared_counter;
     uint64_t *local_counter;
-    uint64_t runtime_ns;
 } thread_arg_t;
 
+// Thread placement (LRC_PLACEMENT=compact|scatter|per_l3)
+static topology_t topo;
+static topo_placement_t placement;
+static int *thread_cpus;     // CPU for thread i, in placement order
+static int max_threads;      // Threads the placement can host
+static thread_pool_t pool;   // Pinned workers, reused by every test
+
 // Test 1: Regular (non-atomic) increment
 uint64_t test_regular_increment(void) {
     uint64_t counter = 0;
-    uint64_t start = get_time_ns();
+    uint64_t start = tsc_begin();
     
     for (uint64_t i = 0; i < ITERATIONS; i++) {
         counter++;
     }
     
-    uint64_t end = get_time_ns();
+    uint64_t end = tsc_end();
     
     // Prevent optimization
     if (counter != ITERATIONS) {
         printf("Error: counter = %lu\n", counter);
     }
     
-    return end - start;
+    return (uint64_t)tsc_to_ns(tsc_elapsed(start, end));
 }
 
 // Test 2: Atomic increment (single thread)
 uint64_t test_atomic_increment(void) {
     _Atomic uint64_t counter = 0;
-    uint64_t start = get_time_ns();
+    uint64_t start = tsc_begin();
     
     for (uint64_t i = 0; i < ITERATIONS; i++) {
         atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed);
     }
     
-    uint64_t end = get_time_ns();
+    uint64_t end = tsc_end();
     
     if (counter != ITERATIONS) {
         printf("Error: counter = %lu\n", counter);
     }
     
-    return end - start;
+    return (uint64_t)tsc_to_ns(tsc_elapsed(start, end));
 }
 
 // Test 3: Compare-and-swap
 uint64_t test_compare_and_swap(void) {
     _Atomic uint64_t counter = 0;
-    uint64_t start = get_time_ns();
+    uint64_t start = tsc_begin();
     
     for (uint64_t i = 0; i < ITERATIONS; i++) {
         uint64_t expected = i;
@@ -94,154 +100,194 @@ uint64_t test_compare_and_swap(void) {
                                                memory_order_relaxed);
     }
     
-    uint64_t end = get_time_ns();
+    uint64_t end = tsc_end();
     
     if (counter != ITERATIONS) {
         printf("Error: counter = %lu\n", counter);
     }
     
-    return end - start;
+    return (uint64_t)tsc_to_ns(tsc_elapsed(start, end));
+}
+
+/*
+ * Per-operation latency: each operation bracketed by its own fenced TSC
+ * pair, timer overhead removed, median kept. The fences stop the
+ * out-of-order overlap the bulk loops benefit from, so this is latency,
+ * where ns_per_operation is throughput.
+ */
+static uint64_t op_samples[TIMED_OPS];
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double op_samples_p50_ns(void) {
+    qsort(op_samples, TIMED_OPS, sizeof(uint64_t), compare_u64);
+    return tsc_to_ns(op_samples[TIMED_OPS / 2]);
+}
+
+static double timed_regular_increment(void) {
+    volatile uint64_t counter = 0;
+    
+    for (int i = 0; i < TIMED_OPS; i++) {
+        uint64_t start = tsc_begin();
+        counter++;
+        uint64_t end = tsc_end();
+        op_samples[i] = tsc_elapsed(start, end);
+    }
+    return op_samples_p50_ns();
 }
 
-// Worker thread for contention test
-void* worker_atomic_contention(void *arg) {
-    thread_arg_t *params = (thread_arg_t*)arg;
+static double timed_atomic_increment(void) {
+    _Atomic uint64_t counter = 0;
     
-    // Pin to specific CPU
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    for (int i = 0; i < TIMED_OPS; i++) {
+        uint64_t start = tsc_begin();
+        atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed);
+        uint64_t end = tsc_end();
+        op_samples[i] = tsc_elapsed(start, end);
+    }
+    return op_samples_p50_ns();
+}
+
+static double timed_compare_and_swap(void) {
+    _Atomic uint64_t counter = 0;
     
-    uint64_t start = get_time_ns();
+    for (int i = 0; i < TIMED_OPS; i++) {
+        uint64_t expected = i;
+        uint64_t start = tsc_begin();
+        atomic_compare_exchange_strong_explicit(&counter, &expected, (uint64_t)i + 1,
+                                               memory_order_relaxed,
+                                               memory_order_relaxed);
+        uint64_t end = tsc_end();
+        op_samples[i] = tsc_elapsed(start, end);
+    }
+    return op_samples_p50_ns();
+}
+
+// Pool task for contention test (threads pinned by the pool)
+static void worker_atomic_contention(int id, void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg + id;
     
     for (uint64_t i = 0; i < params->iterations; i++) {
         atomic_fetch_add_explicit(params->shared_counter, 1, memory_order_relaxed);
     }
-    
-    params->runtime_ns = get_time_ns() - start;
-    
-    return NULL;
 }
 
-// Worker thread for local (no contention) test
-void* worker_local_increment(void *arg) {
-    thread_arg_t *params = (thread_arg_t*)arg;
-    
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    
-    uint64_t start = get_time_ns();
+// Pool task for local (no contention) test (threads pinned by the pool)
+static void worker_local_increment(int id, void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg + id;
     
     for (uint64_t i = 0; i < params->iterations; i++) {
         (*params->local_counter)++;
     }
-    
-    params->runtime_ns = get_time_ns() - start;
-    
-    return NULL;
 }
 
-void run_contention_test(FILE *csv, int num_threads, int *run_number) {
-    pthread_t threads[MAX_THREADS];
-    thread_arg_t args[MAX_THREADS];
+void run_contention_test(results_t *csv, int num_threads, int *run_number) {
+    thread_arg_t args[num_threads];
     _Atomic uint64_t shared_counter = 0;
-    uint64_t local_counters[MAX_THREADS] = {0};
+    uint64_t local_counters[num_threads];
+    
+    memset(local_counters, 0, sizeof(local_counters));
     
     // Test with contention (shared atomic)
-    uint64_t start_ts = get_time_ns();
+    uint64_t start_ts = tsc_clock_ns();
     
     for (int i = 0; i < num_threads; i++) {
         args[i].thread_id = i;
+        args[i].cpu = thread_cpus[i];
         args[i].iterations = ITERATIONS / num_threads;
         args[i].shared_counter = &shared_counter;
-        pthread_create(&threads[i], NULL, worker_atomic_contention, &args[i]);
-    }
-    
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
     }
     
-    uint64_t max_runtime = 0;
-    for (int i = 0; i < num_threads; i++) {
-        if (args[i].runtime_ns > max_runtime) {
-            max_runtime = args[i].runtime_ns;
-        }
-    }
+    thread_pool_run(&pool, num_threads, NULL, worker_atomic_contention, args);
+    uint64_t max_runtime = thread_pool_elapsed_ns(&pool);
     
     double ns_per_op = (double)max_runtime / (ITERATIONS / num_threads);
     
-    fprintf(csv, "%d,atomic_contended_%dthreads,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-           (*run_number)++, num_threads, start_ts, max_runtime, ns_per_op);
+    results_u64(csv, (*run_number)++);
+    results_strf(csv, "atomic_contended_%dthreads", num_threads);
+    results_str(csv, topology_placement_name(placement));
+    results_runtime(csv, start_ts, max_runtime);
+    results_f64(csv, ns_per_op);
+    results_f64(csv, NAN);   // op_p50_ns: not timed per operation, empty cell
     
     // Test without contention (local counters)
-    start_ts = get_time_ns();
+    start_ts = tsc_clock_ns();
     
     for (int i = 0; i < num_threads; i++) {
         args[i].thread_id = i;
+        args[i].cpu = thread_cpus[i];
         args[i].iterations = ITERATIONS / num_threads;
         args[i].local_counter = &local_counters[i];
-        pthread_create(&threads[i], NULL, worker_local_increment, &args[i]);
-    }
-    
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
     }
     
-    max_runtime = 0;
-    for (int i = 0; i < num_threads; i++) {
-        if (args[i].runtime_ns > max_runtime) {
-            max_runtime = args[i].runtime_ns;
-        }
-    }
+    thread_pool_run(&pool, num_threads, NULL, worker_local_increment, args);
+    max_runtime = thread_pool_elapsed_ns(&pool);
     
     ns_per_op = (double)max_runtime / (ITERATIONS / num_threads);
     
-    fprintf(csv, "%d,local_no_contention_%dthreads,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-           (*run_number)++, num_threads, start_ts, max_runtime, ns_per_op);
+    results_u64(csv, (*run_number)++);
+    results_strf(csv, "local_no_contention_%dthreads", num_threads);
+    results_str(csv, topology_placement_name(placement));
+    results_runtime(csv, start_ts, max_runtime);
+    results_f64(csv, ns_per_op);
+    results_f64(csv, NAN);   // op_p50_ns: not timed per operation, empty cell
 }
 
-void run_experiment(FILE *csv) {
+void run_experiment(results_t *csv) {
     int run = 0;
     
     // Single-threaded tests
     printf("Single-threaded tests...\n");
     
     for (int i = 0; i < 5; i++) {
-        uint64_t start_ts = get_time_ns();
+        uint64_t start_ts = tsc_clock_ns();
         uint64_t runtime = test_regular_increment();
         double ns_per_op = (double)runtime / ITERATIONS;
         
-        fprintf(csv, "%d,regular_increment,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-               run++, start_ts, runtime, ns_per_op);
+        results_u64(csv, run++);
+        results_str(csv, "regular_increment");
+        results_str(csv, "single");
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ns_per_op);
+        results_f64(csv, timed_regular_increment());
     }
     
     for (int i = 0; i < 5; i++) {
-        uint64_t start_ts = get_time_ns();
+        uint64_t start_ts = tsc_clock_ns();
         uint64_t runtime = test_atomic_increment();
         double ns_per_op = (double)runtime / ITERATIONS;
         
-        fprintf(csv, "%d,atomic_relaxed,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-               run++, start_ts, runtime, ns_per_op);
+        results_u64(csv, run++);
+        results_str(csv, "atomic_relaxed");
+        results_str(csv, "single");
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ns_per_op);
+        results_f64(csv, timed_atomic_increment());
     }
     
     for (int i = 0; i < 5; i++) {
-        uint64_t start_ts = get_time_ns();
+        uint64_t start_ts = tsc_clock_ns();
         uint64_t runtime = test_compare_and_swap();
         double ns_per_op = (double)runtime / ITERATIONS;
         
-        fprintf(csv, "%d,compare_and_swap,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-               run++, start_ts, runtime, ns_per_op);
+        results_u64(csv, run++);
+        results_str(csv, "compare_and_swap");
+        results_str(csv, "single");
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ns_per_op);
+        results_f64(csv, timed_compare_and_swap());
     }
     
     // Multi-threaded contention tests
-    int thread_counts[] = {2, 4, 8};
-    for (int i = 0; i < 3; i++) {
+    int thread_counts[32];
+    int num_counts = topology_thread_counts(max_threads, thread_counts, 32);
+    for (int i = 0; i < num_counts; i++) {
         int num_threads = thread_counts[i];
         
-        if (num_threads > sysconf(_SC_NPROCESSORS_ONLN)) {
+        if (num_threads < 2) {
             continue;
         }
         
@@ -251,25 +297,47 @@ void run_experiment(FILE *csv) {
 }
 
 int main(void) {
-    FILE *csv = fopen("data/atomic_operations.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    placement = topology_placement_from_env(TOPO_PLACE_SCATTER);
+    thread_cpus = malloc(topo.num_cpus * sizeof(int));
+    max_threads = topology_place(&topo, placement, topo.num_cpus, thread_cpus);
+    if (thread_pool_create(&pool, max_threads, thread_cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
+        return 1;
+    }
+    
+    results_t csv;
+    if (results_open(&csv, "data/atomic_operations.csv", 15 + 2 * max_threads) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "ns_per_operation\n");
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_column(&csv, "thread_placement", RESULT_STR, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "ns_per_operation", RESULT_F64, 2);
+    results_add_column(&csv, "op_p50_ns", RESULT_F64, 2);
     
     printf("Atomic Operations Cost Benchmark\n");
     printf("=================================\n\n");
     printf("Iterations: %d\n", ITERATIONS);
-    printf("Available CPUs: %ld\n\n", sysconf(_SC_NPROCESSORS_ONLN));
+    tsc_init();
+    printf("Timer: %s (%.3f ticks/ns, %.1f ns overhead subtracted)\n", tsc_source_name(),
+           tsc_info()->ticks_per_ns, tsc_to_ns(tsc_info()->overhead_ticks));
+    printf("Available CPUs: %d (placement: %s, up to %d threads)\n\n",
+           topo.num_cpus, topology_placement_name(placement), max_threads);
+    
+    run_experiment(&csv);
     
-    run_experiment(csv);
+    thread_pool_destroy(&pool);
+    free(thread_cpus);
+    topology_destroy(&topo);
     
-    fclose(csv);
+    if (results_close(&csv) != 0) return 1;
     
     printf("\nResults saved to data/atomic_operations.csv\n");
     printf("\nExpected patterns:\n");
@@ -15,6 +15,31 @@
  * - Branch predictor effectiveness
  * - Cost of pipeline flushes
  * - Data-dependent control flow overhead
+ *
+ * Predictor capacity (data/branch_capacity.csv):
+ *   The sorted/random array above has one hot branch. Generated kernels
+ *   repeat a conditional branch site 8..4096 times as straight-line code
+ *   (BR_SITE), each site taking a splitmix64 bit as its direction. The
+ *   direction vector repeats every LRC_BRANCH_PERIODS passes (0 = never),
+ *   so a row shows whether the predictor can hold <sites> branches with a
+ *   <period>-long history each. The 4096-site kernel is ~50KB of code and
+ *   also misses L1i; compare MPKI, not only ns_per_branch.
+ *
+ * Indirect branches (data/branch_indirect.csv):
+ *   One dispatch site with 1..256 targets (LRC_BRANCH_TARGETS) in three
+ *   styles: a dense switch (jump table, interpreter loop), a
+ *   function-pointer array, and C "virtual" calls through a per-object
+ *   class pointer. Targets come from a 16K-entry stream that is cyclic
+ *   (0,1,..,T-1: learnable from history) or random (not learnable).
+ *
+ * Both sweeps repeat each configuration under run control (warmup run
+ * discarded, run column per repetition; LRC_RUNS etc. apply).
+ *
+ * Hardware counters:
+ *   instructions, cycles, branches and branch-misses per row (override
+ *   with LRC_PERF_EVENTS; keep instructions and branch_misses for the
+ *   MPKI column, a warning is printed otherwise). Without counters the
+ *   columns are 0.
  */
 
 #define _GNU_SOURCE
@@ -22,21 +47,28 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <time.h>
+#include "../core/perf_counters.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/rng.h"
+#include "../core/tsc.h"
 
 #define ARRAY_SIZE 1000000
 #define ITERATIONS 10
 
-static inline uint64_t get_time_ns(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
-}
+#define BRANCH_PERF_EVENTS "instructions,cycles,branches,branch_misses=branch-misses"
+#define CAPACITY_BRANCHES (1ULL << 24)     // Site executions per capacity row
+#define INDIRECT_DISPATCHES (1ULL << 22)   // Dispatches per indirect row
+#define INDIRECT_OPS 16384                 // Target stream length (power of 2)
+#define OP_COUNT 256                       // Generated targets per dispatch style
+#define MAX_LIST 32
+#define SWEEP_MIN_RUNS 8                   // Per capacity / indirect configuration
+#define SWEEP_MAX_RUNS 30
 
 // Test with predictable branches
 uint64_t test_predictable(int *array, size_t size) {
     uint64_t sum = 0;
-    uint64_t start = get_time_ns();
+    uint64_t start = tsc_begin();
     
     for (size_t i = 0; i < size; i++) {
         if (array[i] < 128) {  // Predictable (all sorted)
@@ -46,18 +78,18 @@ uint64_t test_predictable(int *array, size_t size) {
         }
     }
     
-    uint64_t end = get_time_ns();
+    uint64_t end = tsc_end();
     
     // Prevent optimization
     if (sum == 0xDEADBEEF) printf("!");
     
-    return end - start;
+    return (uint64_t)tsc_to_ns(tsc_elapsed(start, end));
 }
 
 // Test with unpredictable branches
 uint64_t test_unpredictable(int *array, size_t size) {
     uint64_t sum = 0;
-    uint64_t start = get_time_ns();
+    uint64_t start = tsc_begin();
     
     for (size_t i = 0; i < size; i++) {
         if (array[i] < 128) {  // Unpredictable (random)
@@ -67,17 +99,17 @@ uint64_t test_unpredictable(int *array, size_t size) {
         }
     }
     
-    uint64_t end = get_time_ns();
+    uint64_t end = tsc_end();
     
     if (sum == 0xDEADBEEF) printf("!");
     
-    return end - start;
+    return (uint64_t)tsc_to_ns(tsc_elapsed(start, end));
 }
 
 // Test without branches (branchless)
 uint64_t test_branchless(int *array, size_t size) {
     uint64_t sum = 0;
-    uint64_t start = get_time_ns();
+    uint64_t start = tsc_begin();
     
     for (size_t i = 0; i < size; i++) {
         // Branchless: (array[i] < 128) ? add : subtract
@@ -86,18 +118,161 @@ uint64_t test_branchless(int *array, size_t size) {
         sum -= (array[i] & ~mask);
     }
     
-    uint64_t end = get_time_ns();
+    uint64_t end = tsc_end();
     
     if (sum == 0xDEADBEEF) printf("!");
     
-    return end - start;
+    return (uint64_t)tsc_to_ns(tsc_elapsed(start, end));
+}
+
+/*
+ * Code generation: M(0x00) .. M(0xff) as literal tokens, so the argument
+ * can be pasted into names and stringified into distinct asm comments.
+ */
+#define HEX16(M, h) M(h##0) M(h##1) M(h##2) M(h##3) M(h##4) M(h##5) M(h##6) M(h##7) \
+                    M(h##8) M(h##9) M(h##a) M(h##b) M(h##c) M(h##d) M(h##e) M(h##f)
+#define HEX64(M) HEX16(M, 0x0) HEX16(M, 0x1) HEX16(M, 0x2) HEX16(M, 0x3)
+#define HEX256(M) HEX64(M) HEX16(M, 0x4) HEX16(M, 0x5) HEX16(M, 0x6) HEX16(M, 0x7) \
+                  HEX16(M, 0x8) HEX16(M, 0x9) HEX16(M, 0xa) HEX16(M, 0xb) \
+                  HEX16(M, 0xc) HEX16(M, 0xd) HEX16(M, 0xe) HEX16(M, 0xf)
+
+/*
+ * One conditional branch site. The asm in the taken arm stops if-conversion
+ * to cmov and, being distinct per bit, stops sites from being merged.
+ */
+#define BR_SITE(bit) \
+    if (w & (1ULL << (bit))) { __asm__ volatile("# site " #bit : "+r"(acc)); acc += (bit); }
+
+#define BR_SITES8 w = lrc_rng_splitmix64(&x); \
+    BR_SITE(0x0) BR_SITE(0x1) BR_SITE(0x2) BR_SITE(0x3) \
+    BR_SITE(0x4) BR_SITE(0x5) BR_SITE(0x6) BR_SITE(0x7)
+#define BR_WORD w = lrc_rng_splitmix64(&x); HEX64(BR_SITE)
+#define BR_WORD4 BR_WORD BR_WORD BR_WORD BR_WORD
+#define BR_WORD16 BR_WORD4 BR_WORD4 BR_WORD4 BR_WORD4
+#define BR_WORD64 BR_WORD16 BR_WORD16 BR_WORD16 BR_WORD16
+
+/*
+ * A pass executes every site once; the generator restarts from seed every
+ * period passes, so each site sees the same period-long direction history.
+ */
+#define BRANCH_KERNEL(name, sites) \
+    static __attribute__((noinline)) uint64_t name(uint64_t passes, uint64_t period, uint64_t seed) { \
+        uint64_t acc = 0, x = seed, phase = 0, w; \
+        for (uint64_t p = 0; p < passes; p++) { \
+            if (++phase == period) { \
+                phase = 0; \
+                x = seed; \
+            } \
+            sites \
+        } \
+        return acc; \
+    }
+
+BRANCH_KERNEL(branch_sites_8, BR_SITES8)
+BRANCH_KERNEL(branch_sites_64, BR_WORD)
+BRANCH_KERNEL(branch_sites_256, BR_WORD4)
+BRANCH_KERNEL(branch_sites_1024, BR_WORD16)
+BRANCH_KERNEL(branch_sites_4096, BR_WORD64)
+
+typedef uint64_t (*branch_kernel_fn)(uint64_t passes, uint64_t period, uint64_t seed);
+
+static const struct {
+    long sites;
+    branch_kernel_fn fn;
+} branch_kernels[] = {
+    {8, branch_sites_8},
+    {64, branch_sites_64},
+    {256, branch_sites_256},
+    {1024, branch_sites_1024},
+    {4096, branch_sites_4096},
+};
+
+/* Indirect targets: distinct bodies so none fold into one another */
+typedef struct object object_t;
+
+typedef struct {
+    uint64_t (*apply)(const object_t *self, uint64_t acc);
+} object_class_t;
+
+struct object {
+    const object_class_t *cls;
+    uint64_t value;
+};
+
+#define OP_FN(k) \
+    static __attribute__((noinline)) uint64_t op_##k(uint64_t acc) { \
+        __asm__ volatile("# op " #k : "+r"(acc)); \
+        return acc * 31 + k; \
+    }
+#define OP_PTR(k) op_##k,
+#define OP_CASE(k) \
+    case k: \
+        __asm__ volatile("# case " #k : "+r"(acc)); \
+        acc = acc * 31 + k; \
+        break;
+#define CLASS_FN(k) \
+    static __attribute__((noinline)) uint64_t class_apply_##k(const object_t *self, uint64_t acc) { \
+        __asm__ volatile("# class " #k : "+r"(acc)); \
+        return acc * 31 + self->value + k; \
+    }
+#define CLASS_DEF(k) {class_apply_##k},
+
+HEX256(OP_FN)
+HEX256(CLASS_FN)
+
+static uint64_t (*const op_table[OP_COUNT])(uint64_t) = { HEX256(OP_PTR) };
+static const object_class_t object_classes[OP_COUNT] = { HEX256(CLASS_DEF) };
+
+typedef struct {
+    uint8_t ops[INDIRECT_OPS];
+    object_t objects[INDIRECT_OPS];   // objects[i].cls == &object_classes[ops[i]]
+} dispatch_stream_t;
+
+// Interpreter-style loop: one jump-table branch
+static __attribute__((noinline)) uint64_t dispatch_switch(const dispatch_stream_t *s, uint64_t count) {
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        switch (s->ops[i & (INDIRECT_OPS - 1)]) {
+            HEX256(OP_CASE)
+        }
+    }
+    return acc;
+}
+
+static __attribute__((noinline)) uint64_t dispatch_fnptr(const dispatch_stream_t *s, uint64_t count) {
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        acc = op_table[s->ops[i & (INDIRECT_OPS - 1)]](acc);
+    }
+    return acc;
 }
 
+// Heterogeneous collection: load class pointer, then the method
+static __attribute__((noinline)) uint64_t dispatch_virtual(const dispatch_stream_t *s, uint64_t count) {
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        const object_t *obj = &s->objects[i & (INDIRECT_OPS - 1)];
+        acc = obj->cls->apply(obj, acc);
+    }
+    return acc;
+}
+
+typedef uint64_t (*dispatch_fn)(const dispatch_stream_t *s, uint64_t count);
+
+static const struct {
+    const char *name;
+    dispatch_fn fn;
+} dispatch_styles[] = {
+    {"switch", dispatch_switch},
+    {"fnptr", dispatch_fnptr},
+    {"virtual", dispatch_virtual},
+};
+
 int compare_int(const void *a, const void *b) {
     return (*(int*)a - *(int*)b);
 }
 
-void run_experiment(FILE *csv) {
+void run_experiment(results_t *csv) {
     int *array = malloc(ARRAY_SIZE * sizeof(int));
     if (!array) {
         perror("malloc");
@@ -114,12 +289,14 @@ void run_experiment(FILE *csv) {
     qsort(array, ARRAY_SIZE, sizeof(int), compare_int);
     
     for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
+        uint64_t start_ts = tsc_clock_ns();
         uint64_t runtime = test_predictable(array, ARRAY_SIZE);
         double ns_per_elem = (double)runtime / ARRAY_SIZE;
         
-        fprintf(csv, "%d,sorted_predictable,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-               run++, start_ts, runtime, ns_per_elem);
+        results_u64(csv, run++);
+        results_str(csv, "sorted_predictable");
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ns_per_elem);
     }
     
     // Test 2: Random array (unpredictable branches)
@@ -130,23 +307,27 @@ void run_experiment(FILE *csv) {
     }
     
     for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
+        uint64_t start_ts = tsc_clock_ns();
         uint64_t runtime = test_unpredictable(array, ARRAY_SIZE);
         double ns_per_elem = (double)runtime / ARRAY_SIZE;
         
-        fprintf(csv, "%d,random_unpredictable,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-               run++, start_ts, runtime, ns_per_elem);
+        results_u64(csv, run++);
+        results_str(csv, "random_unpredictable");
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ns_per_elem);
     }
     
     // Test 3: Random array with branchless code
     printf("Test 3: Random array (branchless)...\n");
     for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
+        uint64_t start_ts = tsc_clock_ns();
         uint64_t runtime = test_branchless(array, ARRAY_SIZE);
         double ns_per_elem = (double)runtime / ARRAY_SIZE;
         
-        fprintf(csv, "%d,random_branchless,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-               run++, start_ts, runtime, ns_per_elem);
+        results_u64(csv, run++);
+        results_str(csv, "random_branchless");
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ns_per_elem);
     }
     
     // Test 4: Sorted array with branchless code (for comparison)
@@ -154,43 +335,247 @@ void run_experiment(FILE *csv) {
     qsort(array, ARRAY_SIZE, sizeof(int), compare_int);
     
     for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
+        uint64_t start_ts = tsc_clock_ns();
         uint64_t runtime = test_branchless(array, ARRAY_SIZE);
         double ns_per_elem = (double)runtime / ARRAY_SIZE;
         
-        fprintf(csv, "%d,sorted_branchless,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-               run++, start_ts, runtime, ns_per_elem);
+        results_u64(csv, run++);
+        results_str(csv, "sorted_branchless");
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ns_per_elem);
     }
     
     free(array);
 }
 
+static int parse_list(const char *name, const char *defaults, long *out) {
+    const char *env = getenv(name);
+    char *copy = strdup(env && *env ? env : defaults);
+    int count = 0;
+    
+    for (char *tok = strtok(copy, ","); tok && count < MAX_LIST; tok = strtok(NULL, ",")) {
+        out[count++] = strtol(tok, NULL, 10);
+    }
+    free(copy);
+    return count;
+}
+
+/* The mpki and mispredicts columns need these labels in LRC_PERF_EVENTS */
+static void check_mpki_events(const perf_event_list_t *events) {
+    static const char *needed[] = {"instructions", "branch_misses"};
+    
+    for (size_t i = 0; i < sizeof(needed) / sizeof(needed[0]); i++) {
+        if (perf_event_list_find(events, needed[i]) < 0) {
+            fprintf(stderr, "Warning: perf event list has no '%s', mpki and mispredicts "
+                    "columns will be 0\n", needed[i]);
+        }
+    }
+}
+
+/* Per-row counter columns shared by the capacity and indirect sweeps; returns MPKI */
+static double branch_counters(results_t *csv, const perf_event_list_t *events, uint64_t executed) {
+    uint64_t instructions = perf_event_list_value(events, "instructions");
+    uint64_t misses = perf_event_list_value(events, "branch_misses");
+    double mpki = instructions ? 1000.0 * misses / instructions : 0.0;
+    
+    results_f64(csv, executed ? (double)misses / executed : 0.0);
+    results_f64(csv, mpki);
+    results_events(csv, events);
+    return mpki;
+}
+
+static void run_capacity_experiment(results_t *csv, perf_event_list_t *events) {
+    long sites[MAX_LIST], periods[MAX_LIST];
+    int num_sites = parse_list("LRC_BRANCH_SITES", "8,64,256,1024,4096", sites);
+    int num_periods = parse_list("LRC_BRANCH_PERIODS", "1,2,4,8,16,32,64,128,256,1024,0", periods);
+    int num_kernels = sizeof(branch_kernels) / sizeof(branch_kernels[0]);
+    
+    for (int s = 0; s < num_sites; s++) {
+        branch_kernel_fn fn = NULL;
+        for (int k = 0; k < num_kernels; k++) {
+            if (branch_kernels[k].sites == sites[s]) fn = branch_kernels[k].fn;
+        }
+        if (!fn) {
+            fprintf(stderr, "Warning: no generated kernel with %ld sites, skipped\n", sites[s]);
+            continue;
+        }
+        
+        uint64_t passes = CAPACITY_BRANCHES / (uint64_t)sites[s];
+        uint64_t executed = passes * (uint64_t)sites[s];
+        for (int p = 0; p < num_periods; p++) {
+            uint64_t period = periods[p] > 0 ? (uint64_t)periods[p] : 0;
+            uint64_t sink = 0;
+            double mpki_sum = 0.0;
+            run_control_t rc;
+            
+            // The discarded warmup run trains the predictor and faults in the code
+            run_control_begin(&rc, SWEEP_MIN_RUNS, SWEEP_MAX_RUNS);
+            while (run_control_next(&rc)) {
+                uint64_t start_ts = tsc_clock_ns();
+                perf_event_list_start(events);
+                uint64_t start = tsc_begin();
+                sink += fn(passes, period, 12345);
+                uint64_t end = tsc_end();
+                perf_event_list_stop(events);
+                
+                double ns = tsc_to_ns(tsc_elapsed(start, end));
+                if (!run_control_add(&rc, ns)) continue;   // Warmup
+                
+                results_u64(csv, run_control_index(&rc));
+                results_u64(csv, (uint64_t)sites[s]);
+                results_u64(csv, period);
+                results_u64(csv, start_ts);
+                results_u64(csv, executed);
+                results_f64(csv, ns / executed);
+                mpki_sum += branch_counters(csv, events, executed);
+            }
+            
+            if (sink == 0xDEADBEEF) printf("!");
+            
+            printf("  %4ld sites, period %5lu: %6.3f ns/branch, %6.2f MPKI (%d runs)\n", sites[s],
+                   (unsigned long)period, rc.median / executed,
+                   rc.runs ? mpki_sum / rc.runs : 0.0, rc.runs);
+        }
+    }
+}
+
+static void run_indirect_experiment(results_t *csv, perf_event_list_t *events) {
+    static const char *patterns[] = {"cyclic", "random"};
+    long targets[MAX_LIST];
+    int num_targets = parse_list("LRC_BRANCH_TARGETS", "1,2,4,8,16,32,64,128,256", targets);
+    int num_styles = sizeof(dispatch_styles) / sizeof(dispatch_styles[0]);
+    
+    dispatch_stream_t *stream = malloc(sizeof(*stream));
+    if (!stream) {
+        perror("malloc");
+        return;
+    }
+    
+    for (int t = 0; t < num_targets; t++) {
+        if (targets[t] < 1 || targets[t] > OP_COUNT) {
+            fprintf(stderr, "Warning: %ld targets outside 1..%d, skipped\n", targets[t], OP_COUNT);
+            continue;
+        }
+        
+        for (int pat = 0; pat < 2; pat++) {
+            lrc_rng_t rng;
+            lrc_rng_seed(&rng, 12345);
+            for (size_t i = 0; i < INDIRECT_OPS; i++) {
+                uint8_t op = (uint8_t)(pat == 0 ? i % (size_t)targets[t] :
+                                       lrc_rng_bounded(&rng, (uint64_t)targets[t]));
+                stream->ops[i] = op;
+                stream->objects[i].cls = &object_classes[op];
+                stream->objects[i].value = i;
+            }
+            
+            for (int d = 0; d < num_styles; d++) {
+                uint64_t sink = 0;
+                run_control_t rc;
+                
+                run_control_begin(&rc, SWEEP_MIN_RUNS, SWEEP_MAX_RUNS);
+                while (run_control_next(&rc)) {
+                    uint64_t start_ts = tsc_clock_ns();
+                    perf_event_list_start(events);
+                    uint64_t start = tsc_begin();
+                    sink += dispatch_styles[d].fn(stream, INDIRECT_DISPATCHES);
+                    uint64_t end = tsc_end();
+                    perf_event_list_stop(events);
+                    
+                    double ns = tsc_to_ns(tsc_elapsed(start, end));
+                    if (!run_control_add(&rc, ns)) continue;   // Warmup
+                    
+                    results_u64(csv, run_control_index(&rc));
+                    results_str(csv, dispatch_styles[d].name);
+                    results_str(csv, patterns[pat]);
+                    results_u64(csv, (uint64_t)targets[t]);
+                    results_u64(csv, start_ts);
+                    results_u64(csv, INDIRECT_DISPATCHES);
+                    results_f64(csv, ns / INDIRECT_DISPATCHES);
+                    branch_counters(csv, events, INDIRECT_DISPATCHES);
+                }
+                
+                if (sink == 0xDEADBEEF) printf("!");
+            }
+        }
+        printf("  %3ld targets done\n", targets[t]);
+    }
+    
+    free(stream);
+}
+
 int main(void) {
-    FILE *csv = fopen("data/branch_prediction.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    results_t csv;
+    if (results_open(&csv, "data/branch_prediction.csv", 4 * ITERATIONS) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "ns_per_element\n");
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "ns_per_element", RESULT_F64, 2);
     
     printf("Branch Prediction Impact Benchmark\n");
     printf("===================================\n\n");
     printf("Array size: %d elements\n", ARRAY_SIZE);
-    printf("Iterations: %d\n\n", ITERATIONS);
+    printf("Iterations: %d\n", ITERATIONS);
+    tsc_init();
+    printf("Timer: %s (%.3f ticks/ns, %.1f ns overhead subtracted)\n\n", tsc_source_name(),
+           tsc_info()->ticks_per_ns, tsc_to_ns(tsc_info()->overhead_ticks));
+    
+    run_experiment(&csv);
+    
+    if (results_close(&csv) != 0) return 1;
+    
+    // Predictor capacity and indirect dispatch sweeps
+    results_t capacity, indirect;
+    if (results_open(&capacity, "data/branch_capacity.csv", MAX_LIST * MAX_LIST * SWEEP_MIN_RUNS) != 0 ||
+        results_open(&indirect, "data/branch_indirect.csv", 2 * 3 * MAX_LIST * SWEEP_MIN_RUNS) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    perf_event_list_t events;
+    perf_event_list_from_env(&events, BRANCH_PERF_EVENTS, 1);
+    check_mpki_events(&events);
+    
+    results_add_column(&capacity, "run", RESULT_U64, 0);
+    results_add_column(&capacity, "sites", RESULT_U64, 0);
+    results_add_column(&capacity, "period", RESULT_U64, 0);
+    results_add_column(&capacity, "timestamp_ns", RESULT_U64, 0);
+    results_add_column(&capacity, "executed", RESULT_U64, 0);
+    results_add_column(&capacity, "ns_per_branch", RESULT_F64, 3);
+    results_add_column(&capacity, "mispredicts_per_branch", RESULT_F64, 4);
+    results_add_column(&capacity, "mpki", RESULT_F64, 3);
+    results_add_event_columns(&capacity, &events);
+    
+    results_add_column(&indirect, "run", RESULT_U64, 0);
+    results_add_column(&indirect, "dispatch", RESULT_STR, 0);
+    results_add_column(&indirect, "pattern", RESULT_STR, 0);
+    results_add_column(&indirect, "targets", RESULT_U64, 0);
+    results_add_column(&indirect, "timestamp_ns", RESULT_U64, 0);
+    results_add_column(&indirect, "dispatches", RESULT_U64, 0);
+    results_add_column(&indirect, "ns_per_dispatch", RESULT_F64, 3);
+    results_add_column(&indirect, "mispredicts_per_dispatch", RESULT_F64, 4);
+    results_add_column(&indirect, "mpki", RESULT_F64, 3);
+    results_add_event_columns(&indirect, &events);
     
-    run_experiment(csv);
+    printf("\nPredictor capacity (distinct conditional branches x pattern period)\n");
+    run_capacity_experiment(&capacity, &events);
+    printf("\nIndirect dispatch (switch, function pointer, virtual call)\n");
+    run_indirect_experiment(&indirect, &events);
     
-    fclose(csv);
+    perf_event_list_close(&events);
+    if (results_close(&capacity) != 0 || results_close(&indirect) != 0) return 1;
     
-    printf("\nResults saved to data/branch_prediction.csv\n");
+    printf("\nResults saved to data/branch_prediction.csv, data/branch_capacity.csv\n");
+    printf("and data/branch_indirect.csv\n");
     printf("\nExpected patterns:\n");
     printf("  Sorted + branches: ~1-2 ns/element (perfect prediction)\n");
     printf("  Random + branches: ~10-20 ns/element (50%% misprediction)\n");
     printf("  Branchless: ~3-5 ns/element (no mispredictions, more instructions)\n");
+    printf("  Capacity: MPKI stays ~0 until sites x period outgrows the predictor\n");
+    printf("  Indirect: cyclic targets predicted from history, random ones miss (T-1)/T\n");
     printf("\nLesson: For unpredictable data, branchless code can be faster!\n");
     
     return 0;
@@ -10,6 +10,10 @@
  *   - L1/L2/L3/DRAM buffer sizes
  *   - Measure: cache misses, IPC, branch prediction
  *
+ * Variables:
+ *   - Page size (LRC_PAGE_SIZES, default 4k,thp): DRAM-sized buffers
+ *     also pay for TLB misses on 4 KB pages
+ *
  * Expected outcome:
  *   - L1: High IPC (~3-4), low cache misses
  *   - L2: Medium IPC (~2), moderate L1 misses
@@ -21,15 +25,20 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include "../core/metrics.h"
 #include "../core/perf_counters.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/lrc_alloc.h"
 
 extern uint64_t memory_stream_read(const uint64_t *buffer, size_t size);
 extern int pin_to_cpu(int cpu);
 
 #define KB (1024ULL)
 #define MB (1024ULL * KB)
-#define RUNS 10
+#define MIN_RUNS 5
+#define MAX_RUNS 30
 
 static const size_t buffer_sizes[] = {
     8 * KB,
@@ -47,81 +56,101 @@ static const char *size_names[] = {
 
 int main(void) {
     workload_metrics_t metrics;
+    run_control_t rc;
     perf_counters_t perf;
     
-    FILE *out = fopen("../data/cache_analysis.csv", "w");
-    if (!out) {
-        perror("fopen");
+    results_t out;
+    size_t num_sizes = sizeof(buffer_sizes) / sizeof(buffer_sizes[0]);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
+    
+    if (results_open(&out, "../data/cache_analysis.csv", num_pages * num_sizes * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "buffer_size", RESULT_STR, 0);
+    results_add_column(&out, "page_size", RESULT_STR, 0);
+    results_add_column(&out, "huge_fraction", RESULT_F64, 3);
+    results_add_metrics_columns(&out);
     
-    // Initialize perf counters
-    if (perf_counters_init(&perf) < 0) {
+    // Initialize perf counters: one group so all events cover the same
+    // interval; fall back to independent counters if grouping fails.
+    if (perf_counters_init_group(&perf) < 0 && perf_counters_init(&perf) < 0) {
         fprintf(stderr, "Warning: perf counters not available\n");
         fprintf(stderr, "         Need: CAP_PERFMON or /proc/sys/kernel/perf_event_paranoid <= 2\n");
         fprintf(stderr, "         Continuing without hardware counters...\n");
         
         // Continue without perf - still useful data
-        fprintf(out, "run,buffer_size,");
-        metrics_print_csv_header(out);
     } else {
-        fprintf(out, "run,buffer_size,");
-        metrics_print_csv_header(out);
-        fprintf(out, ",");
-        perf_counters_print_csv_header(out);
+        results_add_perf_columns(&out);
     }
     
     pin_to_cpu(0);
     
     printf("Running cache analysis with hardware counters...\n\n");
     
-    for (size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++) {
-        size_t size = buffer_sizes[i];
-        const char *name = size_names[i];
-        
-        uint64_t *buffer = malloc(size);
-        if (!buffer) {
-            fprintf(stderr, "Failed to allocate %zu bytes\n", size);
-            continue;
-        }
-        
-        memset(buffer, 0x42, size);
+    for (int p = 0; p < num_pages; p++) {
+        lrc_alloc_opts_t opts = { -1, pages[p], 0 };
         
-        printf("Testing %s (%zu bytes)...\n", name, size);
-        
-        for (int run = 0; run < RUNS; run++) {
-            fprintf(out, "%d,%s,", run, name);
-            
-            metrics_init(&metrics);
+        for (size_t i = 0; i < num_sizes; i++) {
+            size_t size = buffer_sizes[i];
+            const char *name = size_names[i];
             
-            if (perf.fd_instructions >= 0) {
-                perf_counters_start(&perf);
+            uint64_t *buffer = lrc_alloc(size, &opts);
+            if (!buffer) {
+                fprintf(stderr, "Skipping %s with %s pages: %s\n",
+                        name, lrc_pages_name(pages[p]), strerror(errno));
+                continue;
             }
             
-            uint64_t result = memory_stream_read(buffer, size);
+            memset(buffer, 0x42, size);
+            double huge = lrc_alloc_huge_fraction(buffer, size);
             
-            if (perf.fd_instructions >= 0) {
-                perf_counters_stop(&perf);
-            }
+            printf("Testing %s (%zu bytes, %s pages)...\n", name, size, lrc_pages_name(pages[p]));
             
-            metrics_finish(&metrics);
-            metrics_print_csv(out, &metrics);
-            
-            if (perf.fd_instructions >= 0) {
-                fprintf(out, ",");
-                perf_counters_print_csv(out, &perf);
-            } else {
-                fprintf(out, "\n");
+            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+            while (run_control_next(&rc)) {
+                metrics_init(&metrics);
+                
+                if (perf.fd_instructions >= 0) {
+                    perf_counters_start(&perf);
+                }
+                
+                uint64_t result = memory_stream_read(buffer, size);
+                
+                if (perf.fd_instructions >= 0) {
+                    perf_counters_stop(&perf);
+                    
+                    double ratio = perf_counters_running_ratio(&perf);
+                    if (perf.grouped && ratio < 1.0) {
+                        fprintf(stderr, "Warning: run %d multiplexed (%.0f%% on PMU), "
+                                "values scaled\n", rc.runs, ratio * 100.0);
+                    }
+                }
+                
+                metrics_finish(&metrics);
+                
+                (void)result;
+                if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+                
+                results_u64(&out, run_control_index(&rc));
+                results_str(&out, name);
+                results_str(&out, lrc_pages_name(pages[p]));
+                results_f64(&out, huge);
+                results_metrics(&out, &metrics);
+                if (perf.fd_instructions >= 0) {
+                    results_perf(&out, &perf);
+                }
             }
+            run_control_report(&rc, name);
             
-            (void)result;
+            lrc_free(buffer, size, pages[p]);
         }
-        
-        free(buffer);
     }
     
     perf_counters_close(&perf);
-    fclose(out);
+    if (results_close(&out) != 0) return 1;
     
     printf("\nResults saved to ../data/cache_analysis.csv\n");
     printf("\nAnalyze with:\n");
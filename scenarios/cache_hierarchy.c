@@ -15,6 +15,7 @@
  *
  * Variables:
  *   - Buffer size (controlled)
+ *   - Page size (controlled, LRC_PAGE_SIZES, default 4k,thp)
  *   - Access pattern (sequential, fixed)
  *
  * Expected outcome:
@@ -35,14 +36,19 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/lrc_alloc.h"
 
 extern uint64_t memory_stream_read(const uint64_t *buffer, size_t size);
 extern int pin_to_cpu(int cpu);
 
 #define KB (1024ULL)
 #define MB (1024ULL * KB)
-#define RUNS 10
+#define MIN_RUNS 5
+#define MAX_RUNS 30
 
 static const size_t buffer_sizes[] = {
     8 * KB,      // L1
@@ -60,49 +66,69 @@ static const char *size_names[] = {
 
 int main(void) {
     workload_metrics_t metrics;
-    FILE *out = fopen("../data/cache_hierarchy.csv", "w");
+    run_control_t rc;
+    results_t out;
+    size_t num_sizes = sizeof(buffer_sizes) / sizeof(buffer_sizes[0]);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
     
-    if (!out) {
-        perror("fopen");
+    if (results_open(&out, "../data/cache_hierarchy.csv", num_pages * num_sizes * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
     pin_to_cpu(0);
     
-    fprintf(out, "run,buffer_size,");
-    metrics_print_csv_header(out);
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "buffer_size", RESULT_STR, 0);
+    results_add_column(&out, "page_size", RESULT_STR, 0);
+    results_add_column(&out, "huge_fraction", RESULT_F64, 3);
+    results_add_metrics_columns(&out);
     
     printf("Running cache hierarchy experiment...\n");
     printf("This will allocate up to 64 MB of memory.\n\n");
     
-    for (size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++) {
-        size_t size = buffer_sizes[i];
-        const char *name = size_names[i];
+    for (int p = 0; p < num_pages; p++) {
+        lrc_alloc_opts_t opts = { -1, pages[p], 0 };
         
-        uint64_t *buffer = malloc(size);
-        if (!buffer) {
-            fprintf(stderr, "Failed to allocate %zu bytes\n", size);
-            continue;
-        }
-        
-        memset(buffer, 0x42, size);
-        
-        printf("Testing %s (%zu bytes)...\n", name, size);
-        
-        for (int run = 0; run < RUNS; run++) {
-            fprintf(out, "%d,%s,", run, name);
-            metrics_init(&metrics);
-            uint64_t result = memory_stream_read(buffer, size);
-            metrics_finish(&metrics);
-            metrics_print_csv(out, &metrics);
+        for (size_t i = 0; i < num_sizes; i++) {
+            size_t size = buffer_sizes[i];
+            const char *name = size_names[i];
+            
+            uint64_t *buffer = lrc_alloc(size, &opts);
+            if (!buffer) {
+                fprintf(stderr, "Skipping %s with %s pages: %s\n",
+                        name, lrc_pages_name(pages[p]), strerror(errno));
+                continue;
+            }
             
-            (void)result;
+            memset(buffer, 0x42, size);
+            double huge = lrc_alloc_huge_fraction(buffer, size);
+            
+            printf("Testing %s (%zu bytes, %s pages)...\n", name, size, lrc_pages_name(pages[p]));
+            
+            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+            while (run_control_next(&rc)) {
+                metrics_init(&metrics);
+                uint64_t result = memory_stream_read(buffer, size);
+                metrics_finish(&metrics);
+                
+                (void)result;
+                if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+                
+                results_u64(&out, run_control_index(&rc));
+                results_str(&out, name);
+                results_str(&out, lrc_pages_name(pages[p]));
+                results_f64(&out, huge);
+                results_metrics(&out, &metrics);
+            }
+            run_control_report(&rc, name);
+            
+            lrc_free(buffer, size, pages[p]);
         }
-        
-        free(buffer);
     }
     
-    fclose(out);
+    if (results_close(&out) != 0) return 1;
     printf("\nResults saved to ../data/cache_hierarchy.csv\n");
     
     return 0;
@@ -0,0 +1,385 @@
+/*
+ * core_to_core.c - Core-to-core cache-line transfer latency matrix
+ *
+ * Hypothesis:
+ *   Moving a modified cache line between two cores costs very different
+ *   amounts depending on where they sit: SMT siblings share the L1,
+ *   cores of one L3 (CCX) hand the line over inside it, cores on
+ *   different L3s of one package go through the mesh/fabric, and cores
+ *   on different sockets cross the inter-socket link. Thread-to-core
+ *   affinity for communicating pipeline stages should follow the matrix.
+ *
+ * Method:
+ *   Two threads, pinned to CPUs a and b, pass one cache line back and
+ *   forth with compare-and-swap: the ping side moves the counter from
+ *   2i to 2i+1, the pong side from 2i+1 to 2i+2, each spinning until
+ *   its CAS succeeds. Every round trip moves the line twice. The ping
+ *   side times blocks of LRC_C2C_ROUNDS round trips with the TSC; the
+ *   median of LRC_C2C_SAMPLES blocks is the pair's latency.
+ *
+ *   The two threads stay alive for the whole matrix: ping re-pins once
+ *   per row, pong once per pair, so a pair costs its measurements plus
+ *   one migration, and 256 CPUs (32640 pairs) finish in about a minute.
+ *   Only a < b is measured; the matrix is mirrored.
+ *
+ * Variables:
+ *   - CPU pair (every pair of LRC_C2C_CPUS, default all allowed CPUs)
+ *   - Relation: smt, l3 (same L3, other core), socket (same package,
+ *     other L3), cross_socket
+ *
+ * Expected outcome:
+ *   - smt: ~10-20 ns round trip (line stays in the shared L1)
+ *   - l3: ~40-100 ns
+ *   - socket (other CCX or far side of the mesh): ~100-200 ns
+ *   - cross_socket: ~200-400 ns
+ *
+ * Output:
+ *   ../data/core_to_core.csv         One row per measured pair
+ *   ../data/core_to_core_matrix.csv  N x N round-trip ns (plain CSV,
+ *                                    first row and column are CPU ids)
+ *   Summary per relation on stdout: pairs, min, median, max.
+ *
+ * Limitations:
+ *   - Round trip includes two CAS executions and the spin-loop exit on
+ *     each side, so it is an upper bound on two line transfers
+ *   - Power state: idle cores between rows may wake up more slowly; the
+ *     median of several samples after a warmup block hides most of it
+ *   - Only a < b is measured; asymmetric interconnects are averaged
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "../core/results.h"
+#include "../core/topology.h"
+#include "../core/tsc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define CACHE_LINE 64
+#define DEFAULT_ROUNDS 1000
+#define DEFAULT_SAMPLES 5
+#define MAX_SAMPLES 64
+#define SPINS_BEFORE_YIELD (1 << 20)    // Partner preempted: let it run
+
+typedef enum {
+    REL_SMT = 0,
+    REL_L3,
+    REL_SOCKET,
+    REL_CROSS_SOCKET,
+    REL_COUNT
+} relation_t;
+
+static const char *relation_names[REL_COUNT] = { "smt", "l3", "socket", "cross_socket" };
+
+/* The ping-pong line and the pong thread's mailbox, on separate lines */
+typedef struct {
+    volatile uint64_t line __attribute__((aligned(CACHE_LINE)));
+    volatile uint64_t gen __attribute__((aligned(CACHE_LINE)));   // Bumped per pair
+    volatile uint64_t ack;                                         // = gen when pinned
+    int cpu;                                                       // Pong CPU, -1 = exit
+    int pin_error;
+    uint64_t total;                                                // Round trips to answer
+} pingpong_t;
+
+static pingpong_t pp;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/* Spin until line moves from expected to expected + 1 */
+static inline void cas_step(uint64_t expected) {
+    uint64_t spins = 0;
+    for (;;) {
+        uint64_t e = expected;
+        if (__atomic_compare_exchange_n(&pp.line, &e, expected + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+        cpu_relax();
+        if (++spins == SPINS_BEFORE_YIELD) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+static void *pong_thread(void *arg) {
+    uint64_t seen = 0;
+    (void)arg;
+    
+    for (;;) {
+        while (__atomic_load_n(&pp.gen, __ATOMIC_ACQUIRE) == seen) cpu_relax();
+        seen = pp.gen;
+        if (pp.cpu < 0) return NULL;
+        
+        uint64_t total = pp.total;      // Read before ack: main rewrites it for the next pair
+        pp.pin_error = topology_pin_thread(pthread_self(), pp.cpu);
+        __atomic_store_n(&pp.ack, seen, __ATOMIC_RELEASE);
+        if (pp.pin_error) continue;
+        
+        for (uint64_t i = 0; i < total; i++) cas_step(2 * i + 1);
+    }
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Round-trip latency between the calling thread's CPU and cpu_b.
+ * Returns the median block in ns (min in *min_ns), or -1 if cpu_b
+ * could not be pinned.
+ */
+static double measure_pair(int cpu_b, int rounds, int samples, double *min_ns) {
+    double block_ns[MAX_SAMPLES];
+    
+    pp.line = 0;
+    pp.cpu = cpu_b;
+    pp.total = (uint64_t)rounds * (samples + 1);
+    uint64_t gen = pp.gen + 1;
+    __atomic_store_n(&pp.gen, gen, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&pp.ack, __ATOMIC_ACQUIRE) != gen) cpu_relax();
+    if (pp.pin_error) return -1.0;
+    
+    // Block 0 is warmup (wakes both cores from their idle states)
+    uint64_t i = 0;
+    for (int s = 0; s <= samples; s++) {
+        uint64_t start = tsc_begin();
+        for (int r = 0; r < rounds; r++, i++) cas_step(2 * i);
+        uint64_t end = tsc_end();
+        if (s > 0) block_ns[s - 1] = tsc_to_ns(tsc_elapsed(start, end)) / rounds;
+    }
+    // The pong side's last CAS completes the final round trip
+    while (__atomic_load_n(&pp.line, __ATOMIC_ACQUIRE) != 2 * i) cpu_relax();
+    
+    qsort(block_ns, samples, sizeof(double), cmp_double);
+    *min_ns = block_ns[0];
+    return block_ns[samples / 2];
+}
+
+static relation_t relation(const topo_cpu_t *a, const topo_cpu_t *b) {
+    if (a->domain[TOPO_LEVEL_CORE] == b->domain[TOPO_LEVEL_CORE]) return REL_SMT;
+    if (a->domain[TOPO_LEVEL_L3] == b->domain[TOPO_LEVEL_L3]) return REL_L3;
+    if (a->domain[TOPO_LEVEL_PACKAGE] == b->domain[TOPO_LEVEL_PACKAGE]) return REL_SOCKET;
+    return REL_CROSS_SOCKET;
+}
+
+static int env_int(const char *name, int def, int lo, int hi) {
+    const char *v = getenv(name);
+    int n = v && *v ? atoi(v) : def;
+    if (n < lo) n = lo;
+    if (n > hi) n = hi;
+    return n;
+}
+
+/*
+ * Indexes into topo.cpus of the CPUs to measure ($LRC_C2C_CPUS, a
+ * sysfs-style list, default every allowed CPU).
+ */
+static int select_cpus(const topology_t *topo, int *idx) {
+    const char *list = getenv("LRC_C2C_CPUS");
+    int count = 0;
+    
+    if (!list || !*list) {
+        for (int i = 0; i < topo->num_cpus; i++) idx[count++] = i;
+        return count;
+    }
+    size_t setsize = CPU_ALLOC_SIZE(topo->cpu_limit);
+    cpu_set_t *set = CPU_ALLOC(topo->cpu_limit);
+    if (!set) return 0;
+    topology_parse_cpulist(list, set, setsize);
+    for (int i = 0; i < topo->num_cpus; i++) {
+        if (CPU_ISSET_S(topo->cpus[i].cpu, setsize, set)) idx[count++] = i;
+    }
+    CPU_FREE(set);
+    return count;
+}
+
+static int write_matrix(const char *path, const topology_t *topo, const int *idx, int n,
+                        const double *matrix) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    
+    fprintf(f, "cpu");
+    for (int j = 0; j < n; j++) fprintf(f, ",%d", topo->cpus[idx[j]].cpu);
+    fprintf(f, "\n");
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "%d", topo->cpus[idx[i]].cpu);
+        for (int j = 0; j < n; j++) {
+            double v = matrix[(size_t)i * n + j];
+            if (v < 0) fprintf(f, ",");
+            else fprintf(f, ",%.1f", v);
+        }
+        fprintf(f, "\n");
+    }
+    return fclose(f);
+}
+
+static void print_summary(const double *matrix, const int *rel_of, int n) {
+    double *values = malloc(sizeof(double) * ((size_t)n * n / 2 + 1));
+    if (!values) return;
+    
+    printf("\n%-14s %8s %10s %10s %10s\n", "relation", "pairs", "min_ns", "median_ns", "max_ns");
+    for (int r = 0; r < REL_COUNT; r++) {
+        size_t count = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                double v = matrix[(size_t)i * n + j];
+                if (v >= 0 && rel_of[(size_t)i * n + j] == r) values[count++] = v;
+            }
+        }
+        if (count == 0) continue;
+        qsort(values, count, sizeof(double), cmp_double);
+        printf("%-14s %8zu %10.1f %10.1f %10.1f\n", relation_names[r], count,
+               values[0], values[count / 2], values[count - 1]);
+    }
+    free(values);
+}
+
+int main(void) {
+    topology_t topo;
+    results_t out;
+    pthread_t pong;
+    
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    tsc_init();
+    
+    int rounds = env_int("LRC_C2C_ROUNDS", DEFAULT_ROUNDS, 1, 1 << 24);
+    int samples = env_int("LRC_C2C_SAMPLES", DEFAULT_SAMPLES, 1, MAX_SAMPLES);
+    int *idx = malloc(sizeof(int) * topo.num_cpus);
+    int n = idx ? select_cpus(&topo, idx) : 0;
+    
+    printf("Core-to-Core Cache-Line Latency\n");
+    printf("===============================\n\n");
+    topology_print(&topo);
+    printf("Timer: %s, %d CPUs selected, %d round trips x %d samples per pair\n\n",
+           tsc_source_name(), n, rounds, samples);
+    
+    if (n < 2) {
+        printf("Need at least two CPUs (LRC_C2C_CPUS or the affinity mask); nothing to measure\n");
+        free(idx);
+        topology_destroy(&topo);
+        return 0;
+    }
+    
+    size_t pairs = (size_t)n * (n - 1) / 2;
+    double *matrix = malloc(sizeof(double) * n * n);
+    int *rel_of = malloc(sizeof(int) * n * n);
+    if (!matrix || !rel_of) {
+        perror("malloc");
+        return 1;
+    }
+    
+    if (results_open(&out, "../data/core_to_core.csv", pairs) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    results_add_column(&out, "cpu_a", RESULT_U64, 0);
+    results_add_column(&out, "cpu_b", RESULT_U64, 0);
+    results_add_column(&out, "relation", RESULT_STR, 0);
+    results_add_column(&out, "rounds", RESULT_U64, 0);
+    results_add_column(&out, "samples", RESULT_U64, 0);
+    results_add_column(&out, "rtt_ns", RESULT_F64, 1);
+    results_add_column(&out, "rtt_min_ns", RESULT_F64, 1);
+    results_add_column(&out, "one_way_ns", RESULT_F64, 1);
+    
+    if (pthread_create(&pong, NULL, pong_thread, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+    
+    uint64_t start = tsc_clock_ns();
+    size_t done = 0;
+    for (int i = 0; i < n; i++) {
+        const topo_cpu_t *a = &topo.cpus[idx[i]];
+        matrix[(size_t)i * n + i] = -1.0;
+        rel_of[(size_t)i * n + i] = -1;
+        if (i == n - 1) break;
+        if (topology_pin_thread(pthread_self(), a->cpu) != 0) {
+            fprintf(stderr, "Cannot pin to CPU %d, row skipped\n", a->cpu);
+            for (int j = i + 1; j < n; j++) {
+                matrix[(size_t)i * n + j] = matrix[(size_t)j * n + i] = -1.0;
+                rel_of[(size_t)i * n + j] = rel_of[(size_t)j * n + i] = -1;
+            }
+            continue;
+        }
+        
+        for (int j = i + 1; j < n; j++) {
+            const topo_cpu_t *b = &topo.cpus[idx[j]];
+            double min_ns = 0.0;
+            double rtt = measure_pair(b->cpu, rounds, samples, &min_ns);
+            relation_t rel = relation(a, b);
+            
+            matrix[(size_t)i * n + j] = matrix[(size_t)j * n + i] = rtt;
+            rel_of[(size_t)i * n + j] = rel_of[(size_t)j * n + i] = rel;
+            if (rtt < 0) continue;
+            
+            results_u64(&out, (uint64_t)a->cpu);
+            results_u64(&out, (uint64_t)b->cpu);
+            results_str(&out, relation_names[rel]);
+            results_u64(&out, (uint64_t)rounds);
+            results_u64(&out, (uint64_t)samples);
+            results_f64(&out, rtt);
+            results_f64(&out, min_ns);
+            results_f64(&out, rtt / 2);
+            done++;
+        }
+        printf("\r  %zu / %zu pairs", done, pairs);
+        fflush(stdout);
+    }
+    printf("\n  %.1f s\n", (tsc_clock_ns() - start) / 1e9);
+    
+    pp.cpu = -1;
+    __atomic_store_n(&pp.gen, pp.gen + 1, __ATOMIC_RELEASE);
+    pthread_join(pong, NULL);
+    
+    if (n <= 16) {
+        printf("\nRound trip (ns):\n%6s", "");
+        for (int j = 0; j < n; j++) printf(" %6d", topo.cpus[idx[j]].cpu);
+        printf("\n");
+        for (int i = 0; i < n; i++) {
+            printf("%6d", topo.cpus[idx[i]].cpu);
+            for (int j = 0; j < n; j++) {
+                double v = matrix[(size_t)i * n + j];
+                if (v < 0) printf(" %6s", "-");
+                else printf(" %6.0f", v);
+            }
+            printf("\n");
+        }
+    }
+    print_summary(matrix, rel_of, n);
+    
+    int ret = 0;
+    if (results_close(&out) != 0) ret = 1;
+    if (write_matrix("../data/core_to_core_matrix.csv", &topo, idx, n, matrix) != 0) {
+        perror("../data/core_to_core_matrix.csv");
+        ret = 1;
+    }
+    
+    printf("\nResults saved to ../data/core_to_core.csv and ../data/core_to_core_matrix.csv\n");
+    printf("\nExpected patterns:\n");
+    printf("  smt:          ~10-20 ns (shared L1)\n");
+    printf("  l3:           ~40-100 ns\n");
+    printf("  socket:       ~100-200 ns (other L3 / CCX)\n");
+    printf("  cross_socket: ~200-400 ns\n");
+    
+    free(matrix);
+    free(rel_of);
+    free(idx);
+    topology_destroy(&topo);
+    return ret;
+}
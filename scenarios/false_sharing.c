@@ -24,15 +24,14 @@
 #include <time.h>
 #include <sched.h>
 #include <unistd.h>
+#include "../core/topology.h"
+#include "../core/thread_pool.h"
+#include "../core/results.h"
 
 #define CACHE_LINE_SIZE 64
 #define ITERATIONS 10000000
-#define MAX_THREADS 8
 
-// Shared structure - false sharing
-typedef struct {
-    volatile uint64_t counter[MAX_THREADS];
-} shared_counters_t;
+// Shared layout - false sharing: num_threads adjacent uint64_t counters
 
 // Padded structure - no false sharing
 typedef struct {
@@ -42,29 +41,29 @@ typedef struct {
 
 typedef struct {
     int thread_id;
+    int cpu;
     int num_threads;
     uint64_t iterations;
     void *counters;
     int use_padding;
-    uint64_t runtime_ns;
 } thread_arg_t;
 
+// Thread placement (LRC_PLACEMENT=compact|scatter|per_l3)
+static topology_t topo;
+static topo_placement_t placement;
+static int *thread_cpus;     // CPU for thread i, in placement order
+static int max_threads;      // Threads the placement can host
+static thread_pool_t pool;   // Pinned workers, reused by every test
+
 static inline uint64_t get_time_ns(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
-void* worker_thread(void *arg) {
-    thread_arg_t *params = (thread_arg_t*)arg;
-    
-    // Pin to specific CPU to ensure different cores
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    
-    uint64_t start = get_time_ns();
+// Pool task: threads are pinned to their CPUs when the pool is created
+static void worker_thread(int id, void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg + id;
     
     if (params->use_padding) {
         // Padded - no false sharing
@@ -74,29 +73,24 @@ void* worker_thread(void *arg) {
         }
     } else {
         // Not padded - false sharing
-        shared_counters_t *counters = (shared_counters_t*)params->counters;
+        volatile uint64_t *counters = (volatile uint64_t*)params->counters;
         for (uint64_t i = 0; i < params->iterations; i++) {
-            counters->counter[params->thread_id]++;
+            counters[params->thread_id]++;
         }
     }
-    
-    params->runtime_ns = get_time_ns() - start;
-    
-    return NULL;
 }
 
-void run_test(FILE *csv, int num_threads, int use_padding, int run_number) {
-    pthread_t threads[MAX_THREADS];
-    thread_arg_t args[MAX_THREADS];
+void run_test(results_t *csv, int num_threads, int use_padding, int run_number) {
+    thread_arg_t args[num_threads];
     
     // Allocate counter structures
     void *counters;
     if (use_padding) {
         counters = aligned_alloc(CACHE_LINE_SIZE, 
-                                sizeof(padded_counter_t) * MAX_THREADS);
-        memset(counters, 0, sizeof(padded_counter_t) * MAX_THREADS);
+                                sizeof(padded_counter_t) * num_threads);
+        if (counters) memset(counters, 0, sizeof(padded_counter_t) * num_threads);
     } else {
-        counters = calloc(1, sizeof(shared_counters_t));
+        counters = calloc(num_threads, sizeof(uint64_t));
     }
     
     if (!counters) {
@@ -104,32 +98,31 @@ void run_test(FILE *csv, int num_threads, int use_padding, int run_number) {
         return;
     }
     
-    // Create threads
     uint64_t start_ts = get_time_ns();
     
     for (int i = 0; i < num_threads; i++) {
         args[i].thread_id = i;
+        args[i].cpu = thread_cpus[i];
         args[i].num_threads = num_threads;
         args[i].iterations = ITERATIONS;
         args[i].counters = counters;
         args[i].use_padding = use_padding;
-        pthread_create(&threads[i], NULL, worker_thread, &args[i]);
     }
     
-    // Wait for completion
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    // All threads are released together from the pool's start barrier
+    thread_pool_run(&pool, num_threads, NULL, worker_thread, args);
+    uint64_t runtime = thread_pool_elapsed_ns(&pool);
     
-    // Calculate statistics
+    // Calculate statistics from per-thread timing
     uint64_t max_runtime = 0;
     uint64_t total_runtime = 0;
     
     for (int i = 0; i < num_threads; i++) {
-        if (args[i].runtime_ns > max_runtime) {
-            max_runtime = args[i].runtime_ns;
+        uint64_t thread_ns = pool.timing[i].end_ns - pool.timing[i].start_ns;
+        if (thread_ns > max_runtime) {
+            max_runtime = thread_ns;
         }
-        total_runtime += args[i].runtime_ns;
+        total_runtime += thread_ns;
     }
     
     uint64_t avg_runtime = total_runtime / num_threads;
@@ -137,21 +130,19 @@ void run_test(FILE *csv, int num_threads, int use_padding, int run_number) {
     
     const char *type = use_padding ? "padded" : "false_sharing";
     
-    fprintf(csv, "%d,%s_%dthreads,%lu,%lu,0,0,0,0,-1,-1,%.2f,%lu\n",
-           run_number,
-           type,
-           num_threads,
-           start_ts,
-           max_runtime,
-           ns_per_op,
-           max_runtime);
+    results_u64(csv, run_number);
+    results_strf(csv, "%s_%dthreads", type, num_threads);
+    results_str(csv, topology_placement_name(placement));
+    results_runtime(csv, start_ts, runtime);
+    results_f64(csv, ns_per_op);
+    results_u64(csv, max_runtime);
     
     free(counters);
 }
 
-void run_experiment(FILE *csv) {
-    int thread_counts[] = {1, 2, 4, 8};
-    int num_counts = sizeof(thread_counts) / sizeof(thread_counts[0]);
+void run_experiment(results_t *csv) {
+    int thread_counts[32];
+    int num_counts = topology_thread_counts(max_threads, thread_counts, 32);
     int run = 0;
     
     printf("Testing false sharing effects...\n\n");
@@ -159,12 +150,6 @@ void run_experiment(FILE *csv) {
     for (int i = 0; i < num_counts; i++) {
         int num_threads = thread_counts[i];
         
-        if (num_threads > sysconf(_SC_NPROCESSORS_ONLN)) {
-            printf("Skipping %d threads (only %ld CPUs available)\n",
-                   num_threads, sysconf(_SC_NPROCESSORS_ONLN));
-            continue;
-        }
-        
         printf("Testing with %d thread(s)...\n", num_threads);
         
         // Test without padding (false sharing)
@@ -176,26 +161,45 @@ void run_experiment(FILE *csv) {
 }
 
 int main(void) {
-    FILE *csv = fopen("data/false_sharing.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    placement = topology_placement_from_env(TOPO_PLACE_SCATTER);
+    thread_cpus = malloc(topo.num_cpus * sizeof(int));
+    max_threads = topology_place(&topo, placement, topo.num_cpus, thread_cpus);
+    if (thread_pool_create(&pool, max_threads, thread_cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "ns_per_op,max_thread_runtime\n");
+    results_t csv;
+    if (results_open(&csv, "data/false_sharing.csv", 2 * 32) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_column(&csv, "thread_placement", RESULT_STR, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "ns_per_op", RESULT_F64, 2);
+    results_add_column(&csv, "max_thread_runtime", RESULT_U64, 0);
     
     printf("False Sharing Detection Benchmark\n");
     printf("==================================\n\n");
     printf("Cache line size: %d bytes\n", CACHE_LINE_SIZE);
     printf("Iterations per thread: %d\n", ITERATIONS);
-    printf("Available CPUs: %ld\n\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("Available CPUs: %d (placement: %s, up to %d threads)\n\n",
+           topo.num_cpus, topology_placement_name(placement), max_threads);
+    
+    run_experiment(&csv);
     
-    run_experiment(csv);
+    thread_pool_destroy(&pool);
+    free(thread_cpus);
+    topology_destroy(&topo);
     
-    fclose(csv);
+    if (results_close(&csv) != 0) return 1;
     
     printf("\nResults saved to data/false_sharing.csv\n");
     printf("\nExpected patterns:\n");
@@ -14,6 +14,16 @@
  * - TLB efficiency with different page sizes
  * - Kernel huge page support
  * - Memory allocation overhead
+ *
+ * Hardware counters:
+ *   dTLB/iTLB misses are appended per row (see HUGE_PAGES_PERF_EVENTS),
+ *   so the speedup can be attributed to fewer TLB misses.
+ *
+ * Page sizes:
+ *   LRC_PAGE_SIZES selects the backing (default 4k,thp,2m; see
+ *   lrc_alloc.h). 2m/1g need reserved pages (/proc/sys/vm/nr_hugepages)
+ *   and are skipped, not silently replaced by 4 KB pages, when none are
+ *   free; huge_fraction reports how much of a THP buffer was promoted.
  */
 
 #define _GNU_SOURCE
@@ -21,19 +31,17 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
-#include <sys/mman.h>
 #include <unistd.h>
+#include "../core/perf_counters.h"
+#include "../core/results.h"
+#include "../core/lrc_alloc.h"
 
 #define NORMAL_PAGE_SIZE (4 * 1024)           // 4 KB
 #define HUGE_PAGE_SIZE (2 * 1024 * 1024)      // 2 MB
 #define ITERATIONS 10000000
-
-typedef enum {
-    PAGE_TYPE_NORMAL,
-    PAGE_TYPE_HUGE_2MB,
-    PAGE_TYPE_TRANSPARENT_HUGE
-} page_type_t;
+#define HUGE_PAGES_PERF_EVENTS "cycles,instructions,dTLB-load-misses,dTLB-store-misses,iTLB-load-misses"
 
 static inline uint64_t get_time_ns(void) {
     struct timespec ts;
@@ -45,50 +53,6 @@ static inline void compiler_barrier(void) {
     __asm__ __volatile__("" ::: "memory");
 }
 
-void* allocate_memory(size_t size, page_type_t page_type) {
-    void *ptr;
-    
-    switch (page_type) {
-        case PAGE_TYPE_NORMAL:
-            // Standard allocation
-            ptr = mmap(NULL, size,
-                      PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE | MAP_ANONYMOUS,
-                      -1, 0);
-            break;
-            
-        case PAGE_TYPE_HUGE_2MB:
-            // Explicit huge pages
-            ptr = mmap(NULL, size,
-                      PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
-                      -1, 0);
-            if (ptr == MAP_FAILED) {
-                // Fallback to normal if huge pages not available
-                fprintf(stderr, "Warning: Huge pages not available, using normal pages\n");
-                ptr = mmap(NULL, size,
-                          PROT_READ | PROT_WRITE,
-                          MAP_PRIVATE | MAP_ANONYMOUS,
-                          -1, 0);
-            }
-            break;
-            
-        case PAGE_TYPE_TRANSPARENT_HUGE:
-            // Let kernel decide (Transparent Huge Pages)
-            ptr = mmap(NULL, size,
-                      PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE | MAP_ANONYMOUS,
-                      -1, 0);
-            if (ptr != MAP_FAILED) {
-                // Advise kernel to use huge pages if possible
-                madvise(ptr, size, MADV_HUGEPAGE);
-            }
-            break;
-    }
-    
-    return ptr;
-}
-
 uint64_t measure_memory_access(char *buffer, size_t size) {
     uint64_t sum = 0;
     uint64_t start = get_time_ns();
@@ -112,16 +76,7 @@ uint64_t measure_memory_access(char *buffer, size_t size) {
     return end - start;
 }
 
-const char* page_type_name(page_type_t type) {
-    switch (type) {
-        case PAGE_TYPE_NORMAL: return "normal_4KB";
-        case PAGE_TYPE_HUGE_2MB: return "huge_2MB";
-        case PAGE_TYPE_TRANSPARENT_HUGE: return "transparent_huge";
-        default: return "unknown";
-    }
-}
-
-void run_experiment(FILE *csv) {
+void run_experiment(results_t *csv, perf_event_list_t *events) {
     // Test different working set sizes
     size_t sizes[] = {
         4 * 1024 * 1024,   // 4 MB
@@ -130,14 +85,9 @@ void run_experiment(FILE *csv) {
         256 * 1024 * 1024, // 256 MB
     };
     
-    page_type_t page_types[] = {
-        PAGE_TYPE_NORMAL,
-        PAGE_TYPE_TRANSPARENT_HUGE,
-        PAGE_TYPE_HUGE_2MB
-    };
-    
+    lrc_pages_t page_types[LRC_PAGES_MAX];
     int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
-    int num_types = sizeof(page_types) / sizeof(page_types[0]);
+    int num_types = lrc_pages_from_env(page_types, "4k,thp,2m");
     int run = 0;
     
     for (int s = 0; s < num_sizes; s++) {
@@ -146,61 +96,72 @@ void run_experiment(FILE *csv) {
         printf("Testing %zu MB working set...\n", size / (1024 * 1024));
         
         for (int t = 0; t < num_types; t++) {
-            page_type_t page_type = page_types[t];
+            lrc_alloc_opts_t opts = { -1, page_types[t], 0 };
+            const char *page_name = lrc_pages_name(page_types[t]);
             
             // Allocate memory
-            char *buffer = allocate_memory(size, page_type);
-            if (buffer == MAP_FAILED) {
-                fprintf(stderr, "Failed to allocate %zu MB with %s\n",
-                       size / (1024 * 1024), page_type_name(page_type));
+            char *buffer = lrc_alloc(size, &opts);
+            if (!buffer) {
+                fprintf(stderr, "Skipping %zu MB with %s pages: %s\n",
+                       size / (1024 * 1024), page_name, strerror(errno));
                 continue;
             }
             
             // Touch all memory to ensure allocation
             memset(buffer, 0xAA, size);
+            double huge = lrc_alloc_huge_fraction(buffer, size);
             
             // Warm up
             measure_memory_access(buffer, size);
             
             // Actual measurement
             uint64_t start_ts = get_time_ns();
+            perf_event_list_start(events);
             uint64_t runtime = measure_memory_access(buffer, size);
+            perf_event_list_stop(events);
             
             double ns_per_access = (double)runtime / ITERATIONS;
             
-            fprintf(csv, "%d,%s_%zuMB,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-                   run++,
-                   page_type_name(page_type),
-                   size / (1024 * 1024),
-                   start_ts,
-                   runtime,
-                   ns_per_access);
+            results_u64(csv, run++);
+            results_strf(csv, "%s_%zuMB", page_name, size / (1024 * 1024));
+            results_runtime(csv, start_ts, runtime);
+            results_f64(csv, ns_per_access);
+            results_str(csv, page_name);
+            results_f64(csv, huge);
+            results_events(csv, events);
             
-            munmap(buffer, size);
+            lrc_free(buffer, size, page_types[t]);
         }
     }
 }
 
 int main(void) {
-    FILE *csv = fopen("data/huge_pages.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    results_t csv;
+    if (results_open(&csv, "data/huge_pages.csv", 64) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "ns_per_access\n");
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "ns_per_access", RESULT_F64, 2);
+    results_add_column(&csv, "page_size", RESULT_STR, 0);
+    results_add_column(&csv, "huge_fraction", RESULT_F64, 3);
+    
+    perf_event_list_t events;
+    perf_event_list_from_env(&events, HUGE_PAGES_PERF_EVENTS, 1);
+    results_add_event_columns(&csv, &events);
     
     printf("Huge Pages vs Normal Pages Benchmark\n");
     printf("====================================\n\n");
     printf("Comparing 4KB pages vs 2MB huge pages...\n");
     printf("Iterations per test: %d\n\n", ITERATIONS);
     
-    run_experiment(csv);
+    run_experiment(&csv, &events);
     
-    fclose(csv);
+    perf_event_list_close(&events);
+    if (results_close(&csv) != 0) return 1;
     
     printf("\nResults saved to data/huge_pages.csv\n");
     printf("\nExpected patterns:\n");
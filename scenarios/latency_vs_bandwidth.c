@@ -16,12 +16,26 @@
  * Variables:
  *   - Access pattern (sequential vs random)
  *   - Buffer size (controlled)
+ *   - Page size (controlled, LRC_PAGE_SIZES, default 4k,thp): random
+ *     DRAM hops on 4 KB pages also pay for a page walk
  *
  * Expected outcome:
  *   - Sequential: scales with buffer size (bandwidth-limited)
  *   - Random: much slower, less sensitive to size (latency-limited)
  *   - Random/Sequential ratio: 10-50x at DRAM sizes
  *
+ * Measurement:
+ *   Uses METRICS_MODE_FAST so the 8KB case is not dominated by /proc
+ *   parsing. The calibrated boundary overhead is written per row
+ *   (overhead_ns) so it can be subtracted from runtime_ns.
+ *   The pointer chain is built once per buffer size (chase_build) after
+ *   the sequential runs; only the hops (chase_run) are timed.
+ *
+ * Timeline mode:
+ *   LRC_TIMELINE_US=<interval> samples counters every <interval> us
+ *   during each run into ../data/latency_vs_bandwidth_timeline.csv
+ *   (one series per run) for within-run analysis with timeseries.py.
+ *
  * Limitations:
  *   - Hardware prefetcher helps sequential but not random
  *   - TLB effects at large sizes
@@ -32,17 +46,27 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
+#include <unistd.h>
 #include "../core/metrics.h"
+#include "../core/perf_counters.h"
+#include "../core/sampler.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/lrc_alloc.h"
+#include "../core/workloads_api.h"
 
 extern uint64_t memory_stream_read(const uint64_t *buffer, size_t size);
-extern uint64_t memory_random_chase(uint64_t *buffer, size_t size, uint64_t iterations);
 extern int pin_to_cpu(int cpu);
 
 #define KB (1024ULL)
 #define MB (1024ULL * KB)
-#define RUNS 10
+#define MIN_RUNS 5
+#define MAX_RUNS 30
 #define RANDOM_ITERATIONS 100000ULL
+#define TIMELINE_PERF_EVENTS "instructions,cycles"
+#define TIMELINE_CAPACITY 65536
 
 static const size_t buffer_sizes[] = {
     8 * KB,      // L1
@@ -58,66 +82,168 @@ static const char *size_names[] = {
     "64MB_DRAM"
 };
 
+static int timeline_enabled = 0;
+static results_t timeline_out;
+static perf_event_list_t timeline_events;
+static sampler_t timeline;
+
+/*
+ * Enable the sampler when LRC_TIMELINE_US is set.
+ * Sampler thread goes to CPU 1 so it does not preempt the workload.
+ */
+static void timeline_init(void) {
+    const char *env = getenv("LRC_TIMELINE_US");
+    if (!env || atoi(env) <= 0) return;
+    
+    if (results_open(&timeline_out, "../data/latency_vs_bandwidth_timeline.csv",
+                     TIMELINE_CAPACITY) != 0) {
+        perror("results_open timeline");
+        return;
+    }
+    timeline_enabled = 1;
+    
+    perf_event_list_from_env(&timeline_events, TIMELINE_PERF_EVENTS, 1);
+    perf_event_list_start(&timeline_events);
+    
+    int sampler_cpu = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 1 : -1;
+    sampler_init(&timeline, &timeline_events, atoi(env), TIMELINE_CAPACITY, sampler_cpu);
+    sampler_add_columns(&timeline_out, &timeline);
+    
+    printf("Timeline sampling every %dus -> ../data/latency_vs_bandwidth_timeline.csv\n", atoi(env));
+}
+
+static void timeline_begin(void) {
+    if (timeline_enabled) sampler_start(&timeline);
+}
+
+static void timeline_end(const char *name, const char *pages, const char *pattern, int run) {
+    if (!timeline_enabled) return;
+    
+    char series[80];
+    sampler_stop(&timeline);
+    if (run < 0) return;                       // Warmup run, not recorded
+    snprintf(series, sizeof(series), "%s_%s_%s_run%d", name, pages, pattern, run);
+    sampler_record(&timeline_out, &timeline, series);
+}
+
+static void timeline_close(void) {
+    if (!timeline_enabled) return;
+    
+    sampler_destroy(&timeline);
+    perf_event_list_close(&timeline_events);
+    results_close(&timeline_out);
+}
+
 int main(void) {
     workload_metrics_t metrics;
-    FILE *out = fopen("../data/latency_vs_bandwidth.csv", "w");
+    run_control_t rc;
+    results_t out;
+    size_t num_sizes = sizeof(buffer_sizes) / sizeof(buffer_sizes[0]);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
     
-    if (!out) {
-        perror("fopen");
+    if (results_open(&out, "../data/latency_vs_bandwidth.csv",
+                     num_pages * num_sizes * 2 * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
     pin_to_cpu(0);
+    timeline_init();
+    
+    metrics_set_mode(METRICS_MODE_FAST);
+    uint64_t overhead_ns = metrics_calibrate_overhead(MAX_RUNS * 10);
     
-    fprintf(out, "run,buffer_size,access_pattern,");
-    metrics_print_csv_header(out);
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "buffer_size", RESULT_STR, 0);
+    results_add_column(&out, "access_pattern", RESULT_STR, 0);
+    results_add_column(&out, "page_size", RESULT_STR, 0);
+    results_add_column(&out, "huge_fraction", RESULT_F64, 3);
+    results_add_column(&out, "overhead_ns", RESULT_U64, 0);
+    results_add_metrics_columns(&out);
     
     printf("Running latency vs bandwidth experiment...\n");
-    printf("This compares sequential (bandwidth) vs random (latency) access.\n\n");
+    printf("This compares sequential (bandwidth) vs random (latency) access.\n");
+    printf("Measurement overhead: %luns per run (subtract from runtime_ns)\n\n", overhead_ns);
     
-    for (size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++) {
-        size_t size = buffer_sizes[i];
-        const char *name = size_names[i];
-        
-        uint64_t *buffer = malloc(size);
-        if (!buffer) {
-            fprintf(stderr, "Failed to allocate %zu bytes\n", size);
-            continue;
-        }
-        
-        memset(buffer, 0x42, size);
-        
-        printf("Testing %s (%zu bytes)...\n", name, size);
+    for (int p = 0; p < num_pages; p++) {
+        lrc_alloc_opts_t opts = { -1, pages[p], 0 };
+        const char *page_name = lrc_pages_name(pages[p]);
         
-        // Sequential access (bandwidth-bound)
-        printf("  Sequential access...\n");
-        for (int run = 0; run < RUNS; run++) {
-            fprintf(out, "%d,%s,sequential,", run, name);
-            metrics_init(&metrics);
-            uint64_t result = memory_stream_read(buffer, size);
-            metrics_finish(&metrics);
-            metrics_print_csv(out, &metrics);
+        for (size_t i = 0; i < num_sizes; i++) {
+            size_t size = buffer_sizes[i];
+            const char *name = size_names[i];
             
-            (void)result;
-        }
-        
-        // Random access (latency-bound)
-        printf("  Random access (pointer-chasing)...\n");
-        for (int run = 0; run < RUNS; run++) {
-            fprintf(out, "%d,%s,random,", run, name);
-            metrics_init(&metrics);
-            uint64_t result = memory_random_chase(buffer, size, RANDOM_ITERATIONS);
-            metrics_finish(&metrics);
-            metrics_print_csv(out, &metrics);
+            uint64_t *buffer = lrc_alloc(size, &opts);
+            if (!buffer) {
+                fprintf(stderr, "Skipping %s with %s pages: %s\n",
+                        name, page_name, strerror(errno));
+                continue;
+            }
+            
+            memset(buffer, 0x42, size);
+            double huge = lrc_alloc_huge_fraction(buffer, size);
+            
+            printf("Testing %s (%zu bytes, %s pages)...\n", name, size, page_name);
             
-            (void)result;
+            // Sequential access (bandwidth-bound)
+            printf("  Sequential access...\n");
+            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+            while (run_control_next(&rc)) {
+                timeline_begin();
+                metrics_init(&metrics);
+                uint64_t result = memory_stream_read(buffer, size);
+                metrics_finish(&metrics);
+                int measured = run_control_add(&rc, metrics.runtime_ns);
+                timeline_end(name, page_name, "sequential", measured ? run_control_index(&rc) : -1);
+                (void)result;
+                if (!measured) continue;   // Warmup
+                
+                results_u64(&out, run_control_index(&rc));
+                results_str(&out, name);
+                results_str(&out, "sequential");
+                results_str(&out, page_name);
+                results_f64(&out, huge);
+                results_u64(&out, overhead_ns);
+                results_metrics(&out, &metrics);
+            }
+            
+            // Random access (latency-bound): chain built outside the timed region
+            printf("  Random access (pointer-chasing)...\n");
+            chase_t chain;
+            if (chase_build(&chain, buffer, size, CHASE_SATTOLO, (uint64_t)i + 1) != 0) {
+                fprintf(stderr, "Failed to build pointer chain for %s\n", name);
+                lrc_free(buffer, size, pages[p]);
+                continue;
+            }
+            
+            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+            while (run_control_next(&rc)) {
+                timeline_begin();
+                metrics_init(&metrics);
+                uint64_t result = chase_run(&chain, RANDOM_ITERATIONS);
+                metrics_finish(&metrics);
+                int measured = run_control_add(&rc, metrics.runtime_ns);
+                timeline_end(name, page_name, "random", measured ? run_control_index(&rc) : -1);
+                (void)result;
+                if (!measured) continue;   // Warmup
+                
+                results_u64(&out, run_control_index(&rc));
+                results_str(&out, name);
+                results_str(&out, "random");
+                results_str(&out, page_name);
+                results_f64(&out, huge);
+                results_u64(&out, overhead_ns);
+                results_metrics(&out, &metrics);
+            }
+            
+            lrc_free(buffer, size, pages[p]);
+            printf("\n");
         }
-        
-        free(buffer);
-        printf("\n");
     }
     
-    fclose(out);
+    timeline_close();
+    if (results_close(&out) != 0) return 1;
     printf("Results saved to ../data/latency_vs_bandwidth.csv\n");
     printf("\nAnalyze with:\n");
     printf("  python3 ../analyze/parse.py ../data/latency_vs_bandwidth.csv\n");
@@ -0,0 +1,388 @@
+/*
+ * Loaded Latency Benchmark
+ *
+ * Measures memory latency while other cores generate bandwidth load
+ * (the "loaded latency" curve of Intel MLC). One pinned probe thread
+ * follows a random cache-line pointer chain; N generator threads stream
+ * through their own buffers with a configurable delay injected after
+ * each cache line. Sweeping the delay from large (light load) to 0
+ * (saturation) traces latency as a function of achieved bandwidth.
+ *
+ * Expected Results:
+ * - Idle (no generators): 80-120ns local DRAM, +30-60% remote
+ * - Light load: latency flat while bandwidth rises
+ * - Near saturation: latency climbs steeply ("hockey stick"),
+ *   typically 2-5x idle latency at 80-90% of peak bandwidth
+ * - Remote node: curve starts higher and bends earlier (interconnect)
+ *
+ * What This Tests:
+ * - Queueing delay in the memory controller under load
+ * - Usable bandwidth before latency degrades
+ * - Local vs remote (lrc_alloc bound to a node) loaded behavior
+ *
+ * Placement:
+ *   Probe and generators are workers of one pinned thread_pool_t (probe
+ *   = worker 0), created once. The probe runs on the first allowed CPU;
+ *   generators fill the probe's node first, then the other nodes. Local
+ *   memory is the probe's node, remote the next node domain of
+ *   core/topology.h (skipped on single-node hosts).
+ *
+ * Configuration (environment):
+ *   LRC_LOADED_THREADS  generator threads (default: online CPUs - 1)
+ *   LRC_LOADED_DELAYS   comma-separated injection delays in spin
+ *                       iterations per cache line (default below)
+ *   LRC_PAGE_SIZES      probe and generator buffer pages (default 4k,thp)
+ *
+ * Output: ../data/loaded_latency.csv, one row per (node, pages, delay, run).
+ * Bandwidth is measured over the probe window only, so ramp-up and
+ * tear-down of the generators are excluded.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/lrc_alloc.h"
+#include "../core/thread_pool.h"
+#include "../core/topology.h"
+#include "../core/workloads_api.h"
+
+#define PROBE_BUFFER_SIZE (256 * 1024 * 1024)    // Well beyond LLC
+#define GENERATOR_BUFFER_SIZE (64 * 1024 * 1024) // Per generator thread
+#define PROBE_HOPS 1000000ULL
+#define MIN_RUNS 3
+#define MAX_RUNS 10
+#define MAX_GENERATORS 64
+#define MAX_DELAYS 32
+#define CACHE_LINE 64
+
+static const int default_delays[] = {
+    20000, 5000, 2000, 1000, 500, 200, 100, 50, 20, 0
+};
+
+typedef struct {
+    int delay;
+    char *buffer;
+    size_t size;
+    volatile int *stop;
+    // Published by the generator, read by the probe (own cache line)
+    uint64_t bytes __attribute__((aligned(CACHE_LINE)));
+} generator_t;
+
+/* One curve point, shared by the probe (worker 0) and generators */
+typedef struct {
+    const chase_t *chain;
+    generator_t *gens;
+    int num_gens;
+    volatile int stop;
+    uint64_t bytes_start;
+    uint64_t bytes_end;
+    workload_metrics_t *metrics;
+} point_t;
+
+static thread_pool_t pool;   // Probe + generators, pinned once
+
+/*
+ * Sequential read generator with injected delay per cache line.
+ * Publishes its byte count once per 4KB so the probe can sample it.
+ */
+static void generator_run(generator_t *g) {
+    uint64_t sum = 0;
+    uint64_t bytes = 0;
+    
+    while (!__atomic_load_n(g->stop, __ATOMIC_RELAXED)) {
+        for (size_t i = 0; i < g->size; i += CACHE_LINE) {
+            sum += g->buffer[i];
+            
+            for (int d = 0; d < g->delay; d++) {
+                __asm__ __volatile__("" ::: "memory");
+            }
+            
+            if ((i & 4095) == 0) {
+                bytes += 4096;
+                __atomic_store_n(&g->bytes, bytes, __ATOMIC_RELAXED);
+                if (__atomic_load_n(g->stop, __ATOMIC_RELAXED)) break;
+            }
+        }
+    }
+    
+    // Prevent optimization
+    if (sum == 0xDEADBEEF) printf("!");
+}
+
+static uint64_t total_bytes(generator_t *gens, int count) {
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += __atomic_load_n(&gens[i].bytes, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/*
+ * Probe: let generators reach steady state, then time the chase and
+ * stop them. Generators stream until the probe is done.
+ */
+static void point_worker(int id, void *arg) {
+    point_t *pt = arg;
+    
+    if (id > 0) {
+        generator_run(&pt->gens[id - 1]);
+        return;
+    }
+    
+    if (pt->num_gens > 0) usleep(20000);
+    
+    pt->bytes_start = total_bytes(pt->gens, pt->num_gens);
+    metrics_init(pt->metrics);
+    uint64_t result = chase_run(pt->chain, PROBE_HOPS);
+    metrics_finish(pt->metrics);
+    pt->bytes_end = total_bytes(pt->gens, pt->num_gens);
+    
+    __atomic_store_n(&pt->stop, 1, __ATOMIC_RELAXED);
+    (void)result;
+}
+
+/*
+ * CPUs for probe and generators: the probe's node first (generators
+ * share its socket), then the CPUs of every other node.
+ * Returns the number of CPUs written; *probe_node is the probe's domain.
+ */
+static int select_cpus(const topology_t *topo, int *cpus, int max, int *probe_node) {
+    *probe_node = topo->cpus[0].domain[TOPO_LEVEL_NODE];
+    int count = topology_domain_cpus(topo, TOPO_LEVEL_NODE, *probe_node, cpus, max);
+    if (count > max) count = max;
+    
+    for (int i = 0; i < topo->num_cpus && count < max; i++) {
+        if (topo->cpus[i].domain[TOPO_LEVEL_NODE] != *probe_node) cpus[count++] = topo->cpus[i].cpu;
+    }
+    return count;
+}
+
+static int parse_delays(int *delays) {
+    const char *env = getenv("LRC_LOADED_DELAYS");
+    int count = 0;
+    
+    if (!env || !*env) {
+        count = sizeof(default_delays) / sizeof(default_delays[0]);
+        memcpy(delays, default_delays, sizeof(default_delays));
+        return count;
+    }
+    
+    char *copy = strdup(env);
+    for (char *tok = strtok(copy, ","); tok && count < MAX_DELAYS; tok = strtok(NULL, ",")) {
+        delays[count++] = atoi(tok);
+    }
+    free(copy);
+    return count;
+}
+
+/*
+ * One point of the curve: release probe and generators (if any) from
+ * the pool barrier; the probe stops the generators when it is done.
+ * Returns latency per hop in ns, or -1 if the pool failed to run.
+ */
+static double measure_point(const chase_t *chain, generator_t *gens, int num_gens,
+                            int delay, uint64_t overhead_ns,
+                            workload_metrics_t *metrics, double *bandwidth_mbps) {
+    point_t pt = { chain, gens, num_gens, 0, 0, 0, metrics };
+    
+    for (int i = 0; i < num_gens; i++) {
+        gens[i].delay = delay;
+        gens[i].stop = &pt.stop;
+        gens[i].bytes = 0;
+    }
+    
+    if (thread_pool_run(&pool, 1 + num_gens, NULL, point_worker, &pt) != 0) return -1.0;
+    
+    uint64_t runtime = metrics->runtime_ns > overhead_ns ?
+                       metrics->runtime_ns - overhead_ns : metrics->runtime_ns;
+    
+    // Probe traffic (one line per hop) is included in the bandwidth
+    uint64_t bytes = pt.bytes_end - pt.bytes_start + PROBE_HOPS * CACHE_LINE;
+    *bandwidth_mbps = runtime ? (double)bytes * 1000.0 / runtime : 0.0;
+    
+    return (double)runtime / PROBE_HOPS;
+}
+
+/*
+ * Returns 0, or -1 if the pool failed (rows for the failed point are
+ * not written).
+ */
+static int run_node(results_t *csv, const char *label, int node, lrc_pages_t pages,
+                    int num_gens, const int *delays, int num_delays, uint64_t overhead_ns) {
+    workload_metrics_t metrics;
+    generator_t gens[MAX_GENERATORS];
+    chase_t chain;
+    lrc_alloc_opts_t opts = { node, pages, 0 };
+    const char *page_name = lrc_pages_name(pages);
+    
+    char *probe = lrc_alloc(PROBE_BUFFER_SIZE, &opts);
+    if (!probe) {
+        fprintf(stderr, "Skipping node %d with %s pages: %s\n", node, page_name, strerror(errno));
+        return 0;
+    }
+    chase_build(&chain, (uint64_t *)probe, PROBE_BUFFER_SIZE, CHASE_SATTOLO | CHASE_LINE, 1);
+    double huge = lrc_alloc_huge_fraction(probe, PROBE_BUFFER_SIZE);
+    
+    int allocated = 0;
+    for (int i = 0; i < num_gens; i++) {
+        memset(&gens[i], 0, sizeof(generator_t));
+        gens[i].size = GENERATOR_BUFFER_SIZE;
+        gens[i].buffer = lrc_alloc(GENERATOR_BUFFER_SIZE, &opts);
+        if (!gens[i].buffer) break;
+        memset(gens[i].buffer, 0x42, GENERATOR_BUFFER_SIZE);
+        allocated++;
+    }
+    
+    printf("\n%s memory (node %d, %s pages), %d generator threads:\n",
+           label, node, page_name, allocated);
+    printf("  %-10s %14s %14s\n", "Delay", "Bandwidth", "Latency");
+    
+    // Idle latency first (delay -1 = no generators), then the load sweep
+    int status = 0;
+    for (int d = -1; d < num_delays && status == 0; d++) {
+        int delay = d < 0 ? -1 : delays[d];
+        int active = d < 0 ? 0 : allocated;
+        double sum_bw = 0.0, sum_lat = 0.0;
+        run_control_t rc;
+        
+        run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+        while (run_control_next(&rc)) {
+            double bw;
+            double lat = measure_point(&chain, gens, active, delay < 0 ? 0 : delay,
+                                       overhead_ns, &metrics, &bw);
+            if (lat < 0) {
+                fprintf(stderr, "thread_pool_run failed, stopping %s sweep\n", label);
+                status = -1;
+                break;
+            }
+            if (!run_control_add(&rc, lat)) continue;   // Warmup
+            
+            results_str(csv, label);
+            results_i64(csv, node);
+            results_str(csv, page_name);
+            results_f64(csv, huge);
+            results_i64(csv, active);
+            results_i64(csv, delay);
+            results_u64(csv, run_control_index(&rc));
+            results_f64(csv, bw);
+            results_f64(csv, lat);
+            results_u64(csv, overhead_ns);
+            results_metrics(csv, &metrics);
+            
+            sum_bw += bw;
+            sum_lat += lat;
+        }
+        
+        if (rc.runs == 0) continue;
+        if (delay < 0) {
+            printf("  %-10s %11.0f MB/s %11.1f ns\n", "idle", sum_bw / rc.runs, sum_lat / rc.runs);
+        } else {
+            printf("  %-10d %11.0f MB/s %11.1f ns\n", delay, sum_bw / rc.runs, sum_lat / rc.runs);
+        }
+    }
+    
+    for (int i = 0; i < allocated; i++) {
+        lrc_free(gens[i].buffer, GENERATOR_BUFFER_SIZE, pages);
+    }
+    lrc_free(probe, PROBE_BUFFER_SIZE, pages);
+    return status;
+}
+
+int main(void) {
+    int cpus[MAX_GENERATORS + 1];
+    int delays[MAX_DELAYS];
+    topology_t topo;
+    int probe_node;
+    
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "topology_init failed\n");
+        return 1;
+    }
+    int num_cpus = select_cpus(&topo, cpus, MAX_GENERATORS + 1, &probe_node);
+    int num_nodes = topo.num_domains[TOPO_LEVEL_NODE];
+    int local_node = topology_node_id(&topo, probe_node);
+    int remote_node = topology_node_id(&topo, (probe_node + 1) % num_nodes);
+    int num_delays = parse_delays(delays);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
+    
+    int num_gens = num_cpus - 1;
+    const char *env = getenv("LRC_LOADED_THREADS");
+    if (env) num_gens = atoi(env);
+    if (num_gens < 0) num_gens = 0;
+    if (num_gens > MAX_GENERATORS) num_gens = MAX_GENERATORS;
+    
+    // More generators than spare CPUs: wrap around (shares cores with probe)
+    for (int i = num_cpus; i < num_gens + 1; i++) {
+        cpus[i] = cpus[i % num_cpus];
+    }
+    
+    results_t csv;
+    if (results_open(&csv, "../data/loaded_latency.csv",
+                     2 * num_pages * (num_delays + 1) * MAX_RUNS) != 0) {
+        perror("results_open");
+        topology_destroy(&topo);
+        return 1;
+    }
+    
+    if (thread_pool_create(&pool, 1 + num_gens, cpus) != 0) {
+        fprintf(stderr, "thread_pool_create failed\n");
+        results_close(&csv);
+        topology_destroy(&topo);
+        return 1;
+    }
+    
+    // Overhead calibration on the probe CPU
+    topology_pin_thread(pthread_self(), cpus[0]);
+    metrics_set_mode(METRICS_MODE_FAST);
+    uint64_t overhead_ns = metrics_calibrate_overhead(MAX_RUNS * 10);
+    
+    results_add_column(&csv, "node_label", RESULT_STR, 0);
+    results_add_column(&csv, "node", RESULT_I64, 0);
+    results_add_column(&csv, "page_size", RESULT_STR, 0);
+    results_add_column(&csv, "huge_fraction", RESULT_F64, 3);
+    results_add_column(&csv, "generators", RESULT_I64, 0);
+    results_add_column(&csv, "delay", RESULT_I64, 0);
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "bandwidth_mbps", RESULT_F64, 1);
+    results_add_column(&csv, "latency_ns", RESULT_F64, 2);
+    results_add_column(&csv, "overhead_ns", RESULT_U64, 0);
+    results_add_metrics_columns(&csv);
+    
+    printf("Loaded Latency Benchmark\n");
+    printf("========================\n");
+    printf("Probe on CPU %d, %d generators, %d delay points, %d-%d runs each\n",
+           cpus[0], num_gens, num_delays, MIN_RUNS, MAX_RUNS);
+    if (num_cpus < 2) {
+        printf("⚠ Single CPU: generators time-share with the probe, curve is not meaningful\n");
+    }
+    
+    int status = 0;
+    for (int p = 0; p < num_pages && status == 0; p++) {
+        status = run_node(&csv, "local", local_node, pages[p], num_gens, delays, num_delays,
+                          overhead_ns);
+        
+        if (status == 0 && num_nodes > 1) {
+            status = run_node(&csv, "remote", remote_node, pages[p], num_gens, delays,
+                              num_delays, overhead_ns);
+        }
+    }
+    if (num_nodes < 2) {
+        printf("\nSingle NUMA node: skipping remote curve\n");
+    }
+    
+    thread_pool_destroy(&pool);
+    topology_destroy(&topo);
+    if (results_close(&csv) != 0 || status != 0) return 1;
+    printf("\nResults saved to ../data/loaded_latency.csv\n");
+    printf("Plot latency_ns against bandwidth_mbps per node_label for the curve.\n");
+    
+    return 0;
+}
@@ -6,31 +6,52 @@
  *   Spinlocks: good for low contention, terrible for high contention.
  *   Mutexes: better for high contention (scheduler helps).
  *   Atomics: best scalability (lock-free).
+ *   Queue locks (MCS, CLH, qspinlock): flat handoff cost, because each
+ *   waiter spins on its own cache line instead of the shared lock word.
  *
  * Method:
- *   Run same workload with 1, 2, 4, 8 threads:
- *   1. Spinlock contention
- *   2. Mutex contention
- *   3. Atomic operations
- *   
- *   Measure total runtime and throughput.
+ *   Run same workload (increment one shared counter) with 1, 2, 4, ...
+ *   up to all allowed CPUs, for every lock in the lock zoo:
+ *   spinlock, mutex, atomic, ticket, MCS, CLH, qspinlock,
+ *   spin-then-futex mutex, flat-combining counter.
+ *
+ *   Each lock user follows a profile (LRC_LOCK_PROFILES, comma-separated
+ *   "cs_ns:think_ns:cs_lines"): calibrated cpu_spin() work inside the
+ *   lock, think time between acquisitions, and shared cache lines
+ *   written under the lock. Default profiles: the original single
+ *   increment (0:0:0), a short handler section (100:1000:2) and a
+ *   half-serial one (1000:1000:8).
+ *
+ *   Measure total runtime and throughput, plus acquire latency
+ *   percentiles (1 in LOCK_SAMPLE_INTERVAL acquires timed). Workers come
+ *   from one persistent pinned pool created up front, so thread creation
+ *   is never timed; runtime is first barrier release to last finish.
  *
  * Variables:
- *   - Thread count (1, 2, 4, 8)
- *   - Lock type (spinlock, mutex, atomic)
- *   - Work per thread (fixed)
+ *   - Thread count (1, 2, 4, ... nproc; placement via LRC_PLACEMENT)
+ *   - Lock type (lock_type_t)
+ *   - Critical section / think time / shared lines (profile)
+ *   - Work per thread (fixed count, capped by a time budget per run)
  *
  * Expected outcome:
- *   - 1 thread: All similar (no contention)
- *   - 2-4 threads: Spinlock starts degrading
- *   - 8 threads: Spinlock terrible, mutex better, atomic best
- *   - Throughput: Atomic scales linearly, locks don't
+ *   - 1 thread: All similar (no contention), futex/mutex slightly slower
+ *   - 2-4 threads: Spinlock and ticket start degrading
+ *   - Many threads: ticket collapses (every release invalidates all
+ *     waiters), MCS/CLH/qspinlock stay flat, flat combining gives the
+ *     highest throughput for the counter, futex trades throughput for
+ *     long tail latency (sleep/wake)
+ *   - Throughput: Atomic scales best of the lock-free options
+ *   - With think time: speedup follows Amdahl, bounded by
+ *     (cs_ns + think_ns) / cs_ns; the lock's handoff cost adds to the
+ *     serial part, which is where queue locks pull ahead
  *
  * Limitations:
  *   - Synthetic workload (trivial critical section)
  *   - Does not test different contention patterns
  *   - CPU topology matters (SMT vs physical cores)
- *   - Does not measure fairness
+ *   - FIFO spin locks are pathological when oversubscribed; thread
+ *     counts never exceed the allowed CPUs
+ *   - Latency samples include the timer read (~10-20 cycles with TSC)
  */
 
 #define _GNU_SOURCE
@@ -38,78 +59,170 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <pthread.h>
-
-// Import from lock_contention.c
-extern void lock_workload_init(void* work, int threads, int iterations);
-extern void lock_workload_cleanup(void* work);
-extern uint64_t run_lock_test(void* work, void* (*worker_func)(void*), int pin_threads);
-extern void* spinlock_worker(void* arg);
-extern void* mutex_worker(void* arg);
-extern void* atomic_worker(void* arg);
-
-// Use opaque pointer for lock_workload_t
-typedef void* lock_workload_ptr;
+#include "../core/workloads_api.h"
+#include "../core/thread_pool.h"
+#include "../core/topology.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
 
 #define ITERATIONS_PER_THREAD 1000000
-#define RUNS 5
+#define RUN_BUDGET_NS 100000000ULL     // Caps iterations for slow profiles (uncontended)
+#define MIN_RUNS 5
+#define MAX_RUNS 20
 
-int main(void) {
-    FILE *out = fopen("../data/lock_scaling.csv", "w");
-    if (!out) {
-        perror("fopen");
-        return 1;
-    }
-    
-    fprintf(out, "run,threads,lock_type,runtime_ns,ops_per_sec\n");
-    
-    printf("Running lock scaling experiment...\n");
-    printf("Testing spinlock, mutex, and atomic operations.\n\n");
+static const lock_params_t default_profiles[] = {
+    { 0, 0, 0 },          // Original: single counter increment
+    { 100, 1000, 2 },     // Short handler section, ~9% serial
+    { 1000, 1000, 8 },    // Half serial, 8 shared lines
+};
+
+/*
+ * One profile: every lock type at every thread count.
+ */
+static void run_profile(results_t *out, thread_pool_t *pool, const char *placement_name,
+                        const lock_params_t *prof, const int *thread_counts, int num_counts) {
+    // Approximate per-op cost without contention, to bound run time
+    uint64_t op_ns = prof->cs_ns + prof->think_ns + 20;
+    uint64_t iterations = RUN_BUDGET_NS / op_ns;
+    if (iterations > ITERATIONS_PER_THREAD) iterations = ITERATIONS_PER_THREAD;
     
-    int thread_counts[] = {1, 2, 4, 8};
+    printf("Profile cs=%luns think=%luns lines=%d", prof->cs_ns, prof->think_ns, prof->cs_lines);
+    if (prof->cs_ns > 0) {
+        printf(" (Amdahl limit %.1fx)", (double)(prof->cs_ns + prof->think_ns) / prof->cs_ns);
+    }
+    printf(", %lu iterations per thread\n", iterations);
     
-    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+    for (int t = 0; t < num_counts; t++) {
         int threads = thread_counts[t];
         
         printf("Testing with %d thread(s)...\n", threads);
+        printf("  %-16s %14s %10s %10s %10s\n", "lock", "ops/sec", "p50 ns", "p99 ns", "max ns");
         
-        for (int run = 0; run < RUNS; run++) {
-            char work_buf[256];  // Opaque buffer for lock_workload_t
-            
-            // Spinlock test
-            lock_workload_init(work_buf, threads, ITERATIONS_PER_THREAD);
-            uint64_t spinlock_ns = run_lock_test(work_buf, spinlock_worker, 0);
-            uint64_t total_ops = (uint64_t)threads * ITERATIONS_PER_THREAD;
-            double ops_per_sec = (double)total_ops / (spinlock_ns / 1e9);
-            fprintf(out, "%d,%d,spinlock,%lu,%.0f\n", run, threads, spinlock_ns, ops_per_sec);
-            lock_workload_cleanup(work_buf);
+        for (int type = 0; type < LOCK_TYPE_COUNT; type++) {
+            lock_result_t result;
+            double sum_ops = 0.0;
+            uint64_t p50 = 0, p99 = 0, max = 0;
+            run_control_t rc;
             
-            // Mutex test
-            lock_workload_init(work_buf, threads, ITERATIONS_PER_THREAD);
-            uint64_t mutex_ns = run_lock_test(work_buf, mutex_worker, 0);
-            ops_per_sec = (double)total_ops / (mutex_ns / 1e9);
-            fprintf(out, "%d,%d,mutex,%lu,%.0f\n", run, threads, mutex_ns, ops_per_sec);
-            lock_workload_cleanup(work_buf);
+            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+            while (run_control_next(&rc)) {
+                if (lock_contention_run(pool, type, threads, iterations, prof, &result) != 0) {
+                    fprintf(stderr, "%s run failed\n", lock_type_name(type));
+                    break;
+                }
+                
+                uint64_t expected = (uint64_t)threads * iterations;
+                if (result.operations != expected) {
+                    fprintf(stderr, "%s: counter %lu, expected %lu (lock is broken)\n",
+                            lock_type_name(type), result.operations, expected);
+                }
+                
+                if (!run_control_add(&rc, result.runtime_ns)) continue;   // Warmup
+                
+                double ops_per_sec = (double)result.operations / (result.runtime_ns / 1e9);
+                results_u64(out, run_control_index(&rc));
+                results_u64(out, threads);
+                results_str(out, lock_type_name(type));
+                results_str(out, placement_name);
+                results_u64(out, prof->cs_ns);
+                results_u64(out, prof->think_ns);
+                results_u64(out, prof->cs_lines);
+                results_u64(out, iterations);
+                results_u64(out, result.runtime_ns);
+                results_f64(out, ops_per_sec);
+                results_u64(out, result.p50_ns);
+                results_u64(out, result.p90_ns);
+                results_u64(out, result.p99_ns);
+                results_u64(out, result.p999_ns);
+                results_u64(out, result.max_ns);
+                results_histogram(out, &result.latency);
+                
+                sum_ops += ops_per_sec;
+                p50 += result.p50_ns;
+                p99 += result.p99_ns;
+                if (result.max_ns > max) max = result.max_ns;
+            }
             
-            // Atomic test
-            lock_workload_init(work_buf, threads, ITERATIONS_PER_THREAD);
-            uint64_t atomic_ns = run_lock_test(work_buf, atomic_worker, 0);
-            ops_per_sec = (double)total_ops / (atomic_ns / 1e9);
-            fprintf(out, "%d,%d,atomic,%lu,%.0f\n", run, threads, atomic_ns, ops_per_sec);
-            lock_workload_cleanup(work_buf);
+            if (rc.runs == 0) continue;
+            printf("  %-16s %14.0f %10lu %10lu %10lu  (%d runs)\n", lock_type_name(type),
+                   sum_ops / rc.runs, p50 / rc.runs, p99 / rc.runs, max, rc.runs);
         }
     }
+}
+
+int main(void) {
+    topology_t topo;
+    thread_pool_t pool;
+    
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    topo_placement_t placement = topology_placement_from_env(TOPO_PLACE_COMPACT);
+    int thread_cpus[topo.num_cpus];
+    int max_threads = topology_place(&topo, placement, topo.num_cpus, thread_cpus);
+    
+    if (thread_pool_create(&pool, max_threads, thread_cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
+        return 1;
+    }
+    
+    lock_params_t profiles[LOCK_MAX_PROFILES];
+    int num_profiles = lock_params_from_env("LRC_LOCK_PROFILES", default_profiles,
+                                            sizeof(default_profiles) / sizeof(default_profiles[0]),
+                                            profiles);
+    
+    int thread_counts[32];
+    int num_counts = topology_thread_counts(max_threads, thread_counts, 32);
+    
+    results_t out;
+    if (results_open(&out, "../data/lock_scaling.csv",
+                     (size_t)num_profiles * num_counts * LOCK_TYPE_COUNT * MAX_RUNS) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "threads", RESULT_U64, 0);
+    results_add_column(&out, "lock_type", RESULT_STR, 0);
+    results_add_column(&out, "thread_placement", RESULT_STR, 0);
+    results_add_column(&out, "cs_ns", RESULT_U64, 0);
+    results_add_column(&out, "think_ns", RESULT_U64, 0);
+    results_add_column(&out, "cs_lines", RESULT_U64, 0);
+    results_add_column(&out, "iterations", RESULT_U64, 0);
+    results_add_column(&out, "runtime_ns", RESULT_U64, 0);
+    results_add_column(&out, "ops_per_sec", RESULT_F64, 0);
+    results_add_column(&out, "p50_ns", RESULT_U64, 0);
+    results_add_column(&out, "p90_ns", RESULT_U64, 0);
+    results_add_column(&out, "p99_ns", RESULT_U64, 0);
+    results_add_column(&out, "p999_ns", RESULT_U64, 0);
+    results_add_column(&out, "max_ns", RESULT_U64, 0);
+    results_add_column(&out, "latency_hist", RESULT_STR, 0);
+    
+    printf("Running lock scaling experiment...\n");
+    printf("Testing %d lock types, up to %d threads (placement: %s).\n",
+           LOCK_TYPE_COUNT, max_threads, topology_placement_name(placement));
+    printf("cpu_spin calibration: %.3f iterations/ns\n\n", cpu_spin_calibrate());
+    
+    for (int pr = 0; pr < num_profiles; pr++) {
+        run_profile(&out, &pool, topology_placement_name(placement), &profiles[pr],
+                    thread_counts, num_counts);
+        printf("\n");
+    }
     
-    fclose(out);
+    thread_pool_destroy(&pool);
+    topology_destroy(&topo);
+    if (results_close(&out) != 0) return 1;
     
     printf("\nResults saved to ../data/lock_scaling.csv\n");
     printf("\nAnalyze with:\n");
     printf("  python3 ../analyze/parse.py ../data/lock_scaling.csv\n");
     printf("  python3 ../analyze/classify.py ../data/lock_scaling.csv\n");
     printf("\nExpected results:\n");
-    printf("  1 thread:  All similar (~1s)\n");
-    printf("  2 threads: Spinlock starts degrading\n");
+    printf("  1 thread:  All similar (no contention)\n");
+    printf("  2 threads: Spinlock and ticket start degrading\n");
     printf("  4 threads: Mutex catches up\n");
-    printf("  8 threads: Atomic best, spinlock worst\n");
+    printf("  Many:      MCS/CLH/qspinlock flat, ticket worst, flat combining best throughput\n");
     
     return 0;
 }
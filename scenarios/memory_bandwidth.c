@@ -11,12 +11,52 @@
  * - Multiple threads: Linear scaling until bandwidth saturates
  * - Saturation point: ~50-100 GB/s (DDR4), ~200+ GB/s (DDR5)
  * - Random access: Much lower bandwidth due to cache misses
+ * - Non-temporal writes: up to ~1.5-2x cached writes at DRAM sizes
+ *   (no read-for-ownership of the destination line)
  *
  * What This Tests:
  * - Memory bandwidth limits
  * - Multi-channel memory scaling
  * - Sequential vs random access
  * - Copy, read, write bandwidth
+ *
+ * Kernels:
+ *   The original tests ("compiler" kernel) measure whatever the compiler
+ *   emits for plain loops. Each sequential test is repeated with the
+ *   explicit core kernels (scalar, SSE2, AVX2, AVX-512, their
+ *   non-temporal variants and rep movsb/stosb) that this CPU supports,
+ *   recorded in the kernel column. Cached vs *_nt write bandwidth
+ *   separates RFO traffic from the stores themselves.
+ *
+ * NUMA placement:
+ *   Workers are placed with the topology API (LRC_PLACEMENT, default
+ *   scatter: round-robin across packages and nodes, thread counts up to
+ *   all allowed CPUs) in a persistent pool. Workers allocate and
+ *   first-touch their own buffers before the pool's start barrier, so
+ *   setup and thread creation are outside the timed region. On
+ *   multi-node systems the original tests run under each placement
+ *   (placement column):
+ *   local, remote (next node), interleaved, and main_touch (the old
+ *   behavior: main thread touches everything, so all pages land on one
+ *   node). Explicit-kernel tests use local placement.
+ *
+ * Page sizes:
+ *   The original tests also run per LRC_PAGE_SIZES entry (default
+ *   4k,thp; page_size column), buffers come from lrc_alloc(). The
+ *   explicit-kernel tests use the first entry. Interleaved placement
+ *   keeps numa_alloc_interleaved() and runs once with default pages.
+ *
+ * Bandwidth throttling:
+ *   With resctrl MBA available (root, /sys/fs/resctrl mounted), the
+ *   sequential read is repeated at all threads with the workers in one
+ *   resctrl group throttled to each LRC_MBA_LEVELS percentage (default
+ *   100,70,50,30,10; mba column, 0 = unthrottled rows). mba_schemata
+ *   is the value written to the group's MB: line (percent on Intel, 1/8
+ *   GB/s units on AMD, after granularity rounding). mbm_gbs is the
+ *   group's MBM byte count over the timed region only (from the start
+ *   barrier to the last worker's finish, not the buffer setup), a
+ *   cross-check that the measured bandwidth is what left the memory
+ *   controller.
  */
 
 #define _GNU_SOURCE
@@ -24,19 +64,52 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
 #include <pthread.h>
 #include <sched.h>
 #include <unistd.h>
+#include "../core/numa_api.h"
+#include "../core/lrc_alloc.h"
+#include "../core/topology.h"
+#include "../core/thread_pool.h"
+#include "../core/workloads_api.h"
+#include "../core/results.h"
+#include "../core/resctrl.h"
 
 #define BUFFER_SIZE (64 * 1024 * 1024)  // 64 MB per thread
 #define ITERATIONS 5
-#define MAX_THREADS 8
+
+/*
+ * Buffer placement relative to the worker's node.
+ * PLACEMENT_MAIN reproduces the original behavior (main thread
+ * allocates and touches every buffer, so all pages land on its node).
+ */
+typedef enum {
+    PLACEMENT_LOCAL = 0,    // lrc_alloc(worker node), first touch by worker
+    PLACEMENT_REMOTE,       // lrc_alloc(next node), first touch by worker
+    PLACEMENT_INTERLEAVED,  // numa_alloc_interleaved(), first touch by worker
+    PLACEMENT_MAIN,         // lrc_alloc(unbound) + memset in main thread
+    PLACEMENT_COUNT
+} placement_t;
+
+static const char *placement_names[PLACEMENT_COUNT] = {
+    "local", "remote", "interleaved", "main_touch"
+};
+
+typedef void* (*thread_func_t)(void*);
 
 typedef struct {
     int thread_id;
+    int cpu;
+    int node;                   // Dense node domain (topology_node_id() for lrc_alloc)
+    placement_t placement;
+    lrc_pages_t pages;
     char *buffer;
+    char *temp;                 // copy destination, placed like buffer
     size_t size;
+    stream_kernel_t kernel;
+    thread_func_t func;
     uint64_t bytes_processed;
     uint64_t runtime_ns;
 } thread_arg_t;
@@ -51,12 +124,6 @@ static inline uint64_t get_time_ns(void) {
 void* sequential_read_thread(void *arg) {
     thread_arg_t *params = (thread_arg_t*)arg;
     
-    // Pin to CPU
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    
     uint64_t sum = 0;
     uint64_t start = get_time_ns();
     
@@ -80,11 +147,6 @@ void* sequential_read_thread(void *arg) {
 void* sequential_write_thread(void *arg) {
     thread_arg_t *params = (thread_arg_t*)arg;
     
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    
     uint64_t start = get_time_ns();
     
     // Write entire buffer multiple times
@@ -102,13 +164,7 @@ void* sequential_write_thread(void *arg) {
 void* sequential_copy_thread(void *arg) {
     thread_arg_t *params = (thread_arg_t*)arg;
     
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    
-    char *temp = malloc(params->size);
-    if (!temp) return NULL;
+    char *temp = params->temp;
     
     uint64_t start = get_time_ns();
     
@@ -120,7 +176,6 @@ void* sequential_copy_thread(void *arg) {
     params->runtime_ns = get_time_ns() - start;
     params->bytes_processed = params->size * 10 * 2;  // Read + Write
     
-    free(temp);
     return NULL;
 }
 
@@ -128,11 +183,6 @@ void* sequential_copy_thread(void *arg) {
 void* random_read_thread(void *arg) {
     thread_arg_t *params = (thread_arg_t*)arg;
     
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    
     uint64_t sum = 0;
     uint64_t start = get_time_ns();
     
@@ -151,42 +201,209 @@ void* random_read_thread(void *arg) {
     return NULL;
 }
 
-typedef void* (*thread_func_t)(void*);
+// Explicit-kernel variants of the sequential tests
+void* kernel_read_thread(void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg;
+    
+    uint64_t sum = 0;
+    uint64_t start = get_time_ns();
+    
+    for (int iter = 0; iter < 10; iter++) {
+        sum += memory_stream_read_kernel(params->kernel, (const uint64_t *)params->buffer, params->size);
+    }
+    
+    params->runtime_ns = get_time_ns() - start;
+    params->bytes_processed = params->size * 10;
+    
+    if (sum == 0xDEADBEEF) printf("!");
+    
+    return NULL;
+}
 
-double run_bandwidth_test(thread_func_t func, int num_threads, const char *test_name) {
-    pthread_t threads[MAX_THREADS];
-    thread_arg_t args[MAX_THREADS];
+void* kernel_write_thread(void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg;
+    
+    uint64_t start = get_time_ns();
+    
+    for (int iter = 0; iter < 10; iter++) {
+        memory_stream_write_kernel(params->kernel, (uint64_t *)params->buffer, params->size);
+    }
+    
+    params->runtime_ns = get_time_ns() - start;
+    params->bytes_processed = params->size * 10;
+    
+    return NULL;
+}
+
+void* kernel_copy_thread(void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg;
+    
+    char *temp = params->temp;
+    
+    uint64_t start = get_time_ns();
+    
+    for (int iter = 0; iter < 10; iter++) {
+        memory_stream_copy_kernel(params->kernel, (uint64_t *)temp,
+                                  (const uint64_t *)params->buffer, params->size);
+    }
+    
+    params->runtime_ns = get_time_ns() - start;
+    params->bytes_processed = params->size * 10 * 2;  // Read + Write
+    
+    return NULL;
+}
+
+// Thread placement (LRC_PLACEMENT=compact|scatter|per_l3, default scatter)
+static topology_t topo;
+static topo_placement_t thread_placement;
+static int num_nodes = 1;
+static int *worker_cpus;     // CPU for worker i, in placement order
+static int *worker_nodes;    // Dense node domain of worker_cpus[i]
+static int max_threads;
+static thread_pool_t pool;   // Pinned workers, created once for all tests
+
+/*
+ * Place workers with the topology API. Scatter (default) spreads
+ * consecutive workers across packages/nodes, so every thread count
+ * uses as many memory controllers as it can.
+ */
+static int assign_cpus(void) {
+    if (topology_init(&topo) != 0) return -1;
+    
+    thread_placement = topology_placement_from_env(TOPO_PLACE_SCATTER);
+    worker_cpus = malloc(topo.num_cpus * sizeof(int));
+    worker_nodes = malloc(topo.num_cpus * sizeof(int));
+    if (!worker_cpus || !worker_nodes) return -1;
+    
+    max_threads = topology_place(&topo, thread_placement, topo.num_cpus, worker_cpus);
+    num_nodes = topo.num_domains[TOPO_LEVEL_NODE];
+    
+    for (int i = 0; i < max_threads; i++) {
+        worker_nodes[i] = topology_cpu(&topo, worker_cpus[i])->domain[TOPO_LEVEL_NODE];
+    }
+    return 0;
+}
+
+static char *alloc_buffer(placement_t placement, int node, lrc_pages_t pages, size_t size) {
+    lrc_alloc_opts_t opts = { -1, pages, 0 };
+    
+    switch (placement) {
+        case PLACEMENT_LOCAL:
+            opts.node = topology_node_id(&topo, node);
+            return lrc_alloc(size, &opts);
+        case PLACEMENT_REMOTE:
+            opts.node = topology_node_id(&topo, (node + 1) % num_nodes);
+            return lrc_alloc(size, &opts);
+        case PLACEMENT_INTERLEAVED:
+            return numa_alloc_interleaved(size);
+        default:
+            return lrc_alloc(size, &opts);
+    }
+}
+
+static void free_buffer(placement_t placement, lrc_pages_t pages, char *buffer, size_t size) {
+    if (placement == PLACEMENT_INTERLEAVED) numa_free(buffer, size);
+    else lrc_free(buffer, size, pages);
+}
+
+// Throttled group for the MBA sweep (NULL otherwise)
+static resctrl_group_t *mba_group;
+
+// MBM window of the MBA sweep, read inside the timed region (worker_main)
+static struct {
+    resctrl_mon_t before, after;
+    uint64_t start_ns, end_ns;
+    int valid;                  // Both reads had the total-bytes counter
+    int running;                // Workers still in worker_main
+} mba_mon;
+
+/*
+ * Pool setup (untimed): allocate and first-touch from the pinned worker
+ * itself, so pages land where the placement policy says.
+ */
+static void worker_setup(int id, void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg + id;
+    
+    if (mba_group) resctrl_group_add_task(mba_group, 0);
+    if (params->placement != PLACEMENT_MAIN) {
+        params->buffer = alloc_buffer(params->placement, params->node, params->pages, params->size);
+        params->temp = alloc_buffer(params->placement, params->node, params->pages, params->size);
+        if (params->buffer) memset(params->buffer, 0xAA, params->size);
+        if (params->temp) memset(params->temp, 0, params->size);
+    }
+}
+
+// Pool task: released by the start barrier once every worker is set up
+static void worker_main(int id, void *arg) {
+    thread_arg_t *params = (thread_arg_t*)arg + id;
+    
+    // Setup's allocation and first-touch writes stay out of the MBM window
+    if (mba_group && id == 0) {
+        mba_mon.valid = resctrl_group_read(mba_group, &mba_mon.before) == 0 &&
+                        (mba_mon.before.valid & RESCTRL_MON_TOTAL);
+        mba_mon.start_ns = get_time_ns();
+    }
+    
+    if (params->buffer && params->temp) {
+        params->func(params);
+    }
+    
+    // Last worker out closes the window (worker 0 has opened it by then)
+    if (mba_group && __atomic_sub_fetch(&mba_mon.running, 1, __ATOMIC_ACQ_REL) == 0) {
+        mba_mon.end_ns = get_time_ns();
+        mba_mon.valid = mba_mon.valid && resctrl_group_read(mba_group, &mba_mon.after) == 0 &&
+                        (mba_mon.after.valid & RESCTRL_MON_TOTAL);
+    }
+}
+
+/*
+ * One row: GB/s over num_threads workers, or -1.0 (row skipped) if the
+ * pool run failed or any worker could not allocate its buffers.
+ */
+double run_bandwidth_test(thread_func_t func, int num_threads, stream_kernel_t kernel,
+                          placement_t placement, lrc_pages_t pages) {
+    thread_arg_t args[num_threads];
     
-    // Allocate buffers
     for (int i = 0; i < num_threads; i++) {
+        memset(&args[i], 0, sizeof(thread_arg_t));
         args[i].thread_id = i;
-        args[i].buffer = malloc(BUFFER_SIZE);
+        args[i].cpu = worker_cpus[i];
+        args[i].node = worker_nodes[i];
+        args[i].placement = placement;
+        args[i].pages = pages;
         args[i].size = BUFFER_SIZE;
+        args[i].kernel = kernel;
+        args[i].func = func;
         
-        if (!args[i].buffer) {
-            perror("malloc");
-            return 0.0;
+        if (placement == PLACEMENT_MAIN) {
+            args[i].buffer = alloc_buffer(placement, -1, pages, BUFFER_SIZE);
+            args[i].temp = alloc_buffer(placement, -1, pages, BUFFER_SIZE);
+            
+            if (!args[i].buffer || !args[i].temp) {
+                perror("lrc_alloc");
+                for (int j = 0; j <= i; j++) {
+                    free_buffer(placement, pages, args[j].buffer, BUFFER_SIZE);
+                    free_buffer(placement, pages, args[j].temp, BUFFER_SIZE);
+                }
+                return -1.0;
+            }
+            
+            // Initialize buffer (main thread touches every page)
+            memset(args[i].buffer, 0xAA, BUFFER_SIZE);
+            memset(args[i].temp, 0, BUFFER_SIZE);
         }
-        
-        // Initialize buffer
-        memset(args[i].buffer, 0xAA, BUFFER_SIZE);
     }
     
-    // Run threads
-    for (int i = 0; i < num_threads; i++) {
-        pthread_create(&threads[i], NULL, func, &args[i]);
-    }
-    
-    // Wait for completion
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    // Run on the persistent pool (no thread creation per test)
+    int pool_failed = thread_pool_run(&pool, num_threads, worker_setup, worker_main, args) != 0;
     
     // Calculate total bandwidth
     uint64_t total_bytes = 0;
     uint64_t max_runtime = 0;
+    int missing = 0;
     
     for (int i = 0; i < num_threads; i++) {
+        if (!args[i].buffer || !args[i].temp) missing++;
         total_bytes += args[i].bytes_processed;
         if (args[i].runtime_ns > max_runtime) {
             max_runtime = args[i].runtime_ns;
@@ -195,7 +412,19 @@ double run_bandwidth_test(thread_func_t func, int num_threads, const char *test_
     
     // Free buffers
     for (int i = 0; i < num_threads; i++) {
-        free(args[i].buffer);
+        if (args[i].buffer) free_buffer(placement, pages, args[i].buffer, BUFFER_SIZE);
+        if (args[i].temp) free_buffer(placement, pages, args[i].temp, BUFFER_SIZE);
+    }
+    
+    // A worker without buffers did no work: the row would not be N threads
+    if (pool_failed) {
+        fprintf(stderr, "thread_pool_run failed (%d threads)\n", num_threads);
+        return -1.0;
+    }
+    if (missing) {
+        fprintf(stderr, "Buffer allocation failed for %d of %d workers (%s placement, %s pages)\n",
+                missing, num_threads, placement_names[placement], lrc_pages_name(pages));
+        return -1.0;
     }
     
     // Bandwidth in GB/s
@@ -204,9 +433,87 @@ double run_bandwidth_test(thread_func_t func, int num_threads, const char *test_
     return bandwidth_gbs;
 }
 
-void run_experiment(FILE *csv) {
-    int thread_counts[] = {1, 2, 4, 8};
-    int num_counts = sizeof(thread_counts) / sizeof(thread_counts[0]);
+/*
+ * Sequential read at each MBA level, all workers in one resctrl group.
+ */
+static void run_mba_sweep(results_t *csv, int num_threads, lrc_pages_t pages, int *run) {
+    resctrl_info_t info;
+    resctrl_group_t group;
+    
+    if (resctrl_probe(&info) != 0 || !info.mba) {
+        printf("MBA sweep skipped (resctrl MBA not available)\n");
+        return;
+    }
+    if (resctrl_group_create(&group, &info, "lrc_mba") != 0) {
+        printf("MBA sweep skipped (resctrl: %s)\n", strerror(errno));
+        return;
+    }
+    
+    const char *env = getenv("LRC_MBA_LEVELS");
+    char *levels = strdup(env && *env ? env : "100,70,50,30,10");
+    printf("Testing sequential_read under MBA (%d threads)...\n", num_threads);
+    
+    for (char *tok = strtok(levels, ","); tok; tok = strtok(NULL, ",")) {
+        unsigned percent = (unsigned)atoi(tok);
+        unsigned value = resctrl_mba_value(&info, percent);
+        if (resctrl_group_set_mba(&group, value) != 0) {
+            fprintf(stderr, "  MB=%u rejected: %s\n", value, strerror(errno));
+            continue;
+        }
+        
+        memset(&mba_mon, 0, sizeof(mba_mon));
+        mba_mon.running = num_threads;
+        mba_group = &group;
+        uint64_t start_ts = get_time_ns();
+        double bandwidth = run_bandwidth_test(sequential_read_thread, num_threads,
+                                              STREAM_KERNEL_SCALAR, PLACEMENT_LOCAL, pages);
+        uint64_t runtime = get_time_ns() - start_ts;
+        mba_group = NULL;
+        if (bandwidth < 0) {
+            printf("  MBA %u%% (MB=%u): skipped\n", percent, value);
+            continue;
+        }
+        double mbm_gbs = 0.0;
+        if (mba_mon.valid && mba_mon.end_ns > mba_mon.start_ns) {
+            mbm_gbs = (double)(mba_mon.after.mbm_total_bytes - mba_mon.before.mbm_total_bytes) /
+                      (mba_mon.end_ns - mba_mon.start_ns);
+        }
+        
+        printf("  MBA %u%% (MB=%u): %.2f GB/s (MBM %.2f GB/s)\n", percent, value, bandwidth, mbm_gbs);
+        
+        results_u64(csv, (*run)++);
+        results_strf(csv, "sequential_read_mba%u_%dthreads", percent, num_threads);
+        results_str(csv, "compiler");
+        results_str(csv, "local");
+        results_str(csv, lrc_pages_name(pages));
+        results_str(csv, topology_placement_name(thread_placement));
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, bandwidth);
+        results_u64(csv, percent);
+        results_u64(csv, value);
+        results_f64(csv, mbm_gbs);
+    }
+    free(levels);
+    
+    // Workers return to the root group
+    resctrl_group_destroy(&group);
+}
+
+void run_experiment(results_t *csv) {
+    int thread_counts[32];
+    int num_counts = topology_thread_counts(max_threads, thread_counts, 32);
+    const char *tname = topology_placement_name(thread_placement);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
+    if (num_pages == 0) pages[num_pages++] = LRC_PAGES_DEFAULT;
+    
+    // Each worker holds a source and a copy buffer; stay below half of RAM
+    uint64_t mem_limit = (uint64_t)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / 2;
+    while (num_counts > 1 &&
+           (uint64_t)thread_counts[num_counts - 1] * 2 * BUFFER_SIZE > mem_limit) {
+        printf("Skipping %d threads (buffers exceed half of RAM)\n", thread_counts[num_counts - 1]);
+        num_counts--;
+    }
     int run = 0;
     
     struct {
@@ -221,48 +528,154 @@ void run_experiment(FILE *csv) {
     
     int num_tests = sizeof(tests) / sizeof(tests[0]);
     
-    for (int t = 0; t < num_tests; t++) {
-        printf("Testing %s...\n", tests[t].name);
+    // Placement sweep only makes sense with more than one node
+    int num_placements = numa_is_available() ? PLACEMENT_COUNT : 1;
+    
+    for (int pl = 0; pl < num_placements; pl++) {
+        const char *pname = placement_names[pl];
         
-        for (int i = 0; i < num_counts; i++) {
-            int num_threads = thread_counts[i];
+        for (int p = 0; p < num_pages; p++) {
+            // numa_alloc_interleaved() has no page-size control
+            if (pl == PLACEMENT_INTERLEAVED && p > 0) break;
+            lrc_pages_t pg = pl == PLACEMENT_INTERLEAVED ? LRC_PAGES_DEFAULT : pages[p];
+            const char *pgname = lrc_pages_name(pg);
             
-            if (num_threads > sysconf(_SC_NPROCESSORS_ONLN)) {
-                continue;
+            for (int t = 0; t < num_tests; t++) {
+                printf("Testing %s (%s, %s pages)...\n", tests[t].name, pname, pgname);
+                
+                for (int i = 0; i < num_counts; i++) {
+                    int num_threads = thread_counts[i];
+                    
+                    uint64_t start_ts = get_time_ns();
+                    double bandwidth = run_bandwidth_test(tests[t].func, num_threads,
+                                                          STREAM_KERNEL_SCALAR, pl, pg);
+                    uint64_t runtime = get_time_ns() - start_ts;
+                    
+                    if (bandwidth < 0) {
+                        printf("  %d thread(s): skipped\n", num_threads);
+                        continue;
+                    }
+                    printf("  %d thread(s): %.2f GB/s\n", num_threads, bandwidth);
+                    
+                    results_u64(csv, run++);
+                    results_strf(csv, "%s_%s_%s_%dthreads", tests[t].name, pname, pgname,
+                                 num_threads);
+                    results_str(csv, "compiler");
+                    results_str(csv, pname);
+                    results_str(csv, pgname);
+                    results_str(csv, tname);
+                    results_runtime(csv, start_ts, runtime);
+                    results_f64(csv, bandwidth);
+                    results_u64(csv, 0);
+                    results_u64(csv, 0);
+                    results_f64(csv, 0.0);
+                }
             }
+        }
+    }
+    
+    // Same sequential tests with each explicit kernel (local placement, first page size)
+    struct {
+        const char *name;
+        thread_func_t func;
+        int stores;          // 1 if store strategy (NT, rep) matters
+    } kernel_tests[] = {
+        {"sequential_read", kernel_read_thread, 0},
+        {"sequential_write", kernel_write_thread, 1},
+        {"sequential_copy", kernel_copy_thread, 1},
+    };
+    
+    int num_kernel_tests = sizeof(kernel_tests) / sizeof(kernel_tests[0]);
+    
+    for (int t = 0; t < num_kernel_tests; t++) {
+        for (int k = 0; k < STREAM_KERNEL_COUNT; k++) {
+            if (!stream_kernel_supported(k)) continue;
+            // Read kernels ignore the store strategy, skip duplicates
+            if (!kernel_tests[t].stores && k > STREAM_KERNEL_AVX512) continue;
             
-            printf("  %d thread(s)...\n", num_threads);
-            
-            uint64_t start_ts = get_time_ns();
-            double bandwidth = run_bandwidth_test(tests[t].func, num_threads, tests[t].name);
-            uint64_t runtime = get_time_ns() - start_ts;
+            const char *kname = stream_kernel_name(k);
+            printf("Testing %s (%s)...\n", kernel_tests[t].name, kname);
             
-            fprintf(csv, "%d,%s_%dthreads,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-                   run++, tests[t].name, num_threads, start_ts, runtime, bandwidth);
+            for (int i = 0; i < num_counts; i++) {
+                int num_threads = thread_counts[i];
+                
+                uint64_t start_ts = get_time_ns();
+                double bandwidth = run_bandwidth_test(kernel_tests[t].func, num_threads, k,
+                                                      PLACEMENT_LOCAL, pages[0]);
+                uint64_t runtime = get_time_ns() - start_ts;
+                
+                if (bandwidth < 0) {
+                    printf("  %d thread(s): skipped\n", num_threads);
+                    continue;
+                }
+                printf("  %d thread(s): %.2f GB/s\n", num_threads, bandwidth);
+                
+                results_u64(csv, run++);
+                results_strf(csv, "%s_%s_local_%dthreads", kernel_tests[t].name, kname, num_threads);
+                results_str(csv, kname);
+                results_str(csv, "local");
+                results_str(csv, lrc_pages_name(pages[0]));
+                results_str(csv, tname);
+                results_runtime(csv, start_ts, runtime);
+                results_f64(csv, bandwidth);
+                results_u64(csv, 0);
+                results_u64(csv, 0);
+                results_f64(csv, 0.0);
+            }
         }
     }
+    
+    run_mba_sweep(csv, thread_counts[num_counts - 1], pages[0], &run);
 }
 
 int main(void) {
-    FILE *csv = fopen("data/memory_bandwidth.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    results_t csv;
+    if (results_open(&csv, "data/memory_bandwidth.csv", 256) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "bandwidth_gbs\n");
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_column(&csv, "kernel", RESULT_STR, 0);
+    results_add_column(&csv, "placement", RESULT_STR, 0);
+    results_add_column(&csv, "page_size", RESULT_STR, 0);
+    results_add_column(&csv, "thread_placement", RESULT_STR, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "bandwidth_gbs", RESULT_F64, 2);
+    results_add_column(&csv, "mba", RESULT_U64, 0);
+    results_add_column(&csv, "mba_schemata", RESULT_U64, 0);
+    results_add_column(&csv, "mbm_gbs", RESULT_F64, 2);
     
     printf("Memory Bandwidth Saturation Benchmark\n");
     printf("=====================================\n\n");
     printf("Buffer size per thread: %d MB\n", BUFFER_SIZE / (1024 * 1024));
-    printf("Available CPUs: %ld\n\n", sysconf(_SC_NPROCESSORS_ONLN));
+    if (assign_cpus() != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    if (thread_pool_create(&pool, max_threads, worker_cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
+        return 1;
+    }
+    printf("Available CPUs: %d (thread placement: %s, up to %d threads)\n",
+           topo.num_cpus, topology_placement_name(thread_placement), max_threads);
+    printf("Widest stream kernel: %s\n", stream_kernel_name(stream_kernel_best()));
+    printf("NUMA nodes: %d", num_nodes);
+    if (numa_is_available()) {
+        printf(" (workers spread round-robin, placements: local, remote, interleaved, main_touch)\n\n");
+    } else {
+        printf(" (single node: local first-touch placement only)\n\n");
+    }
+    
+    run_experiment(&csv);
     
-    run_experiment(csv);
+    thread_pool_destroy(&pool);
+    free(worker_cpus);
+    free(worker_nodes);
+    topology_destroy(&topo);
     
-    fclose(csv);
+    if (results_close(&csv) != 0) return 1;
     
     printf("\nResults saved to data/memory_bandwidth.csv\n");
     printf("\nExpected patterns:\n");
@@ -270,6 +683,8 @@ int main(void) {
     printf("  Multi-threaded: Linear scaling until saturation\n");
     printf("  Saturation point: System-dependent (50-200 GB/s)\n");
     printf("  Random access: Much lower (cache miss dominated)\n");
+    printf("  *_nt writes above cached writes: difference is RFO traffic\n");
+    printf("  NUMA: local scales with nodes, remote/main_touch capped by interconnect\n");
     
     return 0;
 }
@@ -0,0 +1,216 @@
+/*
+ * memory_parallelism.c - Memory-level parallelism (MLP) experiment
+ *
+ * Hypothesis:
+ *   A single dependent chain exposes full load-to-use latency. K
+ *   independent chains interleaved in one loop let the core keep up to
+ *   K misses in flight, so the effective time per hop drops roughly as
+ *   latency/K until the miss-handling resources (L1 line-fill buffers,
+ *   L2 superqueue) run out.
+ *
+ * Method:
+ *   For each buffer size (L1, L2, L3, DRAM), split the buffer into K
+ *   equal slices and build one random cache-line chain per slice
+ *   (chase_build, outside the timed region). Follow all K chains
+ *   together with chase_run_multi() for K = 1..32.
+ *
+ * Variables:
+ *   - Independent chains K (1..CHASE_MAX_CHAINS)
+ *   - Buffer size (total working set, constant across K)
+ *   - Page size (LRC_PAGE_SIZES, default 4k,thp); on 4 KB pages the
+ *     page walks compete with the chains for the same miss resources
+ *
+ * Expected outcome:
+ *   - L1: flat, hops are already limited by load ports, not latency
+ *   - L2/L3: ns_per_hop falls with K, saturates around 8-16 chains
+ *   - DRAM: ns_per_hop falls with K until the line-fill buffers are
+ *     exhausted (typically 10-12 per core on Intel, up to ~24+ on
+ *     newer cores); beyond that point adding chains has no effect
+ *
+ * Output:
+ *   ../data/memory_parallelism.csv with one row per run (ns_per_hop is
+ *   the wall time divided by total hops), plus a summary per size:
+ *   latency at K=1, best ns_per_hop, effective MLP (ratio of the two)
+ *   and the saturation point (smallest K within 10% of the best).
+ *
+ * Limitations:
+ *   - Register pressure: above ~12 chains cursors spill to the stack,
+ *     adding a store-forwarding delay per hop (only visible at L1/L2)
+ *   - Hardware prefetchers cannot predict the chains, but the page
+ *     walker still shares miss resources at DRAM sizes
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/lrc_alloc.h"
+#include "../core/workloads_api.h"
+
+extern int pin_to_cpu(int cpu);
+
+#define KB (1024ULL)
+#define MB (1024ULL * KB)
+#define MIN_RUNS 3
+#define MAX_RUNS 20
+#define TOTAL_HOPS (1ULL << 21)     // Per run, split across chains
+#define LINE_SIZE 64
+#define SATURATION_TOLERANCE 1.10   // Within 10% of the best ns_per_hop
+
+static const size_t buffer_sizes[] = {
+    16 * KB,     // L1
+    256 * KB,    // L2
+    8 * MB,      // L3
+    256 * MB     // DRAM
+};
+
+static const char *size_names[] = {
+    "16KB_L1",
+    "256KB_L2",
+    "8MB_L3",
+    "256MB_DRAM"
+};
+
+/*
+ * Split buffer into count line-aligned slices with one chain each.
+ */
+static int build_chains(chase_t *chains, int count, uint64_t *buffer, size_t size) {
+    size_t slice = (size / count) & ~(size_t)(LINE_SIZE - 1);
+    
+    for (int k = 0; k < count; k++) {
+        uint64_t *base = buffer + k * (slice / sizeof(uint64_t));
+        if (chase_build(&chains[k], base, slice, CHASE_SATTOLO | CHASE_LINE,
+                        (uint64_t)count * CHASE_MAX_CHAINS + k) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    workload_metrics_t metrics;
+    run_control_t rc;
+    chase_t chains[CHASE_MAX_CHAINS];
+    double best_ns[CHASE_MAX_CHAINS + 1];
+    results_t out;
+    size_t num_sizes = sizeof(buffer_sizes) / sizeof(buffer_sizes[0]);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
+    
+    if (results_open(&out, "../data/memory_parallelism.csv",
+                     num_pages * num_sizes * CHASE_MAX_CHAINS * MAX_RUNS) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    pin_to_cpu(0);
+    
+    metrics_set_mode(METRICS_MODE_FAST);
+    uint64_t overhead_ns = metrics_calibrate_overhead(MAX_RUNS * 10);
+    
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "buffer_size", RESULT_STR, 0);
+    results_add_column(&out, "page_size", RESULT_STR, 0);
+    results_add_column(&out, "huge_fraction", RESULT_F64, 3);
+    results_add_column(&out, "chains", RESULT_U64, 0);
+    results_add_column(&out, "hops", RESULT_U64, 0);
+    results_add_column(&out, "ns_per_hop", RESULT_F64, 3);
+    results_add_column(&out, "overhead_ns", RESULT_U64, 0);
+    results_add_metrics_columns(&out);
+    
+    printf("Running memory-level parallelism experiment...\n");
+    printf("Independent pointer chains K = 1..%d per buffer size.\n\n", CHASE_MAX_CHAINS);
+    printf("%-12s %-8s %12s %12s %8s %12s\n",
+           "Buffer", "Pages", "K=1 (ns)", "Best (ns)", "MLP", "Saturates");
+    
+    for (int p = 0; p < num_pages; p++) {
+        lrc_alloc_opts_t opts = { -1, pages[p], 0 };
+        const char *page_name = lrc_pages_name(pages[p]);
+        
+        for (size_t i = 0; i < num_sizes; i++) {
+            size_t size = buffer_sizes[i];
+            const char *name = size_names[i];
+            
+            uint64_t *buffer = lrc_alloc(size, &opts);
+            if (!buffer) {
+                fprintf(stderr, "Skipping %s with %s pages: %s\n",
+                        name, page_name, strerror(errno));
+                continue;
+            }
+            memset(buffer, 0, size);
+            double huge = lrc_alloc_huge_fraction(buffer, size);
+            
+            for (int k = 1; k <= CHASE_MAX_CHAINS; k++) {
+                uint64_t hops_per_chain = TOTAL_HOPS / k;
+                uint64_t hops = hops_per_chain * k;
+                
+                best_ns[k] = 0.0;
+                if (build_chains(chains, k, buffer, size) != 0) {
+                    fprintf(stderr, "Failed to build %d chains for %s\n", k, name);
+                    continue;
+                }
+                
+                // Warm-up pass brings the chains into the cache level under test
+                volatile uint64_t sink = chase_run_multi(chains, k, chains[0].nodes);
+                (void)sink;
+                
+                run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+                while (run_control_next(&rc)) {
+                    metrics_init(&metrics);
+                    uint64_t result = chase_run_multi(chains, k, hops_per_chain);
+                    metrics_finish(&metrics);
+                    (void)result;
+                    
+                    uint64_t runtime = metrics.runtime_ns > overhead_ns ?
+                                       metrics.runtime_ns - overhead_ns : 0;
+                    double ns_per_hop = (double)runtime / hops;
+                    if (!run_control_add(&rc, ns_per_hop)) continue;   // Warmup
+                    
+                    results_u64(&out, run_control_index(&rc));
+                    results_str(&out, name);
+                    results_str(&out, page_name);
+                    results_f64(&out, huge);
+                    results_u64(&out, k);
+                    results_u64(&out, hops);
+                    results_f64(&out, ns_per_hop);
+                    results_u64(&out, overhead_ns);
+                    results_metrics(&out, &metrics);
+                }
+                
+                best_ns[k] = rc.median;
+            }
+            
+            // Saturation point: smallest K within tolerance of the best median
+            double best = best_ns[1];
+            for (int k = 2; k <= CHASE_MAX_CHAINS; k++) {
+                if (best_ns[k] > 0.0 && best_ns[k] < best) best = best_ns[k];
+            }
+            
+            int saturation = 1;
+            for (int k = 1; k <= CHASE_MAX_CHAINS; k++) {
+                if (best_ns[k] > 0.0 && best_ns[k] <= best * SATURATION_TOLERANCE) {
+                    saturation = k;
+                    break;
+                }
+            }
+            
+            printf("%-12s %-8s %12.2f %12.2f %8.1f %9d ch\n", name, page_name, best_ns[1], best,
+                   best > 0.0 ? best_ns[1] / best : 0.0, saturation);
+            
+            lrc_free(buffer, size, pages[p]);
+        }
+    }
+    
+    if (results_close(&out) != 0) return 1;
+    printf("\nEffective MLP = K=1 latency / best ns_per_hop.\n");
+    printf("Saturation = smallest K within %.0f%% of the best (miss resources exhausted).\n",
+           (SATURATION_TOLERANCE - 1.0) * 100.0);
+    printf("Results saved to ../data/memory_parallelism.csv\n");
+    
+    return 0;
+}
@@ -13,6 +13,9 @@
  *   - Nice 10 (lower priority)
  *   - Nice 19 (lowest priority)
  *
+ *   With CAP_BPF the scheduler tracer (core/sched_trace.h) records each
+ *   run's preemptions and exact off-CPU time alongside the rusage counts.
+ *
  * Variables:
  *   - Nice level (controlled)
  *   - Workload iterations (fixed)
@@ -36,30 +39,41 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/sched_trace.h"
 
 extern uint64_t cpu_spin(uint64_t iterations);
 extern int set_nice(int nice_value);
 
 #define ITERATIONS 500000000ULL
-#define RUNS 10
+#define MIN_RUNS 5
+#define MAX_RUNS 30
 
 static const int nice_levels[] = {0, -10, 10, 19};
 static const char *nice_names[] = {"nice0", "nice-10", "nice10", "nice19"};
 
 int main(void) {
     workload_metrics_t metrics;
-    FILE *out = fopen("../data/nice_levels.csv", "w");
+    run_control_t rc;
+    results_t out;
+    sched_trace_t trace;
+    sched_trace_run_t traced;
+    uint64_t trace_run = 0;
     
-    if (!out) {
-        perror("fopen");
+    if (results_open(&out, "../data/nice_levels.csv", 4 * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(out, "run,nice_level,");
-    metrics_print_csv_header(out);
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "nice_level", RESULT_STR, 0);
+    results_add_metrics_columns(&out);
+    results_add_sched_trace_columns(&out);
     
     printf("Running nice level experiment...\n");
     printf("Note: nice -10 requires privileges, will skip if denied\n\n");
+    sched_trace_open(&trace);
     
     for (size_t i = 0; i < sizeof(nice_levels) / sizeof(nice_levels[0]); i++) {
         int nice_val = nice_levels[i];
@@ -72,18 +86,26 @@ int main(void) {
         
         printf("Testing nice %d...\n", nice_val);
         
-        for (int run = 0; run < RUNS; run++) {
-            fprintf(out, "%d,%s,", run, name);
+        run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+        while (run_control_next(&rc)) {
+            sched_trace_begin(&trace, ++trace_run);
             metrics_init(&metrics);
             uint64_t result = cpu_spin(ITERATIONS);
             metrics_finish(&metrics);
-            metrics_print_csv(out, &metrics);
-            
+            sched_trace_end(&trace, &traced, NULL, NULL);
             (void)result;
+            if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+            
+            results_u64(&out, run_control_index(&rc));
+            results_str(&out, name);
+            results_metrics(&out, &metrics);
+            results_sched_trace(&out, &traced);
         }
+        run_control_report(&rc, name);
     }
+    sched_trace_close(&trace);
     
-    fclose(out);
+    if (results_close(&out) != 0) return 1;
     printf("\nResults saved to ../data/nice_levels.csv\n");
     
     return 0;
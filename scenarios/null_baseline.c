@@ -8,9 +8,10 @@
  *
  * Method:
  *   Run metrics_init() → (empty loop) → metrics_finish()
+ *   in both collection modes (METRICS_MODE_PROC, METRICS_MODE_FAST).
  *   Measure:
  *   1. Pure timing overhead
- *   2. /proc read overhead
+ *   2. /proc read overhead vs getrusage(RUSAGE_THREAD)
  *   3. sched_getcpu() overhead
  *
  * Variables:
@@ -18,8 +19,10 @@
  *   - Measurement calls (standard)
  *
  * Expected outcome:
- *   - Total measurement overhead: ~100-200μs
- *   - Breakdown: /proc reads ~10-50μs each, timing ~25ns each
+ *   - Counters are read outside the clock pair, so runtime_ns overhead
+ *     is ~25-100ns in both modes (one clock_gettime + call return)
+ *   - Cost per boundary outside the timed region:
+ *     /proc reads ~10-50μs each, getrusage ~0.5-1μs
  *   - Negligible compared to ms-scale workloads
  *
  * Purpose:
@@ -31,63 +34,100 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
 
 extern int pin_to_cpu(int cpu);
 
-#define RUNS 100  // More runs for statistical significance
+#define MIN_RUNS 100  // More runs for statistical significance
+#define MAX_RUNS 1000
 
 int main(void) {
     workload_metrics_t metrics;
-    FILE *out = fopen("../data/null_baseline.csv", "w");
+    run_control_t rc;
+    uint64_t overhead_ns[2];
+    results_t out;
     
-    if (!out) {
-        perror("fopen");
+    if (results_open(&out, "../data/null_baseline.csv", 2 * 2 * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
     pin_to_cpu(0);
     
-    fprintf(out, "run,workload_type,");
-    metrics_print_csv_header(out);
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "workload_type", RESULT_STR, 0);
+    results_add_metrics_columns(&out);
     
     printf("Running null baseline experiment...\n");
     printf("Quantifying pure measurement overhead.\n\n");
     
-    // Null workload: absolutely minimal work
-    printf("Null workload (minimal)...\n");
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,null_minimal,", run);
-        metrics_init(&metrics);
-        
-        // Minimal work: volatile to prevent optimization
-        volatile uint64_t counter = 0;
-        counter++;
-        
-        metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-    }
+    static const struct {
+        metrics_mode_t mode;
+        const char *suffix;
+    } modes[] = {
+        {METRICS_MODE_PROC, ""},
+        {METRICS_MODE_FAST, "_fast"},
+    };
     
-    // Empty loop baseline: typical "nothing" workload
-    printf("Empty loop (typical nothing)...\n");
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,empty_loop,", run);
-        metrics_init(&metrics);
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        const char *suffix = modes[m].suffix;
+        char null_name[32], loop_name[32];
+        snprintf(null_name, sizeof(null_name), "null_minimal%s", suffix);
+        snprintf(loop_name, sizeof(loop_name), "empty_loop%s", suffix);
+        metrics_set_mode(modes[m].mode);
+        
+        // Null workload: absolutely minimal work
+        printf("Null workload (minimal%s)...\n", suffix);
+        run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+        while (run_control_next(&rc)) {
+            metrics_init(&metrics);
+            
+            // Minimal work: volatile to prevent optimization
+            volatile uint64_t counter = 0;
+            counter++;
+            
+            metrics_finish(&metrics);
+            if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+            
+            results_u64(&out, run_control_index(&rc));
+            results_str(&out, null_name);
+            results_metrics(&out, &metrics);
+        }
+        run_control_report(&rc, null_name);
         
-        volatile uint64_t sum = 0;
-        for (int i = 0; i < 1000; i++) {
-            sum += i;
+        // Empty loop baseline: typical "nothing" workload
+        printf("Empty loop (typical nothing%s)...\n", suffix);
+        run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+        while (run_control_next(&rc)) {
+            metrics_init(&metrics);
+            
+            volatile uint64_t sum = 0;
+            for (int i = 0; i < 1000; i++) {
+                sum += i;
+            }
+            
+            metrics_finish(&metrics);
+            if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+            
+            results_u64(&out, run_control_index(&rc));
+            results_str(&out, loop_name);
+            results_metrics(&out, &metrics);
         }
+        run_control_report(&rc, loop_name);
         
-        metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
+        overhead_ns[m] = metrics_calibrate_overhead(MIN_RUNS);
     }
     
-    fclose(out);
+    if (results_close(&out) != 0) return 1;
     
     printf("\nResults saved to ../data/null_baseline.csv\n");
     printf("\nThis measures PURE measurement overhead.\n");
-    printf("Expected: ~100-200μs total\n");
-    printf("  - /proc reads: ~10-50μs each\n");
+    printf("Calibrated overhead (median): proc=%luns fast=%luns\n",
+           overhead_ns[0], overhead_ns[1]);
+    printf("Expected: ~25-100ns in runtime_ns (counters read outside clock pair)\n");
+    printf("  - /proc reads: ~10-50μs each (proc mode, between runs)\n");
+    printf("  - getrusage: ~0.5-1μs each (fast mode, between runs)\n");
     printf("  - clock_gettime: ~25-40ns each\n");
     printf("  - sched_getcpu: ~10ns each\n\n");
     printf("Analyze with:\n");
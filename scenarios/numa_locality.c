@@ -16,6 +16,10 @@
  *   Remote access: 2-3x slower than local
  *   Even if both in "DRAM", locality matters more than cache
  *
+ * Hardware counters:
+ *   node-loads/node-load-misses and LLC misses are appended per row
+ *   (see NUMA_PERF_EVENTS) to confirm remote accesses actually occurred.
+ *
  * Limitations:
  *   - Requires system with 2+ NUMA nodes
  *   - Simplified NUMA allocation (falls back to malloc)
@@ -27,8 +31,11 @@
 #include <stdint.h>
 #include <string.h>
 #include "../core/metrics.h"
+#include "../core/perf_counters.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/workloads_api.h"
 
-extern uint64_t memory_random_chase(uint64_t *buffer, size_t size, uint64_t iterations);
 extern int pin_to_cpu(int cpu);
 extern int numa_get_node_count(void);
 extern uint64_t numa_node_to_cpus(int node);
@@ -40,10 +47,13 @@ extern int numa_is_available(void);
 #define MB (1024ULL * 1024ULL)
 #define BUFFER_SIZE (64 * MB)
 #define ITERATIONS 1000000ULL
-#define RUNS 10
+#define MIN_RUNS 5
+#define MAX_RUNS 30
+#define NUMA_PERF_EVENTS "cycles,instructions,LLC-load-misses,node-loads,node-load-misses"
 
 int main(void) {
     workload_metrics_t metrics;
+    run_control_t rc;
     
     printf("=== NUMA Locality Experiment ===\n\n");
     
@@ -57,14 +67,19 @@ int main(void) {
         printf("\n");
     }
     
-    FILE *out = fopen("../data/numa_locality.csv", "w");
-    if (!out) {
-        perror("fopen");
+    results_t out;
+    if (results_open(&out, "../data/numa_locality.csv", 2 * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(out, "run,locality,");
-    metrics_print_csv_header(out);
+    perf_event_list_t events;
+    perf_event_list_from_env(&events, NUMA_PERF_EVENTS, 1);
+    
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "locality", RESULT_STR, 0);
+    results_add_event_columns(&out, &events);
+    results_add_metrics_columns(&out);
     
     // Pin to first CPU of node 0 (if NUMA available)
     int cpu0 = 0; // Default to CPU 0
@@ -91,14 +106,27 @@ int main(void) {
     memset(local_buffer, 0x42, BUFFER_SIZE);
     printf("  Allocated %llu MB\n", BUFFER_SIZE / MB);
     
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,local,", run);
+    // Same seed for both buffers: identical chain shape, only placement differs
+    chase_t local_chain;
+    chase_build(&local_chain, local_buffer, BUFFER_SIZE, CHASE_SATTOLO, 1);
+    
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         metrics_init(&metrics);
-        uint64_t result = memory_random_chase(local_buffer, BUFFER_SIZE, ITERATIONS);
+        perf_event_list_start(&events);
+        uint64_t result = chase_run(&local_chain, ITERATIONS);
+        perf_event_list_stop(&events);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
+        
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "local");
+        results_events(&out, &events);
+        results_metrics(&out, &metrics);
     }
+    run_control_report(&rc, "local");
     
     numa_free(local_buffer, BUFFER_SIZE);
     
@@ -112,17 +140,31 @@ int main(void) {
     memset(remote_buffer, 0x42, BUFFER_SIZE);
     printf("  Allocated %llu MB\n", BUFFER_SIZE / MB);
     
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,remote,", run);
+    // Same seed for both buffers: identical chain shape, only placement differs
+    chase_t remote_chain;
+    chase_build(&remote_chain, remote_buffer, BUFFER_SIZE, CHASE_SATTOLO, 1);
+    
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         metrics_init(&metrics);
-        uint64_t result = memory_random_chase(remote_buffer, BUFFER_SIZE, ITERATIONS);
+        perf_event_list_start(&events);
+        uint64_t result = chase_run(&remote_chain, ITERATIONS);
+        perf_event_list_stop(&events);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
+        
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "remote");
+        results_events(&out, &events);
+        results_metrics(&out, &metrics);
     }
+    run_control_report(&rc, "remote");
     
     numa_free(remote_buffer, BUFFER_SIZE);
-    fclose(out);
+    perf_event_list_close(&events);
+    if (results_close(&out) != 0) return 1;
     
     printf("\nResults saved to ../data/numa_locality.csv\n");
     
@@ -11,7 +11,9 @@
  *   2. Pinned to CPU 0
  *   3. Pinned to CPU 1
  *   
- *   Measure context switches and CPU migrations.
+ *   Measure context switches and CPU migrations. With CAP_BPF the
+ *   scheduler tracer (core/sched_trace.h) adds each run's exact off-CPU
+ *   time, preemptions, migrations and IRQ/softirq time.
  *
  * Variables:
  *   - CPU affinity (controlled)
@@ -33,68 +35,101 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/sched_trace.h"
 
 extern uint64_t cpu_spin(uint64_t iterations);
 extern int pin_to_cpu(int cpu);
 
 #define ITERATIONS 1000000000ULL
-#define RUNS 10
+#define MIN_RUNS 5
+#define MAX_RUNS 30
 
 int main(void) {
     workload_metrics_t metrics;
-    FILE *out = fopen("../data/pinned.csv", "w");
+    run_control_t rc;
+    results_t out;
+    sched_trace_t trace;
+    sched_trace_run_t traced;
+    uint64_t trace_run = 0;
     
-    if (!out) {
-        perror("fopen");
+    if (results_open(&out, "../data/pinned.csv", 3 * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(out, "run,affinity,");
-    metrics_print_csv_header(out);
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "affinity", RESULT_STR, 0);
+    results_add_metrics_columns(&out);
+    results_add_sched_trace_columns(&out);
     
     printf("Running pinned CPU experiment...\n");
+    sched_trace_open(&trace);
     
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,unpinned,", run);
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
+        sched_trace_begin(&trace, ++trace_run);
         metrics_init(&metrics);
         uint64_t result = cpu_spin(ITERATIONS);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
+        sched_trace_end(&trace, &traced, NULL, NULL);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "unpinned");
+        results_metrics(&out, &metrics);
+        results_sched_trace(&out, &traced);
     }
+    run_control_report(&rc, "unpinned");
     
-    for (int run = 0; run < RUNS; run++) {
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         if (pin_to_cpu(0) == -1) {
             perror("pin_to_cpu(0)");
-            continue;
+            break;
         }
         
-        fprintf(out, "%d,cpu0,", run);
+        sched_trace_begin(&trace, ++trace_run);
         metrics_init(&metrics);
         uint64_t result = cpu_spin(ITERATIONS);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
+        sched_trace_end(&trace, &traced, NULL, NULL);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "cpu0");
+        results_metrics(&out, &metrics);
+        results_sched_trace(&out, &traced);
     }
+    run_control_report(&rc, "cpu0");
     
-    for (int run = 0; run < RUNS; run++) {
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         if (pin_to_cpu(1) == -1) {
             perror("pin_to_cpu(1)");
-            continue;
+            break;
         }
         
-        fprintf(out, "%d,cpu1,", run);
+        sched_trace_begin(&trace, ++trace_run);
         metrics_init(&metrics);
         uint64_t result = cpu_spin(ITERATIONS);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
+        sched_trace_end(&trace, &traced, NULL, NULL);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "cpu1");
+        results_metrics(&out, &metrics);
+        results_sched_trace(&out, &traced);
     }
+    run_control_report(&rc, "cpu1");
+    sched_trace_close(&trace);
     
-    fclose(out);
+    if (results_close(&out) != 0) return 1;
     printf("Results saved to ../data/pinned.csv\n");
     
     return 0;
@@ -0,0 +1,345 @@
+/*
+ * prefetch_distance.c - Software prefetch distance experiment
+ *
+ * Hypothesis:
+ *   A sequential or small-stride scan is already covered by the
+ *   hardware prefetchers, so __builtin_prefetch adds only instructions.
+ *   Large strides (past the streamer's reach or across 4 KB pages) and
+ *   indirect accesses through an index array are not, and there a
+ *   prefetch issued far enough ahead to cover the latency of the level
+ *   the data lives in, but not so far that lines are evicted before use,
+ *   recovers most of the bandwidth.
+ *
+ * Method:
+ *   For each buffer size (L1, L2, L3, DRAM) scan one word per access:
+ *   strided by 1..16 cache lines (memory_stream_strided_prefetch), and
+ *   indirect through a random permutation of the buffer's cache lines
+ *   (memory_stream_indirect). Sweep the prefetch distance (accesses
+ *   ahead, 0 = none) for each locality hint. Small buffers are scanned
+ *   several times per run; a warm-up pass places them in the level
+ *   under test.
+ *
+ * Variables:
+ *   LRC_PF_STRIDES=1,2,4,8,16          Strides in cache lines
+ *   LRC_PF_DISTANCES=0,1,2,4,...,64    Prefetch distances in accesses
+ *   LRC_PF_HINTS=t0,nta                Locality hints (nta, t2, t1, t0)
+ *   LRC_PF_HW_OFF=1                    Repeat everything with the hardware
+ *                                      prefetchers off (MSR 0x1A4, root,
+ *                                      Intel only; skipped otherwise)
+ *   LRC_PAGE_SIZES                     Buffer backing (default 4k)
+ *
+ * Expected outcome:
+ *   - Stride 1-2 with hardware prefetch: flat, distance does not matter
+ *   - Large strides and indirect at L3/DRAM: ns_per_access falls with
+ *     distance to a minimum (roughly latency / time per access) and
+ *     rises again once prefetched lines are evicted before use
+ *   - nta helps DRAM scans that would otherwise evict useful L2/L3 data,
+ *     but its lines can be dropped early at long distances
+ *
+ * Output:
+ *   ../data/prefetch_distance.csv with one row per run, plus a summary
+ *   per size, pattern and hint: time per access without software
+ *   prefetch, the bandwidth-optimal distance and its speedup.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/lrc_alloc.h"
+#include "../core/workloads_api.h"
+#include "../core/hw_prefetch.h"
+#include "../core/rng.h"
+
+extern int pin_to_cpu(int cpu);
+
+#define KB (1024ULL)
+#define MB (1024ULL * KB)
+#define MIN_RUNS 3
+#define MAX_RUNS 20
+#define MAX_LIST 32
+#define TARGET_ACCESSES (1ULL << 20)   // Per run, buffers rescanned to reach it
+#define LINE_SIZE 64
+#define WORDS_PER_LINE (LINE_SIZE / sizeof(uint64_t))
+#define INDIRECT 0                     // Stride value that selects the indirect scan
+
+static const size_t buffer_sizes[] = {
+    16 * KB,     // L1
+    256 * KB,    // L2
+    8 * MB,      // L3
+    256 * MB     // DRAM
+};
+
+static const char *size_names[] = {
+    "16KB_L1",
+    "256KB_L2",
+    "8MB_L3",
+    "256MB_DRAM"
+};
+
+static hw_prefetch_t hw_pf = { -1, -1, 0 };
+
+static void restore_hw_prefetch(void) {
+    hw_prefetch_restore(&hw_pf);
+}
+
+/* hw_prefetch_restore() only does pwrite/close on an open fd: signal-safe */
+static void restore_on_signal(int sig) {
+    hw_prefetch_restore(&hw_pf);
+    _exit(128 + sig);
+}
+
+static int parse_list(const char *name, const char *defaults, long *out) {
+    const char *env = getenv(name);
+    char *copy = strdup(env && *env ? env : defaults);
+    int count = 0;
+    
+    for (char *tok = strtok(copy, ","); tok && count < MAX_LIST; tok = strtok(NULL, ",")) {
+        out[count++] = strtol(tok, NULL, 10);
+    }
+    free(copy);
+    return count;
+}
+
+static int parse_hints(prefetch_hint_t *out) {
+    const char *env = getenv("LRC_PF_HINTS");
+    char *copy = strdup(env && *env ? env : "t0,nta");
+    int count = 0;
+    
+    for (char *tok = strtok(copy, ","); tok && count < PREFETCH_HINT_COUNT; tok = strtok(NULL, ",")) {
+        for (int h = 0; h < PREFETCH_HINT_COUNT; h++) {
+            if (strcmp(tok, prefetch_hint_name((prefetch_hint_t)h)) == 0) out[count++] = h;
+        }
+    }
+    free(copy);
+    return count;
+}
+
+/* Word offsets of every cache line of the buffer, in random order */
+static uint32_t *build_index(size_t size) {
+    size_t lines = size / LINE_SIZE;
+    uint32_t *index = malloc(lines * sizeof(*index));
+    lrc_rng_t rng;
+    
+    if (!index) return NULL;
+    lrc_rng_seed(&rng, 42);
+    for (size_t i = 0; i < lines; i++) index[i] = (uint32_t)(i * WORDS_PER_LINE);
+    for (size_t i = lines - 1; i > 0; i--) {
+        size_t j = (size_t)lrc_rng_bounded(&rng, i + 1);
+        uint32_t t = index[i];
+        index[i] = index[j];
+        index[j] = t;
+    }
+    return index;
+}
+
+static uint64_t scan(const uint64_t *buffer, size_t size, const uint32_t *index, long stride,
+                     long distance, prefetch_hint_t hint, uint64_t passes) {
+    uint64_t sum = 0;
+    
+    for (uint64_t p = 0; p < passes; p++) {
+        if (stride == INDIRECT) {
+            sum += memory_stream_indirect(buffer, index, size / LINE_SIZE, (size_t)distance, hint);
+        } else {
+            sum += memory_stream_strided_prefetch(buffer, size, (size_t)stride, (size_t)distance, hint);
+        }
+    }
+    return sum;
+}
+
+int main(void) {
+    workload_metrics_t metrics;
+    run_control_t rc;
+    results_t out;
+    long strides[MAX_LIST + 1], distances[MAX_LIST];
+    prefetch_hint_t hints[PREFETCH_HINT_COUNT];
+    double median_ns[MAX_LIST];
+    size_t num_sizes = sizeof(buffer_sizes) / sizeof(buffer_sizes[0]);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k");
+    int num_strides = parse_list("LRC_PF_STRIDES", "1,2,4,8,16", strides);
+    int num_distances = parse_list("LRC_PF_DISTANCES", "0,1,2,4,8,16,32,64", distances);
+    int num_hints = parse_hints(hints);
+    const char *hw_env = getenv("LRC_PF_HW_OFF");
+    int hw_modes = 1;
+    
+    // Indirect runs as one more "stride"; drop user strides it would collide with
+    int kept = 0;
+    for (int s = 0; s < num_strides; s++) {
+        if (strides[s] > 0) strides[kept++] = strides[s];
+    }
+    if (kept == 0) {
+        fprintf(stderr, "LRC_PF_STRIDES: no valid stride (cache lines > 0)\n");
+        return 1;
+    }
+    num_strides = kept;
+    strides[num_strides++] = INDIRECT;
+    kept = 0;
+    for (int d = 0; d < num_distances; d++) {
+        if (distances[d] >= 0) distances[kept++] = distances[d];
+    }
+    num_distances = kept;
+    if (num_distances == 0) {
+        fprintf(stderr, "LRC_PF_DISTANCES: no valid distance (accesses >= 0)\n");
+        return 1;
+    }
+    if (num_hints == 0) {
+        fprintf(stderr, "LRC_PF_HINTS: no valid hint (nta, t2, t1, t0)\n");
+        return 1;
+    }
+    
+    pin_to_cpu(0);
+    int cpu = sched_getcpu();
+    
+    if (hw_env && strcmp(hw_env, "1") == 0) {
+        if (hw_prefetch_supported()) {
+            hw_modes = 2;
+            atexit(restore_hw_prefetch);
+            signal(SIGINT, restore_on_signal);
+            signal(SIGTERM, restore_on_signal);
+        } else {
+            fprintf(stderr, "LRC_PF_HW_OFF: MSR 0x%x not writable (needs root, Intel, "
+                    "msr module); hardware prefetch stays on\n", HW_PREFETCH_MSR);
+        }
+    }
+    
+    if (results_open(&out, "../data/prefetch_distance.csv",
+                     (size_t)hw_modes * num_pages * num_sizes * num_strides * num_hints *
+                     num_distances * MIN_RUNS) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    metrics_set_mode(METRICS_MODE_FAST);
+    uint64_t overhead_ns = metrics_calibrate_overhead(MAX_RUNS * 10);
+    
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "hw_prefetch", RESULT_STR, 0);
+    results_add_column(&out, "buffer_size", RESULT_STR, 0);
+    results_add_column(&out, "page_size", RESULT_STR, 0);
+    results_add_column(&out, "pattern", RESULT_STR, 0);
+    results_add_column(&out, "stride_lines", RESULT_U64, 0);
+    results_add_column(&out, "hint", RESULT_STR, 0);
+    results_add_column(&out, "distance", RESULT_U64, 0);
+    results_add_column(&out, "accesses", RESULT_U64, 0);
+    results_add_column(&out, "ns_per_access", RESULT_F64, 3);
+    results_add_column(&out, "bandwidth_gbs", RESULT_F64, 3);
+    results_add_column(&out, "overhead_ns", RESULT_U64, 0);
+    results_add_metrics_columns(&out);
+    
+    printf("Running software prefetch distance experiment on CPU %d...\n", cpu);
+    printf("Distances 0..%ld accesses ahead, %d strides plus indirect, %d hint(s).\n\n",
+           distances[num_distances - 1], num_strides - 1, num_hints);
+    printf("%-4s %-12s %-6s %-12s %-4s %10s %8s %10s %8s\n",
+           "HW", "Buffer", "Pages", "Pattern", "Hint", "d=0 (ns)", "Best d", "Best (ns)", "Speedup");
+    
+    for (int mode = 0; mode < hw_modes; mode++) {
+        const char *hw_name = mode == 0 ? "on" : "off";
+        if (mode == 1 && hw_prefetch_disable(&hw_pf, cpu, HW_PREFETCH_ALL) != 0) {
+            fprintf(stderr, "Disabling hardware prefetch on CPU %d: %s\n", cpu, strerror(errno));
+            break;
+        }
+        
+        for (int p = 0; p < num_pages; p++) {
+            lrc_alloc_opts_t opts = { -1, pages[p], 0 };
+            const char *page_name = lrc_pages_name(pages[p]);
+            
+            for (size_t i = 0; i < num_sizes; i++) {
+                size_t size = buffer_sizes[i];
+                const char *name = size_names[i];
+                
+                uint64_t *buffer = lrc_alloc(size, &opts);
+                uint32_t *index = build_index(size);
+                if (!buffer || !index) {
+                    fprintf(stderr, "Skipping %s with %s pages: %s\n",
+                            name, page_name, strerror(errno));
+                    if (buffer) lrc_free(buffer, size, pages[p]);
+                    free(index);
+                    continue;
+                }
+                memset(buffer, 1, size);
+                
+                for (int s = 0; s < num_strides; s++) {
+                    long stride = strides[s];
+                    size_t lines = size / LINE_SIZE;
+                    uint64_t per_pass = stride == INDIRECT ? lines :
+                                        (lines + (size_t)stride - 1) / (size_t)stride;
+                    uint64_t passes = per_pass >= TARGET_ACCESSES ? 1 : TARGET_ACCESSES / per_pass;
+                    uint64_t accesses = per_pass * passes;
+                    char pattern[32];
+                    if (stride == INDIRECT) snprintf(pattern, sizeof(pattern), "indirect");
+                    else snprintf(pattern, sizeof(pattern), "stride_%ld", stride);
+                    
+                    for (int h = 0; h < num_hints; h++) {
+                        for (int d = 0; d < num_distances; d++) {
+                            long distance = distances[d] > 0 ? distances[d] : 0;
+                            
+                            // Warm-up pass places the buffer in the level under test
+                            volatile uint64_t sink = scan(buffer, size, index, stride, distance,
+                                                          hints[h], 1);
+                            (void)sink;
+                            
+                            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+                            while (run_control_next(&rc)) {
+                                metrics_init(&metrics);
+                                sink = scan(buffer, size, index, stride, distance, hints[h], passes);
+                                metrics_finish(&metrics);
+                                
+                                uint64_t runtime = metrics.runtime_ns > overhead_ns ?
+                                                   metrics.runtime_ns - overhead_ns : 0;
+                                double ns_per_access = (double)runtime / accesses;
+                                if (!run_control_add(&rc, ns_per_access)) continue;   // Warmup
+                                
+                                results_u64(&out, run_control_index(&rc));
+                                results_str(&out, hw_name);
+                                results_str(&out, name);
+                                results_str(&out, page_name);
+                                results_str(&out, pattern);
+                                results_u64(&out, (uint64_t)stride);
+                                results_str(&out, prefetch_hint_name(hints[h]));
+                                results_u64(&out, (uint64_t)distance);
+                                results_u64(&out, accesses);
+                                results_f64(&out, ns_per_access);
+                                results_f64(&out, ns_per_access > 0 ? LINE_SIZE / ns_per_access : 0.0);
+                                results_u64(&out, overhead_ns);
+                                results_metrics(&out, &metrics);
+                            }
+                            median_ns[d] = rc.median;
+                        }
+                        
+                        // Bandwidth-optimal distance: lowest median time per access
+                        int best = 0, base = -1;
+                        for (int d = 0; d < num_distances; d++) {
+                            if (distances[d] <= 0 && base < 0) base = d;
+                            if (median_ns[d] > 0.0 && median_ns[d] < median_ns[best]) best = d;
+                        }
+                        double base_ns = base >= 0 ? median_ns[base] : 0.0;
+                        printf("%-4s %-12s %-6s %-12s %-4s %10.3f %8ld %10.3f %7.2fx\n",
+                               hw_name, name, page_name, pattern, prefetch_hint_name(hints[h]),
+                               base_ns, distances[best], median_ns[best],
+                               base_ns > 0.0 && median_ns[best] > 0.0 ? base_ns / median_ns[best] : 0.0);
+                    }
+                }
+                
+                free(index);
+                lrc_free(buffer, size, pages[p]);
+            }
+        }
+        hw_prefetch_restore(&hw_pf);
+    }
+    
+    if (results_close(&out) != 0) return 1;
+    printf("\nSpeedup = time per access without software prefetch / at the best distance.\n");
+    printf("Bandwidth counts one %d-byte line per access.\n", LINE_SIZE);
+    printf("Results saved to ../data/prefetch_distance.csv\n");
+    
+    return 0;
+}
@@ -4,31 +4,115 @@
  * Measures the cost of creating processes via fork(), vfork(), and clone().
  * Process creation is a fundamental operation with significant overhead.
  *
+ * Every method is measured from parents of growing resident size
+ * (LRC_SPAWN_RSS, prefaulted with 4 KB pages or THP, LRC_PAGE_SIZES) and
+ * with 1..N threads of the parent spawning at once, pinned across
+ * cores (LRC_PLACEMENT):
+ *   fork, fork_exec        copy the page tables (COW setup)
+ *   vfork, clone_vm        share the address space
+ *   clone3_vfork           clone3(CLONE_VFORK | CLONE_VM), the raw syscall
+ *   posix_spawn            exec of /bin/true, glibc default
+ *   posix_spawn_vfork      same with POSIX_SPAWN_USEVFORK
+ *
  * Expected Results:
  * - fork(): 50-200 microseconds (full copy-on-write setup)
  * - vfork(): 5-20 microseconds (minimal setup, shared address space)
  * - clone(CLONE_VM): 10-30 microseconds (thread-like)
  * - posix_spawn(): Similar to vfork()
+ * - fork from a large parent: grows linearly with RSS, ~8 bytes of page
+ *   table per 4 KB page (about 2 MB per GB); THP cuts the entries ~512x
+ *   since one PMD entry maps 2 MB
+ * - vfork/clone3/posix_spawn: flat in RSS
+ * - Concurrent forks of one parent serialize on its mmap lock, so
+ *   spawns/s stops scaling; the vfork family keeps scaling
  *
  * What This Tests:
  * - Process creation mechanisms
  * - Copy-on-write overhead
  * - Virtual memory setup cost
  * - Scheduler interaction
+ *
+ * Page tables (read once per parent configuration, outside the runs):
+ *   pte_bytes_copied is 8 bytes per entry fork fills for the parent's
+ *   anonymous memory, one per 4 KB page and one per THP, from
+ *   /proc/self/smaps_rollup. pgtable_bytes is the page-table memory of a
+ *   forked child (VmPTE); on x86 it stays large with THP, because a
+ *   spare PTE page is kept per huge page for splitting. Methods sharing
+ *   the parent's mm copy neither.
+ *
+ * Environment:
+ *   LRC_SPAWN_RSS=0,64m,1g        Parent buffer sizes (e.g. 20g for a big worker)
+ *   LRC_PAGE_SIZES=4k,thp          Backing of the parent buffer
+ *   LRC_PLACEMENT=scatter          Spawner thread placement
  */
 
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
+#include <sys/syscall.h>
 #include <sched.h>
 #include <spawn.h>
+#include "../core/lrc_alloc.h"
+#include "../core/histogram.h"
+#include "../core/topology.h"
+#include "../core/thread_pool.h"
+#include "../core/run_control.h"
+#include "../core/results.h"
+
+#define MIN_RUNS 5
+#define MAX_RUNS 20
+#define MAX_RSS_SIZES 16
+#define RUN_TARGET_NS 20000000ULL       // Spawns per worker sized to ~20 ms per run
+#define MIN_SPAWNS 4
+#define MAX_SPAWNS 200
+
+typedef enum {
+    SPAWN_FORK = 0,
+    SPAWN_VFORK,
+    SPAWN_CLONE_VM,
+    SPAWN_CLONE3_VFORK,
+    SPAWN_FORK_EXEC,
+    SPAWN_POSIX_SPAWN,
+    SPAWN_POSIX_SPAWN_VFORK,
+    SPAWN_METHOD_COUNT
+} spawn_method_t;
+
+static const char *method_names[SPAWN_METHOD_COUNT] = {
+    "fork", "vfork", "clone_vm", "clone3_vfork", "fork_exec", "posix_spawn", "posix_spawn_vfork"
+};
+
+/* Methods that duplicate the parent's page tables */
+static int method_copies_mm(spawn_method_t m) {
+    return m == SPAWN_FORK || m == SPAWN_FORK_EXEC;
+}
 
-#define ITERATIONS 1000
+/* Per-worker results, padded so spawners do not share lines */
+typedef struct {
+    histogram_t latency;
+    int failures;
+} __attribute__((aligned(64))) spawn_slot_t;
+
+typedef struct {
+    spawn_method_t method;
+    int spawns;               // Per worker and run
+    spawn_slot_t *slots;
+} spawn_job_t;
+
+// Spawner placement (LRC_PLACEMENT=compact|scatter|per_l3)
+static topology_t topo;
+static topo_placement_t placement;
+static int *thread_cpus;
+static int max_threads;
+static thread_pool_t pool;
 
 extern char **environ;
 
@@ -140,84 +224,396 @@ uint64_t test_posix_spawn(void) {
     return get_time_ns() - start;
 }
 
-void run_experiment(FILE *csv) {
-    int run = 0;
+#if defined(__x86_64__) && defined(SYS_clone3)
+/* struct clone_args, CLONE_ARGS_SIZE_VER0 */
+typedef struct {
+    uint64_t flags;
+    uint64_t pidfd;
+    uint64_t child_tid;
+    uint64_t parent_tid;
+    uint64_t exit_signal;
+    uint64_t stack;
+    uint64_t stack_size;
+    uint64_t tls;
+} spawn_clone_args_t;
+
+/*
+ * clone3(CLONE_VFORK | CLONE_VM) without a new stack: the child runs on
+ * the parent's stack while the parent is suspended, so it must not
+ * touch memory at all; it issues exit(0) straight from the same asm
+ * block, before any compiler-generated code can run.
+ */
+static pid_t clone3_vfork_exit(void) {
+    spawn_clone_args_t args;
+    long ret;
     
-    printf("Testing fork() (%d iterations)...\n", ITERATIONS);
-    for (int i = 0; i < ITERATIONS; i++) {
-        uint64_t start_ts = get_time_ns();
-        uint64_t runtime = test_fork();
-        
-        if (runtime > 0) {
-            double us = runtime / 1000.0;
-            fprintf(csv, "%d,fork,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-                   run++, start_ts, runtime, us);
+    memset(&args, 0, sizeof(args));
+    args.flags = CLONE_VFORK | CLONE_VM;
+    args.exit_signal = SIGCHLD;
+    __asm__ volatile(
+        "syscall\n\t"
+        "test %%rax, %%rax\n\t"
+        "jnz 1f\n\t"
+        "mov %[nr_exit], %%eax\n\t"
+        "xor %%edi, %%edi\n\t"
+        "syscall\n\t"
+        "1:"
+        : "=a"(ret)
+        : "0"((long)SYS_clone3), "D"(&args), "S"(sizeof(args)), [nr_exit] "i"(SYS_exit)
+        : "rcx", "r11", "memory");
+    if (ret < 0) {
+        errno = (int)-ret;
+        return -1;
+    }
+    return (pid_t)ret;
+}
+#else
+static pid_t clone3_vfork_exit(void) {
+    errno = ENOSYS;
+    return -1;
+}
+#endif
+
+// Test clone3(CLONE_VFORK | CLONE_VM)
+uint64_t test_clone3_vfork(void) {
+    uint64_t start = get_time_ns();
+    
+    pid_t pid = clone3_vfork_exit();
+    
+    if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("clone3");
+        return 0;
+    }
+    
+    return get_time_ns() - start;
+}
+
+// Test fork() followed by exec, the traditional launcher
+uint64_t test_fork_exec(void) {
+    uint64_t start = get_time_ns();
+    
+    char *argv[] = {"/bin/true", NULL};
+    pid_t pid = fork();
+    
+    if (pid == 0) {
+        execve("/bin/true", argv, environ);
+        _exit(127);
+    } else if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("fork");
+        return 0;
+    }
+    
+    return get_time_ns() - start;
+}
+
+// Test posix_spawn() forced through vfork (older glibc forks by default)
+uint64_t test_posix_spawn_vfork(void) {
+    uint64_t start = get_time_ns();
+    
+    pid_t pid;
+    char *argv[] = {"/bin/true", NULL};
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_USEVFORK);
+    
+    int ret = posix_spawn(&pid, "/bin/true", NULL, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    
+    if (ret == 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("posix_spawn");
+        return 0;
+    }
+    
+    return get_time_ns() - start;
+}
+
+static uint64_t spawn_once(spawn_method_t m) {
+    switch (m) {
+        case SPAWN_FORK:              return test_fork();
+        case SPAWN_VFORK:             return test_vfork();
+        case SPAWN_CLONE_VM:          return test_clone_vm();
+        case SPAWN_CLONE3_VFORK:      return test_clone3_vfork();
+        case SPAWN_FORK_EXEC:         return test_fork_exec();
+        case SPAWN_POSIX_SPAWN:       return test_posix_spawn();
+        case SPAWN_POSIX_SPAWN_VFORK: return test_posix_spawn_vfork();
+        default:                      return 0;
+    }
+}
+
+/* Pool task: one worker's share of a run */
+static void spawn_worker(int id, void *arg) {
+    spawn_job_t *job = arg;
+    spawn_slot_t *slot = &job->slots[id];
+    
+    for (int i = 0; i < job->spawns; i++) {
+        uint64_t ns = spawn_once(job->method);
+        if (ns == 0) {
+            slot->failures++;
+            continue;
         }
+        histogram_record(&slot->latency, ns);
     }
+}
+
+static void spawn_setup(int id, void *arg) {
+    spawn_slot_t *slot = &((spawn_job_t *)arg)->slots[id];
+    histogram_reset(&slot->latency);
+    slot->failures = 0;
+}
+
+/*
+ * VmPTE of a freshly forked child: the page tables fork() allocated.
+ */
+static uint64_t fork_pte_bytes(void) {
+    int fds[2];
+    uint64_t kb = 0;
     
-    printf("Testing vfork() (%d iterations)...\n", ITERATIONS);
-    for (int i = 0; i < ITERATIONS; i++) {
-        uint64_t start_ts = get_time_ns();
-        uint64_t runtime = test_vfork();
-        
-        if (runtime > 0) {
-            double us = runtime / 1000.0;
-            fprintf(csv, "%d,vfork,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-                   run++, start_ts, runtime, us);
+    if (pipe(fds) != 0) return 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        char line[256];
+        uint64_t child_kb = 0;
+        FILE *f = fopen("/proc/self/status", "r");
+        while (f && fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "VmPTE: %" SCNu64 " kB", &child_kb) == 1) break;
         }
+        if (f) fclose(f);
+        if (write(fds[1], &child_kb, sizeof(child_kb)) != sizeof(child_kb)) _exit(1);
+        _exit(0);
+    }
+    close(fds[1]);
+    if (pid > 0) {
+        if (read(fds[0], &kb, sizeof(kb)) != sizeof(kb)) kb = 0;
+        waitpid(pid, NULL, 0);
+    }
+    close(fds[0]);
+    return kb * 1024;
+}
+
+/*
+ * Entries fork() fills for this process's anonymous memory, in bytes.
+ */
+static uint64_t anon_pte_bytes(void) {
+    char line[256];
+    uint64_t anon_kb = 0, huge_kb = 0, kb;
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+    if (!f) return 0;
+    
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "Anonymous: %" SCNu64 " kB", &kb) == 1) anon_kb = kb;
+        else if (sscanf(line, "AnonHugePages: %" SCNu64 " kB", &kb) == 1) huge_kb = kb;
+    }
+    fclose(f);
+    if (huge_kb > anon_kb) huge_kb = anon_kb;
+    return ((anon_kb - huge_kb) / 4 + huge_kb / 2048) * sizeof(uint64_t);
+}
+
+static size_t parse_size(const char *tok) {
+    char *end;
+    double value = strtod(tok, &end);
+    
+    switch (*end) {
+    case 'k': case 'K': return (size_t)(value * 1024);
+    case 'm': case 'M': return (size_t)(value * 1024 * 1024);
+    case 'g': case 'G': return (size_t)(value * 1024 * 1024 * 1024);
+    default: return (size_t)value;
     }
+}
+
+static int parse_rss_sizes(size_t *out) {
+    const char *env = getenv("LRC_SPAWN_RSS");
+    char *copy = strdup(env && *env ? env : "0,64m,1g");
+    int count = 0;
     
-    printf("Testing clone(CLONE_VM) (%d iterations)...\n", ITERATIONS);
-    for (int i = 0; i < ITERATIONS; i++) {
+    for (char *tok = strtok(copy, ","); tok && count < MAX_RSS_SIZES; tok = strtok(NULL, ",")) {
+        out[count++] = parse_size(tok);
+    }
+    free(copy);
+    return count;
+}
+
+/*
+ * One (method, parent, spawners) point under run control; one row per run.
+ */
+static void run_point(results_t *csv, spawn_method_t m, size_t rss, const char *pages,
+                      int threads, uint64_t pte_bytes, uint64_t pgtable_bytes,
+                      spawn_slot_t *slots) {
+    // Size runs from one untimed spawn so big parents do not take minutes
+    uint64_t one = spawn_once(m);
+    if (one == 0) return;
+    uint64_t spawns = RUN_TARGET_NS / one;
+    if (spawns < MIN_SPAWNS) spawns = MIN_SPAWNS;
+    if (spawns > MAX_SPAWNS) spawns = MAX_SPAWNS;
+    
+    spawn_job_t job = { m, (int)spawns, slots };
+    histogram_t merged;
+    run_control_t rc;
+    double rate = 0.0;
+    
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         uint64_t start_ts = get_time_ns();
-        uint64_t runtime = test_clone_vm();
+        thread_pool_run(&pool, threads, spawn_setup, spawn_worker, &job);
+        uint64_t elapsed = thread_pool_elapsed_ns(&pool);
         
-        if (runtime > 0) {
-            double us = runtime / 1000.0;
-            fprintf(csv, "%d,clone_vm,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-                   run++, start_ts, runtime, us);
+        int failures = 0;
+        histogram_reset(&merged);
+        for (int t = 0; t < threads; t++) {
+            histogram_merge(&merged, &slots[t].latency);
+            failures += slots[t].failures;
+        }
+        uint64_t done = merged.count;
+        if (failures > 0 || done == 0) {
+            printf("    %s: %d spawns failed, point skipped\n", method_names[m], failures);
+            return;
+        }
+        double us_per_spawn = merged.sum / 1000.0 / done;
+        if (!run_control_add(&rc, us_per_spawn)) continue;   // Warmup
+        rate = done * 1e9 / elapsed;
+        
+        results_u64(csv, run_control_index(&rc));
+        results_str(csv, method_names[m]);
+        results_u64(csv, rss);
+        results_str(csv, pages);
+        results_u64(csv, (uint64_t)threads);
+        results_str(csv, topology_placement_name(placement));
+        results_runtime(csv, start_ts, elapsed);
+        results_u64(csv, done);
+        results_f64(csv, us_per_spawn);
+        results_f64(csv, histogram_percentile(&merged, 50.0) / 1000.0);
+        results_f64(csv, histogram_percentile(&merged, 99.0) / 1000.0);
+        results_f64(csv, rate);
+        results_u64(csv, method_copies_mm(m) ? pte_bytes : 0);
+        results_u64(csv, method_copies_mm(m) ? pgtable_bytes : 0);
+        results_histogram(csv, &merged);
+    }
+    printf("    %-18s %2d spawners: %9.1f us/spawn %9.0f spawns/s %4d runs\n",
+           method_names[m], threads, rc.median, rate, rc.runs);
+}
+
+/*
+ * All methods and spawner counts from one parent configuration.
+ */
+static void run_parent(results_t *csv, size_t rss, lrc_pages_t pages, int has_buffer,
+                       const int *counts, int num_counts, spawn_slot_t *slots) {
+    void *buf = NULL;
+    const char *pages_name = has_buffer ? lrc_pages_name(pages) : "none";
+    
+    if (has_buffer) {
+        lrc_alloc_opts_t opts = { -1, pages, 1 };
+        buf = lrc_alloc(rss, &opts);
+        if (!buf) {
+            fprintf(stderr, "Skipping %zu MB %s parent: allocation failed\n",
+                    rss >> 20, pages_name);
+            return;
         }
     }
     
-    printf("Testing posix_spawn() (%d iterations)...\n", ITERATIONS / 10);
-    for (int i = 0; i < ITERATIONS / 10; i++) {  // Fewer iterations (slower)
-        uint64_t start_ts = get_time_ns();
-        uint64_t runtime = test_posix_spawn();
-        
-        if (runtime > 0) {
-            double us = runtime / 1000.0;
-            fprintf(csv, "%d,posix_spawn,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-                   run++, start_ts, runtime, us);
+    uint64_t pte_bytes = anon_pte_bytes();
+    uint64_t pgtable_bytes = fork_pte_bytes();
+    printf("Parent RSS %zu MB (%s", rss >> 20, pages_name);
+    if (has_buffer) printf(", %.0f%% huge", lrc_alloc_huge_fraction(buf, rss) * 100.0);
+    printf("), fork copies %" PRIu64 " KB of entries, allocates %" PRIu64 " KB of page tables:\n",
+           pte_bytes / 1024, pgtable_bytes / 1024);
+    
+    for (int m = 0; m < SPAWN_METHOD_COUNT; m++) {
+        for (int c = 0; c < num_counts; c++) {
+            run_point(csv, (spawn_method_t)m, rss, pages_name, counts[c], pte_bytes,
+                      pgtable_bytes, slots);
         }
     }
+    
+    if (buf) lrc_free(buf, rss, pages);
+}
+
+void run_experiment(results_t *csv) {
+    size_t sizes[MAX_RSS_SIZES];
+    int num_sizes = parse_rss_sizes(sizes);
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
+    int counts[32];
+    int num_counts = topology_thread_counts(max_threads, counts, 32);
+    
+    spawn_slot_t *slots = aligned_alloc(64, sizeof(spawn_slot_t) * max_threads);
+    if (!slots) {
+        perror("aligned_alloc");
+        return;
+    }
+    
+    for (int s = 0; s < num_sizes; s++) {
+        if (sizes[s] == 0) {
+            run_parent(csv, 0, LRC_PAGES_DEFAULT, 0, counts, num_counts, slots);
+            continue;
+        }
+        for (int p = 0; p < num_pages; p++) {
+            run_parent(csv, sizes[s], pages[p], 1, counts, num_counts, slots);
+        }
+    }
+    free(slots);
 }
 
 int main(void) {
-    FILE *csv = fopen("data/process_creation.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    placement = topology_placement_from_env(TOPO_PLACE_SCATTER);
+    thread_cpus = malloc(topo.num_cpus * sizeof(int));
+    max_threads = topology_place(&topo, placement, topo.num_cpus, thread_cpus);
+    if (thread_pool_create(&pool, max_threads, thread_cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "time_microseconds\n");
+    results_t csv;
+    if (results_open(&csv, "data/process_creation.csv", SPAWN_METHOD_COUNT * 8 * MIN_RUNS) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_column(&csv, "parent_rss_bytes", RESULT_U64, 0);
+    results_add_column(&csv, "pages", RESULT_STR, 0);
+    results_add_column(&csv, "spawners", RESULT_U64, 0);
+    results_add_column(&csv, "thread_placement", RESULT_STR, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "spawns", RESULT_U64, 0);
+    results_add_column(&csv, "time_microseconds", RESULT_F64, 2);
+    results_add_column(&csv, "p50_us", RESULT_F64, 2);
+    results_add_column(&csv, "p99_us", RESULT_F64, 2);
+    results_add_column(&csv, "spawns_per_sec", RESULT_F64, 1);
+    results_add_column(&csv, "pte_bytes_copied", RESULT_U64, 0);
+    results_add_column(&csv, "pgtable_bytes", RESULT_U64, 0);
+    results_add_column(&csv, "latency_hist", RESULT_STR, 0);
     
     printf("Process Creation Overhead Benchmark\n");
     printf("===================================\n\n");
-    printf("Iterations: %d per test\n\n", ITERATIONS);
+    printf("Available CPUs: %d (placement: %s, up to %d spawners)\n\n",
+           topo.num_cpus, topology_placement_name(placement), max_threads);
+    
+    run_experiment(&csv);
     
-    run_experiment(csv);
+    thread_pool_destroy(&pool);
+    free(thread_cpus);
+    topology_destroy(&topo);
     
-    fclose(csv);
+    if (results_close(&csv) != 0) return 1;
     
     printf("\nResults saved to data/process_creation.csv\n");
     printf("\nExpected patterns:\n");
-    printf("  fork(): 50-200 us (full COW setup)\n");
+    printf("  fork(): 50-200 us (full COW setup), growing with parent RSS\n");
     printf("  vfork(): 5-20 us (minimal, parent blocks)\n");
     printf("  clone(CLONE_VM): 10-30 us (thread-like)\n");
-    printf("  posix_spawn(): Similar to vfork(), optimized for exec\n");
+    printf("  clone3_vfork, posix_spawn(): flat in parent RSS, optimized for exec\n");
+    printf("  THP parents: ~512x fewer page-table bytes copied than 4k\n");
+    printf("  Concurrent forks: spawns/s flattens (parent mmap lock)\n");
     printf("\nNote: Process creation is expensive compared to threads!\n");
     
     return 0;
@@ -0,0 +1,354 @@
+/*
+ * queue_handoff.c - Cross-thread queue handoff experiment
+ *
+ * Hypothesis:
+ *   Handing an item to another thread costs at least one cache-line
+ *   transfer between their cores, so latency follows the core-to-core
+ *   distance (SMT sibling < same L3 < other socket). On top of that the
+ *   queue adds its own synchronization: a lock-free SPSC ring touches
+ *   the shared indices least, MPMC pays a CAS per item, mutex queues
+ *   serialize everything, and sleeping consumers (futex, eventfd) add a
+ *   wakeup only when the queue runs dry. Batching amortizes all of it.
+ *
+ * Method:
+ *   For each placement, producer/consumer configuration and batch size,
+ *   run every queue of core/queues.h: producers push stamped items in
+ *   batches, consumers pop up to a batch at a time and record each
+ *   item's age (push stamp to pop, TSC) in a histogram. Workers come
+ *   from a pinned pool created per placement and configuration; the run
+ *   is first barrier release to last finish.
+ *
+ * Variables:
+ *   - Queue type (spsc only for 1:1)
+ *   - Producers:consumers (LRC_QUEUE_THREADS, default 1:1,2:2,4:4)
+ *   - Batch size (LRC_QUEUE_BATCHES, default 1,8,64)
+ *   - Placement (LRC_QUEUE_PLACEMENTS, default smt,l3,cross_socket,unpinned):
+ *       smt           producer i and consumer i on the two siblings of core i
+ *       l3            all threads in one L3, separate cores first
+ *       cross_socket  producers on package 0, consumers on package 1
+ *       unpinned      scheduler's choice (the usual deployment)
+ *   - Items per producer (LRC_QUEUE_ITEMS, default 200000), ring size
+ *     (LRC_QUEUE_CAPACITY, default 1024)
+ *
+ * Expected outcome:
+ *   - spsc 1:1: tens of millions of items/s unbatched, p50 ~ one line
+ *     transfer (~20 ns smt, ~50-100 ns l3, 200+ ns cross-socket)
+ *   - mpmc: slower than spsc at 1:1, degrades with producer count as
+ *     the enqueue position bounces
+ *   - mutex: lowest throughput, long tails once consumers sleep
+ *   - futex/eventfd: mpmc numbers while busy; when the queue drains a
+ *     wakeup adds microseconds (eventfd slightly more than futex)
+ *   - Batch 64: items/s up several times for every queue, p50 grows by
+ *     the time to fill a batch
+ *
+ * Limitations:
+ *   - Items are bare 64-bit stamps: no payload copy, no work per item
+ *   - Latency includes queueing: with a saturated consumer items wait
+ *     behind up to capacity others (compare p50 at low load by adding
+ *     producers slowly, not here)
+ *   - Placements that do not fit the machine are skipped
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "../core/queues.h"
+#include "../core/thread_pool.h"
+#include "../core/topology.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/tsc.h"
+
+#define MIN_RUNS 3
+#define MAX_RUNS 10
+#define MAX_CONFIGS 16
+#define MAX_BATCHES 16
+#define DEFAULT_ITEMS 200000
+#define DEFAULT_CAPACITY 1024
+
+typedef enum {
+    PLACE_SMT = 0,
+    PLACE_L3,
+    PLACE_CROSS_SOCKET,
+    PLACE_UNPINNED,
+    PLACE_COUNT
+} placement_t;
+
+static const char *placement_names[PLACE_COUNT] = { "smt", "l3", "cross_socket", "unpinned" };
+
+typedef struct {
+    int producers;
+    int consumers;
+} thread_config_t;
+
+static topology_t topo;
+
+/*
+ * "1:1,2:2,4:1"
+ */
+static int parse_configs(thread_config_t *out) {
+    const char *env = getenv("LRC_QUEUE_THREADS");
+    char *copy = strdup(env && *env ? env : "1:1,2:2,4:4");
+    int count = 0;
+    
+    for (char *tok = strtok(copy, ","); tok && count < MAX_CONFIGS; tok = strtok(NULL, ",")) {
+        int p, c;
+        if (sscanf(tok, "%d:%d", &p, &c) == 2 && p > 0 && c > 0) {
+            out[count].producers = p;
+            out[count].consumers = c;
+            count++;
+        }
+    }
+    free(copy);
+    return count;
+}
+
+static int parse_batches(int *out) {
+    const char *env = getenv("LRC_QUEUE_BATCHES");
+    char *copy = strdup(env && *env ? env : "1,8,64");
+    int count = 0;
+    
+    for (char *tok = strtok(copy, ","); tok && count < MAX_BATCHES; tok = strtok(NULL, ",")) {
+        int b = atoi(tok);
+        if (b >= 1 && b <= QUEUE_MAX_BATCH) out[count++] = b;
+    }
+    free(copy);
+    return count;
+}
+
+static int parse_placements(int *enabled) {
+    const char *env = getenv("LRC_QUEUE_PLACEMENTS");
+    char *copy = strdup(env && *env ? env : "smt,l3,cross_socket,unpinned");
+    int count = 0;
+    
+    memset(enabled, 0, PLACE_COUNT * sizeof(int));
+    for (char *tok = strtok(copy, ","); tok; tok = strtok(NULL, ",")) {
+        for (int p = 0; p < PLACE_COUNT; p++) {
+            if (strcmp(tok, placement_names[p]) == 0 && !enabled[p]) {
+                enabled[p] = 1;
+                count++;
+            }
+        }
+    }
+    free(copy);
+    return count;
+}
+
+static uint64_t env_u64(const char *name, uint64_t def) {
+    const char *v = getenv(name);
+    uint64_t n = v && *v ? strtoull(v, NULL, 0) : 0;
+    return n > 0 ? n : def;
+}
+
+/*
+ * Up to max CPUs of one domain, first SMT sibling of each core first.
+ */
+static int domain_cpus_by_core(topo_level_t level, int id, int *cpus, int max) {
+    int count = 0;
+    for (int smt = 0; smt < 8 && count < max; smt++) {
+        for (int i = 0; i < topo.num_cpus && count < max; i++) {
+            const topo_cpu_t *c = &topo.cpus[i];
+            if (c->domain[level] == id && c->smt_index == smt) cpus[count++] = c->cpu;
+        }
+    }
+    return count;
+}
+
+/*
+ * CPU ids for pool workers (producers first, then consumers).
+ * Returns 0 when the placement does not fit this machine.
+ */
+static int place_threads(placement_t place, const thread_config_t *cfg, int *cpus) {
+    int p = cfg->producers, c = cfg->consumers, n = p + c;
+    
+    switch (place) {
+        case PLACE_SMT: {
+            // Pair producer i with consumer i on the siblings of one core
+            if (p != c) return 0;
+            int pairs = 0;
+            for (int core = 0; core < topo.num_domains[TOPO_LEVEL_CORE] && pairs < p; core++) {
+                int sib[2];
+                if (topology_domain_cpus(&topo, TOPO_LEVEL_CORE, core, sib, 2) < 2) continue;
+                cpus[pairs] = sib[0];
+                cpus[p + pairs] = sib[1];
+                pairs++;
+            }
+            return pairs == p;
+        }
+        case PLACE_L3:
+            for (int l3 = 0; l3 < topo.num_domains[TOPO_LEVEL_L3]; l3++) {
+                if (domain_cpus_by_core(TOPO_LEVEL_L3, l3, cpus, n) == n) return 1;
+            }
+            return 0;
+        case PLACE_CROSS_SOCKET:
+            if (topo.num_domains[TOPO_LEVEL_PACKAGE] < 2) return 0;
+            return domain_cpus_by_core(TOPO_LEVEL_PACKAGE, 0, cpus, p) == p &&
+                   domain_cpus_by_core(TOPO_LEVEL_PACKAGE, 1, cpus + p, c) == c;
+        default:
+            return 1;
+    }
+}
+
+static void run_config(results_t *out, placement_t place, const thread_config_t *cfg,
+                       const int *batches, int num_batches, uint64_t items, size_t capacity) {
+    int n = cfg->producers + cfg->consumers;
+    int *cpus = malloc(sizeof(int) * n);
+    thread_pool_t pool;
+    
+    if (!cpus) return;
+    if (!place_threads(place, cfg, cpus)) {
+        printf("  %s %d:%d: does not fit this machine, skipped\n",
+               placement_names[place], cfg->producers, cfg->consumers);
+        free(cpus);
+        return;
+    }
+    if (thread_pool_create(&pool, n, place == PLACE_UNPINNED ? NULL : cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
+        free(cpus);
+        return;
+    }
+    
+    printf("%s, %d producer(s) : %d consumer(s)", placement_names[place],
+           cfg->producers, cfg->consumers);
+    if (place != PLACE_UNPINNED) {
+        printf(" (CPUs");
+        for (int i = 0; i < n; i++) printf(" %d", cpus[i]);
+        printf(")");
+    }
+    printf("\n  %-8s %5s %14s %9s %9s %10s %10s\n",
+           "queue", "batch", "items/sec", "p50 ns", "p99 ns", "max ns", "sleeps");
+    
+    for (int b = 0; b < num_batches; b++) {
+        queue_params_t params = { cfg->producers, cfg->consumers, batches[b],
+                                  capacity < (size_t)batches[b] ? (size_t)batches[b] : capacity,
+                                  items };
+        
+        for (int type = 0; type < QUEUE_TYPE_COUNT; type++) {
+            if (!queue_type_multi((queue_type_t)type) && (cfg->producers > 1 || cfg->consumers > 1)) {
+                continue;
+            }
+            queue_result_t result;
+            run_control_t rc;
+            double sum_rate = 0.0;
+            uint64_t p50 = 0, p99 = 0, max = 0, sleeps = 0;
+            
+            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+            while (run_control_next(&rc)) {
+                uint64_t start_ts = tsc_clock_ns();
+                if (queue_bench_run(&pool, (queue_type_t)type, &params, &result) != 0) {
+                    perror(queue_type_name((queue_type_t)type));
+                    break;
+                }
+                uint64_t expected = (uint64_t)cfg->producers * items;
+                if (result.items != expected) {
+                    fprintf(stderr, "%s: %lu items consumed, expected %lu (queue is broken)\n",
+                            queue_type_name((queue_type_t)type), result.items, expected);
+                }
+                if (!run_control_add(&rc, result.runtime_ns)) continue;   // Warmup
+                
+                double rate = result.items / (result.runtime_ns / 1e9);
+                results_u64(out, run_control_index(&rc));
+                results_str(out, queue_type_name((queue_type_t)type));
+                results_str(out, placement_names[place]);
+                results_u64(out, cfg->producers);
+                results_u64(out, cfg->consumers);
+                results_u64(out, params.batch);
+                results_u64(out, params.capacity);
+                results_runtime(out, start_ts, result.runtime_ns);
+                results_u64(out, result.items);
+                results_f64(out, rate);
+                results_u64(out, result.p50_ns);
+                results_u64(out, result.p90_ns);
+                results_u64(out, result.p99_ns);
+                results_u64(out, result.p999_ns);
+                results_u64(out, result.max_ns);
+                results_u64(out, result.sleeps);
+                results_histogram(out, &result.latency);
+                
+                sum_rate += rate;
+                p50 += result.p50_ns;
+                p99 += result.p99_ns;
+                sleeps += result.sleeps;
+                if (result.max_ns > max) max = result.max_ns;
+            }
+            
+            if (rc.runs == 0) continue;
+            printf("  %-8s %5d %14.0f %9lu %9lu %10lu %10lu  (%d runs)\n",
+                   queue_type_name((queue_type_t)type), params.batch, sum_rate / rc.runs,
+                   p50 / rc.runs, p99 / rc.runs, max, sleeps / rc.runs, rc.runs);
+        }
+    }
+    
+    thread_pool_destroy(&pool);
+    free(cpus);
+}
+
+int main(void) {
+    thread_config_t configs[MAX_CONFIGS];
+    int batches[MAX_BATCHES];
+    int enabled[PLACE_COUNT];
+    int num_configs = parse_configs(configs);
+    int num_batches = parse_batches(batches);
+    parse_placements(enabled);
+    uint64_t items = env_u64("LRC_QUEUE_ITEMS", DEFAULT_ITEMS);
+    size_t capacity = env_u64("LRC_QUEUE_CAPACITY", DEFAULT_CAPACITY);
+    results_t out;
+    
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    tsc_init();
+    
+    if (results_open(&out, "../data/queue_handoff.csv",
+                     (size_t)PLACE_COUNT * num_configs * num_batches * QUEUE_TYPE_COUNT * MIN_RUNS) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "queue", RESULT_STR, 0);
+    results_add_column(&out, "placement", RESULT_STR, 0);
+    results_add_column(&out, "producers", RESULT_U64, 0);
+    results_add_column(&out, "consumers", RESULT_U64, 0);
+    results_add_column(&out, "batch", RESULT_U64, 0);
+    results_add_column(&out, "capacity", RESULT_U64, 0);
+    results_add_metrics_columns(&out);
+    results_add_column(&out, "items", RESULT_U64, 0);
+    results_add_column(&out, "items_per_sec", RESULT_F64, 0);
+    results_add_column(&out, "p50_ns", RESULT_U64, 0);
+    results_add_column(&out, "p90_ns", RESULT_U64, 0);
+    results_add_column(&out, "p99_ns", RESULT_U64, 0);
+    results_add_column(&out, "p999_ns", RESULT_U64, 0);
+    results_add_column(&out, "max_ns", RESULT_U64, 0);
+    results_add_column(&out, "sleeps", RESULT_U64, 0);
+    results_add_column(&out, "latency_hist", RESULT_STR, 0);
+    
+    printf("Cross-Thread Queue Handoff\n");
+    printf("==========================\n\n");
+    topology_print(&topo);
+    printf("Timer: %s, %lu items per producer, ring of %zu slots\n\n",
+           tsc_source_name(), items, capacity);
+    
+    for (int place = 0; place < PLACE_COUNT; place++) {
+        if (!enabled[place]) continue;
+        for (int c = 0; c < num_configs; c++) {
+            run_config(&out, (placement_t)place, &configs[c], batches, num_batches, items, capacity);
+        }
+    }
+    
+    topology_destroy(&topo);
+    if (results_close(&out) != 0) return 1;
+    
+    printf("\nResults saved to ../data/queue_handoff.csv\n");
+    printf("\nAnalyze with:\n");
+    printf("  python3 ../analyze/histogram.py ../data/queue_handoff.csv --group queue\n");
+    printf("\nExpected patterns:\n");
+    printf("  spsc > mpmc > futex/eventfd > mutex in items/sec at 1:1\n");
+    printf("  p50: smt < l3 < cross_socket (one line transfer per handoff)\n");
+    printf("  batch 64: several times the items/sec of batch 1\n");
+    
+    return 0;
+}
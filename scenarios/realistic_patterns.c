@@ -28,140 +28,687 @@
  *   - Memory-heavy: Low IPC, high cache misses
  *   - Phased: Warmup effects visible
  *   - Bursty: Variance in metrics
+ *   - Private: vs_single drops once threads x working set exceeds
+ *     the shared LLC
+ *   - Shared read-only: total throughput scales (one copy in LLC);
+ *     with writes, lines bounce between cores and vs_single falls
+ *   - Partitioning: unpartitioned p99 well above alone; CAT brings it
+ *     most of the way back, MBA recovers the part caused by DRAM
+ *     queueing rather than eviction
+ *
+ *   6. Zipf (s = 0.99) and hotspot (20% of keys, 80% of accesses)
+ *      key distributions at the balanced ratio
+ *   7. Zipf over the whole buffer with keys drawn in the loop (no
+ *      index buffer)
+ *   8. Multithreaded (pinned pool, LRC_PLACEMENT, default compact):
+ *      private buffers per thread, or one shared buffer with 0%, 20%
+ *      and 100% of accesses written back (LRC_MIXED_WRITE_PCT
+ *      overrides the list). Per-thread throughput goes to
+ *      realistic_patterns_mt.csv with vs_single, the ratio to the same
+ *      configuration on one thread: the noisy-neighbour slowdown from
+ *      LLC sharing and coherence traffic.
+ *   9. Cache partitioning (needs 2 CPUs): a latency-sensitive thread
+ *      serving 64-access requests next to a streaming neighbour, alone,
+ *      unpartitioned, with L3 ways split through resctrl (CAT), and with
+ *      the neighbour's memory bandwidth also throttled (MBA). Request
+ *      latency histograms and per-group LLC occupancy / MBM bytes go to
+ *      realistic_patterns_partition.csv. LRC_RDT_BG_WAYS (default 2)
+ *      and LRC_RDT_BG_MBA (percent, default 20) size the neighbour's
+ *      share; configurations resctrl cannot provide are skipped.
+ *
+ * Key streams are seeded (LRC_SEED, default 42), so every run and every
+ * invocation replays the same accesses; LRC_KEY_DIST and
+ * LRC_KEYS_INLOOP change the distribution of patterns 1-5.
  *
  * Limitations:
  *   - Still synthetic (not real application)
  *   - Simplified compute (no branches, no calls)
- *   - Pre-generated access pattern
+ *   - In-loop key draws add their own cost (~30 ns for zipf)
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
 #include "../core/metrics.h"
+#include "../core/mixed_workload.h"
+#include "../core/resctrl.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/thread_pool.h"
+#include "../core/topology.h"
+#include "../core/tsc.h"
+#include "../core/workloads_api.h"
 
-extern int mixed_workload_init(void *w, size_t buffer_size, size_t working_set, int compute_ratio);
-extern void mixed_workload_cleanup(void *w);
-extern uint64_t mixed_workload_run(void *w, uint64_t iterations);
-extern uint64_t mixed_workload_phased(void *w, uint64_t iterations, int phases);
-extern uint64_t mixed_workload_bursty(void *w, uint64_t iterations);
 extern int pin_to_cpu(int cpu);
 
-typedef struct {
-    uint64_t *buffer;
-    size_t buffer_size;
-    uint64_t *indices;
-    size_t working_set_size;
-    int compute_ratio;
-    uint64_t seed;
-} mixed_workload_t;
-
 #define MB (1024ULL * 1024ULL)
 #define BUFFER_SIZE (16 * MB)
 #define WORKING_SET 10000
 #define ITERATIONS 1000000ULL
-#define RUNS 10
+#define MIN_RUNS 5
+#define MAX_RUNS 30
+#define MT_MIN_RUNS 3
+#define MT_MAX_RUNS 10
+#define MT_WORKING_SET 32768        // Keys (cache lines) per thread or shared, 2 MB
+#define MT_BUFFER_SIZE (64 * MB)    // Per thread (private) or in total (shared)
+#define MT_MAX_MODES 8
+#define PART_MIN_RUNS 3
+#define PART_MAX_RUNS 10
+#define PART_REQUESTS 20000         // Requests per run on the latency-sensitive thread
+#define PART_REQUEST_ACCESSES 64    // Accesses per request
+#define PART_WORKING_SET 16384      // Keys of the latency-sensitive thread, 1 MB of lines
+#define PART_STREAM_SIZE (256 * MB) // Neighbour's streaming buffer
+#define PART_STREAM_CHUNK (1 * MB)  // Neighbour checks for the stop flag per chunk
+#define CACHE_LINE 64
+
+/*
+ * Balanced ratio with an explicit key distribution; one row per run.
+ */
+static void run_keys_pattern(results_t *out, const char *label, const mixed_keys_params_t *keys,
+                             size_t working_set) {
+    workload_metrics_t metrics;
+    run_control_t rc;
+    
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
+        mixed_workload_t work;
+        if (mixed_workload_init_keys(&work, BUFFER_SIZE, working_set, 3, keys) != 0) {
+            perror("mixed_workload_init_keys");
+            break;
+        }
+        
+        metrics_init(&metrics);
+        uint64_t result = mixed_workload_run(&work, ITERATIONS);
+        metrics_finish(&metrics);
+        mixed_workload_cleanup(&work);
+        (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(out, run_control_index(&rc));
+        results_str(out, label);
+        results_u64(out, 3);
+        results_str(out, mixed_keys_name(keys->dist));
+        results_u64(out, keys->inloop);
+        results_metrics(out, &metrics);
+    }
+    run_control_report(&rc, label);
+}
+
+/*
+ * Mixed workload on 1..N pinned threads, private or shared buffers.
+ * One row per thread per run.
+ */
+static int run_multithreaded(const mixed_keys_params_t *keys) {
+    topology_t topo;
+    thread_pool_t pool;
+    
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return -1;
+    }
+    topo_placement_t placement = topology_placement_from_env(TOPO_PLACE_COMPACT);
+    int thread_cpus[topo.num_cpus];
+    int max_threads = topology_place(&topo, placement, topo.num_cpus, thread_cpus);
+    if (thread_pool_create(&pool, max_threads, thread_cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
+        topology_destroy(&topo);
+        return -1;
+    }
+    
+    // Modes: private (all writes) and shared at each write share
+    int write_pcts[MT_MAX_MODES] = { 0, 20, 100 };
+    int num_pcts = 3;
+    const char *env = getenv("LRC_MIXED_WRITE_PCT");
+    if (env && *env) {
+        num_pcts = 0;
+        for (const char *p = env; *p && num_pcts < MT_MAX_MODES - 1; ) {
+            char *end;
+            long v = strtol(p, &end, 10);
+            if (end == p) break;
+            if (v >= 0 && v <= 100) write_pcts[num_pcts++] = (int)v;
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+    
+    int thread_counts[32];
+    int num_counts = topology_thread_counts(max_threads, thread_counts, 32);
+    
+    results_t out;
+    size_t rows = 0;
+    for (int t = 0; t < num_counts; t++) rows += thread_counts[t];
+    if (results_open(&out, "../data/realistic_patterns_mt.csv",
+                     rows * (1 + num_pcts) * MT_MAX_RUNS) != 0) {
+        perror("results_open");
+        thread_pool_destroy(&pool);
+        topology_destroy(&topo);
+        return -1;
+    }
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "threads", RESULT_U64, 0);
+    results_add_column(&out, "sharing", RESULT_STR, 0);
+    results_add_column(&out, "write_pct", RESULT_U64, 0);
+    results_add_column(&out, "key_dist", RESULT_STR, 0);
+    results_add_column(&out, "thread_placement", RESULT_STR, 0);
+    results_add_column(&out, "thread", RESULT_U64, 0);
+    results_add_column(&out, "cpu", RESULT_I64, 0);
+    results_add_column(&out, "working_set", RESULT_U64, 0);
+    results_add_column(&out, "buffer_bytes", RESULT_U64, 0);
+    results_add_column(&out, "iterations", RESULT_U64, 0);
+    results_add_column(&out, "thread_runtime_ns", RESULT_U64, 0);
+    results_add_column(&out, "thread_ops_per_sec", RESULT_F64, 0);
+    results_add_column(&out, "elapsed_ns", RESULT_U64, 0);
+    results_add_column(&out, "total_ops_per_sec", RESULT_F64, 0);
+    results_add_column(&out, "vs_single", RESULT_F64, 3);
+    
+    printf("\nMultithreaded mixed workload (up to %d threads, placement: %s, %d keys)...\n",
+           max_threads, topology_placement_name(placement), MT_WORKING_SET);
+    printf("  %-8s %-14s %14s %14s %10s\n", "threads", "sharing", "total ops/s",
+           "min thread", "vs single");
+    
+    mixed_mt_thread_t per_thread[topo.num_cpus];
+    double single[MT_MAX_MODES] = { 0 };   // Mean ops/s on one thread, per mode
+    
+    for (int t = 0; t < num_counts; t++) {
+        int threads = thread_counts[t];
+        
+        for (int m = 0; m <= num_pcts; m++) {
+            mixed_mt_params_t params = {
+                .threads = threads,
+                .shared = m > 0,
+                .write_pct = m > 0 ? write_pcts[m - 1] : 100,
+                .buffer_size = MT_BUFFER_SIZE,
+                .working_set = MT_WORKING_SET,
+                .compute_ratio = 3,
+                .iterations = ITERATIONS,
+                .keys = *keys,
+            };
+            const char *sharing = params.shared ? "shared" : "private";
+            double sum_total = 0.0, min_thread = 0.0;
+            run_control_t rc;
+            
+            run_control_begin(&rc, MT_MIN_RUNS, MT_MAX_RUNS);
+            while (run_control_next(&rc)) {
+                if (mixed_workload_mt_run(&pool, &params, per_thread) != 0) {
+                    fprintf(stderr, "%s run with %d threads failed\n", sharing, threads);
+                    break;
+                }
+                uint64_t elapsed = thread_pool_elapsed_ns(&pool);
+                if (!run_control_add(&rc, elapsed)) continue;   // Warmup
+                
+                double total = 0.0, slowest = 0.0;
+                for (int i = 0; i < threads; i++) {
+                    total += per_thread[i].ops_per_sec;
+                    if (i == 0 || per_thread[i].ops_per_sec < slowest) {
+                        slowest = per_thread[i].ops_per_sec;
+                    }
+                }
+                double ref = threads == 1 ? total : single[m];
+                
+                for (int i = 0; i < threads; i++) {
+                    results_u64(&out, run_control_index(&rc));
+                    results_u64(&out, threads);
+                    results_str(&out, sharing);
+                    results_u64(&out, params.write_pct);
+                    results_str(&out, mixed_keys_name(keys->dist));
+                    results_str(&out, topology_placement_name(placement));
+                    results_u64(&out, i);
+                    results_i64(&out, per_thread[i].cpu);
+                    results_u64(&out, params.working_set);
+                    results_u64(&out, params.buffer_size);
+                    results_u64(&out, per_thread[i].ops);
+                    results_u64(&out, per_thread[i].runtime_ns);
+                    results_f64(&out, per_thread[i].ops_per_sec);
+                    results_u64(&out, elapsed);
+                    results_f64(&out, total);
+                    results_f64(&out, ref > 0 ? per_thread[i].ops_per_sec / ref : 0.0);
+                }
+                sum_total += total;
+                min_thread += slowest;
+            }
+            if (threads == 1 && rc.runs > 0) {
+                single[m] = sum_total / rc.runs;
+            }
+            
+            if (rc.runs == 0) continue;
+            char label[32];
+            snprintf(label, sizeof(label), "%s/w%d", sharing, params.write_pct);
+            printf("  %-8d %-14s %14.0f %14.0f %10.3f  (%d runs)\n", threads, label,
+                   sum_total / rc.runs, min_thread / rc.runs,
+                   single[m] > 0 ? min_thread / rc.runs / single[m] : 0.0, rc.runs);
+        }
+    }
+    
+    thread_pool_destroy(&pool);
+    topology_destroy(&topo);
+    if (results_close(&out) != 0) return -1;
+    printf("Results saved to ../data/realistic_patterns_mt.csv\n");
+    return 0;
+}
+
+/*
+ * Per-worker output, one cache line each: the experiment measures
+ * interference, so the two workers must not write-share a line.
+ */
+typedef struct {
+    uint64_t sink;
+    uint64_t streamed;               // Bytes read (neighbour only)
+} __attribute__((aligned(CACHE_LINE))) part_worker_t;
+
+/*
+ * Latency-sensitive thread (worker 0) and streaming neighbour (worker 1).
+ */
+typedef struct {
+    mixed_workload_t *work;          // Latency-sensitive working set
+    uint64_t *stream;                // Neighbour's buffer
+    stream_kernel_t kernel;
+    resctrl_group_t *groups[2];      // Group per worker, NULL = leave as is
+    histogram_t latency;             // Request latency, ns (worker 0)
+    part_worker_t workers[2];        // Written only by worker id
+    int stop __attribute__((aligned(CACHE_LINE)));  // Set by worker 0 when done
+} part_run_t;
+
+static void part_setup(int id, void *arg) {
+    part_run_t *run = arg;
+    
+    if (run->groups[id] && resctrl_group_add_task(run->groups[id], 0) != 0) {
+        fprintf(stderr, "resctrl: moving worker %d failed: %s\n", id, strerror(errno));
+    }
+}
+
+static void part_work(int id, void *arg) {
+    part_run_t *run = arg;
+    
+    if (id == 0) {
+        for (int r = 0; r < PART_REQUESTS; r++) {
+            uint64_t t0 = tsc_begin();
+            run->workers[0].sink += mixed_workload_run(run->work, PART_REQUEST_ACCESSES);
+            uint64_t t1 = tsc_end();
+            histogram_record(&run->latency, (uint64_t)(tsc_to_ns(tsc_elapsed(t0, t1)) + 0.5));
+        }
+        __atomic_store_n(&run->stop, 1, __ATOMIC_RELEASE);
+        return;
+    }
+    
+    uint64_t bytes = 0, sum = 0;
+    size_t words = PART_STREAM_SIZE / sizeof(uint64_t), chunk = PART_STREAM_CHUNK / sizeof(uint64_t);
+    for (size_t off = 0; !__atomic_load_n(&run->stop, __ATOMIC_ACQUIRE); off = (off + chunk) % words) {
+        sum += memory_stream_read_kernel(run->kernel, run->stream + off, PART_STREAM_CHUNK);
+        bytes += PART_STREAM_CHUNK;
+    }
+    run->workers[1].streamed = bytes;
+    run->workers[1].sink += sum;
+}
+
+static int env_int(const char *name, int fallback) {
+    const char *env = getenv(name);
+    return env && *env ? atoi(env) : fallback;
+}
+
+/*
+ * Tail latency of a latency-sensitive thread next to a streaming
+ * neighbour, with and without resctrl partitioning.
+ */
+static int run_partitioned(const mixed_keys_params_t *keys) {
+    enum { PART_ALONE, PART_SHARED, PART_CAT, PART_CAT_MBA, PART_CONFIGS };
+    static const char *config_names[PART_CONFIGS] = { "alone", "shared", "cat", "cat_mba" };
+    topology_t topo;
+    thread_pool_t pool;
+    
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return -1;
+    }
+    // Compact: both threads on one L3 so they compete for it
+    int cpus[topo.num_cpus];
+    int placed = topology_place(&topo, TOPO_PLACE_COMPACT, topo.num_cpus, cpus);
+    topology_destroy(&topo);
+    printf("\nCache partitioning (latency-sensitive thread + streaming neighbour)...\n");
+    if (placed < 2) {
+        printf("  Skipped: needs 2 CPUs\n");
+        return 0;
+    }
+    if (thread_pool_create(&pool, 2, cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
+        return -1;
+    }
+    
+    resctrl_info_t info;
+    int have_rdt = resctrl_probe(&info) == 0;
+    int bg_ways = env_int("LRC_RDT_BG_WAYS", 2);
+    unsigned bg_mba = info.mba ? resctrl_mba_value(&info, env_int("LRC_RDT_BG_MBA", 20)) : 0;
+    uint64_t bg_mask = 0, ls_mask = 0;
+    if (info.cat_l3) {
+        bg_mask = resctrl_l3_mask(&info, 0, bg_ways);
+        ls_mask = resctrl_l3_mask(&info, __builtin_popcountll(bg_mask),
+                                  info.l3_ways - __builtin_popcountll(bg_mask));
+        if (ls_mask & bg_mask) ls_mask = 0;   // Too few ways to split
+    }
+    if (!have_rdt) {
+        printf("  resctrl not mounted: running alone/shared only\n");
+    } else {
+        printf("  resctrl: %u L3 ways%s, MBA %s, LS mask %lx, neighbour mask %lx / MB %u\n",
+               info.l3_ways, info.cdp ? " (CDP)" : "", info.mba ? "yes" : "no",
+               (unsigned long)ls_mask, (unsigned long)bg_mask, bg_mba);
+    }
+    
+    part_run_t run;
+    memset(&run, 0, sizeof(run));
+    mixed_workload_t work;
+    mixed_keys_params_t ls_keys = *keys;
+    lrc_alloc_opts_t opts = { -1, LRC_PAGES_DEFAULT, 0 };
+    run.stream = lrc_alloc(PART_STREAM_SIZE, &opts);
+    if (!run.stream || mixed_workload_init_keys(&work, BUFFER_SIZE, PART_WORKING_SET, 3,
+                                                &ls_keys) != 0) {
+        perror("partitioning buffers");
+        if (run.stream) lrc_free(run.stream, PART_STREAM_SIZE, opts.pages);
+        thread_pool_destroy(&pool);
+        return -1;
+    }
+    memset(run.stream, 1, PART_STREAM_SIZE);
+    run.work = &work;
+    run.kernel = stream_kernel_best();
+    
+    results_t out;
+    if (results_open(&out, "../data/realistic_patterns_partition.csv",
+                     PART_CONFIGS * PART_MAX_RUNS) != 0) {
+        perror("results_open");
+        thread_pool_destroy(&pool);
+        mixed_workload_cleanup(&work);
+        lrc_free(run.stream, PART_STREAM_SIZE, opts.pages);
+        return -1;
+    }
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "config", RESULT_STR, 0);
+    results_add_column(&out, "key_dist", RESULT_STR, 0);
+    results_add_column(&out, "ls_l3_mask", RESULT_STR, 0);
+    results_add_column(&out, "bg_l3_mask", RESULT_STR, 0);
+    results_add_column(&out, "bg_mba", RESULT_U64, 0);
+    results_add_column(&out, "requests", RESULT_U64, 0);
+    results_add_column(&out, "p50_ns", RESULT_U64, 0);
+    results_add_column(&out, "p99_ns", RESULT_U64, 0);
+    results_add_column(&out, "p999_ns", RESULT_U64, 0);
+    results_add_column(&out, "max_ns", RESULT_U64, 0);
+    results_add_column(&out, "vs_alone_p99", RESULT_F64, 3);
+    results_add_column(&out, "bg_gbs", RESULT_F64, 2);
+    results_add_column(&out, "ls_llc_bytes", RESULT_U64, 0);
+    results_add_column(&out, "bg_llc_bytes", RESULT_U64, 0);
+    results_add_column(&out, "bg_mbm_bytes", RESULT_U64, 0);
+    results_add_column(&out, "latency_hist", RESULT_STR, 0);
+    
+    printf("  %-8s %10s %10s %10s %12s %10s\n", "config", "p50 ns", "p99 ns", "p999 ns",
+           "vs alone", "bg GB/s");
+    
+    resctrl_group_t ls_group, bg_group;
+    int groups_ready = 0;
+    double alone_p99 = 0.0;
+    
+    for (int c = 0; c < PART_CONFIGS; c++) {
+        if (c == PART_CAT && (!ls_mask || !bg_mask)) {
+            printf("  %-8s skipped (no L3 CAT)\n", config_names[c]);
+            continue;
+        }
+        if (c == PART_CAT_MBA && (!ls_mask || !bg_mba)) {
+            printf("  %-8s skipped (no MBA)\n", config_names[c]);
+            continue;
+        }
+        
+        run.groups[0] = run.groups[1] = NULL;
+        if (c >= PART_CAT) {
+            if (!groups_ready) {
+                if (resctrl_group_create(&ls_group, &info, "lrc_ls") != 0 ||
+                    resctrl_group_create(&bg_group, &info, "lrc_bg") != 0 ||
+                    resctrl_group_set_l3(&ls_group, ls_mask) != 0 ||
+                    resctrl_group_set_l3(&bg_group, bg_mask) != 0) {
+                    printf("  %-8s skipped (resctrl: %s)\n", config_names[c], strerror(errno));
+                    break;
+                }
+                groups_ready = 1;
+                run.groups[0] = &ls_group;
+                run.groups[1] = &bg_group;
+            }
+            if (c == PART_CAT_MBA && resctrl_group_set_mba(&bg_group, bg_mba) != 0) {
+                printf("  %-8s skipped (resctrl: %s)\n", config_names[c], strerror(errno));
+                continue;
+            }
+        }
+        
+        histogram_t all;
+        histogram_reset(&all);
+        double sum_gbs = 0.0;
+        run_control_t rc;
+        
+        run_control_begin(&rc, PART_MIN_RUNS, PART_MAX_RUNS);
+        while (run_control_next(&rc)) {
+            resctrl_mon_t before = { 0 }, ls_mon = { 0 }, bg_mon = { 0 };
+            if (groups_ready) resctrl_group_read(&bg_group, &before);
+            
+            histogram_reset(&run.latency);
+            run.workers[1].streamed = 0;
+            run.stop = 0;
+            if (thread_pool_run(&pool, c == PART_ALONE ? 1 : 2, part_setup, part_work, &run) != 0) {
+                break;
+            }
+            run.groups[0] = run.groups[1] = NULL;      // Workers stay in their groups
+            
+            if (groups_ready) {
+                resctrl_group_read(&ls_group, &ls_mon);
+                resctrl_group_read(&bg_group, &bg_mon);
+            }
+            uint64_t p99 = histogram_percentile(&run.latency, 99.0);
+            if (!run_control_add(&rc, p99)) continue;   // Warmup
+            
+            uint64_t elapsed = thread_pool_elapsed_ns(&pool);
+            double gbs = elapsed ? (double)run.workers[1].streamed / elapsed : 0.0;
+            double ref = c == PART_ALONE ? (double)p99 : alone_p99;
+            histogram_merge(&all, &run.latency);
+            sum_gbs += gbs;
+            
+            results_u64(&out, run_control_index(&rc));
+            results_str(&out, config_names[c]);
+            results_str(&out, mixed_keys_name(keys->dist));
+            results_strf(&out, "%lx", c >= PART_CAT ? (unsigned long)ls_mask : 0UL);
+            results_strf(&out, "%lx", c >= PART_CAT ? (unsigned long)bg_mask : 0UL);
+            results_u64(&out, c == PART_CAT_MBA ? bg_mba : 0);
+            results_u64(&out, run.latency.count);
+            results_u64(&out, histogram_percentile(&run.latency, 50.0));
+            results_u64(&out, p99);
+            results_u64(&out, histogram_percentile(&run.latency, 99.9));
+            results_u64(&out, run.latency.max);
+            results_f64(&out, ref > 0 ? p99 / ref : 0.0);
+            results_f64(&out, gbs);
+            results_u64(&out, ls_mon.llc_occupancy);
+            results_u64(&out, bg_mon.llc_occupancy);
+            results_u64(&out, bg_mon.mbm_total_bytes - before.mbm_total_bytes);
+            results_histogram(&out, &run.latency);
+        }
+        if (rc.runs == 0) continue;
+        
+        uint64_t p99 = histogram_percentile(&all, 99.0);
+        if (c == PART_ALONE) alone_p99 = (double)p99;
+        printf("  %-8s %10lu %10lu %10lu %12.3f %10.2f  (%d runs)\n", config_names[c],
+               histogram_percentile(&all, 50.0), p99, histogram_percentile(&all, 99.9),
+               alone_p99 > 0 ? p99 / alone_p99 : 0.0, sum_gbs / rc.runs, rc.runs);
+    }
+    
+    if (groups_ready) {
+        resctrl_group_destroy(&ls_group);
+        resctrl_group_destroy(&bg_group);
+    }
+    thread_pool_destroy(&pool);
+    mixed_workload_cleanup(&work);
+    lrc_free(run.stream, PART_STREAM_SIZE, opts.pages);
+    (void)(run.workers[0].sink + run.workers[1].sink);
+    
+    if (results_close(&out) != 0) return -1;
+    printf("Results saved to ../data/realistic_patterns_partition.csv\n");
+    return 0;
+}
 
 int main(void) {
     workload_metrics_t metrics;
-    FILE *out = fopen("../data/realistic_patterns.csv", "w");
+    run_control_t rc;
+    results_t out;
+    mixed_keys_params_t keys;
     
-    if (!out) {
-        perror("fopen");
+    mixed_keys_defaults(&keys);
+    if (results_open(&out, "../data/realistic_patterns.csv", 8 * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
     pin_to_cpu(0);
     
-    fprintf(out, "run,pattern,compute_ratio,");
-    metrics_print_csv_header(out);
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "pattern", RESULT_STR, 0);
+    results_add_column(&out, "compute_ratio", RESULT_U64, 0);
+    results_add_column(&out, "key_dist", RESULT_STR, 0);
+    results_add_column(&out, "keys_inloop", RESULT_U64, 0);
+    results_add_metrics_columns(&out);
     
     printf("Running realistic workload patterns experiment...\n");
     printf("Testing different compute:memory ratios and patterns.\n\n");
     
     // Compute-heavy (10:1 ratio)
     printf("Compute-heavy pattern (10:1)...\n");
-    for (int run = 0; run < RUNS; run++) {
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         mixed_workload_t work;
-        mixed_workload_init(&work, BUFFER_SIZE, WORKING_SET, 10);
+        mixed_workload_init_keys(&work, BUFFER_SIZE, WORKING_SET, 10, &keys);
         
-        fprintf(out, "%d,compute_heavy,10,", run);
         metrics_init(&metrics);
         uint64_t result = mixed_workload_run(&work, ITERATIONS);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
         mixed_workload_cleanup(&work);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "compute_heavy");
+        results_u64(&out, 10);
+        results_str(&out, mixed_keys_name(keys.dist));
+        results_u64(&out, keys.inloop);
+        results_metrics(&out, &metrics);
     }
+    run_control_report(&rc, "compute_heavy");
     
     // Balanced (3:1 ratio)
     printf("Balanced pattern (3:1)...\n");
-    for (int run = 0; run < RUNS; run++) {
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         mixed_workload_t work;
-        mixed_workload_init(&work, BUFFER_SIZE, WORKING_SET, 3);
+        mixed_workload_init_keys(&work, BUFFER_SIZE, WORKING_SET, 3, &keys);
         
-        fprintf(out, "%d,balanced,3,", run);
         metrics_init(&metrics);
         uint64_t result = mixed_workload_run(&work, ITERATIONS);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
         mixed_workload_cleanup(&work);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "balanced");
+        results_u64(&out, 3);
+        results_str(&out, mixed_keys_name(keys.dist));
+        results_u64(&out, keys.inloop);
+        results_metrics(&out, &metrics);
     }
+    run_control_report(&rc, "balanced");
     
     // Memory-heavy (1:1 ratio)
     printf("Memory-heavy pattern (1:1)...\n");
-    for (int run = 0; run < RUNS; run++) {
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         mixed_workload_t work;
-        mixed_workload_init(&work, BUFFER_SIZE, WORKING_SET, 1);
+        mixed_workload_init_keys(&work, BUFFER_SIZE, WORKING_SET, 1, &keys);
         
-        fprintf(out, "%d,memory_heavy,1,", run);
         metrics_init(&metrics);
         uint64_t result = mixed_workload_run(&work, ITERATIONS);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
         mixed_workload_cleanup(&work);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "memory_heavy");
+        results_u64(&out, 1);
+        results_str(&out, mixed_keys_name(keys.dist));
+        results_u64(&out, keys.inloop);
+        results_metrics(&out, &metrics);
     }
+    run_control_report(&rc, "memory_heavy");
     
     // Phased (growing working set)
     printf("Phased pattern (warmup)...\n");
-    for (int run = 0; run < RUNS; run++) {
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         mixed_workload_t work;
-        mixed_workload_init(&work, BUFFER_SIZE, WORKING_SET, 3);
+        mixed_workload_init_keys(&work, BUFFER_SIZE, WORKING_SET, 3, &keys);
         
-        fprintf(out, "%d,phased,3,", run);
         metrics_init(&metrics);
         uint64_t result = mixed_workload_phased(&work, ITERATIONS, 5);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
         mixed_workload_cleanup(&work);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "phased");
+        results_u64(&out, 3);
+        results_str(&out, mixed_keys_name(keys.dist));
+        results_u64(&out, keys.inloop);
+        results_metrics(&out, &metrics);
     }
+    run_control_report(&rc, "phased");
     
     // Bursty (alternating compute/memory)
     printf("Bursty pattern (alternating)...\n");
-    for (int run = 0; run < RUNS; run++) {
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         mixed_workload_t work;
-        mixed_workload_init(&work, BUFFER_SIZE, WORKING_SET, 3);
+        mixed_workload_init_keys(&work, BUFFER_SIZE, WORKING_SET, 3, &keys);
         
-        fprintf(out, "%d,bursty,3,", run);
         metrics_init(&metrics);
         uint64_t result = mixed_workload_bursty(&work, ITERATIONS);
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
-        
         mixed_workload_cleanup(&work);
         (void)result;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "bursty");
+        results_u64(&out, 3);
+        results_str(&out, mixed_keys_name(keys.dist));
+        results_u64(&out, keys.inloop);
+        results_metrics(&out, &metrics);
     }
+    run_control_report(&rc, "bursty");
+    
+    // Skewed key popularity (balanced ratio)
+    printf("Zipf keys (s=%.2f)...\n", keys.zipf_s);
+    mixed_keys_params_t skewed = keys;
+    skewed.dist = MIXED_KEYS_ZIPF;
+    run_keys_pattern(&out, "zipf", &skewed, WORKING_SET);
+    
+    printf("Hotspot keys (%.0f%% of keys, %.0f%% of accesses)...\n",
+           keys.hot_fraction * 100, keys.hot_access * 100);
+    skewed.dist = MIXED_KEYS_HOTSPOT;
+    run_keys_pattern(&out, "hotspot", &skewed, WORKING_SET);
+    
+    // Whole buffer as key space, drawn in the loop (no index buffer)
+    printf("Zipf keys over the whole buffer, generated in-loop...\n");
+    skewed.dist = MIXED_KEYS_ZIPF;
+    skewed.inloop = 1;
+    run_keys_pattern(&out, "zipf_inloop", &skewed, BUFFER_SIZE / sizeof(uint64_t));
+    
+    if (results_close(&out) != 0) return 1;
+    printf("Results saved to ../data/realistic_patterns.csv\n");
     
-    fclose(out);
+    if (run_multithreaded(&keys) != 0) return 1;
+    tsc_init();
+    if (run_partitioned(&keys) != 0) return 1;
     
-    printf("\nResults saved to ../data/realistic_patterns.csv\n");
     printf("\nAnalyze with:\n");
     printf("  python3 ../analyze/parse.py ../data/realistic_patterns.csv\n");
     printf("  python3 ../analyze/distributions.py ../data/realistic_patterns.csv\n");
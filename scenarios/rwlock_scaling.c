@@ -1,21 +1,61 @@
 /*
  * Reader-Writer Lock Scaling Benchmark
- * 
+ *
  * Tests the scalability of reader-writer (RW) locks under different
  * read/write ratios. RW locks allow multiple concurrent readers but
  * exclusive writers.
  *
+ * Implementations (rwlock_impl column):
+ *   pthread  pthread_rwlock_t: every reader RMWs one shared count line
+ *   percpu   Distributed reader lock: one padded reader flag per thread
+ *            (threads are pinned, so per-thread == per-CPU); writers set
+ *            a flag and wait for every reader slot to drain
+ *   bravo    BRAVO (Dice & Kogan, ATC'19) around pthread_rwlock_t:
+ *            readers publish themselves in a hashed visible-readers
+ *            table while read bias is on; a writer revokes the bias,
+ *            waits for the table and inhibits bias for N x revoke time
+ *   seqlock  Sequence lock: readers never write shared memory, they
+ *            retry if a writer ran concurrently
+ *   rcu      Epoch-based RCU-style read path: readers dereference a
+ *            published pointer inside an epoch; writers copy, update,
+ *            publish and wait for a grace period (synchronous, like
+ *            synchronize_rcu(); two buffers, no allocation per write)
+ *
  * Expected Results:
  * - 100% readers: Near-linear scaling (read locks don't block)
  * - 50/50 mix: Moderate scaling (writer contention)
  * - Heavy writers: Poor scaling (serialization)
  * - pthread_rwlock vs custom spinlock implementations
+ * - 0% writes: pthread flattens after a few cores (reader count line
+ *   bounces), percpu/bravo/seqlock/rcu scale with threads
+ * - With writes: seqlock and rcu readers stay cheap, rcu writers pay
+ *   a grace period each; percpu writers scan every reader slot
+ * - With think time / longer sections: Amdahl-style curves, writers
+ *   bound speedup by (cs_ns + think_ns) / cs_ns
  *
  * What This Tests:
  * - RW lock performance
  * - Reader/writer starvation
  * - Lock fairness policies
  * - Contention effects
+ * - Cost of reader-side shared writes vs read-only read paths
+ *
+ * Latency: one operation in LOCK_SAMPLE_INTERVAL times its acquire
+ * (TSC, reads and writes alike) into a per-thread histogram: from the
+ * lock call until it is held, for seqlock readers until a consistent
+ * snapshot (retries included), for rcu readers until the pointer is
+ * dereferenced. The merged distribution goes into latency_hist.
+ *
+ * Every writer increments all shared lines by one, so a consistent
+ * read sees equal values on every line: readers count torn snapshots
+ * (must be 0), and the final value must equal the number of writes.
+ *
+ * Configuration (environment):
+ *   LRC_RWLOCK_PROFILES  comma-separated "cs_ns:think_ns:cs_lines":
+ *                        cpu_spin() time inside the lock, time between
+ *                        acquisitions, and extra shared cache lines read
+ *                        (readers) or written (writers) under the lock.
+ *                        Default: 0:0:0 (original) and 200:1000:4
  */
 
 #define _GNU_SOURCE
@@ -25,161 +65,647 @@
 #include <pthread.h>
 #include <time.h>
 #include <sched.h>
+#include <string.h>
 #include <unistd.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../core/topology.h"
+#include "../core/thread_pool.h"
+#include "../core/workloads_api.h"
+#include "../core/results.h"
+#include "../core/histogram.h"
+#include "../core/tsc.h"
+
 #define ITERATIONS 1000000
-#define MAX_THREADS 8
+#define RUN_BUDGET_NS 200000000ULL     // Caps iterations for slow profiles (single thread)
+#define CACHE_LINE 64
+#define CACHE_LINE_WORDS 8             // uint64_t per 64-byte line
+#define SPINS_BEFORE_YIELD 1024
+#define BRAVO_TABLE_SIZE 4096          // Visible-readers slots (power of two)
+#define BRAVO_INHIBIT_MULTIPLIER 9     // N in the paper: bias off for N x revoke time
+
+typedef enum {
+    RW_PTHREAD = 0,
+    RW_PERCPU,
+    RW_BRAVO,
+    RW_SEQLOCK,
+    RW_RCU,
+    RW_IMPL_COUNT
+} rw_impl_t;
+
+static const char *rw_impl_names[RW_IMPL_COUNT] = {
+    "pthread", "percpu", "bravo", "seqlock", "rcu"
+};
+
+static const lock_params_t default_profiles[] = {
+    { 0, 0, 0 },          // Original: read or increment one int
+    { 200, 1000, 4 },     // Handler-like section with think time
+};
+
+typedef struct {
+    volatile uint64_t value;
+} __attribute__((aligned(CACHE_LINE))) padded_slot_t;
+
+/*
+ * State shared by all threads of one test. Each synchronization word
+ * gets its own cache line.
+ */
+typedef struct {
+    int num_threads;
+    int num_lines;                   // 1 + cs_lines
+    pthread_rwlock_t rwlock;         // pthread, and BRAVO's underlying lock
+    volatile uint64_t *data;         // Protected lines (all but rcu)
+    
+    // percpu: reader flags per thread, writer flag
+    padded_slot_t *readers;
+    volatile uint64_t writer __attribute__((aligned(CACHE_LINE)));
+    
+    // bravo
+    void *volatile *visible_readers;
+    volatile uint64_t rbias __attribute__((aligned(CACHE_LINE)));
+    volatile uint64_t inhibit_until;
+    
+    // seqlock (writers serialize on writer_lock)
+    volatile uint64_t seq __attribute__((aligned(CACHE_LINE)));
+    volatile uint64_t writer_lock __attribute__((aligned(CACHE_LINE)));
+    
+    // rcu: published object, two buffers, epoch per reader (0 = quiescent)
+    volatile uint64_t *volatile current __attribute__((aligned(CACHE_LINE)));
+    uint64_t *objects[2];
+    volatile uint64_t epoch __attribute__((aligned(CACHE_LINE)));
+    padded_slot_t *reader_epochs;
+} rw_shared_t;
 
 typedef struct {
     int thread_id;
+    int cpu;
     int num_threads;
-    pthread_rwlock_t *rwlock;
-    int *shared_data;
+    rw_shared_t *shared;
     int write_percentage;  // 0-100
+    uint64_t iterations;             // Total across all threads
+    uint64_t cs_iterations;          // cpu_spin() iterations inside the lock
+    uint64_t think_iterations;       // cpu_spin() iterations between acquisitions
+    int cs_lines;
     uint64_t operations;
-    uint64_t runtime_ns;
+    uint64_t writes;
+    uint64_t torn_reads;             // Reads that saw an inconsistent snapshot
+    uint64_t sink;
+    double ns_per_tick;              // Sampled acquire ticks to ns (tsc.h)
+    uint64_t timer_overhead;         // Empty begin/end pair, in ticks
+    histogram_t latency;             // Sampled acquire latencies in ns
 } thread_arg_t;
 
+// Thread placement (LRC_PLACEMENT=compact|scatter|per_l3)
+static topology_t topo;
+static topo_placement_t placement;
+static int *thread_cpus;     // CPU for thread i, in placement order
+static int max_threads;      // Threads the placement can host
+static thread_pool_t pool;   // Pinned workers, reused by every test
+
 static inline uint64_t get_time_ns(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
-void* rwlock_worker(void *arg) {
-    thread_arg_t *params = (thread_arg_t*)arg;
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static inline void spin_pause(unsigned *spins) {
+    cpu_relax();
+    if (++*spins % SPINS_BEFORE_YIELD == 0) sched_yield();
+}
+
+static inline void writer_lock(rw_shared_t *s) {
+    unsigned spins = 0;
+    while (__atomic_exchange_n(&s->writer_lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&s->writer_lock, __ATOMIC_RELAXED)) spin_pause(&spins);
+    }
+}
+
+static inline void writer_unlock(rw_shared_t *s) {
+    __atomic_store_n(&s->writer_lock, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * Critical sections shared by all implementations.
+ */
+static inline void write_lines(volatile uint64_t *data, const thread_arg_t *params) {
+    for (int l = 0; l < params->shared->num_lines; l++) {
+        data[l * CACHE_LINE_WORDS]++;
+    }
+}
+
+// Returns 1 if the lines were not all equal (torn snapshot)
+static inline int read_lines(volatile const uint64_t *data, const thread_arg_t *params,
+                             uint64_t *sink) {
+    uint64_t first = data[0];
+    int torn = 0;
+    
+    for (int l = 1; l < params->shared->num_lines; l++) {
+        torn |= data[l * CACHE_LINE_WORDS] != first;
+    }
+    *sink += first;
+    return torn;
+}
+
+static inline void section_work(thread_arg_t *params, uint64_t *sink) {
+    if (params->cs_iterations) *sink += cpu_spin(params->cs_iterations);
+}
+
+/* percpu: Dekker-style handshake between reader flag and writer flag */
+static inline void percpu_read_lock(rw_shared_t *s, int id) {
+    unsigned spins = 0;
+    for (;;) {
+        __atomic_store_n(&s->readers[id].value, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&s->writer, __ATOMIC_SEQ_CST)) return;
+        __atomic_store_n(&s->readers[id].value, 0, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&s->writer, __ATOMIC_RELAXED)) spin_pause(&spins);
+    }
+}
+
+static inline void percpu_read_unlock(rw_shared_t *s, int id) {
+    __atomic_store_n(&s->readers[id].value, 0, __ATOMIC_RELEASE);
+}
+
+static inline void percpu_write_lock(rw_shared_t *s) {
+    unsigned spins = 0;
+    while (__atomic_exchange_n(&s->writer, 1, __ATOMIC_SEQ_CST)) {
+        while (__atomic_load_n(&s->writer, __ATOMIC_RELAXED)) spin_pause(&spins);
+    }
+    for (int i = 0; i < s->num_threads; i++) {
+        while (__atomic_load_n(&s->readers[i].value, __ATOMIC_ACQUIRE)) spin_pause(&spins);
+    }
+}
+
+static inline void percpu_write_unlock(rw_shared_t *s) {
+    __atomic_store_n(&s->writer, 0, __ATOMIC_RELEASE);
+}
+
+/* bravo: returns the visible-readers slot taken, or NULL for the slow path */
+static inline void *volatile *bravo_read_lock(rw_shared_t *s, int id) {
+    if (__atomic_load_n(&s->rbias, __ATOMIC_RELAXED)) {
+        uint64_t h = ((uint64_t)(id + 1) * 0x9E3779B97F4A7C15ULL) ^ (uintptr_t)s;
+        void *volatile *slot = &s->visible_readers[(h >> 32) & (BRAVO_TABLE_SIZE - 1)];
+        void *expected = NULL;
+        
+        if (__atomic_compare_exchange_n(slot, &expected, (void *)s, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            if (__atomic_load_n(&s->rbias, __ATOMIC_SEQ_CST)) return slot;
+            __atomic_store_n(slot, NULL, __ATOMIC_RELEASE);
+        }
+    }
     
-    // Pin to CPU
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(params->thread_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    pthread_rwlock_rdlock(&s->rwlock);
+    if (!__atomic_load_n(&s->rbias, __ATOMIC_RELAXED) &&
+        get_time_ns() >= __atomic_load_n(&s->inhibit_until, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&s->rbias, 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static inline void bravo_read_unlock(rw_shared_t *s, void *volatile *slot) {
+    if (slot) {
+        __atomic_store_n(slot, NULL, __ATOMIC_RELEASE);
+    } else {
+        pthread_rwlock_unlock(&s->rwlock);
+    }
+}
+
+static inline void bravo_write_lock(rw_shared_t *s) {
+    pthread_rwlock_wrlock(&s->rwlock);
     
-    uint64_t operations = 0;
-    uint64_t start = get_time_ns();
+    if (__atomic_load_n(&s->rbias, __ATOMIC_RELAXED)) {
+        unsigned spins = 0;
+        uint64_t start = get_time_ns();
+        
+        __atomic_store_n(&s->rbias, 0, __ATOMIC_SEQ_CST);
+        for (int i = 0; i < BRAVO_TABLE_SIZE; i++) {
+            while (__atomic_load_n(&s->visible_readers[i], __ATOMIC_ACQUIRE) == (void *)s) {
+                spin_pause(&spins);
+            }
+        }
+        uint64_t now = get_time_ns();
+        __atomic_store_n(&s->inhibit_until, now + (now - start) * BRAVO_INHIBIT_MULTIPLIER,
+                         __ATOMIC_RELAXED);
+    }
+}
+
+/* seqlock: odd sequence = write in progress */
+static inline uint64_t seq_read_begin(rw_shared_t *s) {
+    unsigned spins = 0;
+    uint64_t seq;
+    while ((seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE)) & 1) spin_pause(&spins);
+    return seq;
+}
+
+static inline int seq_read_retry(rw_shared_t *s, uint64_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/* rcu: copy-update-publish, then wait for readers of older epochs */
+static void rcu_write(rw_shared_t *s, thread_arg_t *params, uint64_t *sink, uint64_t *acquired) {
+    writer_lock(s);
+    if (acquired) *acquired = tsc_end();
+    
+    volatile uint64_t *old = s->current;
+    uint64_t *copy = (old == s->objects[0]) ? s->objects[1] : s->objects[0];
+    size_t words = (size_t)s->num_lines * CACHE_LINE_WORDS;
+    
+    for (size_t w = 0; w < words; w++) copy[w] = old[w];
+    write_lines(copy, params);
+    section_work(params, sink);
+    
+    __atomic_store_n(&s->current, copy, __ATOMIC_RELEASE);
+    
+    // Grace period: every reader is quiescent or started after the publish
+    uint64_t epoch = __atomic_add_fetch(&s->epoch, 1, __ATOMIC_SEQ_CST);
+    unsigned spins = 0;
+    for (int i = 0; i < s->num_threads; i++) {
+        for (;;) {
+            uint64_t e = __atomic_load_n(&s->reader_epochs[i].value, __ATOMIC_ACQUIRE);
+            if (e == 0 || e >= epoch) break;
+            spin_pause(&spins);
+        }
+    }
+    
+    writer_unlock(s);
+}
+
+/* acquired (NULL when not sampling) receives tsc_end() once the lock is held */
+static inline __attribute__((always_inline))
+void rw_operation(thread_arg_t *params, int id, int is_write, int impl, uint64_t *sink,
+                  uint64_t *acquired) {
+    rw_shared_t *s = params->shared;
+    
+    switch (impl) {
+        case RW_PTHREAD:
+            if (is_write) {
+                pthread_rwlock_wrlock(&s->rwlock);
+                if (acquired) *acquired = tsc_end();
+                write_lines(s->data, params);
+                section_work(params, sink);
+                pthread_rwlock_unlock(&s->rwlock);
+            } else {
+                pthread_rwlock_rdlock(&s->rwlock);
+                if (acquired) *acquired = tsc_end();
+                params->torn_reads += read_lines(s->data, params, sink);
+                section_work(params, sink);
+                pthread_rwlock_unlock(&s->rwlock);
+            }
+            break;
+        
+        case RW_PERCPU:
+            if (is_write) {
+                percpu_write_lock(s);
+                if (acquired) *acquired = tsc_end();
+                write_lines(s->data, params);
+                section_work(params, sink);
+                percpu_write_unlock(s);
+            } else {
+                percpu_read_lock(s, id);
+                if (acquired) *acquired = tsc_end();
+                params->torn_reads += read_lines(s->data, params, sink);
+                section_work(params, sink);
+                percpu_read_unlock(s, id);
+            }
+            break;
+        
+        case RW_BRAVO:
+            if (is_write) {
+                bravo_write_lock(s);
+                if (acquired) *acquired = tsc_end();
+                write_lines(s->data, params);
+                section_work(params, sink);
+                pthread_rwlock_unlock(&s->rwlock);
+            } else {
+                void *volatile *slot = bravo_read_lock(s, id);
+                if (acquired) *acquired = tsc_end();
+                params->torn_reads += read_lines(s->data, params, sink);
+                section_work(params, sink);
+                bravo_read_unlock(s, slot);
+            }
+            break;
+        
+        case RW_SEQLOCK:
+            if (is_write) {
+                writer_lock(s);
+                if (acquired) *acquired = tsc_end();
+                __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+                write_lines(s->data, params);
+                section_work(params, sink);
+                __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+                writer_unlock(s);
+            } else {
+                uint64_t seq, local_sink;
+                int torn;
+                do {
+                    local_sink = 0;
+                    seq = seq_read_begin(s);
+                    torn = read_lines(s->data, params, &local_sink);
+                    section_work(params, &local_sink);
+                } while (seq_read_retry(s, seq));
+                if (acquired) *acquired = tsc_end();
+                params->torn_reads += torn;
+                *sink += local_sink;
+            }
+            break;
+        
+        case RW_RCU:
+            if (is_write) {
+                rcu_write(s, params, sink, acquired);
+            } else {
+                uint64_t epoch = __atomic_load_n(&s->epoch, __ATOMIC_RELAXED);
+                __atomic_store_n(&s->reader_epochs[id].value, epoch, __ATOMIC_SEQ_CST);
+                volatile const uint64_t *obj = __atomic_load_n(&s->current, __ATOMIC_ACQUIRE);
+                if (acquired) *acquired = tsc_end();
+                params->torn_reads += read_lines(obj, params, sink);
+                section_work(params, sink);
+                __atomic_store_n(&s->reader_epochs[id].value, 0, __ATOMIC_RELEASE);
+            }
+            break;
+    }
+}
+
+/*
+ * Worker id runs its share of operations. Threads are already pinned;
+ * the pool times each one from barrier release.
+ */
+static inline __attribute__((always_inline))
+void rwlock_loop(int id, void *arg, int impl) {
+    thread_arg_t *params = (thread_arg_t*)arg + id;
     
+    uint64_t operations = 0;
+    uint64_t writes = 0;
+    uint64_t sink = 0;
     unsigned int seed = params->thread_id;
     
-    for (uint64_t i = 0; i < ITERATIONS / params->num_threads; i++) {
+    for (uint64_t i = 0; i < params->iterations / params->num_threads; i++) {
         int r = rand_r(&seed) % 100;
+        int is_write = r < params->write_percentage;
         
-        if (r < params->write_percentage) {
-            // Write operation
-            pthread_rwlock_wrlock(params->rwlock);
-            (*params->shared_data)++;
-            pthread_rwlock_unlock(params->rwlock);
+        if (i % LOCK_SAMPLE_INTERVAL == 0) {
+            uint64_t t1 = 0;
+            uint64_t t0 = tsc_begin();
+            rw_operation(params, id, is_write, impl, &sink, &t1);
+            
+            uint64_t ticks = t1 - t0 > params->timer_overhead ? t1 - t0 - params->timer_overhead : 0;
+            histogram_record(&params->latency, (uint64_t)(ticks * params->ns_per_tick));
         } else {
-            // Read operation
-            pthread_rwlock_rdlock(params->rwlock);
-            volatile int val = *params->shared_data;
-            (void)val;  // Prevent optimization
-            pthread_rwlock_unlock(params->rwlock);
+            rw_operation(params, id, is_write, impl, &sink, NULL);
         }
+        writes += is_write;
+        
+        if (params->think_iterations) sink += cpu_spin(params->think_iterations);
         
         operations++;
     }
     
-    params->runtime_ns = get_time_ns() - start;
     params->operations = operations;
+    params->writes = writes;
+    params->sink = sink;
+}
+
+// One pool task per implementation, so each loop is specialized
+#define RWLOCK_TASK(name, impl) \
+    static void name(int id, void *arg) { rwlock_loop(id, arg, impl); }
+
+RWLOCK_TASK(rwlock_pthread_worker, RW_PTHREAD)
+RWLOCK_TASK(rwlock_percpu_worker, RW_PERCPU)
+RWLOCK_TASK(rwlock_bravo_worker, RW_BRAVO)
+RWLOCK_TASK(rwlock_seqlock_worker, RW_SEQLOCK)
+RWLOCK_TASK(rwlock_rcu_worker, RW_RCU)
+
+static const thread_pool_fn_t rwlock_workers[RW_IMPL_COUNT] = {
+    rwlock_pthread_worker, rwlock_percpu_worker, rwlock_bravo_worker,
+    rwlock_seqlock_worker, rwlock_rcu_worker
+};
+
+static void *alloc_lines(size_t lines) {
+    void *p = aligned_alloc(CACHE_LINE, lines * CACHE_LINE);
+    if (p) memset(p, 0, lines * CACHE_LINE);
+    return p;
+}
+
+static void free_shared(rw_shared_t *s) {
+    pthread_rwlock_destroy(&s->rwlock);
+    free((void *)s->data);
+    free(s->readers);
+    free((void *)s->visible_readers);
+    free(s->objects[0]);
+    free(s->objects[1]);
+    free(s->reader_epochs);
+    free(s);
+}
+
+static rw_shared_t *alloc_shared(int num_threads, int cs_lines) {
+    rw_shared_t *s = alloc_lines((sizeof(rw_shared_t) + CACHE_LINE - 1) / CACHE_LINE);
+    if (!s) return NULL;
     
-    return NULL;
+    s->num_threads = num_threads;
+    s->num_lines = cs_lines + 1;
+    pthread_rwlock_init(&s->rwlock, NULL);
+    s->data = alloc_lines(s->num_lines);
+    s->readers = alloc_lines(num_threads);
+    s->visible_readers = alloc_lines(BRAVO_TABLE_SIZE * sizeof(void *) / CACHE_LINE);
+    s->objects[0] = alloc_lines(s->num_lines);
+    s->objects[1] = alloc_lines(s->num_lines);
+    s->reader_epochs = alloc_lines(num_threads);
+    
+    if (!s->data || !s->readers || !s->visible_readers || !s->objects[0] ||
+        !s->objects[1] || !s->reader_epochs) {
+        free_shared(s);
+        return NULL;
+    }
+    
+    s->rbias = 1;
+    s->current = s->objects[0];
+    s->epoch = 1;
+    return s;
 }
 
-void run_rwlock_test(FILE *csv, int num_threads, int write_pct, int *run_number) {
-    pthread_t threads[MAX_THREADS];
-    thread_arg_t args[MAX_THREADS];
+void run_rwlock_test(results_t *csv, int impl, int num_threads, int write_pct,
+                     const lock_params_t *prof, int *run_number) {
+    // Heap: each argument carries a 30 KB histogram
+    thread_arg_t *args = calloc(num_threads, sizeof(thread_arg_t));
     
-    pthread_rwlock_t rwlock;
-    pthread_rwlock_init(&rwlock, NULL);
+    // Counter line plus cs_lines shared lines
+    rw_shared_t *shared = alloc_shared(num_threads, prof->cs_lines);
+    if (!args || !shared) {
+        perror("alloc");
+        free(args);
+        if (shared) free_shared(shared);
+        return;
+    }
     
-    int shared_data = 0;
+    // Bound the run time of slow profiles
+    uint64_t iterations = RUN_BUDGET_NS / (prof->cs_ns + prof->think_ns + 50);
+    if (iterations > ITERATIONS) iterations = ITERATIONS;
     
     uint64_t start_ts = get_time_ns();
+    const tsc_info_t *timer = tsc_info();
     
-    // Create threads
     for (int i = 0; i < num_threads; i++) {
         args[i].thread_id = i;
+        args[i].cpu = thread_cpus[i];
         args[i].num_threads = num_threads;
-        args[i].rwlock = &rwlock;
-        args[i].shared_data = &shared_data;
+        args[i].shared = shared;
         args[i].write_percentage = write_pct;
-        pthread_create(&threads[i], NULL, rwlock_worker, &args[i]);
+        args[i].iterations = iterations;
+        args[i].cs_iterations = cpu_spin_iterations_for_ns(prof->cs_ns);
+        args[i].think_iterations = cpu_spin_iterations_for_ns(prof->think_ns);
+        args[i].cs_lines = prof->cs_lines;
+        args[i].ns_per_tick = 1.0 / timer->ticks_per_ns;
+        args[i].timer_overhead = timer->overhead_ticks;
+        histogram_reset(&args[i].latency);
     }
     
-    // Wait for completion
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    // Run on the pinned pool: first release to last finish
+    thread_pool_run(&pool, num_threads, NULL, rwlock_workers[impl], args);
+    uint64_t max_runtime = thread_pool_elapsed_ns(&pool);
     
     // Calculate aggregate statistics
     uint64_t total_ops = 0;
-    uint64_t max_runtime = 0;
+    uint64_t total_writes = 0;
+    uint64_t torn = 0;
+    histogram_t latency;
     
+    // Per-thread histograms combine into the pooled distribution
+    histogram_reset(&latency);
     for (int i = 0; i < num_threads; i++) {
         total_ops += args[i].operations;
-        if (args[i].runtime_ns > max_runtime) {
-            max_runtime = args[i].runtime_ns;
-        }
+        total_writes += args[i].writes;
+        torn += args[i].torn_reads;
+        histogram_merge(&latency, &args[i].latency);
+    }
+    
+    uint64_t final = impl == RW_RCU ? shared->current[0] : shared->data[0];
+    if (torn > 0 || final != total_writes) {
+        fprintf(stderr, "  %s: %lu torn reads, %lu of %lu writes visible (broken)\n",
+                rw_impl_names[impl], torn, final, total_writes);
     }
     
     // Operations per second
     double ops_per_sec = (double)total_ops / (max_runtime / 1e9);
     double ns_per_op = (double)max_runtime / (total_ops / num_threads);
     
-    fprintf(csv, "%d,rwlock_%dthreads_%dwrite,%lu,%lu,0,0,0,0,-1,-1,%.0f,%.2f\n",
-           (*run_number)++, num_threads, write_pct, start_ts, max_runtime,
-           ops_per_sec, ns_per_op);
+    results_u64(csv, (*run_number)++);
+    results_strf(csv, "rwlock_%s_%dthreads_%dwrite", rw_impl_names[impl], num_threads, write_pct);
+    results_str(csv, rw_impl_names[impl]);
+    results_str(csv, topology_placement_name(placement));
+    results_u64(csv, prof->cs_ns);
+    results_u64(csv, prof->think_ns);
+    results_i64(csv, prof->cs_lines);
+    results_runtime(csv, start_ts, max_runtime);
+    results_f64(csv, ops_per_sec);
+    results_f64(csv, ns_per_op);
+    results_u64(csv, histogram_percentile(&latency, 50.0));
+    results_u64(csv, histogram_percentile(&latency, 99.0));
+    results_u64(csv, latency.max);
+    results_histogram(csv, &latency);
     
-    pthread_rwlock_destroy(&rwlock);
+    printf("    %-8s %14.0f ops/s  p50 %6lu ns  p99 %8lu ns\n", rw_impl_names[impl], ops_per_sec,
+           histogram_percentile(&latency, 50.0), histogram_percentile(&latency, 99.0));
+    
+    free_shared(shared);
+    free(args);
 }
 
-void run_experiment(FILE *csv) {
-    int thread_counts[] = {1, 2, 4, 8};
+void run_experiment(results_t *csv) {
+    int thread_counts[32];
     int write_percentages[] = {0, 10, 50, 100};  // 0% = all readers, 100% = all writers
     
-    int num_thread_counts = sizeof(thread_counts) / sizeof(thread_counts[0]);
+    int num_thread_counts = topology_thread_counts(max_threads, thread_counts, 32);
     int num_write_pcts = sizeof(write_percentages) / sizeof(write_percentages[0]);
     
+    lock_params_t profiles[LOCK_MAX_PROFILES];
+    int num_profiles = lock_params_from_env("LRC_RWLOCK_PROFILES", default_profiles,
+                                            sizeof(default_profiles) / sizeof(default_profiles[0]),
+                                            profiles);
+    
     int run = 0;
     
-    for (int w = 0; w < num_write_pcts; w++) {
-        int write_pct = write_percentages[w];
+    for (int p = 0; p < num_profiles; p++) {
+        const lock_params_t *prof = &profiles[p];
         
-        printf("Testing with %d%% writes...\n", write_pct);
+        printf("Profile cs=%luns think=%luns lines=%d\n",
+               prof->cs_ns, prof->think_ns, prof->cs_lines);
         
-        for (int t = 0; t < num_thread_counts; t++) {
-            int num_threads = thread_counts[t];
+        for (int w = 0; w < num_write_pcts; w++) {
+            int write_pct = write_percentages[w];
             
-            if (num_threads > sysconf(_SC_NPROCESSORS_ONLN)) {
-                continue;
-            }
+            printf("Testing with %d%% writes...\n", write_pct);
             
-            printf("  %d thread(s)...\n", num_threads);
-            run_rwlock_test(csv, num_threads, write_pct, &run);
+            for (int t = 0; t < num_thread_counts; t++) {
+                int num_threads = thread_counts[t];
+                
+                printf("  %d thread(s)...\n", num_threads);
+                for (int impl = 0; impl < RW_IMPL_COUNT; impl++) {
+                    run_rwlock_test(csv, impl, num_threads, write_pct, prof, &run);
+                }
+            }
         }
     }
 }
 
 int main(void) {
-    FILE *csv = fopen("data/rwlock_scaling.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    placement = topology_placement_from_env(TOPO_PLACE_SCATTER);
+    thread_cpus = malloc(topo.num_cpus * sizeof(int));
+    max_threads = topology_place(&topo, placement, topo.num_cpus, thread_cpus);
+    if (thread_pool_create(&pool, max_threads, thread_cpus) != 0) {
+        fprintf(stderr, "Failed to create worker pool\n");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "ops_per_second,ns_per_operation\n");
+    results_t csv;
+    if (results_open(&csv, "data/rwlock_scaling.csv", 256) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_column(&csv, "rwlock_impl", RESULT_STR, 0);
+    results_add_column(&csv, "thread_placement", RESULT_STR, 0);
+    results_add_column(&csv, "cs_ns", RESULT_U64, 0);
+    results_add_column(&csv, "think_ns", RESULT_U64, 0);
+    results_add_column(&csv, "cs_lines", RESULT_I64, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "ops_per_second", RESULT_F64, 0);
+    results_add_column(&csv, "ns_per_operation", RESULT_F64, 2);
+    results_add_column(&csv, "p50_ns", RESULT_U64, 0);
+    results_add_column(&csv, "p99_ns", RESULT_U64, 0);
+    results_add_column(&csv, "max_ns", RESULT_U64, 0);
+    results_add_column(&csv, "latency_hist", RESULT_STR, 0);
     
     printf("Reader-Writer Lock Scaling Benchmark\n");
     printf("====================================\n\n");
     printf("Total operations: %d\n", ITERATIONS);
-    printf("Available CPUs: %ld\n\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("Implementations: pthread, percpu, bravo, seqlock, rcu\n");
+    printf("Available CPUs: %d (placement: %s, up to %d threads)\n\n",
+           topo.num_cpus, topology_placement_name(placement), max_threads);
+    
+    run_experiment(&csv);
     
-    run_experiment(csv);
+    thread_pool_destroy(&pool);
+    free(thread_cpus);
+    topology_destroy(&topo);
     
-    fclose(csv);
+    if (results_close(&csv) != 0) return 1;
     
     printf("\nResults saved to data/rwlock_scaling.csv\n");
     printf("\nExpected patterns:\n");
@@ -187,6 +713,7 @@ int main(void) {
     printf("  10%% writes: Good scaling with occasional serialization\n");
     printf("  50%% writes: Moderate scaling, significant contention\n");
     printf("  100%% writes: Poor scaling, full serialization\n");
+    printf("  pthread readers share one count line; percpu/bravo/seqlock/rcu do not\n");
     printf("\nLesson: RW locks excel when reads dominate!\n");
     
     return 0;
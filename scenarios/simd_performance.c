@@ -1,21 +1,37 @@
 /*
- * SIMD vs Scalar Performance Benchmark
- * 
- * Compares SIMD (Single Instruction Multiple Data) vectorized operations
- * against scalar implementations. SIMD processes multiple data elements
- * in parallel using wide registers (128-bit, 256-bit, 512-bit).
+ * SIMD Kernel Suite Benchmark
+ *
+ * Runs every kernel of core/simd_kernels.h (add, dot, sum/max reductions,
+ * gather/scatter, memchr-style scan, prefix sum, matrix tile, int8 dot
+ * product) in every variant the CPU reports: scalar, SSE4, AVX2,
+ * AVX-512 and AVX-512 VNNI. Variants are chosen from CPUID at runtime,
+ * so the same binary measures whatever machine it runs on.
  *
  * Expected Results:
- * - Scalar: Baseline performance
- * - SSE (128-bit): ~2-4x faster
- * - AVX2 (256-bit): ~4-8x faster
- * - Auto-vectorized: Compiler-dependent speedup
+ * - L1-resident: throughput scales with vector width until the load
+ *   ports or the FP units saturate (dot, matmul, dot_i8 gain most)
+ * - DRAM-resident: all streaming variants converge on memory bandwidth
+ * - gather/scatter: a few times scalar at best; random lines dominate
+ * - prefix sum: gains less than width (log2(width) shuffle steps)
+ * - AVX-512 (on some CPUs AVX2 too): core clock drops under the
+ *   frequency licence for heavy wide instructions, visible in
+ *   cycles_ghz / freq_ratio
  *
  * What This Tests:
- * - SIMD instruction effectiveness
- * - Compiler auto-vectorization
- * - Memory alignment impact
- * - Data parallelism potential
+ * - SIMD instruction effectiveness per kernel type and cache level
+ * - Gather/scatter and horizontal-operation costs
+ * - Frequency licence downclocking of wide vectors
+ *
+ * Frequency:
+ *   cycles_ghz is the perf cycle counter over the run's wall time (0 when
+ *   no PMU is available). probe_ghz times a chain of dependent adds
+ *   right after the run and works without one. freq_ratio compares the
+ *   run to the scalar variant of the same kernel and size (cycles_ghz
+ *   when available, else probe_ghz).
+ *
+ * Environment:
+ *   LRC_SIMD_SIZES=16k,256k,4m,64m   Working sets (operands plus results)
+ *   LRC_RUNS, LRC_MIN_RUNS, ...      Run control (core/run_control.h)
  */
 
 #define _GNU_SOURCE
@@ -23,242 +39,193 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <time.h>
-#include <immintrin.h>
-
-#define ARRAY_SIZE (1024 * 1024)  // 1M elements
-#define ITERATIONS 100
+#include "../core/simd_kernels.h"
+#include "../core/perf_counters.h"
+#include "../core/run_control.h"
+#include "../core/tsc.h"
+#include "../core/results.h"
 
-static inline uint64_t get_time_ns(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
-}
-
-// Scalar implementation: add two arrays element by element
-uint64_t add_scalar(float *a, float *b, float *result, size_t n) {
-    uint64_t start = get_time_ns();
-    
-    for (size_t i = 0; i < n; i++) {
-        result[i] = a[i] + b[i];
-    }
-    
-    return get_time_ns() - start;
-}
+#define MIN_RUNS 5
+#define MAX_RUNS 50
+#define MAX_SIZES 16
+#define RUN_TARGET_NS 2000000ULL          // Passes batched until a run takes ~2 ms
 
-// Auto-vectorized (compiler decides)
-uint64_t add_auto_vectorized(float *a, float *b, float *result, size_t n) {
-    uint64_t start = get_time_ns();
-    
-    // Hint to compiler this can be vectorized
-    #pragma GCC ivdep
-    for (size_t i = 0; i < n; i++) {
-        result[i] = a[i] + b[i];
-    }
-    
-    return get_time_ns() - start;
-}
+static perf_counters_t perf;
+static int have_perf;
 
-// Explicit SSE (128-bit, 4 floats at once)
-uint64_t add_sse(float *a, float *b, float *result, size_t n) {
-    uint64_t start = get_time_ns();
-    
-    size_t i;
-    for (i = 0; i < n - 3; i += 4) {
-        __m128 va = _mm_load_ps(&a[i]);
-        __m128 vb = _mm_load_ps(&b[i]);
-        __m128 vr = _mm_add_ps(va, vb);
-        _mm_store_ps(&result[i], vr);
-    }
+/*
+ * "4096", "64k", "1m", "2g".
+ */
+static size_t parse_size(const char *tok) {
+    char *end;
+    double value = strtod(tok, &end);
     
-    // Handle remainder
-    for (; i < n; i++) {
-        result[i] = a[i] + b[i];
+    switch (*end) {
+    case 'k': case 'K': return (size_t)(value * 1024);
+    case 'm': case 'M': return (size_t)(value * 1024 * 1024);
+    case 'g': case 'G': return (size_t)(value * 1024 * 1024 * 1024);
+    default: return (size_t)value;
     }
-    
-    return get_time_ns() - start;
 }
 
-// AVX2 (256-bit, 8 floats at once)
-uint64_t add_avx2(float *a, float *b, float *result, size_t n) {
-    uint64_t start = get_time_ns();
-    
-    size_t i;
-    for (i = 0; i < n - 7; i += 8) {
-        __m256 va = _mm256_load_ps(&a[i]);
-        __m256 vb = _mm256_load_ps(&b[i]);
-        __m256 vr = _mm256_add_ps(va, vb);
-        _mm256_store_ps(&result[i], vr);
-    }
+static int parse_sizes(size_t *out) {
+    const char *env = getenv("LRC_SIMD_SIZES");
+    char *copy = strdup(env && *env ? env : "16k,256k,4m,64m");
+    int count = 0;
     
-    // Handle remainder
-    for (; i < n; i++) {
-        result[i] = a[i] + b[i];
+    for (char *tok = strtok(copy, ","); tok && count < MAX_SIZES; tok = strtok(NULL, ",")) {
+        size_t size = parse_size(tok);
+        if (size > 0) out[count++] = size;
     }
-    
-    return get_time_ns() - start;
+    free(copy);
+    return count;
 }
 
-// Dot product: scalar
-float dot_product_scalar(float *a, float *b, size_t n) {
-    float sum = 0.0f;
-    for (size_t i = 0; i < n; i++) {
-        sum += a[i] * b[i];
-    }
-    return sum;
+static int checksums_match(double ref, double value) {
+    double diff = ref > value ? ref - value : value - ref;
+    double scale = ref < 0 ? -ref : ref;
+    return diff <= 1e-3 * (scale > 1.0 ? scale : 1.0);
 }
 
-// Dot product: SSE
-float dot_product_sse(float *a, float *b, size_t n) {
-    __m128 sum = _mm_setzero_ps();
-    
-    size_t i;
-    for (i = 0; i < n - 3; i += 4) {
-        __m128 va = _mm_load_ps(&a[i]);
-        __m128 vb = _mm_load_ps(&b[i]);
-        sum = _mm_add_ps(sum, _mm_mul_ps(va, vb));
-    }
-    
-    // Horizontal add to get final sum
-    sum = _mm_hadd_ps(sum, sum);
-    sum = _mm_hadd_ps(sum, sum);
-    
-    float result = _mm_cvtss_f32(sum);
-    
-    // Handle remainder
-    for (; i < n; i++) {
-        result += a[i] * b[i];
-    }
-    
-    return result;
-}
-
-void run_experiment(FILE *csv) {
-    // Allocate aligned memory for SIMD
-    float *a = (float*)aligned_alloc(32, ARRAY_SIZE * sizeof(float));
-    float *b = (float*)aligned_alloc(32, ARRAY_SIZE * sizeof(float));
-    float *result = (float*)aligned_alloc(32, ARRAY_SIZE * sizeof(float));
-    
-    if (!a || !b || !result) {
-        perror("aligned_alloc");
-        return;
-    }
-    
-    // Initialize with random data
-    for (size_t i = 0; i < ARRAY_SIZE; i++) {
-        a[i] = (float)i * 0.1f;
-        b[i] = (float)i * 0.2f;
-    }
-    
-    int run = 0;
-    
-    printf("Testing vector addition (%zu elements, %d iterations)...\n", 
-           ARRAY_SIZE, ITERATIONS);
-    
-    // Test 1: Scalar
-    printf("  Scalar implementation...\n");
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
-        uint64_t runtime = add_scalar(a, b, result, ARRAY_SIZE);
-        double throughput_gflops = (double)ARRAY_SIZE / runtime;  // GFLOP/s
-        
-        fprintf(csv, "%d,scalar_add,%lu,%lu,0,0,0,0,-1,-1,%.3f\n",
-               run++, start_ts, runtime, throughput_gflops);
-    }
-    
-    // Test 2: Auto-vectorized
-    printf("  Auto-vectorized...\n");
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
-        uint64_t runtime = add_auto_vectorized(a, b, result, ARRAY_SIZE);
-        double throughput_gflops = (double)ARRAY_SIZE / runtime;
-        
-        fprintf(csv, "%d,auto_vectorized_add,%lu,%lu,0,0,0,0,-1,-1,%.3f\n",
-               run++, start_ts, runtime, throughput_gflops);
-    }
-    
-    // Test 3: Explicit SSE
-    printf("  SSE (128-bit)...\n");
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
-        uint64_t runtime = add_sse(a, b, result, ARRAY_SIZE);
-        double throughput_gflops = (double)ARRAY_SIZE / runtime;
-        
-        fprintf(csv, "%d,sse_add,%lu,%lu,0,0,0,0,-1,-1,%.3f\n",
-               run++, start_ts, runtime, throughput_gflops);
-    }
-    
-    // Test 4: AVX2
-    printf("  AVX2 (256-bit)...\n");
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        uint64_t start_ts = get_time_ns();
-        uint64_t runtime = add_avx2(a, b, result, ARRAY_SIZE);
-        double throughput_gflops = (double)ARRAY_SIZE / runtime;
+/*
+ * One (size, kernel, variant) point under run control.
+ * Returns the mean clock of the measured runs (cycles_ghz, or probe_ghz
+ * without a PMU) for the scalar baseline of freq_ratio.
+ */
+static double run_point(results_t *csv, simd_suite_t *suite, simd_op_t op, simd_isa_t isa,
+                        double ref_checksum, double base_ghz) {
+    double ops, bytes;
+    simd_suite_work(suite, op, &ops, &bytes);
+    
+    double check = simd_suite_run(suite, op, isa);
+    if (!checksums_match(ref_checksum, check)) {
+        printf("    Warning: %s/%s checksum %.6g, scalar %.6g\n",
+               simd_op_name(op), simd_isa_name(isa), check, ref_checksum);
+    }
+    
+    // Batch passes so short kernels are not dominated by timer overhead
+    uint64_t begin = tsc_begin();
+    simd_suite_run(suite, op, isa);
+    double pass_ns = tsc_to_ns(tsc_elapsed(begin, tsc_end()));
+    uint64_t passes = pass_ns > 0 && pass_ns < RUN_TARGET_NS ? (uint64_t)(RUN_TARGET_NS / pass_ns) : 1;
+    
+    char workload[64];
+    snprintf(workload, sizeof(workload), "%s_%s", simd_op_name(op), simd_isa_name(isa));
+    
+    run_control_t rc;
+    double ghz_sum = 0.0;
+    volatile double sink = 0.0;
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
+        uint64_t start_ts = tsc_clock_ns();
+        if (have_perf) perf_counters_start(&perf);
+        begin = tsc_begin();
+        for (uint64_t p = 0; p < passes; p++) sink += simd_suite_run(suite, op, isa);
+        uint64_t end = tsc_end();
+        if (have_perf) perf_counters_stop(&perf);
+        double probe_ghz = simd_freq_probe_ghz();
         
-        fprintf(csv, "%d,avx2_add,%lu,%lu,0,0,0,0,-1,-1,%.3f\n",
-               run++, start_ts, runtime, throughput_gflops);
-    }
-    
-    // Test 5: Dot product comparison
-    printf("Testing dot product...\n");
-    
-    for (int iter = 0; iter < 10; iter++) {
-        uint64_t start = get_time_ns();
-        float result_scalar = dot_product_scalar(a, b, ARRAY_SIZE);
-        uint64_t runtime_scalar = get_time_ns() - start;
+        uint64_t runtime = (uint64_t)tsc_to_ns(tsc_elapsed(begin, end));
+        if (runtime == 0) runtime = 1;
+        if (!run_control_add(&rc, (double)runtime)) continue;   // Warmup
         
-        start = get_time_ns();
-        float result_sse = dot_product_sse(a, b, ARRAY_SIZE);
-        uint64_t runtime_sse = get_time_ns() - start;
+        double cycles_ghz = have_perf ? (double)perf.cycles / runtime : 0.0;
+        double ghz = have_perf ? cycles_ghz : probe_ghz;
+        ghz_sum += ghz;
         
-        // Verify correctness
-        float diff = result_scalar - result_sse;
-        if (diff > 0.01f || diff < -0.01f) {
-            printf("Warning: Results differ (scalar=%.2f, sse=%.2f)\n", 
-                   result_scalar, result_sse);
+        results_u64(csv, run_control_index(&rc));
+        results_str(csv, workload);
+        results_str(csv, simd_op_name(op));
+        results_str(csv, simd_isa_name(isa));
+        results_u64(csv, suite->bytes);
+        results_u64(csv, passes);
+        results_runtime(csv, start_ts, runtime);
+        results_f64(csv, ops * passes / runtime);
+        results_f64(csv, bytes * passes / runtime);
+        results_f64(csv, cycles_ghz);
+        results_f64(csv, probe_ghz);
+        results_f64(csv, base_ghz > 0 ? ghz / base_ghz : 1.0);
+    }
+    
+    double median_ns = rc.median / passes;
+    double mean_ghz = rc.runs ? ghz_sum / rc.runs : 0.0;
+    printf("    %-8s %-12s %9.2f Gop/s %9.2f GB/s %6.2f GHz (x%.2f) %4d runs\n",
+           simd_op_name(op), simd_isa_name(isa), ops / median_ns, bytes / median_ns,
+           mean_ghz, base_ghz > 0 ? mean_ghz / base_ghz : 1.0, rc.runs);
+    return mean_ghz;
+}
+
+void run_experiment(results_t *csv, const size_t *sizes, int num_sizes) {
+    for (int s = 0; s < num_sizes; s++) {
+        simd_suite_t suite;
+        if (simd_suite_init(&suite, sizes[s]) != 0) {
+            fprintf(stderr, "Skipping %zu bytes: allocation failed\n", sizes[s]);
+            continue;
         }
+        printf("Working set %zu KB:\n", suite.bytes / 1024);
         
-        fprintf(csv, "%d,dot_product_scalar,%lu,%lu,0,0,0,0,-1,-1,%.3f\n",
-               run++, start, runtime_scalar, (double)ARRAY_SIZE / runtime_scalar);
-        
-        fprintf(csv, "%d,dot_product_sse,%lu,%lu,0,0,0,0,-1,-1,%.3f\n",
-               run++, start, runtime_sse, (double)ARRAY_SIZE / runtime_sse);
+        for (int op = 0; op < SIMD_OP_COUNT; op++) {
+            simd_suite_prepare(&suite, (simd_op_t)op);
+            double ref = simd_suite_run(&suite, (simd_op_t)op, SIMD_ISA_SCALAR);
+            double base_ghz = 0.0;
+            
+            for (int isa = 0; isa < SIMD_ISA_COUNT; isa++) {
+                if (!simd_isa_supported((simd_isa_t)isa) ||
+                    !simd_op_has_variant((simd_op_t)op, (simd_isa_t)isa)) continue;
+                double ghz = run_point(csv, &suite, (simd_op_t)op, (simd_isa_t)isa, ref, base_ghz);
+                if (isa == SIMD_ISA_SCALAR) base_ghz = ghz;
+            }
+        }
+        simd_suite_cleanup(&suite);
     }
-    
-    free(a);
-    free(b);
-    free(result);
 }
 
 int main(void) {
-    FILE *csv = fopen("data/simd_performance.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    size_t sizes[MAX_SIZES];
+    int num_sizes = parse_sizes(sizes);
+    results_t csv;
+    
+    tsc_init();
+    have_perf = perf_counters_init_group(&perf) == 0 || perf_counters_init(&perf) == 0;
+    
+    if (results_open(&csv, "data/simd_performance.csv",
+                     (size_t)num_sizes * SIMD_OP_COUNT * SIMD_ISA_COUNT * MIN_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "throughput_gflops\n");
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_column(&csv, "kernel", RESULT_STR, 0);
+    results_add_column(&csv, "isa", RESULT_STR, 0);
+    results_add_column(&csv, "working_set_bytes", RESULT_U64, 0);
+    results_add_column(&csv, "passes", RESULT_U64, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "throughput_gflops", RESULT_F64, 3);
+    results_add_column(&csv, "throughput_gbs", RESULT_F64, 3);
+    results_add_column(&csv, "cycles_ghz", RESULT_F64, 3);
+    results_add_column(&csv, "probe_ghz", RESULT_F64, 3);
+    results_add_column(&csv, "freq_ratio", RESULT_F64, 3);
     
-    printf("SIMD vs Scalar Performance Benchmark\n");
-    printf("====================================\n\n");
-    printf("Array size: %d elements (%.1f MB)\n", 
-           ARRAY_SIZE, (ARRAY_SIZE * sizeof(float)) / (1024.0 * 1024.0));
-    printf("Iterations: %d\n\n", ITERATIONS);
+    printf("SIMD Kernel Suite Benchmark\n");
+    printf("===========================\n\n");
+    printf("ISAs:");
+    for (int isa = 0; isa < SIMD_ISA_COUNT; isa++) {
+        if (simd_isa_supported((simd_isa_t)isa)) printf(" %s", simd_isa_name((simd_isa_t)isa));
+    }
+    printf("\nTimer: %s, cycle counter: %s\n\n", tsc_source_name(),
+           have_perf ? "perf" : "unavailable (freq_ratio from probe_ghz)");
     
-    run_experiment(csv);
+    run_experiment(&csv, sizes, num_sizes);
     
-    fclose(csv);
+    if (have_perf) perf_counters_close(&perf);
+    if (results_close(&csv) != 0) return 1;
     
     printf("\nResults saved to data/simd_performance.csv\n");
     printf("\nExpected patterns:\n");
-    printf("  Scalar: Baseline throughput\n");
-    printf("  SSE: ~4x faster (4 floats at once)\n");
-    printf("  AVX2: ~8x faster (8 floats at once)\n");
-    printf("  Auto-vectorized: Depends on compiler optimization\n");
-    printf("\nNote: Requires CPU with SSE/AVX2 support\n");
+    printf("  L1/L2: throughput grows with vector width; dot, matmul, dot_i8 most\n");
+    printf("  DRAM: streaming kernels converge on memory bandwidth\n");
+    printf("  freq_ratio < 1: the core clocked down for wide vectors (licence)\n");
     
     return 0;
 }
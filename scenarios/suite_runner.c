@@ -0,0 +1,462 @@
+/*
+ * suite_runner.c - Partitioned parallel scenario runner
+ *
+ * Purpose:
+ *   Run the scenario suite concurrently on disjoint CPU partitions
+ *   instead of one binary after another on CPU 0. Single-core scenarios
+ *   share the machine, one per L3 domain (or NUMA node); multi-threaded
+ *   scenarios still get the whole machine to themselves.
+ *
+ * Method:
+ *   - Partition the allowed CPUs by topology level (LRC_PARTITION_LEVEL
+ *     or -l: l3 (default), node, package)
+ *   - Phase 1: single-core scenarios are handed to the next free
+ *     partition. Each child gets that partition's affinity mask and
+ *     LRC_CPU_SET=<cpulist>, so pin_to_cpu(0) inside the scenario lands
+ *     on the partition's first CPU (see sched_map_cpu())
+ *   - Phase 2: exclusive scenarios (threads, NUMA placement, processes,
+ *     disk) run one at a time with every allowed CPU
+ *   - Every run is recorded in data/suite_runs.csv (scenario, partition,
+ *     CPU list, wall time, exit status); stdout/stderr go to
+ *     data/logs/<scenario>.log
+ *   - Children get LRC_PARTITION=<level>:<id> ("all" in phase 2), which
+ *     the result sink writes as a partition column in every result file
+ *
+ * Usage:
+ *   ./suite_runner [-l l3|node|package] [-n] [scenario ...]
+ *   -n prints the schedule without running anything.
+ *   LRC_RUNNER_CPUS=<cpulist> restricts the runner (and every partition)
+ *   to those CPUs, e.g. the isolcpus list in
+ *   /sys/devices/system/cpu/isolated.
+ *
+ * Limitations:
+ *   - Partitions of one node still share its memory controllers, so
+ *     DRAM-bound single-core scenarios can see neighbours' traffic at
+ *     l3 level; use -l node for memory latency work
+ *   - A partition isolates CPUs and caches, not interrupts or SMT
+ *     siblings of the runner itself (which only sleeps in waitpid)
+ *
+ * Justification for syscalls:
+ *   fork/execv/waitpid and sched_setaffinity per scenario launch only;
+ *   the runner measures nothing itself.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../core/topology.h"
+#include "../core/results.h"
+
+#define MAX_PARTITIONS 1024
+#define CPULIST_LEN 4096
+
+typedef enum {
+    RUN_PARTITIONED = 0,      // Single-core: one partition
+    RUN_EXCLUSIVE             // Whole machine, nothing else running
+} run_mode_t;
+
+typedef struct {
+    const char *name;
+    run_mode_t mode;
+    int from_root;            // Writes data/ relative to the repo root
+} scenario_t;
+
+static const scenario_t suite[] = {
+    { "null_baseline",        RUN_PARTITIONED, 0 },
+    { "pinned",               RUN_PARTITIONED, 0 },
+    { "nice_levels",          RUN_PARTITIONED, 0 },
+    { "cache_hierarchy",      RUN_PARTITIONED, 0 },
+    { "cache_analysis",       RUN_PARTITIONED, 0 },
+    { "latency_vs_bandwidth", RUN_PARTITIONED, 0 },
+    { "syscall_overhead",     RUN_PARTITIONED, 0 },
+    { "memory_parallelism",   RUN_PARTITIONED, 0 },
+    { "prefetch_distance",    RUN_PARTITIONED, 0 },
+    { "tlb_pressure",         RUN_PARTITIONED, 1 },
+    { "huge_pages",           RUN_PARTITIONED, 1 },
+    { "branch_prediction",    RUN_PARTITIONED, 1 },
+    { "simd_performance",     RUN_PARTITIONED, 1 },
+    { "numa_locality",        RUN_EXCLUSIVE,   0 },
+    { "lock_scaling",         RUN_EXCLUSIVE,   0 },
+    { "realistic_patterns",   RUN_EXCLUSIVE,   0 },
+    { "loaded_latency",       RUN_EXCLUSIVE,   0 },
+    { "core_to_core",         RUN_EXCLUSIVE,   0 },
+    { "queue_handoff",        RUN_EXCLUSIVE,   0 },
+    { "false_sharing",        RUN_EXCLUSIVE,   1 },
+    { "atomic_operations",    RUN_EXCLUSIVE,   1 },
+    { "memory_bandwidth",     RUN_EXCLUSIVE,   1 },
+    { "process_creation",     RUN_EXCLUSIVE,   1 },
+    { "rwlock_scaling",       RUN_EXCLUSIVE,   1 },
+    { "file_io_patterns",     RUN_EXCLUSIVE,   1 },
+};
+
+#define SUITE_SIZE (int)(sizeof(suite) / sizeof(suite[0]))
+
+typedef struct {
+    int id;                   // Domain id at the partition level, -1 = all CPUs
+    cpu_set_t *set;
+    size_t setsize;
+    char cpulist[CPULIST_LEN];
+    pid_t pid;                // Running child, 0 = free
+    const scenario_t *scenario;
+    uint64_t start_ns;
+} partition_t;
+
+static const char *level_names[] = { "core", "l3", "node", "package" };
+
+static char root_dir[4096];
+
+static inline uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* "0-3,8" style list of the CPUs in set */
+static void format_cpulist(const cpu_set_t *set, size_t setsize, int limit, char *out, size_t len) {
+    size_t used = 0;
+    out[0] = '\0';
+    
+    for (int c = 0; c < limit; c++) {
+        if (!CPU_ISSET_S(c, setsize, set)) continue;
+        int hi = c;
+        while (hi + 1 < limit && CPU_ISSET_S(hi + 1, setsize, set)) hi++;
+        
+        int n = hi > c ? snprintf(out + used, len - used, "%s%d-%d", used ? "," : "", c, hi)
+                       : snprintf(out + used, len - used, "%s%d", used ? "," : "", c);
+        if (n < 0 || (size_t)n >= len - used) break;
+        used += n;
+        c = hi;
+    }
+}
+
+static int parse_level(const char *name, topo_level_t *level) {
+    for (int l = TOPO_LEVEL_L3; l < TOPO_LEVEL_COUNT; l++) {
+        if (strcmp(name, level_names[l]) == 0) {
+            *level = (topo_level_t)l;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const scenario_t *find_scenario(const char *name) {
+    for (int i = 0; i < SUITE_SIZE; i++) {
+        if (strcmp(suite[i].name, name) == 0) return &suite[i];
+    }
+    return NULL;
+}
+
+static int scenario_built(const scenario_t *s) {
+    char path[4200];
+    snprintf(path, sizeof(path), "%s/scenarios/%s", root_dir, s->name);
+    return access(path, X_OK) == 0;
+}
+
+/*
+ * Fork one scenario onto a partition. The child restricts itself before
+ * exec, so every thread it creates inherits the partition's mask.
+ */
+static pid_t launch(const scenario_t *s, const partition_t *p, const char *level, int partitioned) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+    
+    char path[4200];
+    snprintf(path, sizeof(path), "%s/data/logs/%s.log", root_dir, s->name);
+    int log = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log >= 0) {
+        dup2(log, STDOUT_FILENO);
+        dup2(log, STDERR_FILENO);
+        close(log);
+    }
+    
+    if (sched_setaffinity(0, p->setsize, p->set) != 0) {
+        perror("sched_setaffinity");
+        _exit(126);
+    }
+    // The result sink stamps every row with it (partition column)
+    char label[64];
+    snprintf(label, sizeof(label), "%s:%d", level, p->id);
+    setenv("LRC_PARTITION", partitioned ? label : "all", 1);
+    if (partitioned) {
+        setenv("LRC_CPU_SET", p->cpulist, 1);
+    } else {
+        unsetenv("LRC_CPU_SET");
+    }
+    
+    snprintf(path, sizeof(path), "%s%s", root_dir, s->from_root ? "" : "/scenarios");
+    if (chdir(path) != 0) {
+        perror("chdir");
+        _exit(126);
+    }
+    
+    snprintf(path, sizeof(path), "%s/scenarios/%s", root_dir, s->name);
+    execl(path, s->name, (char *)NULL);
+    perror("execl");
+    _exit(127);
+}
+
+static void record(results_t *csv, const partition_t *p, const char *level, int status,
+                   uint64_t end_ns) {
+    double elapsed = (double)(end_ns - p->start_ns) / 1e9;
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    
+    results_str(csv, p->scenario->name);
+    results_str(csv, p->scenario->mode == RUN_PARTITIONED ? "partitioned" : "exclusive");
+    results_str(csv, level);
+    results_i64(csv, p->id);
+    results_str(csv, p->cpulist);
+    results_u64(csv, p->start_ns);
+    results_f64(csv, elapsed);
+    results_i64(csv, code);
+    
+    printf("  %-22s %-8s %-5d %-20s %8.1fs %s\n", p->scenario->name, level, p->id,
+           p->cpulist, elapsed, code == 0 ? "ok" : "FAILED");
+    fflush(stdout);
+}
+
+/* Wait for any child and free its partition; returns the exit code */
+static int reap(results_t *csv, partition_t *parts, int count, const char *level) {
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) return -1;
+    
+    for (int i = 0; i < count; i++) {
+        if (parts[i].pid != pid) continue;
+        record(csv, &parts[i], level, status, get_time_ns());
+        parts[i].pid = 0;
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+    return 0;
+}
+
+static int build_partitions(const topology_t *topo, topo_level_t level, partition_t *parts) {
+    int count = 0;
+    
+    for (int d = 0; d < topo->num_domains[level] && count < MAX_PARTITIONS; d++) {
+        partition_t *p = &parts[count];
+        memset(p, 0, sizeof(*p));
+        p->id = d;
+        p->set = topology_domain_cpuset(topo, level, d, &p->setsize);
+        if (!p->set) continue;
+        if (CPU_COUNT_S(p->setsize, p->set) == 0) {
+            CPU_FREE(p->set);
+            continue;
+        }
+        format_cpulist(p->set, p->setsize, topo->cpu_limit, p->cpulist, sizeof(p->cpulist));
+        count++;
+    }
+    return count;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-l l3|node|package] [-n] [scenario ...]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    topo_level_t level = TOPO_LEVEL_L3;
+    int dry_run = 0;
+    int opt;
+    
+    const char *env = getenv("LRC_PARTITION_LEVEL");
+    if (env && parse_level(env, &level) != 0) {
+        fprintf(stderr, "Unknown LRC_PARTITION_LEVEL '%s'\n", env);
+        return 1;
+    }
+    while ((opt = getopt(argc, argv, "l:nh")) != -1) {
+        switch (opt) {
+            case 'l':
+                if (parse_level(optarg, &level) != 0) {
+                    fprintf(stderr, "Unknown level '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+                dry_run = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    
+    // Repo root = parent of the directory holding this binary
+    char self[4096];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len <= 0) {
+        perror("readlink");
+        return 1;
+    }
+    self[len] = '\0';
+    for (int up = 0; up < 2; up++) {
+        char *slash = strrchr(self, '/');
+        if (slash) *slash = '\0';
+    }
+    memcpy(root_dir, self, sizeof(root_dir));
+    
+    // Optional CPU restriction for the whole run (e.g. isolcpus)
+    env = getenv("LRC_RUNNER_CPUS");
+    if (env && *env) {
+        size_t setsize = CPU_ALLOC_SIZE(CPU_SETSIZE);
+        cpu_set_t *set = CPU_ALLOC(CPU_SETSIZE);
+        if (!set || topology_parse_cpulist(env, set, setsize) == 0 ||
+            sched_setaffinity(0, setsize, set) != 0) {
+            fprintf(stderr, "Cannot restrict to LRC_RUNNER_CPUS='%s'\n", env);
+            return 1;
+        }
+        CPU_FREE(set);
+    }
+    
+    topology_t topo;
+    if (topology_init(&topo) != 0) {
+        fprintf(stderr, "Failed to read CPU topology\n");
+        return 1;
+    }
+    
+    static partition_t parts[MAX_PARTITIONS];
+    int num_parts = build_partitions(&topo, level, parts);
+    
+    // Whole-machine partition for exclusive runs
+    partition_t all;
+    memset(&all, 0, sizeof(all));
+    all.id = -1;
+    all.setsize = CPU_ALLOC_SIZE(topo.cpu_limit);
+    all.set = CPU_ALLOC(topo.cpu_limit);
+    if (!all.set || num_parts == 0) {
+        fprintf(stderr, "No CPU partitions\n");
+        return 1;
+    }
+    CPU_ZERO_S(all.setsize, all.set);
+    for (int i = 0; i < topo.num_cpus; i++) {
+        CPU_SET_S(topo.cpus[i].cpu, all.setsize, all.set);
+    }
+    format_cpulist(all.set, all.setsize, topo.cpu_limit, all.cpulist, sizeof(all.cpulist));
+    
+    // Scenario list: arguments, or every built scenario of the suite
+    const scenario_t *queue[SUITE_SIZE];
+    int num_queued = 0;
+    if (optind < argc) {
+        for (int i = optind; i < argc && num_queued < SUITE_SIZE; i++) {
+            const scenario_t *s = find_scenario(argv[i]);
+            if (!s) {
+                fprintf(stderr, "Unknown scenario '%s'\n", argv[i]);
+                return 1;
+            }
+            queue[num_queued++] = s;
+        }
+    } else {
+        for (int i = 0; i < SUITE_SIZE; i++) {
+            if (scenario_built(&suite[i])) queue[num_queued++] = &suite[i];
+        }
+    }
+    
+    printf("Suite runner: %d %s partition(s) over CPUs %s, %d scenario(s)\n",
+           num_parts, level_names[level], all.cpulist, num_queued);
+    for (int i = 0; i < num_parts; i++) {
+        printf("  partition %-4d CPUs %s\n", parts[i].id, parts[i].cpulist);
+    }
+    
+    if (dry_run) {
+        printf("\nPhase 1 (partitioned, up to %d at once):", num_parts);
+        for (int i = 0; i < num_queued; i++) {
+            if (queue[i]->mode == RUN_PARTITIONED) printf(" %s", queue[i]->name);
+        }
+        printf("\nPhase 2 (exclusive, one at a time):");
+        for (int i = 0; i < num_queued; i++) {
+            if (queue[i]->mode == RUN_EXCLUSIVE) printf(" %s", queue[i]->name);
+        }
+        printf("\n");
+        return 0;
+    }
+    
+    char dir[4200];
+    snprintf(dir, sizeof(dir), "%s/data", root_dir);
+    mkdir(dir, 0755);
+    snprintf(dir, sizeof(dir), "%s/data/logs", root_dir);
+    mkdir(dir, 0755);
+    
+    results_t csv;
+    snprintf(dir, sizeof(dir), "%s/data/suite_runs.csv", root_dir);
+    if (results_open(&csv, dir, num_queued) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    results_add_column(&csv, "scenario", RESULT_STR, 0);
+    results_add_column(&csv, "mode", RESULT_STR, 0);
+    results_add_column(&csv, "partition_level", RESULT_STR, 0);
+    results_add_column(&csv, "partition", RESULT_I64, 0);
+    results_add_column(&csv, "cpus", RESULT_STR, 0);
+    results_add_column(&csv, "start_ns", RESULT_U64, 0);
+    results_add_column(&csv, "elapsed_s", RESULT_F64, 3);
+    results_add_column(&csv, "exit_code", RESULT_I64, 0);
+    
+    uint64_t suite_start = get_time_ns();
+    int failed = 0, running = 0;
+    
+    printf("\n  %-22s %-8s %-5s %-20s %9s\n", "Scenario", "Level", "Part", "CPUs", "Wall");
+    
+    // Phase 1: single-core scenarios, one per free partition
+    for (int i = 0; i < num_queued; i++) {
+        if (queue[i]->mode != RUN_PARTITIONED) continue;
+        
+        int slot = -1;
+        while (slot < 0) {
+            for (int k = 0; k < num_parts && slot < 0; k++) {
+                if (parts[k].pid == 0) slot = k;
+            }
+            if (slot < 0) {
+                if (reap(&csv, parts, num_parts, level_names[level]) != 0) failed++;
+                running--;
+            }
+        }
+        
+        parts[slot].scenario = queue[i];
+        parts[slot].start_ns = get_time_ns();
+        parts[slot].pid = launch(queue[i], &parts[slot], level_names[level], 1);
+        if (parts[slot].pid < 0) {
+            perror("fork");
+            parts[slot].pid = 0;
+            failed++;
+            continue;
+        }
+        running++;
+    }
+    while (running > 0) {
+        if (reap(&csv, parts, num_parts, level_names[level]) != 0) failed++;
+        running--;
+    }
+    
+    // Phase 2: exclusive scenarios on the whole machine
+    for (int i = 0; i < num_queued; i++) {
+        if (queue[i]->mode != RUN_EXCLUSIVE) continue;
+        
+        all.scenario = queue[i];
+        all.start_ns = get_time_ns();
+        all.pid = launch(queue[i], &all, "all", 0);
+        if (all.pid < 0) {
+            perror("fork");
+            failed++;
+            continue;
+        }
+        if (reap(&csv, &all, 1, "all") != 0) failed++;
+    }
+    
+    double wall = (double)(get_time_ns() - suite_start) / 1e9;
+    results_close(&csv);
+    
+    printf("\nSuite finished in %.1fs, %d failure(s)\n", wall, failed);
+    printf("Run log: data/suite_runs.csv, scenario output: data/logs/\n");
+    
+    for (int i = 0; i < num_parts; i++) CPU_FREE(parts[i].set);
+    CPU_FREE(all.set);
+    topology_destroy(&topo);
+    return failed ? 1 : 0;
+}
@@ -6,17 +6,35 @@
  *   Fast syscalls (getpid) should be <100ns.
  *   Moderate syscalls (read from /dev/null) should be <1μs.
  *   Complex syscalls (getrusage) should be <10μs.
+ *   clock_gettime through the vDSO never enters the kernel; forced
+ *   through syscall() it costs as much as getpid.
+ *   Batching (readv/writev, sendmmsg/recvmmsg, io_uring) spreads the
+ *   fixed entry/exit cost over the batch, so cost per operation falls
+ *   with batch size towards the cost of the work itself.
  *
  * Method:
  *   Run tight loops calling different syscalls:
  *   1. getpid() - Fast path (vDSO accelerated on some systems)
  *   2. read(fd_devnull, buf, 1) - Simple kernel work
  *   3. getrusage(RUSAGE_SELF) - Moderate kernel work
+ *   4. clock_gettime(CLOCK_MONOTONIC) - vDSO, then via syscall(SYS_clock_gettime)
  *   
  *   Compare against pure CPU loop baseline.
  *
+ *   Batching techniques, batch sizes 1..64, each batch timed with the
+ *   TSC and divided by its size (../data/syscall_batching.csv):
+ *   - N x read() of 64 B from /dev/zero vs one readv() of N iovecs
+ *   - N x write() to /dev/null vs one writev()
+ *   - N x send()+recv() on a loopback UDP socket vs sendmmsg()+recvmmsg()
+ *   - N IORING_OP_NOP requests submitted and reaped by one io_uring_enter
+ *
+ *   Mitigation state is read from /sys/devices/system/cpu/vulnerabilities
+ *   and stored with every row (kpti, mitigations), so results from
+ *   kernels with and without page-table isolation can be told apart.
+ *
  * Variables:
  *   - Syscall type (controlled)
+ *   - Batch size (controlled, LRC_SYSCALL_BATCHES=1,2,4,8,16,32,64)
  *   - Number of calls (fixed)
  *
  * Expected outcome:
@@ -24,44 +42,412 @@
  *   - read /dev/null: 200-500ns per call
  *   - getrusage: 500-2000ns per call
  *   - Baseline (no syscall): ~3-5ns per iteration
+ *   - clock_gettime: ~20ns vDSO, ~100ns+ as a real syscall
+ *   - Batched: cost per operation falls roughly as fixed/N + work;
+ *     io_uring NOPs reach well under 100ns per request at N=64
+ *   - KPTI adds a page-table switch (~100-200ns) to every entry, so
+ *     batching gains most on kernels that report "Mitigation: PTI"
  *
  * Limitations:
  *   - Does not measure syscall variance under load
  *   - Some syscalls may be vDSO accelerated
  *   - Kernel version affects performance
  *   - Does not test all syscall types
+ *   - Mitigations are recorded, not toggled (that needs a reboot with
+ *     mitigations=off); compare runs across boots
+ *   - cycles_per_call counts TSC ticks (reference cycles), not core
+ *     cycles; without a usable TSC it equals ns_per_call
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include <fcntl.h>
+#include "../core/async_io.h"
 #include "../core/metrics.h"
+#include "../core/results.h"
+#include "../core/run_control.h"
+#include "../core/tsc.h"
 
 extern int pin_to_cpu(int cpu);
 
 #define ITERATIONS 1000000ULL
-#define RUNS 10
+#define TIMED_CALLS 10001           // Individually timed calls per run
+#define MIN_RUNS 5
+#define MAX_RUNS 30
+#define MAX_BATCH 64
+#define MAX_BATCH_SIZES 16
+#define BATCH_OPS 8192              // Operations per batching run (batches x size)
+#define MSG_BYTES 64                // Per read/write/datagram
+#define VULN_DIR "/sys/devices/system/cpu/vulnerabilities"
+
+typedef enum {
+    CALL_NONE = 0,
+    CALL_GETPID,
+    CALL_READ_DEVNULL,
+    CALL_GETRUSAGE,
+    CALL_CLOCK_VDSO,
+    CALL_CLOCK_SYSCALL
+} call_type_t;
+
+typedef enum {
+    BATCH_READ_LOOP = 0,            // N x read()
+    BATCH_READV,                    // 1 x readv() of N iovecs
+    BATCH_WRITE_LOOP,               // N x write()
+    BATCH_WRITEV,                   // 1 x writev()
+    BATCH_SEND_LOOP,                // N x send() + N x recv()
+    BATCH_MMSG,                     // 1 x sendmmsg() + recvmmsg() until N arrived
+    BATCH_URING_NOP,                // 1 x io_uring_enter for N NOPs
+    BATCH_TECHNIQUE_COUNT
+} batch_technique_t;
+
+static const char *technique_names[BATCH_TECHNIQUE_COUNT] = {
+    "read_loop", "readv", "write_loop", "writev", "send_recv_loop", "sendmmsg_recvmmsg", "uring_nop"
+};
+
+typedef struct {
+    int fd_zero;
+    int fd_null;
+    int sock;                       // UDP socket connected to itself, -1 if unavailable
+    async_io_nop_t *ring;           // NULL without io_uring
+    char bufs[MAX_BATCH][MSG_BYTES];
+    struct iovec iov[MAX_BATCH];
+    struct mmsghdr msgs[MAX_BATCH];
+} batch_ctx_t;
+
+typedef struct {
+    int kpti;                       // meltdown: "Mitigation: PTI"
+    int mitigations;                // Entries reporting "Mitigation: ..."
+} mitigations_t;
+
+static histogram_t call_latency;    // Distribution of the last timed_call_p50_ns()
+
+/*
+ * Median latency of one call, each bracketed by a fenced TSC pair with
+ * the timer overhead removed (CALL_NONE should therefore read ~0). The
+ * full distribution is left in call_latency for the latency_hist column.
+ */
+static double timed_call_p50_ns(call_type_t type, int fd, char *buf, struct rusage *ru) {
+    struct timespec ts;
+    
+    histogram_reset(&call_latency);
+    for (int i = 0; i < TIMED_CALLS; i++) {
+        uint64_t start, end;
+        switch (type) {
+            case CALL_GETPID:
+                start = tsc_begin();
+                (void)getpid();
+                end = tsc_end();
+                break;
+            case CALL_READ_DEVNULL:
+                start = tsc_begin();
+                (void)read(fd, buf, 1);
+                end = tsc_end();
+                break;
+            case CALL_GETRUSAGE:
+                start = tsc_begin();
+                (void)getrusage(RUSAGE_SELF, ru);
+                end = tsc_end();
+                break;
+            case CALL_CLOCK_VDSO:
+                start = tsc_begin();
+                (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+                end = tsc_end();
+                break;
+            case CALL_CLOCK_SYSCALL:
+                start = tsc_begin();
+                (void)syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts);
+                end = tsc_end();
+                break;
+            default:
+                start = tsc_begin();
+                end = tsc_end();
+                break;
+        }
+        histogram_record(&call_latency, (uint64_t)(tsc_to_ns(tsc_elapsed(start, end)) + 0.5));
+    }
+    return (double)histogram_percentile(&call_latency, 50.0);
+}
+
+/*
+ * Print every vulnerabilities entry and count the active mitigations.
+ */
+static void read_mitigations(mitigations_t *m) {
+    memset(m, 0, sizeof(*m));
+    DIR *dir = opendir(VULN_DIR);
+    if (!dir) {
+        printf("Mitigations: %s not available\n", VULN_DIR);
+        return;
+    }
+    
+    printf("Mitigations (%s):\n", VULN_DIR);
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+        char path[512], status[256];
+        snprintf(path, sizeof(path), "%s/%s", VULN_DIR, de->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        if (!fgets(status, sizeof(status), f)) status[0] = '\0';
+        fclose(f);
+        status[strcspn(status, "\n")] = '\0';
+        
+        if (strncmp(status, "Mitigation", 10) == 0) m->mitigations++;
+        if (strcmp(de->d_name, "meltdown") == 0 && strstr(status, "PTI")) m->kpti = 1;
+        printf("  %-26s %s\n", de->d_name, status);
+    }
+    closedir(dir);
+    printf("KPTI: %s, %d mitigations active\n\n", m->kpti ? "on" : "off", m->mitigations);
+}
+
+static int parse_batch_sizes(int *out) {
+    const char *env = getenv("LRC_SYSCALL_BATCHES");
+    char *copy = strdup(env && *env ? env : "1,2,4,8,16,32,64");
+    int count = 0;
+    
+    for (char *tok = strtok(copy, ","); tok && count < MAX_BATCH_SIZES; tok = strtok(NULL, ",")) {
+        int n = atoi(tok);
+        if (n >= 1 && n <= MAX_BATCH) out[count++] = n;
+    }
+    free(copy);
+    return count;
+}
+
+/*
+ * UDP socket on 127.0.0.1 connected to its own address: every datagram
+ * it sends is queued on its own receive buffer before send() returns.
+ */
+static int open_loopback_socket(void) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return -1;
+    
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct timeval timeout = { 1, 0 };      // A lost datagram fails the run instead of hanging
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(sock, (struct sockaddr *)&addr, &len) != 0 ||
+        connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static int batch_ctx_open(batch_ctx_t *c) {
+    memset(c, 0, sizeof(*c));
+    c->sock = -1;
+    c->fd_zero = open("/dev/zero", O_RDONLY);
+    c->fd_null = open("/dev/null", O_WRONLY);
+    if (c->fd_zero < 0 || c->fd_null < 0) return -1;
+    
+    c->sock = open_loopback_socket();
+    c->ring = async_io_nop_open(MAX_BATCH);
+    if (c->ring && async_io_nop_entries(c->ring) < MAX_BATCH) {
+        async_io_nop_close(c->ring);
+        c->ring = NULL;
+    }
+    
+    for (int i = 0; i < MAX_BATCH; i++) {
+        c->iov[i].iov_base = c->bufs[i];
+        c->iov[i].iov_len = MSG_BYTES;
+        c->msgs[i].msg_hdr.msg_iov = &c->iov[i];
+        c->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+
+static void batch_ctx_close(batch_ctx_t *c) {
+    if (c->fd_zero >= 0) close(c->fd_zero);
+    if (c->fd_null >= 0) close(c->fd_null);
+    if (c->sock >= 0) close(c->sock);
+    async_io_nop_close(c->ring);
+}
+
+static int technique_available(const batch_ctx_t *c, batch_technique_t t) {
+    if (t == BATCH_SEND_LOOP || t == BATCH_MMSG) return c->sock >= 0;
+    if (t == BATCH_URING_NOP) return c->ring != NULL;
+    return 1;
+}
+
+/* Syscalls one batch of n operations issues */
+static double technique_syscalls(batch_technique_t t, int n) {
+    switch (t) {
+        case BATCH_READ_LOOP:
+        case BATCH_WRITE_LOOP: return n;
+        case BATCH_SEND_LOOP:  return 2.0 * n;
+        case BATCH_MMSG:       return 2.0;
+        default:               return 1.0;
+    }
+}
+
+/*
+ * One batch of n operations; returns how many completed.
+ */
+static int run_batch(batch_ctx_t *c, batch_technique_t t, int n) {
+    int done = 0;
+    ssize_t r;
+    
+    switch (t) {
+        case BATCH_READ_LOOP:
+            for (int i = 0; i < n; i++) {
+                if (read(c->fd_zero, c->bufs[i], MSG_BYTES) == MSG_BYTES) done++;
+            }
+            break;
+        case BATCH_READV:
+            r = readv(c->fd_zero, c->iov, n);
+            done = r > 0 ? (int)(r / MSG_BYTES) : 0;
+            break;
+        case BATCH_WRITE_LOOP:
+            for (int i = 0; i < n; i++) {
+                if (write(c->fd_null, c->bufs[i], MSG_BYTES) == MSG_BYTES) done++;
+            }
+            break;
+        case BATCH_WRITEV:
+            r = writev(c->fd_null, c->iov, n);
+            done = r > 0 ? (int)(r / MSG_BYTES) : 0;
+            break;
+        case BATCH_SEND_LOOP:
+            for (int i = 0; i < n; i++) {
+                (void)send(c->sock, c->bufs[i], MSG_BYTES, 0);
+            }
+            for (int i = 0; i < n; i++) {
+                if (recv(c->sock, c->bufs[i], MSG_BYTES, 0) == MSG_BYTES) done++;
+            }
+            break;
+        case BATCH_MMSG:
+            (void)sendmmsg(c->sock, c->msgs, n, 0);
+            while (done < n) {
+                int got = recvmmsg(c->sock, c->msgs + done, n - done, 0, NULL);
+                if (got <= 0) break;
+                done += got;
+            }
+            break;
+        case BATCH_URING_NOP:
+            done = async_io_nop_submit(c->ring, n);
+            break;
+        default:
+            break;
+    }
+    return done;
+}
+
+/*
+ * Every technique at every batch size under run control. Each run times
+ * BATCH_OPS operations batch by batch; call_latency holds the per-batch
+ * cost divided by its size. The printed ns/call is the median of the
+ * ns_per_call column (timed batches only, no loop overhead).
+ */
+static void run_batching(results_t *out, batch_ctx_t *c, const int *sizes, int num_sizes,
+                         const mitigations_t *mit) {
+    workload_metrics_t metrics;
+    run_control_t rc;
+    
+    for (int t = 0; t < BATCH_TECHNIQUE_COUNT; t++) {
+        if (!technique_available(c, (batch_technique_t)t)) {
+            printf("  %-18s unavailable, skipped\n", technique_names[t]);
+            continue;
+        }
+        for (int s = 0; s < num_sizes; s++) {
+            int n = sizes[s];
+            int batches = BATCH_OPS / n;
+            double ops = (double)batches * n;
+            int failed = 0;
+            
+            run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+            while (run_control_next(&rc)) {
+                uint64_t ticks = 0;
+                
+                histogram_reset(&call_latency);
+                metrics_init(&metrics);
+                for (int b = 0; b < batches; b++) {
+                    uint64_t start = tsc_begin();
+                    int done = run_batch(c, (batch_technique_t)t, n);
+                    uint64_t elapsed = tsc_elapsed(start, tsc_end());
+                    if (done != n) {
+                        failed = 1;
+                        break;
+                    }
+                    ticks += elapsed;
+                    histogram_record(&call_latency, (uint64_t)(tsc_to_ns(elapsed) / n + 0.5));
+                }
+                metrics_finish(&metrics);
+                if (failed) break;
+                // Controlled on the summed batch time, the quantity in ns_per_call
+                if (!run_control_add(&rc, tsc_to_ns(ticks))) continue;   // Warmup
+                
+                double ns_per_call = tsc_to_ns(ticks) / ops;
+                double cycles_per_call = ticks / ops;
+                
+                results_u64(out, run_control_index(&rc));
+                results_str(out, technique_names[t]);
+                results_u64(out, (uint64_t)n);
+                results_f64(out, technique_syscalls((batch_technique_t)t, n) / n);
+                results_u64(out, (uint64_t)mit->kpti);
+                results_u64(out, (uint64_t)mit->mitigations);
+                results_metrics(out, &metrics);
+                results_f64(out, ns_per_call);
+                results_f64(out, cycles_per_call);
+                results_histogram(out, &call_latency);
+            }
+            
+            if (failed) {
+                printf("  %-18s batch %3d: operation failed, skipped\n", technique_names[t], n);
+                break;
+            }
+            double median_ns = rc.median / ops;
+            printf("  %-18s batch %3d: %8.1f ns/call %8.0f cycles/call %4d runs\n",
+                   technique_names[t], n, median_ns, median_ns * tsc_info()->ticks_per_ns, rc.runs);
+        }
+    }
+}
 
 int main(void) {
     workload_metrics_t metrics;
-    FILE *out = fopen("../data/syscall_overhead.csv", "w");
+    run_control_t rc;
+    results_t out, batch_out;
+    mitigations_t mit;
+    batch_ctx_t batch;
+    int batch_sizes[MAX_BATCH_SIZES];
+    int num_batch_sizes = parse_batch_sizes(batch_sizes);
     
-    if (!out) {
-        perror("fopen");
+    if (results_open(&out, "../data/syscall_overhead.csv", 6 * MAX_RUNS) != 0) {
+        perror("results_open");
         return 1;
     }
     
     pin_to_cpu(0);
     
-    fprintf(out, "run,syscall_type,");
-    metrics_print_csv_header(out);
+    results_add_column(&out, "run", RESULT_U64, 0);
+    results_add_column(&out, "syscall_type", RESULT_STR, 0);
+    results_add_column(&out, "kpti", RESULT_U64, 0);
+    results_add_column(&out, "mitigations", RESULT_U64, 0);
+    results_add_metrics_columns(&out);
+    results_add_column(&out, "call_p50_ns", RESULT_F64, 1);
+    results_add_column(&out, "latency_hist", RESULT_STR, 0);
     
     printf("Running syscall overhead experiment...\n");
-    printf("Measuring overhead of different system calls.\n\n");
+    printf("Measuring overhead of different system calls.\n");
+    tsc_init();
+    printf("Per-call timer: %s (%.1f ns overhead subtracted, %.3f ticks/ns)\n\n", tsc_source_name(),
+           tsc_to_ns(tsc_info()->overhead_ticks), tsc_info()->ticks_per_ns);
+    read_mitigations(&mit);
     
     // Open /dev/null for read tests
     int fd_null = open("/dev/null", O_RDONLY);
@@ -75,8 +461,8 @@ int main(void) {
     
     // Baseline: empty loop (no syscall)
     printf("Baseline (no syscall)...\n");
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,baseline,", run);
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         metrics_init(&metrics);
         
         volatile uint64_t sum = 0;
@@ -85,14 +471,23 @@ int main(void) {
         }
         
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
         (void)sum;
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "baseline");
+        results_u64(&out, (uint64_t)mit.kpti);
+        results_u64(&out, (uint64_t)mit.mitigations);
+        results_metrics(&out, &metrics);
+        results_f64(&out, timed_call_p50_ns(CALL_NONE, fd_null, dummy_buf, &dummy_rusage));
+        results_histogram(&out, &call_latency);
     }
+    run_control_report(&rc, "baseline");
     
     // getpid() - fast syscall (may be vDSO)
     printf("getpid() - fast path...\n");
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,getpid,", run);
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         metrics_init(&metrics);
         
         for (uint64_t i = 0; i < ITERATIONS; i++) {
@@ -100,13 +495,22 @@ int main(void) {
         }
         
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "getpid");
+        results_u64(&out, (uint64_t)mit.kpti);
+        results_u64(&out, (uint64_t)mit.mitigations);
+        results_metrics(&out, &metrics);
+        results_f64(&out, timed_call_p50_ns(CALL_GETPID, fd_null, dummy_buf, &dummy_rusage));
+        results_histogram(&out, &call_latency);
     }
+    run_control_report(&rc, "getpid");
     
     // read() from /dev/null - simple kernel work
     printf("read() from /dev/null - simple kernel work...\n");
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,read_devnull,", run);
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         metrics_init(&metrics);
         
         for (uint64_t i = 0; i < ITERATIONS; i++) {
@@ -114,13 +518,22 @@ int main(void) {
         }
         
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "read_devnull");
+        results_u64(&out, (uint64_t)mit.kpti);
+        results_u64(&out, (uint64_t)mit.mitigations);
+        results_metrics(&out, &metrics);
+        results_f64(&out, timed_call_p50_ns(CALL_READ_DEVNULL, fd_null, dummy_buf, &dummy_rusage));
+        results_histogram(&out, &call_latency);
     }
+    run_control_report(&rc, "read_devnull");
     
     // getrusage() - moderate kernel work
     printf("getrusage() - moderate kernel work...\n");
-    for (int run = 0; run < RUNS; run++) {
-        fprintf(out, "%d,getrusage,", run);
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
         metrics_init(&metrics);
         
         for (uint64_t i = 0; i < ITERATIONS; i++) {
@@ -128,20 +541,106 @@ int main(void) {
         }
         
         metrics_finish(&metrics);
-        metrics_print_csv(out, &metrics);
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "getrusage");
+        results_u64(&out, (uint64_t)mit.kpti);
+        results_u64(&out, (uint64_t)mit.mitigations);
+        results_metrics(&out, &metrics);
+        results_f64(&out, timed_call_p50_ns(CALL_GETRUSAGE, fd_null, dummy_buf, &dummy_rusage));
+        results_histogram(&out, &call_latency);
     }
+    run_control_report(&rc, "getrusage");
+    
+    // clock_gettime() through the vDSO - no kernel entry
+    printf("clock_gettime() - vDSO...\n");
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
+        struct timespec ts;
+        metrics_init(&metrics);
+        
+        for (uint64_t i = 0; i < ITERATIONS; i++) {
+            (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        }
+        
+        metrics_finish(&metrics);
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "clock_gettime_vdso");
+        results_u64(&out, (uint64_t)mit.kpti);
+        results_u64(&out, (uint64_t)mit.mitigations);
+        results_metrics(&out, &metrics);
+        results_f64(&out, timed_call_p50_ns(CALL_CLOCK_VDSO, fd_null, dummy_buf, &dummy_rusage));
+        results_histogram(&out, &call_latency);
+    }
+    run_control_report(&rc, "clock_gettime_vdso");
+    
+    // The same call forced through the syscall instruction
+    printf("syscall(SYS_clock_gettime) - real kernel entry...\n");
+    run_control_begin(&rc, MIN_RUNS, MAX_RUNS);
+    while (run_control_next(&rc)) {
+        struct timespec ts;
+        metrics_init(&metrics);
+        
+        for (uint64_t i = 0; i < ITERATIONS; i++) {
+            (void)syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts);
+        }
+        
+        metrics_finish(&metrics);
+        if (!run_control_add(&rc, metrics.runtime_ns)) continue;   // Warmup
+        
+        results_u64(&out, run_control_index(&rc));
+        results_str(&out, "clock_gettime_syscall");
+        results_u64(&out, (uint64_t)mit.kpti);
+        results_u64(&out, (uint64_t)mit.mitigations);
+        results_metrics(&out, &metrics);
+        results_f64(&out, timed_call_p50_ns(CALL_CLOCK_SYSCALL, fd_null, dummy_buf, &dummy_rusage));
+        results_histogram(&out, &call_latency);
+    }
+    run_control_report(&rc, "clock_gettime_syscall");
     
     close(fd_null);
-    fclose(out);
+    if (results_close(&out) != 0) return 1;
+    
+    // Batching: cost per operation against batch size
+    if (results_open(&batch_out, "../data/syscall_batching.csv",
+                     (size_t)BATCH_TECHNIQUE_COUNT * num_batch_sizes * MIN_RUNS) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    results_add_column(&batch_out, "run", RESULT_U64, 0);
+    results_add_column(&batch_out, "technique", RESULT_STR, 0);
+    results_add_column(&batch_out, "batch_size", RESULT_U64, 0);
+    results_add_column(&batch_out, "syscalls_per_call", RESULT_F64, 4);
+    results_add_column(&batch_out, "kpti", RESULT_U64, 0);
+    results_add_column(&batch_out, "mitigations", RESULT_U64, 0);
+    results_add_metrics_columns(&batch_out);
+    results_add_column(&batch_out, "ns_per_call", RESULT_F64, 1);
+    results_add_column(&batch_out, "cycles_per_call", RESULT_F64, 1);
+    results_add_column(&batch_out, "latency_hist", RESULT_STR, 0);
+    
+    printf("\nBatched syscalls (%d operations per run)...\n", BATCH_OPS);
+    if (batch_ctx_open(&batch) != 0) {
+        perror("open /dev/zero or /dev/null");
+        return 1;
+    }
+    run_batching(&batch_out, &batch, batch_sizes, num_batch_sizes, &mit);
+    batch_ctx_close(&batch);
+    if (results_close(&batch_out) != 0) return 1;
     
-    printf("\nResults saved to ../data/syscall_overhead.csv\n");
+    printf("\nResults saved to ../data/syscall_overhead.csv and ../data/syscall_batching.csv\n");
     printf("\nAnalyze with:\n");
     printf("  python3 ../analyze/parse.py ../data/syscall_overhead.csv\n");
+    printf("  python3 ../analyze/parse.py ../data/syscall_batching.csv\n");
     printf("\nExpected results:\n");
     printf("  baseline:      ~3-5 ns/call\n");
     printf("  getpid:        ~10-100 ns/call\n");
     printf("  read_devnull:  ~200-500 ns/call\n");
     printf("  getrusage:     ~500-2000 ns/call\n");
+    printf("  clock_gettime: ~20 ns vDSO, ~100+ ns as a syscall\n");
+    printf("  batched:       ns/call falls with batch size towards the per-item work\n");
     
     return 0;
 }
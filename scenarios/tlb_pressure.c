@@ -14,6 +14,33 @@
  * - TLB capacity (typically 64-512 entries)
  * - Page table walk cost
  * - Memory access patterns vs TLB
+ *
+ * Hardware counters:
+ *   dTLB/iTLB miss counts are appended per row (see TLB_PERF_EVENTS);
+ *   raw walk events (r0e08) can be added through LRC_PERF_EVENTS.
+ *
+ * Page sizes:
+ *   Every size/stride is repeated per LRC_PAGE_SIZES entry (default
+ *   4k,thp; add 2m/1g when hugetlb pages are reserved).
+ *
+ * TLB reach (data/tlb_reach.csv, data/tlb_levels.csv):
+ *   The stride loop above mixes L1 dTLB, STLB and data cache effects.
+ *   The reach sweep follows a chain with exactly one node per page, at
+ *   a random line of the page so the nodes do not alias into one cache
+ *   set, for 4..65536 pages in 2^(1/8) steps per page size. A control
+ *   chain over the same number of packed lines is subtracted, leaving
+ *   the translation cost (excess_ns). L1 dTLB and STLB entry counts are
+ *   inferred from the steps in that curve. The span per page size is
+ *   capped by LRC_TLB_MAX_MB (default 1024). Walk counters default to
+ *   the Intel DTLB_LOAD_MISSES.{STLB_HIT,WALK_COMPLETED,WALK_PENDING}
+ *   raw events on Intel and generic dTLB events elsewhere; override
+ *   with LRC_PERF_EVENTS.
+ *
+ * Context switch (data/tlb_switch.csv):
+ *   Time one lap over 32 and 512 warm pages right after a pipe round
+ *   trip to ourselves (syscall) or to a child process on the same CPU
+ *   (process_switch). Equal rows mean the TLB is tagged (PCID/ASID) and
+ *   survives the address-space switch.
  */
 
 #define _GNU_SOURCE
@@ -21,12 +48,35 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
-#include <sys/mman.h>
 #include <unistd.h>
+#include <sys/wait.h>
+#include "../core/perf_counters.h"
+#include "../core/results.h"
+#include "../core/lrc_alloc.h"
+#include "../core/workloads_api.h"
+
+extern int pin_to_cpu(int cpu);
 
 #define PAGE_SIZE 4096
 #define ITERATIONS 1000000
+#define TLB_PERF_EVENTS "cycles,instructions,dTLB-loads,dTLB-load-misses,iTLB-load-misses"
+#define REACH_PERF_EVENTS "cycles,dTLB-loads,dTLB-load-misses"
+#define REACH_PERF_EVENTS_INTEL REACH_PERF_EVENTS ",stlb_hit=r2008,walk_completed=r0e08,walk_pending=r1008"
+
+#define CACHE_LINE 64
+#define REACH_MIN_PAGES 4
+#define REACH_MAX_PAGES 65536
+#define REACH_MAX_POINTS 160
+#define REACH_STEPS_PER_OCTAVE 8
+#define REACH_STEP_RATIO 1.0905077326652577   // 2^(1/REACH_STEPS_PER_OCTAVE)
+#define REACH_MIN_HOPS (1ULL << 20)
+#define REACH_STEP_NS 1.0                      // Excess latency marking a new level
+#define REACH_DEFAULT_MAX_MB 1024
+#define SWITCH_SMALL_PAGES 32                  // Within any L1 dTLB
+#define SWITCH_LARGE_PAGES 512                 // Within any STLB
+#define SWITCH_PASSES 2001
 
 typedef struct {
     uint64_t timestamp_ns;
@@ -38,6 +88,19 @@ typedef struct {
     int stride;
 } measurement_t;
 
+typedef struct {
+    size_t pages;
+    double excess_ns;           // ns_per_hop minus the control chain
+} reach_point_t;
+
+typedef struct {
+    size_t l1_entries;          // Last page count before the first step
+    size_t stlb_entries;        // Last page count before the second step (0 = not seen)
+    double l1_ns;               // Excess latency per level
+    double stlb_ns;
+    double walk_ns;
+} tlb_levels_t;
+
 static inline uint64_t get_time_ns(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -70,7 +133,7 @@ uint64_t measure_tlb_pressure(char *buffer, size_t size, int stride) {
     return end - start;
 }
 
-void run_experiment(FILE *csv) {
+void run_experiment(results_t *csv, perf_event_list_t *events) {
     // Test different working set sizes
     size_t sizes[] = {
         16 * 1024,        // 16 KB - fits in TLB (4 pages)
@@ -87,69 +150,426 @@ void run_experiment(FILE *csv) {
     int strides[] = {1, 2, 4, 8, 16}; // Pages between accesses
     int num_strides = sizeof(strides) / sizeof(strides[0]);
     
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
     int run = 0;
     
-    for (int s = 0; s < num_sizes; s++) {
-        size_t size = sizes[s];
+    for (int p = 0; p < num_pages; p++) {
+        lrc_alloc_opts_t opts = { -1, pages[p], 0 };
+        const char *page_name = lrc_pages_name(pages[p]);
         
-        // Allocate buffer
-        char *buffer = mmap(NULL, size, 
-                           PROT_READ | PROT_WRITE,
-                           MAP_PRIVATE | MAP_ANONYMOUS,
-                           -1, 0);
+        for (int s = 0; s < num_sizes; s++) {
+            size_t size = sizes[s];
+            
+            // Allocate buffer
+            char *buffer = lrc_alloc(size, &opts);
+            if (!buffer) {
+                fprintf(stderr, "Skipping %zu KB with %s pages: %s\n",
+                        size / 1024, page_name, strerror(errno));
+                continue;
+            }
+            
+            // Touch all pages to ensure allocation
+            memset(buffer, 0xAA, size);
+            double huge = lrc_alloc_huge_fraction(buffer, size);
+            
+            for (int st = 0; st < num_strides; st++) {
+                int stride = strides[st];
+                
+                uint64_t start_ts = get_time_ns();
+                perf_event_list_start(events);
+                uint64_t runtime = measure_tlb_pressure(buffer, size, stride);
+                perf_event_list_stop(events);
+                
+                // Calculate per-access time
+                double ns_per_access = (double)runtime / ITERATIONS;
+                
+                results_u64(csv, run++);
+                results_strf(csv, "tlb_pressure_%zuKB_stride%d", size / 1024, stride);
+                results_runtime(csv, start_ts, runtime);
+                results_f64(csv, ns_per_access);
+                results_str(csv, page_name);
+                results_f64(csv, huge);
+                results_events(csv, events);
+            }
+            
+            lrc_free(buffer, size, pages[p]);
+        }
+    }
+}
+
+/* Whether the first /proc/cpuinfo line starting with key lists token */
+static int cpu_info_has(const char *key, const char *token) {
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[8192];
+    int found = 0;
+    
+    if (!f) return 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, strlen(key)) != 0) continue;
+        for (char *tok = strtok(strchr(line, ':'), ": \t\n"); tok; tok = strtok(NULL, " \t\n")) {
+            if (strcmp(tok, token) == 0) found = 1;
+        }
+        break;
+    }
+    fclose(f);
+    return found;
+}
+
+/*
+ * Per-level TLB reach: one chain node per page (chase_build_pages), page
+ * count swept in REACH_STEPS_PER_OCTAVE steps per doubling. A control
+ * chain with the same number of lines packed into a few huge pages
+ * gives the cache cost of the same footprint, so the excess latency is
+ * the translation cost alone.
+ */
+static double chase_ns_per_hop(const chase_t *chain, perf_event_list_t *events) {
+    uint64_t hops = chain->nodes * 16 > REACH_MIN_HOPS ? chain->nodes * 16 : REACH_MIN_HOPS;
+    
+    volatile uint64_t sink = chase_run(chain, chain->nodes * 2);   // Fill the TLBs
+    
+    if (events) perf_event_list_start(events);
+    uint64_t start = get_time_ns();
+    sink = chase_run(chain, hops);
+    uint64_t runtime = get_time_ns() - start;
+    if (events) perf_event_list_stop(events);
+    
+    (void)sink;
+    return (double)runtime / hops;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Median excess over points [from, to), clipped to the sweep */
+static double median_excess(const reach_point_t *pt, int n, int from, int to) {
+    double v[REACH_MAX_POINTS];
+    int count = 0;
+    
+    if (to > n) to = n;
+    for (int i = from; i < to; i++) v[count++] = pt[i].excess_ns;
+    if (count == 0) return from > 0 && from <= n ? pt[from - 1].excess_ns : 0.0;
+    
+    qsort(v, count, sizeof(double), compare_double);
+    return v[count / 2];
+}
+
+/* First index >= from where two consecutive points exceed limit (-1 if none) */
+static int first_step(const reach_point_t *pt, int n, int from, double limit) {
+    for (int i = from; i + 1 < n; i++) {
+        if (pt[i].excess_ns > limit && pt[i + 1].excess_ns > limit) return i;
+    }
+    return -1;
+}
+
+/*
+ * Level boundaries from the excess-latency curve. The L1 dTLB reach is
+ * the last point before the excess rises REACH_STEP_NS above the base.
+ * The STLB plateau is the median of the second octave past that step
+ * (the first one is still ramping: TLBs are not fully associative), and
+ * the STLB reach is the last point before the excess clears 1.5x that
+ * plateau (+ REACH_STEP_NS). Two consecutive points must agree, so one
+ * noisy sample does not end a level.
+ */
+static void infer_levels(const reach_point_t *pt, int n, tlb_levels_t *lv) {
+    memset(lv, 0, sizeof(*lv));
+    if (n < 4) return;
+    
+    lv->l1_ns = median_excess(pt, n, 0, REACH_STEPS_PER_OCTAVE);
+    int i1 = first_step(pt, n, 1, lv->l1_ns + REACH_STEP_NS);
+    if (i1 < 0) {
+        lv->l1_entries = pt[n - 1].pages;      // No step within the sweep
+        return;
+    }
+    lv->l1_entries = pt[i1 - 1].pages;
+    
+    lv->stlb_ns = median_excess(pt, n, i1 + REACH_STEPS_PER_OCTAVE, i1 + 2 * REACH_STEPS_PER_OCTAVE);
+    int i2 = first_step(pt, n, i1 + REACH_STEPS_PER_OCTAVE, lv->stlb_ns * 1.5 + REACH_STEP_NS);
+    if (i2 < 0) return;
+    
+    lv->stlb_entries = pt[i2 - 1].pages;
+    lv->walk_ns = median_excess(pt, n, i2 + REACH_STEPS_PER_OCTAVE, i2 + 2 * REACH_STEPS_PER_OCTAVE);
+}
+
+static void run_reach_experiment(results_t *csv, results_t *levels, perf_event_list_t *events) {
+    lrc_pages_t pages[LRC_PAGES_MAX];
+    int num_pages = lrc_pages_from_env(pages, "4k,thp");
+    const char *env = getenv("LRC_TLB_MAX_MB");
+    size_t max_span = (size_t)(env && atoi(env) > 0 ? atoi(env) : REACH_DEFAULT_MAX_MB) << 20;
+    
+    // Control chains: lines packed into huge pages, reach never exceeded
+    size_t control_size = REACH_MAX_PAGES * CACHE_LINE;
+    lrc_alloc_opts_t control_opts = { -1, LRC_PAGES_THP, 1 };
+    uint64_t *control = lrc_alloc(control_size, &control_opts);
+    if (!control) {
+        perror("lrc_alloc control");
+        return;
+    }
+    
+    for (int p = 0; p < num_pages; p++) {
+        const char *page_name = lrc_pages_name(pages[p]);
+        size_t page_size = lrc_pages_size(pages[p]);
+        size_t max_pages = max_span / page_size;
+        if (max_pages > REACH_MAX_PAGES) max_pages = REACH_MAX_PAGES;
+        if (max_pages < REACH_MIN_PAGES) {
+            printf("Skipping %s pages: LRC_TLB_MAX_MB allows fewer than %d pages\n",
+                   page_name, REACH_MIN_PAGES);
+            continue;
+        }
         
-        if (buffer == MAP_FAILED) {
-            perror("mmap");
+        lrc_alloc_opts_t opts = { -1, pages[p], 0 };
+        uint64_t *buffer = lrc_alloc(max_pages * page_size, &opts);
+        if (!buffer) {
+            fprintf(stderr, "Skipping %s pages: %s\n", page_name, strerror(errno));
             continue;
         }
         
-        // Touch all pages to ensure allocation
-        memset(buffer, 0xAA, size);
+        reach_point_t pt[REACH_MAX_POINTS];
+        int n = 0;
+        size_t last = 0;
+        
+        printf("\n%s pages (%zu KB), up to %zu pages:\n", page_name, page_size / 1024, max_pages);
+        printf("  %8s %10s %12s %12s %12s\n", "Pages", "Reach", "ns/hop", "Control", "Excess");
         
-        for (int st = 0; st < num_strides; st++) {
-            int stride = strides[st];
+        for (double f = REACH_MIN_PAGES; n < REACH_MAX_POINTS; f *= REACH_STEP_RATIO) {
+            size_t count = (size_t)(f + 0.5);
+            if (count > max_pages) break;
+            if (count == last) continue;
+            last = count;
             
-            uint64_t start_ts = get_time_ns();
-            uint64_t runtime = measure_tlb_pressure(buffer, size, stride);
+            chase_t chain, control_chain;
+            if (chase_build_pages(&chain, buffer, count, page_size, count) != 0 ||
+                chase_build(&control_chain, control, count * CACHE_LINE,
+                            CHASE_SATTOLO | CHASE_LINE, count) != 0) {
+                continue;
+            }
             
-            // Calculate per-access time
-            double ns_per_access = (double)runtime / ITERATIONS;
+            double control_ns = chase_ns_per_hop(&control_chain, NULL);
+            double ns = chase_ns_per_hop(&chain, events);
+            double huge = lrc_alloc_huge_fraction(buffer, count * page_size);
             
-            fprintf(csv, "%d,tlb_pressure_%zuKB_stride%d,%lu,%lu,0,0,0,0,-1,-1,%.2f\n",
-                   run++,
-                   size / 1024,
-                   stride,
-                   start_ts,
-                   runtime,
-                   ns_per_access);
+            pt[n].pages = count;
+            pt[n].excess_ns = ns > control_ns ? ns - control_ns : 0.0;
+            
+            results_str(csv, page_name);
+            results_f64(csv, huge);
+            results_u64(csv, count);
+            results_u64(csv, count * page_size / 1024);
+            results_f64(csv, ns);
+            results_f64(csv, control_ns);
+            results_f64(csv, pt[n].excess_ns);
+            results_events(csv, events);
+            
+            printf("  %8zu %8zuKB %12.2f %12.2f %12.2f\n",
+                   count, count * page_size / 1024, ns, control_ns, pt[n].excess_ns);
+            n++;
+        }
+        
+        tlb_levels_t lv;
+        infer_levels(pt, n, &lv);
+        
+        printf("  Inferred: L1 dTLB ~%zu entries (%zu KB reach), STLB ",
+               lv.l1_entries, lv.l1_entries * page_size / 1024);
+        if (lv.stlb_entries) {
+            printf("~%zu entries (%zu KB reach)\n", lv.stlb_entries, lv.stlb_entries * page_size / 1024);
+        } else {
+            printf("reach not exceeded within the sweep\n");
         }
         
-        munmap(buffer, size);
+        results_str(levels, page_name);
+        results_u64(levels, max_pages);
+        results_u64(levels, lv.l1_entries);
+        results_u64(levels, lv.stlb_entries);
+        results_f64(levels, lv.l1_ns);
+        results_f64(levels, lv.stlb_ns);
+        results_f64(levels, lv.walk_ns);
+        
+        lrc_free(buffer, max_pages * page_size, pages[p]);
     }
+    
+    lrc_free(control, control_size, LRC_PAGES_THP);
+}
+
+/*
+ * TLB survival across a context switch. Each pass is one lap of a warm
+ * chain right after a round trip through a pipe: to ourselves (syscall
+ * only, which still switches page tables under PTI) or to a child
+ * process on the same CPU (address-space switch). With PCID/ASID tagging
+ * the entries survive the switch and both rows match; without it the
+ * process_switch lap pays a walk per page.
+ */
+static int switch_round_trip(int wfd, int rfd) {
+    char c = 0;
+    if (write(wfd, &c, 1) != 1) return -1;
+    return read(rfd, &c, 1) == 1 ? 0 : -1;
+}
+
+static void run_switch_experiment(results_t *csv) {
+    static const size_t counts[] = { SWITCH_SMALL_PAGES, SWITCH_LARGE_PAGES };
+    static const char *conditions[] = { "syscall", "process_switch" };
+    int self_pipe[2], to_child[2], to_parent[2];
+    int pcid = cpu_info_has("flags", "pcid");
+    
+    if (pipe(self_pipe) || pipe(to_child) || pipe(to_parent)) {
+        perror("pipe");
+        return;
+    }
+    
+    pin_to_cpu(0);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return;
+    }
+    if (child == 0) {
+        // Echo each byte back until the parent closes its end
+        char c;
+        close(to_child[1]);
+        close(to_parent[0]);
+        while (read(to_child[0], &c, 1) == 1) {
+            if (write(to_parent[1], &c, 1) != 1) break;
+        }
+        _exit(0);
+    }
+    
+    size_t size = SWITCH_LARGE_PAGES * PAGE_SIZE;
+    lrc_alloc_opts_t opts = { -1, LRC_PAGES_4K, 1 };
+    uint64_t *buffer = lrc_alloc(size, &opts);
+    uint64_t *samples = malloc(SWITCH_PASSES * sizeof(uint64_t));
+    
+    printf("\nContext switch (PCID %s):\n", pcid ? "supported" : "not reported");
+    printf("  %8s %-16s %12s %12s\n", "Pages", "Condition", "p50 ns/hop", "p90 ns/hop");
+    
+    for (size_t i = 0; buffer && samples && i < sizeof(counts) / sizeof(counts[0]); i++) {
+        chase_t chain;
+        if (chase_build_pages(&chain, buffer, counts[i], PAGE_SIZE, counts[i]) != 0) continue;
+        
+        for (int cond = 0; cond < 2; cond++) {
+            int wfd = cond == 0 ? self_pipe[1] : to_child[1];
+            int rfd = cond == 0 ? self_pipe[0] : to_parent[0];
+            volatile uint64_t sink = chase_run(&chain, counts[i] * 4);
+            int passes = 0;
+            
+            for (int k = 0; k < SWITCH_PASSES; k++) {
+                if (switch_round_trip(wfd, rfd) != 0) break;
+                uint64_t start = get_time_ns();
+                sink = chase_run(&chain, counts[i]);
+                samples[passes++] = get_time_ns() - start;
+            }
+            (void)sink;
+            if (passes == 0) continue;
+            
+            qsort(samples, passes, sizeof(uint64_t), compare_u64);
+            double p50 = (double)samples[passes / 2] / counts[i];
+            double p90 = (double)samples[passes * 9 / 10] / counts[i];
+            
+            results_u64(csv, counts[i]);
+            results_str(csv, conditions[cond]);
+            results_u64(csv, pcid);
+            results_u64(csv, passes);
+            results_f64(csv, p50);
+            results_f64(csv, p90);
+            
+            printf("  %8zu %-16s %12.2f %12.2f\n", counts[i], conditions[cond], p50, p90);
+        }
+    }
+    
+    close(to_child[1]);
+    waitpid(child, NULL, 0);
+    close(to_child[0]);
+    close(to_parent[0]);
+    close(to_parent[1]);
+    close(self_pipe[0]);
+    close(self_pipe[1]);
+    free(samples);
+    if (buffer) lrc_free(buffer, size, LRC_PAGES_4K);
 }
 
 int main(void) {
-    FILE *csv = fopen("data/tlb_pressure.csv", "w");
-    if (!csv) {
-        perror("fopen");
+    results_t csv;
+    if (results_open(&csv, "data/tlb_pressure.csv", 256) != 0) {
+        perror("results_open");
         return 1;
     }
     
-    fprintf(csv, "run,workload_type,timestamp_ns,runtime_ns,"
-                 "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
-                 "minor_page_faults,major_page_faults,start_cpu,end_cpu,"
-                 "ns_per_access\n");
+    results_add_column(&csv, "run", RESULT_U64, 0);
+    results_add_column(&csv, "workload_type", RESULT_STR, 0);
+    results_add_metrics_columns(&csv);
+    results_add_column(&csv, "ns_per_access", RESULT_F64, 2);
+    results_add_column(&csv, "page_size", RESULT_STR, 0);
+    results_add_column(&csv, "huge_fraction", RESULT_F64, 3);
+    
+    perf_event_list_t events;
+    perf_event_list_from_env(&events, TLB_PERF_EVENTS, 1);
+    results_add_event_columns(&csv, &events);
     
     printf("TLB Pressure Benchmark\n");
     printf("======================\n\n");
     printf("Testing TLB behavior with different working set sizes...\n");
     printf("Iterations per test: %d\n\n", ITERATIONS);
     
-    run_experiment(csv);
+    run_experiment(&csv, &events);
+    
+    perf_event_list_close(&events);
+    if (results_close(&csv) != 0) return 1;
+    
+    // Per-level reach sweep
+    results_t reach, levels, switches;
+    if (results_open(&reach, "data/tlb_reach.csv", REACH_MAX_POINTS * LRC_PAGES_MAX) != 0 ||
+        results_open(&levels, "data/tlb_levels.csv", LRC_PAGES_MAX) != 0 ||
+        results_open(&switches, "data/tlb_switch.csv", 8) != 0) {
+        perror("results_open");
+        return 1;
+    }
+    
+    const char *reach_spec = cpu_info_has("vendor_id", "GenuineIntel") ?
+                             REACH_PERF_EVENTS_INTEL : REACH_PERF_EVENTS;
+    perf_event_list_t reach_events;
+    perf_event_list_from_env(&reach_events, reach_spec, 1);
     
-    fclose(csv);
+    results_add_column(&reach, "page_size", RESULT_STR, 0);
+    results_add_column(&reach, "huge_fraction", RESULT_F64, 3);
+    results_add_column(&reach, "pages", RESULT_U64, 0);
+    results_add_column(&reach, "reach_kb", RESULT_U64, 0);
+    results_add_column(&reach, "ns_per_hop", RESULT_F64, 3);
+    results_add_column(&reach, "control_ns_per_hop", RESULT_F64, 3);
+    results_add_column(&reach, "excess_ns", RESULT_F64, 3);
+    results_add_event_columns(&reach, &reach_events);
+    
+    results_add_column(&levels, "page_size", RESULT_STR, 0);
+    results_add_column(&levels, "max_pages", RESULT_U64, 0);
+    results_add_column(&levels, "l1_dtlb_entries", RESULT_U64, 0);
+    results_add_column(&levels, "stlb_entries", RESULT_U64, 0);
+    results_add_column(&levels, "l1_excess_ns", RESULT_F64, 3);
+    results_add_column(&levels, "stlb_excess_ns", RESULT_F64, 3);
+    results_add_column(&levels, "walk_excess_ns", RESULT_F64, 3);
+    
+    results_add_column(&switches, "pages", RESULT_U64, 0);
+    results_add_column(&switches, "condition", RESULT_STR, 0);
+    results_add_column(&switches, "pcid", RESULT_U64, 0);
+    results_add_column(&switches, "passes", RESULT_U64, 0);
+    results_add_column(&switches, "p50_ns_per_hop", RESULT_F64, 3);
+    results_add_column(&switches, "p90_ns_per_hop", RESULT_F64, 3);
+    
+    printf("\nTLB reach sweep (one node per page, control-subtracted)\n");
+    run_reach_experiment(&reach, &levels, &reach_events);
+    run_switch_experiment(&switches);
+    
+    perf_event_list_close(&reach_events);
+    if (results_close(&reach) != 0 || results_close(&levels) != 0 ||
+        results_close(&switches) != 0) {
+        return 1;
+    }
     
-    printf("\nResults saved to data/tlb_pressure.csv\n");
+    printf("\nResults saved to data/tlb_pressure.csv, data/tlb_reach.csv,\n");
+    printf("data/tlb_levels.csv and data/tlb_switch.csv\n");
     printf("\nExpected patterns:\n");
     printf("  Small working sets (16-64KB): Low TLB pressure, ~2-5 ns/access\n");
     printf("  Large working sets (1-16MB): High TLB misses, ~20-50 ns/access\n");
@@ -0,0 +1,146 @@
+/*
+ * Test log-linear histogram bucketing, percentiles and the CSV encoding
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../core/histogram.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                   \
+    if (!(cond)) {                              \
+        printf("ERROR: " __VA_ARGS__);          \
+        printf("\n");                           \
+        failures++;                             \
+    }                                           \
+} while (0)
+
+static void test_index(void) {
+    printf("Bucket index...\n");
+    
+    for (uint64_t v = 0; v < HISTOGRAM_SUB_COUNT; v++) {
+        CHECK(histogram_index(v) == (int)v, "index(%lu) = %d, expected exact", v, histogram_index(v));
+    }
+    
+    // Monotonic, bucket low edge at or below the value, within 1/64 of it
+    int prev = -1;
+    for (uint64_t v = 1; v < (1ULL << 20); v += 1 + v / 97) {
+        int idx = histogram_index(v);
+        uint64_t low = histogram_bucket_low(idx);
+        
+        CHECK(idx >= prev, "index(%lu) = %d below previous %d", v, idx, prev);
+        CHECK(low <= v, "bucket_low(%d) = %lu above value %lu", idx, low, v);
+        CHECK((double)(v - low) / v < 1.0 / HISTOGRAM_SUB_COUNT,
+              "value %lu is %.4f above its bucket", v, (double)(v - low) / v);
+        prev = idx;
+    }
+    
+    CHECK(histogram_index(UINT64_MAX) == HISTOGRAM_BUCKETS - 1,
+          "index(UINT64_MAX) = %d, expected %d", histogram_index(UINT64_MAX), HISTOGRAM_BUCKETS - 1);
+}
+
+static void test_percentile(void) {
+    static histogram_t h;
+    
+    printf("Percentiles...\n");
+    
+    histogram_reset(&h);
+    CHECK(histogram_percentile(&h, 50.0) == 0, "empty histogram p50 not 0");
+    
+    for (uint64_t v = 1; v <= 10000; v++) histogram_record(&h, v);
+    
+    CHECK(h.count == 10000 && h.min == 1 && h.max == 10000, "count/min/max %lu/%lu/%lu",
+          h.count, h.min, h.max);
+    CHECK(histogram_mean(&h) == 5000.5, "mean %.2f, expected 5000.5", histogram_mean(&h));
+    
+    static const double pct[] = { 1.0, 50.0, 90.0, 99.0, 99.9 };
+    for (size_t i = 0; i < sizeof(pct) / sizeof(pct[0]); i++) {
+        double expected = pct[i] * 100.0;
+        uint64_t got = histogram_percentile(&h, pct[i]);
+        CHECK(got >= expected && got <= expected * (1.0 + 2.0 / HISTOGRAM_SUB_COUNT),
+              "p%g = %lu, expected about %.0f", pct[i], got, expected);
+    }
+    CHECK(histogram_percentile(&h, 100.0) == 10000, "p100 = %lu, expected the max",
+          histogram_percentile(&h, 100.0));
+    
+    // Merge doubles every count
+    static histogram_t twice;
+    histogram_reset(&twice);
+    histogram_merge(&twice, &h);
+    histogram_merge(&twice, &h);
+    CHECK(twice.count == 20000 && twice.min == 1 && twice.max == 10000, "merge count/min/max");
+    CHECK(histogram_percentile(&twice, 50.0) == histogram_percentile(&h, 50.0), "merge moved p50");
+}
+
+/* Decode "<sub_bits>;<index>:<count>;<gap>:<count>;..." back into counts */
+static int decode(const char *s, histogram_t *out) {
+    char *end;
+    long sub_bits = strtol(s, &end, 10);
+    int index = 0, first = 1;
+    
+    if (sub_bits != HISTOGRAM_SUB_BITS) return -1;
+    histogram_reset(out);
+    while (*end == ';') {
+        long step = strtol(end + 1, &end, 10);
+        if (*end != ':') return -1;
+        unsigned long long count = strtoull(end + 1, &end, 10);
+        
+        index = first ? (int)step : index + (int)step;
+        first = 0;
+        if (index < 0 || index >= HISTOGRAM_BUCKETS) return -1;
+        out->counts[index] = count;
+        out->count += count;
+    }
+    return *end == '\0' ? 0 : -1;
+}
+
+static void test_encode(void) {
+    static histogram_t h, back;
+    static char buf[HISTOGRAM_ENCODED_MAX];
+    
+    printf("Encode round trip...\n");
+    
+    histogram_reset(&h);
+    size_t len = histogram_encode(&h, buf, sizeof(buf));
+    CHECK(len == strlen(buf), "encode length %zu, string %zu", len, strlen(buf));
+    CHECK(decode(buf, &back) == 0 && back.count == 0, "empty histogram \"%s\"", buf);
+    
+    uint64_t x = 88172645463325252ULL;
+    for (int i = 0; i < 100000; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        histogram_record(&h, x >> (x & 63));    // Spread over every octave
+    }
+    histogram_record(&h, 0);
+    histogram_record(&h, UINT64_MAX);
+    
+    len = histogram_encode(&h, buf, sizeof(buf));
+    CHECK(len == strlen(buf) && strchr(buf, ',') == NULL, "cell has length %zu or a comma", len);
+    CHECK(decode(buf, &back) == 0, "could not decode \"%.60s...\"", buf);
+    CHECK(back.count == h.count, "decoded %lu values, recorded %lu", back.count, h.count);
+    CHECK(memcmp(back.counts, h.counts, sizeof(h.counts)) == 0, "decoded counts differ");
+    
+    // Truncation keeps the buffer terminated
+    char small[16];
+    histogram_encode(&h, small, sizeof(small));
+    CHECK(strlen(small) == sizeof(small) - 1, "truncated cell length %zu", strlen(small));
+}
+
+int main(void) {
+    printf("=== Histogram Test ===\n\n");
+    
+    test_index();
+    test_percentile();
+    test_encode();
+    
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll tests passed!\n");
+    return 0;
+}
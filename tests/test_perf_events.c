@@ -0,0 +1,129 @@
+/*
+ * Test perf event list parsing: named, hw cache, raw and label=event
+ * entries, column names and lookup. Nothing is opened, so no PMU needed
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <linux/perf_event.h>
+
+#include "../core/perf_counters.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                   \
+    if (!(cond)) {                              \
+        printf("ERROR: " __VA_ARGS__);          \
+        printf("\n");                           \
+        failures++;                             \
+    }                                           \
+} while (0)
+
+static const struct {
+    const char *column;
+    uint32_t type;
+    uint64_t config;
+} expected[] = {
+    {"instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"dTLB_load_misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"r01d1",            PERF_TYPE_RAW,      0x01d1},
+    {"walks",            PERF_TYPE_RAW,      0x0e08},
+    {"ipc_base",         PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"page_faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+static void test_parse(void) {
+    perf_event_list_t list;
+    
+    printf("Named, raw and labelled events...\n");
+    
+    // Spaces after commas and empty entries are skipped
+    int n = perf_event_list_parse(&list,
+        "instructions, dTLB-load-misses,r01d1,walks=r0e08,,ipc_base=instructions,page-faults");
+    int count = (int)(sizeof(expected) / sizeof(expected[0]));
+    CHECK(n == count && list.count == count, "parsed %d events (count %d), expected %d",
+          n, list.count, count);
+    
+    for (int i = 0; i < list.count && i < count; i++) {
+        const perf_event_t *ev = &list.events[i];
+        CHECK(strcmp(ev->name, expected[i].column) == 0, "event %d column \"%s\", expected \"%s\"",
+              i, ev->name, expected[i].column);
+        CHECK(ev->type == expected[i].type && ev->config == expected[i].config,
+              "%s: type %u config 0x%lx, expected %u 0x%lx", ev->name, ev->type, ev->config,
+              expected[i].type, expected[i].config);
+        CHECK(ev->fd == -1 && ev->slot == -1, "%s: parsed event has fd %d slot %d", ev->name,
+              ev->fd, ev->slot);
+    }
+    
+    CHECK(perf_event_list_find(&list, "walks") == 3, "find(walks) = %d, expected 3",
+          perf_event_list_find(&list, "walks"));
+    CHECK(perf_event_list_find(&list, "page_faults") == 5, "find(page_faults) = %d, expected 5",
+          perf_event_list_find(&list, "page_faults"));
+    CHECK(perf_event_list_find(&list, "page-faults") == -1, "find matched the event, not the column");
+    CHECK(perf_event_list_value(&list, "missing") == 0, "value of an absent column not 0");
+    
+    perf_event_list_close(&list);
+    CHECK(list.count == 0 && list.events == NULL, "close left %d events", list.count);
+}
+
+static void test_growth(void) {
+    perf_event_list_t list;
+    char spec[512] = "";
+    
+    printf("List growth...\n");
+    
+    // Past the initial capacity of 8
+    for (int i = 0; i < 20; i++) {
+        char entry[32];
+        snprintf(entry, sizeof(entry), "%se%d=r%x", i ? "," : "", i, 0x100 + i);
+        strcat(spec, entry);
+    }
+    CHECK(perf_event_list_parse(&list, spec) == 20, "parsed %d of 20 events", list.count);
+    CHECK(perf_event_list_find(&list, "e19") == 19 && list.events[19].config == 0x113,
+          "last event lost in growth");
+    perf_event_list_close(&list);
+}
+
+static void test_reject(void) {
+    perf_event_list_t list;
+    
+    printf("Unknown events...\n");
+    
+    static const char *bad[] = {
+        "instructions,bogus", "r", "rxyz", "r01d1g", "walks=", "dTLB-misses", "LLC-load",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        int n = perf_event_list_parse(&list, bad[i]);
+        CHECK(n == -1 && list.count == 0 && list.events == NULL,
+              "\"%s\" parsed to %d events", bad[i], n);
+    }
+    
+    CHECK(perf_event_list_parse(&list, "") == 0 && list.count == 0, "empty spec not empty");
+    CHECK(perf_event_list_parse(&list, NULL) == 0 && list.count == 0, "NULL spec not empty");
+    
+    // $LRC_PERF_EVENTS replaces the default only when non-empty
+    setenv("LRC_PERF_EVENTS", "", 1);
+    CHECK(strcmp(perf_event_list_spec("cycles"), "cycles") == 0, "empty LRC_PERF_EVENTS used");
+    setenv("LRC_PERF_EVENTS", "r01d1", 1);
+    CHECK(strcmp(perf_event_list_spec("cycles"), "r01d1") == 0, "LRC_PERF_EVENTS ignored");
+    unsetenv("LRC_PERF_EVENTS");
+}
+
+int main(void) {
+    printf("=== Perf Event List Test ===\n\n");
+    
+    test_parse();
+    test_growth();
+    test_reject();
+    
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Test cross-thread queues: every item pushed is popped exactly once,
+ * in order per producer, for every queue type
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../core/queues.h"
+
+#define ITEMS 20000               // Per producer
+#define MAX_THREADS 4
+#define BATCH 8
+#define STOP UINT64_MAX
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                   \
+    if (!(cond)) {                              \
+        printf("ERROR: " __VA_ARGS__);          \
+        printf("\n");                           \
+        failures++;                             \
+    }                                           \
+} while (0)
+
+typedef struct {
+    queue_t *q;
+    int id;
+    uint64_t count[MAX_THREADS];  // Consumer: items seen per producer
+    uint64_t sum[MAX_THREADS];
+    uint64_t last[MAX_THREADS];   // Last sequence number + 1 per producer
+    int out_of_order;
+} worker_t;
+
+/* Item = producer id in the top bits, sequence number below */
+static void *producer(void *arg) {
+    worker_t *w = arg;
+    uint64_t items[BATCH];
+    
+    for (uint64_t i = 0; i < ITEMS; i += BATCH) {
+        int n = ITEMS - i < BATCH ? (int)(ITEMS - i) : BATCH;
+        for (int k = 0; k < n; k++) items[k] = ((uint64_t)w->id << 32) | (i + k);
+        queue_push(w->q, items, n);
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    worker_t *w = arg;
+    uint64_t items[BATCH];
+    int stopped = 0;
+    
+    while (!stopped) {
+        int n = queue_pop(w->q, items, BATCH);
+        for (int k = 0; k < n; k++) {
+            if (items[k] == STOP) {
+                // One stop per consumer: hand extra ones back
+                if (stopped++) queue_push(w->q, &items[k], 1);
+                continue;
+            }
+            int p = (int)(items[k] >> 32);
+            uint64_t seq = items[k] & 0xffffffffULL;
+            if (p < 0 || p >= MAX_THREADS) {
+                w->out_of_order++;
+                continue;
+            }
+            if (seq + 1 <= w->last[p]) w->out_of_order++;
+            w->last[p] = seq + 1;
+            w->count[p]++;
+            w->sum[p] += seq;
+        }
+    }
+    return NULL;
+}
+
+static void test_conservation(queue_type_t type, int producers, int consumers) {
+    static worker_t prod[MAX_THREADS], cons[MAX_THREADS];
+    pthread_t pt[MAX_THREADS], ct[MAX_THREADS];
+    
+    queue_t *q = queue_create(type, 64);
+    if (!q) {
+        perror(queue_type_name(type));
+        failures++;
+        return;
+    }
+    
+    for (int i = 0; i < consumers; i++) {
+        memset(&cons[i], 0, sizeof(worker_t));
+        cons[i].q = q;
+        pthread_create(&ct[i], NULL, consumer, &cons[i]);
+    }
+    for (int i = 0; i < producers; i++) {
+        memset(&prod[i], 0, sizeof(worker_t));
+        prod[i].q = q;
+        prod[i].id = i;
+        pthread_create(&pt[i], NULL, producer, &prod[i]);
+    }
+    for (int i = 0; i < producers; i++) pthread_join(pt[i], NULL);
+    
+    // Stops go in after every item, from this thread (spsc: the producers are done)
+    uint64_t stop = STOP;
+    for (int i = 0; i < consumers; i++) queue_push(q, &stop, 1);
+    for (int i = 0; i < consumers; i++) pthread_join(ct[i], NULL);
+    
+    uint64_t expected_sum = (uint64_t)ITEMS * (ITEMS - 1) / 2;
+    for (int p = 0; p < producers; p++) {
+        uint64_t count = 0, sum = 0;
+        for (int c = 0; c < consumers; c++) {
+            count += cons[c].count[p];
+            sum += cons[c].sum[p];
+        }
+        CHECK(count == ITEMS && sum == expected_sum,
+              "%s %dx%d: producer %d delivered %lu items (sum %lu), expected %d (sum %lu)",
+              queue_type_name(type), producers, consumers, p, count, sum, ITEMS, expected_sum);
+    }
+    for (int c = 0; c < consumers; c++) {
+        CHECK(cons[c].out_of_order == 0, "%s %dx%d: consumer %d saw %d items out of order",
+              queue_type_name(type), producers, consumers, c, cons[c].out_of_order);
+    }
+    
+    queue_destroy(q);
+}
+
+static void test_bench(thread_pool_t *pool, queue_type_t type, int producers, int consumers) {
+    static queue_result_t result;
+    queue_params_t params = { producers, consumers, BATCH, 64, ITEMS };
+    
+    if (queue_bench_run(pool, type, &params, &result) != 0) {
+        printf("ERROR: queue_bench_run(%s, %dx%d) failed\n", queue_type_name(type),
+               producers, consumers);
+        failures++;
+        return;
+    }
+    uint64_t expected = (uint64_t)producers * ITEMS;
+    CHECK(result.items == expected && result.latency.count == expected,
+          "%s %dx%d bench: %lu items, %lu latencies, expected %lu", queue_type_name(type),
+          producers, consumers, result.items, result.latency.count, expected);
+}
+
+int main(void) {
+    thread_pool_t pool;
+    
+    printf("=== Queue Test ===\n\n");
+    
+    // Unpinned: the test must also pass on one CPU
+    if (thread_pool_create(&pool, MAX_THREADS, NULL) != 0) {
+        printf("ERROR: thread_pool_create failed\n");
+        return 1;
+    }
+    
+    for (int type = 0; type < QUEUE_TYPE_COUNT; type++) {
+        printf("%s...\n", queue_type_name((queue_type_t)type));
+        test_conservation((queue_type_t)type, 1, 1);
+        test_bench(&pool, (queue_type_t)type, 1, 1);
+        if (queue_type_multi((queue_type_t)type)) {
+            test_conservation((queue_type_t)type, 2, 2);
+            test_bench(&pool, (queue_type_t)type, 2, 2);
+        }
+    }
+    
+    // spsc rejects a second producer instead of corrupting the ring
+    queue_params_t bad = { 2, 1, BATCH, 64, ITEMS };
+    static queue_result_t result;
+    CHECK(queue_bench_run(&pool, QUEUE_SPSC, &bad, &result) != 0, "spsc accepted two producers");
+    
+    thread_pool_destroy(&pool);
+    
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * Test the result sink: string table (results_intern), CSV output and
+ * column schema (long names, dropped columns, the partition column)
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../core/results.h"
+
+#define NUM_STRINGS 5000      // Several rehashes of the 64-slot initial table
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                   \
+    if (!(cond)) {                              \
+        printf("ERROR: " __VA_ARGS__);          \
+        printf("\n");                           \
+        failures++;                             \
+    }                                           \
+} while (0)
+
+/* Temporary CSV path; -1 (counted as a failure) if it cannot be created */
+static int temp_csv(char *path) {
+    int fd = mkstemps(path, 4);
+    if (fd < 0) {
+        perror("mkstemps");
+        failures++;
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+static void test_intern(void) {
+    results_t r;
+    char path[] = "/tmp/lrc_test_results_XXXXXX.csv";
+    char name[32];
+    
+    printf("String interning...\n");
+    
+    int fd = mkstemps(path, 4);
+    if (fd < 0 || results_open(&r, path, 16) != 0) {
+        perror("results_open");
+        failures++;
+        return;
+    }
+    close(fd);
+    
+    // Ids are dense in first-seen order and stable across rehashes
+    for (int i = 0; i < NUM_STRINGS; i++) {
+        snprintf(name, sizeof(name), "workload_%d", i);
+        uint64_t id = results_intern(&r, name);
+        CHECK(id == (uint64_t)i, "new string %d got id %lu", i, id);
+    }
+    for (int i = NUM_STRINGS - 1; i >= 0; i--) {
+        snprintf(name, sizeof(name), "workload_%d", i);
+        uint64_t id = results_intern(&r, name);
+        CHECK(id == (uint64_t)i, "existing string %d got id %lu", i, id);
+    }
+    
+    CHECK(results_intern(&r, NULL) == results_intern(&r, ""), "NULL is not interned as \"\"");
+    CHECK(results_intern(&r, "") == NUM_STRINGS, "\"\" got id %lu", results_intern(&r, ""));
+    CHECK(r.lost_strings == 0, "%zu strings lost without an allocation failure", r.lost_strings);
+    
+    // A failed intern (counted in lost_strings) must fail the sink
+    r.lost_strings = 1;
+    CHECK(results_close(&r) != 0, "results_close succeeded with a lost string");
+    unlink(path);
+}
+
+static void test_csv(void) {
+    results_t r;
+    char path[] = "/tmp/lrc_test_results_XXXXXX.csv";
+    char line[256];
+    
+    printf("CSV string cells...\n");
+    
+    int fd = mkstemps(path, 4);
+    if (fd < 0) {
+        perror("mkstemps");
+        failures++;
+        return;
+    }
+    close(fd);
+    
+    if (results_open(&r, path, 2) != 0) {
+        perror("results_open");
+        failures++;
+        return;
+    }
+    results_add_column(&r, "run", RESULT_U64, 0);
+    results_add_column(&r, "label", RESULT_STR, 0);
+    
+    // Rows past the preallocated capacity, repeated labels, one lost cell
+    static const char *labels[] = { "alpha", "beta", "alpha", "gamma", "beta" };
+    for (int i = 0; i < 5; i++) {
+        results_u64(&r, i);
+        results_str(&r, labels[i]);
+    }
+    results_u64(&r, 5);
+    results_put(&r, RESULTS_STRING_NONE);
+    
+    CHECK(results_close(&r) == 0, "results_close failed");
+    
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        failures++;
+        return;
+    }
+    CHECK(fgets(line, sizeof(line), f) && strcmp(line, "run,label\n") == 0, "header \"%s\"", line);
+    for (int i = 0; i < 6; i++) {
+        char expected[64];
+        snprintf(expected, sizeof(expected), "%d,%s\n", i, i < 5 ? labels[i] : "");
+        CHECK(fgets(line, sizeof(line), f) && strcmp(line, expected) == 0,
+              "row %d is \"%s\", expected \"%s\"", i, line, expected);
+    }
+    CHECK(!fgets(line, sizeof(line), f), "extra row \"%s\"", line);
+    fclose(f);
+    unlink(path);
+}
+
+static void test_long_event_name(void) {
+    results_t r;
+    perf_event_list_t list;
+    char path[] = "/tmp/lrc_test_results_XXXXXX.csv";
+    char spec[128], line[512], expected[512];
+    char label[61];
+    
+    printf("Long event column names...\n");
+    
+    // A 60-character label: valid for perf (PERF_EVENT_NAME_MAX), too long for the sink
+    memset(label, 'x', 60);
+    label[60] = '\0';
+    snprintf(spec, sizeof(spec), "%s=instructions,cycles", label);
+    if (perf_event_list_parse(&list, spec) != 2 || temp_csv(path) != 0) {
+        printf("ERROR: could not set up \"%s\"\n", spec);
+        failures++;
+        return;
+    }
+    list.events[0].value = 111;
+    list.events[1].value = 222;
+    
+    if (results_open(&r, path, 2) != 0) {
+        perror("results_open");
+        failures++;
+        return;
+    }
+    results_add_column(&r, "run", RESULT_U64, 0);
+    results_add_event_columns(&r, &list);
+    results_add_column(&r, "label", RESULT_STR, 0);
+    CHECK(r.num_columns == 5, "%d columns, expected 5", r.num_columns);
+    
+    results_u64(&r, 7);
+    results_events(&r, &list);
+    results_str(&r, "end");
+    CHECK(results_close(&r) == 0, "results_close failed");
+    perf_event_list_close(&list);
+    
+    // Truncated to RESULTS_NAME_MAX - 1, and every cell still under its header
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        failures++;
+        return;
+    }
+    snprintf(expected, sizeof(expected), "run,%.*s,cycles,perf_running_ratio,label\n",
+             RESULTS_NAME_MAX - 1, label);
+    CHECK(fgets(line, sizeof(line), f) && strcmp(line, expected) == 0, "header \"%s\"", line);
+    CHECK(fgets(line, sizeof(line), f) && strcmp(line, "7,111,222,0.000,end\n") == 0,
+          "row \"%s\"", line);
+    fclose(f);
+    unlink(path);
+}
+
+static void test_dropped_column(void) {
+    results_t r;
+    char path[] = "/tmp/lrc_test_results_XXXXXX.csv";
+    char name[32];
+    
+    printf("Dropped columns...\n");
+    
+    if (temp_csv(path) != 0) return;
+    if (results_open(&r, path, 2) != 0) {
+        perror("results_open");
+        failures++;
+        return;
+    }
+    
+    // One past the schema limit: the extra column is refused and the sink fails
+    for (int c = 0; c <= RESULTS_MAX_COLUMNS; c++) {
+        snprintf(name, sizeof(name), "c%d", c);
+        int idx = results_add_column(&r, name, RESULT_U64, 0);
+        CHECK((c < RESULTS_MAX_COLUMNS) == (idx == c), "column %d got index %d", c, idx);
+    }
+    for (int c = 0; c <= RESULTS_MAX_COLUMNS; c++) results_u64(&r, c);
+    
+    CHECK(results_close(&r) != 0, "results_close succeeded with a dropped column");
+    CHECK(access(path, F_OK) != 0, "misaligned %s left behind", path);
+    unlink(path);
+}
+
+static void test_partition(void) {
+    results_t r;
+    char path[] = "/tmp/lrc_test_results_XXXXXX.csv";
+    char line[256];
+    
+    printf("Suite runner partition column...\n");
+    
+    if (temp_csv(path) != 0) return;
+    setenv("LRC_PARTITION", "l3:1", 1);
+    if (results_open(&r, path, 2) != 0) {
+        perror("results_open");
+        failures++;
+        unsetenv("LRC_PARTITION");
+        return;
+    }
+    results_add_column(&r, "run", RESULT_U64, 0);
+    for (int i = 0; i < 3; i++) results_u64(&r, i);
+    CHECK(results_close(&r) == 0, "results_close failed");
+    unsetenv("LRC_PARTITION");
+    
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        failures++;
+        return;
+    }
+    CHECK(fgets(line, sizeof(line), f) && strcmp(line, "run,partition\n") == 0, "header \"%s\"", line);
+    for (int i = 0; i < 3; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%d,l3:1\n", i);
+        CHECK(fgets(line, sizeof(line), f) && strcmp(line, expected) == 0,
+              "row %d is \"%s\", expected \"%s\"", i, line, expected);
+    }
+    fclose(f);
+    unlink(path);
+}
+
+int main(void) {
+    printf("=== Results Sink Test ===\n\n");
+    
+    setenv("LRC_RESULTS_FORMAT", "csv", 1);   // No .lrcr files left behind
+    
+    test_intern();
+    test_csv();
+    test_long_event_name();
+    test_dropped_column();
+    test_partition();
+    
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Test the run-count controller: warmup, stop conditions and median CI
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../core/run_control.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                   \
+    if (!(cond)) {                              \
+        printf("ERROR: " __VA_ARGS__);          \
+        printf("\n");                           \
+        failures++;                             \
+    }                                           \
+} while (0)
+
+static void clear_env(void) {
+    unsetenv("LRC_RUNS");
+    unsetenv("LRC_WARMUP");
+    unsetenv("LRC_MIN_RUNS");
+    unsetenv("LRC_MAX_RUNS");
+    unsetenv("LRC_CI_TARGET");
+    unsetenv("LRC_RUN_BUDGET_S");
+}
+
+/* Drive rc with value(i) for run i (warmup included); returns total runs */
+static int drive(run_control_t *rc, double (*value)(int)) {
+    int total = 0;
+    while (run_control_next(rc)) {
+        run_control_add(rc, value(total));
+        total++;
+    }
+    return total;
+}
+
+static double constant(int i) { (void)i; return 100.0; }
+static double alternating(int i) { return i % 2 ? 1.0 : 100.0; }
+
+static void test_fixed(void) {
+    run_control_t rc;
+    
+    printf("LRC_RUNS fixed count...\n");
+    clear_env();
+    setenv("LRC_RUNS", "4", 1);
+    
+    run_control_begin(&rc, 8, 100);
+    int total = drive(&rc, constant);
+    CHECK(total == 4 && rc.runs == 4, "%d runs (%d measured), expected 4 without warmup",
+          total, rc.runs);
+    CHECK(rc.stop == RUN_STOP_FIXED, "stop %s, expected fixed", run_control_stop_name(rc.stop));
+}
+
+static void test_converge_floor(void) {
+    run_control_t rc;
+    
+    printf("Convergence floor...\n");
+    clear_env();
+    
+    // A constant value converges as soon as the CI exists: n = 8, not min_runs = 3
+    run_control_begin(&rc, 3, 100);
+    CHECK(rc.min_runs == RUN_CONTROL_MIN_CI_RUNS, "min_runs %d, expected %d", rc.min_runs,
+          RUN_CONTROL_MIN_CI_RUNS);
+    CHECK(run_control_next(&rc) && run_control_add(&rc, 1e9) == 0, "first run was not warmup");
+    
+    for (int i = 0; i < RUN_CONTROL_MIN_CI_RUNS - 1; i++) {
+        CHECK(run_control_next(&rc), "stopped after %d runs", rc.runs);
+        CHECK(run_control_add(&rc, 100.0) == 1, "measured run not counted");
+        CHECK(rc.rel_halfwidth < 0, "CI defined with %d runs", rc.runs);
+    }
+    run_control_next(&rc);
+    run_control_add(&rc, 100.0);
+    CHECK(rc.rel_halfwidth == 0.0, "CI half-width %.3f at n = 8", rc.rel_halfwidth);
+    CHECK(!run_control_next(&rc) && rc.stop == RUN_STOP_CONVERGED, "no convergence at n = 8 (%s)",
+          run_control_stop_name(rc.stop));
+    CHECK(rc.median == 100.0 && run_control_index(&rc) == 7, "median %.1f, index %d", rc.median,
+          run_control_index(&rc));
+}
+
+static void test_ci_ranks(void) {
+    run_control_t rc;
+    
+    printf("Median and order-statistic CI...\n");
+    clear_env();
+    setenv("LRC_WARMUP", "0", 1);
+    
+    // Added out of order; kept sorted. n = 8: ranks 1 and 8
+    static const double v[] = { 5, 3, 8, 1, 7, 2, 6, 4 };
+    run_control_begin(&rc, 8, 100);
+    for (int i = 0; i < 8; i++) {
+        run_control_next(&rc);
+        run_control_add(&rc, v[i]);
+        if (i == 6) CHECK(rc.median == 5.0, "odd median %.1f, expected 5", rc.median);
+    }
+    CHECK(rc.median == 4.5, "even median %.2f, expected 4.5", rc.median);
+    CHECK(rc.ci_low == 1.0 && rc.ci_high == 8.0, "CI [%.1f, %.1f], expected [1, 8]",
+          rc.ci_low, rc.ci_high);
+    CHECK(rc.rel_halfwidth > 0.77 && rc.rel_halfwidth < 0.78, "half-width %.4f, expected 3.5/4.5",
+          rc.rel_halfwidth);
+}
+
+static void test_max_runs(void) {
+    run_control_t rc;
+    
+    printf("Run cap and budget...\n");
+    clear_env();
+    
+    // Bimodal values never reach a 2% CI
+    run_control_begin(&rc, 5, 20);
+    int total = drive(&rc, alternating);
+    CHECK(rc.runs == 20 && total == 21, "%d measured of %d runs, expected 20 of 21", rc.runs, total);
+    CHECK(rc.stop == RUN_STOP_MAX_RUNS, "stop %s, expected max_runs", run_control_stop_name(rc.stop));
+    
+    // LRC_MAX_RUNS overrides the cap; min_runs never exceeds it
+    setenv("LRC_MAX_RUNS", "6", 1);
+    run_control_begin(&rc, 5, 20);
+    CHECK(rc.max_runs == 6 && rc.min_runs == 6, "min/max %d/%d, expected 6/6", rc.min_runs,
+          rc.max_runs);
+    unsetenv("LRC_MAX_RUNS");
+    
+    // An exhausted budget stops after the first measured run
+    setenv("LRC_RUN_BUDGET_S", "0.000000001", 1);
+    run_control_begin(&rc, 5, 20);
+    drive(&rc, alternating);
+    CHECK(rc.runs == 1 && rc.stop == RUN_STOP_BUDGET, "%d runs, stop %s, expected 1 and budget",
+          rc.runs, run_control_stop_name(rc.stop));
+}
+
+int main(void) {
+    printf("=== Run Control Test ===\n\n");
+    
+    test_fixed();
+    test_converge_floor();
+    test_ci_ranks();
+    test_max_runs();
+    clear_env();
+    
+    if (failures) {
+        printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nAll tests passed!\n");
+    return 0;
+}